@@ -0,0 +1,145 @@
+#pragma once
+#include "API/common.hpp"
+#include "API/services/StaticAssetStore.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief The network designer UI: cyperland.html and the css/js/icons next to it
+ *
+ *   GET /                        the designer page
+ *   GET /<path>.<ext>            any file of the Views directory (not under /api or /ws)
+ *
+ * Everything is answered from StaticAssetStore: bodies and their gzip/brotli
+ * variants were made once at startup, so a request does no disk IO and no
+ * compression. Every response has a strong ETag and If-None-Match gets a
+ * 304. The page links its files as "/js/app.js?v=<hash>"; a request carrying
+ * the current hash is cached for a year as immutable, anything else
+ * (the page itself, unversioned URLs) is "no-cache" and revalidated by ETag.
+ *
+ * Responses are built once per IO thread and asset variant and then reused
+ * (setExpiredTime(0) makes drogon keep the rendered bytes), the same way
+ * drogon's own static file router caches. Files too large for the store go
+ * out through newFileResponse, i.e. sendfile from disk.
+ */
+class WebController : public drogon::HttpController<WebController> {
+public:
+    using Callback = std::function<void(const drogon::HttpResponsePtr&)>;
+
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(WebController::index, "/", {drogon::Get, drogon::Head});
+    ADD_METHOD_VIA_REGEX(WebController::asset, "/((?!api/|ws/).+\\.[A-Za-z0-9]+)", {drogon::Get, drogon::Head});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run(); the store must already be loaded
+    static void configure(std::shared_ptr<const StaticAssetStore> store, std::string indexPage = "cyperland.html") {
+        assets() = std::move(store);
+        indexPath() = std::move(indexPage);
+    }
+
+    void index(const drogon::HttpRequestPtr& req, Callback&& callback) { serve(req, indexPath(), callback); }
+
+    void asset(const drogon::HttpRequestPtr& req, Callback&& callback, std::string path) { serve(req, path, callback); }
+
+private:
+    static constexpr const char* kImmutable = "public, max-age=31536000, immutable";
+    static constexpr const char* kRevalidate = "no-cache";
+
+    static std::shared_ptr<const StaticAssetStore>& assets() {
+        static std::shared_ptr<const StaticAssetStore> instance;
+        return instance;
+    }
+
+    static std::string& indexPath() {
+        static std::string instance = "cyperland.html";
+        return instance;
+    }
+
+    struct Variant {
+        const StaticAsset* asset;
+        int kind; // AssetEncoding, +3 for immutable, 6 for the 304, -1 for a 404 body
+
+        bool operator==(const Variant&) const = default;
+    };
+
+    struct VariantHash {
+        std::size_t operator()(const Variant& v) const noexcept {
+            return std::hash<const void*>{}(v.asset) ^ static_cast<std::size_t>(v.kind + 1);
+        }
+    };
+
+    // HttpResponse is not thread-safe, so each IO thread keeps its own prebuilt set
+    static drogon::HttpResponsePtr& cached(const Variant& key) {
+        thread_local std::unordered_map<Variant, drogon::HttpResponsePtr, VariantHash> responses;
+        return responses[key];
+    }
+
+    static void serve(const drogon::HttpRequestPtr& req, const std::string& path, const Callback& callback) {
+        const auto& store = assets();
+        const StaticAsset* asset = store ? store->find(path) : nullptr;
+        if (!asset) {
+            callback(notFound(store.get()));
+            return;
+        }
+
+        if (StaticAssetStore::matches(req->getHeader("if-none-match"), asset->etag)) {
+            auto& resp = cached({asset, 6});
+            if (!resp) {
+                resp = drogon::HttpResponse::newHttpResponse();
+                resp->setStatusCode(drogon::k304NotModified);
+                resp->addHeader("ETag", asset->etag);
+                resp->addHeader("Cache-Control", kRevalidate);
+                resp->setExpiredTime(0);
+            }
+            callback(resp);
+            return;
+        }
+
+        const bool page = asset->contentType.starts_with("text/html");
+        const bool immutable = !page && req->getParameter("v") == StaticAssetStore::version(*asset);
+        if (!asset->inMemory()) {
+            // rare and large: not worth a cached copy per thread
+            auto resp = drogon::HttpResponse::newFileResponse(asset->file.string());
+            resp->setContentTypeString(asset->contentType);
+            resp->addHeader("ETag", asset->etag);
+            resp->addHeader("Cache-Control", immutable ? kImmutable : kRevalidate);
+            callback(resp);
+            return;
+        }
+
+        const auto encoding = StaticAssetStore::negotiate(req->getHeader("accept-encoding"), *asset);
+        auto& resp = cached({asset, static_cast<int>(encoding) + (immutable ? 3 : 0)});
+        if (!resp) {
+            resp = drogon::HttpResponse::newHttpResponse();
+            resp->setContentTypeString(asset->contentType);
+            resp->setBody(asset->body(encoding));
+            resp->addHeader("ETag", asset->etag);
+            resp->addHeader("Cache-Control", immutable ? kImmutable : kRevalidate);
+            if (!asset->gzip.empty() || !asset->brotli.empty()) resp->addHeader("Vary", "Accept-Encoding");
+            if (encoding == AssetEncoding::Gzip) resp->addHeader("Content-Encoding", "gzip");
+            if (encoding == AssetEncoding::Brotli) resp->addHeader("Content-Encoding", "br");
+            resp->setExpiredTime(0);
+        }
+        callback(resp);
+    }
+
+    static drogon::HttpResponsePtr notFound(const StaticAssetStore* store) {
+        const StaticAsset* page = store ? store->find("404.html") : nullptr;
+        auto& resp = cached({page, -1});
+        if (!resp) {
+            resp = drogon::HttpResponse::newHttpResponse();
+            resp->setStatusCode(drogon::k404NotFound);
+            if (page && page->inMemory()) {
+                resp->setContentTypeString(page->contentType);
+                resp->setBody(page->identity);
+            } else {
+                resp->setContentTypeString("text/plain; charset=utf-8");
+                resp->setBody("Not found");
+            }
+            resp->addHeader("Cache-Control", kRevalidate);
+            resp->setExpiredTime(0);
+        }
+        return resp;
+    }
+};
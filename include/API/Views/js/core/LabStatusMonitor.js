@@ -0,0 +1,106 @@
+// === فئة: LabStatusMonitor ===
+// حالة أجهزة المختبر والمهام عبر /ws/labs بدل استطلاع كل متصفح لـ libvirt.
+// الخادم يرسل snapshot عند الاشتراك ثم delta واحدة لكل tick؛ عند الانقطاع يُعاد الاشتراك فيصل snapshot جديد.
+// جاهزية الأجهزة (probing/ready/failed) تصل بنفس الطريقة، فلا حاجة لاستطلاع الجهاز حتى يقلع.
+class LabStatusMonitor {
+  constructor(retryInterval = 3000) {
+    this.retryInterval = retryInterval;
+    this.labs = new Map(); // lab -> { vms: Map(name -> vm), ready: Map(name -> status), listeners: Set }
+    this.socket = null;
+    this.connect();
+  }
+
+  connect() {
+    const scheme = location.protocol === 'https:' ? 'wss' : 'ws';
+    this.socket = new WebSocket(`${scheme}://${location.host}/ws/labs`);
+
+    this.socket.addEventListener('open', () => {
+      for (const lab of this.labs.keys()) this.send({ subscribe: lab });
+    });
+
+    this.socket.addEventListener('message', (e) => {
+      try {
+        this.handleMessage(JSON.parse(e.data));
+      } catch (error) {
+        console.error('LabStatusMonitor: bad message', error);
+      }
+    });
+
+    this.socket.addEventListener('close', () => {
+      setTimeout(() => this.connect(), this.retryInterval);
+    });
+  }
+
+  send(message) {
+    if (this.socket && this.socket.readyState === WebSocket.OPEN) {
+      this.socket.send(JSON.stringify(message));
+    }
+  }
+
+  // listener(event) يُستدعى مع { lab, vms, tasks, ready, snapshot }؛ يعيد دالة لإلغاء الاشتراك
+  watch(lab, listener) {
+    let entry = this.labs.get(lab);
+    if (!entry) {
+      entry = { vms: new Map(), ready: new Map(), listeners: new Set() };
+      this.labs.set(lab, entry);
+      this.send({ subscribe: lab });
+    }
+    entry.listeners.add(listener);
+    return () => {
+      entry.listeners.delete(listener);
+      if (entry.listeners.size) return;
+      this.labs.delete(lab);
+      this.send({ unsubscribe: lab });
+    };
+  }
+
+  // الحالة المعروفة حالياً لأجهزة المختبر
+  vms(lab) {
+    const entry = this.labs.get(lab);
+    return entry ? [...entry.vms.values()] : [];
+  }
+
+  // آخر حالة جاهزية معروفة لأجهزة المختبر
+  ready(lab) {
+    const entry = this.labs.get(lab);
+    return entry ? [...entry.ready.values()] : [];
+  }
+
+  // يُحل مع حالة الجهاز عند جاهزيته ويُرفض إن فشل الفحص
+  whenReady(lab, name) {
+    return new Promise((resolve, reject) => {
+      let unwatch = null;
+      const settle = (status) => {
+        if (!status || status.state === 'probing') return false;
+        if (unwatch) unwatch();
+        if (status.state === 'ready') resolve(status);
+        else reject(new Error(`${name} never got ready: ${status.detail || status.state}`));
+        return true;
+      };
+      const known = this.labs.get(lab)?.ready.get(name);
+      if (settle(known)) return;
+      unwatch = this.watch(lab, (event) => settle(event.ready.find((s) => s.name === name)));
+    });
+  }
+
+  handleMessage(msg) {
+    const entry = this.labs.get(msg.lab);
+    if (!entry) return;
+    const snapshot = msg.type === 'snapshot';
+    if (snapshot) {
+      entry.vms.clear();
+      entry.ready.clear();
+    }
+    for (const vm of msg.vms || []) {
+      if (vm.state !== 'removed') {
+        entry.vms.set(vm.name, vm);
+        continue;
+      }
+      entry.vms.delete(vm.name);
+      entry.ready.delete(vm.name);
+    }
+    for (const status of msg.ready || []) entry.ready.set(status.name, status);
+    const event = { lab: msg.lab, vms: msg.vms || [], tasks: msg.tasks || [], ready: msg.ready || [], snapshot };
+    for (const listener of entry.listeners) listener(event);
+  }
+}
@@ -0,0 +1,94 @@
+// === فئة: TaskMonitor ===
+// متابعة المهام الطويلة (نشر، حذف، snapshot) عبر /ws/tasks بدل الاستطلاع المتكرر.
+// يرجع الاستطلاع عبر GET /api/v1/tasks/{id} فقط إذا انقطع الـ WebSocket.
+class TaskMonitor {
+  constructor(pollInterval = 3000) {
+    this.pollInterval = pollInterval;
+    this.waiters = new Map(); // taskId -> { onUpdate, resolve, reject }
+    this.socket = null;
+    this.pollTimer = null;
+    this.connect();
+  }
+
+  connect() {
+    const scheme = location.protocol === 'https:' ? 'wss' : 'ws';
+    this.socket = new WebSocket(`${scheme}://${location.host}/ws/tasks`);
+
+    this.socket.addEventListener('open', () => {
+      this.stopPolling();
+      for (const id of this.waiters.keys()) this.send({ subscribe: id });
+    });
+
+    this.socket.addEventListener('message', (e) => {
+      try {
+        this.handleUpdate(JSON.parse(e.data));
+      } catch (error) {
+        console.error('TaskMonitor: bad message', error);
+      }
+    });
+
+    this.socket.addEventListener('close', () => {
+      this.startPolling();
+      setTimeout(() => this.connect(), this.pollInterval);
+    });
+  }
+
+  send(message) {
+    if (this.socket && this.socket.readyState === WebSocket.OPEN) {
+      this.socket.send(JSON.stringify(message));
+    }
+  }
+
+  // ينتظر انتهاء المهمة؛ onUpdate يُستدعى عند كل تغيير حالة
+  track(taskId, onUpdate = null) {
+    return new Promise((resolve, reject) => {
+      this.waiters.set(taskId, { onUpdate, resolve, reject });
+      this.send({ subscribe: taskId });
+      if (this.pollTimer) this.poll(taskId);
+    });
+  }
+
+  // مساعد للطلبات التي ترد بـ 202 Accepted
+  async run(url, options = {}, onUpdate = null) {
+    const res = await fetch(url, options);
+    const body = res.status === 204 ? {} : await res.json();
+    if (!res.ok) throw new Error(body.error || `HTTP ${res.status}`);
+    if (res.status !== 202) return body;
+    const task = await this.track(body.taskId, onUpdate);
+    return task.result;
+  }
+
+  handleUpdate(task) {
+    const waiter = this.waiters.get(task.taskId);
+    if (!waiter) return;
+    if (waiter.onUpdate) waiter.onUpdate(task);
+    if (task.status === 'completed') {
+      this.waiters.delete(task.taskId);
+      waiter.resolve(task);
+    } else if (task.status === 'failed') {
+      this.waiters.delete(task.taskId);
+      waiter.reject(new Error(task.error || 'task failed'));
+    }
+  }
+
+  startPolling() {
+    if (this.pollTimer) return;
+    this.pollTimer = setInterval(() => {
+      for (const id of this.waiters.keys()) this.poll(id);
+    }, this.pollInterval);
+  }
+
+  stopPolling() {
+    clearInterval(this.pollTimer);
+    this.pollTimer = null;
+  }
+
+  async poll(taskId) {
+    try {
+      const res = await fetch(`/api/v1/tasks/${taskId}`);
+      if (res.ok) this.handleUpdate(await res.json());
+    } catch (error) {
+      console.error('TaskMonitor: poll failed', error);
+    }
+  }
+}
@@ -66,18 +66,14 @@ class UploadManager {
   async processFile(file) {
     try {
       this.updateProgress(0, `جاري معالجة ${file.name}...`);
-      
-      // محاكاة التقدم
-      for (let i = 0; i <= 100; i += 10) {
-        await this.delay(100);
-        this.updateProgress(i, `جاري رفع ${file.name}... (${i}%)`);
-      }
 
       // معالجة الملف حسب النوع
       const fileType = file.type;
       const fileName = file.name.toLowerCase();
 
-      if (fileName.endsWith('.json')) {
+      if (this.isDiskImage(fileName)) {
+        await this.uploadDiskImage(file);
+      } else if (fileName.endsWith('.json')) {
         await this.handleJsonFile(file);
       } else if (fileName.endsWith('.xml')) {
         await this.handleXmlFile(file);
@@ -96,6 +92,69 @@ class UploadManager {
     }
   }
 
+  isDiskImage(fileName) {
+    return ['.iso', '.qcow2', '.img', '.raw'].some(ext => fileName.endsWith(ext));
+  }
+
+  // رفع مجزأ قابل للاستئناف: POST لإنشاء الرفع ثم PUT لكل جزء مع Upload-Offset
+  async uploadDiskImage(file) {
+    const key = `penhive-upload:${file.name}:${file.size}`;
+    let upload = null;
+
+    // استئناف رفع سابق لنفس الملف إن كان الخادم ما زال يعرفه
+    const savedId = localStorage.getItem(key);
+    if (savedId) {
+      const res = await fetch(`/api/v1/uploads/${savedId}`);
+      if (res.ok) upload = await res.json();
+      else localStorage.removeItem(key);
+    }
+
+    if (!upload) {
+      const res = await fetch('/api/v1/uploads', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify({ fileName: file.name, size: file.size })
+      });
+      upload = await res.json();
+      if (!res.ok) throw new Error(upload.error || `HTTP ${res.status}`);
+      localStorage.setItem(key, upload.uploadId);
+    }
+
+    const chunkSize = upload.chunkSize;
+    let offset = upload.offset;
+    let retries = 0;
+
+    while (offset < file.size) {
+      const chunk = file.slice(offset, Math.min(offset + chunkSize, file.size));
+      let res;
+      try {
+        res = await fetch(`/api/v1/uploads/${upload.uploadId}`, {
+          method: 'PUT',
+          headers: { 'Upload-Offset': String(offset), 'Content-Type': 'application/octet-stream' },
+          body: chunk
+        });
+      } catch (err) {
+        // انقطاع الشبكة: ننتظر ثم نعيد نفس الجزء
+        if (++retries > 5) throw err;
+        await this.delay(1000 * retries);
+        continue;
+      }
+
+      const state = await res.json();
+      if (res.ok || res.status === 409) {
+        // في حالة 409 يخبرنا الخادم بالموضع الذي يتوقعه
+        offset = state.offset;
+        retries = 0;
+        this.updateProgress(Math.floor(state.progress), `جاري رفع ${file.name}... (${Math.floor(state.progress)}%)`);
+      } else {
+        if (++retries > 5) throw new Error(state.error || `HTTP ${res.status}`);
+        await this.delay(1000 * retries);
+      }
+    }
+
+    localStorage.removeItem(key);
+  }
+
   async handleJsonFile(file) {
     const text = await this.readFileAsText(file);
     const data = JSON.parse(text);
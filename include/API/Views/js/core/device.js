@@ -10,6 +10,7 @@ class Device {
         this.y = y;
         this.designer = designer;
         this.isDragging = false;
+        this.netProfile = ''; // '' | 'vhost' | 'throughput': NICs the lab wiring attaches
         
         this.el = this.createElement();
         this.designer.workspace.appendChild(this.el);
@@ -345,11 +346,26 @@ class Device {
                 <div class="property-item mb-2">
                     <strong>نظام التشغيل:</strong> ${this.getOSInfo().name}
                 </div>
+                <div class="property-item mb-2">
+                    <strong>ملف الشبكة:</strong>
+                    <select class="form-select form-select-sm mt-1" data-property="netProfile">
+                        <option value="">افتراضي (طابور واحد)</option>
+                        <option value="vhost">vhost-net</option>
+                        <option value="throughput">أداء عالٍ (طابور لكل vCPU)</option>
+                    </select>
+                </div>
                 <div class="property-item">
                     <strong>الحالة:</strong> <span class="text-success">● نشط</span>
                 </div>
             </div>
         `;
+        const profile = propertiesContent.querySelector('[data-property="netProfile"]');
+        profile.value = this.netProfile;
+        // applies to NICs attached by the next applyTopology
+        profile.addEventListener('change', () => {
+            this.netProfile = profile.value;
+            this.designer.queueTopologyOp({ op: 'updateDevice', id: this.id, netProfile: this.netProfile });
+        });
     }
 
     /**
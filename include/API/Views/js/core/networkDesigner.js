@@ -23,6 +23,13 @@ class NetworkDesigner {
         this.selectedCableId = null;
         this.zoomLevel = 1;
 
+        // مزامنة المخطط مع الخادم: تعديلات صغيرة (PATCH) بدل رفعه كاملاً عند كل تطبيق
+        this.labId = null;
+        this.topologyVersion = 0;
+        this.pendingOps = [];
+        this.syncTimer = null;
+        this.syncing = null;
+
         // حالة الاتصال المحسنة
         this.connectionState = {
             isConnecting: false,
@@ -187,6 +194,7 @@ class NetworkDesigner {
         
         device.showLoading();
         this.devices.set(id, device);
+        this.queueTopologyOp({ op: 'addDevice', id, type, netProfile: device.netProfile || '' });
         this.updatePlaceholder();
 
         try {
@@ -244,6 +252,7 @@ class NetworkDesigner {
         }
 
         this.devices.delete(id);
+        this.queueTopologyOp({ op: 'removeDevice', id });
         if (device.el && device.el.parentNode) {
             device.el.parentNode.removeChild(device.el);
         }
@@ -440,6 +449,7 @@ class NetworkDesigner {
         
         if (cable.isValid()) {
             this.cables.set(id, cable);
+            this.queueTopologyOp({ op: 'addCable', id, from: fromId, to: toId });
             this.selectCable(id);
             this.showNotification('تم إنشاء الاتصال بنجاح', 'success');
             return cable;
@@ -459,6 +469,7 @@ class NetworkDesigner {
 
         cable.remove();
         this.cables.delete(id);
+        this.queueTopologyOp({ op: 'removeCable', id });
 
         if (this.selectedCableId === id) {
             this.selectedCableId = null;
@@ -564,6 +575,122 @@ class NetworkDesigner {
         }
     }
 
+    /**
+     * تصدير المخطط بالصيغة التي يقبلها POST /api/v1/labs/{lab}/topology
+     */
+    exportTopology() {
+        const devices = [];
+        for (const [id, device] of this.devices) {
+            // netProfile: "vhost" | "throughput" for traffic-heavy devices (scanners, DoS targets)
+            devices.push({ id, type: device.type, domain: device.domain || '', netProfile: device.netProfile || '' });
+        }
+        const cables = [];
+        for (const [id, cable] of this.cables) {
+            cables.push({ id, from: cable.from, to: cable.to });
+        }
+        return { devices, cables };
+    }
+
+    /**
+     * ربط مساحة العمل بمختبر: يُرفع المخطط مرة واحدة ثم تُرسل التعديلات فقط
+     */
+    async attachLab(labId) {
+        this.labId = labId;
+        this.pendingOps = [];
+        await this.uploadTopology();
+    }
+
+    /**
+     * تعديل واحد على المخطط؛ تُجمع التعديلات وتُرسل دفعة واحدة بعد توقف قصير
+     */
+    queueTopologyOp(op) {
+        if (!this.labId) return;
+        this.pendingOps.push(op);
+        clearTimeout(this.syncTimer);
+        this.syncTimer = setTimeout(() => this.flushTopology(), 300);
+    }
+
+    /**
+     * إرسال التعديلات المعلقة؛ عند تعارض النسخة يُرفع المخطط كاملاً (مساحة العمل هي المرجع)
+     */
+    async flushTopology() {
+        clearTimeout(this.syncTimer);
+        // one request at a time: each PATCH needs the version the previous one returned
+        while (this.syncing) await this.syncing;
+        if (!this.labId || this.pendingOps.length === 0) return;
+        const ops = this.pendingOps;
+        this.pendingOps = [];
+        this.syncing = (async () => {
+            try {
+                const res = await fetch(this.topologyUrl(), {
+                    method: 'PATCH',
+                    headers: { 'Content-Type': 'application/json' },
+                    body: JSON.stringify({ baseVersion: this.topologyVersion, ops })
+                });
+                const body = await res.json();
+                if (res.ok) {
+                    this.topologyVersion = body.version;
+                    return;
+                }
+                console.warn('NetworkDesigner: topology update rejected, uploading the design', body.error);
+                await this.uploadTopology();
+            } catch (error) {
+                console.error('NetworkDesigner: topology sync failed', error);
+                this.pendingOps = ops.concat(this.pendingOps);
+            }
+        })();
+        try {
+            await this.syncing;
+        } finally {
+            this.syncing = null;
+        }
+    }
+
+    async uploadTopology() {
+        const res = await fetch(this.topologyUrl(), {
+            method: 'PUT',
+            headers: { 'Content-Type': 'application/json' },
+            body: JSON.stringify(this.exportTopology())
+        });
+        const body = await res.json();
+        if (!res.ok) throw new Error(body.error || `HTTP ${res.status}`);
+        this.pendingOps = [];
+        this.topologyVersion = body.version;
+    }
+
+    topologyUrl(labId = this.labId) {
+        return `/api/v1/labs/${encodeURIComponent(labId)}/topology`;
+    }
+
+    /**
+     * تطبيق التوصيلات على الـ VMs؛ الخادم يطبق الفرق فقط (dryRun = عرض الخطة دون تنفيذ)
+     * للمختبر المربوط يُطبق المخطط المخزن على الخادم دون إعادة رفعه
+     */
+    async applyTopology(labId, { dryRun = false } = {}) {
+        const url = `${this.topologyUrl(labId)}${dryRun ? '?dryRun=1' : ''}`;
+        const options = {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json' }
+        };
+        if (labId === this.labId) {
+            await this.flushTopology();
+        } else {
+            options.body = JSON.stringify(this.exportTopology());
+        }
+        try {
+            this.taskMonitor = this.taskMonitor || new TaskMonitor();
+            const result = await this.taskMonitor.run(url, options);
+            if (!dryRun) {
+                const failed = result.failed || 0;
+                this.showNotification(failed ? `فشل ${failed} من تغييرات التوصيل` : 'تم تطبيق التوصيلات', failed ? 'warning' : 'success');
+            }
+            return result;
+        } catch (error) {
+            this.showNotification(`فشل تطبيق المخطط: ${error.message}`, 'error');
+            throw error;
+        }
+    }
+
     /**
      * تبديل الوضع الداكن
      */
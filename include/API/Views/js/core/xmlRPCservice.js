@@ -5,9 +5,37 @@
 class XmlRPCService {
     constructor() {
         this.baseUrl = 'http://localhost:3000/xmlrpc';
+        this.batchUrl = '/api/v1/rpc';
         this.timeout = 10000;
     }
 
+    /**
+     * إرسال عدة عمليات في طلب واحد إلى /api/v1/rpc
+     * ops: [{ id, method, params, after: [ids] }] — العمليات المستقلة تُنفّذ بالتوازي على الخادم
+     * يعيد Map من id إلى { status, result | error }
+     */
+    async sendBatch(ops) {
+        const controller = new AbortController();
+        const timeoutId = setTimeout(() => controller.abort(), this.timeout * 6);
+        try {
+            const response = await fetch(this.batchUrl, {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/json', 'Accept': 'application/json' },
+                body: JSON.stringify({ ops }),
+                signal: controller.signal
+            });
+            const data = await response.json();
+            // 207 = بعض العمليات فشلت؛ التفاصيل في results
+            if (!response.ok && response.status !== 207) throw new Error(data.error || `HTTP error! status: ${response.status}`);
+            return new Map(data.results.map((r) => [r.id, r]));
+        } catch (error) {
+            if (error.name === 'AbortError') throw new Error('انتهت مهلة الاتصال بالخادم');
+            throw error;
+        } finally {
+            clearTimeout(timeoutId);
+        }
+    }
+
     /**
      * إرسال طلب XML-RPC
      */
@@ -0,0 +1,27 @@
+#pragma once
+#include "API/common.hpp"
+#include "Core/metrics/Metrics.hpp"
+
+/**
+ * @brief Prometheus scrape endpoint
+ *
+ *   GET /metrics        text exposition format 0.0.4
+ *
+ * Renders METRICS::MetricsRegistry::global(): libvirt call latency per API,
+ * deploy stage times, dispatcher queue depths and task latency, pool
+ * allocation and upload throughput. Callback gauges are sampled here, so a
+ * scrape costs one pass over the registry and nothing on the hot paths.
+ */
+class MetricsController : public drogon::HttpController<MetricsController> {
+public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(MetricsController::scrape, "/metrics", {drogon::Get});
+    METHOD_LIST_END
+
+    void scrape(const drogon::HttpRequestPtr&, std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+        resp->setBody(METRICS::MetricsRegistry::global().render());
+        callback(resp);
+    }
+};
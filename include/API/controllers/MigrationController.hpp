@@ -0,0 +1,172 @@
+#pragma once
+#include "API/common.hpp"
+#include "API/controllers/TaskController.hpp"
+#include "API/services/AsyncTaskManager.hpp"
+#include "Virtualization/cluster/MigrationManager.hpp"
+#include <memory>
+
+/**
+ * @brief Moving VMs between cluster hosts
+ *
+ *   POST /api/v1/vms/{name}/migrate       {"host": "...", "bandwidthMiBs": 0, "postCopy": false}
+ *   POST /api/v1/hosts/{host}/drain       every VM off the host (maintenance)
+ *   POST /api/v1/cluster/rebalance        {"highWater": 0.85}
+ *
+ * All three answer 202 + task id. While a migration runs, the task's
+ * "progress" carries bytes processed/remaining per VM, as polled from the
+ * libvirt job; /ws/tasks pushes every update.
+ */
+class MigrationController : public drogon::HttpController<MigrationController> {
+public:
+    using Callback = std::function<void(const drogon::HttpResponsePtr&)>;
+
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(MigrationController::migrate, "/api/v1/vms/{1}/migrate", {drogon::Post});
+    ADD_METHOD_TO(MigrationController::drain, "/api/v1/hosts/{1}/drain", {drogon::Post});
+    ADD_METHOD_TO(MigrationController::rebalance, "/api/v1/cluster/rebalance", {drogon::Post});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<MigrationManager> manager, std::shared_ptr<AsyncTaskManager> taskManager) {
+        migrations() = std::move(manager);
+        tasks() = std::move(taskManager);
+    }
+
+    void migrate(const drogon::HttpRequestPtr& req, Callback&& callback, std::string name) {
+        if (!ready(callback)) return;
+        auto json = req->getJsonObject();
+        const std::string host = json ? (*json).get("host", "").asString() : std::string{};
+        if (host.empty()) {
+            callback(error(drogon::k400BadRequest, "missing target host"));
+            return;
+        }
+        const MigrationOptions options = optionsOf(json.get());
+        auto id = tasks()->submitTracked("migrate", name,
+            [manager = migrations(), taskManager = tasks(), name, host, options](const std::string& taskId) -> Result<Json::Value> {
+                auto result = manager->migrate(name, host, options, reporter(taskManager, taskId));
+                if (!result.ok()) return Err{result.error};
+                return toJson(result);
+            });
+        callback(TaskController::accepted(id));
+    }
+
+    void drain(const drogon::HttpRequestPtr& req, Callback&& callback, std::string host) {
+        if (!ready(callback)) return;
+        auto json = req->getJsonObject();
+        const MigrationOptions options = optionsOf(json.get());
+        auto id = tasks()->submitTracked("drain", host,
+            [manager = migrations(), taskManager = tasks(), host, options](const std::string& taskId) -> Result<Json::Value> {
+                auto res = manager->drain(host, options, reporter(taskManager, taskId));
+                if (res.isErr()) return Err{std::move(res).unwrapErr()};
+                return toJson(res.unwrap());
+            });
+        callback(TaskController::accepted(id));
+    }
+
+    void rebalance(const drogon::HttpRequestPtr& req, Callback&& callback) {
+        if (!ready(callback)) return;
+        auto json = req->getJsonObject();
+        const double highWater = json ? (*json).get("highWater", 0.85).asDouble() : 0.85;
+        const MigrationOptions options = optionsOf(json.get());
+        auto id = tasks()->submitTracked("rebalance", "cluster",
+            [manager = migrations(), taskManager = tasks(), highWater, options](const std::string& taskId) -> Result<Json::Value> {
+                auto res = manager->rebalance(highWater, options, reporter(taskManager, taskId));
+                if (res.isErr()) return Err{std::move(res).unwrapErr()};
+                return toJson(res.unwrap());
+            });
+        callback(TaskController::accepted(id));
+    }
+
+private:
+    static std::shared_ptr<MigrationManager>& migrations() {
+        static std::shared_ptr<MigrationManager> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<AsyncTaskManager>& tasks() {
+        static std::shared_ptr<AsyncTaskManager> instance;
+        return instance;
+    }
+
+    static bool ready(const Callback& callback) {
+        if (migrations() && tasks()) return true;
+        callback(error(drogon::k503ServiceUnavailable, "migration service not configured"));
+        return false;
+    }
+
+    static MigrationOptions optionsOf(const Json::Value* json) {
+        MigrationOptions o;
+        if (!json) return o;
+        o.bandwidthMiBs = (*json).get("bandwidthMiBs", Json::UInt64(o.bandwidthMiBs)).asUInt64();
+        o.autoConverge = (*json).get("autoConverge", o.autoConverge).asBool();
+        o.postCopy = (*json).get("postCopy", o.postCopy).asBool();
+        o.compressed = (*json).get("compressed", o.compressed).asBool();
+        if (json->isMember("postCopyAfterSec")) o.postCopyAfter = std::chrono::seconds((*json)["postCopyAfterSec"].asInt64());
+        if (json->isMember("timeoutSec")) o.timeout = std::chrono::seconds((*json)["timeoutSec"].asInt64());
+        return o;
+    }
+
+    static const char* toString(MigrationPhase phase) noexcept {
+        switch (phase) {
+            case MigrationPhase::Queued: return "queued";
+            case MigrationPhase::Precopy: return "precopy";
+            case MigrationPhase::Postcopy: return "postcopy";
+            case MigrationPhase::Completed: return "completed";
+            case MigrationPhase::Failed: return "failed";
+        }
+        return "unknown";
+    }
+
+    // the task's progress is the set of migrations it currently runs, keyed by domain
+    static MigrationManager::ProgressFn reporter(std::shared_ptr<AsyncTaskManager> taskManager, std::string taskId) {
+        auto state = std::make_shared<std::pair<std::mutex, Json::Value>>();
+        return [taskManager = std::move(taskManager), taskId = std::move(taskId), state](const MigrationProgress& p) {
+            Json::Value snapshot;
+            {
+                std::lock_guard lock(state->first);
+                Json::Value& vm = state->second[p.domain];
+                vm["from"] = p.from;
+                vm["to"] = p.to;
+                vm["phase"] = toString(p.phase);
+                vm["dataTotal"] = Json::UInt64(p.dataTotal);
+                vm["dataProcessed"] = Json::UInt64(p.dataProcessed);
+                vm["dataRemaining"] = Json::UInt64(p.dataRemaining);
+                vm["elapsedMs"] = Json::Int64(p.elapsed.count());
+                snapshot = state->second;
+            }
+            taskManager->report(taskId, std::move(snapshot));
+        };
+    }
+
+    static Json::Value toJson(const MigrationResult& r) {
+        Json::Value v;
+        v["name"] = r.domain;
+        v["from"] = r.from;
+        v["to"] = r.to;
+        v["ms"] = Json::Int64(r.took.count());
+        v["postCopy"] = r.postCopy;
+        if (!r.ok()) v["error"] = r.error;
+        return v;
+    }
+
+    static Json::Value toJson(const std::vector<MigrationResult>& results) {
+        Json::Value v;
+        std::size_t failed = 0;
+        v["vms"] = Json::Value(Json::arrayValue);
+        for (const auto& r : results) {
+            if (!r.ok()) ++failed;
+            v["vms"].append(toJson(r));
+        }
+        v["succeeded"] = Json::UInt64(results.size() - failed);
+        v["failed"] = Json::UInt64(failed);
+        return v;
+    }
+
+    static drogon::HttpResponsePtr error(drogon::HttpStatusCode code, const std::string& message) {
+        Json::Value v;
+        v["error"] = message;
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+        resp->setStatusCode(code);
+        return resp;
+    }
+};
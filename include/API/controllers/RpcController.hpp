@@ -0,0 +1,286 @@
+#pragma once
+#include "API/common.hpp"
+#include "API/controllers/VirtualMachineApiController.hpp"
+#include "API/services/MsgPackCodec.hpp"
+#include "API/services/RpcBatch.hpp"
+#include "Core/concurrency/Offload.hpp"
+#include "Virtualization/vmm/TopologyApplier.hpp"
+#include "Virtualization/vmm/VirtualMachineManager.hpp"
+#include <memory>
+
+/**
+ * @brief Batched RPC: many designer / VM operations in one request
+ *
+ *   POST /api/v1/rpc   {"ops":[{"id":"a","method":"vm.start","params":{"name":"pc1"},"after":["b"]}, ...]}
+ *                      (a bare array of ops is accepted too; id defaults to the op's index)
+ *
+ * Bodies may be JSON or MessagePack (Content-Type application/msgpack); the
+ * reply uses MessagePack when Accept asks for it. The reply lists every op in
+ * request order: {"results":[{"id","status":"ok|failed|skipped","result"|"error"}],
+ * "ok":N,"failed":N,"skipped":N}, with 207 when anything did not succeed.
+ *
+ * Methods:
+ *   system.ping
+ *   vm.deploy        same params as POST /api/v1/vms (fails at once when deploy admission refuses it)
+ *   vm.start | vm.shutdown | vm.reboot | vm.destroy | vm.state   {"name"}
+ *   vm.delete        {"name","deleteStorage"}
+ *   lab.createDevice {"lab","id","type","domain","netProfile"}
+ *   lab.connectCable {"lab","id","from","to"}
+ * The lab.* ops of one lab are folded into a single TopologyApplier::apply,
+ * so together they must describe the lab's whole designer graph.
+ */
+class RpcController : public drogon::HttpController<RpcController> {
+public:
+    using Callback = std::function<void(const drogon::HttpResponsePtr&)>;
+
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(RpcController::call, "/api/v1/rpc", {drogon::Post});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run(); width caps the ops of one wave running at once
+    static void configure(std::shared_ptr<VirtualMachineManager> manager,
+                          std::shared_ptr<TopologyApplier> applier,
+                          std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                          std::size_t width = 8) {
+        auto methods = std::make_shared<RpcRegistry>();
+        registerMethods(*methods, manager, applier);
+        registry() = std::move(methods);
+        dispatcher_() = std::move(dispatcher);
+        width_() = std::max<std::size_t>(width, 1);
+    }
+
+    drogon::Task<> call(drogon::HttpRequestPtr req, Callback callback) {
+        const bool msgpackReply = MSGPACK::isMsgPack(req->getHeader("accept"));
+        if (!registry() || !dispatcher_()) {
+            callback(error(drogon::k503ServiceUnavailable, "rpc service not configured", msgpackReply));
+            co_return;
+        }
+        std::optional<Json::Value> body;
+        if (MSGPACK::isMsgPack(req->getHeader("content-type"))) {
+            body = MSGPACK::decode(req->body());
+        } else if (auto json = req->getJsonObject()) {
+            body = *json;
+        }
+        if (!body) {
+            callback(error(drogon::k400BadRequest, "body must be JSON or MessagePack", msgpackReply));
+            co_return;
+        }
+        auto ops = toOps(*body);
+        if (ops.isErr()) {
+            callback(error(drogon::k400BadRequest, ops.unwrapErr(), msgpackReply));
+            co_return;
+        }
+
+        // the whole batch is one blocking job; its waves fan out on their own threads (see parallelFor)
+        auto methods = registry();
+        const std::size_t width = width_();
+        std::vector<std::string> ids;
+        for (const auto& op : ops.unwrap()) ids.push_back(op.id);
+        auto res = co_await CONCURRENCY::Offload<Result<std::vector<RpcOutcome>>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+            [methods, width, ops = std::move(ops).unwrap()]() { return methods->run(ops, width); });
+        if (res.isErr()) {
+            callback(error(drogon::k400BadRequest, res.unwrapErr(), msgpackReply));
+            co_return;
+        }
+
+        const auto& outcomes = res.unwrap();
+        Json::Value reply;
+        Json::Value& results = reply["results"] = Json::Value(Json::arrayValue);
+        Json::UInt64 counts[3] = {0, 0, 0};
+        for (std::size_t i = 0; i < outcomes.size(); ++i) {
+            const auto& o = outcomes[i];
+            Json::Value item;
+            item["id"] = ids[i];
+            switch (o.status) {
+                case RpcOutcome::Status::Ok: item["status"] = "ok"; item["result"] = o.result; break;
+                case RpcOutcome::Status::Failed: item["status"] = "failed"; item["error"] = o.error; break;
+                case RpcOutcome::Status::Skipped: item["status"] = "skipped"; item["error"] = o.error; break;
+            }
+            ++counts[static_cast<int>(o.status)];
+            results.append(std::move(item));
+        }
+        reply["ok"] = counts[0];
+        reply["failed"] = counts[1];
+        reply["skipped"] = counts[2];
+        auto resp = respond(reply, msgpackReply);
+        if (counts[1] || counts[2]) resp->setStatusCode(drogon::k207MultiStatus);
+        callback(resp);
+    }
+
+private:
+    static std::shared_ptr<RpcRegistry>& registry() {
+        static std::shared_ptr<RpcRegistry> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<CONCURRENCY::EventDispatcher>& dispatcher_() {
+        static std::shared_ptr<CONCURRENCY::EventDispatcher> instance;
+        return instance;
+    }
+
+    static std::size_t& width_() {
+        static std::size_t instance = 8;
+        return instance;
+    }
+
+    static const Json::Value& opsOf(const Json::Value& body) { return body.isArray() ? body : body["ops"]; }
+
+    static std::string idOf(const Json::Value& op, std::size_t index) {
+        const auto& id = op["id"];
+        if (id.isString()) return id.asString();
+        if (id.isIntegral()) return id.asString();
+        return std::to_string(index);
+    }
+
+    static Result<std::vector<RpcOp>> toOps(const Json::Value& body) {
+        using R = Result<std::vector<RpcOp>>;
+        const Json::Value& ops = opsOf(body);
+        if (!ops.isArray() || ops.empty()) return R{std::string("ops must be a non-empty array")};
+        if (ops.size() > RpcRegistry::kMaxOps) return R{"Batch larger than " + std::to_string(RpcRegistry::kMaxOps) + " operations"};
+        std::vector<RpcOp> out;
+        out.reserve(ops.size());
+        for (Json::ArrayIndex i = 0; i < ops.size(); ++i) {
+            const auto& op = ops[i];
+            if (!op.isObject() || !op["method"].isString()) return R{"Operation " + std::to_string(i) + " has no method"};
+            RpcOp parsed;
+            parsed.id = idOf(op, i);
+            parsed.method = op["method"].asString();
+            parsed.params = op.get("params", Json::Value(Json::objectValue));
+            const auto& after = op["after"];
+            if (after.isString()) parsed.after.push_back(after.asString());
+            if (after.isArray()) {
+                for (const auto& dep : after) parsed.after.push_back(dep.asString());
+            }
+            out.push_back(std::move(parsed));
+        }
+        return R{std::move(out)};
+    }
+
+    static Result<std::string> nameParam(const Json::Value& params) {
+        if (!params["name"].isString() || params["name"].asString().empty()) return Err{"name is required"};
+        return params["name"].asString();
+    }
+
+    static void registerMethods(RpcRegistry& methods, const std::shared_ptr<VirtualMachineManager>& manager,
+                                const std::shared_ptr<TopologyApplier>& applier) {
+        methods.add("system.ping", [](const Json::Value&) -> Result<Json::Value> {
+            Json::Value v;
+            v["pong"] = true;
+            return v;
+        });
+        if (manager) registerVmMethods(methods, manager);
+        if (applier) registerLabMethods(methods, applier);
+    }
+
+    static void registerVmMethods(RpcRegistry& methods, const std::shared_ptr<VirtualMachineManager>& manager) {
+        methods.add("vm.deploy", [manager](const Json::Value& params) -> Result<Json::Value> {
+            if (!params["name"].isString() || !params["memoryKiB"].isUInt64() || !params["vcpus"].isUInt()) {
+                return Err{"name, memoryKiB and vcpus are required"};
+            }
+            auto cfg = VirtualMachineApiController::toConfig(params);
+            // the batch already holds a blocking thread: an admitted deploy runs right here, counted in flight
+            std::optional<Result<int>> res;
+            if (auto gate = manager->getDeployAdmission()) {
+                auto ticket = gate->admit(cfg);
+                if (ticket.isErr()) {
+                    const auto& rejection = ticket.unwrapErr();
+                    return Err{rejection.message + " (retry after " + std::to_string(rejection.retryAfter.count()) + "s)"};
+                }
+                gate->run(std::move(ticket).unwrap(), [&] { res = manager->dispatch_deploy(cfg); });
+            } else {
+                res = manager->dispatch_deploy(cfg);
+            }
+            if (res->isErr()) return Err{std::move(*res).unwrapErr()};
+            Json::Value v;
+            v["name"] = cfg.name;
+            v["id"] = res->unwrap();
+            return v;
+        });
+
+        // power actions go through VirtualMachine so errors read the same as everywhere else
+        auto power = [manager](void (VirtualMachine::*action)()) {
+            return [manager, action](const Json::Value& params) -> Result<Json::Value> {
+                auto name = nameParam(params);
+                if (name.isErr()) return Err{std::move(name).unwrapErr()};
+                if (auto woken = manager->wake(name.unwrap()); woken.isErr()) return Err{std::move(woken).unwrapErr()};
+                auto vm = manager->findDomainByName(name.unwrap());
+                if (vm.isErr()) return Err{std::move(vm).unwrapErr()};
+                (vm.unwrap().get()->*action)();
+                Json::Value v;
+                v["name"] = name.unwrap();
+                return v;
+            };
+        };
+        methods.add("vm.start", power(&VirtualMachine::start));
+        methods.add("vm.shutdown", power(&VirtualMachine::shutdown));
+        methods.add("vm.reboot", power(&VirtualMachine::reboot));
+        methods.add("vm.destroy", power(&VirtualMachine::destroy));
+
+        methods.add("vm.delete", [manager](const Json::Value& params) -> Result<Json::Value> {
+            auto name = nameParam(params);
+            if (name.isErr()) return Err{std::move(name).unwrapErr()};
+            auto res = manager->deleteDomain(name.unwrap(), params.get("deleteStorage", false).asBool());
+            if (res.isErr()) return Err{std::move(res).unwrapErr()};
+            Json::Value v;
+            v["name"] = name.unwrap();
+            return v;
+        });
+
+        methods.add("vm.state", [manager](const Json::Value& params) -> Result<Json::Value> {
+            auto name = nameParam(params);
+            if (name.isErr()) return Err{std::move(name).unwrapErr()};
+            auto state = manager->getState(name.unwrap());
+            if (state.isErr()) return Err{std::move(state).unwrapErr()};
+            Json::Value v;
+            v["name"] = name.unwrap();
+            v["state"] = static_cast<int>(state.unwrap());
+            return v;
+        });
+    }
+
+    static void registerLabMethods(RpcRegistry& methods, const std::shared_ptr<TopologyApplier>& applier) {
+        methods.fold({"lab.createDevice", "lab.connectCable"}, "lab",
+            [applier](const std::string& lab, const std::vector<const RpcOp*>& ops) -> Result<Json::Value> {
+                LabTopology topology;
+                topology.lab = lab;
+                for (const auto* op : ops) {
+                    const auto& p = op->params;
+                    if (op->method == "lab.createDevice") {
+                        topology.devices.push_back({p["id"].asString(), p.get("type", "pc").asString(), p.get("domain", "").asString(),
+                                                    p.get("netProfile", "").asString()});
+                    } else {
+                        topology.links.push_back({p.get("id", "").asString(), p["from"].asString(), p["to"].asString()});
+                    }
+                }
+                auto res = applier->apply(topology);
+                if (res.isErr()) return Err{std::move(res).unwrapErr()};
+                const auto& applied = res.unwrap();
+                if (!applied.ok()) {
+                    std::string message = "Topology of " + lab + ": " + std::to_string(applied.failed) + " changes failed";
+                    if (!applied.errors.empty()) message += " (" + applied.errors.front() + ")";
+                    return Err{std::move(message)};
+                }
+                Json::Value v;
+                v["lab"] = lab;
+                v["applied"] = Json::UInt64(applied.applied);
+                v["networks"] = Json::UInt64(applied.plan.createNetworks.size());
+                return v;
+            });
+    }
+
+    static drogon::HttpResponsePtr respond(const Json::Value& body, bool msgpack) {
+        if (!msgpack) return drogon::HttpResponse::newHttpJsonResponse(body);
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setContentTypeString("application/msgpack");
+        resp->setBody(MSGPACK::encode(body));
+        return resp;
+    }
+
+    static drogon::HttpResponsePtr error(drogon::HttpStatusCode code, const std::string& message, bool msgpack) {
+        Json::Value v;
+        v["error"] = message;
+        auto resp = respond(v, msgpack);
+        resp->setStatusCode(code);
+        return resp;
+    }
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include "API/common.hpp"
+#include "API/controllers/TaskController.hpp"
+#include "API/services/AsyncTaskManager.hpp"
+#include "Core/concurrency/Offload.hpp"
+#include "Virtualization/vmm/SnapshotEngine.hpp"
+#include <memory>
+
+/**
+ * @brief Lab resets and VM snapshots
+ *
+ *   POST /api/v1/labs/{lab}/revert        every VM of the lab back to its golden state
+ *   POST /api/v1/vms/{name}/golden        (re)capture the golden state from the VM's current state
+ *   POST /api/v1/vms/{name}/revert        {"snapshot": "..."}; without a body: the golden state
+ *
+ * Lab resets answer 202 + task id when a task manager is configured; all
+ * other calls await the libvirt work on the dispatcher's blocking lane.
+ */
+class SnapshotController : public drogon::HttpController<SnapshotController> {
+public:
+    using Callback = std::function<void(const drogon::HttpResponsePtr&)>;
+
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(SnapshotController::revertLab, "/api/v1/labs/{1}/revert", {drogon::Post});
+    ADD_METHOD_TO(SnapshotController::captureGolden, "/api/v1/vms/{1}/golden", {drogon::Post});
+    ADD_METHOD_TO(SnapshotController::revertVm, "/api/v1/vms/{1}/revert", {drogon::Post});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<SnapshotEngine> engine,
+                          std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                          std::shared_ptr<AsyncTaskManager> taskManager = nullptr) {
+        snapshots() = std::move(engine);
+        dispatcher_() = std::move(dispatcher);
+        tasks() = std::move(taskManager);
+    }
+
+    drogon::Task<> revertLab(drogon::HttpRequestPtr req, Callback callback, std::string lab) {
+        (void)req;
+        if (!snapshots()) {
+            callback(error(drogon::k503ServiceUnavailable, "snapshot service not configured"));
+            co_return;
+        }
+        auto engine = snapshots();
+        if (tasks()) {
+            auto id = tasks()->submit("revert", lab, [engine, lab]() -> Result<Json::Value> {
+                auto res = engine->revert_lab(lab);
+                if (res.isErr()) return Err{std::move(res).unwrapErr()};
+                return toJson(res.unwrap());
+            });
+            callback(TaskController::accepted(id));
+            co_return;
+        }
+        auto res = co_await CONCURRENCY::Offload<Result<LabRevertResult>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+            [engine, lab]() { return engine->revert_lab(lab); });
+        if (res.isErr()) {
+            callback(error(drogon::k404NotFound, res.unwrapErr()));
+            co_return;
+        }
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(toJson(res.unwrap()));
+        if (res.unwrap().failed() > 0) resp->setStatusCode(drogon::k207MultiStatus);
+        callback(resp);
+    }
+
+    drogon::Task<> captureGolden(drogon::HttpRequestPtr req, Callback callback, std::string name) {
+        (void)req;
+        if (!snapshots()) {
+            callback(error(drogon::k503ServiceUnavailable, "snapshot service not configured"));
+            co_return;
+        }
+        auto engine = snapshots();
+        auto res = co_await CONCURRENCY::Offload<Result<void>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+            [engine, name]() { return engine->captureGolden(name); });
+        callback(res.isErr() ? error(drogon::k400BadRequest, res.unwrapErr()) : ok(name));
+    }
+
+    drogon::Task<> revertVm(drogon::HttpRequestPtr req, Callback callback, std::string name) {
+        if (!snapshots()) {
+            callback(error(drogon::k503ServiceUnavailable, "snapshot service not configured"));
+            co_return;
+        }
+        std::string snapshot;
+        if (auto json = req->getJsonObject()) snapshot = (*json).get("snapshot", "").asString();
+        auto engine = snapshots();
+        auto res = co_await CONCURRENCY::Offload<Result<void>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+            [engine, name, snapshot]() { return snapshot.empty() ? engine->revertToGolden(name) : engine->revert(name, snapshot); });
+        callback(res.isErr() ? error(drogon::k400BadRequest, res.unwrapErr()) : ok(name));
+    }
+
+private:
+    static std::shared_ptr<SnapshotEngine>& snapshots() {
+        static std::shared_ptr<SnapshotEngine> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<CONCURRENCY::EventDispatcher>& dispatcher_() {
+        static std::shared_ptr<CONCURRENCY::EventDispatcher> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<AsyncTaskManager>& tasks() {
+        static std::shared_ptr<AsyncTaskManager> instance;
+        return instance;
+    }
+
+    static Json::Value toJson(const LabRevertResult& result) {
+        Json::Value v;
+        v["lab"] = result.lab;
+        v["succeeded"] = Json::UInt64(result.succeeded());
+        v["failed"] = Json::UInt64(result.failed());
+        v["totalMs"] = Json::Int64(result.total.count());
+        v["vms"] = Json::Value(Json::arrayValue);
+        for (const auto& o : result.outcomes) {
+            Json::Value vm;
+            vm["name"] = o.domain;
+            vm["ms"] = Json::Int64(o.took.count());
+            if (!o.ok()) vm["error"] = o.error;
+            v["vms"].append(vm);
+        }
+        return v;
+    }
+
+    static drogon::HttpResponsePtr ok(const std::string& name) {
+        Json::Value v;
+        v["name"] = name;
+        v["status"] = "ok";
+        return drogon::HttpResponse::newHttpJsonResponse(v);
+    }
+
+    static drogon::HttpResponsePtr error(drogon::HttpStatusCode code, const std::string& message) {
+        Json::Value v;
+        v["error"] = message;
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+        resp->setStatusCode(code);
+        return resp;
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include "API/common.hpp"
+#include "API/services/AsyncTaskManager.hpp"
+#include <charconv>
+#include <memory>
+
+/**
+ * @brief Polling side of the async task tracker (the push side is /ws/tasks)
+ *
+ *   GET /api/v1/tasks           newest first (?limit=N, default 100)
+ *   GET /api/v1/tasks/{id}      one task: status, and result or error once finished
+ *
+ * Reads only take shared shard locks; nothing here touches libvirt.
+ */
+class TaskController : public drogon::HttpController<TaskController> {
+public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(TaskController::list, "/api/v1/tasks", {drogon::Get});
+    ADD_METHOD_TO(TaskController::get, "/api/v1/tasks/{1}", {drogon::Get});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<AsyncTaskManager> manager) {
+        tasks() = std::move(manager);
+    }
+
+    void list(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
+        if (!ready(callback)) return;
+        std::size_t limit = 100;
+        const std::string& param = req->getParameter("limit");
+        if (!param.empty()) std::from_chars(param.data(), param.data() + param.size(), limit);
+        Json::Value body(Json::arrayValue);
+        for (const auto& task : tasks()->list(limit)) body.append(task.toJson());
+        callback(drogon::HttpResponse::newHttpJsonResponse(body));
+    }
+
+    void get(const drogon::HttpRequestPtr&, std::function<void(const drogon::HttpResponsePtr&)>&& callback, std::string id) {
+        if (!ready(callback)) return;
+        auto task = tasks()->get(id);
+        if (!task) {
+            callback(error(drogon::k404NotFound, "Task not found: " + id));
+            return;
+        }
+        callback(drogon::HttpResponse::newHttpJsonResponse(task->toJson()));
+    }
+
+    // 202 Accepted pointing at the task; shared by the controllers that start long operations
+    static drogon::HttpResponsePtr accepted(const std::string& taskId) {
+        Json::Value body;
+        body["status"] = "accepted";
+        body["taskId"] = taskId;
+        body["location"] = "/api/v1/tasks/" + taskId;
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(body);
+        resp->setStatusCode(drogon::k202Accepted);
+        resp->addHeader("Location", "/api/v1/tasks/" + taskId);
+        return resp;
+    }
+
+private:
+    static std::shared_ptr<AsyncTaskManager>& tasks() {
+        static std::shared_ptr<AsyncTaskManager> instance;
+        return instance;
+    }
+
+    static bool ready(const std::function<void(const drogon::HttpResponsePtr&)>& callback) {
+        if (tasks()) return true;
+        callback(error(drogon::k503ServiceUnavailable, "task service not configured"));
+        return false;
+    }
+
+    static drogon::HttpResponsePtr error(drogon::HttpStatusCode code, const std::string& message) {
+        Json::Value v;
+        v["error"] = message;
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+        resp->setStatusCode(code);
+        return resp;
+    }
+};
@@ -0,0 +1,352 @@
+#pragma once
+#include "API/common.hpp"
+#include "API/controllers/TaskController.hpp"
+#include "API/services/AsyncTaskManager.hpp"
+#include "Core/concurrency/Offload.hpp"
+#include "Virtualization/vmm/TopologyApplier.hpp"
+#include "Virtualization/vmm/TopologyStore.hpp"
+#include <map>
+#include <memory>
+#include <optional>
+
+/**
+ * @brief Applies a network designer graph to a lab's VMs
+ *
+ *   POST /api/v1/labs/{lab}/topology     {"devices":[{"id","type","domain","netProfile"}],"cables":[{"id","from","to"}]}
+ *                                        ?dryRun=1 only returns the plan; without a body the stored design is applied
+ *   DELETE /api/v1/labs/{lab}/topology   the lab is over: removes all of its networks and the stored design
+ *
+ * With a TopologyStore the design lives on the server and the designer
+ * sends edits instead of the whole graph:
+ *   GET /api/v1/labs/{lab}/topology      stored design + version
+ *   PUT /api/v1/labs/{lab}/topology      replaces the stored design (same body as POST), nothing is applied
+ *   PATCH /api/v1/labs/{lab}/topology    {"baseVersion":N,"ops":[{"op":"addDevice","id",...},
+ *                                        {"op":"updateDevice","id","domain"},{"op":"removeDevice","id"},
+ *                                        {"op":"addCable","id","from","to"},{"op":"removeCable","id"}]}
+ *                                        all or nothing; 409 + current version when N is stale
+ * A POST with a body also replaces the stored design.
+ *
+ * Only the difference to the current wiring is applied (see TopologyApplier;
+ * a stored design is applied straight from the store's graph). With a task
+ * manager configured the apply answers 202 + task id; otherwise the handler
+ * awaits it on the dispatcher's blocking lane. Store calls go to the same
+ * lane: a miss reads the lab's graph back from RocksDB, and every write is a
+ * synchronous WriteBatch.
+ */
+class TopologyController : public drogon::HttpController<TopologyController> {
+public:
+    using Callback = std::function<void(const drogon::HttpResponsePtr&)>;
+
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(TopologyController::apply, "/api/v1/labs/{1}/topology", {drogon::Post});
+    ADD_METHOD_TO(TopologyController::teardown, "/api/v1/labs/{1}/topology", {drogon::Delete});
+    ADD_METHOD_TO(TopologyController::get, "/api/v1/labs/{1}/topology", {drogon::Get});
+    ADD_METHOD_TO(TopologyController::replace, "/api/v1/labs/{1}/topology", {drogon::Put});
+    ADD_METHOD_TO(TopologyController::update, "/api/v1/labs/{1}/topology", {drogon::Patch});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<TopologyApplier> applier,
+                          std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                          std::shared_ptr<AsyncTaskManager> taskManager = nullptr,
+                          std::shared_ptr<TopologyStore> store = nullptr) {
+        if (applier && store) applier->setTopologyStore(store);
+        topologies() = std::move(applier);
+        dispatcher_() = std::move(dispatcher);
+        tasks() = std::move(taskManager);
+        designs() = std::move(store);
+    }
+
+    drogon::Task<> apply(drogon::HttpRequestPtr req, Callback callback, std::string lab) {
+        if (!topologies()) {
+            callback(error(drogon::k503ServiceUnavailable, "topology service not configured"));
+            co_return;
+        }
+        auto json = req->getJsonObject();
+        auto applier = topologies();
+        const bool dryRun = req->getParameter("dryRun") == "1";
+        // without a body the stored design is applied from the store's graph
+        std::optional<LabTopology> topology;
+        if (json && (*json)["devices"].isArray()) {
+            topology = toTopology(lab, *json);
+            if (auto store = designs(); store && !dryRun) {
+                auto res = co_await CONCURRENCY::Offload<Result<TopologyRevision>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+                    [store, design = *topology]() { return store->replace(design); });
+                if (res.isErr()) {
+                    callback(error(drogon::k400BadRequest, res.unwrapErr()));
+                    co_return;
+                }
+            }
+        } else if (!designs()) {
+            callback(error(drogon::k400BadRequest, "devices and cables are required"));
+            co_return;
+        }
+
+        if (dryRun) {
+            auto res = co_await CONCURRENCY::Offload<Result<TopologyPlan>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+                [applier, topology, lab]() { return topology ? applier->plan(*topology) : applier->planStored(lab); });
+            if (res.isErr()) {
+                callback(error(drogon::k400BadRequest, res.unwrapErr()));
+                co_return;
+            }
+            callback(drogon::HttpResponse::newHttpJsonResponse(toJson(res.unwrap())));
+            co_return;
+        }
+
+        auto run = [applier, topology = std::move(topology), lab]() {
+            return topology ? applier->apply(*topology) : applier->applyStored(lab);
+        };
+        if (tasks()) {
+            auto id = tasks()->submit("topology", lab, [run]() -> Result<Json::Value> {
+                auto res = run();
+                if (res.isErr()) return Err{std::move(res).unwrapErr()};
+                return toJson(res.unwrap());
+            });
+            callback(TaskController::accepted(id));
+            co_return;
+        }
+        auto res = co_await CONCURRENCY::Offload<Result<TopologyApplyResult>>(dispatcher_(), CONCURRENCY::Lane::Blocking, run);
+        if (res.isErr()) {
+            callback(error(drogon::k400BadRequest, res.unwrapErr()));
+            co_return;
+        }
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(toJson(res.unwrap()));
+        if (!res.unwrap().ok()) resp->setStatusCode(drogon::k207MultiStatus);
+        callback(resp);
+    }
+
+    drogon::Task<> teardown(drogon::HttpRequestPtr, Callback callback, std::string lab) {
+        if (!topologies()) {
+            callback(error(drogon::k503ServiceUnavailable, "topology service not configured"));
+            co_return;
+        }
+        auto applier = topologies();
+        auto res = co_await CONCURRENCY::Offload<Result<std::size_t>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+            [applier, lab]() { return applier->teardown(lab); });
+        if (res.isErr()) {
+            callback(error(drogon::k400BadRequest, res.unwrapErr()));
+            co_return;
+        }
+        Json::Value v;
+        v["lab"] = lab;
+        v["removedNetworks"] = Json::UInt64(res.unwrap());
+        if (auto store = designs()) {
+            // the networks are gone already; a design left behind only costs a key range
+            v["removedDesign"] = co_await CONCURRENCY::Offload<bool>(dispatcher_(), CONCURRENCY::Lane::Blocking, [store, lab]() {
+                auto erased = store->erase(lab);
+                return erased.isOk() && erased.unwrap();
+            });
+        }
+        callback(drogon::HttpResponse::newHttpJsonResponse(v));
+    }
+
+    drogon::Task<> get(drogon::HttpRequestPtr, Callback callback, std::string lab) {
+        if (!designs()) {
+            callback(error(drogon::k503ServiceUnavailable, "topology store not configured"));
+            co_return;
+        }
+        auto store = designs();
+        auto stored = co_await CONCURRENCY::Offload<std::optional<std::pair<std::uint64_t, LabTopology>>>(
+            dispatcher_(), CONCURRENCY::Lane::Blocking, [store, lab]() -> std::optional<std::pair<std::uint64_t, LabTopology>> {
+                auto version = store->version(lab);
+                auto topology = store->topology(lab);
+                if (!version || !topology) return std::nullopt;
+                return std::pair{*version, std::move(*topology)};
+            });
+        if (!stored) {
+            callback(error(drogon::k404NotFound, "no topology stored for lab " + lab));
+            co_return;
+        }
+        const auto& [version, topology] = *stored;
+        Json::Value v;
+        v["lab"] = lab;
+        v["version"] = Json::UInt64(version);
+        v["devices"] = Json::Value(Json::arrayValue);
+        for (const auto& d : topology.devices) {
+            Json::Value device;
+            device["id"] = d.id;
+            device["type"] = d.type;
+            device["domain"] = d.domain;
+            device["netProfile"] = d.netProfile;
+            v["devices"].append(device);
+        }
+        v["cables"] = Json::Value(Json::arrayValue);
+        for (const auto& l : topology.links) {
+            Json::Value cable;
+            cable["id"] = l.id;
+            cable["from"] = l.from;
+            cable["to"] = l.to;
+            v["cables"].append(cable);
+        }
+        callback(drogon::HttpResponse::newHttpJsonResponse(v));
+    }
+
+    drogon::Task<> replace(drogon::HttpRequestPtr req, Callback callback, std::string lab) {
+        if (!designs()) {
+            callback(error(drogon::k503ServiceUnavailable, "topology store not configured"));
+            co_return;
+        }
+        auto json = req->getJsonObject();
+        if (!json || !(*json)["devices"].isArray()) {
+            callback(error(drogon::k400BadRequest, "devices and cables are required"));
+            co_return;
+        }
+        auto store = designs();
+        auto res = co_await CONCURRENCY::Offload<Result<TopologyRevision>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+            [store, design = toTopology(lab, *json)]() { return store->replace(design); });
+        if (res.isErr()) {
+            callback(error(drogon::k400BadRequest, res.unwrapErr()));
+            co_return;
+        }
+        callback(drogon::HttpResponse::newHttpJsonResponse(toJson(lab, res.unwrap())));
+    }
+
+    drogon::Task<> update(drogon::HttpRequestPtr req, Callback callback, std::string lab) {
+        if (!designs()) {
+            callback(error(drogon::k503ServiceUnavailable, "topology store not configured"));
+            co_return;
+        }
+        auto json = req->getJsonObject();
+        if (!json || !(*json)["ops"].isArray() || !(*json)["baseVersion"].isUInt64()) {
+            callback(error(drogon::k400BadRequest, "baseVersion and ops are required"));
+            co_return;
+        }
+        const auto& ops = (*json)["ops"];
+        if (ops.size() > kMaxOps) {
+            callback(error(drogon::k413RequestEntityTooLarge, "at most " + std::to_string(kMaxOps) + " ops per update, PUT the design instead"));
+            co_return;
+        }
+        std::vector<TopologyDelta> deltas;
+        deltas.reserve(ops.size());
+        for (Json::ArrayIndex i = 0; i < ops.size(); ++i) {
+            auto delta = toDelta(ops[i]);
+            if (!delta) {
+                callback(error(drogon::k400BadRequest, "op " + std::to_string(i) + ": unknown op " + ops[i]["op"].asString()));
+                co_return;
+            }
+            deltas.push_back(std::move(*delta));
+        }
+        auto store = designs();
+        const auto baseVersion = (*json)["baseVersion"].asUInt64();
+        auto res = co_await CONCURRENCY::Offload<Result<TopologyRevision, TopologyDeltaError>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+            [store, lab, baseVersion, deltas = std::move(deltas)]() { return store->update(lab, baseVersion, deltas); });
+        if (res.isErr()) {
+            const auto& e = res.unwrapErr();
+            Json::Value v;
+            v["error"] = e.message;
+            // the client reloads from GET or uploads its whole design
+            if (e.conflict) v["version"] = Json::UInt64(e.version);
+            auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+            resp->setStatusCode(e.conflict ? drogon::k409Conflict : drogon::k400BadRequest);
+            callback(resp);
+            co_return;
+        }
+        callback(drogon::HttpResponse::newHttpJsonResponse(toJson(lab, res.unwrap())));
+    }
+
+private:
+    static std::shared_ptr<TopologyApplier>& topologies() {
+        static std::shared_ptr<TopologyApplier> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<CONCURRENCY::EventDispatcher>& dispatcher_() {
+        static std::shared_ptr<CONCURRENCY::EventDispatcher> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<AsyncTaskManager>& tasks() {
+        static std::shared_ptr<AsyncTaskManager> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<TopologyStore>& designs() {
+        static std::shared_ptr<TopologyStore> instance;
+        return instance;
+    }
+
+    // a larger edit is a redraw: the client uploads the whole design
+    static constexpr Json::ArrayIndex kMaxOps = 4096;
+
+    static std::optional<TopologyDelta> toDelta(const Json::Value& json) {
+        using Op = TopologyDelta::Op;
+        static const std::map<std::string, Op, std::less<>> ops{
+            {"addDevice", Op::AddDevice}, {"updateDevice", Op::UpdateDevice}, {"removeDevice", Op::RemoveDevice},
+            {"addCable", Op::AddLink}, {"removeCable", Op::RemoveLink}};
+        auto it = ops.find(json["op"].asString());
+        if (it == ops.end()) return std::nullopt;
+        TopologyDelta d;
+        d.op = it->second;
+        d.id = json["id"].asString();
+        auto field = [&](const char* name) -> std::optional<std::string> {
+            if (!json.isMember(name)) return std::nullopt;
+            return json[name].asString();
+        };
+        d.type = field("type");
+        d.domain = field("domain");
+        d.netProfile = field("netProfile");
+        if (d.op == Op::AddDevice && !d.type) d.type = "pc";
+        d.from = json["from"].asString();
+        d.to = json["to"].asString();
+        return d;
+    }
+
+    static Json::Value toJson(const std::string& lab, const TopologyRevision& revision) {
+        Json::Value v;
+        v["lab"] = lab;
+        v["version"] = Json::UInt64(revision.version);
+        v["devices"] = Json::UInt64(revision.devices);
+        v["cables"] = Json::UInt64(revision.links);
+        v["removedCables"] = Json::UInt64(revision.removedLinks);
+        return v;
+    }
+
+    static LabTopology toTopology(const std::string& lab, const Json::Value& json) {
+        LabTopology t;
+        t.lab = lab;
+        for (const auto& d : json["devices"]) {
+            t.devices.push_back({d["id"].asString(), d.get("type", "pc").asString(), d.get("domain", "").asString(),
+                                 d.get("netProfile", "").asString()});
+        }
+        for (const auto& c : json["cables"]) {
+            t.links.push_back({c.get("id", "").asString(), c["from"].asString(), c["to"].asString()});
+        }
+        return t;
+    }
+
+    static Json::Value toJson(const TopologyPlan& plan) {
+        Json::Value v;
+        v["createNetworks"] = Json::Value(Json::arrayValue);
+        for (const auto& n : plan.createNetworks) v["createNetworks"].append(n);
+        v["removeNetworks"] = Json::Value(Json::arrayValue);
+        for (const auto& n : plan.removeNetworks) v["removeNetworks"].append(n);
+        v["changes"] = Json::Value(Json::arrayValue);
+        for (const auto& c : plan.changes) {
+            Json::Value change;
+            change["op"] = c.kind == NicChange::Kind::Attach ? "attach" : "detach";
+            change["domain"] = c.domain;
+            change["network"] = c.network;
+            change["mac"] = c.mac;
+            if (!c.error.empty()) change["error"] = c.error;
+            v["changes"].append(change);
+        }
+        return v;
+    }
+
+    static Json::Value toJson(const TopologyApplyResult& result) {
+        Json::Value v = toJson(result.plan);
+        v["applied"] = Json::UInt64(result.applied);
+        v["failed"] = Json::UInt64(result.failed);
+        v["errors"] = Json::Value(Json::arrayValue);
+        for (const auto& e : result.errors) v["errors"].append(e);
+        return v;
+    }
+
+    static drogon::HttpResponsePtr error(drogon::HttpStatusCode code, const std::string& message) {
+        Json::Value v;
+        v["error"] = message;
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+        resp->setStatusCode(code);
+        return resp;
+    }
+};
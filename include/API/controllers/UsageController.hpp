@@ -0,0 +1,124 @@
+#pragma once
+#include "API/common.hpp"
+#include "Core/concurrency/Offload.hpp"
+#include "Virtualization/vmm/UsageCollector.hpp"
+#include <charconv>
+#include <memory>
+
+/**
+ * @brief Resource usage history per VM
+ *
+ *   GET /api/v1/vms/{name}/usage   ?from=&to= (unix seconds; default the last hour)
+ *   GET /api/v1/usage/top          ?by=cpu|memory|disk|network&limit=N (default cpu, 20)
+ *
+ * cpu is in busy vCPUs, rates in bytes per second. Points older than the
+ * collector's ring come from the RocksDB rollups, so a history read runs on
+ * the dispatcher's blocking lane; top only reads the last pass.
+ */
+class UsageController : public drogon::HttpController<UsageController> {
+public:
+    using Callback = std::function<void(const drogon::HttpResponsePtr&)>;
+
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(UsageController::history, "/api/v1/vms/{1}/usage", {drogon::Get});
+    ADD_METHOD_TO(UsageController::top, "/api/v1/usage/top", {drogon::Get});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<UsageCollector> collector, std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher) {
+        usage() = std::move(collector);
+        dispatcher_() = std::move(dispatcher);
+    }
+
+    drogon::Task<> history(drogon::HttpRequestPtr req, Callback callback, std::string name) {
+        if (!usage()) {
+            callback(error(drogon::k503ServiceUnavailable, "usage collector not configured"));
+            co_return;
+        }
+        using namespace std::chrono;
+        const auto now = system_clock::now();
+        const auto from = timeParam(req->getParameter("from")).value_or(now - hours(1));
+        const auto to = timeParam(req->getParameter("to")).value_or(now);
+        if (to < from) {
+            callback(error(drogon::k400BadRequest, "to is before from"));
+            co_return;
+        }
+        auto collector = usage();
+        auto points = co_await CONCURRENCY::Offload<std::vector<UsagePoint>>(dispatcher_(), CONCURRENCY::Lane::Blocking,
+            [collector, name, from, to]() { return collector->history(name, from, to); });
+
+        Json::Value body;
+        body["name"] = name;
+        body["points"] = Json::Value(Json::arrayValue);
+        for (const auto& p : points) body["points"].append(toJson(p));
+        callback(drogon::HttpResponse::newHttpJsonResponse(body));
+    }
+
+    void top(const drogon::HttpRequestPtr& req, Callback&& callback) {
+        if (!usage()) {
+            callback(error(drogon::k503ServiceUnavailable, "usage collector not configured"));
+            return;
+        }
+        const std::string& by = req->getParameter("by");
+        UsageMetric metric = UsageMetric::Cpu;
+        if (by == "memory") metric = UsageMetric::Memory;
+        else if (by == "disk") metric = UsageMetric::Disk;
+        else if (by == "network") metric = UsageMetric::Network;
+        else if (!by.empty() && by != "cpu") {
+            callback(error(drogon::k400BadRequest, "by must be cpu, memory, disk or network"));
+            return;
+        }
+        std::size_t limit = 20;
+        const std::string& param = req->getParameter("limit");
+        if (!param.empty()) std::from_chars(param.data(), param.data() + param.size(), limit);
+
+        Json::Value body(Json::arrayValue);
+        for (const auto& u : usage()->top(metric, std::min<std::size_t>(limit, 1000))) {
+            Json::Value v = toJson(u.point);
+            v["name"] = u.domain;
+            body.append(v);
+        }
+        callback(drogon::HttpResponse::newHttpJsonResponse(body));
+    }
+
+private:
+    static std::shared_ptr<UsageCollector>& usage() {
+        static std::shared_ptr<UsageCollector> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<CONCURRENCY::EventDispatcher>& dispatcher_() {
+        static std::shared_ptr<CONCURRENCY::EventDispatcher> instance;
+        return instance;
+    }
+
+    static std::optional<std::chrono::system_clock::time_point> timeParam(const std::string& param) {
+        std::int64_t seconds = 0;
+        auto [ptr, ec] = std::from_chars(param.data(), param.data() + param.size(), seconds);
+        if (param.empty() || ec != std::errc{} || ptr != param.data() + param.size()) return std::nullopt;
+        return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+    }
+
+    static Json::Value toJson(const UsagePoint& p) {
+        Json::Value v;
+        v["at"] = Json::Int64(std::chrono::duration_cast<std::chrono::seconds>(p.at.time_since_epoch()).count());
+        v["spanMs"] = Json::Int64(p.span.count());
+        v["cpu"] = p.cpu;
+        v["vcpus"] = p.vcpus;
+        v["memoryKiB"] = Json::UInt64(p.memoryKiB);
+        v["memoryPeakKiB"] = Json::UInt64(p.memoryPeakKiB);
+        v["diskReadBps"] = p.diskReadBps;
+        v["diskWriteBps"] = p.diskWriteBps;
+        v["netRxBps"] = p.netRxBps;
+        v["netTxBps"] = p.netTxBps;
+        return v;
+    }
+
+    static drogon::HttpResponsePtr error(drogon::HttpStatusCode code, const std::string& message) {
+        Json::Value v;
+        v["error"] = message;
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+        resp->setStatusCode(code);
+        return resp;
+    }
+};
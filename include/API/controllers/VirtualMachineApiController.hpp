@@ -0,0 +1,263 @@
+#pragma once
+#include "API/common.hpp"
+#include "API/controllers/TaskController.hpp"
+#include "API/services/AsyncTaskManager.hpp"
+#include "Virtualization/vmm/VirtualMachineManager.hpp"
+#include "Core/serialization/Writers.hpp"
+#include <memory>
+
+/**
+ * @brief VM CRUD over the manager's co_* awaitables
+ *
+ *   GET    /api/v1/vms               summaries (?inactive=0 for running domains only)
+ *   GET    /api/v1/vms/{name}        one domain, state from the event-fed cache
+ *   POST   /api/v1/vms               {"name","memoryKiB","vcpus","disks":[...],"networks":[...]}
+ *   DELETE /api/v1/vms/{name}        ?deleteStorage=1 also removes the volumes
+ *   POST   /api/v1/vms/{name}/activity  user activity outside the console (the SSH bastion
+ *                                     reports open sessions here); keeps the VM from idle suspend
+ *
+ * Every libvirt call is awaited on the dispatcher; the handler resumes on its
+ * own IO loop, so no drogon thread ever blocks on libvirt. With a task
+ * manager configured, POST and DELETE answer 202 + task id instead of
+ * holding the connection until the deploy/delete finishes.
+ * Behind deploy admission a POST is refused up front with 429 (the lab's
+ * queue or memory budget is full) or 503 (the host's), plus Retry-After.
+ * Parameters are taken by value: they must survive the suspension.
+ */
+class VirtualMachineApiController : public drogon::HttpController<VirtualMachineApiController> {
+public:
+    using Callback = std::function<void(const drogon::HttpResponsePtr&)>;
+
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(VirtualMachineApiController::list, "/api/v1/vms", {drogon::Get});
+    ADD_METHOD_TO(VirtualMachineApiController::get, "/api/v1/vms/{1}", {drogon::Get});
+    ADD_METHOD_TO(VirtualMachineApiController::create, "/api/v1/vms", {drogon::Post});
+    ADD_METHOD_TO(VirtualMachineApiController::remove, "/api/v1/vms/{1}", {drogon::Delete});
+    ADD_METHOD_TO(VirtualMachineApiController::activity, "/api/v1/vms/{1}/activity", {drogon::Post});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<VirtualMachineManager> manager,
+                          std::shared_ptr<AsyncTaskManager> taskManager = nullptr) {
+        vms() = std::move(manager);
+        tasks() = std::move(taskManager);
+    }
+
+    drogon::Task<> list(drogon::HttpRequestPtr req, Callback callback) {
+        if (!ready(callback)) co_return;
+        const bool includeInactive = req->getParameter("inactive") != "0";
+        auto res = co_await vms()->co_list(includeInactive);
+        if (res.isErr()) {
+            callback(error(drogon::k500InternalServerError, res.unwrapErr()));
+            co_return;
+        }
+        // the dashboard polls this for every domain: written straight into the body, no Json::Value tree
+        const auto& summaries = res.unwrap();
+        std::string body;
+        body.reserve(summaries.size() * 160 + 2);
+        SERIALIZATION::JsonWriter json(body);
+        json.beginArray();
+        for (const auto& d : summaries) writeSummary(json, d);
+        json.endArray();
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+        resp->setBody(std::move(body));
+        callback(resp);
+    }
+
+    drogon::Task<> get(drogon::HttpRequestPtr, Callback callback, std::string name) {
+        if (!ready(callback)) co_return;
+        auto res = co_await vms()->co_find(name);
+        if (res.isErr()) {
+            callback(error(drogon::k404NotFound, res.unwrapErr()));
+            co_return;
+        }
+        Json::Value body;
+        body["name"] = res.unwrap()->getName();
+        auto state = vms()->getState(name); // in-memory, no libvirt call
+        body["state"] = state.isOk() ? static_cast<int>(state.unwrap()) : static_cast<int>(VirtualMachine::VmState::Unknown);
+        callback(drogon::HttpResponse::newHttpJsonResponse(body));
+    }
+
+    drogon::Task<> create(drogon::HttpRequestPtr req, Callback callback) {
+        if (!ready(callback)) co_return;
+        auto json = req->getJsonObject();
+        if (!json || !(*json)["name"].isString() || !(*json)["memoryKiB"].isUInt64() || !(*json)["vcpus"].isUInt()) {
+            callback(error(drogon::k400BadRequest, "name, memoryKiB and vcpus are required"));
+            co_return;
+        }
+        auto cfg = toConfig(*json);
+        const std::string name = cfg.name;
+        // admission control answers before anything is queued: 429/503 with Retry-After
+        auto gate = vms()->getDeployAdmission();
+        std::shared_ptr<DeployAdmission::Ticket> ticket;
+        if (gate) {
+            auto admitted = gate->admit(cfg);
+            if (admitted.isErr()) {
+                callback(rejected(admitted.unwrapErr()));
+                co_return;
+            }
+            ticket = std::make_shared<DeployAdmission::Ticket>(std::move(admitted).unwrap());
+        }
+        if (tasks()) {
+            auto job = [manager = vms(), cfg = std::move(cfg)](const std::string&) -> Result<Json::Value> {
+                auto res = manager->dispatch_deploy(cfg);
+                if (res.isErr()) return Err{std::move(res).unwrapErr()};
+                Json::Value v;
+                v["name"] = cfg.name;
+                v["id"] = res.unwrap();
+                return v;
+            };
+            // the task stays pending while the deploy waits for its tenant's turn
+            const auto id = gate
+                ? tasks()->submitTracked("deploy", name, std::move(job),
+                                         [gate, ticket](std::function<void()> body) { gate->start(std::move(*ticket), std::move(body)); })
+                : tasks()->submitTracked("deploy", name, std::move(job));
+            callback(TaskController::accepted(id));
+            co_return;
+        }
+        if (gate) {
+            // queued work holds no thread: the worker that runs the deploy answers
+            gate->start(std::move(*ticket), [manager = vms(), cfg = std::move(cfg), callback] {
+                callback(created(cfg.name, manager->dispatch_deploy(cfg)));
+            });
+            co_return;
+        }
+        auto res = co_await vms()->co_deploy(std::move(cfg));
+        callback(created(name, res));
+    }
+
+    drogon::Task<> remove(drogon::HttpRequestPtr req, Callback callback, std::string name) {
+        if (!ready(callback)) co_return;
+        const bool deleteStorage = req->getParameter("deleteStorage") == "1";
+        if (tasks()) {
+            auto id = tasks()->submit("delete", name, [manager = vms(), name, deleteStorage]() -> Result<Json::Value> {
+                auto res = manager->deleteDomain(name, deleteStorage);
+                if (res.isErr()) return Err{std::move(res).unwrapErr()};
+                Json::Value v;
+                v["name"] = name;
+                return v;
+            });
+            callback(TaskController::accepted(id));
+            co_return;
+        }
+        auto res = co_await vms()->co_delete(std::move(name), deleteStorage);
+        if (res.isErr()) {
+            callback(error(drogon::k404NotFound, res.unwrapErr()));
+            co_return;
+        }
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k204NoContent);
+        callback(resp);
+    }
+
+    // in-memory only (no libvirt call), so it is answered on the IO loop
+    void activity(const drogon::HttpRequestPtr&, Callback&& callback, const std::string& name) {
+        if (!ready(callback)) return;
+        vms()->touch(name);
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k204NoContent);
+        callback(resp);
+    }
+
+    // POST /api/v1/vms body -> VmConfig; also used by the vm.deploy RPC method
+    static VmConfig toConfig(const Json::Value& json) {
+        VmConfig cfg{};
+        cfg.name = json["name"].asString();
+        cfg.osType = json.get("osType", "hvm").asString();
+        cfg.arch = json.get("arch", "x86_64").asString();
+        cfg.memory = static_cast<unsigned long>(json["memoryKiB"].asUInt64());
+        cfg.currentMemory = cfg.memory;
+        cfg.vcpus = json["vcpus"].asUInt();
+        cfg.maxVcpus = cfg.vcpus;
+        for (const auto& d : json["disks"]) {
+            DiskConfig disk{};
+            disk.type = d.get("type", "file").asString();
+            disk.device = d.get("device", "disk").asString();
+            disk.source = d["source"].asString();
+            disk.target = d.get("target", "vda").asString();
+            disk.driver = d.get("driver", "qcow2").asString();
+            disk.readOnly = d.get("readOnly", false).asBool();
+            disk.cache = d.get("cache", "").asString();
+            disk.io = d.get("io", "").asString();
+            disk.discard = d.get("discard", "").asString();
+            cfg.disks.push_back(std::move(disk));
+        }
+        for (const auto& n : json["networks"]) {
+            NetworkConfig nic{};
+            nic.type = n.get("type", "network").asString();
+            nic.source = n.get("source", "default").asString();
+            nic.model = n.get("model", "virtio").asString();
+            nic.macAddress = n.get("mac", "").asString();
+            nic.driverName = n.get("driver", "").asString();
+            nic.queues = n.get("queues", 0).asUInt();
+            nic.rxQueueSize = n.get("rxQueueSize", 0).asUInt();
+            nic.txQueueSize = n.get("txQueueSize", 0).asUInt();
+            nic.directMode = n.get("mode", "").asString();
+            cfg.networks.push_back(std::move(nic));
+        }
+        // "lab-throwaway" | "persistent"; unknown names fail the deploy
+        if (json["ioProfile"].isString()) cfg.metadata["ioProfile"] = json["ioProfile"].asString();
+        // "vhost" | "throughput"; NIC fields given explicitly take precedence
+        if (json["netProfile"].isString()) cfg.metadata["netProfile"] = json["netProfile"].asString();
+        return cfg;
+    }
+
+private:
+    static std::shared_ptr<VirtualMachineManager>& vms() {
+        static std::shared_ptr<VirtualMachineManager> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<AsyncTaskManager>& tasks() {
+        static std::shared_ptr<AsyncTaskManager> instance;
+        return instance;
+    }
+
+    static bool ready(const Callback& callback) {
+        if (vms()) return true;
+        callback(error(drogon::k503ServiceUnavailable, "virtual machine service not configured"));
+        return false;
+    }
+
+    static void writeSummary(SERIALIZATION::JsonWriter<>& json, const DomainSummary& d) {
+        json.beginObject()
+            .member("name", d.name)
+            .member("uuid", d.uuid)
+            .member("state", static_cast<int>(d.state))
+            .member("active", d.active)
+            .member("vcpus", d.vcpus)
+            .member("memoryKiB", d.memoryKiB)
+            .member("maxMemoryKiB", d.maxMemoryKiB)
+            .endObject();
+    }
+
+    static drogon::HttpResponsePtr error(drogon::HttpStatusCode code, const std::string& message) {
+        Json::Value v;
+        v["error"] = message;
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+        resp->setStatusCode(code);
+        return resp;
+    }
+
+    static drogon::HttpResponsePtr created(const std::string& name, const Result<int>& res) {
+        if (res.isErr()) return error(drogon::k500InternalServerError, res.unwrapErr());
+        Json::Value body;
+        body["name"] = name;
+        body["id"] = res.unwrap();
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(body);
+        resp->setStatusCode(drogon::k201Created);
+        return resp;
+    }
+
+    // 429 when the lab is over its share, 503 when the host is; both say when to come back
+    static drogon::HttpResponsePtr rejected(const AdmissionRejection& rejection) {
+        Json::Value v;
+        v["error"] = rejection.message;
+        v["retryAfter"] = Json::Int64(rejection.retryAfter.count());
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+        resp->setStatusCode(rejection.tenantBound() ? drogon::k429TooManyRequests : drogon::k503ServiceUnavailable);
+        resp->addHeader("Retry-After", std::to_string(rejection.retryAfter.count()));
+        return resp;
+    }
+};
@@ -1,7 +1,10 @@
 #pragma once 
 #include "API/common.hpp"
+#include "API/controllers/TaskController.hpp"
+#include "API/services/ImageImportService.hpp"
+#include <filesystem>
+#include <memory>
 using namespace drogon;
-class VirtualMachineuploadDiskController;
 class VirtualMachineController : public drogon::HttpController<VirtualMachineController> {
 public:
     METHOD_LIST_BEGIN
@@ -15,41 +18,63 @@ public:
     VirtualMachineController() = default;
     virtual ~VirtualMachineController() = default;
 
+    // optional: with an import service every upload is converted into a base image (202 + task id)
+    static void configure(std::shared_ptr<ImageImportService> service) { imports() = std::move(service); }
+
     // your declaration of processing function maybe like this:
     // void your_method_name(const HttpRequestPtr& req,
     //                      std::function<void(const HttpResponsePtr&)>&& callback,
     //                      std::string arg1,
     //                      int arg2);
 private:
+  static std::shared_ptr<ImageImportService>& imports() {
+      static std::shared_ptr<ImageImportService> instance;
+      return instance;
+  }
+
+  // small files only: drogon buffers the whole multipart body, disk images go through /api/v1/uploads
   drogon::Task<> 
     uploadFile(const drogon::HttpRequestPtr& req,std::function<void(const drogon::HttpResponsePtr&)>&& callback){
-        std::async_launch(std::launch::async, [](){
-            // Long-running operation here
-        });
-        auto files = req->getFiles();
-        if (files.empty()) {
+        drogon::MultiPartParser parser;
+        if (parser.parse(req) != 0 || parser.getFiles().empty()) {
             auto resp = drogon::HttpResponse::newHttpResponse();
             resp->setStatusCode(drogon::k400BadRequest);
             resp->setBody("No file uploaded");      
             callback(resp);
             co_return;
         }
-        const auto& file = files[0]; // Assuming single file upload
-        std::string uploadPath = "/var/lib/penhive/uploads/" + file.getFileName();
-        if (!file.moveTo(uploadPath)) {
+        const auto& file = parser.getFiles()[0]; // Assuming single file upload
+        const std::string fileName = std::filesystem::path(file.getFileName()).filename().string();
+        std::string uploadPath = "/var/lib/penhive/uploads/" + fileName;
+        if (fileName.empty() || file.saveAs(uploadPath) != 0) {
             auto resp = drogon::HttpResponse::newHttpResponse();
             resp->setStatusCode(drogon::k500InternalServerError);
             resp->setBody("Failed to save uploaded file");
             callback(resp); 
+            co_return;
+        }
+        if (auto service = imports()) {
+            auto task = service->submit(uploadPath);
+            if (task.isOk()) {
+                callback(TaskController::accepted(task.unwrap()));
+                co_return;
+            }
+            // the file is kept; it can be imported later
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setStatusCode(drogon::k503ServiceUnavailable);
+            resp->setBody(task.unwrapErr());
+            callback(resp);
+            co_return;
         }
+        Json::Value body;
+        body["fileName"] = fileName;
+        body["size"] = Json::UInt64(file.fileLength());
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(body);
+        resp->setStatusCode(drogon::k201Created);
+        callback(resp);
     }
 };
 class VMwareIntegration; // Forward declaration
-class VirtualMachineuploadDiskController {
-public:
-    
-
-};
 
 
 /*
@@ -1 +1,155 @@
-#pragma
\ No newline at end of file
+#pragma once
+#include "API/common.hpp"
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Virtualization/Storage/VolumeUploadManager.hpp"
+#include <charconv>
+#include <memory>
+
+/**
+ * @brief Resumable chunked disk image uploads (used by UploadManager.js)
+ *
+ *   POST   /api/v1/uploads          {"fileName","size"} -> 201 {"uploadId","chunkSize","offset"}
+ *   PUT    /api/v1/uploads/{id}     raw chunk, "Upload-Offset" header -> progress
+ *   GET    /api/v1/uploads/{id}     progress (the client resumes from "offset")
+ *   DELETE /api/v1/uploads/{id}     abort and drop the partial volume
+ *
+ * A PUT at the wrong offset gets 409 with the offset the server expects.
+ * libvirt calls run on the EventDispatcher, never on drogon's IO loop.
+ */
+class VirtualMachineuploadDiskController : public drogon::HttpController<VirtualMachineuploadDiskController> {
+public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(VirtualMachineuploadDiskController::begin, "/api/v1/uploads", {drogon::Post});
+    ADD_METHOD_TO(VirtualMachineuploadDiskController::putChunk, "/api/v1/uploads/{1}", {drogon::Put});
+    ADD_METHOD_TO(VirtualMachineuploadDiskController::status, "/api/v1/uploads/{1}", {drogon::Get});
+    ADD_METHOD_TO(VirtualMachineuploadDiskController::abort, "/api/v1/uploads/{1}", {drogon::Delete});
+    METHOD_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<VolumeUploadManager> manager,
+                          std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher) {
+        uploads() = std::move(manager);
+        executor() = std::move(dispatcher);
+    }
+
+    void begin(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
+        auto json = req->getJsonObject();
+        if (!ready(callback)) return;
+        if (!json || !(*json)["fileName"].isString() || !(*json)["size"].isUInt64()) {
+            callback(error(drogon::k400BadRequest, "fileName and size are required"));
+            return;
+        }
+        std::string fileName = (*json)["fileName"].asString();
+        const std::uint64_t size = (*json)["size"].asUInt64();
+        executor()->dispatch(CONCURRENCY::Lane::Blocking, [fileName = std::move(fileName), size, callback = std::move(callback)] {
+            uploads()->purgeIdle();
+            auto res = uploads()->begin(fileName, size);
+            if (res.isErr()) {
+                callback(error(drogon::k400BadRequest, res.unwrapErr()));
+                return;
+            }
+            auto resp = drogon::HttpResponse::newHttpJsonResponse(toJson(res.unwrap()));
+            resp->setStatusCode(drogon::k201Created);
+            callback(resp);
+        });
+    }
+
+    void putChunk(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback, std::string id) {
+        if (!ready(callback)) return;
+        std::uint64_t offset = 0;
+        const std::string& header = req->getHeader("Upload-Offset");
+        if (auto [p, ec] = std::from_chars(header.data(), header.data() + header.size(), offset);
+            header.empty() || ec != std::errc{} || p != header.data() + header.size()) {
+            callback(error(drogon::k400BadRequest, "Upload-Offset header is required"));
+            return;
+        }
+        if (req->body().size() > VolumeUploadManager::kMaxChunkBytes) {
+            callback(error(drogon::k413RequestEntityTooLarge, "chunk too large"));
+            return;
+        }
+        // req keeps the body alive; the chunk is streamed from it without a copy
+        executor()->dispatch(CONCURRENCY::Lane::Blocking, [req, id = std::move(id), offset, callback = std::move(callback)] {
+            auto res = uploads()->writeChunk(id, offset, req->body());
+            if (res.isOk()) {
+                callback(drogon::HttpResponse::newHttpJsonResponse(toJson(res.unwrap())));
+                return;
+            }
+            auto current = uploads()->status(id);
+            if (current.isErr()) {
+                callback(error(drogon::k404NotFound, current.unwrapErr()));
+                return;
+            }
+            auto progress = current.unwrap();
+            const bool conflict = progress.received != offset;
+            auto resp = drogon::HttpResponse::newHttpJsonResponse(toJson(progress, res.unwrapErr()));
+            resp->setStatusCode(conflict ? drogon::k409Conflict : drogon::k500InternalServerError);
+            callback(resp);
+        });
+    }
+
+    void status(const drogon::HttpRequestPtr&, std::function<void(const drogon::HttpResponsePtr&)>&& callback, std::string id) {
+        if (!ready(callback)) return;
+        auto res = uploads()->status(id); // in-memory, no libvirt call
+        if (res.isErr()) {
+            callback(error(drogon::k404NotFound, res.unwrapErr()));
+            return;
+        }
+        callback(drogon::HttpResponse::newHttpJsonResponse(toJson(res.unwrap())));
+    }
+
+    void abort(const drogon::HttpRequestPtr&, std::function<void(const drogon::HttpResponsePtr&)>&& callback, std::string id) {
+        if (!ready(callback)) return;
+        executor()->dispatch(CONCURRENCY::Lane::Blocking, [id = std::move(id), callback = std::move(callback)] {
+            auto res = uploads()->abort(id);
+            if (res.isErr()) {
+                callback(error(drogon::k404NotFound, res.unwrapErr()));
+                return;
+            }
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setStatusCode(drogon::k204NoContent);
+            callback(resp);
+        });
+    }
+
+private:
+    static std::shared_ptr<VolumeUploadManager>& uploads() {
+        static std::shared_ptr<VolumeUploadManager> instance;
+        return instance;
+    }
+
+    static std::shared_ptr<CONCURRENCY::EventDispatcher>& executor() {
+        static std::shared_ptr<CONCURRENCY::EventDispatcher> instance;
+        return instance;
+    }
+
+    static bool ready(const std::function<void(const drogon::HttpResponsePtr&)>& callback) {
+        if (uploads() && executor()) return true;
+        callback(error(drogon::k503ServiceUnavailable, "upload service not configured"));
+        return false;
+    }
+
+    static Json::Value toJson(const UploadProgress& p, const std::string& err = {}) {
+        Json::Value v;
+        v["uploadId"] = p.id;
+        v["fileName"] = p.fileName;
+        v["volume"] = p.volumeName;
+        v["format"] = p.format;
+        v["size"] = Json::UInt64(p.size);
+        v["offset"] = Json::UInt64(p.received);
+        v["progress"] = p.percent();
+        v["complete"] = p.complete;
+        if (!p.digest.empty()) v["digest"] = p.digest;
+        v["deduplicated"] = p.deduplicated;
+        v["chunkSize"] = Json::UInt64(VolumeUploadManager::kDefaultChunkBytes);
+        if (!err.empty()) v["error"] = err;
+        return v;
+    }
+
+    static drogon::HttpResponsePtr error(drogon::HttpStatusCode code, const std::string& message) {
+        Json::Value v;
+        v["error"] = message;
+        auto resp = drogon::HttpResponse::newHttpJsonResponse(v);
+        resp->setStatusCode(code);
+        return resp;
+    }
+};
@@ -0,0 +1,310 @@
+#pragma once
+#include <drogon/drogon.h>
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Core/concurrency/TimerWheel.hpp"
+#include "Core/tracing/Trace.hpp"
+#include "Utils/Logger.hpp"
+#include "Utils/Result.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class TaskStatus { Pending, Running, Completed, Failed };
+
+inline const char* toString(TaskStatus status) noexcept {
+    switch (status) {
+        case TaskStatus::Pending: return "pending";
+        case TaskStatus::Running: return "running";
+        case TaskStatus::Completed: return "completed";
+        case TaskStatus::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+struct AsyncTask {
+    std::string id;
+    std::string operation; // "deploy", "delete", "snapshot", ...
+    std::string target;    // VM / lab the task acts on
+    TaskStatus status{TaskStatus::Pending};
+    Json::Value result;
+    Json::Value progress; // last report() of a running job (null if it never reported)
+    std::string error;
+    std::string traceId;  // trace of the request that submitted it (empty when tracing is off)
+    std::chrono::system_clock::time_point createdAt;
+    std::chrono::system_clock::time_point updatedAt;
+
+    [[nodiscard]] bool finished() const noexcept { return status == TaskStatus::Completed || status == TaskStatus::Failed; }
+
+    [[nodiscard]] Json::Value toJson() const {
+        using namespace std::chrono;
+        Json::Value v;
+        v["taskId"] = id;
+        v["operation"] = operation;
+        v["target"] = target;
+        v["status"] = toString(status);
+        if (!progress.isNull()) v["progress"] = progress;
+        if (status == TaskStatus::Completed) v["result"] = result;
+        if (status == TaskStatus::Failed) v["error"] = error;
+        if (!traceId.empty()) v["traceId"] = traceId;
+        v["createdAt"] = Json::Int64(duration_cast<milliseconds>(createdAt.time_since_epoch()).count());
+        v["updatedAt"] = Json::Int64(duration_cast<milliseconds>(updatedAt.time_since_epoch()).count());
+        return v;
+    }
+};
+
+/**
+ * @brief Table of long-running operations answered with 202 + task id
+ *
+ * The job runs on the EventDispatcher; the HTTP request returns at once and
+ * the client polls /api/v1/tasks/{id} or listens on /ws/tasks. Tasks live
+ * in 16 shards keyed by id hash, each behind its own shared_mutex, so a
+ * transition only locks one shard and polling takes shared locks. Finished
+ * tasks are evicted `ttl` after their last update by a sweep on the timer
+ * wheel. Listeners see every transition (Pending -> Running -> Completed/Failed)
+ * on the thread that made it; they must not block.
+ * Queued jobs reference the manager, so it has to outlive the dispatcher's work.
+ */
+class AsyncTaskManager {
+public:
+    using Job = std::function<Result<Json::Value>()>;
+    // job that reports progress: it gets its own task id for report()
+    using TrackedJob = std::function<Result<Json::Value>(const std::string& taskId)>;
+    using Listener = std::function<void(const AsyncTask&)>;
+    // runs a task body (no arguments) now or later, on a thread of its choosing
+    using Launcher = std::function<void(std::function<void()>)>;
+
+    explicit AsyncTaskManager(std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                              std::chrono::seconds ttl = std::chrono::minutes(15))
+        : dispatcher_(std::move(dispatcher)), ttl_(ttl), rng_(std::random_device{}()) {}
+
+    ~AsyncTaskManager() {
+        if (wheel_ && sweepId_) wheel_->cancel(sweepId_);
+    }
+
+    AsyncTaskManager(const AsyncTaskManager&) = delete;
+    AsyncTaskManager& operator=(const AsyncTaskManager&) = delete;
+
+    // Registers the task and queues the job; returns the task id right away
+    std::string submit(std::string operation, std::string target, Job job,
+                       CONCURRENCY::Lane lane = CONCURRENCY::Lane::Blocking) {
+        return submitTracked(std::move(operation), std::move(target),
+                             [job = std::move(job)](const std::string&) { return job(); }, lane);
+    }
+
+    std::string submitTracked(std::string operation, std::string target, TrackedJob job,
+                              CONCURRENCY::Lane lane = CONCURRENCY::Lane::Blocking) {
+        return submitTracked(std::move(operation), std::move(target), std::move(job), *dispatcher_, lane);
+    }
+
+    // Same task table, but the job runs on `executor` (e.g. a small pool for long disk work that
+    // must not occupy the API dispatcher); the executor has to outlive the jobs it was given
+    std::string submitTracked(std::string operation, std::string target, TrackedJob job,
+                              CONCURRENCY::EventDispatcher& executor,
+                              CONCURRENCY::Lane lane = CONCURRENCY::Lane::Blocking) {
+        return submitTracked(std::move(operation), std::move(target), std::move(job),
+                             [&executor, lane](std::function<void()> body) { executor.dispatch(lane, std::move(body)); });
+    }
+
+    // Same task table, but `launch` decides when and where the job runs (deploy admission queues it
+    // per tenant): it is handed the task body once, and the task stays pending until the body runs
+    std::string submitTracked(std::string operation, std::string target, TrackedJob job, const Launcher& launch) {
+        AsyncTask task;
+        task.id = newId();
+        task.operation = std::move(operation);
+        task.target = std::move(target);
+        task.createdAt = task.updatedAt = std::chrono::system_clock::now();
+        if (const auto ctx = TRACING::TraceContext::current(); ctx.valid()) task.traceId = ctx.traceIdHex();
+        const std::string id = task.id;
+        std::string spanName = "task." + task.operation;
+        {
+            auto& shard = shardOf(id);
+            std::unique_lock lock(shard.mutex_);
+            shard.tasks.emplace(id, task);
+        }
+        notify(task);
+
+        // the dispatcher carries the request's trace over; the span and log fields tie the job to the task id
+        launch([this, id, spanName = std::move(spanName), job = std::move(job)] {
+            TRACING::Span span(spanName);
+            span.setAttribute("task.id", id);
+            LogScope scope(LogFields{.op_id = id});
+            transition(id, TaskStatus::Running, {}, {});
+            try {
+                auto res = job(id);
+                if (res.isOk()) transition(id, TaskStatus::Completed, std::move(res).unwrap(), {});
+                else transition(id, TaskStatus::Failed, {}, std::move(res).unwrapErr());
+            } catch (const std::exception& e) {
+                transition(id, TaskStatus::Failed, {}, e.what());
+            } catch (...) {
+                transition(id, TaskStatus::Failed, {}, "unknown error");
+            }
+        });
+        return id;
+    }
+
+    // Progress of a running task (e.g. bytes migrated); listeners see it like a transition
+    void report(const std::string& id, Json::Value progress) {
+        AsyncTask snapshot;
+        {
+            auto& shard = shardOf(id);
+            std::unique_lock lock(shard.mutex_);
+            auto it = shard.tasks.find(id);
+            if (it == shard.tasks.end() || it->second.finished()) return;
+            it->second.progress = std::move(progress);
+            it->second.updatedAt = std::chrono::system_clock::now();
+            snapshot = it->second;
+        }
+        notify(snapshot);
+    }
+
+    [[nodiscard]] std::optional<AsyncTask> get(const std::string& id) const {
+        const auto& shard = shardOf(id);
+        std::shared_lock lock(shard.mutex_);
+        auto it = shard.tasks.find(id);
+        if (it == shard.tasks.end()) return std::nullopt;
+        return it->second;
+    }
+
+    // Newest first, at most `limit` entries
+    [[nodiscard]] std::vector<AsyncTask> list(std::size_t limit = 100) const {
+        std::vector<AsyncTask> out;
+        for (const auto& shard : shards_) {
+            std::shared_lock lock(shard.mutex_);
+            for (const auto& [id, task] : shard.tasks) out.push_back(task);
+        }
+        std::sort(out.begin(), out.end(), [](const AsyncTask& a, const AsyncTask& b) { return a.createdAt > b.createdAt; });
+        if (out.size() > limit) out.resize(limit);
+        return out;
+    }
+
+    // Drops finished tasks older than the ttl; returns how many were removed
+    std::size_t sweep() {
+        const auto cutoff = std::chrono::system_clock::now() - ttl_;
+        std::size_t removed = 0;
+        for (auto& shard : shards_) {
+            std::unique_lock lock(shard.mutex_);
+            for (auto it = shard.tasks.begin(); it != shard.tasks.end();) {
+                if (it->second.finished() && it->second.updatedAt < cutoff) {
+                    it = shard.tasks.erase(it);
+                    ++removed;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return removed;
+    }
+
+    // Periodic sweep every ttl/4 on the shared wheel (the wheel must outlive this manager)
+    void scheduleEviction(CONCURRENCY::TimerWheel& wheel) {
+        if (wheel_ && sweepId_) wheel_->cancel(sweepId_);
+        wheel_ = &wheel;
+        const auto every = std::max<std::chrono::seconds>(ttl_ / 4, std::chrono::seconds(1));
+        sweepId_ = wheel.schedule_every(every, [this] { (void)sweep(); }, {every / 10});
+    }
+
+    std::uint64_t subscribe(Listener listener) {
+        std::lock_guard lock(listenersMutex_);
+        auto next = std::make_shared<std::vector<std::pair<std::uint64_t, Listener>>>(*listeners_);
+        const auto id = ++listenerSeq_;
+        next->emplace_back(id, std::move(listener));
+        listeners_ = std::move(next);
+        return id;
+    }
+
+    void unsubscribe(std::uint64_t id) {
+        std::lock_guard lock(listenersMutex_);
+        auto next = std::make_shared<std::vector<std::pair<std::uint64_t, Listener>>>(*listeners_);
+        std::erase_if(*next, [id](const auto& l) { return l.first == id; });
+        listeners_ = std::move(next);
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        std::size_t n = 0;
+        for (const auto& shard : shards_) {
+            std::shared_lock lock(shard.mutex_);
+            n += shard.tasks.size();
+        }
+        return n;
+    }
+
+private:
+    static constexpr std::size_t kShards = 16;
+
+    struct Shard {
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<std::string, AsyncTask> tasks;
+    };
+
+    Shard& shardOf(const std::string& id) { return shards_[std::hash<std::string>{}(id) % kShards]; }
+    const Shard& shardOf(const std::string& id) const { return shards_[std::hash<std::string>{}(id) % kShards]; }
+
+    std::string newId() {
+        std::uint64_t bits;
+        {
+            std::lock_guard lock(rngMutex_);
+            bits = rng_();
+        }
+        static constexpr char hex[] = "0123456789abcdef";
+        std::string id(16, '0');
+        for (auto& c : id) {
+            c = hex[bits & 0xF];
+            bits >>= 4;
+        }
+        return id;
+    }
+
+    void transition(const std::string& id, TaskStatus status, Json::Value result, std::string error) {
+        AsyncTask snapshot;
+        {
+            auto& shard = shardOf(id);
+            std::unique_lock lock(shard.mutex_);
+            auto it = shard.tasks.find(id);
+            if (it == shard.tasks.end()) return;
+            it->second.status = status;
+            it->second.updatedAt = std::chrono::system_clock::now();
+            if (status == TaskStatus::Completed) it->second.result = std::move(result);
+            if (status == TaskStatus::Failed) it->second.error = std::move(error);
+            snapshot = it->second;
+        }
+        notify(snapshot);
+    }
+
+    void notify(const AsyncTask& task) {
+        std::shared_ptr<const std::vector<std::pair<std::uint64_t, Listener>>> current;
+        {
+            std::lock_guard lock(listenersMutex_);
+            current = listeners_;
+        }
+        for (const auto& [id, listener] : *current) {
+            try { listener(task); } catch (...) {}
+        }
+    }
+
+    std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher_;
+    std::chrono::seconds ttl_;
+    std::array<Shard, kShards> shards_;
+
+    std::mutex rngMutex_;
+    std::mt19937_64 rng_;
+
+    // copy-on-write: notify() only copies a shared_ptr under the lock
+    std::mutex listenersMutex_;
+    std::shared_ptr<const std::vector<std::pair<std::uint64_t, Listener>>> listeners_ =
+        std::make_shared<std::vector<std::pair<std::uint64_t, Listener>>>();
+    std::uint64_t listenerSeq_{0};
+
+    CONCURRENCY::TimerWheel* wheel_{nullptr};
+    CONCURRENCY::TimerId sweepId_;
+};
@@ -0,0 +1,176 @@
+#pragma once
+#include <drogon/WebSocketController.h>
+#include <drogon/utils/coroutine.h>
+#include <trantor/net/EventLoop.h>
+#include <trantor/net/TcpClient.h>
+#include "Core/metrics/Metrics.hpp"
+#include "Utils/Logger.hpp"
+#include "Virtualization/vmm/VirtualMachineManager.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+
+/**
+ * @brief noVNC-compatible WebSocket-to-TCP bridge for VM consoles: /ws/console?vm=<name>
+ *
+ * Binary frames from the browser are written to the VM's VNC/SPICE port
+ * unchanged, and whatever the display server sends comes back as binary
+ * frames. The upstream socket is a trantor::TcpClient on the same IO loop
+ * as the WebSocket, so both directions run on one thread with no locks and
+ * no proxy threads; the port comes from VirtualMachinePool through
+ * VirtualMachineManager::consoleEndpoint(), which also wakes idle VMs;
+ * browser input keeps the VM marked active while the session lasts.
+ *
+ * Browser -> VM: the frame payload drogon already decoded is moved into the
+ * TCP send; it is copied only if the socket cannot take it right away.
+ * VM -> browser: the loop's input buffer is framed straight from peek() and
+ * drained, so the buffer is reused across reads instead of allocated per
+ * frame. Anything the browser types before the VM socket is up is held in a
+ * small bounded buffer.
+ */
+class ConsoleProxyService : public drogon::WebSocketController<ConsoleProxyService> {
+public:
+    WS_PATH_LIST_BEGIN
+    WS_PATH_ADD("/ws/console", drogon::Get);
+    WS_PATH_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<VirtualMachineManager> manager) { vms() = std::move(manager); }
+
+    void handleNewConnection(const drogon::HttpRequestPtr& req, const drogon::WebSocketConnectionPtr& conn) override {
+        const std::string vm = req->getParameter("vm");
+        if (!vms() || vm.empty()) {
+            conn->shutdown(drogon::CloseCode::kViolation, "vm parameter required");
+            return;
+        }
+        auto session = std::make_shared<Session>();
+        session->vm = vm;
+        conn->setContext(session);
+        // handlers of a connection run on its IO loop; the upstream client lives on the same one
+        trantor::EventLoop* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+        std::weak_ptr<drogon::WebSocketConnection> weak = conn;
+        drogon::async_run([loop, weak, session]() -> drogon::Task<> {
+            auto endpoint = co_await vms()->co_console(session->vm);
+            auto ws = weak.lock();
+            if (!ws || session->closed) co_return;
+            if (endpoint.isErr()) {
+                BoostLogger::Warn("Console proxy: " + endpoint.unwrapErr());
+                ws->shutdown(drogon::CloseCode::kUnexpectedCondition, "console unavailable");
+                co_return;
+            }
+            connectUpstream(loop, weak, session, endpoint.unwrap());
+        });
+    }
+
+    void handleNewMessage(const drogon::WebSocketConnectionPtr& conn, std::string&& message,
+                          const drogon::WebSocketMessageType& type) override {
+        // RFB/SPICE are binary; text frames are only sent by websockify's legacy base64 mode
+        if (type != drogon::WebSocketMessageType::Binary) return;
+        auto session = conn->getContext<Session>();
+        if (!session || session->closed) return;
+        // someone is typing or moving the mouse: the VM is in use even if the guest looks idle
+        const auto now = std::chrono::steady_clock::now();
+        if (now - session->touchedAt >= kTouchInterval) {
+            session->touchedAt = now;
+            vms()->touch(session->vm);
+        }
+        if (session->upstream && session->upstream->connected()) {
+            session->upstream->send(std::move(message));
+            return;
+        }
+        if (session->early.size() + message.size() > kEarlyLimit) {
+            conn->shutdown(drogon::CloseCode::kMessageTooBig, "console not connected");
+            return;
+        }
+        session->early += message;
+    }
+
+    void handleConnectionClosed(const drogon::WebSocketConnectionPtr& conn) override {
+        auto session = conn->getContext<Session>();
+        if (!session) return;
+        session->closed = true;
+        if (session->upstream) session->upstream->forceClose();
+        session->upstream.reset();
+        session->client.reset();
+    }
+
+private:
+    // RFB asks the server to speak first, so a client rarely sends anything before upstream is up
+    static constexpr std::size_t kEarlyLimit = 64 * 1024;
+    // input queued for a display server that stopped reading; past this the session is dropped
+    static constexpr std::size_t kHighWaterMark = 8 * 1024 * 1024;
+    // input marks the VM active at most this often (one IdleSuspender lookup, not one per frame)
+    static constexpr std::chrono::seconds kTouchInterval{10};
+
+    // touched only on the connection's IO loop
+    struct Session {
+        std::string vm;
+        std::shared_ptr<trantor::TcpClient> client;
+        trantor::TcpConnectionPtr upstream;
+        std::string early;
+        std::chrono::steady_clock::time_point touchedAt{};
+        bool closed{false};
+    };
+
+    static std::shared_ptr<VirtualMachineManager>& vms() {
+        static std::shared_ptr<VirtualMachineManager> instance;
+        return instance;
+    }
+
+    static METRICS::Gauge& activeSessions() {
+        static auto& gauge = METRICS::MetricsRegistry::global().gauge("penhive_console_sessions", "Open console proxy sessions");
+        return gauge;
+    }
+
+    static void connectUpstream(trantor::EventLoop* loop, std::weak_ptr<drogon::WebSocketConnection> weak,
+                                const std::shared_ptr<Session>& session, const ConsoleEndpoint& endpoint) {
+        auto client = std::make_shared<trantor::TcpClient>(loop, trantor::InetAddress(endpoint.host, endpoint.port),
+                                                           "console-" + session->vm);
+        std::weak_ptr<Session> weakSession = session;
+
+        client->setConnectionCallback([weak, weakSession](const trantor::TcpConnectionPtr& tcp) {
+            auto session = weakSession.lock();
+            auto ws = weak.lock();
+            if (tcp->connected()) {
+                activeSessions().add(1);
+                if (!session || session->closed || !ws) {
+                    tcp->forceClose();
+                    return;
+                }
+                tcp->setTcpNoDelay(true);
+                tcp->setHighWaterMarkCallback([weak](const trantor::TcpConnectionPtr& full, std::size_t) {
+                    full->forceClose();
+                    if (auto ws = weak.lock()) ws->shutdown(drogon::CloseCode::kUnexpectedCondition, "console backlog");
+                }, kHighWaterMark);
+                session->upstream = tcp;
+                if (!session->early.empty()) {
+                    tcp->send(std::move(session->early));
+                    session->early.clear();
+                }
+                return;
+            }
+            activeSessions().add(-1);
+            if (ws && session && !session->closed) ws->shutdown(drogon::CloseCode::kNormalClosure, "console closed");
+        });
+
+        client->setConnectionErrorCallback([weak, weakSession] {
+            auto ws = weak.lock();
+            auto session = weakSession.lock();
+            if (session) BoostLogger::Warn("Console proxy: cannot reach display of " + session->vm);
+            if (ws) ws->shutdown(drogon::CloseCode::kUnexpectedCondition, "console unreachable");
+        });
+
+        client->setMessageCallback([weak](const trantor::TcpConnectionPtr& tcp, trantor::MsgBuffer* buffer) {
+            auto ws = weak.lock();
+            if (!ws || !ws->connected()) {
+                tcp->forceClose();
+                return;
+            }
+            ws->send(buffer->peek(), buffer->readableBytes(), drogon::WebSocketMessageType::Binary);
+            buffer->retrieveAll();
+        });
+
+        session->client = client;
+        client->connect();
+    }
+};
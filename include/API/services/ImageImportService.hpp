@@ -0,0 +1,125 @@
+#pragma once
+#include "API/services/AsyncTaskManager.hpp"
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Virtualization/Storage/ImageImporter.hpp"
+#include "Virtualization/Storage/VirtualMachineStorageManager.hpp"
+#include "Utils/Logger.hpp"
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+
+/**
+ * @brief Import stage after an upload lands: every file becomes an "import" task
+ *
+ * Conversions run on a dispatcher of their own with `workers` threads, so at
+ * most that many qemu-img processes exist at once and a burst of imports
+ * never takes the API dispatcher's Blocking lane away from libvirt calls.
+ * Each conversion is itself parallel (ImportOptions::coroutines), so a small
+ * worker count still keeps the disks busy. At most `maxQueued` imports wait;
+ * past that submit() refuses instead of building an unbounded backlog.
+ * When the output directory is the base pool, the pool is refreshed after
+ * each import so the image is usable for linked clones right away, and with
+ * an ImageObjectStore on the orchestrator the import is committed to it by
+ * digest: a second import of the same bytes is dropped for the existing
+ * object, as VolumeUploadManager does for streamed uploads.
+ */
+class ImageImportService {
+public:
+    ImageImportService(std::shared_ptr<AsyncTaskManager> tasks, ImageImporter importer,
+                       std::filesystem::path outputDir, std::shared_ptr<StorageOrchestrator> storage = nullptr,
+                       std::size_t workers = 2, std::size_t maxQueued = 32)
+        : tasks_(std::move(tasks)), state_(std::make_shared<State>(std::move(importer), std::move(outputDir), std::move(storage))),
+          maxQueued_(maxQueued), pool_(std::make_unique<CONCURRENCY::EventDispatcher>(workers == 0 ? 1 : workers)) {}
+
+    ~ImageImportService() { pool_->stop(); }
+
+    ImageImportService(const ImageImportService&) = delete;
+    ImageImportService& operator=(const ImageImportService&) = delete;
+
+    // Task id of the import, or an error when too many are already waiting
+    [[nodiscard]] Result<std::string> submit(std::filesystem::path source) {
+        if (state_->outstanding.fetch_add(1, std::memory_order_acq_rel) >= maxQueued_) {
+            state_->outstanding.fetch_sub(1, std::memory_order_acq_rel);
+            return Err{std::string("import queue is full")};
+        }
+        const std::string target = source.filename().string();
+        return Result<std::string>{tasks_->submitTracked("import", target,
+            [state = state_, tasks = tasks_, source = std::move(source)](const std::string& taskId) -> Result<Json::Value> {
+                struct Done {
+                    std::atomic<std::size_t>& n;
+                    ~Done() { n.fetch_sub(1, std::memory_order_acq_rel); }
+                } done{state->outstanding};
+                // qemu-img prints a line per percent or less; the task table only needs whole steps
+                int lastReported = -1;
+                auto res = state->importer.import(source, state->outputDir, [&](double percent) {
+                    const int whole = static_cast<int>(percent);
+                    if (whole == lastReported) return;
+                    lastReported = whole;
+                    Json::Value p;
+                    p["percent"] = whole;
+                    tasks->report(taskId, std::move(p));
+                });
+                if (res.isErr()) return Err{std::move(res).unwrapErr()};
+                const auto& imported = res.unwrap();
+                std::optional<ImageCommit> committed;
+                if (state->storage) {
+                    // the pool has to know the new file before it can be committed or dropped
+                    (void)state->storage->listBaseVolumes();
+                    // as for a streamed upload, the image stays usable when the index cannot be updated
+                    auto c = commit(*state->storage, imported);
+                    if (c.isErr()) BoostLogger::Warn("Import " + imported.output.filename().string() + " not deduplicated: " + c.unwrapErr());
+                    else committed = std::move(c).unwrap();
+                }
+                Json::Value v;
+                v["sourceFormat"] = toString(imported.sourceFormat);
+                v["output"] = imported.output.string();
+                v["format"] = imported.outputFormat;
+                v["converted"] = imported.converted;
+                v["sourceBytes"] = Json::UInt64(imported.sourceBytes);
+                v["allocatedBytes"] = Json::UInt64(imported.allocatedBytes);
+                if (!imported.digest.empty()) v["digest"] = imported.digest;
+                if (committed) {
+                    v["volume"] = committed->object.volumeName;
+                    v["deduplicated"] = committed->duplicate;
+                }
+                return v;
+            },
+            *pool_)};
+    }
+
+    [[nodiscard]] std::size_t outstanding() const noexcept { return state_->outstanding.load(std::memory_order_acquire); }
+
+private:
+    // the import under its file stem, like a streamed upload of the same name; an optional
+    // commit when the orchestrator has no object store (the pool refresh is all it gets then)
+    static Result<std::optional<ImageCommit>> commit(StorageOrchestrator& storage, const ImportResult& imported) {
+        if (!storage.objectStore()) return Result<std::optional<ImageCommit>>{std::optional<ImageCommit>{}};
+        if (imported.digest.empty()) return Err{"cannot hash " + imported.output.string()};
+        ImageObject candidate;
+        candidate.digest = imported.digest;
+        candidate.volumeName = imported.output.filename().string();
+        candidate.format = imported.outputFormat;
+        std::error_code ec;
+        candidate.sizeBytes = std::filesystem::file_size(imported.output, ec);
+        auto res = storage.commitBaseVolume(imported.output.stem().string(), candidate);
+        if (res.isErr()) return Err{std::move(res).unwrapErr()};
+        return Result<std::optional<ImageCommit>>{std::optional<ImageCommit>{std::move(res).unwrap()}};
+    }
+
+    // shared with queued jobs, which may still run while the service is being torn down
+    struct State {
+        State(ImageImporter i, std::filesystem::path dir, std::shared_ptr<StorageOrchestrator> s)
+            : importer(std::move(i)), outputDir(std::move(dir)), storage(std::move(s)) {}
+        ImageImporter importer;
+        std::filesystem::path outputDir;
+        std::shared_ptr<StorageOrchestrator> storage;
+        std::atomic<std::size_t> outstanding{0};
+    };
+
+    std::shared_ptr<AsyncTaskManager> tasks_;
+    std::shared_ptr<State> state_;
+    std::size_t maxQueued_;
+    std::unique_ptr<CONCURRENCY::EventDispatcher> pool_; // last: stopped before the rest goes away
+};
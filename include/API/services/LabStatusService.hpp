@@ -0,0 +1,318 @@
+#pragma once
+#include <drogon/WebSocketController.h>
+#include "API/services/AsyncTaskManager.hpp"
+#include "Core/serialization/Writers.hpp"
+#include "Virtualization/vmm/DomainStateCache.hpp"
+#include "Virtualization/vmm/SnapshotEngine.hpp"
+#include "Virtualization/vmm/VirtualMachineManager.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Live VM and task status per lab over /ws/labs
+ *
+ * Client messages:
+ *   {"subscribe":"<lab>"}       that lab (may be repeated)
+ *   {"subscribe":"*"}           every lab
+ *   {"unsubscribe":"<lab>"}
+ * Subscribing sends {"type":"snapshot","lab":...,"vms":[...],"ready":[...]}
+ * from the state cache and the readiness prober. After that, changes are
+ * coalesced for one tick (last state per VM, per task and per readiness
+ * status wins) and each lab gets a single
+ *   {"type":"delta","lab":...,"seq":N,"vms":[...],"tasks":[...],"ready":[...]}
+ * serialized once and handed to every subscriber of that lab, no matter
+ * how many browsers are watching. "ready" entries say whether a VM can be
+ * used yet ("probing", "ready", "failed"), so clients wait for the push
+ * instead of polling the VM. Nothing here touches libvirt.
+ */
+class LabStatusService : public drogon::WebSocketController<LabStatusService> {
+public:
+    WS_PATH_LIST_BEGIN
+    WS_PATH_ADD("/ws/labs", drogon::Get);
+    WS_PATH_LIST_END
+
+    // must be called before drogon::app().run(); the manager's timer wheel drives the ticks
+    static void configure(std::shared_ptr<VirtualMachineManager> manager, std::shared_ptr<AsyncTaskManager> tasks,
+                          std::shared_ptr<SnapshotEngine> snapshots,
+                          std::chrono::milliseconds tick = std::chrono::milliseconds(250)) {
+        auto& state = hub();
+        stop();
+        std::lock_guard lock(state.sourcesMutex);
+        state.manager = std::move(manager);
+        state.tasks = std::move(tasks);
+        state.snapshots = std::move(snapshots);
+        if (!state.manager || !state.snapshots) return;
+
+        state.states = state.manager->getStateCache();
+        if (state.states) state.stateListener = state.states->subscribe([](const DomainStateEvent& ev) { onState(ev); });
+        if (state.tasks) state.taskListener = state.tasks->subscribe([](const AsyncTask& task) { onTask(task); });
+        state.readiness = state.manager->getReadinessProber();
+        if (state.readiness) {
+            state.readinessListener = state.readiness->subscribe([](const ReadinessStatus& status) { onReady(status); });
+        }
+
+        auto flag = std::make_shared<std::atomic<bool>>(false);
+        state.cancelFlag = flag;
+        CONCURRENCY::WheelJobOptions opts;
+        opts.lane = CONCURRENCY::Lane::Cpu;
+        opts.cancelFlag = std::move(flag);
+        (void)state.manager->getTimerWheel().schedule_every(tick, [] { flush(); }, std::move(opts));
+    }
+
+    static void stop() {
+        auto& state = hub();
+        std::lock_guard lock(state.sourcesMutex);
+        if (state.cancelFlag) state.cancelFlag->store(true);
+        state.cancelFlag.reset();
+        if (state.states && state.stateListener) state.states->unsubscribe(state.stateListener);
+        if (state.tasks && state.taskListener) state.tasks->unsubscribe(state.taskListener);
+        if (state.readiness && state.readinessListener) state.readiness->unsubscribe(state.readinessListener);
+        state.stateListener = state.taskListener = state.readinessListener = 0;
+        state.states.reset();
+        state.readiness.reset();
+    }
+
+    void handleNewConnection(const drogon::HttpRequestPtr&, const drogon::WebSocketConnectionPtr& conn) override {
+        conn->setContext(std::make_shared<Subscription>());
+        std::lock_guard lock(hub().mutex_);
+        hub().connections.insert(conn);
+    }
+
+    void handleNewMessage(const drogon::WebSocketConnectionPtr& conn, std::string&& message,
+                          const drogon::WebSocketMessageType& type) override {
+        if (type != drogon::WebSocketMessageType::Text) return;
+        Json::Value msg;
+        Json::Reader reader;
+        if (!reader.parse(message, msg) || !msg.isObject()) return;
+        auto sub = conn->getContext<Subscription>();
+        if (!sub) return;
+
+        if (msg["subscribe"].isString()) {
+            const std::string lab = msg["subscribe"].asString();
+            {
+                std::lock_guard lock(sub->mutex_);
+                if (lab == "*") sub->all = true;
+                else sub->labs.insert(lab);
+            }
+            if (lab != "*") conn->send(snapshot(lab));
+        } else if (msg["unsubscribe"].isString()) {
+            const std::string lab = msg["unsubscribe"].asString();
+            std::lock_guard lock(sub->mutex_);
+            if (lab == "*") sub->all = false;
+            else sub->labs.erase(lab);
+        }
+    }
+
+    void handleConnectionClosed(const drogon::WebSocketConnectionPtr& conn) override {
+        std::lock_guard lock(hub().mutex_);
+        hub().connections.erase(conn);
+    }
+
+private:
+    struct Subscription {
+        std::mutex mutex_;
+        bool all{false};
+        std::unordered_set<std::string> labs;
+    };
+
+    // آخر حالة معروفة لكل VM خلال الـ tick؛ lab محفوظ لحظة الحدث لأن الحذف يزيل العضوية
+    struct PendingVm {
+        std::string lab;
+        DomainStateEntry entry;
+        bool removed{false};
+    };
+
+    struct Hub {
+        std::mutex mutex_; // connections
+        std::unordered_set<drogon::WebSocketConnectionPtr> connections;
+
+        std::mutex sourcesMutex; // configure()/stop()
+        std::shared_ptr<VirtualMachineManager> manager;
+        std::shared_ptr<AsyncTaskManager> tasks;
+        std::shared_ptr<SnapshotEngine> snapshots;
+        std::shared_ptr<DomainStateCache> states;
+        std::shared_ptr<ReadinessProber> readiness;
+        std::uint64_t stateListener{0};
+        std::uint64_t taskListener{0};
+        std::uint64_t readinessListener{0};
+        std::shared_ptr<std::atomic<bool>> cancelFlag;
+
+        std::mutex pendingMutex;
+        std::unordered_map<std::string, PendingVm> pendingVms; // domain -> latest
+        std::unordered_map<std::string, AsyncTask> pendingTasks; // taskId -> latest
+        std::unordered_map<std::string, ReadinessStatus> pendingReady; // domain -> latest, group = lab
+        std::uint64_t seq{0};
+    };
+
+    static Hub& hub() {
+        static Hub instance;
+        return instance;
+    }
+
+    static std::string_view stateName(VirtualMachine::VmState state) noexcept {
+        switch (state) {
+            case VirtualMachine::VmState::Running: return "running";
+            case VirtualMachine::VmState::Paused: return "paused";
+            case VirtualMachine::VmState::Shutdown: return "shutdown";
+            case VirtualMachine::VmState::Crashed: return "crashed";
+            case VirtualMachine::VmState::Suspended: return "suspended";
+            case VirtualMachine::VmState::Unknown: break;
+        }
+        return "unknown";
+    }
+
+    static void writeVm(SERIALIZATION::JsonWriter<>& json, const DomainStateEntry& entry, bool removed) {
+        json.beginObject()
+            .member("name", entry.name)
+            .member("uuid", entry.uuid)
+            .member("state", removed ? std::string_view("removed") : stateName(entry.state))
+            .member("reason", entry.reason)
+            .endObject();
+    }
+
+    static std::string_view readinessName(ReadinessState state) noexcept {
+        switch (state) {
+            case ReadinessState::Probing: return "probing";
+            case ReadinessState::Ready: return "ready";
+            case ReadinessState::Failed: return "failed";
+        }
+        return "probing";
+    }
+
+    static void writeReady(SERIALIZATION::JsonWriter<>& json, const ReadinessStatus& status) {
+        json.beginObject()
+            .member("name", status.domain)
+            .member("state", readinessName(status.state))
+            .member("address", status.address)
+            .member("detail", status.detail)
+            .member("attempts", status.attempts)
+            .member("elapsedMs", static_cast<std::int64_t>(status.elapsed.count()))
+            .endObject();
+    }
+
+    // runs on the libvirt event thread: record and return, the tick does the rest
+    static void onState(const DomainStateEvent& ev) {
+        auto snapshots = hub().snapshots;
+        if (!snapshots) return;
+        auto lab = snapshots->labOf(ev.entry.name);
+        std::lock_guard lock(hub().pendingMutex);
+        auto& pending = hub().pendingVms[ev.entry.name];
+        // a Removed event can arrive after the lab dropped the member; keep the lab seen earlier in the tick
+        if (lab) pending.lab = std::move(*lab);
+        pending.entry = ev.entry;
+        pending.removed = ev.kind == DomainStateEvent::Kind::Removed;
+        if (pending.lab.empty()) hub().pendingVms.erase(ev.entry.name);
+    }
+
+    static void onTask(const AsyncTask& task) {
+        std::lock_guard lock(hub().pendingMutex);
+        hub().pendingTasks.insert_or_assign(task.id, task);
+    }
+
+    // runs on a prober round: the group the manager watched with is the lab
+    static void onReady(const ReadinessStatus& status) {
+        ReadinessStatus pending = status;
+        if (pending.group.empty()) {
+            auto snapshots = hub().snapshots;
+            auto lab = snapshots ? snapshots->labOf(status.domain) : std::nullopt;
+            if (!lab) return;
+            pending.group = std::move(*lab);
+        }
+        std::lock_guard lock(hub().pendingMutex);
+        hub().pendingReady.insert_or_assign(status.domain, std::move(pending));
+    }
+
+    static std::string snapshot(const std::string& lab) {
+        std::string body;
+        SERIALIZATION::JsonWriter json(body);
+        json.beginObject().member("type", "snapshot").member("lab", lab).key("vms").beginArray();
+        auto snapshots = hub().snapshots;
+        auto states = hub().states;
+        const auto members = snapshots ? snapshots->members(lab) : std::vector<std::string>{};
+        if (states) {
+            for (const auto& name : members) {
+                if (auto entry = states->get(name)) writeVm(json, *entry, false);
+            }
+        }
+        json.endArray().key("ready").beginArray();
+        if (auto readiness = hub().readiness) {
+            for (const auto& name : members) {
+                if (auto status = readiness->status(name)) writeReady(json, *status);
+            }
+        }
+        json.endArray().endObject();
+        return body;
+    }
+
+    // one payload per lab per tick; every subscriber of the lab gets the same string
+    static void flush() {
+        std::unordered_map<std::string, PendingVm> vms;
+        std::unordered_map<std::string, AsyncTask> tasks;
+        std::unordered_map<std::string, ReadinessStatus> ready;
+        std::uint64_t seq = 0;
+        {
+            std::lock_guard lock(hub().pendingMutex);
+            if (hub().pendingVms.empty() && hub().pendingTasks.empty() && hub().pendingReady.empty()) return;
+            vms.swap(hub().pendingVms);
+            tasks.swap(hub().pendingTasks);
+            ready.swap(hub().pendingReady);
+            seq = ++hub().seq;
+        }
+
+        struct LabDelta {
+            std::vector<const PendingVm*> vms;
+            std::vector<const AsyncTask*> tasks;
+            std::vector<const ReadinessStatus*> ready;
+        };
+        std::unordered_map<std::string, LabDelta> byLab;
+        for (const auto& [_, vm] : vms) byLab[vm.lab].vms.push_back(&vm);
+        for (const auto& [_, status] : ready) byLab[status.group].ready.push_back(&status);
+        if (auto snapshots = hub().snapshots) {
+            for (const auto& [_, task] : tasks) {
+                // the target is a member VM or the lab itself
+                if (auto lab = snapshots->labOf(task.target)) byLab[*lab].tasks.push_back(&task);
+                else if (!snapshots->members(task.target).empty()) byLab[task.target].tasks.push_back(&task);
+            }
+        }
+        if (byLab.empty()) return;
+
+        std::vector<std::pair<drogon::WebSocketConnectionPtr, std::shared_ptr<Subscription>>> targets;
+        {
+            std::lock_guard lock(hub().mutex_);
+            targets.reserve(hub().connections.size());
+            for (const auto& conn : hub().connections) {
+                if (auto sub = conn->getContext<Subscription>()) targets.emplace_back(conn, std::move(sub));
+            }
+        }
+        if (targets.empty()) return;
+
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        for (const auto& [lab, delta] : byLab) {
+            std::string payload;
+            SERIALIZATION::JsonWriter json(payload);
+            json.beginObject().member("type", "delta").member("lab", lab).member("seq", seq).key("vms").beginArray();
+            for (const auto* vm : delta.vms) writeVm(json, vm->entry, vm->removed);
+            json.endArray().key("tasks").beginArray();
+            for (const auto* task : delta.tasks) json.raw(Json::writeString(writer, task->toJson()));
+            json.endArray().key("ready").beginArray();
+            for (const auto* status : delta.ready) writeReady(json, *status);
+            json.endArray().endObject();
+
+            for (const auto& [conn, sub] : targets) {
+                bool wanted = false;
+                {
+                    std::lock_guard subLock(sub->mutex_);
+                    wanted = sub->all || sub->labs.contains(lab);
+                }
+                if (wanted && conn->connected()) conn->send(payload);
+            }
+        }
+    }
+};
@@ -0,0 +1,220 @@
+#pragma once
+#include <json/json.h>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief MessagePack <-> Json::Value for the API bodies that offer both encodings
+ *
+ * Covers everything a Json::Value can hold: nil, bool, int/uint up to 64
+ * bits, float32/float64, str, array and map (string keys). bin is decoded
+ * as a string; ext types and non-string map keys are rejected. Integers are
+ * written in the shortest form, so small ids and counters cost one byte.
+ */
+namespace MSGPACK {
+
+namespace detail {
+
+inline void putBE(std::string& out, std::uint64_t v, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) out.push_back(static_cast<char>((v >> shift) & 0xFF));
+}
+
+inline void putLength(std::string& out, std::size_t n, std::uint8_t fix, std::size_t fixMax,
+                      std::uint8_t b8, std::uint8_t b16, std::uint8_t b32) {
+    if (n <= fixMax) {
+        out.push_back(static_cast<char>(fix | n));
+    } else if (b8 && n <= 0xFF) {
+        out.push_back(static_cast<char>(b8));
+        putBE(out, n, 1);
+    } else if (n <= 0xFFFF) {
+        out.push_back(static_cast<char>(b16));
+        putBE(out, n, 2);
+    } else {
+        out.push_back(static_cast<char>(b32));
+        putBE(out, n, 4);
+    }
+}
+
+inline void putString(std::string& out, std::string_view s) {
+    putLength(out, s.size(), 0xA0, 31, 0xD9, 0xDA, 0xDB);
+    out.append(s);
+}
+
+inline void putUnsigned(std::string& out, std::uint64_t v) {
+    if (v < 0x80) out.push_back(static_cast<char>(v));
+    else if (v <= 0xFF) { out.push_back('\xCC'); putBE(out, v, 1); }
+    else if (v <= 0xFFFF) { out.push_back('\xCD'); putBE(out, v, 2); }
+    else if (v <= 0xFFFFFFFFULL) { out.push_back('\xCE'); putBE(out, v, 4); }
+    else { out.push_back('\xCF'); putBE(out, v, 8); }
+}
+
+inline void putSigned(std::string& out, std::int64_t v) {
+    if (v >= 0) return putUnsigned(out, static_cast<std::uint64_t>(v));
+    const auto bits = static_cast<std::uint64_t>(v);
+    if (v >= -32) out.push_back(static_cast<char>(v));
+    else if (v >= INT8_MIN) { out.push_back('\xD0'); putBE(out, bits, 1); }
+    else if (v >= INT16_MIN) { out.push_back('\xD1'); putBE(out, bits, 2); }
+    else if (v >= INT32_MIN) { out.push_back('\xD2'); putBE(out, bits, 4); }
+    else { out.push_back('\xD3'); putBE(out, bits, 8); }
+}
+
+inline void encode(std::string& out, const Json::Value& v) {
+    switch (v.type()) {
+        case Json::nullValue: out.push_back('\xC0'); break;
+        case Json::booleanValue: out.push_back(v.asBool() ? '\xC3' : '\xC2'); break;
+        case Json::intValue: putSigned(out, v.asInt64()); break;
+        case Json::uintValue: putUnsigned(out, v.asUInt64()); break;
+        case Json::realValue:
+            out.push_back('\xCB');
+            putBE(out, std::bit_cast<std::uint64_t>(v.asDouble()), 8);
+            break;
+        case Json::stringValue: {
+            const char* begin = nullptr;
+            const char* end = nullptr;
+            v.getString(&begin, &end);
+            putString(out, std::string_view(begin, static_cast<std::size_t>(end - begin)));
+            break;
+        }
+        case Json::arrayValue:
+            putLength(out, v.size(), 0x90, 15, 0, 0xDC, 0xDD);
+            for (const auto& item : v) encode(out, item);
+            break;
+        case Json::objectValue:
+            putLength(out, v.size(), 0x80, 15, 0, 0xDE, 0xDF);
+            for (auto it = v.begin(); it != v.end(); ++it) {
+                putString(out, it.name());
+                encode(out, *it);
+            }
+            break;
+    }
+}
+
+class Decoder {
+public:
+    explicit Decoder(std::string_view in) : in_(in) {}
+
+    bool value(Json::Value& out, int depth = 0) {
+        if (depth > kMaxDepth) return false;
+        std::uint8_t tag = 0;
+        if (!byte(tag)) return false;
+        if (tag <= 0x7F) { out = Json::Int64(tag); return true; }
+        if (tag >= 0xE0) { out = Json::Int64(static_cast<std::int8_t>(tag)); return true; }
+        if ((tag & 0xE0) == 0xA0) return string(tag & 0x1F, out);
+        if ((tag & 0xF0) == 0x90) return array(tag & 0x0F, out, depth);
+        if ((tag & 0xF0) == 0x80) return map(tag & 0x0F, out, depth);
+        std::uint64_t n = 0;
+        switch (tag) {
+            case 0xC0: out = Json::Value(Json::nullValue); return true;
+            case 0xC2: out = false; return true;
+            case 0xC3: out = true; return true;
+            case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+                if (!be(n, 1 << (tag - 0xCC))) return false;
+                // like Json::Reader: signed unless it only fits unsigned
+                if (n <= static_cast<std::uint64_t>(INT64_MAX)) out = Json::Int64(n);
+                else out = Json::UInt64(n);
+                return true;
+            case 0xD0: case 0xD1: case 0xD2: case 0xD3: {
+                const int bytes = 1 << (tag - 0xD0);
+                if (!be(n, bytes)) return false;
+                // sign-extend from the encoded width
+                const int unused = 64 - bytes * 8;
+                out = Json::Int64(static_cast<std::int64_t>(n << unused) >> unused);
+                return true;
+            }
+            case 0xCA:
+                if (!be(n, 4)) return false;
+                out = static_cast<double>(std::bit_cast<float>(static_cast<std::uint32_t>(n)));
+                return true;
+            case 0xCB:
+                if (!be(n, 8)) return false;
+                out = std::bit_cast<double>(n);
+                return true;
+            case 0xD9: case 0xC4: return be(n, 1) && string(n, out);
+            case 0xDA: case 0xC5: return be(n, 2) && string(n, out);
+            case 0xDB: case 0xC6: return be(n, 4) && string(n, out);
+            case 0xDC: return be(n, 2) && array(n, out, depth);
+            case 0xDD: return be(n, 4) && array(n, out, depth);
+            case 0xDE: return be(n, 2) && map(n, out, depth);
+            case 0xDF: return be(n, 4) && map(n, out, depth);
+            default: return false; // ext and the reserved 0xC1
+        }
+    }
+
+    [[nodiscard]] bool done() const noexcept { return pos_ == in_.size(); }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    bool byte(std::uint8_t& b) {
+        if (pos_ >= in_.size()) return false;
+        b = static_cast<std::uint8_t>(in_[pos_++]);
+        return true;
+    }
+
+    bool be(std::uint64_t& v, int bytes) {
+        if (in_.size() - pos_ < static_cast<std::size_t>(bytes)) return false;
+        v = 0;
+        for (int i = 0; i < bytes; ++i) v = (v << 8) | static_cast<std::uint8_t>(in_[pos_++]);
+        return true;
+    }
+
+    bool string(std::uint64_t n, Json::Value& out) {
+        if (in_.size() - pos_ < n) return false;
+        out = Json::Value(in_.data() + pos_, in_.data() + pos_ + n);
+        pos_ += n;
+        return true;
+    }
+
+    bool array(std::uint64_t n, Json::Value& out, int depth) {
+        // every element takes at least one byte: a huge count in a short body is garbage
+        if (n > in_.size() - pos_) return false;
+        out = Json::Value(Json::arrayValue);
+        for (std::uint64_t i = 0; i < n; ++i) {
+            if (!value(out.append(Json::Value()), depth + 1)) return false;
+        }
+        return true;
+    }
+
+    bool map(std::uint64_t n, Json::Value& out, int depth) {
+        if (n > (in_.size() - pos_) / 2) return false;
+        out = Json::Value(Json::objectValue);
+        for (std::uint64_t i = 0; i < n; ++i) {
+            Json::Value key;
+            if (!value(key, depth + 1) || !key.isString()) return false;
+            if (!value(out[key.asString()], depth + 1)) return false;
+        }
+        return true;
+    }
+
+    std::string_view in_;
+    std::size_t pos_{0};
+};
+
+} // namespace detail
+
+[[nodiscard]] inline std::string encode(const Json::Value& v) {
+    std::string out;
+    detail::encode(out, v);
+    return out;
+}
+
+// nullopt on malformed input or trailing bytes
+[[nodiscard]] inline std::optional<Json::Value> decode(std::string_view bytes) {
+    Json::Value out;
+    detail::Decoder decoder(bytes);
+    if (!decoder.value(out) || !decoder.done()) return std::nullopt;
+    return out;
+}
+
+// Content-Type / Accept check shared by the endpoints that speak both
+[[nodiscard]] inline bool isMsgPack(std::string_view mediaType) noexcept {
+    return mediaType.find("application/msgpack") != std::string_view::npos
+        || mediaType.find("application/x-msgpack") != std::string_view::npos
+        || mediaType.find("application/vnd.msgpack") != std::string_view::npos;
+}
+
+} // namespace MSGPACK
@@ -0,0 +1,86 @@
+#pragma once
+#include <drogon/drogon.h>
+#include "Core/tracing/Trace.hpp"
+#include "Utils/Logger.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Ships finished spans to an OpenTelemetry collector (OTLP/HTTP, JSON encoding)
+ *
+ *   TRACING::Tracer::global().setExporter(std::make_shared<OtlpTraceExporter>("http://otel:4318"));
+ *   TRACING::Tracer::global().start(wheel);
+ *
+ * Optional: without an exporter tracing is off. Each batch becomes one
+ * POST /v1/traces, sent asynchronously by drogon's HttpClient; a collector
+ * that is down costs a warning, never the caller.
+ */
+class OtlpTraceExporter : public TRACING::SpanExporter {
+public:
+    explicit OtlpTraceExporter(const std::string& endpoint, std::string serviceName = "penhive")
+        : client(drogon::HttpClient::newHttpClient(endpoint)), service(std::move(serviceName)) {}
+
+    void exportSpans(std::vector<TRACING::SpanRecord>&& spans) override {
+        if (spans.empty()) return;
+        auto req = drogon::HttpRequest::newHttpRequest();
+        req->setMethod(drogon::Post);
+        req->setPath("/v1/traces");
+        req->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+        req->setBody(encode(spans));
+        client->sendRequest(req, [](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
+            if (result != drogon::ReqResult::Ok) {
+                BoostLogger::Warn("OTLP export failed: ReqResult " + std::to_string(static_cast<int>(result)));
+            } else if (resp && resp->statusCode() >= 300) {
+                BoostLogger::Warn("OTLP export rejected: HTTP " + std::to_string(static_cast<int>(resp->statusCode())));
+            }
+        });
+    }
+
+private:
+    static Json::Value attribute(const std::string& key, const std::string& value) {
+        Json::Value a;
+        a["key"] = key;
+        a["value"]["stringValue"] = value;
+        return a;
+    }
+
+    static std::string unixNanos(std::chrono::system_clock::time_point t) {
+        return std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count());
+    }
+
+    // OTLP ExportTraceServiceRequest; ids are hex strings in the JSON encoding
+    std::string encode(const std::vector<TRACING::SpanRecord>& spans) const {
+        Json::Value list(Json::arrayValue);
+        for (const auto& s : spans) {
+            Json::Value span;
+            span["traceId"] = s.context.traceIdHex();
+            span["spanId"] = s.context.spanIdHex();
+            if (s.parentSpanId != 0) span["parentSpanId"] = TRACING::TraceContext{0, 0, s.parentSpanId}.spanIdHex();
+            span["name"] = s.name;
+            // SpanKind: 1 internal, 2 server, 3 client
+            span["kind"] = s.kind == TRACING::SpanKind::Server ? 2 : s.kind == TRACING::SpanKind::Client ? 3 : 1;
+            span["startTimeUnixNano"] = unixNanos(s.start);
+            span["endTimeUnixNano"] = unixNanos(s.start + std::chrono::duration_cast<std::chrono::system_clock::duration>(s.duration));
+            span["attributes"] = Json::Value(Json::arrayValue);
+            for (const auto& [k, v] : s.attributes) span["attributes"].append(attribute(k, v));
+            if (s.errorCode != 0) {
+                span["attributes"].append(attribute("error.code", std::to_string(s.errorCode)));
+                span["status"]["code"] = 2; // STATUS_CODE_ERROR
+                span["status"]["message"] = s.error;
+            }
+            list.append(std::move(span));
+        }
+        Json::Value body;
+        Json::Value& resource = body["resourceSpans"][0];
+        resource["resource"]["attributes"].append(attribute("service.name", service));
+        resource["scopeSpans"][0]["scope"]["name"] = "penhive";
+        resource["scopeSpans"][0]["spans"] = std::move(list);
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        return Json::writeString(writer, body);
+    }
+
+    drogon::HttpClientPtr client;
+    std::string service;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <drogon/drogon.h>
+#include "Core/tracing/Trace.hpp"
+#include <chrono>
+#include <string>
+
+/**
+ * @brief One server span per API request, continuing the caller's W3C traceparent
+ *
+ * The pre-handling advice makes the request's context current on the
+ * handler's thread, so everything the handler dispatches (deploys, async
+ * tasks, their libvirt calls) lands in the same trace. The response
+ * carries the context back in a traceparent header, and async tasks
+ * report it as "traceId". No-op while the Tracer has no exporter.
+ *
+ * Call before drogon::app().run().
+ */
+inline void installRequestTracing() {
+    using Clock = std::chrono::steady_clock;
+
+    drogon::app().registerPreHandlingAdvice([](const drogon::HttpRequestPtr& req) {
+        // a worker thread keeps its thread-local context between requests; never inherit one
+        if (!TRACING::Tracer::global().enabled()) {
+            (void)TRACING::exchangeCurrent({});
+            return;
+        }
+        const auto parent = TRACING::TraceContext::fromTraceparent(req->getHeader("traceparent"));
+        const TRACING::TraceContext ctx = parent
+            ? TRACING::TraceContext{parent->traceHi, parent->traceLo, TRACING::newSpanId()}
+            : TRACING::TraceContext::root();
+        auto attrs = req->attributes();
+        attrs->insert("trace.ctx", ctx);
+        attrs->insert("trace.parent", parent ? parent->spanId : std::uint64_t{0});
+        attrs->insert("trace.start", Clock::now());
+        attrs->insert("trace.wall", std::chrono::system_clock::now());
+        (void)TRACING::exchangeCurrent(ctx);
+    });
+
+    drogon::app().registerPostHandlingAdvice([](const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp) {
+        // clear first and unconditionally: a coroutine handler may answer on another
+        // thread than the one the pre-handling advice ran on, and an early return
+        // must not leave this request's span current for the next one
+        (void)TRACING::exchangeCurrent({});
+        auto attrs = req->attributes();
+        if (!attrs->find("trace.ctx")) return;
+        const auto ctx = attrs->get<TRACING::TraceContext>("trace.ctx");
+        resp->addHeader("traceparent", ctx.traceparent());
+
+        TRACING::SpanRecord span;
+        span.name = "HTTP " + std::string(req->getMethodString());
+        span.kind = TRACING::SpanKind::Server;
+        span.context = ctx;
+        span.parentSpanId = attrs->get<std::uint64_t>("trace.parent");
+        span.start = attrs->get<std::chrono::system_clock::time_point>("trace.wall");
+        span.duration = Clock::now() - attrs->get<Clock::time_point>("trace.start");
+        span.attributes.emplace_back("http.target", req->path());
+        span.attributes.emplace_back("http.status_code", std::to_string(static_cast<int>(resp->statusCode())));
+        if (resp->statusCode() >= 500) span.errorCode = static_cast<int>(resp->statusCode());
+        TRACING::Tracer::global().record(std::move(span));
+    });
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include <json/json.h>
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct RpcOp {
+    std::string id;
+    std::string method;
+    Json::Value params;
+    std::vector<std::string> after; // ids that must succeed first
+};
+
+struct RpcOutcome {
+    enum class Status { Ok, Failed, Skipped };
+    Status status{Status::Skipped};
+    Json::Value result;
+    std::string error;
+};
+
+/**
+ * @brief Method table and executor for batched RPC (POST /api/v1/rpc)
+ *
+ * A batch is a list of operations with optional "after" dependencies.
+ * Operations are run in waves: everything whose dependencies succeeded runs
+ * in parallel (up to `width` threads), and an operation whose dependency
+ * failed is skipped, not attempted.
+ *
+ * Folded methods (lab.createDevice, lab.connectCable) describe parts of one
+ * larger request: all ops of a fold with the same key parameter become one
+ * unit of work that sees them together, e.g. a single topology diff per lab
+ * instead of one libvirt round trip per cable. Each op of the unit gets the
+ * unit's outcome, and `after` on any of them waits for the whole unit.
+ */
+class RpcRegistry {
+public:
+    using Handler = std::function<Result<Json::Value>(const Json::Value& params)>;
+    using GroupHandler = std::function<Result<Json::Value>(const std::string& key, const std::vector<const RpcOp*>& ops)>;
+
+    static constexpr std::size_t kMaxOps = 1000;
+
+    void add(std::string method, Handler handler) { methods.insert_or_assign(std::move(method), std::move(handler)); }
+
+    // ops of any of `foldedMethods` sharing params[keyParam] are handed to `handler` as one unit
+    void fold(std::vector<std::string> foldedMethods, std::string keyParam, GroupHandler handler) {
+        const std::size_t index = groups.size();
+        groups.push_back({std::move(keyParam), std::move(handler)});
+        for (auto& m : foldedMethods) folded.insert_or_assign(std::move(m), index);
+    }
+
+    [[nodiscard]] bool knows(std::string_view method) const {
+        return methods.contains(std::string(method)) || folded.contains(std::string(method));
+    }
+
+    /**
+     * @brief Run a whole batch; outcomes are in the order of `ops`
+     * @return Error for a malformed batch (duplicate or unknown ids, a
+     *         dependency cycle, an unknown method); nothing has run then
+     */
+    [[nodiscard]] Result<std::vector<RpcOutcome>> run(const std::vector<RpcOp>& ops, std::size_t width) const {
+        using R = Result<std::vector<RpcOutcome>>;
+        if (ops.size() > kMaxOps) return R{"Batch larger than " + std::to_string(kMaxOps) + " operations"};
+
+        std::unordered_map<std::string, std::size_t> byId;
+        for (std::size_t i = 0; i < ops.size(); ++i) {
+            if (!knows(ops[i].method)) return R{"Unknown method: " + ops[i].method};
+            if (!byId.emplace(ops[i].id, i).second) return R{"Duplicate operation id: " + ops[i].id};
+        }
+
+        // one unit per plain op, one per (fold, key) for folded ops
+        std::vector<Unit> units;
+        std::vector<std::size_t> unitOf(ops.size());
+        std::map<std::pair<std::size_t, std::string>, std::size_t> foldUnits;
+        for (std::size_t i = 0; i < ops.size(); ++i) {
+            auto f = folded.find(ops[i].method);
+            if (f == folded.end()) {
+                unitOf[i] = units.size();
+                units.push_back({{i}, std::nullopt, {}});
+                continue;
+            }
+            const auto& key = ops[i].params[groups[f->second].keyParam];
+            if (!key.isString() || key.asString().empty()) {
+                return R{ops[i].method + " needs a \"" + groups[f->second].keyParam + "\" parameter"};
+            }
+            auto [it, inserted] = foldUnits.try_emplace({f->second, key.asString()}, units.size());
+            if (inserted) units.push_back({{}, f->second, key.asString()});
+            units[it->second].ops.push_back(i);
+            unitOf[i] = it->second;
+        }
+
+        // dependency edges between units, then Kahn levels
+        std::vector<std::vector<std::size_t>> deps(units.size());
+        std::vector<std::vector<std::size_t>> dependents(units.size());
+        for (std::size_t u = 0; u < units.size(); ++u) {
+            for (std::size_t i : units[u].ops) {
+                for (const auto& dep : ops[i].after) {
+                    auto it = byId.find(dep);
+                    if (it == byId.end()) return R{"Operation " + ops[i].id + " waits for unknown id " + dep};
+                    const std::size_t d = unitOf[it->second];
+                    if (d == u || std::find(deps[u].begin(), deps[u].end(), d) != deps[u].end()) continue;
+                    deps[u].push_back(d);
+                    dependents[d].push_back(u);
+                }
+            }
+        }
+        std::vector<std::size_t> pending(units.size());
+        std::vector<std::size_t> wave;
+        for (std::size_t u = 0; u < units.size(); ++u) {
+            pending[u] = deps[u].size();
+            if (pending[u] == 0) wave.push_back(u);
+        }
+
+        std::vector<RpcOutcome> unitOutcome(units.size());
+        std::size_t finished = 0;
+        while (!wave.empty()) {
+            parallelFor(wave.size(), width, [&](std::size_t k) {
+                const std::size_t u = wave[k];
+                for (std::size_t d : deps[u]) {
+                    if (unitOutcome[d].status == RpcOutcome::Status::Ok) continue;
+                    unitOutcome[u].error = "Skipped: dependency failed";
+                    return;
+                }
+                unitOutcome[u] = execute(units[u], ops);
+            }, [&](std::size_t k, std::string what) {
+                unitOutcome[wave[k]] = RpcOutcome{RpcOutcome::Status::Failed, Json::Value{}, std::move(what)};
+            });
+            finished += wave.size();
+            std::vector<std::size_t> next;
+            for (std::size_t u : wave) {
+                for (std::size_t v : dependents[u]) {
+                    if (--pending[v] == 0) next.push_back(v);
+                }
+            }
+            wave = std::move(next);
+        }
+        if (finished != units.size()) return R{"Dependency cycle between operations"};
+
+        std::vector<RpcOutcome> out(ops.size());
+        for (std::size_t i = 0; i < ops.size(); ++i) out[i] = unitOutcome[unitOf[i]];
+        return R{std::move(out)};
+    }
+
+private:
+    struct Group {
+        std::string keyParam;
+        GroupHandler handler;
+    };
+
+    struct Unit {
+        std::vector<std::size_t> ops;
+        std::optional<std::size_t> group;
+        std::string key;
+    };
+
+    [[nodiscard]] RpcOutcome execute(const Unit& unit, const std::vector<RpcOp>& ops) const {
+        RpcOutcome outcome;
+        try {
+            auto res = [&]() -> Result<Json::Value> {
+                if (!unit.group) {
+                    const auto& op = ops[unit.ops.front()];
+                    return methods.at(op.method)(op.params);
+                }
+                std::vector<const RpcOp*> members;
+                members.reserve(unit.ops.size());
+                for (std::size_t i : unit.ops) members.push_back(&ops[i]);
+                return groups[*unit.group].handler(unit.key, members);
+            }();
+            if (res.isErr()) {
+                outcome.status = RpcOutcome::Status::Failed;
+                outcome.error = std::move(res).unwrapErr();
+            } else {
+                outcome.status = RpcOutcome::Status::Ok;
+                outcome.result = std::move(res).unwrap();
+            }
+        } catch (const std::exception& e) {
+            outcome.status = RpcOutcome::Status::Failed;
+            outcome.error = e.what();
+        }
+        return outcome;
+    }
+
+    std::unordered_map<std::string, Handler> methods;
+    std::unordered_map<std::string, std::size_t> folded; // method -> groups index
+    std::vector<Group> groups;
+};
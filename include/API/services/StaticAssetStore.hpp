@@ -0,0 +1,314 @@
+#pragma once
+#include "Utils/Result.hpp"
+#include <openssl/evp.h>
+#include <zlib.h>
+#if __has_include(<brotli/encode.h>)
+#include <brotli/encode.h>
+#define PENHIVE_HAS_BROTLI 1
+#endif
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+enum class AssetEncoding { Identity, Gzip, Brotli };
+
+struct StaticAsset {
+    std::string path;        // relative to the root, '/' separated
+    std::string contentType;
+    std::string etag;        // strong: quoted content hash
+    std::string identity;    // empty when the file is served from disk
+    std::string gzip;        // empty when it would not be smaller
+    std::string brotli;
+    std::filesystem::path file;
+    std::size_t size{0};
+
+    [[nodiscard]] bool inMemory() const noexcept { return file.empty(); }
+    [[nodiscard]] const std::string& body(AssetEncoding e) const noexcept {
+        switch (e) {
+            case AssetEncoding::Gzip: return gzip;
+            case AssetEncoding::Brotli: return brotli;
+            case AssetEncoding::Identity: break;
+        }
+        return identity;
+    }
+};
+
+/**
+ * @brief The designer's static files, read and compressed once at startup
+ *
+ * Every file under the root with a known type is hashed (SHA-256, first
+ * 16 bytes as the strong ETag) and, when it compresses by at least 10%,
+ * kept as gzip and brotli too. Requests are then answered from memory
+ * without touching the disk. Files above maxInMemory are only hashed; they
+ * are streamed from disk (sendfile) uncompressed. The set is fixed after
+ * load(): lookups need no locking.
+ */
+class StaticAssetStore {
+public:
+    explicit StaticAssetStore(std::filesystem::path root, std::size_t maxInMemory = 4 * 1024 * 1024)
+        : root_(std::move(root)), maxInMemory_(maxInMemory) {}
+
+    // Number of assets loaded; an unreadable root is an error, an unreadable file is skipped
+    [[nodiscard]] Result<std::size_t> load() {
+        std::error_code ec;
+        std::filesystem::recursive_directory_iterator it(root_, ec), end;
+        if (ec) return Result<std::size_t>{"Cannot read asset directory " + root_.string() + ": " + ec.message()};
+        for (; it != end; it.increment(ec)) {
+            if (ec) break;
+            if (!it->is_regular_file(ec)) continue;
+            const auto type = contentTypeOf(it->path().extension().string());
+            if (type.empty()) continue; // headers and anything else not meant for browsers
+            StaticAsset asset;
+            asset.path = std::filesystem::relative(it->path(), root_, ec).generic_string();
+            asset.contentType = std::string(type);
+            asset.size = static_cast<std::size_t>(it->file_size(ec));
+            if (ec || !read(it->path(), asset)) continue;
+            assets_.insert_or_assign(asset.path, std::move(asset));
+        }
+        // pages last: they link the others by hash, and their own hash must cover those links
+        auto isPage = [](const StaticAsset& a) { return a.contentType.starts_with("text/html"); };
+        for (auto& [_, asset] : assets_) {
+            if (asset.inMemory() && !isPage(asset)) finish(asset);
+        }
+        for (auto& [_, asset] : assets_) {
+            if (!asset.inMemory() || !isPage(asset)) continue;
+            versionReferences(asset);
+            finish(asset);
+        }
+        return assets_.size();
+    }
+
+    [[nodiscard]] const StaticAsset* find(std::string_view path) const {
+        auto it = assets_.find(std::string(path));
+        return it == assets_.end() ? nullptr : &it->second;
+    }
+
+    // content hash for cache-busting URLs ("?v=..."): the ETag without quotes
+    [[nodiscard]] static std::string_view version(const StaticAsset& asset) noexcept {
+        std::string_view tag = asset.etag;
+        if (tag.size() >= 2) tag = tag.substr(1, tag.size() - 2);
+        return tag;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return assets_.size(); }
+    [[nodiscard]] const std::unordered_map<std::string, StaticAsset>& all() const noexcept { return assets_; }
+
+    // best variant the client accepts; "q=0" rules an encoding out
+    [[nodiscard]] static AssetEncoding negotiate(std::string_view acceptEncoding, const StaticAsset& asset) {
+        if (!asset.brotli.empty() && accepts(acceptEncoding, "br")) return AssetEncoding::Brotli;
+        if (!asset.gzip.empty() && accepts(acceptEncoding, "gzip")) return AssetEncoding::Gzip;
+        return AssetEncoding::Identity;
+    }
+
+    // If-None-Match: "*" or a list of tags; weak comparison as RFC 9110 requires for GET
+    [[nodiscard]] static bool matches(std::string_view ifNoneMatch, std::string_view etag) {
+        while (!ifNoneMatch.empty()) {
+            const auto comma = ifNoneMatch.find(',');
+            auto tag = trim(ifNoneMatch.substr(0, comma));
+            ifNoneMatch = comma == std::string_view::npos ? std::string_view{} : ifNoneMatch.substr(comma + 1);
+            if (tag == "*") return true;
+            if (tag.starts_with("W/")) tag.remove_prefix(2);
+            if (tag == etag) return true;
+        }
+        return false;
+    }
+
+private:
+    static std::string_view contentTypeOf(std::string ext) {
+        std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        static const std::unordered_map<std::string_view, std::string_view> types = {
+            {".html", "text/html; charset=utf-8"},
+            {".css", "text/css; charset=utf-8"},
+            {".js", "text/javascript; charset=utf-8"},
+            {".mjs", "text/javascript; charset=utf-8"},
+            {".json", "application/json"},
+            {".map", "application/json"},
+            {".svg", "image/svg+xml"},
+            {".png", "image/png"},
+            {".jpg", "image/jpeg"},
+            {".jpeg", "image/jpeg"},
+            {".gif", "image/gif"},
+            {".webp", "image/webp"},
+            {".ico", "image/x-icon"},
+            {".woff", "font/woff"},
+            {".woff2", "font/woff2"},
+            {".ttf", "font/ttf"},
+            {".txt", "text/plain; charset=utf-8"},
+        };
+        auto it = types.find(ext);
+        return it == types.end() ? std::string_view{} : it->second;
+    }
+
+    // already compressed formats gain nothing from another pass
+    static bool compressible(std::string_view type) {
+        return type.starts_with("text/") || type.starts_with("application/json") || type.starts_with("image/svg")
+            || type == "font/ttf" || type == "image/x-icon";
+    }
+
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+        return s;
+    }
+
+    static bool accepts(std::string_view header, std::string_view coding) {
+        while (!header.empty()) {
+            const auto comma = header.find(',');
+            auto item = trim(header.substr(0, comma));
+            header = comma == std::string_view::npos ? std::string_view{} : header.substr(comma + 1);
+            const auto semi = item.find(';');
+            const auto name = trim(item.substr(0, semi));
+            if (name != coding && name != "*") continue;
+            if (semi == std::string_view::npos) return true;
+            auto params = trim(item.substr(semi + 1));
+            // q=0, q=0.0, q=0.000 all mean "not acceptable"
+            if (params.starts_with("q=") || params.starts_with("Q=")) {
+                params.remove_prefix(2);
+                return params.find_first_not_of("0.") != std::string_view::npos;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    static void appendHex(std::string& out, const unsigned char* digest, unsigned int len) {
+        static constexpr char hex[] = "0123456789abcdef";
+        for (unsigned int i = 0; i < 16 && i < len; ++i) {
+            out += hex[digest[i] >> 4];
+            out += hex[digest[i] & 0xF];
+        }
+    }
+
+    // small files are kept whole; large ones are only hashed here and streamed from disk later
+    bool read(const std::filesystem::path& file, StaticAsset& asset) const {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) return false;
+        if (asset.size <= maxInMemory_) {
+            asset.identity.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            asset.size = asset.identity.size();
+            return !in.bad();
+        }
+        EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+        if (!ctx || EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr) != 1) {
+            EVP_MD_CTX_free(ctx);
+            return false;
+        }
+        std::vector<char> chunk(256 * 1024);
+        while (in) {
+            in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            const auto n = static_cast<std::size_t>(in.gcount());
+            if (n == 0) break;
+            EVP_DigestUpdate(ctx, chunk.data(), n);
+        }
+        std::array<unsigned char, EVP_MAX_MD_SIZE> digest{};
+        unsigned int len = 0;
+        const bool ok = !in.bad() && EVP_DigestFinal_ex(ctx, digest.data(), &len) == 1;
+        EVP_MD_CTX_free(ctx);
+        if (!ok) return false;
+        asset.etag = "\"";
+        appendHex(asset.etag, digest.data(), len);
+        asset.etag += '"';
+        asset.file = file;
+        return true;
+    }
+
+    void finish(StaticAsset& asset) const {
+        std::array<unsigned char, EVP_MAX_MD_SIZE> digest{};
+        unsigned int len = 0;
+        EVP_Digest(asset.identity.data(), asset.identity.size(), digest.data(), &len, EVP_sha256(), nullptr);
+        asset.etag = "\"";
+        appendHex(asset.etag, digest.data(), len);
+        asset.etag += '"';
+        asset.size = asset.identity.size();
+        if (!compressible(asset.contentType)) return;
+        // a variant is only kept when it saves at least 10%
+        const std::size_t worthIt = asset.identity.size() - asset.identity.size() / 10;
+        if (auto gz = gzip(asset.identity); gz.size() < worthIt) asset.gzip = std::move(gz);
+#ifdef PENHIVE_HAS_BROTLI
+        if (auto br = brotli(asset.identity, asset.contentType); br.size() < worthIt) asset.brotli = std::move(br);
+#endif
+    }
+
+    /**
+     * src="js/app.js" / href="/css/x.css" pointing at a loaded asset become
+     * "/js/app.js?v=<hash>", so those URLs can be cached as immutable and a
+     * page reload only revalidates the page itself. Pages are expected at the
+     * root (they are served from "/").
+     */
+    void versionReferences(StaticAsset& page) {
+        std::string out;
+        out.reserve(page.identity.size() + 512);
+        std::string_view html = page.identity;
+        while (!html.empty()) {
+            const auto src = html.find("src=\"");
+            const auto href = html.find("href=\"");
+            const auto at = std::min(src, href);
+            if (at == std::string_view::npos) break;
+            const auto valueStart = at + (at == src ? 5 : 6);
+            const auto valueEnd = html.find('"', valueStart);
+            if (valueEnd == std::string_view::npos) break;
+            out.append(html.substr(0, valueStart));
+            std::string_view ref = html.substr(valueStart, valueEnd - valueStart);
+            std::string_view key = ref;
+            if (key.starts_with("./")) key.remove_prefix(2);
+            else if (key.starts_with('/')) key.remove_prefix(1);
+            auto target = key.find_first_of("?#") == std::string_view::npos ? assets_.find(std::string(key)) : assets_.end();
+            if (target != assets_.end() && !target->second.contentType.starts_with("text/html") && !target->second.etag.empty()) {
+                out += '/';
+                out.append(key);
+                out += "?v=";
+                out.append(version(target->second));
+            } else {
+                out.append(ref);
+            }
+            html.remove_prefix(valueEnd);
+        }
+        out.append(html);
+        page.identity = std::move(out);
+    }
+
+    static std::string gzip(std::string_view data) {
+        z_stream zs{};
+        // 15 window bits + 16: gzip wrapper instead of zlib
+        if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) return {};
+        std::string out(deflateBound(&zs, static_cast<uLong>(data.size())), '\0');
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        zs.avail_in = static_cast<uInt>(data.size());
+        zs.next_out = reinterpret_cast<Bytef*>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+        const int rc = deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return rc == Z_STREAM_END ? out : std::string{};
+    }
+
+#ifdef PENHIVE_HAS_BROTLI
+    static std::string brotli(std::string_view data, std::string_view type) {
+        std::size_t size = BrotliEncoderMaxCompressedSize(data.size());
+        if (size == 0) return {};
+        std::string out(size, '\0');
+        const auto mode = type.starts_with("font/") ? BROTLI_MODE_FONT : BROTLI_MODE_TEXT;
+        if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, mode, data.size(),
+                                   reinterpret_cast<const std::uint8_t*>(data.data()), &size,
+                                   reinterpret_cast<std::uint8_t*>(out.data()))) {
+            return {};
+        }
+        out.resize(size);
+        return out;
+    }
+#endif
+
+    std::filesystem::path root_;
+    std::size_t maxInMemory_;
+    std::unordered_map<std::string, StaticAsset> assets_;
+};
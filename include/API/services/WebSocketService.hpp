@@ -0,0 +1,123 @@
+#pragma once
+#include <drogon/WebSocketController.h>
+#include "API/services/AsyncTaskManager.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+/**
+ * @brief Pushes AsyncTaskManager transitions to the UI over /ws/tasks
+ *
+ * Client messages:
+ *   {"subscribe":"<taskId>"}    only that task (may be repeated)
+ *   {"subscribe":"*"}           every task
+ *   {"unsubscribe":"<taskId>"}
+ * Each transition is sent as the same JSON that GET /api/v1/tasks/{id}
+ * returns. Subscribing to a task that already moved on sends its current
+ * state right away, so nothing is lost between the POST and the subscribe.
+ */
+class WebSocketService : public drogon::WebSocketController<WebSocketService> {
+public:
+    WS_PATH_LIST_BEGIN
+    WS_PATH_ADD("/ws/tasks", drogon::Get);
+    WS_PATH_LIST_END
+
+    // must be called before drogon::app().run()
+    static void configure(std::shared_ptr<AsyncTaskManager> manager) {
+        auto& state = hub();
+        if (state.tasks && state.listenerId) state.tasks->unsubscribe(state.listenerId);
+        state.tasks = std::move(manager);
+        if (state.tasks) state.listenerId = state.tasks->subscribe([](const AsyncTask& task) { broadcast(task); });
+    }
+
+    void handleNewConnection(const drogon::HttpRequestPtr&, const drogon::WebSocketConnectionPtr& conn) override {
+        conn->setContext(std::make_shared<Subscription>());
+        std::lock_guard lock(hub().mutex_);
+        hub().connections.insert(conn);
+    }
+
+    void handleNewMessage(const drogon::WebSocketConnectionPtr& conn, std::string&& message,
+                          const drogon::WebSocketMessageType& type) override {
+        if (type != drogon::WebSocketMessageType::Text) return;
+        Json::Value msg;
+        Json::Reader reader;
+        if (!reader.parse(message, msg) || !msg.isObject()) return;
+        auto sub = conn->getContext<Subscription>();
+        if (!sub) return;
+
+        if (msg["subscribe"].isString()) {
+            const std::string id = msg["subscribe"].asString();
+            {
+                std::lock_guard lock(sub->mutex_);
+                if (id == "*") sub->all = true;
+                else sub->ids.insert(id);
+            }
+            if (id != "*" && hub().tasks) {
+                if (auto task = hub().tasks->get(id)) conn->send(serialize(*task));
+            }
+        } else if (msg["unsubscribe"].isString()) {
+            const std::string id = msg["unsubscribe"].asString();
+            std::lock_guard lock(sub->mutex_);
+            if (id == "*") sub->all = false;
+            else sub->ids.erase(id);
+        }
+    }
+
+    void handleConnectionClosed(const drogon::WebSocketConnectionPtr& conn) override {
+        std::lock_guard lock(hub().mutex_);
+        hub().connections.erase(conn);
+    }
+
+private:
+    struct Subscription {
+        std::mutex mutex_;
+        bool all{false};
+        std::unordered_set<std::string> ids;
+    };
+
+    struct Hub {
+        std::mutex mutex_;
+        std::unordered_set<drogon::WebSocketConnectionPtr> connections;
+        std::shared_ptr<AsyncTaskManager> tasks;
+        std::uint64_t listenerId{0};
+    };
+
+    static Hub& hub() {
+        static Hub instance;
+        return instance;
+    }
+
+    static std::string serialize(const AsyncTask& task) {
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        return Json::writeString(writer, task.toJson());
+    }
+
+    // runs on the thread of the transition; send() is queued on each connection's loop
+    static void broadcast(const AsyncTask& task) {
+        std::vector<drogon::WebSocketConnectionPtr> targets;
+        {
+            std::lock_guard lock(hub().mutex_);
+            targets.reserve(hub().connections.size());
+            for (const auto& conn : hub().connections) {
+                auto sub = conn->getContext<Subscription>();
+                if (!sub) continue;
+                std::lock_guard subLock(sub->mutex_);
+                if (sub->all || sub->ids.contains(task.id)) targets.push_back(conn);
+            }
+        }
+        if (targets.empty()) return;
+        const std::string payload = serialize(task);
+        for (const auto& conn : targets) {
+            if (conn->connected()) conn->send(payload);
+        }
+        // a finished task sends nothing more: drop it from the per-connection sets
+        if (!task.finished()) return;
+        for (const auto& conn : targets) {
+            auto sub = conn->getContext<Subscription>();
+            std::lock_guard subLock(sub->mutex_);
+            sub->ids.erase(task.id);
+        }
+    }
+};
@@ -1,7 +1,10 @@
 #pragma once
 #include <boost/asio.hpp>
+#include "Core/concurrency/PriorityTaskQueue.hpp"
+#include "Core/concurrency/Task.hpp"
 #include <functional>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <thread>
 #include <vector>
@@ -12,7 +15,12 @@ using namespace std::chrono_literals;
 
 class Timer {
 public:
-    Timer(asio::io_context& io, std::chrono::steady_clock::duration dur, std::function<void()> cb);
+    // opaque: a steady_timer plus its callback, recycled by the dispatcher's timer pool
+    struct Impl;
+
+    Timer(asio::io_context& io, std::chrono::steady_clock::duration dur, Task cb);
+    // pooled timer obtained from EventDispatcher::dispatch_delayed
+    explicit Timer(std::shared_ptr<Impl> pooled) noexcept;
     void cancel();
     ~Timer();
 
@@ -21,25 +29,69 @@ public:
     Timer& operator=(const Timer&) = delete;
 
 private:
-    struct Impl;
     std::shared_ptr<Impl> impl_;
 };
 
+// SharedQueue: N threads on one io_context (default). WorkStealing: per-thread deques
+// with stealing for CPU tasks plus a separate pool for blocking calls; asio only runs timers.
+enum class ExecutorMode { SharedQueue, WorkStealing };
+
+// Blocking = long libvirt/disk calls, kept off the threads that run short CPU tasks
+enum class Lane { Cpu, Blocking };
+
+struct DispatcherStats {
+    ExecutorMode mode{ExecutorMode::SharedQueue};
+    size_t cpuThreads{0};
+    size_t blockingThreads{0};
+    size_t cpuQueued{0};
+    size_t blockingQueued{0};
+    std::uint64_t steals{0};
+    std::uint64_t executed{0};
+    std::vector<size_t> cpuDepths; // per worker, WorkStealing only
+    size_t rankedQueued{0};        // tasks waiting in the priority queues (both lanes)
+    std::uint64_t missedDeadlines{0};
+};
+
+// A ranked task that started after its deadline (it still runs)
+struct MissedDeadline {
+    Priority priority{Priority::Normal};
+    Lane lane{Lane::Cpu};
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::duration lateness{};
+};
+
 class EventDispatcher {
 public:
     explicit EventDispatcher(size_t threads = std::thread::hardware_concurrency());
+    // blockingThreads == 0 runs the Blocking lane on the CPU threads
+    EventDispatcher(ExecutorMode mode, size_t cpuThreads, size_t blockingThreads = 2);
     ~EventDispatcher();
 
-    // Post immediate task
-    void dispatch(std::function<void()> f);
+    // Post immediate task (Cpu lane)
+    // Task keeps small captures inline: no heap allocation for the common lambda
+    void dispatch(Task f);
+    void dispatch(Lane lane, Task f);
+    // Ranked task: strict priority between classes, EDF inside a class.
+    // Normal without a deadline is the same as dispatch(lane, f).
+    void dispatch(Priority prio, Deadline deadline, Task f, Lane lane = Lane::Cpu);
 
-    // Post delayed task (returns shared_ptr to Timer to allow cancel)
-    std::shared_ptr<Timer> dispatch_delayed(std::chrono::steady_clock::duration dur, std::function<void()> f);
+    // Post delayed task (returns shared_ptr to Timer to allow cancel). Timer objects
+    // and their shared_ptr blocks are recycled, so re-arming per tick does not allocate.
+    std::shared_ptr<Timer> dispatch_delayed(std::chrono::steady_clock::duration dur, Task f);
 
     // Control lifecycle
     void start();
     void stop();
 
+    [[nodiscard]] ExecutorMode mode() const noexcept;
+    // queue depths and steal counts for sizing the pools
+    [[nodiscard]] DispatcherStats stats() const;
+
+    // Most recent deadline misses (bounded history, oldest first)
+    [[nodiscard]] std::vector<MissedDeadline> missed_deadlines() const;
+    // Called on the worker thread right before the late task runs; keep it cheap
+    void on_deadline_missed(std::function<void(const MissedDeadline&)> handler);
+
     // non-copyable
     EventDispatcher(const EventDispatcher&) = delete;
     EventDispatcher& operator=(const EventDispatcher&) = delete;
@@ -49,51 +101,4 @@ private:
     std::unique_ptr<Impl> impl_;
 };
 
-} // namespace CONCURRENCY
-        stop();
-    }
-
-    // Post immediate task
-    void dispatch(std::function<void()> f) {
-        if (!f) return;
-        asio::post(io_ctx_, std::move(f));
-    }
-
-    // Post delayed task (returns shared_ptr to Timer to allow cancel)
-    std::shared_ptr<Timer> dispatch_delayed(std::chrono::steady_clock::duration dur, std::function<void()> f) {
-        if (!f) return nullptr;
-        auto t = std::make_shared<Timer>(io_ctx_, dur, std::move(f));
-        return t;
-    }
-
-    void start() {
-        if (running_.exchange(true)) return;
-        for (size_t i = 0; i < thread_count_; ++i) {
-            threads_.emplace_back([this]() {
-                try {
-                    io_ctx_.run();
-                } catch (...) {
-                    // ensure thread doesn't propagate exceptions
-                }
-            });
-        }
-    }
-
-    void stop() {
-        if (!running_.exchange(false)) return;
-        work_guard_.reset();
-        io_ctx_.stop();
-        for (auto &t : threads_) {
-            if (t.joinable()) t.join();
-        }
-        threads_.clear();
-    }
-
-private:
-    asio::io_context io_ctx_;
-    asio::executor_work_guard<asio::io_context::executor_type> work_guard_;
-    std::vector<std::thread> threads_;
-    size_t thread_count_{1};
-    std::atomic<bool> running_;
-};
 } // namespace CONCURRENCY
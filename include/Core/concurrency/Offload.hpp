@@ -0,0 +1,84 @@
+#pragma once
+#include "Core/concurrency/EventDispatcher.hpp"
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#if __has_include(<trantor/net/EventLoop.h>)
+#include <trantor/net/EventLoop.h>
+#define PENHIVE_HAS_TRANTOR 1
+#endif
+
+namespace CONCURRENCY {
+
+/**
+ * @brief co_await-able job: runs `fn` on the dispatcher, resumes the awaiting
+ * coroutine on the event loop it was suspended on
+ *
+ *   auto res = co_await manager->co_find(name);   // inside a drogon::Task<>
+ *
+ * When the awaiting thread is a drogon/trantor loop, the continuation is
+ * queued back onto that loop, so handler code after the co_await keeps
+ * running on its own IO thread. Anywhere else (a plain thread, a test)
+ * the coroutine simply resumes on the dispatcher worker.
+ * Exceptions thrown by `fn` are rethrown from co_await.
+ */
+template <typename T>
+class Offload {
+public:
+    Offload(std::shared_ptr<EventDispatcher> dispatcher, Lane lane, std::function<T()> fn)
+        : dispatcher_(std::move(dispatcher)), lane_(lane), fn_(std::move(fn)) {}
+
+    Offload(Offload&&) noexcept = default;
+    Offload(const Offload&) = delete;
+    Offload& operator=(const Offload&) = delete;
+
+    bool await_ready() const noexcept { return !dispatcher_; }
+
+    void await_suspend(std::coroutine_handle<> h) {
+#ifdef PENHIVE_HAS_TRANTOR
+        trantor::EventLoop* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+#else
+        void* loop = nullptr;
+#endif
+        // the awaiter lives in the suspended frame, so `this` stays valid until resume
+        dispatcher_->dispatch(lane_, [this, h, loop] {
+            run();
+#ifdef PENHIVE_HAS_TRANTOR
+            if (loop) {
+                loop->queueInLoop([h] { h.resume(); });
+                return;
+            }
+#else
+            (void)loop;
+#endif
+            h.resume();
+        });
+    }
+
+    T await_resume() {
+        // no dispatcher: await_ready() skipped the suspension, run inline
+        if (!dispatcher_) run();
+        if (error_) std::rethrow_exception(error_);
+        return std::move(*value_);
+    }
+
+private:
+    void run() noexcept {
+        try {
+            value_.emplace(fn_());
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+    }
+
+    std::shared_ptr<EventDispatcher> dispatcher_;
+    Lane lane_;
+    std::function<T()> fn_;
+    std::optional<T> value_;
+    std::exception_ptr error_;
+};
+
+} // namespace CONCURRENCY
@@ -0,0 +1,71 @@
+#pragma once
+#include "Core/concurrency/Task.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <vector>
+
+namespace CONCURRENCY {
+
+// Lower value drains first. Normal is what plain dispatch() uses.
+enum class Priority : std::uint8_t { Interactive = 0, High = 1, Normal = 2, Background = 3 };
+
+using Deadline = std::optional<std::chrono::steady_clock::time_point>;
+
+/**
+ * @brief Ranked tasks of one dispatcher lane: strict priority between
+ * classes, earliest deadline first inside a class, FIFO without a deadline
+ *
+ * The queue does not run anything itself. The dispatcher posts one token
+ * per push to the lane executor, and each token runs popped(). Tasks ranked
+ * above Normal are also drained by plain Normal tasks before they run, so
+ * an interactive task waits for the tasks already running, not for the
+ * whole backlog ahead of its token.
+ */
+class PriorityTaskQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Item {
+        CONCURRENCY::Task fn;
+        Priority priority{Priority::Normal};
+        Deadline deadline;
+    };
+
+    void push(Item item);
+    // Best task across classes, or nullopt if another token already took it
+    [[nodiscard]] std::optional<Item> pop();
+    // Only tasks ranked above Normal (used by the Normal fast path)
+    [[nodiscard]] std::optional<Item> popUrgent();
+
+    [[nodiscard]] bool hasUrgent() const noexcept { return urgent.load(std::memory_order_acquire) > 0; }
+    [[nodiscard]] std::size_t size() const noexcept { return total.load(std::memory_order_relaxed); }
+    void clear();
+
+private:
+    struct Entry {
+        Clock::time_point deadline;
+        std::uint64_t seq;
+        Item item;
+    };
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const noexcept {
+            return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+        }
+    };
+    using Heap = std::priority_queue<Entry, std::vector<Entry>, Later>;
+
+    [[nodiscard]] std::optional<Item> popFrom(std::size_t lastClass);
+
+    mutable std::mutex mutex_;
+    std::array<Heap, 4> classes;
+    std::uint64_t seq{0};
+    std::atomic<std::size_t> urgent{0};
+    std::atomic<std::size_t> total{0};
+};
+
+} // namespace CONCURRENCY
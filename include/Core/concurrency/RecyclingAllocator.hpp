@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <new>
+
+namespace CONCURRENCY {
+
+namespace detail {
+
+/**
+ * Per-thread free lists for small blocks (64/128/256/512 bytes). asio
+ * handler ops and pooled timers are allocated and freed at a steady rate,
+ * so after warm-up almost every allocation is a pop from a list. A block
+ * freed on another thread simply joins that thread's cache.
+ */
+class HandlerCache {
+public:
+    static constexpr std::size_t kClasses = 4;
+    static constexpr std::size_t kMaxPerClass = 512;
+
+    // nullptr once this thread's cache is gone (frees during thread/static teardown)
+    static HandlerCache* local() noexcept {
+        thread_local HandlerCache cache;
+        return alive() ? &cache : nullptr;
+    }
+
+    void* allocate(std::size_t bytes) {
+        const std::size_t cls = classOf(bytes);
+        if (cls == kClasses) return ::operator new(bytes);
+        if (Node* n = heads[cls]) {
+            heads[cls] = n->next;
+            --counts[cls];
+            return n;
+        }
+        return ::operator new(blockSize(cls));
+    }
+
+    void deallocate(void* p, std::size_t bytes) noexcept {
+        const std::size_t cls = classOf(bytes);
+        if (cls == kClasses || counts[cls] >= kMaxPerClass) {
+            ::operator delete(p);
+            return;
+        }
+        auto* n = static_cast<Node*>(p);
+        n->next = heads[cls];
+        heads[cls] = n;
+        ++counts[cls];
+    }
+
+    ~HandlerCache() {
+        alive() = false;
+        for (Node* head : heads) {
+            while (head) {
+                Node* next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    }
+
+private:
+    struct Node { Node* next; };
+
+    static bool& alive() noexcept {
+        thread_local bool flag = true;
+        return flag;
+    }
+
+    static constexpr std::size_t blockSize(std::size_t cls) noexcept { return std::size_t{64} << cls; }
+    static constexpr std::size_t classOf(std::size_t bytes) noexcept {
+        for (std::size_t cls = 0; cls < kClasses; ++cls) {
+            if (bytes <= blockSize(cls)) return cls;
+        }
+        return kClasses;
+    }
+
+    std::array<Node*, kClasses> heads{};
+    std::array<std::size_t, kClasses> counts{};
+};
+
+} // namespace detail
+
+// Stateless allocator over the thread-local HandlerCache (asio handlers, allocate_shared)
+template <typename T>
+class RecyclingAllocator {
+public:
+    using value_type = T;
+
+    RecyclingAllocator() noexcept = default;
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not recycled");
+        auto* cache = detail::HandlerCache::local();
+        return static_cast<T*>(cache ? cache->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (auto* cache = detail::HandlerCache::local()) cache->deallocate(p, n * sizeof(T));
+        else ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const RecyclingAllocator<U>&) const noexcept { return true; }
+};
+
+} // namespace CONCURRENCY
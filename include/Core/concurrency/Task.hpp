@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace CONCURRENCY {
+
+/**
+ * @brief Move-only void() callable with inline storage
+ *
+ * Callables up to kInlineSize bytes (a lambda capturing a few pointers, a
+ * shared_ptr and a string_view) live inside the Task, so the common
+ * dispatch() never touches the heap. Larger ones fall back to new. Unlike
+ * std::function, move-only captures (unique_ptr, promises) are accepted.
+ */
+class Task {
+public:
+    static constexpr std::size_t kInlineSize = 48;
+
+    Task() noexcept = default;
+    Task(std::nullptr_t) noexcept {}
+
+    template <typename F>
+        requires (!std::is_same_v<std::remove_cvref_t<F>, Task>) && std::is_invocable_r_v<void, std::decay_t<F>&>
+    Task(F&& f) {
+        using Fn = std::decay_t<F>;
+        // an empty function pointer or std::function stays an empty Task
+        if constexpr (std::is_pointer_v<Fn>) {
+            if (!f) return;
+        } else if constexpr (requires(const Fn& fn) { fn.operator bool(); }) {
+            if (!static_cast<bool>(f)) return;
+        }
+        if constexpr (fitsInline<Fn>()) {
+            ::new (static_cast<void*>(&storage)) Fn(std::forward<F>(f));
+            ops = &inlineOps<Fn>;
+        } else {
+            *reinterpret_cast<Fn**>(&storage) = new Fn(std::forward<F>(f));
+            ops = &heapOps<Fn>;
+        }
+    }
+
+    Task(Task&& other) noexcept { moveFrom(other); }
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+    Task& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops->invoke(&storage); }
+    explicit operator bool() const noexcept { return ops != nullptr; }
+
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(&storage);
+            ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*move)(void* dst, void* src) noexcept; // move-constructs dst, destroys src
+        void (*destroy)(void*) noexcept;
+    };
+
+    template <typename Fn>
+    static constexpr bool fitsInline() {
+        return sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<Fn>;
+    }
+
+    template <typename Fn>
+    static constexpr Ops inlineOps{
+        [](void* p) { (*static_cast<Fn*>(p))(); },
+        [](void* dst, void* src) noexcept {
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        },
+        [](void* p) noexcept { static_cast<Fn*>(p)->~Fn(); },
+    };
+
+    template <typename Fn>
+    static constexpr Ops heapOps{
+        [](void* p) { (**static_cast<Fn**>(p))(); },
+        [](void* dst, void* src) noexcept { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); },
+        [](void* p) noexcept { delete *static_cast<Fn**>(p); },
+    };
+
+    void moveFrom(Task& other) noexcept {
+        if (other.ops) {
+            other.ops->move(&storage, &other.storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[kInlineSize];
+    const Ops* ops{nullptr};
+};
+
+} // namespace CONCURRENCY
@@ -0,0 +1,143 @@
+#pragma once
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Core/concurrency/Task.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace CONCURRENCY {
+
+// Handle of a wheel job; stale handles (fired one-shots, cancelled jobs) are detected by generation
+struct TimerId {
+    std::uint32_t index{std::numeric_limits<std::uint32_t>::max()};
+    std::uint32_t generation{0};
+
+    explicit operator bool() const noexcept { return index != std::numeric_limits<std::uint32_t>::max(); }
+};
+
+struct WheelJobOptions {
+    // each firing lands somewhere in [due, due + jitter] so thousands of VMs do not tick together
+    std::chrono::steady_clock::duration jitter{0};
+    Lane lane{Lane::Cpu};
+    Priority priority{Priority::Normal};
+    // alternative to cancel(): once set, the job is dropped at its next due time
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+};
+
+struct TimerWheelStats {
+    std::size_t jobs{0};
+    std::uint64_t fired{0};
+    // periodic firings dropped because the previous run was still executing
+    std::uint64_t skipped{0};
+};
+
+/**
+ * @brief Hierarchical timer wheel for many long-lived periodic jobs
+ *
+ * 4 levels x 64 slots of `tick` resolution (100 ms covers ~19 days before
+ * the overflow list). One driver thread advances the wheel and hands due
+ * jobs to the EventDispatcher; jobs never run on the driver. Scheduling and
+ * cancel are O(1): jobs are intrusive doubly-linked nodes in a slab, and
+ * a cascade only touches one slot per level. Intended for health checks,
+ * session TTLs and snapshot schedules, where one asio timer per object is
+ * wasteful and millisecond precision is not needed.
+ *
+ * A periodic job is fixed-rate: the next due time advances by `interval`
+ * from the previous one, not from when the job finished. If a run is still
+ * executing when the next one is due, that firing is skipped.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(std::shared_ptr<EventDispatcher> dispatcher, std::chrono::milliseconds tick = std::chrono::milliseconds(100));
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    TimerId schedule_once(Clock::duration delay, Task fn, WheelJobOptions opts = {});
+    // first run after `interval` (+ jitter)
+    TimerId schedule_every(Clock::duration interval, Task fn, WheelJobOptions opts = {});
+    // false if the job already fired (one-shot) or was cancelled; a run already handed
+    // to the dispatcher is dropped before it starts, a run in progress completes
+    bool cancel(TimerId id) noexcept;
+
+    void stop();
+
+    [[nodiscard]] std::chrono::milliseconds tick() const noexcept { return tick_; }
+    [[nodiscard]] TimerWheelStats stats() const;
+
+private:
+    static constexpr std::size_t kLevels = 4;
+    static constexpr std::size_t kSlotBits = 6;
+    static constexpr std::size_t kSlots = std::size_t{1} << kSlotBits;
+    static constexpr std::uint32_t kNil = std::numeric_limits<std::uint32_t>::max();
+    // bucket index of the overflow list (jobs further out than the wheel spans)
+    static constexpr std::uint32_t kOverflow = kLevels * kSlots;
+
+    // shared with in-flight dispatches so a cancel or the wheel going away is safe
+    struct Job {
+        Task fn;
+        Lane lane{Lane::Cpu};
+        Priority priority{Priority::Normal};
+        std::shared_ptr<std::atomic<bool>> cancelFlag;
+        std::atomic<bool> cancelled{false};
+        std::atomic<bool> running{false};
+    };
+
+    struct Node {
+        std::uint32_t prev{kNil};
+        std::uint32_t next{kNil};
+        std::uint32_t bucket{kNil};
+        std::uint32_t generation{0};
+        std::uint64_t expiry{0};   // tick the job fires at
+        std::uint64_t base{0};     // nominal due tick, without jitter (periodic)
+        std::uint64_t interval{0}; // ticks; 0 = one-shot
+        std::uint64_t jitter{0};   // ticks
+        std::shared_ptr<Job> job;
+    };
+
+    TimerId add(Clock::duration delay, Clock::duration interval, Task fn, const WheelJobOptions& opts);
+    std::uint64_t toTicks(Clock::duration d) const noexcept;
+    std::uint64_t jitterTicks(std::uint64_t maxTicks);
+
+    void link(std::uint32_t idx);
+    void unlink(std::uint32_t idx) noexcept;
+    void release(std::uint32_t idx) noexcept;
+    void cascade(std::uint32_t bucket);
+    void advance(std::vector<std::shared_ptr<Job>>& due);
+    void run();
+
+    std::shared_ptr<EventDispatcher> dispatcher;
+    std::chrono::milliseconds tick_;
+    Clock::time_point origin;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake;
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> freeList;
+    std::array<std::uint32_t, kLevels * kSlots + 1> heads;
+    std::uint64_t now{0}; // last processed tick
+    std::size_t active{0};
+    std::minstd_rand rng;
+    bool stopping{false};
+
+    // outlives the wheel: queued runs still count into it
+    struct Counters {
+        std::atomic<std::uint64_t> fired{0};
+        std::atomic<std::uint64_t> skipped{0};
+    };
+    std::shared_ptr<Counters> counters;
+    std::thread driver;
+};
+
+} // namespace CONCURRENCY
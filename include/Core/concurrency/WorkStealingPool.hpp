@@ -0,0 +1,71 @@
+#pragma once
+#include "Core/concurrency/Task.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CONCURRENCY {
+
+/**
+ * @brief Fixed set of workers, one deque each, idle workers steal
+ *
+ * A worker pushes and pops at the back of its own deque (LIFO, cache warm);
+ * thieves and the submission round-robin work on the front. Each deque has
+ * its own lock, so submitters only contend when they hit the same worker.
+ * Sleeping workers are woken only when someone is actually asleep.
+ */
+class WorkStealingPool {
+public:
+    using Task = CONCURRENCY::Task;
+
+    // beforeTask runs on the worker ahead of every task (the dispatcher drains urgent work there)
+    explicit WorkStealingPool(std::size_t threads, std::function<void()> beforeTask = nullptr);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task);
+
+    void start();
+    // Joins the workers; tasks still queued are dropped (same as io_context::stop)
+    void stop();
+
+    [[nodiscard]] std::size_t threadCount() const noexcept { return workers.size(); }
+    [[nodiscard]] std::size_t queued() const noexcept { return pending.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t steals() const noexcept { return stealCount.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t executed() const noexcept { return execCount.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::vector<std::size_t> depths() const;
+
+private:
+    struct Worker {
+        mutable std::mutex mutex_;
+        std::deque<Task> tasks;
+    };
+
+    void run(std::size_t self);
+    bool popLocal(std::size_t self, Task& out);
+    bool steal(std::size_t self, Task& out);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::function<void()> beforeTask;
+
+    std::atomic<std::size_t> pending{0};
+    std::atomic<std::size_t> sleepers{0};
+    std::atomic<std::size_t> nextWorker{0};
+    std::atomic<std::uint64_t> stealCount{0};
+    std::atomic<std::uint64_t> execCount{0};
+    std::atomic<bool> running{false};
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+};
+
+} // namespace CONCURRENCY
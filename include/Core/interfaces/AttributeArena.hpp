@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// أسماء السمات الفرعية تتكرر في كل تعريف VM (bus، target، source...): تُخزَّن مرة واحدة للعملية كلها
+// والـ string_view المُعاد صالح حتى نهاية البرنامج
+class AttributeKeys {
+public:
+    static std::string_view intern(std::string_view key) {
+        auto& self = instance();
+        {
+            std::shared_lock lock(self.mutex_);
+            if (auto it = self.keys.find(key); it != self.keys.end()) return *it;
+        }
+        std::unique_lock lock(self.mutex_);
+        return *self.keys.emplace(key).first;
+    }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+    };
+
+    static AttributeKeys& instance() {
+        static AttributeKeys keys;
+        return keys;
+    }
+
+    std::shared_mutex mutex_;
+    std::unordered_set<std::string, Hash, std::equal_to<>> keys; // node-based: elements never move
+};
+
+// ذاكرة متجاورة للقيم: كتل تكبر بالمضاعفة، والقيم string_view داخلها (لا تخصيص لكل قيمة)
+// القيم المستبدلة تبقى حتى يُنسخ الكائن (النسخ يضغط) أو يُمسح
+class AttributeArena {
+public:
+    AttributeArena() = default;
+    // the source is left empty, as after clear(): a defaulted move kept its capacity/used with no block behind them
+    AttributeArena(AttributeArena&& other) noexcept
+        : blocks(std::move(other.blocks)),
+          capacity(std::exchange(other.capacity, 0)),
+          used(std::exchange(other.used, 0)),
+          nextBlock(std::exchange(other.nextBlock, kFirstBlock)) {
+        other.blocks.clear();
+    }
+    AttributeArena& operator=(AttributeArena&& other) noexcept {
+        if (this == &other) return *this;
+        blocks = std::move(other.blocks);
+        capacity = std::exchange(other.capacity, 0);
+        used = std::exchange(other.used, 0);
+        nextBlock = std::exchange(other.nextBlock, kFirstBlock);
+        other.blocks.clear();
+        return *this;
+    }
+    AttributeArena(const AttributeArena&) = delete;
+    AttributeArena& operator=(const AttributeArena&) = delete;
+
+    std::string_view store(std::string_view value) {
+        if (value.empty()) return {};
+        if (value.size() > capacity - used) grow(value.size());
+        char* dst = blocks.back().get() + used;
+        std::memcpy(dst, value.data(), value.size());
+        used += value.size();
+        return {dst, value.size()};
+    }
+
+    void clear() noexcept {
+        blocks.clear();
+        capacity = used = 0;
+        nextBlock = kFirstBlock;
+    }
+
+private:
+    static constexpr std::size_t kFirstBlock = 256;
+    static constexpr std::size_t kMaxBlock = 64 * 1024;
+
+    void grow(std::size_t atLeast) {
+        const std::size_t size = std::max(nextBlock, atLeast);
+        blocks.push_back(std::make_unique_for_overwrite<char[]>(size));
+        capacity = size;
+        used = 0;
+        nextBlock = std::min(nextBlock * 2, kMaxBlock);
+    }
+
+    std::vector<std::unique_ptr<char[]>> blocks; // heap blocks: views survive a move of the arena
+    std::size_t capacity{0};
+    std::size_t used{0};
+    std::size_t nextBlock{kFirstBlock};
+};
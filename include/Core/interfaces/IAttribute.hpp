@@ -8,6 +8,10 @@
 #include <algorithm> 
 #include <vector>
 #include <map>
+#include <cstdint>
+#include <utility>
+#include "Core/interfaces/AttributeArena.hpp"
+#include "Core/serialization/Writers.hpp"
 // مفهوم (Concept) للسمات
 template<typename T>
 concept AttributeType = requires(T t, std::string_view sv) {
@@ -19,6 +23,14 @@ concept AttributeType = requires(T t, std::string_view sv) {
     { t.to_json() } -> std::same_as<std::string>;
 };
 
+namespace attribute_detail {
+// المُسلسِلات تحسب الطول النهائي أولاً ثم تكتب في buffer واحد بدون إعادة تخصيص
+// (القيم تُهرَّب أثناء الكتابة نفسها؛ الطول المحسوب تقدير يكفي ما لم تحتج القيمة تهريباً)
+inline void append(std::string& out, std::same_as<std::string_view> auto... parts) {
+    (out.append(parts), ...);
+}
+} // namespace attribute_detail
+
 // الكلاس الأساسي باستخدام CRTP
 template<typename Derived>
 class IAttribute {
@@ -78,15 +90,30 @@ public:
     }
     
     std::string to_xml_impl() const {
-        return std::format("<{}>{}</{}>", name_, value_, name_);
+        std::string result;
+        result.reserve(2 * name_.size() + value_.size() + 5);
+        attribute_detail::append(result, std::string_view("<"), std::string_view(name_), std::string_view(">"));
+        SERIALIZATION::appendXmlEscaped(result, value_);
+        attribute_detail::append(result, std::string_view("</"), std::string_view(name_), std::string_view(">"));
+        return result;
     }
     
     std::string to_json_impl() const {
-        return std::format("\"{}\": \"{}\"", name_, value_);
+        std::string result;
+        result.reserve(name_.size() + value_.size() + 6);
+        result += '"';
+        SERIALIZATION::appendJsonEscaped(result, name_);
+        result += "\": \"";
+        SERIALIZATION::appendJsonEscaped(result, value_);
+        result += '"';
+        return result;
     }
     
     std::string to_str_impl(char separator) const {
-        return std::format("{}{}{}", name_, separator, value_);
+        std::string result;
+        result.reserve(name_.size() + value_.size() + 1);
+        attribute_detail::append(result, std::string_view(name_), std::string_view(&separator, 1), std::string_view(value_));
+        return result;
     }
     
     // مشغلات حديثة
@@ -95,94 +122,138 @@ public:
     // تحويل إلى string_view للكفاءة
     std::string_view value_view() const noexcept { return value_; }
     
-    // فحص إذا كانت القيمة رقمية
+    // فحص إذا كانت القيمة رقمية: أرقام فقط بعد تجاهل المسافات، بدون نسخة مؤقتة من القيمة
     bool is_numeric() const noexcept {
-        if (value_.empty()) return false;
-        
-        auto view = value_ | std::views::filter([](char c) { 
-            return !std::isspace(static_cast<unsigned char>(c)); 
-        });
-        
-        std::string trimmed(view.begin(), view.end());
-        
-        // استخدام std::from_chars في C++17+ أو التحقق اليدوي
-        return !trimmed.empty() && 
-               std::ranges::all_of(trimmed, [](char c) { 
-                   return std::isdigit(static_cast<unsigned char>(c)); 
-               });
+        bool digit = false;
+        for (char c : value_) {
+            if (std::isdigit(static_cast<unsigned char>(c))) {
+                digit = true;
+            } else if (!std::isspace(static_cast<unsigned char>(c))) {
+                return false;
+            }
+        }
+        return digit;
     }
 };
 
+// السمات الفرعية: المفاتيح مُخزّنة مرة واحدة (AttributeKeys)، والقيم string_view داخل arena خاص بالكائن،
+// وindex_ صغير مرتب حسب المفتاح للبحث بـ O(log n). attributes_ يحفظ ترتيب الإضافة للتسلسل
 class VectorAttribute final : public IAttribute<VectorAttribute> {
+public:
+    using entry_type = std::pair<std::string_view, std::string_view>;
+
 private:
-    std::vector<std::pair<std::string, std::string>> attributes_;
-    
+    AttributeArena arena_;
+    std::vector<entry_type> attributes_;
+    std::vector<std::uint32_t> index_; // مواقع في attributes_؛ المفاتيح المكررة بترتيب إضافتها
+
+    auto key_of() const {
+        return [this](std::uint32_t i) { return attributes_[i].first; };
+    }
+
+    auto lookup(std::string_view sub_name) const {
+        auto it = std::ranges::lower_bound(index_, sub_name, std::ranges::less{}, key_of());
+        return it != index_.end() && attributes_[*it].first == sub_name ? attributes_.begin() + *it : attributes_.end();
+    }
+
 public:
     explicit VectorAttribute(std::string_view name) : IAttribute(name) {}
+
+    // النسخ يضغط القيم في arena جديد (ويتخلص من القيم المستبدلة)؛ الفهرس يبقى كما هو
+    VectorAttribute(const VectorAttribute& other) : IAttribute(other), index_(other.index_) {
+        attributes_.reserve(other.attributes_.size());
+        for (const auto& [key, value] : other.attributes_) attributes_.emplace_back(key, arena_.store(value));
+    }
+    VectorAttribute& operator=(const VectorAttribute& other) {
+        if (this != &other) {
+            VectorAttribute copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    VectorAttribute(VectorAttribute&&) noexcept = default;
+    VectorAttribute& operator=(VectorAttribute&&) noexcept = default;
     
     // إضافة/استبدال سمات فرعية
     void add(std::string_view sub_name, std::string_view sub_value) {
-        attributes_.emplace_back(sub_name, sub_value);
+        const auto pos = static_cast<std::uint32_t>(attributes_.size());
+        attributes_.emplace_back(AttributeKeys::intern(sub_name), arena_.store(sub_value));
+        index_.insert(std::ranges::upper_bound(index_, sub_name, std::ranges::less{}, key_of()), pos);
     }
     
     void replace(std::string_view sub_name, std::string_view new_value) {
-        auto it = std::ranges::find_if(attributes_, 
-            [&](const auto& pair) { return pair.first == sub_name; });
-        
-        if (it != attributes_.end()) {
-            it->second = new_value;
+        if (auto it = lookup(sub_name); it != attributes_.end()) {
+            attributes_[static_cast<std::size_t>(it - attributes_.begin())].second = arena_.store(new_value);
         } else {
             add(sub_name, new_value);
         }
     }
+
+    void reserve(std::size_t n) {
+        attributes_.reserve(n);
+        index_.reserve(n);
+    }
     
     // الحصول على القيمة (ترجع قيمة افتراضية أو أول قيمة)
     std::string value_impl() const {
-        return attributes_.empty() ? "" : attributes_.front().second;
+        return attributes_.empty() ? "" : std::string(attributes_.front().second);
     }
     
     void replace_impl(std::string_view new_value)  {
         if (!attributes_.empty()) {
-            attributes_.front().second = new_value;
+            attributes_.front().second = arena_.store(new_value);
         }
     }
     
     std::unique_ptr<VectorAttribute> clone_impl() const {
-        auto cloned = std::make_unique<VectorAttribute>(name_);
-        cloned->attributes_ = attributes_;
-        return cloned;
+        return std::make_unique<VectorAttribute>(*this);
     }
     
     std::string to_xml_impl() const {
-        std::string result = std::format("<{}>", name_);
-        
+        std::size_t size = 2 * name_.size() + 5;
+        for (const auto& [key, value] : attributes_) size += 2 * key.size() + value.size() + 5;
+        std::string result;
+        result.reserve(size);
+        attribute_detail::append(result, std::string_view("<"), std::string_view(name_), std::string_view(">"));
         for (const auto& [key, value] : attributes_) {
-            result += std::format("<{0}>{1}</{0}>", key, value);
+            attribute_detail::append(result, std::string_view("<"), key, std::string_view(">"));
+            SERIALIZATION::appendXmlEscaped(result, value);
+            attribute_detail::append(result, std::string_view("</"), key, std::string_view(">"));
         }
-        
-        result += std::format("</{}>", name_);
+        attribute_detail::append(result, std::string_view("</"), std::string_view(name_), std::string_view(">"));
         return result;
     }
     
     std::string to_json_impl() const {
-        std::string result = std::format("\"{}\": {{", name_);
-        
+        std::size_t size = name_.size() + 6;
+        for (const auto& [key, value] : attributes_) size += key.size() + value.size() + 8;
+        std::string result;
+        result.reserve(size);
+        result += '"';
+        SERIALIZATION::appendJsonEscaped(result, name_);
+        result += "\": {";
         bool first = true;
         for (const auto& [key, value] : attributes_) {
             if (!first) result += ", ";
-            result += std::format("\"{}\": \"{}\"", key, value);
+            result += '"';
+            SERIALIZATION::appendJsonEscaped(result, key);
+            result += "\": \"";
+            SERIALIZATION::appendJsonEscaped(result, value);
+            result += '"';
             first = false;
         }
-        
         result += "}";
         return result;
     }
     
-    std::string to_str_impl(char separator) const {
-        std::string result = std::format("{} = [", name_);
-        
+    std::string to_str_impl(char /*separator*/) const {
+        std::size_t size = name_.size() + 6;
+        for (const auto& [key, value] : attributes_) size += key.size() + value.size() + 3;
+        std::string result;
+        result.reserve(size);
+        attribute_detail::append(result, std::string_view(name_), std::string_view(" = ["));
         for (const auto& [key, val] : attributes_) {
-            result += std::format(" {}={},", key, val);
+            attribute_detail::append(result, std::string_view(" "), key, std::string_view("="), val, std::string_view(","));
         }
         
         if (!attributes_.empty()) {
@@ -199,9 +270,8 @@ public:
     auto size() const { return attributes_.size(); }
     bool empty() const { return attributes_.empty(); }
     
-    // البحث باستخدام ranges
+    // بحث ثنائي في index_؛ يعيد أول قيمة أُضيفت بهذا المفتاح أو end()
     auto find(std::string_view sub_name) const {
-        return std::ranges::find_if(attributes_,
-            [&](const auto& pair) { return pair.first == sub_name; });
+        return lookup(sub_name);
     }
-};
\ No newline at end of file
+};
@@ -29,6 +29,12 @@ public:
     [[nodiscard]] virtual std::expected<void, rocksdb::Status>
     Delete(const rocksdb::WriteOptions& options, std::string_view key) noexcept = 0;
 
+    /**
+     * @brief Applies every operation in the batch atomically with a single WAL write.
+     */
+    [[nodiscard]] virtual std::expected<void, rocksdb::Status>
+    Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch& batch) noexcept = 0;
+
     [[nodiscard]] virtual std::unique_ptr<rocksdb::Iterator>
     NewIterator(const rocksdb::ReadOptions& options) noexcept = 0;
 
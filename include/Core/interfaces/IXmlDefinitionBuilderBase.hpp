@@ -14,7 +14,8 @@
 class IXmlBuilderBase {
 protected:
     pugi::xml_document doc;     ///< Underlying XML document
-    std::string buffer;         ///< Temporary data storage
+    std::string buffer;         ///< Reused output of build_compact()
+    std::size_t lastSize{0};    ///< Size of the previous output, reserved up front next time
 
     /**
      * @brief Constructs the XML document structure
@@ -36,26 +37,67 @@ public:
     IXmlBuilderBase& operator=(IXmlBuilderBase&&) noexcept = default;
 
     /**
-     * @brief Builds and returns the formatted XML document
-     * 
-     * @return std::string Formatted XML content
-     * 
-     * @note Uses return value optimization (RVO) for efficiency
+     * @brief Output layout of build_into()
+     *
+     * Compact writes raw XML with no declaration and no indentation, which is
+     * all libvirt needs; Indented matches build() for logs and debugging.
      */
-    [[nodiscard]] std::string build() {
+    enum class XmlFormat { Compact, Indented };
+
+    /**
+     * @brief Builds the document into a caller-owned buffer
+     *
+     * @param out Cleared and refilled; its capacity is kept, so a buffer
+     *            reused across calls stops reallocating after the first one
+     * @param format Compact (default) or Indented
+     *
+     * The document is rebuilt from scratch on every call, so one builder
+     * can be reconfigured and built repeatedly in a loop.
+     */
+    void build_into(std::string& out, XmlFormat format = XmlFormat::Compact) {
+        doc.reset();
         buildDocument(); // Delegate to derived implementation
 
-        // Use string writer to capture the XML output
-        struct xml_string_writer : pugi::xml_writer {
-            std::string result;
+        struct xml_append_writer : pugi::xml_writer {
+            std::string& out;
+            explicit xml_append_writer(std::string& target) : out(target) {}
             void write(const void* data, size_t size) override {
-                result.append(static_cast<const char*>(data), size);
+                out.append(static_cast<const char*>(data), size);
             }
         };
 
-        xml_string_writer writer;
-        doc.save(writer, "  ", pugi::format_default | pugi::format_indent);
-        return writer.result;
+        out.clear();
+        out.reserve(lastSize);
+        xml_append_writer writer(out);
+        if (format == XmlFormat::Compact) {
+            doc.save(writer, "", pugi::format_raw | pugi::format_no_declaration);
+        } else {
+            doc.save(writer, "  ", pugi::format_default | pugi::format_indent);
+        }
+        lastSize = out.size();
+    }
+
+    /**
+     * @brief Builds compactly into the builder's own buffer
+     *
+     * @return std::string_view Valid until the next build or reset
+     */
+    [[nodiscard]] std::string_view build_compact() {
+        build_into(buffer, XmlFormat::Compact);
+        return buffer;
+    }
+
+    /**
+     * @brief Builds and returns the formatted XML document
+     * 
+     * @return std::string Formatted XML content
+     * 
+     * @note Uses return value optimization (RVO) for efficiency
+     */
+    [[nodiscard]] std::string build() {
+        std::string result;
+        build_into(result, XmlFormat::Indented);
+        return result;
     }
 
     /**
@@ -67,6 +109,7 @@ public:
     void reset() noexcept {
         doc.reset();
         buffer.clear();
+        lastSize = 0;
         
         // Shrink buffer if capacity becomes excessive
         if (buffer.capacity() > 1024) {
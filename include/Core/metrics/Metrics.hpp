@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace METRICS {
+
+// one cache line each: counters bumped from different threads must not share one
+class Counter {
+public:
+    void inc(std::uint64_t n = 1) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<std::uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(double v) noexcept { value_.store(v, std::memory_order_relaxed); }
+    void add(double v) noexcept { value_.fetch_add(v, std::memory_order_relaxed); }
+    [[nodiscard]] double value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<double> value_{0.0};
+};
+
+/**
+ * @brief Fixed-bucket histogram; observe() is a handful of relaxed atomics
+ *
+ * Buckets are counted separately and made cumulative only when scraped, so
+ * an observation touches one bucket and the sum. Bounds are
+ * upper bounds in ascending order; +Inf is implicit.
+ */
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value) noexcept;
+    void observe(std::chrono::steady_clock::duration d) noexcept {
+        observe(std::chrono::duration<double>(d).count());
+    }
+
+    struct Snapshot {
+        std::vector<double> bounds;
+        std::vector<std::uint64_t> cumulative; // bounds.size() + 1 entries, the last is +Inf
+        std::uint64_t count{0};
+        double sum{0.0};
+    };
+    [[nodiscard]] Snapshot snapshot() const;
+
+private:
+    std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> buckets_;
+    std::atomic<double> sum_{0.0};
+};
+
+// 100 µs .. 60 s: from a cached lookup to a cold boot
+[[nodiscard]] const std::vector<double>& latencyBuckets();
+// 4 KiB .. 64 MiB
+[[nodiscard]] const std::vector<double>& byteBuckets();
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief Process-wide metrics in Prometheus text format
+ *
+ * Series are created on first use under a mutex and then live as long as
+ * the registry, so hot paths look a series up once and keep the reference:
+ *
+ *   static auto& define = METRICS::libvirtCall("virDomainDefineXML");
+ *   METRICS::ScopedTimer timer(define);
+ *
+ * From then on recording is lock-free. Callback gauges (queue depths, pool
+ * sizes) are sampled only when /metrics is scraped. render() takes the
+ * registry mutex; it is the only reader.
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& global();
+
+    Counter& counter(std::string_view name, std::string_view help, const Labels& labels = {});
+    Gauge& gauge(std::string_view name, std::string_view help, const Labels& labels = {});
+    Histogram& histogram(std::string_view name, std::string_view help, const Labels& labels = {},
+                         const std::vector<double>& bounds = latencyBuckets());
+
+    // value read at scrape time; returns an id for removeGauge() (owners that die before the registry)
+    std::uint64_t gaugeFn(std::string_view name, std::string_view help, const Labels& labels, std::function<double()> fn);
+    void removeGauge(std::uint64_t id);
+
+    [[nodiscard]] std::string render() const;
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Series {
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> fn;
+    };
+
+    struct Family {
+        std::string help;
+        Type type{Type::Counter};
+        std::map<std::string, Series> series; // key: rendered labels, e.g. api="virDomainCreate"
+    };
+
+    Series& series(std::string_view name, std::string_view help, Type type, const Labels& labels);
+    static std::string renderLabels(const Labels& labels);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family, std::less<>> families;
+    std::unordered_map<std::uint64_t, std::pair<std::string, std::string>> gaugeFns; // id -> family, labels
+    std::uint64_t nextGaugeId{1};
+};
+
+// observes the time since construction when it goes out of scope
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram) noexcept
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { histogram_.observe(std::chrono::steady_clock::now() - start_); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// penhive_libvirt_call_seconds{api="..."}; look it up once per call site (static local)
+[[nodiscard]] Histogram& libvirtCall(std::string_view api);
+
+} // namespace METRICS
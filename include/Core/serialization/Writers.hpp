@@ -0,0 +1,248 @@
+#pragma once
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace SERIALIZATION {
+
+// anything bytes can be appended to: a std::string, a socket buffer, a response body
+template <typename S>
+concept OutputSink = requires(S& s, std::string_view v, char c) {
+    s.write(v);
+    s.put(c);
+};
+
+class StringSink {
+public:
+    explicit StringSink(std::string& out) noexcept : out_(&out) {}
+    void write(std::string_view v) { out_->append(v); }
+    void put(char c) { out_->push_back(c); }
+    void reserve(std::size_t n) { out_->reserve(out_->size() + n); }
+
+private:
+    std::string* out_;
+};
+
+// offset of the first byte that needs escaping, or s.size(); 16 bytes per step with SSE2
+[[nodiscard]] std::size_t findJsonEscape(std::string_view s) noexcept;
+// text: & < >   attributes: also " and '   both: control bytes other than \t \n \r
+[[nodiscard]] std::size_t findXmlEscape(std::string_view s, bool attribute) noexcept;
+
+// runs without special bytes go to the sink in one write; values are never copied first
+template <OutputSink Sink>
+void writeJsonEscaped(Sink& sink, std::string_view s) {
+    static constexpr char hex[] = "0123456789abcdef";
+    while (!s.empty()) {
+        const std::size_t clean = findJsonEscape(s);
+        if (clean) sink.write(s.substr(0, clean));
+        if (clean == s.size()) return;
+        const unsigned char c = static_cast<unsigned char>(s[clean]);
+        switch (c) {
+            case '"': sink.write("\\\""); break;
+            case '\\': sink.write("\\\\"); break;
+            case '\n': sink.write("\\n"); break;
+            case '\r': sink.write("\\r"); break;
+            case '\t': sink.write("\\t"); break;
+            case '\b': sink.write("\\b"); break;
+            case '\f': sink.write("\\f"); break;
+            default: {
+                const char u[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                sink.write(std::string_view(u, sizeof(u)));
+            }
+        }
+        s.remove_prefix(clean + 1);
+    }
+}
+
+template <OutputSink Sink>
+void writeXmlEscaped(Sink& sink, std::string_view s, bool attribute = false) {
+    while (!s.empty()) {
+        const std::size_t clean = findXmlEscape(s, attribute);
+        if (clean) sink.write(s.substr(0, clean));
+        if (clean == s.size()) return;
+        switch (s[clean]) {
+            case '&': sink.write("&amp;"); break;
+            case '<': sink.write("&lt;"); break;
+            case '>': sink.write("&gt;"); break;
+            case '"': sink.write("&quot;"); break;
+            case '\'': sink.write("&apos;"); break;
+            // XML 1.0 cannot carry other control characters at all, even as references
+            default: sink.write("\xEF\xBF\xBD"); break;
+        }
+        s.remove_prefix(clean + 1);
+    }
+}
+
+inline void appendJsonEscaped(std::string& out, std::string_view s) {
+    StringSink sink(out);
+    writeJsonEscaped(sink, s);
+}
+
+inline void appendXmlEscaped(std::string& out, std::string_view s, bool attribute = false) {
+    StringSink sink(out);
+    writeXmlEscaped(sink, s, attribute);
+}
+
+/**
+ * @brief Streaming JSON writer: commas, quoting and escaping in one pass into the sink
+ *
+ *   std::string body;
+ *   SERIALIZATION::JsonWriter json(body);
+ *   json.beginObject().member("name", vm).key("disks").beginArray().value("vda").endArray().endObject();
+ *
+ * Nesting is tracked in a 64-level bitmask; going deeper is a caller bug.
+ */
+template <OutputSink Sink = StringSink>
+class JsonWriter {
+public:
+    explicit JsonWriter(Sink sink) : sink_(std::move(sink)) {}
+    explicit JsonWriter(std::string& out) requires std::same_as<Sink, StringSink> : sink_(out) {}
+
+    JsonWriter& beginObject() { open('{'); return *this; }
+    JsonWriter& endObject() { close('}'); return *this; }
+    JsonWriter& beginArray() { open('['); return *this; }
+    JsonWriter& endArray() { close(']'); return *this; }
+
+    JsonWriter& key(std::string_view k) {
+        separate();
+        quoted(k);
+        sink_.put(':');
+        afterKey = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view v) { separate(); quoted(v); return *this; }
+    JsonWriter& value(const char* v) { return value(std::string_view(v)); }
+    JsonWriter& value(const std::string& v) { return value(std::string_view(v)); }
+    JsonWriter& value(bool v) { separate(); sink_.write(v ? "true" : "false"); return *this; }
+    JsonWriter& null() { separate(); sink_.write("null"); return *this; }
+    template <typename T>
+        requires(std::integral<T> || std::floating_point<T>) && (!std::same_as<T, bool>)
+    JsonWriter& value(T v) {
+        separate();
+        char buf[32];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+        sink_.write(std::string_view(buf, static_cast<std::size_t>(end - buf)));
+        return *this;
+    }
+    // pre-serialized JSON (a cached fragment); not validated
+    JsonWriter& raw(std::string_view json) { separate(); sink_.write(json); return *this; }
+
+    template <typename T>
+    JsonWriter& member(std::string_view k, T&& v) { key(k); return value(std::forward<T>(v)); }
+
+    Sink& sink() noexcept { return sink_; }
+
+private:
+    void separate() {
+        if (afterKey) {
+            afterKey = false;
+            return;
+        }
+        if (depth == 0) return;
+        const std::uint64_t bit = std::uint64_t{1} << (depth - 1);
+        if (hasItems & bit) sink_.put(',');
+        hasItems |= bit;
+    }
+
+    void open(char c) {
+        separate();
+        sink_.put(c);
+        ++depth;
+        hasItems &= ~(std::uint64_t{1} << (depth - 1));
+    }
+
+    void close(char c) {
+        sink_.put(c);
+        if (depth > 0) --depth;
+    }
+
+    void quoted(std::string_view s) {
+        sink_.put('"');
+        writeJsonEscaped(sink_, s);
+        sink_.put('"');
+    }
+
+    Sink sink_;
+    std::uint64_t hasItems{0};
+    unsigned int depth{0};
+    bool afterKey{false};
+};
+
+/**
+ * @brief Streaming XML writer: element names are written as given, text and attributes escaped
+ *
+ *   SERIALIZATION::XmlWriter xml(out);
+ *   xml.begin("disk").attribute("type", "file").element("source", path).end();
+ *
+ * A start tag stays open until the first child or text, so empty elements come out as <x/>.
+ */
+template <OutputSink Sink = StringSink>
+class XmlWriter {
+public:
+    explicit XmlWriter(Sink sink) : sink_(std::move(sink)) {}
+    explicit XmlWriter(std::string& out) requires std::same_as<Sink, StringSink> : sink_(out) {}
+
+    XmlWriter& begin(std::string_view name) {
+        closeStartTag();
+        sink_.put('<');
+        sink_.write(name);
+        open.emplace_back(name);
+        startTagOpen = true;
+        return *this;
+    }
+
+    XmlWriter& attribute(std::string_view name, std::string_view value) {
+        // only valid right after begin(); ignored afterwards rather than producing broken XML
+        if (!startTagOpen) return *this;
+        sink_.put(' ');
+        sink_.write(name);
+        sink_.write("=\"");
+        writeXmlEscaped(sink_, value, true);
+        sink_.put('"');
+        return *this;
+    }
+
+    XmlWriter& text(std::string_view value) {
+        closeStartTag();
+        writeXmlEscaped(sink_, value, false);
+        return *this;
+    }
+
+    XmlWriter& end() {
+        if (open.empty()) return *this;
+        if (startTagOpen) {
+            sink_.write("/>");
+            startTagOpen = false;
+        } else {
+            sink_.write("</");
+            sink_.write(open.back());
+            sink_.put('>');
+        }
+        open.pop_back();
+        return *this;
+    }
+
+    // <name>text</name>
+    XmlWriter& element(std::string_view name, std::string_view value) { return begin(name).text(value).end(); }
+
+    Sink& sink() noexcept { return sink_; }
+
+private:
+    void closeStartTag() {
+        if (!startTagOpen) return;
+        sink_.put('>');
+        startTagOpen = false;
+    }
+
+    Sink sink_;
+    std::vector<std::string> open;
+    bool startTagOpen{false};
+};
+
+} // namespace SERIALIZATION
@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace CONCURRENCY { class TimerWheel; }
+
+namespace TRACING {
+
+// W3C trace context ids: a 128-bit trace id shared by every span of one API request, a 64-bit id per span
+struct TraceContext {
+    std::uint64_t traceHi{0};
+    std::uint64_t traceLo{0};
+    std::uint64_t spanId{0};
+
+    [[nodiscard]] bool valid() const noexcept { return (traceHi | traceLo) != 0; }
+    [[nodiscard]] std::string traceIdHex() const;
+    [[nodiscard]] std::string spanIdHex() const;
+    // "00-<trace id>-<span id>-01"
+    [[nodiscard]] std::string traceparent() const;
+
+    [[nodiscard]] static std::optional<TraceContext> fromTraceparent(std::string_view header) noexcept;
+    // fresh trace id and span id
+    [[nodiscard]] static TraceContext root() noexcept;
+    // the context of the span running on this thread; invalid outside any trace
+    [[nodiscard]] static TraceContext current() noexcept;
+};
+
+[[nodiscard]] std::uint64_t newSpanId() noexcept;
+
+// sets the thread's context and returns the previous one; for hooks that cannot hold a scope
+// (an HTTP pre-handling advice and its post-handling pair)
+TraceContext exchangeCurrent(const TraceContext& ctx) noexcept;
+
+// installs ctx as the thread's current context until the scope ends (tasks handed to another thread)
+class ContextScope {
+public:
+    explicit ContextScope(const TraceContext& ctx) noexcept;
+    ~ContextScope();
+    ContextScope(const ContextScope&) = delete;
+    ContextScope& operator=(const ContextScope&) = delete;
+
+private:
+    TraceContext previous;
+};
+
+enum class SpanKind { Internal, Server, Client };
+
+struct SpanRecord {
+    std::string name;
+    SpanKind kind{SpanKind::Internal};
+    TraceContext context;          // this span's ids
+    std::uint64_t parentSpanId{0}; // 0 for a root span
+    std::chrono::system_clock::time_point start;
+    std::chrono::nanoseconds duration{0};
+    int errorCode{0};              // 0 = ok; for libvirt calls the virErrorNumber
+    std::string error;
+    std::vector<std::pair<std::string, std::string>> attributes;
+};
+
+class SpanExporter {
+public:
+    virtual ~SpanExporter() = default;
+    // called with a batch; must not block for long (the caller may be a libvirt worker)
+    virtual void exportSpans(std::vector<SpanRecord>&& spans) = 0;
+};
+
+/**
+ * @brief Collects finished spans and hands them to the exporter in batches
+ *
+ * Without an exporter tracing is off: Span costs one relaxed load and
+ * records nothing, and no ids are generated. With one, spans accumulate
+ * under a mutex, are handed over when a batch fills, and start() flushes
+ * partial batches on the shared TimerWheel.
+ */
+class Tracer {
+public:
+    static Tracer& global();
+
+    void setExporter(std::shared_ptr<SpanExporter> exporter, std::size_t batchSize = 256);
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    void record(SpanRecord&& span);
+    void flush();
+
+    void start(CONCURRENCY::TimerWheel& wheel, std::chrono::seconds interval = std::chrono::seconds(5));
+    void stop() noexcept;
+
+private:
+    std::atomic<bool> enabled_{false};
+    std::mutex mutex_;
+    std::shared_ptr<SpanExporter> exporter_;
+    std::size_t batchSize_{256};
+    std::vector<SpanRecord> pending;
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+};
+
+/**
+ * @brief One timed operation; a child of the thread's current span, or a new trace
+ *
+ * While it lives it is the current context, so nested spans and tasks
+ * dispatched from inside it share its trace id.
+ *
+ *   TRACING::Span span("vm.deploy");
+ *   span.setAttribute("vm", cfg.name);
+ */
+class Span {
+public:
+    explicit Span(std::string_view name, SpanKind kind = SpanKind::Internal);
+    ~Span();
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    [[nodiscard]] bool recording() const noexcept { return record_ != nullptr; }
+    [[nodiscard]] TraceContext context() const noexcept { return record_ ? record_->context : TraceContext{}; }
+    void setAttribute(std::string key, std::string value);
+    void setError(int code, std::string message);
+
+private:
+    std::unique_ptr<SpanRecord> record_;
+    TraceContext previous;
+    std::chrono::steady_clock::time_point started;
+};
+
+} // namespace TRACING
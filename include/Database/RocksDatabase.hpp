@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Core/interfaces/IDatabase.hpp"
+#include <memory>
+#include <mutex>
+
+/**
+ * @brief IRocksDB implementation over a single rocksdb::DB instance.
+ *
+ * rocksdb::DB is internally synchronized; the mutex only guards Open/Close
+ * against concurrent use of the handle.
+ */
+class RocksDatabase final : public IRocksDB {
+public:
+    RocksDatabase() = default;
+    ~RocksDatabase() noexcept override;
+
+    RocksDatabase(const RocksDatabase&) = delete;
+    RocksDatabase& operator=(const RocksDatabase&) = delete;
+
+    [[nodiscard]] std::expected<void, rocksdb::Status>
+    Open(const rocksdb::Options& options, std::string_view name) noexcept override;
+
+    [[nodiscard]] std::expected<void, rocksdb::Status>
+    Put(const rocksdb::WriteOptions& options, std::string_view key, std::string_view value) noexcept override;
+
+    [[nodiscard]] std::expected<std::string, rocksdb::Status>
+    Get(const rocksdb::ReadOptions& options, std::string_view key) const noexcept override;
+
+    [[nodiscard]] std::expected<void, rocksdb::Status>
+    Delete(const rocksdb::WriteOptions& options, std::string_view key) noexcept override;
+
+    [[nodiscard]] std::expected<void, rocksdb::Status>
+    Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch& batch) noexcept override;
+
+    [[nodiscard]] std::unique_ptr<rocksdb::Iterator>
+    NewIterator(const rocksdb::ReadOptions& options) noexcept override;
+
+    [[nodiscard]] bool Close() noexcept override;
+
+private:
+    mutable std::mutex mutex_;
+    std::unique_ptr<rocksdb::DB> db;
+};
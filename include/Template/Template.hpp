@@ -1,4 +1,4 @@
-#pragma once 
+#pragma once
 #include <nlohmann/json.hpp>
 #include <expected>
 #include <optional>
@@ -15,75 +15,63 @@ namespace nlohmann {
 /**
  * Modern JSON template class using nlohmann::json with C++23 features.
  * Interface only — implementation lives in src/Template/Template.cpp
+ *
+ * Keys are dotted paths into the document ("vms.0.nics.1.mac"); a plain
+ * name addresses a top-level attribute. For templates that are read many
+ * times (lab expansion) resolve them once through TemplateEngine, whose
+ * CompiledTemplate answers the same paths from a precomputed index.
  */
 class Template {
 public:
     Template() = default;
+    explicit Template(nlohmann::json document) : data(std::move(document)) {}
 
+    /**
+     * @brief Parse a JSON document; the previous content is kept on error
+     * @return Error message with the caller's location on failure
+     */
     [[nodiscard]] std::expected<void, std::string> parse(
         std::string_view json_str,
         std::source_location loc = std::source_location::current()
     ) noexcept;
 
-    [[nodiscard]] std::string to_string() const;
-
-    void set(std::string key, nlohmann::json value);
-    void add(std::string key, nlohmann::json value);
-    [[nodiscard]] std::optional<nlohmann::json> get(std::string_view key) const;
-    [[nodiscard]] std::vector<nlohmann::json> get_all(std::string_view key) const;
-    [[nodiscard]] bool remove(std::string_view key);
-    [[nodiscard]] bool empty() const;
-    void merge(const Template& other);
-    void encrypt(const std::string& key);
-    void decrypt(const std::string& key);
-
-private:
-    nlohmann::json data;
-    [[nodiscard]] bool is_sensitive_field(std::string_view key) const;
-    [[nodiscard]] std::string encrypt_string(std::string_view plain, std::string_view key) const;
-    [[nodiscard]] std::string decrypt_string(std::string_view encrypted, std::string_view key) const;
-};
     /**
      * @brief Convert to JSON string with pretty printing (4-space indentation)
      * @return Formatted JSON string
      */
-    #include <map>
-    [[nodiscard]] std::string to_string() const{
-       
-        
-    }
+    [[nodiscard]] std::string to_string() const;
 
     /**
-     * @brief Set a key-value pair (replaces existing value)
-     * @param key Attribute name
+     * @brief Set a key-value pair (replaces existing value, creates intermediate objects)
+     * @param key Attribute path
      * @param value Attribute value (nlohmann::json type)
      */
     void set(std::string key, nlohmann::json value);
 
     /**
      * @brief Add value to existing key (appends to array or creates new array)
-     * @param key Attribute name
+     * @param key Attribute path
      * @param value Value to add
      */
     void add(std::string key, nlohmann::json value);
 
     /**
      * @brief Get first value for key (handles arrays)
-     * @param key Attribute name
+     * @param key Attribute path
      * @return Optional containing value or nullopt if not found
      */
     [[nodiscard]] std::optional<nlohmann::json> get(std::string_view key) const;
 
     /**
      * @brief Get all values for key as vector (single values become single-element vectors)
-     * @param key Attribute name
+     * @param key Attribute path
      * @return Vector of all values
      */
     [[nodiscard]] std::vector<nlohmann::json> get_all(std::string_view key) const;
 
     /**
      * @brief Remove key from template
-     * @param key Attribute name
+     * @param key Attribute path
      * @return true if key existed and was removed
      */
     [[nodiscard]] bool remove(std::string_view key);
@@ -95,35 +83,52 @@ private:
     [[nodiscard]] bool empty() const;
 
     /**
-     * @brief Merge another template (overwrites existing keys)
+     * @brief Merge another template: objects merge recursively, anything else is overwritten,
+     *        and a null in other removes the key (RFC 7386 merge patch, as used for inheritance)
      * @param other Template to merge from
      */
     void merge(const Template& other);
 
     /**
-     * @brief Encrypt sensitive fields using provided key
-     * @param key Encryption key
+     * @brief Encrypt sensitive fields using provided key (AES-256-GCM, one pass over the document)
+     *
+     * Every string under a sensitive name (see is_sensitive_field) becomes
+     * "enc:v1:<base64 iv|ciphertext|tag>"; already encrypted values are left
+     * alone. The AES key schedule is cached per thread and key.
+     * @param key Encryption key: a high-entropy secret, hashed into the AES key
+     * @throws TemplateException if OpenSSL fails
      */
     void encrypt(const std::string& key);
 
     /**
      * @brief Decrypt sensitive fields using provided key
      * @param key Decryption key
+     * @throws TemplateException on a wrong key or a tampered value; the template is left unchanged
      */
     void decrypt(const std::string& key);
 
+    [[nodiscard]] const nlohmann::json& document() const noexcept { return data; }
+
+    /**
+     * @brief Walk a dotted path; numeric segments index arrays
+     * @return The node, or nullptr if any segment is missing
+     */
+    [[nodiscard]] static const nlohmann::json* find(const nlohmann::json& root, std::string_view path) noexcept;
+
 private:
     nlohmann::json data;
 
     /**
-     * @brief Check if field name is sensitive (case-insensitive match)
+     * @brief Check if field name is sensitive: its last words are password, secret, token, flag, ...
+     *        ignoring case, '_' / '-' separators and a numeric suffix ("rootPassword", "flag_2");
+     *        words split at separators and camelCase, so "cpuflags" or "bitstoken" are not
      * @param key Field name to check
      * @return true if sensitive
      */
     [[nodiscard]] bool is_sensitive_field(std::string_view key) const;
 
     /**
-     * @brief Encrypt string using provided key
+     * @brief Encrypt string using provided key (same format as encrypt())
      * @param plain Plain text string
      * @param key Encryption key
      * @return Encrypted string
@@ -138,4 +143,3 @@ private:
      */
     [[nodiscard]] std::string decrypt_string(std::string_view encrypted, std::string_view key) const;
 };
-
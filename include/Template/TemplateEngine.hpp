@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Template/Template.hpp"
+
+/**
+ * @brief A template with every "extends" resolved, flattened into a path index
+ *
+ * Immutable once built: each node of the resolved document is reachable by
+ * its dotted path ("vms.12.nics.0.network") through one hash lookup, so
+ * expanding a lab reads fields without walking the JSON again.
+ */
+class CompiledTemplate {
+public:
+    CompiledTemplate(std::string name, std::uint64_t contentHash, nlohmann::json resolved);
+
+    CompiledTemplate(const CompiledTemplate&) = delete;
+    CompiledTemplate& operator=(const CompiledTemplate&) = delete;
+
+    [[nodiscard]] const std::string& name() const noexcept { return name_; }
+    // FNV-1a over the sources of this template and everything it extends
+    [[nodiscard]] std::uint64_t contentHash() const noexcept { return hash_; }
+    [[nodiscard]] const nlohmann::json& root() const noexcept { return root_; }
+
+    // the node at path or nullptr; pointers stay valid as long as the CompiledTemplate
+    [[nodiscard]] const nlohmann::json* find(std::string_view path) const noexcept;
+    // same contract as Template::get: the first element when the node is an array
+    [[nodiscard]] std::optional<nlohmann::json> get(std::string_view path) const;
+    [[nodiscard]] std::size_t paths() const noexcept { return index.size(); }
+
+    // mutable copy, for callers that patch a resolved template (per-student overrides)
+    [[nodiscard]] Template toTemplate() const { return Template(root_); }
+
+private:
+    struct PathHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view key) const noexcept { return std::hash<std::string_view>{}(key); }
+    };
+
+    void indexNode(const nlohmann::json& node, std::string& path);
+
+    std::string name_;
+    std::uint64_t hash_;
+    nlohmann::json root_;
+    std::unordered_map<std::string, const nlohmann::json*, PathHash, std::equal_to<>> index;
+};
+
+using CompiledTemplatePtr = std::shared_ptr<const CompiledTemplate>;
+
+/**
+ * @brief Named templates with inheritance, resolved once and cached
+ *
+ * A template (or any object nested in it, such as one VM of a lab) may name
+ * its bases with "extends": "kali-attacker" or ["linux-base", "lab-net"].
+ * Bases are merged left to right, then the object's own fields on top
+ * (Template::merge semantics: objects merge, everything else is replaced,
+ * null deletes). resolve() returns a shared CompiledTemplate that is reused
+ * until one of the sources it depends on changes.
+ *
+ * With a cache directory the resolved document is also stored as MessagePack
+ * under its content hash, so a restart or another node with the same
+ * sources skips resolution entirely.
+ */
+class TemplateEngine {
+public:
+    explicit TemplateEngine(std::filesystem::path cacheDir = {});
+
+    TemplateEngine(const TemplateEngine&) = delete;
+    TemplateEngine& operator=(const TemplateEngine&) = delete;
+
+    // registers or replaces a template source; resolution of references is deferred to resolve()
+    [[nodiscard]] std::expected<void, std::string> add(std::string name, std::string_view json);
+    // every *.json in dir, named after the file stem; returns how many were loaded
+    [[nodiscard]] std::expected<std::size_t, std::string> loadDirectory(const std::filesystem::path& dir);
+    bool remove(std::string_view name);
+
+    [[nodiscard]] std::expected<CompiledTemplatePtr, std::string> resolve(std::string_view name);
+
+    struct Stats {
+        std::uint64_t hits{0};      // served from memory
+        std::uint64_t diskHits{0};  // decoded from the MessagePack cache
+        std::uint64_t compiles{0};  // resolved from sources
+    };
+    [[nodiscard]] Stats stats() const noexcept {
+        return {hits.load(std::memory_order_relaxed), diskHits.load(std::memory_order_relaxed), compiles.load(std::memory_order_relaxed)};
+    }
+
+    static constexpr std::size_t kMaxDepth = 32;
+
+private:
+    struct Source {
+        nlohmann::json document;
+        std::uint64_t hash{0};
+        std::vector<std::string> references; // every "extends" target anywhere in the document
+    };
+    using SourceMap = std::unordered_map<std::string, std::shared_ptr<const Source>>;
+    // templates already resolved during one resolve() call: 50 VMs extending one base merge it once
+    using ResolvedMap = std::unordered_map<std::string, nlohmann::json>;
+
+    // content key: this source and, transitively, every source it references; fails on cycles
+    [[nodiscard]] std::expected<std::uint64_t, std::string> contentHash(const SourceMap& sources, const std::string& name,
+                                                                        std::vector<std::string>& stack) const;
+    [[nodiscard]] SourceMap snapshot() const;
+    [[nodiscard]] static std::expected<std::reference_wrapper<const nlohmann::json>, std::string> resolveDocument(
+        const SourceMap& sources, const std::string& name, std::vector<std::string>& stack, ResolvedMap& done);
+    [[nodiscard]] static std::expected<void, std::string> resolveNode(const SourceMap& sources, nlohmann::json& node,
+                                                                      std::vector<std::string>& stack, ResolvedMap& done);
+
+    [[nodiscard]] std::optional<nlohmann::json> loadCached(std::uint64_t hash) const;
+    void storeCached(std::uint64_t hash, const nlohmann::json& resolved) const;
+
+    std::filesystem::path cacheDir;
+
+    mutable std::shared_mutex mutex_;
+    SourceMap sources;
+    std::unordered_map<std::string, CompiledTemplatePtr> compiled; // by name, checked against contentHash
+
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> diskHits{0};
+    std::atomic<std::uint64_t> compiles{0};
+};
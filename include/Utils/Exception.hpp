@@ -10,4 +10,9 @@ public:
 class VMException : public std::runtime_error {
 public:
     using std::runtime_error::runtime_error;
-};
\ No newline at end of file
+};
+
+class TemplateException : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
@@ -2,7 +2,16 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <initializer_list>
+#include <mutex>
+#include <sstream>
+#include <type_traits>
 #include <boost/log/core.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/log/expressions.hpp>
@@ -17,10 +26,8 @@
 #include <boost/shared_ptr.hpp>
 #include <iostream>
 #include <fstream>
-
-// لدعم التنسيق الحديث (اختياري - يتطلب fmt)
-// #include <fmt/format.h>
-// #include <fmt/ostream.h>
+#include <utility>
+#include <vector>
 
 namespace bl = boost::log;
 namespace src = boost::log::sources;
@@ -29,6 +36,23 @@ namespace expr = boost::log::expressions;
 namespace attrs = boost::log::attributes;
 using namespace boost::log::trivial;
 
+// أدنى مستوى يُترجم أصلًا؛ ما دونه يختفي من الكود ولا تُقيَّم وسائطه (0 = Trace .. 5 = fatal)
+#ifndef PENHIVE_LOG_MIN_LEVEL
+#  ifdef NDEBUG
+#    define PENHIVE_LOG_MIN_LEVEL 2
+#  else
+#    define PENHIVE_LOG_MIN_LEVEL 0
+#  endif
+#endif
+
+// حقول منظمة تُلحق بالسطر بصيغة logfmt: "... vm=web01 lab=lab-3 op_id=7f2c"؛ الفارغ منها لا يُكتب
+struct LogFields {
+    std::string_view vm{};
+    std::string_view lab{};
+    std::string_view op_id{};
+    std::initializer_list<std::pair<std::string_view, std::string_view>> extra{};
+};
+
 class BoostLogger {
 public:
     enum class Level {
@@ -40,6 +64,12 @@ public:
         fatal = 5
     };
 
+    // ماذا يحدث عندما تمتلئ طابور السجل غير المتزامن
+    enum class OverflowPolicy {
+        Drop,  // تُسقط الرسالة وتُعدّ؛ خيط المُستدعي لا ينتظر أبدًا
+        Block  // ينتظر المُستدعي حتى يتفرّغ مكان
+    };
+
     struct Config {
         std::string name = "app";
         std::string file_path = "logs/app.log";
@@ -49,10 +79,22 @@ public:
         int max_files = 5;
         bool enable_console = true;
         bool enable_file = true;
+        // async: الرسالة تُنسخ إلى حلقة محدودة بلا أقفال ويكتبها خيط خلفي على دفعات
+        bool async = true;
+        std::size_t queue_capacity = 8192;                       // تُقرّب لأقرب قوة للعدد 2
+        OverflowPolicy overflow = OverflowPolicy::Drop;
+        std::chrono::milliseconds flush_interval{200};           // أقصى تأخير قبل flush للملف
     };
 
-    // تهيئة السجل وفق الإعدادات
-    static void Init(const Config& config = Config());
+    // تهيئة السجل وفق الإعدادات (أول استدعاء فقط يطبّق الإعدادات)
+    static void Init() { Init(Config{}); }
+    static void Init(const Config& config);
+
+    // يفرّغ الطابور ويوقف الخيط الخلفي؛ ما يُسجَّل بعدها يُكتب بشكل متزامن
+    static void Shutdown();
+
+    // عدد الرسائل التي أُسقطت بسبب امتلاء الطابور (OverflowPolicy::Drop)
+    static std::uint64_t Dropped() noexcept;
 
     // دوال التسجيل الأساسية (تدعم <<)
     static void Trace(const auto& msg) { log_impl(severity_level::trace, msg); }
@@ -60,25 +102,76 @@ public:
     static void Info(const auto& msg) { log_impl(severity_level::info, msg); }
     static void Warn(const auto& msg) { log_impl(severity_level::warning, msg); }
     static void Error(const auto& msg) { log_impl(severity_level::error, msg); }
-    static void Critical(const auto& msg) { log_impl(severity_level::critical, msg); }
+    static void Critical(const auto& msg) { log_impl(severity_level::fatal, msg); }
+
+    // تنسيق std::format: Info("Domain deployed: {}", name)؛ لا يُنسَّق شيء إن كان المستوى معطّلًا
+    template<typename A, typename... Args>
+    static void Trace(std::format_string<A, Args...> fmt, A&& a, Args&&... args) { Log(Level::Trace, fmt, std::forward<A>(a), std::forward<Args>(args)...); }
+    template<typename A, typename... Args>
+    static void Debug(std::format_string<A, Args...> fmt, A&& a, Args&&... args) { Log(Level::Debug, fmt, std::forward<A>(a), std::forward<Args>(args)...); }
+    template<typename A, typename... Args>
+    static void Info(std::format_string<A, Args...> fmt, A&& a, Args&&... args) { Log(Level::Info, fmt, std::forward<A>(a), std::forward<Args>(args)...); }
+    template<typename A, typename... Args>
+    static void Warn(std::format_string<A, Args...> fmt, A&& a, Args&&... args) { Log(Level::Warning, fmt, std::forward<A>(a), std::forward<Args>(args)...); }
+    template<typename A, typename... Args>
+    static void Error(std::format_string<A, Args...> fmt, A&& a, Args&&... args) { Log(Level::Error, fmt, std::forward<A>(a), std::forward<Args>(args)...); }
+    template<typename A, typename... Args>
+    static void Critical(std::format_string<A, Args...> fmt, A&& a, Args&&... args) { Log(Level::fatal, fmt, std::forward<A>(a), std::forward<Args>(args)...); }
+
+    // هل يُكتب هذا المستوى في أي sink؟ (يُحسب في Init من مستويات الـ sinks)
+    static bool Enabled(Level level) noexcept {
+        return static_cast<int>(level) >= s_min_level.load(std::memory_order_relaxed);
+    }
+
+    template<typename... Args>
+    static void Log(Level level, std::format_string<Args...> fmt, Args&&... args) {
+        if (!Enabled(level)) return;
+        write(to_boost_level(level), std::format(fmt, std::forward<Args>(args)...), nullptr);
+    }
 
-    // دعم التنسيق باستخدام fmt (اختياري - انظر التعليق أدناه)
-    /*
     template<typename... Args>
-    static void Trace(fmt::format_string<Args...> fmt, Args&&... args) {
-        Trace(fmt::format(fmt, std::forward<Args>(args)...));
+    static void Log(Level level, const LogFields& fields, std::format_string<Args...> fmt, Args&&... args) {
+        if (!Enabled(level)) return;
+        write(to_boost_level(level), std::format(fmt, std::forward<Args>(args)...), &fields);
     }
-    // كرر لكل مستوى...
-    */
+
+    /**
+     * @brief Fields attached to every line this thread logs while the scope lives
+     *
+     * Scopes nest; the values are copied, so the caller's strings may go away.
+     *
+     *   LogScope scope(LogFields{.lab = labId, .op_id = taskId});
+     */
+    class Scope {
+    public:
+        explicit Scope(const LogFields& fields);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        friend class BoostLogger;
+        std::vector<std::pair<std::string, std::string>> fields_;
+        const Scope* parent_;
+    };
 
 private:
     inline static src::severity_logger_mt<severity_level> s_logger;
-    inline static bool s_initialized = false;
+    inline static std::atomic<bool> s_initialized{false};
+    inline static std::atomic<bool> s_async{false};
+    inline static std::mutex s_init_mutex;
+    inline static std::atomic<int> s_min_level{0};
 
     static severity_level to_boost_level(Level level);
     static void log_impl(severity_level lvl, const auto& msg);
+    // appends the call's and the thread's fields, then queues or writes the line
+    static void write(severity_level lvl, std::string&& line, const LogFields* fields);
+    // false when the async backend is not running (never started or shut down)
+    static bool enqueue(severity_level lvl, std::string&& msg);
 };
 
+using LogScope = BoostLogger::Scope;
+
 // تنفيذ الدوال
 inline severity_level BoostLogger::to_boost_level(Level level) {
     switch (level) {
@@ -93,45 +186,31 @@ inline severity_level BoostLogger::to_boost_level(Level level) {
 }
 
 inline void BoostLogger::log_impl(severity_level lvl, const auto& msg) {
-    if (!s_initialized) {
-        // تهيئة افتراضية إذا لم تتم التهيئة يدويًا
-        Init();
+    if (static_cast<int>(lvl) < s_min_level.load(std::memory_order_relaxed)) return;
+    // only the rendering happens on the caller's thread; in async mode the sinks run on the flusher
+    std::string line;
+    if constexpr (std::is_convertible_v<decltype(msg), std::string_view>) {
+        line = std::string_view(msg);
+    } else {
+        std::ostringstream os;
+        os << msg;
+        line = std::move(os).str();
     }
-    BOOST_LOG_SEV(s_logger, lvl) << msg;
+    write(lvl, std::move(line), nullptr);
 }
 
-inline void BoostLogger::Init(const Config& config) {
-    if (s_initialized) return;
-
-    // مسح أي تسجيلات سابقة (لتجنب التكرار عند إعادة التهيئة)
-    bl::core::get()->remove_all_sinks();
-
-    // إضافة سمة الوقت والخطوة (thread id)
-    bl::add_common_attributes();
-
-    // sink للكونسول
-    if (config.enable_console) {
-        auto console_sink = bl::add_console_log(
-            std::clog,
-            bl::keywords::format = "[%TimeStamp%] [%ThreadID%] [%Severity%] %Message%"
-        );
-        console_sink->set_filter(severity >= to_boost_level(config.console_level));
-    }
-
-    // sink للملف
-    if (config.enable_file) {
-        auto file_sink = bl::add_file_log(
-            bl::keywords::file_name = config.file_path,
-            bl::keywords::rotation_size = config.rotation_size,
-            bl::keywords::max_size = config.rotation_size * config.max_files,
-            bl::keywords::format = "[%TimeStamp%] [%ThreadID%] [%Severity%] %Message%",
-            bl::keywords::auto_flush = true
-        );
-        file_sink->set_filter(severity >= to_boost_level(config.file_level));
-    }
-
-    // ضبط الحد الأدنى لمستوى التسجيل العام
-    bl::core::get()->set_filter(severity >= severity_level::trace);
-
-    s_initialized = true;
-}
\ No newline at end of file
+// PH_INFO("deployed in {} ms", ms) أو PH_INFO(LogFields{.vm = name}, "deployed in {} ms", ms)
+// تحت PENHIVE_LOG_MIN_LEVEL يُحذف الاستدعاء عند الترجمة، وفوقه لا تُقيَّم الوسائط إن كان المستوى معطّلًا
+#define PH_LOG(level, ...)                                                        \
+    do {                                                                          \
+        if constexpr (static_cast<int>(level) >= PENHIVE_LOG_MIN_LEVEL) {         \
+            if (BoostLogger::Enabled(level)) BoostLogger::Log(level, __VA_ARGS__); \
+        }                                                                         \
+    } while (false)
+
+#define PH_TRACE(...)    PH_LOG(BoostLogger::Level::Trace, __VA_ARGS__)
+#define PH_DEBUG(...)    PH_LOG(BoostLogger::Level::Debug, __VA_ARGS__)
+#define PH_INFO(...)     PH_LOG(BoostLogger::Level::Info, __VA_ARGS__)
+#define PH_WARN(...)     PH_LOG(BoostLogger::Level::Warning, __VA_ARGS__)
+#define PH_ERROR(...)    PH_LOG(BoostLogger::Level::Error, __VA_ARGS__)
+#define PH_CRITICAL(...) PH_LOG(BoostLogger::Level::fatal, __VA_ARGS__)
@@ -1,33 +1,227 @@
 #pragma once
+#include <concepts>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
+// Explicit error wrapper; required when T and E are the same type (Result<std::string>)
+template <typename E = std::string>
+struct Err {
+  E error;
+};
+Err(const char*) -> Err<std::string>;
+template <typename E>
+Err(E) -> Err<E>;
+
 template <typename T, typename E = std::string>
+class Result;
+
+namespace result_detail {
+template <typename U>
+struct is_err : std::false_type {};
+template <typename E>
+struct is_err<Err<E>> : std::true_type {};
+
+template <typename U>
+struct is_result : std::false_type {};
+template <typename T, typename E>
+struct is_result<Result<T, E>> : std::true_type {};
+
+template <typename U, typename R>
+concept NotSpecial = !std::same_as<std::remove_cvref_t<U>, R> && !is_err<std::remove_cvref_t<U>>::value;
+} // namespace result_detail
+
+/**
+ * @brief Value-or-error with move-out and reference access
+ *
+ * Lvalue accessors return references, rvalue accessors move the payload out:
+ *   const auto& xml = res.unwrap();        // no copy
+ *   auto vms = std::move(res).unwrap();    // works for move-only T
+ * A plain value that converts to E but is not a T builds an error, so the
+ * existing `return Result<int>{"message"};` style keeps working. When T and
+ * E are the same type, errors must be wrapped: `return Err{"message"};`.
+ */
+template <typename T, typename E>
 class Result {
+  // index 0 = value, 1 = error; indices keep T == E unambiguous
   std::variant<T, E> storage;
 
 public:
-  Result(T&& value)
-      : storage(std::move(value)) {}
-  Result(E&& error)
-      : storage(std::move(error)) {}
+  using value_type = T;
+  using error_type = E;
+
+  template <typename U = T>
+    requires result_detail::NotSpecial<U, Result> && std::constructible_from<T, U> &&
+             (std::same_as<T, E> || std::same_as<std::remove_cvref_t<U>, T> || !std::constructible_from<E, U>)
+  Result(U&& value)
+      : storage(std::in_place_index<0>, std::forward<U>(value)) {}
 
-  [[nodiscard]] bool isOk() const noexcept { 
-    return std::holds_alternative<T>(storage); 
+  template <typename U>
+    requires result_detail::NotSpecial<U, Result> && (!std::same_as<T, E>) && std::constructible_from<E, U> &&
+             (!std::same_as<std::remove_cvref_t<U>, T>)
+  Result(U&& error)
+      : storage(std::in_place_index<1>, std::forward<U>(error)) {}
+
+  template <typename E2>
+    requires std::constructible_from<E, E2&&>
+  Result(Err<E2>&& error)
+      : storage(std::in_place_index<1>, std::move(error.error)) {}
+
+  [[nodiscard]] bool isOk() const noexcept {
+    return storage.index() == 0;
   }
-  [[nodiscard]] bool isErr() const noexcept { return std::holds_alternative<E>(storage); }
+  [[nodiscard]] bool isErr() const noexcept { return storage.index() == 1; }
+  explicit operator bool() const noexcept { return isOk(); }
 
-  T expect(const std::string& msg) {
-    if (isErr()) throw std::runtime_error(msg + ": " + std::get<E>(storage));
-    return std::get<T>(storage);
+  T& expect(const std::string& msg) & {
+    if (isErr()) throw std::runtime_error(msg + ": " + describe());
+    return std::get<0>(storage);
+  }
+  const T& expect(const std::string& msg) const& {
+    if (isErr()) throw std::runtime_error(msg + ": " + describe());
+    return std::get<0>(storage);
   }
+  T expect(const std::string& msg) && {
+    if (isErr()) throw std::runtime_error(msg + ": " + describe());
+    return std::get<0>(std::move(storage));
+  }
+
+  T& unwrap() & { return expect("Called unwrap on error Result"); }
+  const T& unwrap() const& { return expect("Called unwrap on error Result"); }
+  T unwrap() && { return std::move(*this).expect("Called unwrap on error Result"); }
 
-  T unwrap() { return expect("Called unwrap on error Result"); }
-  E unwrapErr() {
+  E& unwrapErr() & {
     if (isOk()) throw std::runtime_error("Called unwrapErr on ok Result");
-    return std::get<E>(storage);
+    return std::get<1>(storage);
   }
+  const E& unwrapErr() const& {
+    if (isOk()) throw std::runtime_error("Called unwrapErr on ok Result");
+    return std::get<1>(storage);
+  }
+  E unwrapErr() && {
+    if (isOk()) throw std::runtime_error("Called unwrapErr on ok Result");
+    return std::get<1>(std::move(storage));
+  }
+
+  T unwrapOr(T defaultValue) const& { return isOk() ? std::get<0>(storage) : std::move(defaultValue); }
+  T unwrapOr(T defaultValue) && { return isOk() ? std::get<0>(std::move(storage)) : std::move(defaultValue); }
+
+  // Result<U, E> with f(value); the error is carried over untouched
+  template <typename F>
+  auto map(F&& f) & { return mapImpl(*this, std::forward<F>(f)); }
+  template <typename F>
+  auto map(F&& f) const& { return mapImpl(*this, std::forward<F>(f)); }
+  template <typename F>
+  auto map(F&& f) && { return mapImpl(std::move(*this), std::forward<F>(f)); }
+
+  // f(value) must itself return a Result<U, E>
+  template <typename F>
+  auto andThen(F&& f) & { return andThenImpl(*this, std::forward<F>(f)); }
+  template <typename F>
+  auto andThen(F&& f) const& { return andThenImpl(*this, std::forward<F>(f)); }
+  template <typename F>
+  auto andThen(F&& f) && { return andThenImpl(std::move(*this), std::forward<F>(f)); }
 
-  T unwrapOr(T&& defaultValue) { return isOk() ? std::get<T>(storage) : std::move(defaultValue); }
-};
\ No newline at end of file
+  template <typename F>
+  auto mapErr(F&& f) && {
+    using E2 = std::remove_cvref_t<std::invoke_result_t<F, E&&>>;
+    if (isOk()) return Result<T, E2>(std::get<0>(std::move(storage)));
+    return Result<T, E2>(Err<E2>{std::forward<F>(f)(std::get<1>(std::move(storage)))});
+  }
+
+private:
+  std::string describe() const {
+    if constexpr (std::is_convertible_v<const E&, std::string>) return std::get<1>(storage);
+    else return "error";
+  }
+
+  template <typename Self, typename F>
+  static auto mapImpl(Self&& self, F&& f) {
+    using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::get<0>(std::forward<Self>(self).storage))>>;
+    if (self.isErr()) return Result<U, E>(Err<E>{std::get<1>(std::forward<Self>(self).storage)});
+    if constexpr (std::is_void_v<U>) {
+      std::forward<F>(f)(std::get<0>(std::forward<Self>(self).storage));
+      return Result<void, E>();
+    } else {
+      return Result<U, E>(std::forward<F>(f)(std::get<0>(std::forward<Self>(self).storage)));
+    }
+  }
+
+  template <typename Self, typename F>
+  static auto andThenImpl(Self&& self, F&& f) {
+    using R = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::get<0>(std::forward<Self>(self).storage))>>;
+    static_assert(result_detail::is_result<R>::value, "andThen callback must return a Result");
+    if (self.isErr()) return R(Err<E>{std::get<1>(std::forward<Self>(self).storage)});
+    return std::forward<F>(f)(std::get<0>(std::forward<Self>(self).storage));
+  }
+};
+
+// Success carries no value; only the error is stored
+template <typename E>
+class Result<void, E> {
+  std::optional<E> error;
+
+public:
+  using value_type = void;
+  using error_type = E;
+
+  Result() noexcept = default;
+
+  template <typename U>
+    requires result_detail::NotSpecial<U, Result> && std::constructible_from<E, U>
+  Result(U&& err)
+      : error(std::in_place, std::forward<U>(err)) {}
+
+  template <typename E2>
+    requires std::constructible_from<E, E2&&>
+  Result(Err<E2>&& err)
+      : error(std::in_place, std::move(err.error)) {}
+
+  [[nodiscard]] bool isOk() const noexcept { return !error.has_value(); }
+  [[nodiscard]] bool isErr() const noexcept { return error.has_value(); }
+  explicit operator bool() const noexcept { return isOk(); }
+
+  void expect(const std::string& msg) const {
+    if (isErr()) {
+      if constexpr (std::is_convertible_v<const E&, std::string>) throw std::runtime_error(msg + ": " + *error);
+      else throw std::runtime_error(msg);
+    }
+  }
+  void unwrap() const { expect("Called unwrap on error Result"); }
+
+  E& unwrapErr() & {
+    if (isOk()) throw std::runtime_error("Called unwrapErr on ok Result");
+    return *error;
+  }
+  const E& unwrapErr() const& {
+    if (isOk()) throw std::runtime_error("Called unwrapErr on ok Result");
+    return *error;
+  }
+  E unwrapErr() && {
+    if (isOk()) throw std::runtime_error("Called unwrapErr on ok Result");
+    return std::move(*error);
+  }
+
+  template <typename F>
+  auto map(F&& f) const& {
+    using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+    if (isErr()) return Result<U, E>(Err<E>{*error});
+    if constexpr (std::is_void_v<U>) {
+      std::forward<F>(f)();
+      return Result<void, E>();
+    } else {
+      return Result<U, E>(std::forward<F>(f)());
+    }
+  }
+
+  template <typename F>
+  auto andThen(F&& f) const& {
+    using R = std::remove_cvref_t<std::invoke_result_t<F>>;
+    static_assert(result_detail::is_result<R>::value, "andThen callback must return a Result");
+    if (isErr()) return R(Err<E>{*error});
+    return std::forward<F>(f)();
+  }
+};
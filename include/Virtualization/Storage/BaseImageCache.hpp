@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// نسخة محلية من صورة أساسية بعيدة (NFS/Ceph) على قرص الـ host
+struct CachedImage {
+    std::string name;          // base image name (BaseImageRegistry key)
+    std::string sourcePath;    // the remote backing file it copies; a different path means stale
+    std::string volumeName;    // volume inside the local cache pool
+    std::string path;          // local path clones use as backing file
+    std::uint64_t bytes{0};    // allocation on the local disk
+    std::size_t clones{0};     // clones backed by this copy; never evicted while > 0
+};
+
+/**
+ * @brief Bookkeeping of one host's local base-image cache: LRU order, clone pins, capacity
+ *
+ * Holds no libvirt state; StorageOrchestrator pulls and deletes the volumes
+ * and reports back here. A copy that backs a clone is pinned until the clone
+ * is deleted, so eviction only ever picks unreferenced copies, least
+ * recently used first. claim() marks a pull in flight so concurrent
+ * prefetches of the same base copy it once.
+ */
+class BaseImageCache {
+public:
+    enum class Claim { Hit, Pull, Busy };
+
+    explicit BaseImageCache(std::uint64_t capacityBytes) : capacity(capacityBytes) {}
+
+    // Hit: a copy of sourcePath is ready (and becomes most recent). Pull: the caller copies, then completed()/failed()
+    [[nodiscard]] Claim claim(std::string_view name, std::string_view sourcePath, CachedImage* hit = nullptr);
+    void completed(CachedImage image);
+    void failed(std::string_view name);
+
+    /**
+     * Startup: a copy found in the cache pool, pinned by the clones found
+     * backed by it. An empty image.name files it as retired (its source is
+     * gone or changed), so it is never handed out and only kept until
+     * evicted. Restored copies are colder than anything pulled since.
+     */
+    void restore(CachedImage image, const std::vector<std::string>& cloneVolumes);
+
+    // Ready copy of the current source, pinned for `cloneVolume` in the same step so it cannot be evicted in between
+    [[nodiscard]] std::optional<CachedImage> pin(std::string_view name, std::string_view sourcePath, std::string_view cloneVolume);
+    void release(std::string_view cloneVolume);
+
+    /**
+     * Unreferenced copies to delete so that `incoming` more bytes fit, least
+     * recently used first; they are already forgotten here. `fits` is false
+     * when even evicting everything evictable leaves too little room.
+     */
+    struct Eviction {
+        std::vector<CachedImage> victims;
+        bool fits{true};
+    };
+    [[nodiscard]] Eviction evictFor(std::uint64_t incoming);
+    // Drops a stale copy (its source changed) unless clones still use it; a pinned one is retired by completed()
+    [[nodiscard]] std::optional<CachedImage> forget(std::string_view name);
+
+    [[nodiscard]] std::vector<CachedImage> list() const;
+    [[nodiscard]] std::uint64_t usedBytes() const;
+    [[nodiscard]] std::uint64_t capacityBytes() const noexcept { return capacity; }
+
+private:
+    struct Entry {
+        CachedImage image;
+        std::list<std::string>::iterator lru;
+    };
+
+    void touch(Entry& entry);
+
+    const std::uint64_t capacity;
+    mutable std::mutex mutex_;
+    std::list<std::string> lru; // front = most recently used
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_set<std::string> pulling;
+    std::unordered_map<std::string, std::string> cloneOf; // clone volume -> image name
+    std::uint64_t used{0};
+};
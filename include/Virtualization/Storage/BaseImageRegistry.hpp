@@ -0,0 +1,35 @@
+#pragma once
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// صورة أساسية (golden image) يمكن إنشاء linked clones منها
+struct BaseImage {
+    std::string name;          // logical name used by templates (e.g. "kali-2024.1")
+    std::string volumeName;    // volume name inside the base pool
+    std::string path;          // absolute path used as backing file
+    std::string format{"qcow2"};
+    unsigned long long capacityBytes{0};
+};
+
+/**
+ * @brief Thread-safe registry of base images keyed by logical name
+ *
+ * Filled from the base storage pool (StorageOrchestrator::listBaseVolumes)
+ * or explicitly. Lookups are shared-locked: cloning never waits on a refresh.
+ */
+class BaseImageRegistry {
+public:
+    void add(BaseImage image);
+    bool remove(std::string_view name);
+    [[nodiscard]] std::optional<BaseImage> find(std::string_view name) const;
+    [[nodiscard]] std::vector<BaseImage> list() const;
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, BaseImage> images;
+};
@@ -0,0 +1,87 @@
+#pragma once
+// PENHIVE_WITH_BLAKE3 comes from the build when it found libblake3 (a header alone does not link)
+#if defined(PENHIVE_WITH_BLAKE3) && __has_include(<blake3.h>)
+#include <blake3.h>
+#define PENHIVE_HAS_BLAKE3 1
+#else
+#include <openssl/evp.h>
+#endif
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Incremental content digest for disk images, fed chunk by chunk as an upload streams in
+ *
+ * BLAKE3 when the library is available, SHA-256 (OpenSSL) otherwise. The
+ * algorithm is part of the digest ("blake3:<hex>" / "sha256:<hex>"), so
+ * objects stored by a build with one never collide with the other.
+ */
+class ContentHasher {
+public:
+    ContentHasher() {
+#ifdef PENHIVE_HAS_BLAKE3
+        blake3_hasher_init(&state);
+#else
+        ctx = EVP_MD_CTX_new();
+        if (ctx) EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr);
+#endif
+    }
+
+    ~ContentHasher() {
+#ifndef PENHIVE_HAS_BLAKE3
+        EVP_MD_CTX_free(ctx);
+#endif
+    }
+
+    ContentHasher(const ContentHasher&) = delete;
+    ContentHasher& operator=(const ContentHasher&) = delete;
+
+    void update(std::string_view data) {
+        bytes += data.size();
+#ifdef PENHIVE_HAS_BLAKE3
+        blake3_hasher_update(&state, data.data(), data.size());
+#else
+        if (ctx) EVP_DigestUpdate(ctx, data.data(), data.size());
+#endif
+    }
+
+    // Empty if the hash backend failed; the hasher cannot be fed after this
+    [[nodiscard]] std::string finish() {
+        std::array<unsigned char, 32> digest{};
+#ifdef PENHIVE_HAS_BLAKE3
+        blake3_hasher_finalize(&state, digest.data(), digest.size());
+        std::string out = "blake3:";
+#else
+        unsigned int len = 0;
+        if (!ctx || EVP_DigestFinal_ex(ctx, digest.data(), &len) != 1 || len != digest.size()) return {};
+        std::string out = "sha256:";
+#endif
+        static constexpr char hex[] = "0123456789abcdef";
+        for (unsigned char b : digest) {
+            out += hex[b >> 4];
+            out += hex[b & 0xF];
+        }
+        return out;
+    }
+
+    [[nodiscard]] std::uint64_t hashedBytes() const noexcept { return bytes; }
+
+    // "blake3:..." / "sha256:..." with 64 hex digits
+    [[nodiscard]] static bool isDigest(std::string_view s) noexcept {
+        const auto colon = s.find(':');
+        if (colon == std::string_view::npos || s.size() - colon - 1 != 64) return false;
+        const auto algo = s.substr(0, colon);
+        if (algo != "blake3" && algo != "sha256") return false;
+        return s.substr(colon + 1).find_first_not_of("0123456789abcdef") == std::string_view::npos;
+    }
+
+private:
+#ifdef PENHIVE_HAS_BLAKE3
+    blake3_hasher state;
+#else
+    EVP_MD_CTX* ctx{nullptr};
+#endif
+    std::uint64_t bytes{0};
+};
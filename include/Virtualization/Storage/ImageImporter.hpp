@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Utils/Result.hpp"
+
+enum class ImageFormat { Unknown, Raw, Qcow2, Vmdk, Vdi, Vhdx, Vpc, Ova, Iso };
+
+const char* toString(ImageFormat format) noexcept;
+
+struct ImportOptions {
+    bool compress{false};          // qcow2 compressed clusters: smaller bases, slower first reads
+    unsigned coroutines{8};        // qemu-img -m: parallel requests inside one conversion
+    std::string qemuImg{"qemu-img"};
+};
+
+// نتيجة استيراد صورة واحدة
+struct ImportResult {
+    ImageFormat sourceFormat{ImageFormat::Unknown};
+    std::filesystem::path output;
+    std::string outputFormat;      // "qcow2", or "raw" for ISOs kept as they are
+    std::uint64_t sourceBytes{0};
+    std::uint64_t allocatedBytes{0}; // blocks actually used on disk (the output is sparse)
+    std::string digest;            // ContentHasher digest of the published file; empty if it could not be read
+    bool converted{false};
+};
+
+/**
+ * @brief Turns an uploaded disk image into a base image: detect, convert, publish
+ *
+ * The format is read from the file's magic bytes, not its name. Anything
+ * that is not already a qcow2 (raw, VMDK, VDI, VHD/VHDX, the VMDK inside an
+ * OVA) is converted with `qemu-img convert -O qcow2 -m N -W`: N requests in
+ * flight with out-of-order writes, and zero runs (-S 4k) left unallocated so
+ * the output is sparse. OVAs are not unpacked; the disk is read in place
+ * from its offset in the tar. ISOs are published unchanged.
+ *
+ * The output is written next to its final name and renamed when complete,
+ * so a half-converted image never appears in the base pool; the upload is
+ * removed afterwards (moved, when no conversion was needed). The published
+ * file is hashed once more, so the caller can commit it to the
+ * ImageObjectStore like a streamed upload. One import
+ * blocks its thread for the whole conversion; callers run it on a pool of
+ * their own.
+ */
+class ImageImporter {
+public:
+    using Progress = std::function<void(double percent)>;
+
+    explicit ImageImporter(ImportOptions options = {}) : options(std::move(options)) {}
+
+    [[nodiscard]] static ImageFormat detect(const std::filesystem::path& file);
+
+    // Imports `source` as `outputDir/<stem>.qcow2` (".iso" kept for ISOs)
+    [[nodiscard]] Result<ImportResult> import(const std::filesystem::path& source,
+                                              const std::filesystem::path& outputDir,
+                                              const Progress& progress = {}) const;
+
+    [[nodiscard]] const ImportOptions& getOptions() const noexcept { return options; }
+
+private:
+    // offset and size of the first .vmdk member of an OVA (a ustar archive)
+    struct TarMember {
+        std::uint64_t offset{0};
+        std::uint64_t size{0};
+    };
+    [[nodiscard]] static Result<TarMember> findDisk(const std::filesystem::path& ova);
+    [[nodiscard]] Result<void> run(const std::vector<std::string>& argv, const Progress& progress) const;
+
+    ImportOptions options;
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "Utils/Result.hpp"
+
+class IRocksDB;
+
+// كائن واحد في المخزن: volume واحد في pool الصور الأساسية لكل محتوى مختلف
+struct ImageObject {
+    std::string digest;        // "blake3:<hex>" / "sha256:<hex>"
+    std::string volumeName;    // the volume that holds the bytes, inside the base pool
+    std::string format{"qcow2"};
+    std::uint64_t sizeBytes{0};
+    std::size_t names{0};      // logical image names resolving to this object
+    std::size_t clones{0};     // linked clones using it as backing file
+
+    [[nodiscard]] std::size_t refs() const noexcept { return names + clones; }
+};
+
+struct ImageCommit {
+    ImageObject object;
+    bool duplicate{false};                // the committed volume repeats `object` and can be deleted
+    std::optional<ImageObject> orphaned;  // the name used to point elsewhere and that object lost its last ref
+};
+
+/**
+ * @brief Content-addressed index of base images with reference counts
+ *
+ * Every completed upload is committed with its digest. The first volume seen
+ * with a digest becomes the object; a later upload of the same bytes only
+ * adds its name to it, and the caller drops the redundant volume. Names and
+ * linked clones both hold references, and an object is only handed back for
+ * deletion when neither is left, so a backing file never disappears under a
+ * clone.
+ *
+ * Key schema (optional IRocksDB, values are plain text):
+ *   img/obj/<digest>      -> volume \x1f format \x1f size
+ *   img/name/<name>       -> digest
+ *   img/clone/<volume>    -> digest
+ * Counts are not stored; load() rebuilds them from the name and clone keys.
+ */
+class ImageObjectStore {
+public:
+    explicit ImageObjectStore(std::shared_ptr<IRocksDB> db = nullptr);
+
+    // Warm start from the database; returns the number of objects
+    std::size_t load();
+
+    /**
+     * @brief Record that `name` now has the content `candidate.digest`
+     * @return The stored object (existing one on a duplicate), or an error
+     *         if the index could not be persisted; memory is unchanged then
+     */
+    [[nodiscard]] Result<ImageCommit> commit(const ImageObject& candidate, std::string_view name);
+
+    [[nodiscard]] std::optional<ImageObject> find(std::string_view digest) const;
+    // A logical name, or a digest used directly as a name
+    [[nodiscard]] std::optional<ImageObject> resolve(std::string_view nameOrDigest) const;
+    [[nodiscard]] std::optional<ImageObject> findByVolume(std::string_view volumeName) const;
+
+    // Returns the object when it lost its last reference; the caller deletes its volume
+    [[nodiscard]] Result<std::optional<ImageObject>> releaseName(std::string_view name);
+    [[nodiscard]] Result<void> retainClone(std::string_view digest, std::string_view cloneVolume);
+    [[nodiscard]] Result<std::optional<ImageObject>> releaseClone(std::string_view cloneVolume);
+
+    // (name, object) for every name; the orchestrator registers them as base images
+    [[nodiscard]] std::vector<std::pair<std::string, ImageObject>> aliases() const;
+    [[nodiscard]] std::vector<ImageObject> list() const;
+
+private:
+    struct Entry {
+        ImageObject object;
+        std::unordered_set<std::string> names;
+        std::unordered_set<std::string> clones;
+
+        [[nodiscard]] ImageObject snapshot() const;
+    };
+
+    [[nodiscard]] std::optional<ImageObject> dropIfUnreferenced(const std::string& digest);
+
+    std::shared_ptr<IRocksDB> db;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Entry> objects;       // digest -> entry
+    std::unordered_map<std::string, std::string> byName;  // name -> digest
+    std::unordered_map<std::string, std::string> byClone; // clone volume -> digest
+};
@@ -3,17 +3,89 @@
 #include <vector>
 #include <memory>
 #include <string_view>
-#include "System/Result.hpp"
-#include "System/VmException.hpp"
+#include <libvirt/libvirt.h>
+#include "Utils/Result.hpp"
+#include "Virtualization/Utils/VmException.hpp"
+#include "Virtualization/Storage/BaseImageCache.hpp"
+#include "Virtualization/Storage/BaseImageRegistry.hpp"
+#include "Virtualization/Storage/ImageObjectStore.hpp"
+
+class HypervisorConnector;
 
 class StorageOrchestrator {
     std::shared_ptr<class HypervisorConnector> connector;
+    std::string basePoolName;
+    std::string clonePoolName;
+    mutable BaseImageRegistry registry; // refreshed by listBaseVolumes()
+    std::shared_ptr<ImageObjectStore> objects; // optional; set before first use
+    std::shared_ptr<BaseImageCache> cache;     // optional: local copies of remote bases
+    std::string cachePoolName;
 
 public:
-    explicit StorageOrchestrator(std::shared_ptr<HypervisorConnector> conn);
+    explicit StorageOrchestrator(std::shared_ptr<HypervisorConnector> conn,
+                                 std::string basePool = "penhive-base",
+                                 std::string clonePool = "penhive-clones");
 
+    // يقرأ الـ volumes من pool الصور الأساسية ويحدّث الـ registry
     [[nodiscard]] Result<std::vector<std::string>> listBaseVolumes() const;
+    void registerBaseImage(BaseImage image);
+
+    /**
+     * Content-addressed bases: every name (and digest) in the store resolves
+     * to its object's volume, clones take a reference on the object they are
+     * backed by and deleting the clone drops it again. Must be called before
+     * the orchestrator is shared.
+     */
+    void attachObjectStore(std::shared_ptr<ImageObjectStore> store);
+    // Registers `name` as a base image backed by `object` (after an upload was committed)
+    [[nodiscard]] Result<BaseImage> adoptObject(std::string_view name, const ImageObject& object);
+    // Deletes a volume of the base pool (a duplicate upload or an unreferenced object)
+    [[nodiscard]] Result<void> deleteBaseVolume(std::string_view volumeName);
+    // Deletes an object that lost its last reference and forgets the base images pointing at it
+    void releaseObject(const ImageObject& object);
+    /**
+     * Commits a volume that appeared in the base pool outside VolumeUploadManager
+     * (an /api/upload import) to the object store under `name`: a duplicate
+     * volume is deleted, an object the name no longer points at is released when
+     * unreferenced, and the name is registered as a base image of the object.
+     */
+    [[nodiscard]] Result<ImageCommit> commitBaseVolume(std::string_view name, const ImageObject& candidate);
+
+    /**
+     * Creates a qcow2 overlay of baseName in the clone pool. Only the qcow2
+     * header is written, so the clone is ready in milliseconds regardless of
+     * the base image size. Returns the clone's path.
+     */
     [[nodiscard]] Result<std::string> createLinkedClone(std::string_view baseName, std::string_view cloneBaseName);
+
+    /**
+     * Per-host cache of bases that live on shared storage (NFS, Ceph). Once
+     * prefetch() copied a base into the local cache pool, new clones of it
+     * are backed by the local copy instead of the network one; the copy is
+     * pinned while such a clone exists and evicted LRU beyond the cache's
+     * capacity otherwise. Must be called before the orchestrator is shared.
+     */
+    void attachCache(std::shared_ptr<BaseImageCache> baseCache, std::string cachePool = "penhive-cache");
+    /**
+     * Rebuilds the cache index from the volumes already in the cache pool
+     * (named <hash of the source path>-<base volume>) after a restart. A copy
+     * of a current base is restored under its name; one whose source is gone
+     * or changed is kept as retired while clones in the clone pool are backed
+     * by it, and deleted otherwise. Returns the number of copies restored.
+     */
+    [[nodiscard]] Result<std::size_t> loadCache();
+    // Local path of the cached copy, pulling it first if needed (blocks for the whole copy)
+    [[nodiscard]] Result<std::string> prefetch(std::string_view baseName);
     [[nodiscard]] Result<void> deleteVolume(std::string_view volumeName);
     [[nodiscard]] Result<std::string> getVolumePath(std::string_view volumeName) const;
-};
\ No newline at end of file
+
+    [[nodiscard]] const BaseImageRegistry& baseImages() const noexcept { return registry; }
+    [[nodiscard]] const std::shared_ptr<ImageObjectStore>& objectStore() const noexcept { return objects; }
+    [[nodiscard]] const std::shared_ptr<BaseImageCache>& baseCache() const noexcept { return cache; }
+
+private:
+    [[nodiscard]] Result<BaseImage> describeBaseVolume(std::string_view name, const std::string& volumeName) const;
+    [[nodiscard]] Result<BaseImage> resolveBase(std::string_view baseName) const;
+    [[nodiscard]] Result<CachedImage> pullToCache(const BaseImage& base);
+    void deleteCachedVolume(const std::string& volumeName);
+};
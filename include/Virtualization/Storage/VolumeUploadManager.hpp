@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Utils/Result.hpp"
+#include "Virtualization/Storage/ContentHash.hpp"
+
+class HypervisorConnector;
+class ImageObjectStore;
+class StorageOrchestrator;
+
+// حالة رفع واحد كما يراها العميل (GET /api/v1/uploads/{id})
+struct UploadProgress {
+    std::string id;
+    std::string fileName;
+    std::string volumeName;
+    std::string format;
+    std::uint64_t size{0};
+    std::uint64_t received{0};   // contiguous bytes written; the next chunk must start here
+    bool complete{false};
+    std::string digest;          // content hash, set once complete
+    bool deduplicated{false};    // same bytes were already stored; volumeName is that volume
+
+    [[nodiscard]] double percent() const noexcept {
+        return size == 0 ? 100.0 : static_cast<double>(received) * 100.0 / static_cast<double>(size);
+    }
+};
+
+/**
+ * @brief Resumable chunked uploads streamed into a libvirt storage pool
+ *
+ * begin() creates the target volume with the final capacity; every chunk is
+ * then pushed through virStorageVolUpload at its offset, so no temp file is
+ * written and memory per request is bounded by kMaxChunkBytes. Chunks must
+ * arrive in order: a chunk at the wrong offset is rejected with the current
+ * offset so the client can resume from there, and a re-sent chunk that is
+ * already stored is acknowledged without being written again.
+ *
+ * Because chunks are in order, the content hash is computed on the way
+ * through. With an ImageObjectStore attached, a completed upload is
+ * committed by digest: if the bytes are already stored, the new volume is
+ * deleted and the upload's name resolves to the existing object, which is
+ * what linked clones back onto.
+ */
+class VolumeUploadManager {
+public:
+    static constexpr std::uint64_t kDefaultChunkBytes = 4ull << 20;
+    static constexpr std::uint64_t kMaxChunkBytes = 16ull << 20;
+
+    explicit VolumeUploadManager(std::shared_ptr<HypervisorConnector> connector,
+                                 std::string poolName = "penhive-base",
+                                 std::chrono::minutes idleTimeout = std::chrono::minutes{30});
+
+    [[nodiscard]] Result<UploadProgress> begin(std::string_view fileName, std::uint64_t size);
+    [[nodiscard]] Result<UploadProgress> writeChunk(std::string_view id, std::uint64_t offset, std::string_view data);
+    [[nodiscard]] Result<UploadProgress> status(std::string_view id) const;
+    // Deletes the partial volume of an unfinished upload
+    [[nodiscard]] Result<void> abort(std::string_view id);
+    [[nodiscard]] std::vector<UploadProgress> list() const;
+
+    // Aborts uploads with no chunk for idleTimeout; returns how many were dropped
+    std::size_t purgeIdle();
+
+    // Content-addressed dedup of completed uploads; must be called before the first upload
+    void attachObjectStore(std::shared_ptr<ImageObjectStore> store, std::shared_ptr<StorageOrchestrator> orchestrator);
+
+    [[nodiscard]] const std::string& getPoolName() const noexcept { return poolName; }
+
+private:
+    struct Session {
+        std::mutex mutex_;       // serializes chunks of one upload; other uploads proceed in parallel
+        UploadProgress progress;
+        std::chrono::steady_clock::time_point lastActivity;
+        ContentHasher hasher;    // fed with every chunk as it is streamed
+    };
+
+    [[nodiscard]] std::shared_ptr<Session> find(std::string_view id) const;
+    [[nodiscard]] std::string streamChunk(const std::string& volumeName, std::uint64_t offset, std::string_view data);
+    [[nodiscard]] std::string deleteVolume(const std::string& volumeName);
+    void commitContent(UploadProgress& p, ContentHasher& hasher);
+
+    std::shared_ptr<HypervisorConnector> connector;
+    std::string poolName;
+    std::chrono::minutes idleTimeout;
+    std::shared_ptr<ImageObjectStore> objects;
+    std::shared_ptr<StorageOrchestrator> storage;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Session>> sessions;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Core/interfaces/IXmlDefinitionBuilderBase.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
 #include <memory>
 #include <string_view>
 
@@ -20,6 +21,9 @@ private:
   std::string osType{ "hvm" };
   std::string architecture{ "x86_64" };
   std::string vncListenAddress{ "127.0.0.1" };
+  int consolePort{ -1 }; // -1: libvirt autoport
+  CpuPlacement placement;
+  const IoProfile* ioProfile{ nullptr }; // nullptr: libvirt's disk defaults
   /**
    * @brief Builds the domain definition XML structure
    *
@@ -47,6 +51,12 @@ public:
   VirtualMachineBuilder& setDisk(std::string_view diskPath);
   VirtualMachineBuilder& setOsType(std::string_view osType = "hvm");
   VirtualMachineBuilder& setArchitecture(std::string_view arch = "x86_64");
+  // vCPU pins, NUMA memory nodes and hugepages (see PlacementEngine)
+  VirtualMachineBuilder& setPlacement(CpuPlacement placement);
+  // SPICE display on a port from VirtualMachinePool::reserveConsolePort(), reached through the console proxy
+  VirtualMachineBuilder& setConsolePort(int port);
+  // disk cache/io/discard, virtio-blk multiqueue and iothreads (see VmConfig::findIoProfile); "" = none
+  [[nodiscard]] Result<void> setIoProfile(std::string_view profile);
 
   /**
    * @brief Builds and returns the formatted XML document
@@ -69,5 +79,8 @@ public:
     diskPath.clear();
     osType = "hvm";
     architecture = "x86_64";
+    placement = {};
+    consolePort = -1;
+    ioProfile = nullptr;
   }
 };
\ No newline at end of file
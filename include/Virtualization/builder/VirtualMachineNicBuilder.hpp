@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Core/interfaces/IXmlDefinitionBuilderBase.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
 #include <string_view>
 
 /**
@@ -24,6 +25,11 @@ private:
     std::string networkName{"default"};
     std::string deviceType{"network"};
     std::string sourceDevice;
+    std::string directMode{"bridge"};
+    std::string driverName; // empty: no <driver> element
+    unsigned int queues{0};
+    unsigned int rxQueueSize{0};
+    unsigned int txQueueSize{0};
 
 public:
     VirtualMachineNicBuilder() = default;
@@ -59,6 +65,31 @@ public:
      */
     VirtualMachineNicBuilder& setSourceDevice(std::string_view device);
 
+    /**
+     * @brief Sets the macvtap mode of a "direct" NIC
+     * @param mode "bridge", "vepa", "private" or "passthrough"
+     */
+    VirtualMachineNicBuilder& setDirectMode(std::string_view mode);
+
+    /**
+     * @brief Sets the virtio-net backend
+     * @param name Driver name ("vhost" or "qemu")
+     * @param queues Queue pairs; 0 or 1 = single queue
+     */
+    VirtualMachineNicBuilder& setDriver(std::string_view name, unsigned int queues = 0);
+
+    /**
+     * @brief Sets the virtio ring sizes; 0 keeps qemu's 256
+     */
+    VirtualMachineNicBuilder& setRingSizes(unsigned int rx, unsigned int tx = 0);
+
+    /**
+     * @brief Applies a named profile (see VmConfig::findNetProfile)
+     * @param vcpus vCPUs of the domain; multiqueue profiles get a queue pair per vCPU
+     * @return Error for an unknown profile; "" clears the driver settings
+     */
+    [[nodiscard]] Result<void> setNetProfile(std::string_view profile, unsigned int vcpus);
+
     /**
      * @brief Builds and returns the formatted XML document
      * @return Formatted XML string representation
@@ -79,5 +110,10 @@ public:
         networkName = "default";
         deviceType = "network";
         sourceDevice.clear();
+        directMode = "bridge";
+        driverName.clear();
+        queues = 0;
+        rxQueueSize = 0;
+        txQueueSize = 0;
     }
 };
\ No newline at end of file
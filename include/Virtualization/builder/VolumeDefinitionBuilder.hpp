@@ -3,20 +3,39 @@
 #include <string_view>
 #include <libxml/xmlwriter.h>
 
+/**
+ * @brief Builder for libvirt storage volume XML (virStorageVolCreateXML)
+ *
+ * With a backing store the volume becomes a qcow2 overlay: creation only
+ * writes the qcow2 header, the data stays in the base image.
+ */
 class VolumeDefinitionBuilder {
-    xmlTextWriterPtr writer;
+    xmlTextWriterPtr writer{nullptr};
+    xmlBufferPtr xmlBuf{nullptr};
     std::string buffer;
 
+    std::string name;
+    std::string format{"qcow2"};
+    std::string backingPath;
+    std::string backingFormat{"qcow2"};
+    unsigned long long capacityBytes{0};
+
     void finalize();
 
 public:
     VolumeDefinitionBuilder();
     ~VolumeDefinitionBuilder();
 
+    VolumeDefinitionBuilder(const VolumeDefinitionBuilder&) = delete;
+    VolumeDefinitionBuilder& operator=(const VolumeDefinitionBuilder&) = delete;
+
     VolumeDefinitionBuilder& setName(std::string_view name);
     VolumeDefinitionBuilder& setFormat(std::string_view format = "qcow2");
+    VolumeDefinitionBuilder& setCapacity(unsigned long long bytes);
     VolumeDefinitionBuilder& setBackingStore(std::string_view backingPath);
+    VolumeDefinitionBuilder& setBackingFormat(std::string_view format = "qcow2");
 
+    // throws StorageException if libxml2 fails
     [[nodiscard]] std::string build();
 };
 /*  const char* volumeXML = 
@@ -28,4 +47,4 @@ public:
         "  </target>"
         "</volume>";
 
-    virStorageVolPtr newVol = virStorageVolCreateXML(pool, volumeXML, 0);*/
\ No newline at end of file
+    virStorageVolPtr newVol = virStorageVolCreateXML(pool, volumeXML, 0);*/
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <libvirt/libvirt.h>
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+
+// ما يتسع له host واحد (الذاكرة والأقراص بالـ KiB مثل VmConfig)
+struct HostCapacity {
+    std::uint64_t totalMemoryKiB{0};
+    std::uint64_t freeMemoryKiB{0};      // virNodeGetFreeMemory: what the host has right now
+    std::uint64_t committedMemoryKiB{0}; // maximum memory of every active domain
+    unsigned int cpus{0};
+    unsigned int committedVcpus{0};
+    std::uint64_t freeDiskKiB{0};        // available bytes of the storage pool / 1024
+
+    // node info, free memory and one bulk stats call for the committed side
+    [[nodiscard]] static Result<HostCapacity> read(virConnectPtr conn, const std::string& storagePool = "default");
+};
+
+// BinPack: fill the fullest host that still fits (frees whole hosts).
+// Spread: least loaded host first (keeps noisy labs apart)
+enum class SchedulePolicy { BinPack, Spread };
+
+struct ScheduleOptions {
+    SchedulePolicy policy{SchedulePolicy::Spread};
+    unsigned int vcpuOvercommit{4};               // vCPUs per host CPU, like PlacementOptions::overcommit
+    double memoryOvercommit{1.0};                 // > 1 with balloons and KSM on the hosts
+    std::uint64_t memoryReserveKiB{2ull << 20};   // kept for the host itself
+    std::uint64_t diskReserveKiB{20ull << 20};    // never fill a pool to the last block
+};
+
+struct HostSlot {
+    std::string name;
+    HostCapacity capacity;
+    bool up{true};
+};
+
+/**
+ * @brief Chooses a host for every VM of a batch
+ *
+ * VMs are grouped by lab (metadata["lab"]; a VM without one is a group of
+ * its own). Groups are handled largest first, and a group that fits on one
+ * host as a whole goes there, so lab traffic stays on the host's bridges.
+ * Only a lab that no host holds is split: each of its VMs then prefers the
+ * host that already has most of its lab. Among hosts that fit, the policy
+ * picks by load, max(memory used / budget, vCPUs used / budget) after the
+ * placement. Capacity taken by earlier VMs of the batch counts.
+ * Pure computation: no libvirt calls.
+ */
+class ClusterScheduler {
+public:
+    explicit ClusterScheduler(ScheduleOptions options = {});
+
+    // host name per config in input order; empty = no host has room for it
+    [[nodiscard]] std::vector<std::string> schedule(const std::vector<VmConfig>& cfgs, std::vector<HostSlot> hosts) const;
+
+    [[nodiscard]] const ScheduleOptions& options() const noexcept { return opts; }
+    // max(memory, vCPU) share of the host's budget in use; > 1 = overcommitted past the options
+    [[nodiscard]] double load(const HostCapacity& host) const noexcept { return loadAfter(host, {}); }
+
+private:
+    struct Demand {
+        std::uint64_t memoryKiB{0};
+        unsigned int vcpus{0};
+        std::uint64_t diskKiB{0};
+    };
+
+    [[nodiscard]] static Demand demandOf(const VmConfig& cfg) noexcept;
+    [[nodiscard]] bool fits(const HostCapacity& host, const Demand& d) const noexcept;
+    [[nodiscard]] double loadAfter(const HostCapacity& host, const Demand& d) const noexcept;
+    static void take(HostCapacity& host, const Demand& d) noexcept;
+    // index of the best host among candidates for the policy, or -1
+    [[nodiscard]] int pick(const std::vector<HostSlot>& hosts, const std::vector<int>& candidates, const Demand& d) const;
+
+    ScheduleOptions opts;
+};
@@ -0,0 +1,140 @@
+#pragma once
+#include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Core/interfaces/IDatabase.hpp"
+#include "Utils/Result.hpp"
+#include "Virtualization/Storage/VirtualMachineStorageManager.hpp"
+#include "Virtualization/cluster/ClusterScheduler.hpp"
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/SegmentAllocator.hpp"
+#include "Virtualization/vmm/VirtualMachineManager.hpp"
+
+// host واحد في الـ cluster؛ uri مثل qemu+tls://node2.lab/system
+struct ClusterHostSpec {
+    std::string name;
+    std::string uri;
+    std::size_t poolSize{4};
+    // VM ids and console ports are kept per database: give each host its own
+    // to keep them apart (nullptr = the cluster database)
+    std::shared_ptr<IRocksDB> db;
+    // local copies of shared base images (the warm-pool bases of the templates it deploys); 0 = no cache
+    std::uint64_t baseCacheBytes{0};
+    std::string baseCachePool{"penhive-cache"};
+    // lab segments that span hosts (Vlan/Vxlan); Isolated = the manager gets no fabric
+    FabricOptions fabric;
+};
+
+struct ClusterHostStatus {
+    std::string name;
+    std::string uri;
+    bool up{false};
+    HostCapacity capacity;
+    std::string error; // last refresh failure
+    std::chrono::steady_clock::time_point refreshedAt{};
+};
+
+/**
+ * @brief Several hypervisor hosts behind one deploy/lookup API
+ *
+ * Every host gets its own HypervisorConnector (and connection pool) and its
+ * own VirtualMachineManager, so state caches, warm pools and timer wheels
+ * stay per host exactly as on a single box. deploy_batch() refreshes the
+ * capacity of all hosts in parallel, lets the ClusterScheduler choose a
+ * host per VM (a lab stays on one host whenever one holds it) and runs one
+ * deploy_batch per host concurrently. The host each domain landed on is
+ * persisted with its lab as
+ *   cluster/domain/<name> -> host '\t' lab
+ * so lookups, deletes and migrations find it again after a restart.
+ *
+ * Hosts with a base cache get their own StorageOrchestrator, whose cache
+ * index is rebuilt from the cache pool when the host is added. Before a host
+ * deploys its share of a batch, the base images its warm pools clone for the
+ * VMs' templates (metadata["template"] -> WarmPoolSpec::baseImage) are
+ * copied to its local cache pool, so the boot storm of a class reads local
+ * disks instead of the storage network. prefetch() does the same ahead of
+ * time for a lab that is about to start.
+ *
+ * Hosts with a Vlan/Vxlan fabric share one SegmentAllocator on the cluster
+ * database, so a segment has the same tag/VNI on every host.
+ */
+class HypervisorCluster {
+public:
+    explicit HypervisorCluster(std::shared_ptr<IRocksDB> db, ScheduleOptions options = {}, std::string storagePool = "default");
+    ~HypervisorCluster();
+
+    HypervisorCluster(const HypervisorCluster&) = delete;
+    HypervisorCluster& operator=(const HypervisorCluster&) = delete;
+
+    // connects to the host and builds its manager; a host that is down is not added
+    [[nodiscard]] Result<void> addHost(const ClusterHostSpec& spec);
+    void removeHost(const std::string& name);
+
+    [[nodiscard]] std::vector<std::string> hosts() const;
+    [[nodiscard]] std::shared_ptr<VirtualMachineManager> manager(std::string_view host) const;
+    [[nodiscard]] std::optional<std::string> hostOf(std::string_view domain) const;
+    // lab the domain was deployed with (metadata["lab"] does not survive in domain XML)
+    [[nodiscard]] std::optional<std::string> labOf(std::string_view domain) const;
+    // manager of the host that runs the domain (nullptr if unknown)
+    [[nodiscard]] std::shared_ptr<VirtualMachineManager> managerOf(std::string_view domain) const;
+
+    [[nodiscard]] std::shared_ptr<HypervisorConnector> connector(std::string_view host) const;
+    // storage of a host with a base cache (nullptr otherwise)
+    [[nodiscard]] std::shared_ptr<StorageOrchestrator> storage(std::string_view host) const;
+    [[nodiscard]] std::string uri(std::string_view host) const;
+    [[nodiscard]] std::vector<std::string> domainsOn(std::string_view host) const;
+    // the domain now runs on host (after a migration)
+    void rehome(const std::string& domain, const std::string& host);
+    [[nodiscard]] const ClusterScheduler& getScheduler() const noexcept { return scheduler; }
+    // tags/VNIs of lab segments, for any other fabric that must agree with the hosts' ones
+    [[nodiscard]] const std::shared_ptr<SegmentAllocator>& segmentAllocator() const noexcept { return segments; }
+
+    // capacity of every host, read concurrently; returns the number of hosts up
+    std::size_t refreshCapacity();
+    [[nodiscard]] std::vector<ClusterHostStatus> status() const;
+
+    // outcomes in input order, each with the host it went to
+    [[nodiscard]] Result<DeployBatchResult> deploy_batch(const std::vector<VmConfig>& cfgs);
+    [[nodiscard]] Result<void> deleteDomain(std::string_view name, bool deleteStorage = false);
+
+    // Schedules cfgs like deploy_batch and pulls their base images to the chosen hosts; returns copies ready
+    std::size_t prefetch(const std::vector<VmConfig>& cfgs);
+
+private:
+    struct Host {
+        ClusterHostSpec spec;
+        std::shared_ptr<HypervisorConnector> connector;
+        std::shared_ptr<VirtualMachineManager> manager;
+        std::shared_ptr<StorageOrchestrator> storage;
+        ClusterHostStatus status;
+    };
+
+    struct Placed {
+        std::string host;
+        std::string lab;
+    };
+
+    static std::string key(std::string_view domain);
+    void remember(const std::string& domain, Placed where);
+    void forget(const std::string& domain);
+    [[nodiscard]] std::map<std::string, std::vector<std::size_t>> plan(const std::vector<VmConfig>& cfgs,
+                                                                       std::map<std::string, std::shared_ptr<Host>>& byName,
+                                                                       std::vector<std::string>& chosen);
+    static std::size_t prefetchOn(Host& host, const std::vector<VmConfig>& cfgs, const std::vector<std::size_t>& members);
+
+    std::shared_ptr<IRocksDB> db;
+    ClusterScheduler scheduler;
+    std::string storagePool;
+    std::shared_ptr<SegmentAllocator> segments;
+
+    mutable std::shared_mutex mutex_;
+    std::map<std::string, std::shared_ptr<Host>> nodes; // ordered: ties in the scheduler go to the first name
+    std::unordered_map<std::string, Placed> placed;
+};
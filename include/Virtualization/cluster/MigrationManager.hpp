@@ -0,0 +1,119 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Utils/Result.hpp"
+#include "Virtualization/cluster/HypervisorCluster.hpp"
+
+struct MigrationOptions {
+    unsigned long long bandwidthMiBs{0};         // VIR_MIGRATE_PARAM_BANDWIDTH; 0 = unlimited
+    bool autoConverge{true};                      // throttle vCPUs of guests that dirty memory faster than the link
+    bool postCopy{false};                         // allow switching to post-copy ...
+    std::chrono::seconds postCopyAfter{60};       // ... once pre-copy ran this long without converging
+    bool compressed{false};
+    std::chrono::seconds timeout{std::chrono::minutes(10)}; // pre-copy only: post-copy cannot be aborted
+    std::chrono::milliseconds pollInterval{500};  // virDomainGetJobStats
+};
+
+// كم ترحيل في نفس الوقت؛ كل ترحيل يستهلك رابط الـ host المصدر والهدف
+struct MigrationLimits {
+    unsigned int outgoingPerHost{2};
+    unsigned int incomingPerHost{2};
+    unsigned int total{8};
+};
+
+enum class MigrationPhase { Queued, Precopy, Postcopy, Completed, Failed };
+
+struct MigrationProgress {
+    std::string domain;
+    std::string from;
+    std::string to;
+    MigrationPhase phase{MigrationPhase::Queued};
+    std::uint64_t dataTotal{0};     // bytes
+    std::uint64_t dataProcessed{0};
+    std::uint64_t dataRemaining{0};
+    std::uint64_t dirtyRate{0};     // pages/s
+    std::chrono::milliseconds elapsed{0};
+};
+
+struct MigrationResult {
+    std::string domain;
+    std::string from;
+    std::string to;
+    std::string error;
+    bool postCopy{false};
+    std::chrono::milliseconds took{0};
+
+    [[nodiscard]] bool ok() const noexcept { return error.empty(); }
+};
+
+/**
+ * @brief Live migration between cluster hosts: single moves, drains, rebalancing
+ *
+ * A migration is one virDomainMigrateToURI3 call (peer-to-peer, so the
+ * source libvirtd talks to the target over its qemu+tls URI) with the
+ * domain persisted on the target and undefined on the source. Live moves
+ * copy the disk overlays incrementally (their base images are in every
+ * host's cache); on success the source manager drops its pool record,
+ * console port and MAC reservations for the domain. While it
+ * blocks, a monitor polls virDomainGetJobStats on the same handle, hands
+ * progress to the caller, switches to post-copy when allowed and pre-copy
+ * did not converge in time, and aborts a pre-copy past its timeout.
+ * Slots per source, per target and cluster-wide bound how many run at once;
+ * a migration waits for its slots. drain() and rebalance() choose targets
+ * with the ClusterScheduler, so a lab moves as a whole whenever a host
+ * holds it, and run the moves concurrently within those limits.
+ */
+class MigrationManager {
+public:
+    using ProgressFn = std::function<void(const MigrationProgress&)>;
+
+    explicit MigrationManager(std::shared_ptr<HypervisorCluster> cluster, MigrationLimits limits = {});
+
+    MigrationManager(const MigrationManager&) = delete;
+    MigrationManager& operator=(const MigrationManager&) = delete;
+
+    // blocks until the domain runs on toHost or the migration failed
+    [[nodiscard]] MigrationResult migrate(const std::string& domain, const std::string& toHost,
+                                          const MigrationOptions& options = {}, const ProgressFn& progress = nullptr);
+
+    // every domain off host (maintenance); fails without moving anything if the others cannot hold them
+    [[nodiscard]] Result<std::vector<MigrationResult>> drain(const std::string& host, const MigrationOptions& options = {},
+                                                             const ProgressFn& progress = nullptr);
+
+    // hosts whose scheduler load exceeds highWater shed VMs (cheapest labs first) to the other hosts
+    [[nodiscard]] Result<std::vector<MigrationResult>> rebalance(double highWater = 0.85, const MigrationOptions& options = {},
+                                                                 const ProgressFn& progress = nullptr);
+
+    [[nodiscard]] std::vector<MigrationProgress> active() const;
+
+private:
+    struct Move {
+        std::string domain;
+        std::string to;
+    };
+
+    void acquireSlots(const std::string& from, const std::string& to);
+    void releaseSlots(const std::string& from, const std::string& to);
+    [[nodiscard]] std::vector<MigrationResult> runAll(const std::vector<Move>& moves, const MigrationOptions& options,
+                                                      const ProgressFn& progress);
+    // scheduler targets for domains, with `excluded` hosts treated as down
+    [[nodiscard]] Result<std::vector<Move>> plan(const std::vector<std::string>& domains, const std::vector<std::string>& excluded);
+    void publish(const MigrationProgress& p, const ProgressFn& progress);
+
+    std::shared_ptr<HypervisorCluster> cluster;
+    MigrationLimits limits;
+
+    mutable std::mutex mutex_;
+    std::condition_variable slotFreed;
+    std::map<std::string, unsigned int> outgoing;
+    std::map<std::string, unsigned int> incoming;
+    unsigned int running{0};
+    std::map<std::string, MigrationProgress> inFlight;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Core/interfaces/IDatabase.hpp"
+#include "Utils/Result.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Fleet-wide MAC address allocation with a collision index
+ *
+ * Addresses are locally administered unicast (first octet x2/x6/xA/xE).
+ * With a lab id the layout is deterministic per lab:
+ *   02:<lab hash 16 bit>:<24 random bits>
+ * so all NICs of a lab share a recognizable prefix; without one, 46 bits
+ * are random. Random bits come from a thread-local splitmix64 state seeded
+ * once per thread, and addresses are formatted into a fixed char buffer.
+ *
+ * Every assigned address is kept in an in-memory hash index (O(1)
+ * collision check) and, when a database is given, persisted as
+ *   mac/<12 hex digits> -> owner (domain name)
+ * and reloaded with one prefix scan at construction.
+ */
+class MacAllocator {
+public:
+    using Mac = std::uint64_t; // 48 bits, first octet in bits 47..40
+
+    explicit MacAllocator(std::shared_ptr<IRocksDB> db = nullptr);
+
+    // new unique address for owner; lab empty = fully random layout
+    [[nodiscard]] Result<std::string> allocate(const std::string& owner, std::string_view lab = {});
+    // records an address chosen elsewhere (user supplied, found during reconciliation);
+    // false if it is malformed or already held by another owner
+    [[nodiscard]] bool reserve(std::string_view mac, const std::string& owner);
+    void release(std::string_view mac);
+    void releaseOwner(const std::string& owner);
+
+    [[nodiscard]] bool contains(std::string_view mac) const;
+    [[nodiscard]] std::optional<std::string> ownerOf(std::string_view mac) const;
+    [[nodiscard]] std::size_t size() const;
+
+    // stateless helpers (no index): used where no allocator is wired in
+    [[nodiscard]] static std::string randomMac();
+    [[nodiscard]] static std::array<char, 18> format(Mac mac) noexcept; // "xx:xx:xx:xx:xx:xx\0"
+    [[nodiscard]] static std::optional<Mac> parse(std::string_view text) noexcept;
+
+private:
+    [[nodiscard]] static Mac candidate(std::string_view lab) noexcept;
+    [[nodiscard]] static std::string key(Mac mac);
+    // index only; caller holds the mutex
+    bool insertLocked(Mac mac, const std::string& owner);
+    void eraseLocked(Mac mac);
+
+    std::shared_ptr<IRocksDB> db;
+    mutable std::mutex mutex_;
+    std::unordered_map<Mac, std::string> owners;               // mac -> owner
+    std::unordered_map<std::string, std::vector<Mac>> byOwner; // owner -> macs
+};
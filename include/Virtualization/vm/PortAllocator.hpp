@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief Bitmap allocator for console (VNC/SPICE) ports
+ *
+ * One bit per port in [first, last]. reserve() scans 64 ports per step from a
+ * rotating cursor, so it is constant time for console-sized ranges and never
+ * touches a socket. Not thread-safe: the owner serializes access.
+ */
+class PortAllocator {
+public:
+    PortAllocator(std::uint16_t first, std::uint16_t last);
+
+    // Next free port, or nullopt when the range is exhausted
+    [[nodiscard]] std::optional<std::uint16_t> reserve() noexcept;
+    // Marks a specific port as used (reconciliation); false if out of range or already taken
+    bool reserve(std::uint16_t port) noexcept;
+    bool release(std::uint16_t port) noexcept;
+
+    [[nodiscard]] bool isReserved(std::uint16_t port) const noexcept;
+    [[nodiscard]] bool contains(std::uint16_t port) const noexcept { return port >= first && port <= last; }
+    [[nodiscard]] std::size_t available() const noexcept { return freeCount; }
+    [[nodiscard]] std::size_t capacity() const noexcept { return static_cast<std::size_t>(last - first) + 1; }
+    [[nodiscard]] std::uint16_t firstPort() const noexcept { return first; }
+    [[nodiscard]] std::uint16_t lastPort() const noexcept { return last; }
+
+    void clear() noexcept;
+
+private:
+    std::uint16_t first;
+    std::uint16_t last;
+    std::vector<std::uint64_t> words; // bit set = port in use
+    std::size_t cursor{0};            // word index to resume scanning from
+    std::size_t freeCount{0};
+};
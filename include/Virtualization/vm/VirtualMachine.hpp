@@ -13,6 +13,8 @@ public:
     enum class VmState { Running, Paused, Shutdown, Crashed, Suspended, Unknown };
 
     VirtualMachine(std::shared_ptr<HypervisorConnector> conn, std::string_view vmName);
+    // from a handle already looked up (DomainRegistry): takes its own reference, no libvirt round trip
+    VirtualMachine(std::shared_ptr<HypervisorConnector> conn, std::string_view vmName, virDomainPtr Dom);
     ~VirtualMachine();
 
     VirtualMachine(const VirtualMachine&) = delete;
@@ -31,6 +33,8 @@ public:
     [[nodiscard]] bool isActive() const;
     [[nodiscard]] virDomainPtr getRawHandle() const noexcept;
 
+    [[nodiscard]] static VmState mapLibvirtState(int state);
+
 private:
     std::shared_ptr<HypervisorConnector> connector;
     virDomainPtr domain {nullptr};
@@ -39,7 +43,6 @@ private:
 
     void refreshHandle();
     void checkLibvirtError(int result, const std::string& action);
-    static VmState mapLibvirtState(int state);
 
     int bootstrap();
 };
\ No newline at end of file
@@ -1,18 +1,22 @@
 #pragma once
 #include <libvirt/libvirt.h>
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
 #include <string>
 
 class VirtualMachineNic {
 public:
     VirtualMachineNic();
     explicit VirtualMachineNic(std::string mac);
+    // network, model and driver tuning from nic; a random MAC when it has none
+    explicit VirtualMachineNic(NetworkConfig nic);
     ~VirtualMachineNic();
 
     bool attach(virDomainPtr domain);
     bool detach(virDomainPtr domain);
     [[nodiscard]] std::string getMac() const noexcept;
+    [[nodiscard]] const NetworkConfig& config() const noexcept { return nic; }
 
 private:
-    std::string mac;
+    NetworkConfig nic;
     std::string generate_mac();
-};
\ No newline at end of file
+};
@@ -3,39 +3,111 @@
 #include "Core/interfaces/IDatabase.hpp"
 #include "Utils/Result.hpp"
 #include <boost/uuid/uuid_generators.hpp>
-#include <boost/asio.hpp>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <stdexcept>
+#include <vector>
+#include "Virtualization/vm/PortAllocator.hpp"
+#include "Virtualization/vm/VmMetadataStore.hpp"
 #include "Virtualization/vmm/HypervisorConnector.hpp"
 
+// انحراف السجلات عن libvirt كما وجده الـ reconciler عند التشغيل، يُطبَّق في commit واحد
+struct PoolRepair {
+    std::vector<int> stale;                 // records whose domain is gone
+    std::vector<VmRecord> adopted;          // domains without a record; ids are assigned here
+    std::vector<std::pair<int, int>> ports; // record id -> port its domain really listens on
+    std::vector<int> livePorts;             // port/tlsPort of every running domain, ours or not
+
+    [[nodiscard]] bool empty() const noexcept {
+        return stale.empty() && adopted.empty() && ports.empty() && livePorts.empty();
+    }
+};
+
 class VirtualMachinePool
 {
 public:
-    explicit VirtualMachinePool(std::shared_ptr<HypervisorConnector> connector);
+    explicit VirtualMachinePool(std::shared_ptr<HypervisorConnector> connector,
+                                std::uint16_t firstConsolePort = 5900,
+                                std::uint16_t lastConsolePort = 6000);
     ~VirtualMachinePool();
 
+    // console port arguments of allocate()/allocateBatch() besides an adopted port (> 0)
+    static constexpr int kAutoConsolePort = 0; // reserve one from the range here
+    static constexpr int kNoConsolePort = -1;  // no graphics, or a port only libvirt knows
+
     /**
-     * Allocate a new VM record and persist minimal metadata.
-     * Returns Result<int> where int is an internal oid (simulated).
+     * Allocate a new VM record and persist its metadata (vm/, uuid/, port/
+     * keys and the id counter) in one WriteBatch when a DB is attached.
+     * Returns Result<int> where int is the internal oid.
      */
-    [[nodiscard]] Result<int> allocate();
+    [[nodiscard]] Result<int> allocate(std::string_view name = {}, int consolePort = kAutoConsolePort);
+
+    // Allocates one record per name and persists all of them with a single group commit.
+    // consolePorts[i] > 0 adopts a port taken earlier with reserveConsolePort() or claimConsolePort(),
+    // kAutoConsolePort (the default for missing entries) reserves one here, kNoConsolePort records none.
+    // On failure every port of the batch, adopted ones included, is released.
+    [[nodiscard]] Result<std::vector<int>> allocateBatch(const std::vector<std::string>& names,
+                                                         const std::vector<int>& consolePorts = {});
+
+    // Port for a domain's graphics before its record exists (the XML is built before allocate); -1 when exhausted
+    [[nodiscard]] int reserveConsolePort();
+    // Marks a fixed graphics port taken so no autoport VM is handed it; a port outside the range has
+    // nothing to mark and is accepted as is; false when another VM holds it
+    [[nodiscard]] bool claimConsolePort(int port);
+    // Gives back a port from reserveConsolePort() or claimConsolePort() that never reached allocate()
+    void releaseConsolePort(int port);
+    // Console port recorded for a domain name (console proxy lookups)
+    [[nodiscard]] std::optional<std::uint16_t> consolePort(std::string_view name);
 
     [[nodiscard]] std::optional<std::pair<std::string,int>> getMeta(int id);
+    [[nodiscard]] std::optional<VmRecord> getRecord(int id);
+    [[nodiscard]] std::vector<VmRecord> records();
     bool remove(int id);
+    // the record of a domain name, with its console port (deletes, migrations away)
+    bool removeByName(std::string_view name);
+
+    /**
+     * Load every persisted record from the metadata store so the pool resumes
+     * where it stopped without asking libvirt. Returns the number of records
+     * loaded (0 without a DB).
+     */
+    int warmStart();
+
+    /**
+     * Startup reconciliation (see StartupReconciler): between the two calls
+     * allocate() and reserveConsolePort() wait, so no id or port is handed
+     * out before the records and libvirt agree. Reads are not held up.
+     */
+    void beginRecovery();
+    void endRecovery();
+    // applies the drift in one WriteBatch, then marks drift.livePorts and every persisted port/ key
+    // in use (an empty drift only sweeps the ports); returns the number of records touched
+    [[nodiscard]] Result<std::size_t> repair(const PoolRepair& drift);
+
+    [[nodiscard]] std::size_t availablePorts();
 
 private:
-    struct Entry { std::string uuid; int reservedPort{-1}; };
+    struct Entry { std::string uuid; int reservedPort{-1}; std::string name; };
 
     [[nodiscard]] std::string generate_uuid();
-    [[nodiscard]] int findAvailablePort(int startPort = 5900, int endPort = 6000);
+    [[nodiscard]] int reservePort();
+    void releasePort(int port);
+    [[nodiscard]] VmRecord toRecord(int id, const Entry& e) const;
+    void awaitRecovery(std::unique_lock<std::mutex>& lock);
 
     std::shared_ptr<HypervisorConnector> connector;
     std::shared_ptr<IRocksDB> db; // optional DB handle for persistence
+    std::unique_ptr<VmMetadataStore> store;
     std::map<int, Entry> entries;
+    PortAllocator ports;
     int nextId{1};
     std::mutex mutex_;
+    std::condition_variable recovered;
+    bool recovering{false};
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Core/interfaces/IDatabase.hpp"
+#include <expected>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct VmRecord {
+    int id{-1};
+    std::string uuid;
+    std::string name;
+    int consolePort{-1};
+};
+
+/**
+ * @brief Persistent VM metadata on top of IRocksDB
+ *
+ * Key schema (all values are plain text):
+ *   vm/<id:010>       -> uuid \x1f port \x1f name
+ *   uuid/<uuid>       -> id
+ *   port/<port>       -> id
+ *   meta/next_id      -> next id to hand out
+ *
+ * Ids are zero padded so a prefix scan of "vm/" returns records in id order.
+ * Every mutation of a record touches all of its index keys in one WriteBatch.
+ */
+class VmMetadataStore {
+public:
+    using Status = std::expected<void, rocksdb::Status>;
+
+    // Accumulates mutations for one group commit
+    class Batch {
+    public:
+        void put(const VmRecord& record);
+        void erase(const VmRecord& record);
+        void setNextId(int nextId);
+
+        [[nodiscard]] int size() const { return batch.Count(); }
+        [[nodiscard]] bool empty() const { return batch.Count() == 0; }
+
+    private:
+        friend class VmMetadataStore;
+        rocksdb::WriteBatch batch;
+    };
+
+    explicit VmMetadataStore(std::shared_ptr<IRocksDB> db);
+
+    [[nodiscard]] Status commit(Batch& batch);
+    [[nodiscard]] Status put(const VmRecord& record);
+    [[nodiscard]] Status erase(const VmRecord& record);
+
+    // Warm start: prefix scan of vm/ bounded by an upper key, no full-table iteration
+    [[nodiscard]] std::vector<VmRecord> loadAll() const;
+    [[nodiscard]] std::optional<int> loadNextId() const;
+    [[nodiscard]] std::optional<int> findIdByUuid(std::string_view uuid) const;
+    void forEachPort(const std::function<void(int port, int id)>& fn) const;
+
+    [[nodiscard]] static std::string vmKey(int id);
+    [[nodiscard]] static std::string uuidKey(std::string_view uuid);
+    [[nodiscard]] static std::string portKey(int port);
+
+private:
+    void scanPrefix(std::string_view prefix, const std::function<void(std::string_view key, std::string_view value)>& fn) const;
+
+    std::shared_ptr<IRocksDB> db;
+};
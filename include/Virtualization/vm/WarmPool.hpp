@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Utils/Result.hpp"
+#include "Virtualization/Storage/VirtualMachineStorageManager.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/ReadinessProber.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+
+class VirtualMachineManager;
+
+// قالب يُحتفظ منه بعدد من النسخ المُقلعة مسبقًا (paused) جاهزة للتسليم
+struct WarmPoolSpec {
+    std::string templateId;
+    VmConfig base;                    // name is ignored; each instance gets <templateId>-warm-<n>
+    std::string baseImage;            // optional: linked clone per instance from this base image
+    unsigned int targetSize{2};
+    std::string parkingNetwork{"penhive-warm"}; // isolated network warm instances boot on
+    std::chrono::seconds bootGrace{20};         // time the guest gets to boot before it is paused
+    // with the manager's ReadinessProber: paused once these pass instead of after bootGrace; empty = bootGrace
+    ReadinessSpec readiness{ReadinessSpec::none()};
+};
+
+struct WarmInstance {
+    std::string name;
+    int id{-1};
+    std::string parkingMac;           // NIC removed at handout
+    std::chrono::steady_clock::time_point readyAt;
+    VmConfig config;                  // set at handout: the template as wired, with the request's metadata
+};
+
+/**
+ * @brief Keeps N pre-booted, paused instances per template
+ *
+ * acquire() resumes an idle instance, swaps its parking NIC for the
+ * requested networks and returns it in well under a second. Refill runs in
+ * the background on the EventDispatcher: an instance is deployed, given
+ * bootGrace to come up (or, with the manager's ReadinessProber, probed until
+ * spec.readiness passes; one that never gets ready is discarded), then
+ * suspended and queued. Tasks capture `this`, so the pool must outlive the
+ * dispatcher's queue (shutdown() cancels pending pauses and deletes the
+ * instances still booting).
+ */
+class WarmPool {
+public:
+    WarmPool(VirtualMachineManager& manager,
+             std::shared_ptr<HypervisorConnector> connector,
+             std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+             std::shared_ptr<StorageOrchestrator> storage = nullptr);
+    ~WarmPool();
+
+    WarmPool(const WarmPool&) = delete;
+    WarmPool& operator=(const WarmPool&) = delete;
+
+    // Registers (or resizes) a template and starts filling it in the background
+    void registerTemplate(WarmPoolSpec spec);
+    void unregisterTemplate(std::string_view templateId);
+
+    /**
+     * Hands out a running instance wired to request.networks. A warm
+     * instance already has its name, disks and sizing, so only a request
+     * that leaves those to the template can use one: an unnamed request
+     * (the pool's name is returned) with no disks, and memory/vcpus of 0 or
+     * equal to the template's. request.metadata is carried into the
+     * returned config. Fails when the request doesn't fit, or with "warm
+     * pool empty" when nothing is ready; callers then deploy cold.
+     */
+    [[nodiscard]] Result<WarmInstance> acquire(std::string_view templateId, const VmConfig& request);
+
+    [[nodiscard]] std::size_t readyCount(std::string_view templateId) const;
+    // the base image instances of a template are cloned from (what a host should have cached); "" if none
+    [[nodiscard]] std::string baseImageOf(std::string_view templateId) const;
+
+    // Stops background refills and deletes instances still booting; instances already parked stay defined
+    void shutdown();
+
+private:
+    struct Slot {
+        WarmPoolSpec spec;
+        std::deque<WarmInstance> ready;
+        std::map<std::string, std::shared_ptr<CONCURRENCY::Timer>> booting; // name -> pause timer, nullptr while probed
+        unsigned int inFlight{0};
+        unsigned int sequence{0};
+    };
+
+    void scheduleRefill(const std::string& templateId);
+    void refillOne(const std::string& templateId);
+    void park(const std::string& templateId, WarmInstance inst);
+    void discard(const std::string& name);
+    [[nodiscard]] Result<WarmInstance> provision(const WarmPoolSpec& spec, const std::string& name);
+    [[nodiscard]] bool rewire(virDomainPtr domain, const WarmInstance& inst, const std::vector<NetworkConfig>& networks);
+
+    VirtualMachineManager& manager;
+    std::shared_ptr<HypervisorConnector> connector;
+    std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher;
+    std::shared_ptr<StorageOrchestrator> storage;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Slot, std::less<>> slots;
+    std::atomic<bool> stopping{false};
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include "Core/concurrency/TimerWheel.hpp"
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+
+// سياسة تقليص/توسيع الـ balloon؛ كل القيم نسبة إلى الذاكرة القصوى للـ VM ما لم يُذكر غير ذلك
+struct BalloonPolicy {
+    double headroom{0.20};              // guest keeps used * (1 + headroom) ...
+    std::uint64_t minFreeKiB{128 * 1024}; // ... and at least this much on top of what it uses
+    double floorFraction{0.40};         // never below this share of the maximum
+    double shrinkStep{0.10};            // at most this share of the maximum per pass: the guest gets time to react
+    double growBelow{0.10};             // usable < growBelow * current: give memory back at once
+    std::uint64_t hysteresisKiB{64 * 1024}; // smaller corrections are skipped
+    unsigned int statsPeriod{10};       // enabled on domains that do not report guest stats yet
+};
+
+// ما يعرفه الـ controller عن VM واحدة في كل دورة (بالـ KiB)
+struct BalloonSample {
+    std::uint64_t currentKiB{0};
+    std::uint64_t maximumKiB{0};
+    std::uint64_t usableKiB{0}; // usable without swapping; free memory on guests that do not report it
+    bool hasGuestStats{false};
+};
+
+struct BalloonPassStats {
+    std::size_t domains{0};
+    std::size_t withGuestStats{0};
+    std::size_t shrunk{0};
+    std::size_t grown{0};
+    std::size_t failed{0};
+    std::uint64_t reclaimedKiB{0}; // sum of maximum - current after the pass
+    std::chrono::milliseconds took{0};
+};
+
+/**
+ * @brief Background balloon driver that hands idle VMs' memory back to the host
+ *
+ * Every pass reads the balloon group of all running domains in one
+ * virConnectGetAllDomainStats call; that group carries the same guest
+ * counters as virDomainMemoryStats, without one RPC per domain. target()
+ * then sizes each balloon to what the guest uses plus headroom: idle
+ * guests shrink step by step down to the floor, and a guest that runs low
+ * on usable memory grows back in one go. Together with KSM merging the
+ * near-identical lab images, this is what lets a host run more lab VMs
+ * than its RAM would otherwise hold. Passes run on the Blocking lane via
+ * the shared timer wheel; a pass still running when the next is due makes
+ * the wheel skip that firing. Must be owned by a shared_ptr: the wheel job
+ * holds a weak reference, so a controller replaced or destroyed while a pass
+ * is queued is never touched.
+ */
+class BalloonController : public std::enable_shared_from_this<BalloonController> {
+public:
+    explicit BalloonController(std::shared_ptr<HypervisorConnector> connector, BalloonPolicy policy = {});
+    ~BalloonController();
+
+    BalloonController(const BalloonController&) = delete;
+    BalloonController& operator=(const BalloonController&) = delete;
+
+    void start(CONCURRENCY::TimerWheel& wheel, std::chrono::seconds interval = std::chrono::seconds(15));
+    void stop() noexcept;
+
+    [[nodiscard]] Result<BalloonPassStats> runOnce();
+    [[nodiscard]] BalloonPassStats lastPass() const;
+
+    void setPolicy(const BalloonPolicy& policy);
+    [[nodiscard]] BalloonPolicy getPolicy() const;
+
+    // new balloon size in KiB, or nullopt to leave it as it is
+    [[nodiscard]] static std::optional<std::uint64_t> target(const BalloonSample& sample, const BalloonPolicy& policy);
+
+private:
+    std::shared_ptr<HypervisorConnector> connector;
+    mutable std::mutex mutex_;
+    BalloonPolicy policy_;
+    BalloonPassStats last;
+    std::unordered_set<std::string> statsRequested; // domains we already asked for a stats period
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+};
@@ -0,0 +1,163 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Core/tracing/Trace.hpp"
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+#include "Virtualization/vmm/PlacementEngine.hpp"
+#include "resources/allocation/LabSliceManager.hpp"
+
+// حدود الـ admission control أمام عمليات النشر على هذا الـ host
+struct AdmissionOptions {
+    // define/start running at once; the rest wait in the tenant queues
+    unsigned int maxInFlight{4};
+    // deploys admitted and still waiting for a slot, over all tenants (full = 503)
+    std::size_t maxQueued{128};
+    // the same for one lab/tenant (full = 429)
+    std::size_t maxQueuedPerTenant{16};
+    // deploy time assumed for Retry-After until the first deploy was timed
+    std::chrono::milliseconds initialDeployTime{4000};
+    // Retry-After when the host or the lab is out of CPU/memory; only deletes free it
+    std::chrono::seconds capacityRetry{60};
+};
+
+// رفض مبكر لطلب نشر: السبب ومتى يُعاد الطلب
+struct AdmissionRejection {
+    enum class Reason { TenantQueueFull, TenantOverBudget, HostQueueFull, HostFull };
+    Reason reason{Reason::HostQueueFull};
+    std::chrono::seconds retryAfter{1};
+    std::string message;
+
+    // 429 when the tenant is over its own share, 503 when the host is
+    [[nodiscard]] bool tenantBound() const noexcept {
+        return reason == Reason::TenantQueueFull || reason == Reason::TenantOverBudget;
+    }
+};
+
+struct AdmissionStats {
+    unsigned int inFlight{0};
+    std::size_t queued{0};  // admitted, not started (tickets plus the tenant queues)
+    std::size_t tenants{0}; // tenants with something queued
+    std::uint64_t admitted{0};
+    std::uint64_t rejected{0};
+    std::chrono::milliseconds deployTime{0}; // moving average the estimates use
+};
+
+/**
+ * @brief Admission control and fair queuing in front of the deploy paths
+ *
+ * admit() decides at request time: a ticket, or a rejection with a
+ * Retry-After estimate when the tenant's queue or the host's queue is full,
+ * when the NUMA cells have no vCPU/memory left under the placement engine's
+ * overcommit limits, or when the lab's cgroup memory.max would be exceeded.
+ * The demand of admitted-but-unfinished deploys counts against both, so a
+ * burst cannot outrun the capacity check.
+ *
+ * start() queues the ticket's work per tenant (the lab of the VM, see
+ * LabSliceManager::labOf); at most maxInFlight define/start run on the
+ * Blocking lane at once and free slots go round-robin over the tenants, so
+ * one lab clicking "start" 200 times does not push everyone else's deploy
+ * behind its own. Queued work holds no thread. run() is for callers that
+ * already own a blocking thread (an RPC batch): the work runs there at once
+ * and is counted in flight, so queued work waits for it.
+ *
+ * Retry-After is (deploys ahead / maxInFlight + 1) times a moving average of
+ * the deploy duration. The admission has to outlive its tickets and queued work.
+ */
+class DeployAdmission {
+public:
+    using Work = std::function<void()>;
+
+    // a place in a tenant's queue; dropping it unstarted gives the place back
+    class Ticket {
+    public:
+        Ticket() = default;
+        Ticket(Ticket&& other) noexcept;
+        Ticket& operator=(Ticket&& other) noexcept;
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+        ~Ticket();
+
+        [[nodiscard]] const std::string& tenant() const noexcept { return tenant_; }
+        explicit operator bool() const noexcept { return owner != nullptr; }
+
+    private:
+        friend class DeployAdmission;
+        DeployAdmission* owner{nullptr};
+        std::string tenant_;
+        unsigned int vcpus{0};
+        unsigned long long memoryKiB{0};
+    };
+
+    explicit DeployAdmission(std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher, AdmissionOptions options = {});
+    ~DeployAdmission();
+    DeployAdmission(const DeployAdmission&) = delete;
+    DeployAdmission& operator=(const DeployAdmission&) = delete;
+
+    // capacity sources for admit(); either may be null
+    void setCapacitySources(std::shared_ptr<PlacementEngine> placement, std::shared_ptr<LabSliceManager> slices);
+
+    [[nodiscard]] Result<Ticket, AdmissionRejection> admit(const VmConfig& cfg);
+    // work runs on the Blocking lane when the tenant's turn comes
+    void start(Ticket ticket, Work work);
+    // work runs on the calling thread now
+    void run(Ticket ticket, const Work& work);
+
+    [[nodiscard]] AdmissionStats stats() const;
+    [[nodiscard]] const AdmissionOptions& options() const noexcept { return opts; }
+
+    // queue key of a VM: its lab/tenant, "" for VMs outside any lab
+    [[nodiscard]] static std::string tenantOf(const VmConfig& cfg);
+
+private:
+    struct Pending {
+        Ticket ticket;
+        Work work;
+        TRACING::TraceContext trace; // of the request; the work starts on whatever thread frees a slot
+    };
+
+    struct Tenant {
+        std::size_t admitted{0};             // tickets plus queued, not yet started
+        unsigned long long memoryKiB{0};     // demand admitted and not finished
+        std::deque<Pending> queue;
+    };
+    // nothing admitted, queued or running: the entry can go
+    [[nodiscard]] static bool idle(const Tenant& t) noexcept { return t.admitted == 0 && t.memoryKiB == 0 && t.queue.empty(); }
+
+    [[nodiscard]] std::optional<AdmissionRejection> check(const VmConfig& cfg, const std::string& tenant);
+    [[nodiscard]] std::chrono::seconds estimate(std::size_t ahead) const;
+    // takes the next works in round-robin order while slots are free; called with mutex_ held
+    [[nodiscard]] std::vector<Pending> takeRunnable();
+    void launch(std::vector<Pending> runnable);
+    void finished(const std::string& tenant, unsigned int vcpus, unsigned long long memoryKiB,
+                  std::chrono::steady_clock::duration took);
+    // gives back the demand of a ticket that never started
+    void drop(Ticket& ticket) noexcept;
+
+    std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher_;
+    AdmissionOptions opts;
+    std::shared_ptr<PlacementEngine> placement; // atomic_load/atomic_store
+    std::shared_ptr<LabSliceManager> slices;    // atomic_load/atomic_store
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Tenant> tenants;
+    std::deque<std::string> turns; // tenants with queued work, next first
+    std::size_t queued{0};
+    unsigned int inFlight{0};
+    unsigned long long pendingVcpus{0};
+    unsigned long long pendingMemoryKiB{0};
+    double deployMs{0.0};
+    std::uint64_t admittedTotal{0};
+    std::uint64_t rejectedTotal{0};
+    std::vector<std::uint64_t> gaugeIds;
+};
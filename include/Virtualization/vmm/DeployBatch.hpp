@@ -0,0 +1,82 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Core/tracing/Trace.hpp"
+#include "Virtualization/vmm/DeployAdmission.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+
+// توقيت كل مرحلة من مراحل نشر مجموعة VMs (lab)
+struct DeployStageTimings {
+    std::chrono::milliseconds buildXml{0};
+    std::chrono::milliseconds define{0};
+    std::chrono::milliseconds allocate{0};
+    std::chrono::milliseconds start{0};
+    std::chrono::milliseconds total{0};
+    std::vector<std::chrono::milliseconds> waves; // start time of each dependency wave
+};
+
+// نتيجة نشر VM واحدة داخل الدفعة
+struct DeployOutcome {
+    std::string name;
+    int id{-1};
+    unsigned int wave{0};
+    std::string error;
+    std::string host; // cluster host it was deployed on; empty on a single host
+    // set when admission control refused the VM: tenantBound() is a 429, otherwise a 503
+    std::optional<AdmissionRejection> rejection;
+
+    [[nodiscard]] bool ok() const noexcept { return error.empty() && id >= 0; }
+};
+
+struct DeployBatchResult {
+    std::vector<DeployOutcome> outcomes; // same order as the input configs
+    DeployStageTimings timings;
+
+    [[nodiscard]] std::size_t succeeded() const noexcept;
+    [[nodiscard]] std::size_t failed() const noexcept;
+};
+
+/**
+ * @brief Start wave of a VM inside a lab deployment
+ *
+ * metadata["wave"] wins when it holds a number. Otherwise infrastructure
+ * roles (metadata["role"] = router, switch, firewall, dhcp, dns) boot in
+ * wave 0 and every other VM in wave 1.
+ */
+[[nodiscard]] unsigned int deployWaveOf(const VmConfig& cfg) noexcept;
+
+// يشغّل fn(i) لكل i في [0, count) على width خيط كحد أقصى وينتظر انتهاءها
+// (threads are spawned per stage on purpose: waiting on our own dispatcher from a dispatcher thread would deadlock)
+// when fn(i) throws, onError(i, what) records it for that item; onError itself must not throw
+template <typename Fn, typename OnError>
+void parallelFor(std::size_t count, std::size_t width, Fn&& fn, OnError&& onError) {
+    if (count == 0) return;
+    width = std::clamp<std::size_t>(width, 1, count);
+    std::atomic<std::size_t> next{0};
+    // spawned threads join the caller's trace, so their libvirt spans nest under the batch
+    const auto trace = TRACING::TraceContext::current();
+    auto worker = [&]() {
+        TRACING::ContextScope scope(trace);
+        for (std::size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            try {
+                fn(i);
+            } catch (const std::exception& e) {
+                onError(i, std::string(e.what()));
+            } catch (...) {
+                onError(i, std::string("unknown exception"));
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(width - 1);
+    for (std::size_t t = 1; t < width; ++t) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <libvirt/libvirt.h>
+
+/**
+ * @brief One live domain handle, shared by everyone looking the VM up
+ *
+ * Owns one libvirt reference; whoever needs the virDomainPtr beyond the
+ * lifetime of the shared_ptr takes its own with virDomainRef.
+ */
+class DomainHandle {
+public:
+    // adopts one reference on domain
+    DomainHandle(virDomainPtr domain, std::string name, std::string uuid) noexcept
+        : domain_(domain), name_(std::move(name)), uuid_(std::move(uuid)) {}
+    ~DomainHandle() { if (domain_) virDomainFree(domain_); }
+
+    DomainHandle(const DomainHandle&) = delete;
+    DomainHandle& operator=(const DomainHandle&) = delete;
+
+    [[nodiscard]] virDomainPtr get() const noexcept { return domain_; }
+    [[nodiscard]] const std::string& name() const noexcept { return name_; }
+    [[nodiscard]] const std::string& uuid() const noexcept { return uuid_; }
+
+private:
+    virDomainPtr domain_;
+    std::string name_;
+    std::string uuid_;
+};
+
+using DomainHandlePtr = std::shared_ptr<const DomainHandle>;
+
+/**
+ * @brief Live domain handles by name and by uuid, sharded for read-mostly traffic
+ *
+ * Every find, list and delete used to take the manager's single mutex and
+ * then pay a virDomainLookupByName round trip. Here each key hashes to one
+ * of a fixed number of shards, each behind its own shared_mutex: dashboard
+ * lookups take a shared lock on one shard and copy a shared_ptr, and a
+ * deploy only excludes readers of the shard its name lands in. Handles are
+ * inserted when a domain is defined, or the first time a lookup misses,
+ * and erased when the domain is undefined (by us, or reported Removed by
+ * DomainStateCache).
+ */
+class DomainRegistry {
+public:
+    explicit DomainRegistry(std::size_t shards = 16);
+
+    DomainRegistry(const DomainRegistry&) = delete;
+    DomainRegistry& operator=(const DomainRegistry&) = delete;
+
+    [[nodiscard]] DomainHandlePtr find(std::string_view name) const;
+    [[nodiscard]] DomainHandlePtr findByUuid(std::string_view uuid) const;
+
+    // takes its own reference on domain (the caller still frees its pointer); replaces an older handle
+    // of the same name. Returns nullptr if libvirt cannot name the domain
+    DomainHandlePtr insert(virDomainPtr domain);
+    void erase(std::string_view name);
+    void clear();
+    [[nodiscard]] std::size_t size() const noexcept { return count.load(std::memory_order_relaxed); }
+
+    struct Stats {
+        std::uint64_t hits{0};
+        std::uint64_t misses{0};
+    };
+    [[nodiscard]] Stats stats() const noexcept { return {hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed)}; }
+
+private:
+    struct KeyHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view key) const noexcept { return std::hash<std::string_view>{}(key); }
+    };
+    using Map = std::unordered_map<std::string, DomainHandlePtr, KeyHash, std::equal_to<>>;
+
+    struct Shard {
+        mutable std::shared_mutex mutex_;
+        Map entries;
+    };
+
+    Shard& shardOf(std::vector<Shard>& shards, std::string_view key) const noexcept;
+    const Shard& shardOf(const std::vector<Shard>& shards, std::string_view key) const noexcept;
+    DomainHandlePtr lookup(const std::vector<Shard>& shards, std::string_view key) const;
+
+    std::vector<Shard> byName;
+    std::vector<Shard> byUuid;
+    std::atomic<std::size_t> count{0};
+    mutable std::atomic<std::uint64_t> hits{0};
+    mutable std::atomic<std::uint64_t> misses{0};
+};
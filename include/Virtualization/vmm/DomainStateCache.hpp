@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <libvirt/libvirt.h>
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Virtualization/vm/VirtualMachine.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+
+struct DomainStateEntry {
+    std::string name;
+    std::string uuid;
+    VirtualMachine::VmState state{VirtualMachine::VmState::Unknown};
+    int reason{0};
+    std::chrono::steady_clock::time_point updatedAt;
+};
+
+// تغيير حالة domain كما وصل من libvirt أو من المزامنة الدورية
+struct DomainStateEvent {
+    enum class Kind { Updated, Removed };
+    Kind kind{Kind::Updated};
+    DomainStateEntry entry;
+    VirtualMachine::VmState previous{VirtualMachine::VmState::Unknown};
+};
+
+/**
+ * @brief In-memory view of every domain's lifecycle state
+ *
+ * Fed by virConnectDomainEventRegisterAny lifecycle callbacks on a dedicated
+ * event connection. A slow periodic reconciliation (one bulk
+ * virConnectListAllDomains call) repairs anything missed while the event
+ * connection was down. When libvirt closes that connection (daemon
+ * restart, keepalive timeout) it is reopened from the dispatcher, retried
+ * every few seconds, and isEventDriven() is false until it is back. Reads
+ * never touch libvirt.
+ *
+ * Must be owned by a shared_ptr: the reconcile timer only holds a weak
+ * reference. The process-wide libvirt event loop thread runs while at least
+ * one cache is started and exits when the last one stops.
+ */
+class DomainStateCache : public std::enable_shared_from_this<DomainStateCache> {
+public:
+    using Listener = std::function<void(const DomainStateEvent&)>;
+
+    DomainStateCache(std::shared_ptr<HypervisorConnector> connector,
+                     std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                     std::chrono::seconds reconcileInterval = std::chrono::seconds(60));
+    ~DomainStateCache();
+
+    DomainStateCache(const DomainStateCache&) = delete;
+    DomainStateCache& operator=(const DomainStateCache&) = delete;
+
+    // Opens the event connection, registers callbacks and seeds the cache; throws LibvirtException
+    void start();
+    void stop() noexcept;
+
+    // Full bulk resync against libvirt; returns number of domains seen, or -1 on failure
+    int reconcile();
+
+    [[nodiscard]] std::optional<DomainStateEntry> get(std::string_view name) const;
+    [[nodiscard]] std::optional<DomainStateEntry> getByUuid(std::string_view uuid) const;
+    [[nodiscard]] std::vector<DomainStateEntry> list() const;
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] bool isEventDriven() const noexcept { return callbackId.load() >= 0; }
+
+    // Listeners run on the libvirt event thread (or a dispatcher thread during reconciliation); keep them short
+    [[nodiscard]] std::uint64_t subscribe(Listener listener);
+    void unsubscribe(std::uint64_t id);
+
+private:
+    static int lifecycleCallback(virConnectPtr conn, virDomainPtr dom, int event, int detail, void* opaque);
+    static void closeCallback(virConnectPtr conn, int reason, void* opaque);
+    void onLifecycle(virDomainPtr dom, int event, int detail);
+
+    // both called with lifecycleMutex held; open throws LibvirtException and leaves nothing behind
+    void openEventConnection();
+    void closeEventConnection() noexcept;
+    void reconnect();
+    void scheduleReconnect(); // called with lifecycleMutex held
+
+    // reconcile passes the time its listing began: entries an event updated after that are newer than the listing
+    using TimePoint = std::chrono::steady_clock::time_point;
+    void upsert(DomainStateEntry entry, TimePoint listedAt = TimePoint::max());
+    void erase(const std::string& name, TimePoint listedAt = TimePoint::max());
+    void notify(const DomainStateEvent& ev);
+    void scheduleReconcile();
+
+    std::shared_ptr<HypervisorConnector> connector;
+    std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher;
+    std::chrono::seconds reconcileInterval;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, DomainStateEntry> byName;
+    std::unordered_map<std::string, std::string> uuidToName;
+    std::unordered_map<std::string, TimePoint> erasedAt; // undefine events newer than the oldest running listing
+
+    std::mutex listenerMutex;
+    std::vector<std::pair<std::uint64_t, Listener>> listeners;
+    std::uint64_t nextListenerId{1};
+
+    std::mutex lifecycleMutex;
+    virConnectPtr eventConn{nullptr};
+    std::atomic<int> callbackId{-1};
+    std::shared_ptr<CONCURRENCY::Timer> reconcileTimer;
+    std::shared_ptr<CONCURRENCY::Timer> reconnectTimer;
+    std::atomic<bool> running{false};
+};
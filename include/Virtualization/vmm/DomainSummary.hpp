@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <libvirt/libvirt.h>
+#include "Utils/Result.hpp"
+#include "Virtualization/vm/VirtualMachine.hpp"
+
+// لقطة خفيفة لحالة domain (بدون مقبض libvirt) مناسبة للوحة التحكم والقوائم
+struct DomainSummary {
+    std::string name;
+    std::string uuid;
+    VirtualMachine::VmState state{VirtualMachine::VmState::Unknown};
+    int stateReason{0};
+    unsigned int vcpus{0};
+    unsigned int maxVcpus{0};
+    unsigned long long memoryKiB{0};    // current balloon size
+    unsigned long long maxMemoryKiB{0};
+    unsigned long long cpuTimeNs{0};
+    bool active{false};
+};
+
+/**
+ * @brief Collects summaries for every domain in one round trip
+ *
+ * Uses virConnectGetAllDomainStats (state, cpu, balloon, vcpu groups).
+ * Falls back to virConnectListAllDomains + virDomainGetInfo on daemons that
+ * do not support bulk stats. listFlags takes VIR_CONNECT_LIST_DOMAINS_* bits;
+ * 0 means active and inactive domains.
+ */
+[[nodiscard]] Result<std::vector<DomainSummary>> collectDomainSummaries(virConnectPtr conn, unsigned int listFlags = 0);
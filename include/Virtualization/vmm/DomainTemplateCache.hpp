@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+
+// &, <, >, ' and " for text and single/double-quoted attributes
+void appendXmlEscaped(std::string& out, std::string_view value);
+
+/**
+ * @brief Domain XML pre-rendered once, with the per-instance fields left as slots
+ *
+ * compile() renders a prototype whose per-instance fields (name, uuid, disk
+ * sources, MACs, graphics port, CPU placement, resource partition) hold sentinel markers and
+ * splits the output into literal runs and slots. render() then only appends
+ * the runs and the escaped instance values into one pre-sized string: no
+ * stream, no DOM. A config that differs from the prototype in anything that
+ * is not a slot (memory, vcpus, disk count, network sources, ...) does not
+ * match() and needs its own template.
+ */
+class DomainTemplate {
+public:
+    using DomainWriter = void (*)(std::string& out, const VmConfig& cfg);
+    using PlacementWriter = void (*)(std::string& out, const CpuPlacement& placement, const MemoryTuning& memory);
+
+    enum class Slot : std::uint8_t { Name, Uuid, Placement, DiskSource, Mac, GraphicsPort, Partition };
+
+    [[nodiscard]] static Result<DomainTemplate> compile(const VmConfig& prototype, DomainWriter writeDomain, PlacementWriter writePlacement);
+
+    [[nodiscard]] bool matches(const VmConfig& cfg) const;
+    void render(std::string& out, const VmConfig& cfg) const;
+
+    [[nodiscard]] std::size_t slotCount() const noexcept { return parts.size(); }
+
+private:
+    struct Part {
+        std::string literal; // text before the slot
+        Slot slot{Slot::Name};
+        std::uint32_t index{0};
+    };
+
+    VmConfig shape;        // prototype with the slot fields cleared
+    std::vector<Part> parts;
+    std::string tail;      // text after the last slot
+    std::size_t literalBytes{0};
+    PlacementWriter writePlacement{nullptr};
+};
+
+/**
+ * @brief Templates by template id, shared by all deploys of that template
+ *
+ * A lookup takes a shared lock; a miss (or a config whose shape no longer
+ * matches the cached template) compiles from the config itself and replaces
+ * the entry. Call invalidate() when a template definition changes.
+ */
+class DomainTemplateCache {
+public:
+    DomainTemplateCache(DomainTemplate::DomainWriter writeDomain, DomainTemplate::PlacementWriter writePlacement);
+
+    [[nodiscard]] Result<std::string> render(std::string_view templateId, const VmConfig& cfg);
+    void invalidate(std::string_view templateId);
+    void clear();
+
+    struct Stats {
+        std::uint64_t hits{0};
+        std::uint64_t compiles{0};
+    };
+    [[nodiscard]] Stats stats() const noexcept { return {hits.load(std::memory_order_relaxed), compiles.load(std::memory_order_relaxed)}; }
+
+private:
+    DomainTemplate::DomainWriter writeDomain;
+    DomainTemplate::PlacementWriter writePlacement;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const DomainTemplate>> templates;
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> compiles{0};
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <libvirt/libvirt.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Fixed-size pool of libvirt connections to a single URI
+ *
+ * Connections are opened lazily up to the configured capacity. A handle is
+ * checked out through a Lease and returned to the pool when the lease goes
+ * out of scope. Idle handles are probed with virConnectIsAlive on checkout
+ * and transparently reopened when the daemon dropped them.
+ *
+ * Always held by shared_ptr: leases keep the pool alive until they are returned.
+ */
+class HypervisorConnectionPool : public std::enable_shared_from_this<HypervisorConnectionPool> {
+public:
+    /**
+     * @brief RAII checkout of one pooled connection
+     *
+     * Call invalidate() after a connection-level failure so the handle is
+     * closed on checkin instead of being handed to the next caller.
+     */
+    class Lease {
+    public:
+        Lease() = default;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+
+        [[nodiscard]] virConnectPtr get() const noexcept { return conn; }
+        [[nodiscard]] explicit operator bool() const noexcept { return conn != nullptr; }
+
+        void invalidate() noexcept { broken = true; }
+
+    private:
+        friend class HypervisorConnectionPool;
+        Lease(std::shared_ptr<HypervisorConnectionPool> pool, virConnectPtr conn) noexcept
+            : pool(std::move(pool)), conn(conn) {}
+
+        void release() noexcept;
+
+        std::shared_ptr<HypervisorConnectionPool> pool;
+        virConnectPtr conn{nullptr};
+        bool broken{false};
+    };
+
+    HypervisorConnectionPool(std::string uri, std::size_t capacity);
+    ~HypervisorConnectionPool();
+
+    HypervisorConnectionPool(const HypervisorConnectionPool&) = delete;
+    HypervisorConnectionPool& operator=(const HypervisorConnectionPool&) = delete;
+
+    // Blocks until a handle is available; throws LibvirtException if opening fails
+    [[nodiscard]] Lease acquire();
+
+    // Same as acquire() but gives up after timeout
+    [[nodiscard]] std::optional<Lease> tryAcquire(std::chrono::milliseconds timeout);
+
+    // Closes idle handles and rejects further checkouts; outstanding leases close on checkin
+    void close() noexcept;
+
+    [[nodiscard]] const std::string& getUri() const noexcept { return uri; }
+    [[nodiscard]] std::size_t capacity() const noexcept { return maxSize; }
+    [[nodiscard]] std::size_t idleCount() const;
+    [[nodiscard]] std::size_t openCount() const;
+
+private:
+    [[nodiscard]] Lease checkoutLocked(std::unique_lock<std::mutex>& lock);
+    [[nodiscard]] virConnectPtr openOrThrow();
+    void checkin(virConnectPtr conn, bool broken) noexcept;
+
+    const std::string uri;
+    const std::size_t maxSize;
+
+    mutable std::mutex mutex_;
+    std::condition_variable available;
+    std::vector<virConnectPtr> idle;
+    std::size_t opened{0};
+    bool closed{false};
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Core/concurrency/Offload.hpp"
+#include "Core/concurrency/TimerWheel.hpp"
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/DomainStateCache.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/UsageCollector.hpp"
+
+// متى تُعتبر VM خاملة وماذا يُفعل بها؛ 0 في أي مدة = المرحلة معطلة
+struct IdlePolicy {
+    std::chrono::seconds pauseAfter{std::chrono::minutes(30)}; // virDomainSuspend: frees the CPU, resumes in milliseconds
+    std::chrono::seconds saveAfter{std::chrono::hours(2)};     // virDomainManagedSave on top: frees the RAM as well
+    double cpuThreshold{0.03}; // busy above this share of its vCPUs (guests tick even when idle)
+    // with a UsageCollector feeding observe(): disk + network traffic that also counts as activity; 0 = CPU only
+    double ioBytesPerSecond{32.0 * 1024};
+};
+
+struct IdleStats {
+    std::size_t tracked{0};
+    std::size_t paused{0};
+    std::size_t saved{0};
+    std::uint64_t resumes{0};
+    std::uint64_t coalescedResumes{0}; // callers that waited on a resume someone else started
+};
+
+/**
+ * @brief Suspends idle lab VMs and brings them back on first touch
+ *
+ * A pass on the timer wheel reads cpu.time of every active domain in one
+ * virConnectGetAllDomainStats call. A domain is active while it uses more
+ * than cpuThreshold of its vCPUs, or while touch()/ensureRunning() mark it
+ * (console sessions, API calls). After pauseAfter without activity it is
+ * paused; after saveAfter more it is managed-saved, so its memory goes
+ * back to the host too. Only domains suspended here are resumed here; a
+ * state change seen by the DomainStateCache (someone resumed or deleted it)
+ * drops the mark. observe() takes the UsageCollector's shorter passes in
+ * between: a CPU burst the pass average would hide, or disk and network
+ * traffic (an SSH session, a download), keeps the VM active too.
+ *
+ * ensureRunning() is what callers use before talking to a VM: a running VM
+ * costs one map lookup; for a suspended one the first caller resumes it and
+ * everyone who arrives meanwhile waits on the same shared future. Console
+ * input and SSH sessions reach touch() through VirtualMachineManager::touch().
+ *
+ * Must be owned by a shared_ptr: the wheel job and the state listener hold
+ * weak references, so a replaced or destroyed suspender is never touched.
+ */
+class IdleSuspender : public std::enable_shared_from_this<IdleSuspender> {
+public:
+    IdleSuspender(std::shared_ptr<HypervisorConnector> connector,
+                  std::shared_ptr<DomainStateCache> states,
+                  std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                  IdlePolicy policy = {});
+    ~IdleSuspender();
+
+    IdleSuspender(const IdleSuspender&) = delete;
+    IdleSuspender& operator=(const IdleSuspender&) = delete;
+
+    void start(CONCURRENCY::TimerWheel& wheel, std::chrono::seconds interval = std::chrono::seconds(60));
+    void stop() noexcept;
+
+    // activity without a resume (e.g. a console frame from a running VM)
+    void touch(std::string_view domain);
+    // one UsageCollector pass: VMs over cpuThreshold or ioBytesPerSecond count as touched
+    void observe(const std::vector<DomainUsage>& round);
+    // resumes the domain if it was suspended here; concurrent callers share one resume
+    [[nodiscard]] Result<void> ensureRunning(std::string_view domain);
+    [[nodiscard]] CONCURRENCY::Offload<Result<void>> co_ensureRunning(std::string domain);
+
+    // never suspended (routers, DHCP servers, ... that other VMs depend on)
+    void setExempt(const std::string& domain, bool exempt = true);
+    void forget(const std::string& domain);
+
+    // one detection pass (what the wheel runs); returns the number of domains suspended
+    [[nodiscard]] Result<std::size_t> runOnce();
+    [[nodiscard]] IdleStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    enum class Suspended { No, Paused, Saved };
+
+    struct Entry {
+        std::uint64_t cpuNs{0};
+        Clock::time_point sampledAt{};
+        Clock::time_point lastActive{};
+        Suspended suspended{Suspended::No};
+        Clock::time_point suspendedAt{};
+        std::shared_future<Result<void>> resuming; // valid while a resume is in flight
+    };
+
+    [[nodiscard]] Result<void> doResume(const std::string& domain, Suspended how);
+    void onState(const DomainStateEvent& ev);
+
+    std::shared_ptr<HypervisorConnector> connector;
+    std::shared_ptr<DomainStateCache> states;
+    std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher;
+    IdlePolicy policy;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_set<std::string> exempt;
+    std::uint64_t resumes{0};
+    std::uint64_t coalesced{0};
+    std::uint64_t subscription{0};
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+};
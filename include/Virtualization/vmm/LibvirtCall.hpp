@@ -0,0 +1,50 @@
+#pragma once
+#include <libvirt/libvirt.h>
+#include <type_traits>
+#include "Core/metrics/Metrics.hpp"
+#include "Core/tracing/Trace.hpp"
+
+namespace LIBVIRT {
+
+// per call site: the API name and its latency series, looked up once
+struct CallSite {
+    explicit CallSite(const char* api) : api(api), latency(METRICS::libvirtCall(api)) {}
+    const char* api;
+    METRICS::Histogram& latency;
+};
+
+// virGetLastError() into penhive_libvirt_errors_total{api,code} and the span
+void recordFailure(const CallSite& site, TRACING::Span& span);
+
+template <typename R>
+[[nodiscard]] constexpr bool failed(const R& r) noexcept {
+    if constexpr (std::is_pointer_v<R>) return r == nullptr;
+    else return r < 0;
+}
+
+/**
+ * @brief Runs one libvirt call with latency, error and span recording
+ *
+ * The span is a client span under the caller's trace (the API request,
+ * via the dispatcher), so a slow deploy shows how much of it was
+ * virDomainCreate (qemu starting) and how much was ours. Use the macro,
+ * which keeps one CallSite per call site:
+ *
+ *   virDomainPtr dom = LIBVIRT_CALL(virDomainDefineXML, conn, xml.c_str());
+ */
+template <typename F>
+auto call(const CallSite& site, F&& fn) {
+    TRACING::Span span(site.api, TRACING::SpanKind::Client);
+    METRICS::ScopedTimer timer(site.latency);
+    auto result = fn();
+    if (failed(result)) recordFailure(site, span);
+    return result;
+}
+
+} // namespace LIBVIRT
+
+#define LIBVIRT_CALL(api, ...)                                                       \
+    ::LIBVIRT::call([]() -> const ::LIBVIRT::CallSite& {                             \
+        static const ::LIBVIRT::CallSite site(#api);                                 \
+        return site;                                                                 \
+    }(), [&] { return api(__VA_ARGS__); })
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/SegmentAllocator.hpp"
+
+// كيف تمتد مقاطع المختبر (ph-<lab>-...) بين الأجهزة المضيفة
+struct FabricOptions {
+    enum class Mode { Isolated, Vlan, Vxlan };
+    Mode mode{Mode::Isolated};
+
+    // Vlan: an Open vSwitch bridge whose uplink trunks between the hosts; each segment is one tag
+    std::string ovsBridge{"br-penhive"};
+    unsigned int vlanFirst{100};
+    unsigned int vlanLast{3999};
+
+    // Vxlan: a kernel bridge plus a vxlan device per segment, built over netlink
+    std::string underlay;           // host interface that carries the tunnels, e.g. "eth1"
+    std::string multicastGroup;     // IPv4 group for BUM traffic; empty = head-end replication to peers
+    std::vector<std::string> peers; // underlay IPv4 addresses of the other hosts (unicast mode)
+    unsigned short vxlanPort{4789};
+};
+
+/**
+ * @brief Creates and removes the libvirt networks behind lab segments
+ *
+ * A lab segment is a libvirt network named ph-<lab>-<segment>, drawn as a
+ * switch or a point-to-point cable in networkDesigner.js. ensure() creates
+ * the missing ones lazily, right before the first NIC is attached or a VM
+ * is deployed on them, and a lab's networks are garbage-collected when its
+ * last VM is deleted (or explicitly by releaseLab()).
+ *
+ *   Isolated  no <forward>: an L2 segment on this host only
+ *   Vlan      OVS bridge + <vlan><tag>
+ *   Vxlan     bridge phb<vni> + vxlan device phv<vni>
+ *
+ * Tags and VNIs come from a SegmentAllocator: give the fabrics of all hosts
+ * the one on the cluster database and a segment maps to the same tag/tunnel
+ * everywhere, with no two segments sharing one. The name hash is only where
+ * the search for a free id starts. Ids of segments defined before the
+ * allocator knew them (read from the networks libvirt has) are adopted the
+ * first time the fabric is used.
+ *
+ * libvirt has no batch call: the define/create of one ensure() run in
+ * parallel over the connection pool. The vxlan links of one ensure() go to
+ * the kernel as one netlink batch (bridges, then tunnels and peer FDB
+ * entries), each request acked on its own.
+ */
+class NetworkFabric {
+public:
+    // segments = nullptr: ids private to this fabric (one host)
+    explicit NetworkFabric(std::shared_ptr<HypervisorConnector> connector, FabricOptions options = {},
+                           std::shared_ptr<SegmentAllocator> segments = nullptr);
+
+    [[nodiscard]] static std::string labPrefix(std::string_view lab);
+    [[nodiscard]] static bool isLabNetwork(std::string_view network) noexcept;
+    [[nodiscard]] static unsigned int vniOf(std::string_view network) noexcept;
+
+    // one error per name, "" = the network exists and is running
+    [[nodiscard]] std::vector<std::string> ensure(const std::vector<std::string>& networks);
+    [[nodiscard]] std::vector<std::string> remove(const std::vector<std::string>& networks);
+    // every ph-<lab>- network on this host; returns how many were removed
+    [[nodiscard]] Result<std::size_t> releaseLab(std::string_view lab);
+
+    // lab membership, for garbage collection when a lab's last domain goes away
+    void retain(const std::string& lab, const std::string& domain);
+    // the lab whose last domain this was, if any
+    [[nodiscard]] std::optional<std::string> release(const std::string& domain);
+
+    [[nodiscard]] const FabricOptions& options() const noexcept { return opts; }
+
+private:
+    [[nodiscard]] std::string networkXml(const std::string& name, unsigned int id) const;
+    // the tag (Vlan) or VNI (Vxlan) of the segment, allocated on first use
+    [[nodiscard]] Result<unsigned int> segmentId(const std::string& name);
+    void seedSegments();
+    void releaseSegments(const std::vector<std::string>& networks);
+    [[nodiscard]] std::vector<std::string> createLinks(const std::vector<std::string>& networks,
+                                                       const std::vector<unsigned int>& vnis);
+    // returns the networks whose links are still there
+    [[nodiscard]] std::set<std::string> deleteLinks(const std::vector<std::string>& networks);
+
+    std::shared_ptr<HypervisorConnector> connector;
+    FabricOptions opts;
+    std::shared_ptr<SegmentAllocator> segments;
+    std::string holder; // this host in the allocator: the connector's URI
+
+    std::mutex mutex_;
+    std::set<std::string, std::less<>> ready;     // known to be defined and running
+    bool segmentsSeeded{false};
+    std::map<std::string, std::set<std::string>> labDomains;
+    std::map<std::string, std::string> domainLab;
+};
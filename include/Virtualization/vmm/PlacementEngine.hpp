@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <libvirt/libvirt.h>
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+
+struct HostCpu {
+    int id{0};
+    int socket{0};
+    int core{0};
+    std::string siblings; // SMT siblings as libvirt prints them, e.g. "0,16"
+};
+
+struct NumaCell {
+    int id{0};
+    unsigned long long memoryKiB{0};
+    std::vector<HostCpu> cpus;
+    std::map<unsigned long, unsigned long long> hugepages; // page size KiB -> pages
+};
+
+struct HostTopology {
+    std::vector<NumaCell> cells;
+
+    [[nodiscard]] std::size_t cpuCount() const noexcept;
+    // <host><topology> of virConnectGetCapabilities
+    [[nodiscard]] static Result<HostTopology> fromCapabilities(const std::string& capsXml);
+};
+
+struct PlacementOptions {
+    // host CPUs never handed to guests (host services, libvirt, drogon)
+    std::set<int> reservedCpus;
+    // vCPUs pinned per host CPU before a cell counts as full (1 = no overcommit)
+    unsigned int overcommit{4};
+    // 0 = no hugepages; otherwise the page size requested in <memoryBacking>
+    unsigned long hugepageSizeKiB{0};
+    // cell memory counts this many times over: balloons and KSM hand the difference back
+    // (ignored with hugepages, which are neither ballooned nor merged)
+    double memoryOvercommit{1.0};
+    // load bonus for a cell that already runs VMs of the same base image; KSM with
+    // merge_across_nodes=0 only merges pages within one node
+    double sharedBaseAffinity{0.5};
+    // measured busy vCPUs per usable CPU (observeLoad) on top of the pinned ratio, times this;
+    // 0 = pins only. A cell of idle lab VMs then wins over one of the same size running builds
+    double observedLoadWeight{0.5};
+};
+
+// what the cells can still take under the overcommit limits, summed over all cells
+struct PlacementHeadroom {
+    unsigned long long vcpus{0};
+    unsigned long long memoryKiB{0};
+};
+
+/**
+ * @brief Assigns each domain to one NUMA cell and pins its vCPUs there
+ *
+ * A domain that fits a cell (vCPUs and memory) goes to the cell with the
+ * lowest load (pinned vCPUs per usable CPU, then committed memory), which
+ * spreads the heavy target VMs across sockets. Its vCPUs take the least
+ * loaded CPUs of that cell, preferring distinct physical cores, and its
+ * memory is bound to the cell with numatune mode='strict'. Clones of one
+ * base image (shareGroup) lean towards the cell their siblings run on, so
+ * KSM can merge them. A domain larger than any cell gets no pins and
+ * memory interleaved over all cells. With observeLoad() fed (the
+ * UsageCollector's passes), what the placed domains actually use counts
+ * as well, smoothed over a few passes.
+ * The engine only tracks its own reservations; release() on delete.
+ */
+class PlacementEngine {
+public:
+    explicit PlacementEngine(HostTopology topology, PlacementOptions options = {});
+
+    // topology from libvirt host capabilities
+    [[nodiscard]] static Result<HostTopology> readHostTopology(virConnectPtr conn);
+
+    [[nodiscard]] Result<CpuPlacement> place(const std::string& domain, unsigned int vcpus, unsigned long long memoryKiB,
+                                             const std::string& shareGroup = {});
+    void release(const std::string& domain);
+    // busy vCPUs per domain from one usage pass; domains not placed here are ignored
+    void observeLoad(const std::vector<std::pair<std::string, double>>& busyVcpus);
+
+    // pinned vCPUs per cell id (for the dashboard / scheduler)
+    [[nodiscard]] std::map<int, unsigned int> cellLoad() const;
+    // free vCPU slots and memory (admission control checks a deploy against it before queuing it)
+    [[nodiscard]] PlacementHeadroom headroom() const;
+    [[nodiscard]] const HostTopology& topology() const noexcept { return topo; }
+
+private:
+    struct Reservation {
+        int cell{-1};
+        std::vector<int> cpus;
+        unsigned long long memoryKiB{0};
+        std::string group;
+        double observed{0}; // busy vCPUs, exponentially smoothed
+    };
+
+    HostTopology topo;
+    PlacementOptions opts;
+    mutable std::mutex mutex_;
+    std::map<int, unsigned int> cpuLoad;                  // host cpu -> pinned vCPUs
+    std::map<int, unsigned long long> cellMemory;         // cell -> committed KiB
+    std::map<std::string, Reservation> reservations;
+    std::map<std::string, std::map<int, unsigned int>> groupCells; // share group -> cell -> VMs
+};
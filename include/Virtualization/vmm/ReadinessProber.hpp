@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Core/concurrency/TimerWheel.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+
+// متى تُعتبر الـ VM جاهزة للطلاب؛ كل الفحوص المطلوبة يجب أن تنجح في نفس الدور
+struct ReadinessSpec {
+    bool agent{false};  // guest-ping through the qemu guest agent
+    bool address{true}; // a non-loopback address is reported (agent, or DHCP leases without one)
+    std::vector<std::string> services;   // systemd units, `systemctl is-active` via guest-exec
+    std::vector<std::uint16_t> tcpPorts; // a connect() to the guest address succeeds (22 = SSH answers)
+    std::string tcpHost;                 // connect here instead of the reported address (port forwards)
+    std::chrono::seconds timeout{std::chrono::minutes(5)};
+
+    [[nodiscard]] bool empty() const noexcept {
+        return !agent && !address && services.empty() && tcpPorts.empty();
+    }
+    // no checks at all
+    [[nodiscard]] static ReadinessSpec none() {
+        ReadinessSpec spec;
+        spec.agent = false;
+        spec.address = false;
+        return spec;
+    }
+    // metadata "ready.agent" ("1" = on; writeXML then adds the agent channel), "ready.address" ("0" = off),
+    // "ready.services" ("sshd,nginx", needs the agent too), "ready.tcp" ("22,80"), "ready.host",
+    // "ready.timeout" (seconds). Without any, a DHCP lease of the guest is enough.
+    [[nodiscard]] static ReadinessSpec fromConfig(const VmConfig& cfg);
+};
+
+enum class ReadinessState { Probing, Ready, Failed };
+
+// حالة الجاهزية لـ domain واحد كما تُرسل عبر الـ WebSocket
+struct ReadinessStatus {
+    std::string domain;
+    std::string group; // the lab; all of a group's VMs are probed in one round
+    ReadinessState state{ReadinessState::Probing};
+    std::string address;
+    std::string detail; // the check still failing, or why the VM never got ready
+    unsigned int attempts{0};
+    std::chrono::milliseconds elapsed{0}; // since watch()
+};
+
+struct ReadinessOptions {
+    std::chrono::milliseconds initialDelay{2000}; // first probe after watch(); doubles per failed round
+    std::chrono::milliseconds maxDelay{30000};
+    std::chrono::seconds agentTimeout{2};           // per virDomainQemuAgentCommand
+    std::chrono::milliseconds tcpTimeout{1500};     // one poll() over all of a round's connects
+};
+
+/**
+ * @brief Tells when a started VM can actually be used
+ *
+ * "virDomainCreate returned" only means qemu runs. watch() keeps probing a
+ * domain until every check of its ReadinessSpec passes, or its timeout
+ * passes. Probing is per group (lab): one one-shot job on the timer wheel
+ * per group, armed for the earliest due VM, and a round probes every VM
+ * of the group that is due. The guest agent calls (guest-ping, the
+ * interface addresses, guest-exec of `systemctl is-active`) run in parallel
+ * over the connection pool, and the TCP checks of the round share a single
+ * poll() over non-blocking connects. Each VM backs off on its own:
+ * initialDelay, doubling to maxDelay, with the unit checks started by
+ * guest-exec collected in the next round rather than waited for.
+ *
+ * Listeners get a status when its state changes or an address shows up;
+ * they run on a Blocking-lane thread and must be short. A settle callback
+ * given to watch() runs once with the final status: Ready, or Failed after
+ * the timeout, a forget(), a new watch() of the same domain or stop(). Jobs
+ * hold a weak reference; stop() (or the destructor) before the wheel goes away.
+ */
+class ReadinessProber : public std::enable_shared_from_this<ReadinessProber> {
+public:
+    using Listener = std::function<void(const ReadinessStatus&)>;
+    using Settled = std::function<void(const ReadinessStatus&)>;
+
+    explicit ReadinessProber(std::shared_ptr<HypervisorConnector> connector, ReadinessOptions options = {});
+    ~ReadinessProber();
+
+    ReadinessProber(const ReadinessProber&) = delete;
+    ReadinessProber& operator=(const ReadinessProber&) = delete;
+
+    void start(CONCURRENCY::TimerWheel& wheel);
+    // targets still probing settle as Failed
+    void stop() noexcept;
+
+    // an empty spec is Ready at once
+    void watch(const std::string& domain, const std::string& group, ReadinessSpec spec, Settled onSettled = nullptr);
+    void forget(const std::string& domain);
+
+    [[nodiscard]] std::optional<ReadinessStatus> status(std::string_view domain) const;
+    [[nodiscard]] std::vector<ReadinessStatus> group(std::string_view group) const;
+
+    [[nodiscard]] std::uint64_t subscribe(Listener listener);
+    void unsubscribe(std::uint64_t id);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Target {
+        ReadinessSpec spec;
+        ReadinessStatus status;
+        Clock::time_point started{};
+        Clock::time_point due{};
+        std::chrono::milliseconds backoff{0};
+        std::map<std::string, long long> execs; // unit -> guest-exec pid still running
+        Settled onSettled;
+        bool probing{false}; // taken by a round right now
+    };
+
+    struct Group {
+        std::vector<std::string> domains;
+        CONCURRENCY::TimerId timer;
+        Clock::time_point armedFor{Clock::time_point::max()};
+        bool running{false};
+    };
+
+    // what a round learned about one target, merged back under the lock
+    struct Probe;
+
+    void arm(const std::string& group, Group& g); // called with mutex_ held
+    void dropMember(const std::string& group, const std::string& domain); // called with mutex_ held
+    void round(const std::string& group);
+    void settle(Target& t, ReadinessState state, std::string detail,
+                std::vector<std::pair<Settled, ReadinessStatus>>& settled); // called with mutex_ held
+    void notify(const std::vector<ReadinessStatus>& changed,
+                std::vector<std::pair<Settled, ReadinessStatus>>& settled);
+    // guest agent checks of one target on a pooled connection
+    void probeAgent(Probe& p) const;
+    // all TCP checks of a round in one poll()
+    void probeTcp(std::vector<Probe>& probes) const;
+
+    std::shared_ptr<HypervisorConnector> connector;
+    ReadinessOptions opts;
+
+    mutable std::mutex mutex_;
+    CONCURRENCY::TimerWheel* wheel{nullptr};
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+    std::unordered_map<std::string, Target> targets;
+    std::unordered_map<std::string, Group> groups;
+
+    std::mutex listenersMutex;
+    std::vector<std::pair<std::uint64_t, Listener>> listeners;
+    std::uint64_t nextListenerId{1};
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include "Utils/Result.hpp"
+
+class IRocksDB;
+
+// نوع معرّف المقطع: VLAN tag (وضع Vlan) أو VXLAN VNI (وضع Vxlan)
+enum class SegmentKind { Vlan, Vni };
+
+/**
+ * @brief Cluster-wide ids of lab segments: VLAN tags and VXLAN VNIs
+ *
+ * One allocator is shared by the NetworkFabric of every host, on the
+ * cluster database, so a segment carries the same id on all hosts and two
+ * segments never share one, whatever their names hash to. The search for a
+ * free id starts at the caller's hint (a hash of the name), so it rarely
+ * probes and a re-created segment tends to get its old id back.
+ *
+ * Every host that runs a segment holds its id (holder = the host's libvirt
+ * URI); the id is only given back when the last holder releases it, so a
+ * host tearing a lab down never hands a tunnel still carrying traffic on
+ * another host to a new segment.
+ *
+ * Key schema (optional IRocksDB, values are plain text):
+ *   fabric/vlan/<network> -> tag '\x1f' holder '\x1f' holder ...
+ *   fabric/vni/<network>  -> vni '\x1f' holder ...
+ * The id -> network side is not stored; load() rebuilds it. Without a
+ * database the ids only live in this process.
+ */
+class SegmentAllocator {
+public:
+    explicit SegmentAllocator(std::shared_ptr<IRocksDB> db = nullptr);
+
+    // Warm start from the database; returns the number of ids loaded
+    std::size_t load();
+
+    // The id of `network` for `holder`, allocating the first free one in [first, last] from `hint` on
+    [[nodiscard]] Result<unsigned int> acquire(SegmentKind kind, std::string_view network, std::string_view holder,
+                                               unsigned int first, unsigned int last, unsigned int hint);
+    // Records an id a network already uses (found defined in libvirt); false when another segment holds it
+    [[nodiscard]] bool adopt(SegmentKind kind, std::string_view network, std::string_view holder, unsigned int id);
+    // Drops `holder`; the id is free again once no host holds it
+    [[nodiscard]] Result<void> release(SegmentKind kind, std::string_view network, std::string_view holder);
+
+    [[nodiscard]] std::optional<unsigned int> find(SegmentKind kind, std::string_view network) const;
+    [[nodiscard]] std::optional<std::string> owner(SegmentKind kind, unsigned int id) const;
+    [[nodiscard]] std::size_t size(SegmentKind kind) const;
+
+private:
+    struct Entry {
+        unsigned int id{0};
+        std::set<std::string, std::less<>> holders;
+    };
+    struct Table {
+        std::map<std::string, Entry, std::less<>> byNetwork;
+        std::map<unsigned int, std::string> byId;
+    };
+
+    [[nodiscard]] Table& table(SegmentKind kind) noexcept { return tables[static_cast<std::size_t>(kind)]; }
+    [[nodiscard]] const Table& table(SegmentKind kind) const noexcept { return tables[static_cast<std::size_t>(kind)]; }
+    // called with mutex_ held, before memory is touched; an entry without holders is deleted
+    [[nodiscard]] Result<void> persist(SegmentKind kind, std::string_view network, const Entry& entry);
+
+    std::shared_ptr<IRocksDB> db;
+    mutable std::mutex mutex_;
+    std::array<Table, 2> tables;
+};
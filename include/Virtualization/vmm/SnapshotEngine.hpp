@@ -0,0 +1,105 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <libvirt/libvirt.h>
+#include "Core/interfaces/IDatabase.hpp"
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+
+// Internal: inside the qcow2 images (memory too when the domain runs).
+// External: disk-only overlays; reverting them needs libvirt >= 9.9
+enum class SnapshotMode { Internal, External };
+
+struct SnapshotOptions {
+    SnapshotMode mode{SnapshotMode::Internal};
+    std::string description;
+};
+
+// الحالة "الذهبية" لكل template: ما يُعاد إليه كل VM من هذا الـ template عند reset
+struct GoldenSpec {
+    std::string snapshot{"golden"};
+    SnapshotMode mode{SnapshotMode::Internal};
+    bool captureOnDeploy{true};  // taken right after define, before the first boot
+    bool startAfterRevert{true}; // a snapshot of a shut-off domain boots after the revert
+};
+
+struct RevertOutcome {
+    std::string domain;
+    std::string error;
+    std::chrono::milliseconds took{0};
+
+    [[nodiscard]] bool ok() const noexcept { return error.empty(); }
+};
+
+struct LabRevertResult {
+    std::string lab;
+    std::vector<RevertOutcome> outcomes;
+    std::chrono::milliseconds total{0};
+
+    [[nodiscard]] std::size_t succeeded() const noexcept;
+    [[nodiscard]] std::size_t failed() const noexcept;
+};
+
+/**
+ * @brief libvirt snapshots and golden-state resets for lab VMs
+ *
+ * Resetting a lab box by reverting to its golden snapshot replaces
+ * delete + redeploy: no disk is recreated, no XML is rebuilt, and with a
+ * snapshot that holds memory the VM is back running without a boot. Each
+ * template has a GoldenSpec; the manager tracks every deployed VM with its
+ * lab and template and, unless disabled, captures the golden snapshot
+ * before the first start. Membership is persisted as
+ *   snap/<lab>/<domain> -> template id
+ * so revert_lab() still knows a lab after a restart. revert_lab() reverts
+ * all members in parallel over the connection pool.
+ */
+class SnapshotEngine {
+public:
+    explicit SnapshotEngine(std::shared_ptr<HypervisorConnector> connector, std::shared_ptr<IRocksDB> db = nullptr);
+
+    void setGolden(std::string templateId, GoldenSpec spec);
+    // the template's spec, or the default spec for templates without one
+    [[nodiscard]] GoldenSpec golden(std::string_view templateId) const;
+
+    void track(const std::string& domain, const std::string& lab, const std::string& templateId);
+    void untrack(const std::string& domain);
+    [[nodiscard]] std::vector<std::string> members(const std::string& lab) const;
+    [[nodiscard]] std::optional<std::string> labOf(std::string_view domain) const;
+
+    [[nodiscard]] Result<void> create(std::string_view domain, const std::string& name, const SnapshotOptions& options = {});
+    [[nodiscard]] Result<void> create(virDomainPtr domain, const std::string& name, const SnapshotOptions& options = {});
+    [[nodiscard]] Result<void> revert(std::string_view domain, const std::string& name, bool startIfShutOff = false);
+    [[nodiscard]] Result<void> remove(std::string_view domain, const std::string& name);
+    [[nodiscard]] Result<std::vector<std::string>> list(std::string_view domain);
+
+    // (re)captures the golden snapshot from the domain's current state
+    [[nodiscard]] Result<void> captureGolden(std::string_view domain);
+    [[nodiscard]] Result<void> captureGolden(virDomainPtr domain, std::string_view templateId);
+    [[nodiscard]] Result<void> revertToGolden(std::string_view domain);
+
+    [[nodiscard]] Result<LabRevertResult> revert_lab(const std::string& lab);
+
+private:
+    struct Member {
+        std::string lab;
+        std::string templateId;
+    };
+
+    [[nodiscard]] std::string templateOf(std::string_view domain) const;
+    [[nodiscard]] static std::string key(const std::string& lab, const std::string& domain);
+
+    std::shared_ptr<HypervisorConnector> connector;
+    std::shared_ptr<IRocksDB> db;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, GoldenSpec> goldens;                // template id -> spec
+    std::unordered_map<std::string, Member> domains;                    // domain -> lab/template
+    std::unordered_map<std::string, std::set<std::string>> labMembers;  // lab -> domains
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Virtualization/vm/VirtualMachinePool.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+
+// نتيجة المزامنة الأولى بين سجلات RocksDB والـ domains في libvirt
+struct ReconcileReport {
+    std::size_t records{0}; // loaded from the snapshot
+    std::size_t domains{0}; // listed by libvirt
+    std::size_t stale{0};   // records dropped: their domain is gone
+    std::size_t adopted{0}; // domains that had no record
+    std::size_t foreign{0}; // domains without a record or PenHive's <metadata>: not adopted
+    std::size_t ports{0};   // records whose console port was corrected
+    std::size_t probed{0};  // domains whose XML had to be read
+    std::chrono::milliseconds took{0};
+    std::string error;      // libvirt unreachable or the repair commit failed
+};
+
+/**
+ * @brief Brings the VM pool and libvirt back in line after a restart
+ *
+ * begin() puts the pool in recovery and lists every domain in one bulk
+ * call on the dispatcher while the calling thread loads the RocksDB
+ * snapshot (warmStart), so the two overlap and the constructor returns as
+ * soon as the snapshot is in: reads are served from it from then on. The
+ * job then diffs the two by name:
+ *
+ *   record without a domain    stale, dropped (deleted while we were down)
+ *   domain without a record    adopted with its uuid and console port, if
+ *                              its XML carries PenHive's <metadata>
+ *   running domain             the port it listens on is recorded if it
+ *                              differs; its port and tlsPort are marked taken
+ *
+ * Only the domains in those last two groups have their XML read, in
+ * parallel over the connection pool; stopped domains the snapshot knows are
+ * trusted. The repair lands in one group commit, then every persisted
+ * port/ key is marked taken too, and only then do allocate() and
+ * reserveConsolePort() stop waiting.
+ */
+class StartupReconciler : public std::enable_shared_from_this<StartupReconciler> {
+public:
+    StartupReconciler(VirtualMachinePool& pool, std::shared_ptr<HypervisorConnector> connector);
+    ~StartupReconciler();
+
+    StartupReconciler(const StartupReconciler&) = delete;
+    StartupReconciler& operator=(const StartupReconciler&) = delete;
+
+    // returns the number of records loaded; the diff and repair finish on the dispatcher
+    int begin(CONCURRENCY::EventDispatcher& dispatcher);
+    // a job that has not started yet is skipped, a running one is waited for
+    void cancel();
+
+    [[nodiscard]] bool done() const;
+    // nullopt until the job has finished
+    [[nodiscard]] std::optional<ReconcileReport> report() const;
+
+private:
+    enum class Phase { Idle, Queued, Running, Done, Cancelled };
+
+    void run(std::shared_future<int> snapshot);
+    [[nodiscard]] ReconcileReport reconcile(std::shared_future<int>& snapshot);
+    void finish(ReconcileReport result);
+
+    VirtualMachinePool& pool;
+    std::shared_ptr<HypervisorConnector> connector;
+
+    mutable std::mutex mutex_;
+    std::condition_variable phaseChanged;
+    Phase phase{Phase::Idle};
+    std::optional<ReconcileReport> result_;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Utils/Result.hpp"
+#include "Virtualization/vm/MacAllocator.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/NetworkFabric.hpp"
+#include "Virtualization/vmm/VmConfigCache.hpp"
+
+class TopologyStore;
+
+// جهاز في مخطط networkDesigner.js؛ domain فارغ = جهاز لم يُنشر بعد (أو switch/hub)
+struct TopologyDevice {
+    std::string id;
+    std::string type;   // pc, server, router, switch, hub, ...
+    std::string domain; // libvirt domain name of the VM behind the device
+    std::string netProfile; // NICs the designer attaches: "vhost", "throughput" (VmConfig::findNetProfile); "" = bare virtio
+};
+
+// كابل بين جهازين
+struct TopologyLink {
+    std::string id;
+    std::string from;
+    std::string to;
+};
+
+struct LabTopology {
+    std::string lab;
+    std::vector<TopologyDevice> devices;
+    std::vector<TopologyLink> links;
+};
+
+// عملية NIC واحدة ناتجة عن المقارنة
+struct NicChange {
+    enum class Kind { Attach, Detach };
+    Kind kind{Kind::Attach};
+    std::string domain;
+    std::string network;
+    std::string mac;   // attaches get theirs in apply(); empty in a dry-run plan
+    std::string error; // filled by apply() when the libvirt call failed
+    std::string profile;    // attaches: network profile of the device
+    unsigned int vcpus{0};  // attaches: queue pairs of a multiqueue profile follow the domain's vCPUs
+};
+
+// ما يجب أن تتصل به VMs المختبر: من desiredWiring() أو من TopologyStore::wiring()
+struct TopologyWiring {
+    std::string lab;
+    std::map<std::string, std::vector<std::string>> networks; // domain -> managed networks, one entry per cable, sorted
+    std::map<std::string, std::string> profiles;              // domain -> netProfile of its device
+    std::set<std::string> domains;                            // every domain the graph names
+};
+
+struct TopologyPlan {
+    std::vector<std::string> createNetworks;
+    std::vector<std::string> removeNetworks; // managed networks of the lab no cable uses any more
+    std::vector<NicChange> changes;
+
+    [[nodiscard]] bool empty() const noexcept { return createNetworks.empty() && removeNetworks.empty() && changes.empty(); }
+};
+
+struct TopologyApplyResult {
+    TopologyPlan plan;
+    std::size_t applied{0};
+    std::size_t failed{0};
+    std::vector<std::string> errors; // network-level failures
+
+    [[nodiscard]] bool ok() const noexcept { return failed == 0 && errors.empty(); }
+};
+
+/**
+ * @brief Wires lab VMs to match the network designer's graph
+ *
+ * Every switch/hub component of the graph becomes one libvirt
+ * network (see NetworkFabric) named ph-<lab>-<smallest switch id>; a cable straight between
+ * two VMs becomes a point-to-point network ph-<lab>-p2p:<a>:<b>. The
+ * desired NICs per domain are diffed against the interfaces in the current
+ * domain XML, and only NICs on the lab's own ph-<lab>- networks are
+ * touched, so management/parking NICs survive. apply() has the fabric
+ * create missing networks first, then runs each domain's detaches and attaches as one job,
+ * domains in parallel over the connection pool, and finally removes the
+ * lab networks that no cable uses and no domain outside the graph is on.
+ *
+ * With a TopologyStore, planStored()/applyStored() take the wiring straight
+ * from the stored graph (its device kinds and link adjacency), without
+ * materialising the design as a LabTopology first.
+ */
+class TopologyApplier {
+public:
+    explicit TopologyApplier(std::shared_ptr<HypervisorConnector> connector);
+
+    // isolated per-host segments unless a VLAN/VXLAN fabric is shared with the VM manager
+    void setNetworkFabric(std::shared_ptr<NetworkFabric> fabric);
+
+    // new NICs get lab-prefixed, collision-checked MACs; without one they are random
+    void setMacAllocator(std::shared_ptr<MacAllocator> allocator);
+
+    // designs saved by the network designer, for planStored()/applyStored()
+    void setTopologyStore(std::shared_ptr<TopologyStore> store);
+
+    // domain -> managed networks it must have a NIC on (one entry per cable, sorted)
+    [[nodiscard]] static Result<std::map<std::string, std::vector<std::string>>> desiredWiring(const LabTopology& topology);
+    [[nodiscard]] static std::string networkPrefix(std::string_view lab);
+    // network of the switch/hub component whose smallest device id is `root`
+    [[nodiscard]] static std::string segmentNetwork(std::string_view lab, std::string_view root);
+    // network of a cable straight between two VMs (ids in either order)
+    [[nodiscard]] static std::string p2pNetwork(std::string_view lab, std::string_view a, std::string_view b);
+
+    // read-only diff against the current libvirt state (dry run)
+    [[nodiscard]] Result<TopologyPlan> plan(const LabTopology& topology);
+    [[nodiscard]] Result<TopologyApplyResult> apply(const LabTopology& topology);
+    // the same for the design stored for the lab; an error without a store or a stored design
+    [[nodiscard]] Result<TopologyPlan> planStored(std::string_view lab);
+    [[nodiscard]] Result<TopologyApplyResult> applyStored(std::string_view lab);
+    // the lab is over: drop all of its networks, NICs still on them go dead
+    [[nodiscard]] Result<std::size_t> teardown(std::string_view lab);
+
+private:
+    struct CurrentNic {
+        std::string network;
+        std::string mac;
+    };
+
+    struct CurrentDomain {
+        unsigned int vcpus{0};
+        std::vector<CurrentNic> nics;
+    };
+
+    [[nodiscard]] static Result<TopologyWiring> wiringOf(const LabTopology& topology);
+    [[nodiscard]] Result<TopologyWiring> storedWiring(std::string_view lab) const;
+    [[nodiscard]] Result<TopologyPlan> planWiring(const TopologyWiring& wiring);
+    [[nodiscard]] Result<TopologyApplyResult> applyWiring(const TopologyWiring& wiring);
+    [[nodiscard]] Result<std::map<std::string, CurrentDomain>> readWiring(const std::vector<std::string>& domains, const std::string& prefix);
+    [[nodiscard]] Result<std::vector<std::string>> managedNetworks(const std::string& prefix);
+    // of `networks`, those a domain not in `graphDomains` still has a NIC on (live port or inactive config)
+    [[nodiscard]] std::set<std::string> outsideUsers(const std::vector<std::string>& networks, const std::set<std::string>& graphDomains);
+
+    std::shared_ptr<HypervisorConnector> connector;
+    std::shared_ptr<MacAllocator> macs; // atomic_load/atomic_store
+    std::shared_ptr<NetworkFabric> fabric; // atomic_load/atomic_store
+    std::shared_ptr<TopologyStore> designs; // atomic_load/atomic_store
+    VmConfigCache configs; // lab domains are re-read on every plan
+    std::mutex applyMutex; // one topology change at a time: plans must not interleave
+};
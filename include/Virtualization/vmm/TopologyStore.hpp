@@ -0,0 +1,183 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/TopologyApplier.hpp"
+
+class IRocksDB;
+namespace rocksdb { class WriteBatch; }
+
+// نوع الجهاز كما يرسمه المصمم؛ switch/hub تصير segments في TopologyApplier
+enum class DeviceKind : std::uint8_t { Pc, Server, Router, Switch, Hub, Firewall, Other };
+
+// تعديل واحد من networkDesigner.js بدل رفع المخطط كاملاً
+struct TopologyDelta {
+    enum class Op { AddDevice, UpdateDevice, RemoveDevice, AddLink, RemoveLink };
+    Op op{Op::AddDevice};
+    std::string id; // device or link id
+    // devices; UpdateDevice only changes the fields that are set
+    std::optional<std::string> type;
+    std::optional<std::string> domain;
+    std::optional<std::string> netProfile;
+    // AddLink
+    std::string from;
+    std::string to;
+};
+
+// حالة المخطط المخزن بعد تعديل
+struct TopologyRevision {
+    std::uint64_t version{0};
+    std::size_t devices{0};
+    std::size_t links{0};
+    std::size_t removedLinks{0}; // cables dropped along with their devices
+};
+
+// رفض دفعة تعديلات؛ conflict = المخطط تغيّر منذ baseVersion
+struct TopologyDeltaError {
+    bool conflict{false};
+    std::uint64_t version{0}; // the stored one, for the client to resync from
+    std::string message;
+};
+
+/**
+ * @brief Server-side model of the network designer's graph per lab
+ *
+ * A lab's graph is a table of typed device records and a table of links
+ * that refer to devices by slot index; type and network profile strings are
+ * interned per graph, so a record is its id, its domain and three small
+ * integers. The links of a device come from CSR arrays (offsets + link
+ * slots per device) rebuilt only after links were added; removals leave
+ * tombstones that the walk skips, and the tables are compacted once they
+ * are mostly dead. wiring() walks them for TopologyApplier: switch/hub
+ * components by their device kind, then the cables of each deployed VM.
+ *
+ * The designer sends deltas against the version it last saw; a batch is
+ * applied to the resident graph in place, each change recorded in an undo
+ * log, and lands in one WriteBatch together with the new version. A delta
+ * that does not fit or a failed write replays the log backwards, so the
+ * batch is applied completely or not at all without copying the graph. A
+ * stale baseVersion is a conflict and the client resends the full design
+ * (replace()).
+ *
+ * Graphs are loaded on first use and at most maxResident labs stay in
+ * memory; evicted ones are read back from RocksDB. Without a database
+ * nothing is evicted. Key schema (values are plain text):
+ *   topo/<lab>/v          -> version
+ *   topo/<lab>/d/<id>     -> type \x1f domain \x1f netProfile
+ *   topo/<lab>/l/<id>     -> from \x1f to
+ */
+class TopologyStore {
+public:
+    explicit TopologyStore(std::shared_ptr<IRocksDB> db = nullptr, std::size_t maxResident = 64);
+    ~TopologyStore();
+
+    TopologyStore(const TopologyStore&) = delete;
+    TopologyStore& operator=(const TopologyStore&) = delete;
+
+    // the stored design as TopologyApplier takes it; nullopt = nothing stored for the lab
+    [[nodiscard]] std::optional<LabTopology> topology(std::string_view lab);
+    [[nodiscard]] std::optional<std::uint64_t> version(std::string_view lab);
+    // what TopologyApplier::desiredWiring() makes of topology(lab), read off the graph; nullopt = nothing stored
+    [[nodiscard]] std::optional<TopologyWiring> wiring(std::string_view lab);
+
+    // full upload: the design replaces whatever was stored; links without an id get one
+    [[nodiscard]] Result<TopologyRevision> replace(const LabTopology& design);
+    [[nodiscard]] Result<TopologyRevision, TopologyDeltaError> update(std::string_view lab, std::uint64_t baseVersion,
+                                                                      const std::vector<TopologyDelta>& deltas);
+    // the lab is over; returns false when nothing was stored
+    [[nodiscard]] Result<bool> erase(std::string_view lab);
+
+    [[nodiscard]] static DeviceKind kindOf(std::string_view type) noexcept;
+
+private:
+    static constexpr std::uint32_t kNone = 0xffffffffu;
+
+    struct DeviceRecord {
+        std::string id;
+        std::string domain;
+        std::uint16_t type{0};    // label index
+        std::uint16_t profile{0}; // label index, 0 = ""
+        DeviceKind kind{DeviceKind::Other};
+        bool live{false};
+    };
+
+    struct LinkRecord {
+        std::string id;
+        std::uint32_t from{kNone}; // device slot; kNone = removed
+        std::uint32_t to{kNone};
+    };
+
+    struct Graph {
+        std::uint64_t version{0};
+        std::vector<std::string> labels{std::string()};
+        std::vector<DeviceRecord> devices;
+        std::vector<LinkRecord> links;
+        std::vector<std::uint32_t> freeDevices;
+        std::unordered_map<std::string, std::uint32_t> deviceSlots;
+        std::unordered_map<std::string, std::uint32_t> linkSlots;
+        // CSR: links of device d are adjacency[offsets[d] .. offsets[d + 1])
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> adjacency;
+        bool adjacencyDirty{true};
+
+        // nullopt = the label table is full
+        [[nodiscard]] std::optional<std::uint16_t> intern(std::string_view label);
+        [[nodiscard]] const std::string& label(std::uint16_t index) const { return labels[index]; }
+        [[nodiscard]] std::size_t liveLinks() const noexcept { return linkSlots.size(); }
+        // no checks: applyDelta() and loadGraph() have done them
+        std::uint32_t addDevice(DeviceRecord record);
+        void addLink(LinkRecord record);
+        void rebuildAdjacency();
+        // fn(other end, link) per live link of the device; the adjacency must be current
+        template <typename Fn>
+        void forEachLink(std::uint32_t slot, Fn&& fn);
+        // drops tombstones once they outnumber the live records
+        void compact();
+    };
+
+    // what one change of applyDelta() destroyed, replayed backwards by rollback()
+    struct Undo {
+        enum class Kind { AddedDevice, ChangedDevice, RemovedDevice, AddedLink, RemovedLink };
+        Kind kind{Kind::AddedDevice};
+        std::uint32_t slot{kNone};
+        bool reused{false};  // AddedDevice: the slot came from freeDevices
+        DeviceRecord device; // ChangedDevice, RemovedDevice: the record before
+        LinkRecord link;     // RemovedLink: the record before
+    };
+    struct UndoLog {
+        std::size_t labels{0}; // size of the label table before the batch
+        std::vector<Undo> entries;
+    };
+
+    struct Resident {
+        std::string lab;
+        Graph graph;
+    };
+    using Lru = std::list<Resident>;
+
+    // one delta on `graph`, its keys go into `batch` and its inverse into `undo` (when given);
+    // returns the error on a delta that does not fit, which leaves the graph unchanged
+    [[nodiscard]] static std::optional<std::string> applyDelta(Graph& graph, std::string_view lab, const TopologyDelta& delta,
+                                                               rocksdb::WriteBatch& batch, TopologyRevision& revision,
+                                                               UndoLog* undo = nullptr);
+    static void rollback(Graph& graph, UndoLog& undo);
+    // resident graph of the lab, loaded from the database on a miss; nullptr = nothing stored
+    [[nodiscard]] Graph* graphOf(std::string_view lab);
+    [[nodiscard]] std::optional<Graph> loadGraph(std::string_view lab) const;
+    void store(std::string lab, Graph graph);
+    void evictOverflow();
+
+    std::shared_ptr<IRocksDB> db;
+    std::size_t maxResident;
+    mutable std::mutex mutex_;
+    Lru resident; // most recently used first
+    std::unordered_map<std::string, Lru::iterator> byLab;
+};
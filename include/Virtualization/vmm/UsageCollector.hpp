@@ -0,0 +1,183 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Core/concurrency/TimerWheel.hpp"
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+
+class IRocksDB;
+
+// استهلاك VM خلال فترة واحدة: عينة من الـ ring أو rollup مخزن في RocksDB
+struct UsagePoint {
+    std::chrono::system_clock::time_point at; // end of the span
+    std::chrono::milliseconds span{0};
+    double cpu{0};       // busy vCPUs, 1.0 = one vCPU fully used
+    unsigned int vcpus{0};
+    std::uint64_t memoryKiB{0};     // host RSS (balloon.rss), balloon.current without it; mean over a rollup
+    std::uint64_t memoryPeakKiB{0}; // = memoryKiB for a single sample
+    double diskReadBps{0};
+    double diskWriteBps{0};
+    double netRxBps{0};
+    double netTxBps{0};
+
+    [[nodiscard]] double cpuShare() const noexcept { return vcpus ? cpu / vcpus : cpu; }
+    [[nodiscard]] double ioBps() const noexcept { return diskReadBps + diskWriteBps + netRxBps + netTxBps; }
+};
+
+// آخر عينة لكل VM في دور واحد، لمن يشترك (IdleSuspender، PlacementEngine)
+struct DomainUsage {
+    std::string domain;
+    UsagePoint point;
+};
+
+enum class UsageMetric { Cpu, Memory, Disk, Network };
+
+struct UsageOptions {
+    std::size_t ringSamples{180};                        // per VM; 30 minutes at the default interval
+    std::chrono::seconds rollup{300};                    // older data survives as one row per VM per rollup
+    std::chrono::hours retention{std::chrono::hours(24 * 30)};
+};
+
+/**
+ * @brief CPU, memory, disk and network history per VM
+ *
+ * A pass on the timer wheel reads every active domain with one
+ * virConnectGetAllDomainStats call and walks each record's parameters once
+ * (no per-field lookups). Counters are stored as deltas against the
+ * previous pass, in a fixed ring of 32-byte samples per VM, so memory is
+ * ringSamples * 32 bytes per VM however long it runs. The samples of each
+ * rollup period are folded into one aggregate that is written to RocksDB
+ * when the period ends (one WriteBatch per pass for all VMs), and rows
+ * past the retention are dropped with a range delete per VM once an hour.
+ * history() answers from the ring where it reaches and from the rollups
+ * that start before it; ring samples inside the newest such rollup are left
+ * out, so no span is counted twice or lost.
+ *
+ * A VM that leaves the list (shut off, deleted) loses its ring; its
+ * rollups stay until they age out. Key schema (values are plain text):
+ *   usage/<vm>/<bucket start, 10 digits of unix seconds>
+ *     -> spanMs cpuUs memKiB memPeakKiB diskReadKiB diskWriteKiB netRxKiB netTxKiB vcpus
+ *
+ * Listeners get the newest point of every VM after each pass, on the
+ * wheel's Blocking lane. The wheel job holds a weak reference; stop() (or
+ * the destructor) before the wheel goes away.
+ */
+class UsageCollector : public std::enable_shared_from_this<UsageCollector> {
+public:
+    using Listener = std::function<void(const std::vector<DomainUsage>&)>;
+
+    explicit UsageCollector(std::shared_ptr<HypervisorConnector> connector, std::shared_ptr<IRocksDB> db = nullptr,
+                            UsageOptions options = {});
+    ~UsageCollector();
+
+    UsageCollector(const UsageCollector&) = delete;
+    UsageCollector& operator=(const UsageCollector&) = delete;
+
+    void start(CONCURRENCY::TimerWheel& wheel, std::chrono::seconds interval = std::chrono::seconds(10));
+    void stop() noexcept;
+
+    // one pass (what the wheel runs); returns the number of domains sampled
+    [[nodiscard]] Result<std::size_t> runOnce();
+    // the same pass stamped `at` (tests, replays): spans are the time between the `at`s of successive passes;
+    // do not mix with runOnce() on one collector
+    [[nodiscard]] Result<std::size_t> runOnce(std::chrono::system_clock::time_point at);
+
+    [[nodiscard]] std::optional<UsagePoint> latest(std::string_view domain) const;
+    // oldest first; rollups for the part the ring no longer holds
+    [[nodiscard]] std::vector<UsagePoint> history(std::string_view domain, std::chrono::system_clock::time_point from,
+                                                  std::chrono::system_clock::time_point to) const;
+    // the VMs using the most of `metric` in the last pass (abuse, noisy neighbours)
+    [[nodiscard]] std::vector<DomainUsage> top(UsageMetric metric, std::size_t limit) const;
+    [[nodiscard]] std::size_t tracked() const;
+
+    [[nodiscard]] std::uint64_t subscribe(Listener listener);
+    void unsubscribe(std::uint64_t id);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // one pass of one VM; counters are deltas, clamped to 32 bits
+    struct Sample {
+        std::uint32_t at{0};         // unix seconds
+        std::uint32_t spanMs : 22{0}; // clamped, ~70 minutes
+        std::uint32_t vcpus : 10{0};  // vcpu.current when sampled, clamped to 1023
+        std::uint32_t cpuUs{0};
+        std::uint32_t memKiB{0};
+        std::uint32_t diskReadKiB{0};
+        std::uint32_t diskWriteKiB{0};
+        std::uint32_t netRxKiB{0};
+        std::uint32_t netTxKiB{0};
+    };
+    static_assert(sizeof(Sample) == 32);
+
+    struct Counters {
+        std::uint64_t cpuNs{0};
+        std::uint64_t diskRead{0}; // bytes
+        std::uint64_t diskWrite{0};
+        std::uint64_t netRx{0};
+        std::uint64_t netTx{0};
+    };
+
+    struct Rollup {
+        std::uint32_t bucket{0}; // unix seconds of the period start; 0 = empty
+        std::uint64_t spanMs{0};
+        std::uint64_t cpuUs{0};
+        std::uint64_t memKiBSum{0};
+        std::uint32_t memPeakKiB{0};
+        std::uint32_t samples{0};
+        std::uint64_t diskReadKiB{0};
+        std::uint64_t diskWriteKiB{0};
+        std::uint64_t netRxKiB{0};
+        std::uint64_t netTxKiB{0};
+        std::uint32_t vcpus{0};
+    };
+
+    struct Series {
+        std::vector<Sample> ring; // grows to ringSamples, then head wraps
+        std::size_t head{0};      // next slot to overwrite once full
+        Counters last;
+        Clock::time_point sampledAt{};
+        std::uint32_t vcpus{0};
+        Rollup rollup;
+        std::uint64_t pass{0}; // last pass that saw the VM
+    };
+
+    // what one stats record says, parsed before the lock is taken
+    struct Reading;
+
+    // the pass; `at` empty = the clocks now
+    [[nodiscard]] Result<std::size_t> collect(std::optional<std::chrono::system_clock::time_point> at);
+
+    [[nodiscard]] static UsagePoint pointOf(const Sample& s);
+    [[nodiscard]] static UsagePoint pointOf(const Rollup& r, std::uint32_t rollupSeconds);
+    // the finished period goes into `rows` as key/value; called with mutex_ held
+    void closeRollup(const std::string& domain, Rollup& r, std::vector<std::pair<std::string, std::string>>& rows) const;
+
+    std::shared_ptr<HypervisorConnector> connector;
+    std::shared_ptr<IRocksDB> db;
+    UsageOptions opts;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Series> series;
+    std::map<std::string, std::uint32_t> retired; // gone VMs -> last bucket, still to be pruned
+    std::uint64_t passes{0};
+    Clock::time_point lastPrune{};
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+    CONCURRENCY::TimerWheel* wheel{nullptr};
+    CONCURRENCY::TimerId timer;
+
+    std::mutex listenersMutex;
+    std::vector<std::pair<std::uint64_t, Listener>> listeners;
+    std::uint64_t nextListenerId{1};
+};
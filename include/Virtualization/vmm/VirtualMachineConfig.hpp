@@ -2,9 +2,11 @@
 #define VMCONFIG_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <memory>
+#include "Utils/Result.hpp"
 
 struct DiskConfig {
     std::string type; // file, block, network
@@ -12,22 +14,76 @@ struct DiskConfig {
     std::string source; // path to image
     std::string target; // device name (e.g., vda)
     std::string driver; // driver type
-    unsigned long size; // in KB
-    bool readOnly;
+    unsigned long size{0}; // in KB
+    bool readOnly{false};
+
+    // <driver> I/O tuning; empty/0 = libvirt default (usually filled from an IoProfile)
+    std::string cache;        // none, writeback, writethrough, directsync, unsafe
+    std::string io;           // native, threads, io_uring
+    std::string discard;      // unmap, ignore
+    unsigned int queues{0};   // virtio-blk queues; 0 = qemu default
+    unsigned int iothread{0}; // 1-based index into VmConfig::iothreads; 0 = qemu main loop
+};
+
+// ملف I/O يُختار لكل قالب (metadata "ioProfile"): ما ندفعه من سرعة مقابل المتانة
+struct IoProfile {
+    std::string_view name;
+    std::string_view cache;
+    std::string_view io;
+    std::string_view discard;
+    bool multiqueue{false};         // one virtio-blk queue per vCPU
+    bool dedicatedIothreads{false}; // every virtio disk gets its own iothread
 };
 
 struct NetworkConfig {
-    std::string type; // bridge, network, user
-    std::string source; // network name or bridge name
+    std::string type; // bridge, network, direct, user
+    std::string source; // network name, bridge name or (direct) host interface
     std::string model; // network card model
     std::string macAddress;
+
+    // virtio-net tuning; empty/0 = libvirt default (usually filled from a NetProfile)
+    std::string driverName;        // vhost, qemu
+    unsigned int queues{0};        // queue pairs; 0 = one
+    unsigned int rxQueueSize{0};   // rx ring entries (256..1024, power of two)
+    unsigned int txQueueSize{0};   // tx ring entries; qemu only honours it for vhost-user
+    std::string directMode;        // type direct (macvtap): bridge, vepa, private, passthrough; "" = bridge
+};
+
+// ملف شبكة لكل قالب (metadata "netProfile") أو لكل جهاز في المصمم
+struct NetProfile {
+    std::string_view name;
+    std::string_view driver;
+    bool multiqueue{false};      // one queue pair per vCPU
+    unsigned int rxQueueSize{0};
+    unsigned int txQueueSize{0};
+};
+
+// تثبيت الـ vCPUs وذاكرة NUMA (يملؤها PlacementEngine أو يدويًا)؛ فارغ = بدون cputune/numatune
+struct CpuPlacement {
+    std::vector<std::string> vcpuPins; // cpuset لكل vCPU بالترتيب، مثل "2" أو "2,18"
+    std::string emulatorPin;           // cpuset لخيوط qemu غير الـ vCPU
+    std::string memoryNodes;           // nodeset، مثل "0"
+    std::string numaMode{"strict"};    // strict | preferred | interleave
+    unsigned long hugepageSizeKiB{0};  // 0 = صفحات عادية
+    std::vector<std::string> iothreadPins; // cpuset لكل iothread بالترتيب
+
+    [[nodiscard]] bool empty() const noexcept { return vcpuPins.empty() && memoryNodes.empty() && hugepageSizeKiB == 0; }
+};
+
+// balloon و KSM: ما يسمح بتحميل عدد أكبر من الـ VMs المتشابهة على نفس الـ host
+struct MemoryTuning {
+    bool balloon{true};            // virtio memballoon; false = model='none' (no resize at runtime)
+    unsigned int statsPeriod{10};  // seconds between guest memory stats; 0 = off
+    bool autodeflate{true};        // guest OOM deflates the balloon before killing anything
+    bool freePageReporting{true};  // guest hands freed pages back to the host
+    bool sharePages{true};         // false = <nosharepages/>: KSM skips this domain
 };
 
 struct GraphicsConfig {
     std::string type; // vnc, spice, sdl
     std::string listenAddress;
-    int port;
-    bool autoport;
+    int port{-1};
+    bool autoport{false};
 };
 
 struct VmConfig {
@@ -39,10 +95,11 @@ struct VmConfig {
     std::string arch;
     
     // الموارد
-    unsigned long memory; // in KB
-    unsigned long currentMemory; // in KB
-    unsigned int vcpus;
-    unsigned int maxVcpus;
+    unsigned long memory{0}; // in KB
+    unsigned long currentMemory{0}; // in KB؛ 0 = مثل memory
+    unsigned int vcpus{0};
+    unsigned int maxVcpus{0}; // 0 = مثل vcpus
+    unsigned int iothreads{0}; // <iothreads>؛ الأقراص تشير إليها بـ DiskConfig::iothread
     
     // التخزين والشبكات
     std::vector<DiskConfig> disks;
@@ -50,14 +107,42 @@ struct VmConfig {
     
     // إعدادات أخرى
     GraphicsConfig graphics;
+    CpuPlacement placement;
+    MemoryTuning memoryTuning;
+    std::string resourcePartition; // <resource><partition>: cgroup libvirt starts qemu in; empty = /machine
+    // <channel> org.qemu.guest_agent.0; also written when metadata "ready.agent"/"ready.services" ask for the agent
+    bool guestAgent{false};
     std::map<std::string, std::string> metadata;
     
     // التوافقية
     std::string emulator;
     
     // التهيئة من/إلى XML
-    static VmConfig fromXML(const std::string& xml);
+    // parse يقرأ كل الأقراص والشبكات والـ graphics والـ placement؛ metadata لا تُكتب في XML
+    [[nodiscard]] static Result<VmConfig> parse(std::string_view xml);
+    static VmConfig fromXML(const std::string& xml); // config فارغ إذا تعذّر التحليل
     std::string toXML() const;
+
+    // الكاتب الوحيد لـ domain XML: toXML والـ factory وقوالب DomainTemplateCache تستخدمه
+    static void writeXML(std::string& out, const VmConfig& cfg);
+    // namespace of the <metadata> element writeXML stamps on every domain: marks the ones PenHive defined
+    static constexpr std::string_view kMetadataNamespace = "https://penhive.dev/xmlns/domain/1.0";
+    // also the <memoryBacking> (hugepages of the placement, nosharepages of the tuning)
+    static void writePlacementXML(std::string& out, const CpuPlacement& placement, const MemoryTuning& memory);
+
+    // ملفات I/O: "lab-throwaway" (cache=unsafe, io_uring) و "persistent" (cache=none, native, iothreads)
+    [[nodiscard]] static const IoProfile* findIoProfile(std::string_view name) noexcept;
+    // fills the disk fields the caller left empty; "" = keep the config as is.
+    // Call after placement: iothreads are pinned next to the emulator threads.
+    [[nodiscard]] static Result<void> applyIoProfile(VmConfig& cfg, std::string_view profile);
+
+    // ملفات الشبكة: "vhost" (vhost-net بطابور واحد) و "throughput" (طابور لكل vCPU وحلقات أكبر)
+    [[nodiscard]] static const NetProfile* findNetProfile(std::string_view name) noexcept;
+    // like applyIoProfile, for the virtio NICs of cfg
+    [[nodiscard]] static Result<void> applyNetProfile(VmConfig& cfg, std::string_view profile);
+    static void applyNetProfile(NetworkConfig& nic, const NetProfile& profile, unsigned int vcpus);
+    // one <interface>; writeXML, VirtualMachineNic and hot-plug callers share it
+    static void writeInterfaceXML(std::string& out, const NetworkConfig& nic);
     
     // التحقق من الصحة
     bool validate() const;
@@ -2,7 +2,9 @@
 #include <libvirt/libvirt.h>
 #include <memory>
 #include <string>
+#include <string_view>
 #include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/DomainTemplateCache.hpp"
 #include "Virtualization/vmm/VirtualMachineConfig.hpp"
 #include "Utils/Result.hpp"
 
@@ -14,12 +16,14 @@ public:
 
     // يبني XML من VmConfig (implementation in .cpp)
     [[nodiscard]] Result<std::string> buildDomainXML(const VmConfig& cfg);
+    // نفس الـ XML لكن من قالب مُجمّع مسبقًا لـ templateId (يُجمَّع عند أول استخدام)؛ فارغ = buildDomainXML(cfg)
+    [[nodiscard]] Result<std::string> buildDomainXML(const VmConfig& cfg, std::string_view templateId);
+    [[nodiscard]] DomainTemplateCache& getTemplateCache() noexcept { return templates; }
 
     // يعرّف domain في libvirt ويعيد المقبض (implementation in .cpp)
     [[nodiscard]] Result<virDomainPtr> defineDomain(const std::string& xml);
 
 private:
     std::shared_ptr<HypervisorConnector> connector;
-};
-    [[nodiscard]] Result<virDomainPtr> defineDomain(const std::string& xml);
+    DomainTemplateCache templates;
 };
@@ -2,6 +2,7 @@
 #include <string>
 #include <memory>
 #include <string_view>
+#include <span>
 #include <vector>
 #include <mutex>
 #include <functional>
@@ -9,36 +10,153 @@
 #include <chrono>
 #include "Virtualization/vm/VirtualMachinePool.hpp"
 #include "Virtualization/vm/VirtualMachine.hpp"
+#include "Virtualization/vm/WarmPool.hpp"
 #include "Utils/Result.hpp"
 #include "Virtualization/vmm/HypervisorConnector.hpp"
 #include "Virtualization/vmm/VirtualMachineFactory.hpp"
 #include "Virtualization/vmm/VirtualMachineDriver.hpp"
 #include "Virtualization/vmm/VirtualMachineConfig.hpp"
+#include "Virtualization/vmm/DeployAdmission.hpp"
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include "Virtualization/vmm/DomainStateCache.hpp"
+#include "Virtualization/vmm/DomainRegistry.hpp"
+#include "Virtualization/vmm/DomainSummary.hpp"
+#include "Virtualization/vmm/VmConfigCache.hpp"
 #include "Core/concurrency/EventDispatcher.hpp"
+#include "Core/concurrency/TimerWheel.hpp"
+#include "Core/concurrency/Offload.hpp"
+#include "resources/allocation/LabSliceManager.hpp"
+#include "Virtualization/vm/MacAllocator.hpp"
+#include "Virtualization/vmm/BalloonController.hpp"
+#include "Virtualization/vmm/IdleSuspender.hpp"
+#include "Virtualization/vmm/NetworkFabric.hpp"
+#include "Virtualization/vmm/PlacementEngine.hpp"
+#include "Virtualization/vmm/ReadinessProber.hpp"
+#include "Virtualization/vmm/SnapshotEngine.hpp"
+#include "Virtualization/vmm/StartupReconciler.hpp"
+#include "Virtualization/vmm/UsageCollector.hpp"
 #include "Utils/Logger.hpp"
 
+// عنوان الـ VNC/SPICE الذي يتصل به console proxy
+struct ConsoleEndpoint {
+    std::string type; // vnc, spice
+    std::string host;
+    std::uint16_t port{0};
+};
+
 class VirtualMachineManager {
 public:
     // ctor: optional injected dispatcher (if null, manager creates its own)
+    // storage is only needed by warm-pool templates that clone a base image
     explicit VirtualMachineManager(std::shared_ptr<HypervisorConnector> conn,
-                                   std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher = nullptr);
+                                   std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher = nullptr,
+                                   std::shared_ptr<StorageOrchestrator> storage = nullptr);
     ~VirtualMachineManager();
 
     // synchronous deploy (blocking)
     [[nodiscard]] Result<int> dispatch_deploy(const VmConfig& cfg);
 
     // asynchronous deploy: schedules deploy on dispatcher, optional callback called with Result<int>
-    void dispatch_deploy_async(const VmConfig& cfg, std::function<void(Result<int>)> callback = nullptr);
+    // behind admission control the deploy is queued per tenant, or refused at once (callback not called)
+    std::optional<AdmissionRejection> dispatch_deploy_async(const VmConfig& cfg, std::function<void(Result<int>)> callback = nullptr);
+
+    // نشر lab كامل: بناء XML وتعريف الـ domains بالتوازي، ثم التشغيل على موجات (routers/switches أولًا)
+    // behind admission control each VM is admitted first (refused ones carry outcome.rejection) and starts in a gate slot
+    [[nodiscard]] Result<DeployBatchResult> deploy_batch(const std::vector<VmConfig>& cfgs);
+
+    // نسخة جاهزة من الـ warm pool إن وُجدت (resume + NIC rewiring)، وإلا نشر عادي عبر dispatch_deploy
+    [[nodiscard]] Result<int> deploy_from_template(std::string_view templateId, const VmConfig& cfg);
+    [[nodiscard]] WarmPool& getWarmPool() noexcept { return *warmPool; }
 
     // عمليات قراءة / حذف
     [[nodiscard]] Result<std::unique_ptr<VirtualMachine>> findDomainByName(std::string_view name);
+    [[nodiscard]] Result<std::unique_ptr<VirtualMachine>> findDomainByUuid(std::string_view uuid);
     [[nodiscard]] Result<std::vector<std::unique_ptr<VirtualMachine>>> listAllDomains();
+    // قائمة خفيفة لكل الـ domains (name/uuid/state/vCPU/memory) في استدعاء libvirt واحد
+    [[nodiscard]] Result<std::vector<DomainSummary>> listDomainSummaries(bool includeInactive = true);
     [[nodiscard]] Result<void> deleteDomain(std::string_view name, bool deleteStorage = false);
+    // الـ domain غادر هذا الـ host (ترحيل): سجله ومنفذ الـ console والـ MACs والحجوزات تُحرَّر بدون استدعاء libvirt
+    void releaseMigrated(std::string_view name);
+    // VmConfig الحالي للـ domain من XML الخاص به؛ لا يُعاد التحليل ما دام الـ XML لم يتغير
+    [[nodiscard]] Result<std::shared_ptr<const VmConfig>> getConfig(std::string_view name);
+
+    // حالة الـ domains من الذاكرة (DomainStateCache) بدون أي استدعاء libvirt
+    [[nodiscard]] Result<VirtualMachine::VmState> getState(std::string_view name) const;
+    [[nodiscard]] std::vector<DomainStateEntry> listStates() const;
+    [[nodiscard]] std::shared_ptr<DomainStateCache> getStateCache() const noexcept { return stateCache; }
+    // نتيجة مزامنة السجلات مع libvirt عند التشغيل؛ nullopt ما دامت جارية (عمليات النشر تنتظرها)
+    [[nodiscard]] std::optional<ReconcileReport> getStartupReport() const { return reconciler->report(); }
+    // مقابض الـ domains الحية حسب الاسم أو الـ uuid؛ القراءة لا تنتظر عمليات النشر
+    [[nodiscard]] const DomainRegistry& getDomainRegistry() const noexcept { return registry; }
+
+    // نسخ co_await للـ controllers: عمل libvirt يتم على الـ dispatcher والاستئناف على نفس event loop
+    // (لا يوجد أي استدعاء blocking على threads الخاصة بـ drogon)
+    [[nodiscard]] CONCURRENCY::Offload<Result<int>> co_deploy(VmConfig cfg);
+    [[nodiscard]] CONCURRENCY::Offload<Result<std::unique_ptr<VirtualMachine>>> co_find(std::string name);
+    [[nodiscard]] CONCURRENCY::Offload<Result<std::vector<DomainSummary>>> co_list(bool includeInactive = true);
+    [[nodiscard]] CONCURRENCY::Offload<Result<void>> co_delete(std::string name, bool deleteStorage = false);
 
-    // جدولة فحص حالة دورية للـ VM. تعيد flag للإلغاء (عند وضع true يتم إيقاف الفحص)
+    // منفذ الـ console من الـ pool (الـ XML الحي يغلب إن اختلف)، بعد استئناف الـ VM إن كانت خاملة
+    [[nodiscard]] Result<ConsoleEndpoint> consoleEndpoint(std::string_view name);
+    [[nodiscard]] CONCURRENCY::Offload<Result<ConsoleEndpoint>> co_console(std::string name);
+
+    // جدولة فحص حالة دورية للـ VM على الـ timer wheel. تعيد flag للإلغاء (عند وضع true يتم إيقاف الفحص)
     [[nodiscard]] std::shared_ptr<std::atomic<bool>> schedule_health_check(std::string vmName, std::chrono::seconds interval);
+    // wheel مشترك للمهام الدورية (health checks، انتهاء الـ sessions، جداول الـ snapshots)
+    [[nodiscard]] CONCURRENCY::TimerWheel& getTimerWheel() noexcept { return *timerWheel; }
+
+    // عزل الموارد لكل lab: بعد التشغيل تُنقل عملية qemu إلى cgroup الخاص بالـ lab (metadata["lab"])
+    void setLabSlices(std::shared_ptr<LabSliceManager> slices);
+    // شبكات ph-<lab>-... تُنشأ عند أول نشر عليها وتُحذف مع آخر VM في الـ lab
+    void setNetworkFabric(std::shared_ptr<NetworkFabric> fabric);
+    // تثبيت vCPUs وذاكرة كل VM على NUMA cell واحدة (ما لم يحدد VmConfig::placement مسبقاً)
+    void setPlacementEngine(std::shared_ptr<PlacementEngine> engine);
+    // عناوين MAC فريدة على مستوى الأسطول لكل NIC بدون عنوان، ورفض العناوين المكررة
+    void setMacAllocator(std::shared_ptr<MacAllocator> allocator);
+    // لقطة "ذهبية" قبل أول تشغيل لكل VM في lab أو من template، ليُعاد ضبطها بـ revert بدلاً من الحذف وإعادة النشر
+    void setSnapshotEngine(std::shared_ptr<SnapshotEngine> engine);
+    // حد لعمليات define/start المتزامنة وطوابير عادلة لكل tenant، مع رفض مبكر (429/503) عند الامتلاء
+    // يأخذ الـ placement engine والـ lab slices الحالية كمصادر للسعة
+    void setDeployAdmission(std::shared_ptr<DeployAdmission> admission);
+    [[nodiscard]] std::shared_ptr<DeployAdmission> getDeployAdmission() const { return std::atomic_load(&admission); }
+    // تقليص الـ balloon للـ VMs الخاملة دوريًا على الـ timer wheel (nullptr يوقفه)
+    void setBalloonController(std::shared_ptr<BalloonController> controller, std::chrono::seconds interval = std::chrono::seconds(15));
+    // إيقاف الـ VMs الخاملة مؤقتًا ثم managed save، واستئنافها عند أول وصول (co_find، الـ console)
+    void setIdleSuspender(std::shared_ptr<IdleSuspender> suspender, std::chrono::seconds interval = std::chrono::seconds(60));
+    // يستأنف الـ VM إن كانت موقوفة بسبب الخمول؛ لا شيء إن لم تكن كذلك
+    [[nodiscard]] Result<void> wake(std::string_view name);
+    [[nodiscard]] std::shared_ptr<IdleSuspender> getIdleSuspender() const { return std::atomic_load(&idleSuspender); }
+    // نشاط مستخدم على VM (إدخال console، جلسة SSH) يؤجل تعليقها؛ بدون IdleSuspender لا شيء
+    void touch(std::string_view name);
+    // فحص جاهزية الـ VMs بعد التشغيل (agent، عنوان، خدمات، منافذ TCP) لكل VM في lab؛ nullptr يوقفه
+    void setReadinessProber(std::shared_ptr<ReadinessProber> prober);
+    [[nodiscard]] std::shared_ptr<ReadinessProber> getReadinessProber() const { return std::atomic_load(&readiness); }
+    // سجل استهلاك كل VM (CPU، ذاكرة، قرص، شبكة) على الـ timer wheel، ويغذي الـ idle suspender والـ placement engine
+    void setUsageCollector(std::shared_ptr<UsageCollector> collector, std::chrono::seconds interval = std::chrono::seconds(10));
+    [[nodiscard]] std::shared_ptr<UsageCollector> getUsageCollector() const { return std::atomic_load(&usage); }
 
 private:
+    void isolate(const VmConfig& cfg);
+    void watchReadiness(const VmConfig& cfg); // lab VMs only
+    void wireAdmission(); // capacity sources of the admission follow setPlacementEngine / setLabSlices
+    // lab networks the NICs of cfgs are on, created in one fabric call; one error per config
+    [[nodiscard]] std::vector<std::string> ensureNetworks(std::span<const VmConfig> cfgs);
+    bool place(VmConfig& cfg); // true if a reservation was taken for cfg.name
+    void partition(VmConfig& cfg); // lab VMs: <resource><partition> of the lab's slice
+    void forget(const std::string& name); // everything this manager holds for a domain that is no longer here
+    void unplace(const std::string& name);
+    // new reservations are appended to reserved so a failed deploy can give them back
+    [[nodiscard]] Result<void> assignMacs(VmConfig& cfg, std::vector<std::string>& reserved);
+    void releaseMacs(std::vector<std::string>& reserved);
+    void snapshotGolden(virDomainPtr domain, const VmConfig& cfg); // defined, not yet started
+    // pins an autoport graphics device to a port from the pool and marks a fixed one taken;
+    // returns the port the pool record adopts, or VirtualMachinePool::kNoConsolePort
+    [[nodiscard]] int stampConsolePort(VmConfig& cfg);
+    // cached handle if its connection is still alive, else one lookup that refills the registry
+    [[nodiscard]] DomainHandlePtr handleOf(std::string_view name);
+    [[nodiscard]] DomainHandlePtr handleOfUuid(std::string_view uuid);
+    [[nodiscard]] static bool alive(const DomainHandle& handle) noexcept;
+
     std::shared_ptr<HypervisorConnector> connector;
     std::unique_ptr<VirtualMachinePool> vmpool;
     std::unique_ptr<VirtualMachineFactory> factory;
@@ -48,5 +166,30 @@ private:
     std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher_;
     bool own_dispatcher_{false};
 
-    std::mutex managerMutex;
+    std::shared_ptr<DomainStateCache> stateCache;
+    std::shared_ptr<StartupReconciler> reconciler;
+    std::unique_ptr<WarmPool> warmPool;
+    std::unique_ptr<CONCURRENCY::TimerWheel> timerWheel;
+    std::shared_ptr<LabSliceManager> labSlices; // atomic_load/atomic_store
+    std::shared_ptr<NetworkFabric> networkFabric; // atomic_load/atomic_store
+    std::shared_ptr<PlacementEngine> placement; // atomic_load/atomic_store
+    std::shared_ptr<MacAllocator> macAllocator; // atomic_load/atomic_store
+    std::shared_ptr<SnapshotEngine> snapshotEngine; // atomic_load/atomic_store
+    std::shared_ptr<BalloonController> balloons; // atomic_load/atomic_store
+    std::shared_ptr<IdleSuspender> idleSuspender; // atomic_load/atomic_store
+    std::shared_ptr<ReadinessProber> readiness; // atomic_load/atomic_store
+    std::shared_ptr<UsageCollector> usage; // atomic_load/atomic_store
+    std::atomic<std::uint64_t> usageListener{0};
+    // what the usage listener feeds; it holds these weakly, so a pass in flight never reaches a destroyed manager
+    struct UsageSinks {
+        std::shared_ptr<IdleSuspender> idle; // atomic_load/atomic_store
+        std::shared_ptr<PlacementEngine> placement; // atomic_load/atomic_store
+    };
+    std::shared_ptr<UsageSinks> usageSinks{std::make_shared<UsageSinks>()};
+    std::shared_ptr<DeployAdmission> admission; // atomic_load/atomic_store
+    VmConfigCache configCache;
+
+    // يحل محل managerMutex: كل shard خلف shared_mutex خاص به
+    DomainRegistry registry;
+    std::uint64_t registryListener{0};
 };
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+
+/**
+ * @brief Parsed VmConfig per domain, reused while its XML does not change
+ *
+ * Reconciliation passes fetch the same domain definitions again and again,
+ * and most of them are unchanged. Each entry keeps the hash and length of
+ * the XML it was parsed from; get() only hashes the fresh XML and hands out
+ * the shared immutable config when both match, so pugixml runs once per
+ * definition change. Entries are keyed by domain name, so the cache holds at
+ * most one config per domain. Call erase() when a domain is undefined.
+ */
+class VmConfigCache {
+public:
+    [[nodiscard]] Result<std::shared_ptr<const VmConfig>> get(std::string_view domain, std::string_view xml);
+    void erase(std::string_view domain);
+    void clear();
+    [[nodiscard]] std::size_t size() const;
+
+    struct Stats {
+        std::uint64_t hits{0};
+        std::uint64_t parses{0};
+    };
+    [[nodiscard]] Stats stats() const noexcept { return {hits.load(std::memory_order_relaxed), parses.load(std::memory_order_relaxed)}; }
+
+private:
+    struct Entry {
+        std::size_t hash{0};
+        std::size_t length{0};
+        std::shared_ptr<const VmConfig> config;
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Entry> entries;
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> parses{0};
+};
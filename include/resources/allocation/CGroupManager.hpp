@@ -1,40 +1,62 @@
-#include <cerrno>
-#include <fstream>
-#include <sys/stat.h>
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
 #include <sys/types.h>
-#include <system_error>
-#include <unistd.h>
-#include "c"
-class CGroupManager {
-private:
-  std::string cgroupPath;
+#include <unordered_map>
 
+/**
+ * @brief One cgroup v2 directory with its control files kept open
+ *
+ * Control files are opened on first write and the descriptor is reused for
+ * every later write (pwrite at offset 0), so re-applying limits or moving
+ * many PIDs costs one syscall each instead of open/write/close.
+ * Errors are reported as std::system_error carrying the errno.
+ */
+class CGroupManager {
 public:
-  CGroupManager(const std::string& name) {
-    cgroupPath = "/sys/fs/cgroup/" + name;
-    createCGroup();
-  }
+    // 0 in any limit below means "max" (no limit)
+    static constexpr std::uint64_t kUnlimited = 0;
+
+    // name relative to root, e.g. "penhive.slice/lab-red"; created if missing
+    explicit CGroupManager(const std::string& name, std::string root = "/sys/fs/cgroup");
+    ~CGroupManager();
 
-  void createCGroup() {
-    if (mkdir(cgroupPath.c_str(), 0755) != 0 && errno != EEXIST) {
-      throw std::system_error(errno, std::system_category(), "Failed to create cgroup");
-    }
-  }
+    CGroupManager(const CGroupManager&) = delete;
+    CGroupManager& operator=(const CGroupManager&) = delete;
 
-  void setCPULimit(unsigned long quota_us, unsigned long period_us = 100000) {
-    writeValue("cpu.max", std::to_string(quota_us) + " " + std::to_string(period_us));
-  }
+    void createCGroup();
+    // rmdir; fails with EBUSY while processes or child groups remain
+    void remove();
 
-  void setMemoryLimit(const std::string& limit) { writeValue("memory.max", limit); }
+    // "+cpu +memory +io +pids" in cgroup.subtree_control so children get these controllers
+    void enableControllers(std::string_view controllers = "+cpu +memory +io +pids");
 
-  void addProcess(pid_t pid) { writeValue("cgroup.procs", std::to_string(pid)); }
+    void setCPULimit(unsigned long quota_us, unsigned long period_us = 100000);
+    void setCPUWeight(unsigned int weight); // 1..10000, default 100
+    void setMemoryLimit(const std::string& limit);
+    void setMemoryLimit(std::uint64_t bytes);
+    void setMemoryHigh(std::uint64_t bytes); // throttle + reclaim before memory.max OOM-kills
+    // device is "MAJ:MIN"; 0 = max for each field
+    void setIOLimit(const std::string& device, std::uint64_t rbps, std::uint64_t wbps,
+                    std::uint64_t riops = kUnlimited, std::uint64_t wiops = kUnlimited);
+    void setPidsLimit(std::uint64_t max);
+
+    // moves the whole process (all threads)
+    void addProcess(pid_t pid);
+
+    // single-number files such as memory.current; "max" reads as kUnlimited
+    [[nodiscard]] std::uint64_t readValue(const std::string& file) const;
+
+    [[nodiscard]] const std::string& path() const noexcept { return cgroupPath; }
 
 private:
-  void writeValue(const std::string& file, const std::string& value) {
-    std::ofstream f(cgroupPath + "/" + file);
-    if (!f) {
-      throw std::runtime_error("Cannot write to cgroup file: " + file);
-    }
-    f << value;
-  }
+    void writeValue(const std::string& file, const std::string& value);
+    int fdOf(const std::string& file);
+    void closeAll() noexcept;
+
+    std::string cgroupPath;
+    std::mutex mutex_;
+    std::unordered_map<std::string, int> fds;
 };
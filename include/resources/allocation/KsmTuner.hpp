@@ -0,0 +1,44 @@
+#pragma once
+#include "Utils/Result.hpp"
+#include <cstdint>
+#include <string>
+
+struct KsmSettings {
+    unsigned int pagesToScan{1000};   // per wake-up; the kernel default (100) is far too slow for dozens of clones
+    unsigned int sleepMillisecs{20};
+    bool mergeAcrossNodes{false};     // keep merged pages NUMA-local, matching PlacementEngine pinning
+};
+
+struct KsmStats {
+    std::uint64_t pagesShared{0};   // distinct merged pages
+    std::uint64_t pagesSharing{0};  // mappings that point at them (the sharing that is saved)
+    std::uint64_t pagesUnshared{0};
+    std::uint64_t fullScans{0};
+    std::uint64_t savedBytes{0};    // pagesSharing * page size
+    bool running{false};
+};
+
+/**
+ * @brief Host side of page sharing: /sys/kernel/mm/ksm
+ *
+ * Lab images are near-identical (the same Metasploitable or Windows base
+ * booted many times), so KSM merges a large part of their guest memory.
+ * qemu marks guest RAM mergeable unless a domain opts out with
+ * <nosharepages/> (VmConfig::memoryTuning.sharePages); the kernel only
+ * scans when ksm/run is 1. merge_across_nodes can only change while no
+ * page is merged, so enable() writes it before switching KSM on.
+ */
+class KsmTuner {
+public:
+    explicit KsmTuner(std::string sysfsRoot = "/sys/kernel/mm/ksm");
+
+    [[nodiscard]] Result<void> enable(const KsmSettings& settings = {});
+    [[nodiscard]] Result<void> disable(); // stops scanning, keeps already merged pages
+    [[nodiscard]] Result<KsmStats> stats() const;
+
+private:
+    [[nodiscard]] Result<void> write(const char* file, const std::string& value) const;
+    [[nodiscard]] Result<std::uint64_t> read(const char* file) const;
+
+    std::string root;
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include "resources/allocation/CGroupManager.hpp"
+#include "Utils/Result.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct IoLimit {
+    std::string device; // "MAJ:MIN" of the block device backing the storage pool
+    std::uint64_t rbps{0};
+    std::uint64_t wbps{0};
+    std::uint64_t riops{0};
+    std::uint64_t wiops{0};
+};
+
+// Aggregate limits of one lab/tenant; 0 = unlimited
+struct SliceLimits {
+    std::uint64_t cpuQuotaUs{0};
+    std::uint64_t cpuPeriodUs{100000};
+    unsigned int cpuWeight{100};
+    std::uint64_t memoryMaxBytes{0};
+    std::uint64_t memoryHighBytes{0};
+    std::uint64_t pidsMax{0};
+    std::vector<IoLimit> io;
+};
+
+/**
+ * @brief One cgroup v2 slice per lab/tenant holding its qemu processes
+ *
+ *   <root>/penhive.slice/lab-<id>.partition/<libvirt's machine scope>
+ *
+ * Limits are set on the lab group, so all VMs of a lab share one CPU,
+ * memory, io and pids budget and a noisy lab only throttles itself. The
+ * lab of a VM comes from VmConfig::metadata["lab"] (or "tenant"). Domains
+ * are defined with <resource><partition> set to partitionFor(lab), so
+ * libvirt starts qemu inside the lab group and creates and removes the
+ * per-VM leaf itself; nothing is moved after start. The group names carry
+ * a dot so libvirt uses them as is instead of appending ".partition".
+ * This needs libvirt's plain cgroup backend: under systemd (machined),
+ * partitions must be systemd slices below /machine.
+ */
+class LabSliceManager {
+public:
+    explicit LabSliceManager(std::string cgroupRoot = "/sys/fs/cgroup",
+                             std::string sliceName = "penhive.slice");
+
+    // limits used for labs without their own entry
+    void setDefaultLimits(SliceLimits limits);
+    // creates the lab group if needed and (re)applies the limits
+    [[nodiscard]] Result<void> setLimits(const std::string& lab, const SliceLimits& limits);
+    // creates the lab group if needed; the <resource><partition> for the lab's domains
+    [[nodiscard]] Result<std::string> partitionFor(const std::string& lab);
+    // records a domain defined in the lab's partition (for removeLab) and the memory it was given
+    void attachDomain(const std::string& lab, const std::string& domainName, std::uint64_t memoryBytes = 0);
+    void detachDomain(const std::string& domainName);
+    // removes the lab group; fails while VMs are still inside
+    [[nodiscard]] Result<void> removeLab(const std::string& lab);
+
+    // bytes the lab may still commit before memory.max: the limit minus what its domains were
+    // given, or minus memory.current when that is more; nullopt when the lab has no memory limit
+    [[nodiscard]] std::optional<std::uint64_t> memoryRoom(const std::string& lab) const;
+
+    [[nodiscard]] std::vector<std::string> labs() const;
+    [[nodiscard]] static std::optional<std::string> labOf(const VmConfig& cfg);
+
+private:
+    struct Lab {
+        std::unique_ptr<CGroupManager> group;
+        SliceLimits limits;
+    };
+
+    static bool validName(const std::string& name);
+    static std::string groupName(const std::string& lab);
+    Lab& ensureLab(const std::string& lab);
+    static void apply(CGroupManager& group, const SliceLimits& limits);
+
+    std::string sliceName;
+    std::string root;
+    mutable std::mutex mutex_;
+    std::unique_ptr<CGroupManager> slice;
+    SliceLimits defaults;
+    std::unordered_map<std::string, Lab> labs_;
+    struct Member {
+        std::string lab;
+        std::uint64_t memoryBytes{0};
+    };
+
+    std::unordered_map<std::string, Member> domainLab; // domain -> lab
+};
@@ -1,40 +1,138 @@
-#include "/home/hussin/Desktop/PenHive/include/Core/concurrency/EventDispatcher.hpp"
+#include "Core/concurrency/EventDispatcher.hpp"
+#include "Core/concurrency/RecyclingAllocator.hpp"
+#include "Core/concurrency/WorkStealingPool.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Core/tracing/Trace.hpp"
 #include <boost/system/error_code.hpp>
+#include <array>
 #include <atomic>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
 #include <iostream>
 
 namespace CONCURRENCY {
 
+struct TimerPool;
+
 //
 // Timer::Impl
 //
+// One steady_timer reused across arms. Every arm/cancel bumps the generation,
+// so a completion that belongs to an earlier arm is ignored. The mutex
+// serializes access to the steady_timer, which is not thread-safe.
 struct Timer::Impl {
+    using Forward = void (*)(void* ctx, Task task);
+
     asio::steady_timer timer;
-    std::function<void()> cb;
-    std::atomic<bool> cancelled;
+    std::mutex mutex_;
+    Task cb;
+    std::uint64_t generation{0};
+    // WorkStealing mode: expired callbacks are handed to the CPU lane instead of running here
+    Forward forward{nullptr};
+    void* forward_ctx{nullptr};
+    std::weak_ptr<TimerPool> pool;
 
-    Impl(asio::io_context& io, std::chrono::steady_clock::duration dur, std::function<void()> cb_)
-        : timer(io, dur), cb(std::move(cb_)), cancelled(false)
-    {
-        timer.async_wait([self = this](const boost::system::error_code& ec) {
-            if (ec || self->cancelled.load()) return;
-            try {
-                if (self->cb) self->cb();
-            } catch (...) {
-                // swallow exceptions to avoid terminating io thread
-            }
-        });
+    explicit Impl(asio::io_context& io) : timer(io) {}
+
+    // completion handler: small, allocated from the recycling cache
+    struct Fired {
+        std::shared_ptr<Impl> self;
+        std::uint64_t gen;
+        using allocator_type = RecyclingAllocator<void>;
+        allocator_type get_allocator() const noexcept { return {}; }
+        void operator()(const boost::system::error_code& ec) { if (!ec) self->fire(gen); }
+    };
+
+    static void arm(const std::shared_ptr<Impl>& self, std::chrono::steady_clock::duration dur, Task f) {
+        std::lock_guard lock(self->mutex_);
+        self->cb = std::move(f);
+        const auto gen = ++self->generation;
+        self->timer.expires_after(dur);
+        self->timer.async_wait(Fired{self, gen});
+    }
+
+    void fire(std::uint64_t gen) {
+        Task f;
+        {
+            std::lock_guard lock(mutex_);
+            if (gen != generation) return;
+            f = std::move(cb);
+            ++generation;
+        }
+        if (!f) return;
+        if (forward) {
+            forward(forward_ctx, std::move(f));
+            return;
+        }
+        try {
+            f();
+        } catch (...) {
+            // swallow exceptions to avoid terminating io thread
+        }
     }
 
     void cancel() {
-        cancelled.store(true);
-        boost::system::error_code ec;
-        timer.cancel(ec);
+        Task dropped;
+        {
+            std::lock_guard lock(mutex_);
+            ++generation;
+            dropped = std::move(cb);
+            boost::system::error_code ec;
+            timer.cancel(ec);
+        }
+        // captures are destroyed outside the lock: they may own other timers
     }
 };
 
-Timer::Timer(asio::io_context& io, std::chrono::steady_clock::duration dur, std::function<void()> cb)
-    : impl_(std::make_shared<Impl>(io, dur, std::move(cb)))
+// Free list of Timer::Impl objects bound to one io_context
+struct TimerPool {
+    static constexpr size_t kMaxIdle = 4096;
+
+    asio::io_context& io;
+    Timer::Impl::Forward forward{nullptr};
+    void* forward_ctx{nullptr};
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Timer::Impl>> idle;
+
+    explicit TimerPool(asio::io_context& io_) : io(io_) {}
+
+    std::shared_ptr<Timer::Impl> acquire(const std::shared_ptr<TimerPool>& self) {
+        {
+            std::lock_guard lock(mutex_);
+            if (!idle.empty()) {
+                auto impl = std::move(idle.back());
+                idle.pop_back();
+                return impl;
+            }
+        }
+        auto impl = std::allocate_shared<Timer::Impl>(RecyclingAllocator<Timer::Impl>{}, io);
+        impl->forward = forward;
+        impl->forward_ctx = forward_ctx;
+        impl->pool = self;
+        return impl;
+    }
+
+    void release(std::shared_ptr<Timer::Impl> impl) {
+        std::lock_guard lock(mutex_);
+        if (idle.size() < kMaxIdle) idle.push_back(std::move(impl));
+    }
+
+    void clear() {
+        std::lock_guard lock(mutex_);
+        idle.clear();
+    }
+};
+
+Timer::Timer(asio::io_context& io, std::chrono::steady_clock::duration dur, Task cb)
+    : impl_(std::make_shared<Impl>(io))
+{
+    Impl::arm(impl_, dur, std::move(cb));
+}
+
+Timer::Timer(std::shared_ptr<Impl> pooled) noexcept
+    : impl_(std::move(pooled))
 {}
 
 void Timer::cancel() {
@@ -43,25 +141,106 @@ void Timer::cancel() {
 
 Timer::~Timer() {
     cancel();
+    if (!impl_) return;
+    if (auto pool = impl_->pool.lock()) pool->release(std::move(impl_));
 }
 
 //
 // EventDispatcher::Impl
 //
 struct EventDispatcher::Impl {
+    ExecutorMode mode{ExecutorMode::SharedQueue};
+    // SharedQueue: runs every task; WorkStealing: runs timers only
     asio::io_context io_ctx;
-    asio::executor_work_guard<asio::io_context::executor_type> work_guard;
+    // optional so a stop()/start() cycle can re-arm it
+    std::optional<asio::executor_work_guard<asio::io_context::executor_type>> work_guard;
     std::vector<std::thread> threads;
     size_t thread_count{1};
+    size_t blocking_count{0};
     std::atomic<bool> running{false};
 
-    explicit Impl(size_t threads_count)
-        : io_ctx(), work_guard(asio::make_work_guard(io_ctx)), thread_count(threads_count)
-    {}
+    // SharedQueue blocking lane
+    std::unique_ptr<asio::thread_pool> blocking_pool;
+    std::atomic<size_t> cpu_queued{0};
+    std::atomic<size_t> blocking_queued{0};
+    std::atomic<std::uint64_t> executed{0};
+
+    // WorkStealing lanes
+    std::unique_ptr<WorkStealingPool> cpu_ws;
+    std::unique_ptr<WorkStealingPool> blocking_ws;
+
+    // ranked tasks per lane + deadline-miss bookkeeping
+    static constexpr size_t kMissHistory = 256;
+    std::array<PriorityTaskQueue, 2> ranked;
+    std::atomic<std::uint64_t> missed_count{0};
+    mutable std::mutex miss_mutex;
+    std::deque<MissedDeadline> misses;
+    std::function<void(const MissedDeadline&)> miss_handler;
+
+    // declared after io_ctx so pooled steady_timers are destroyed first
+    std::shared_ptr<TimerPool> timer_pool;
+
+    // per lane (Cpu, Blocking): time a task waited in the queue and time it ran (SharedQueue mode)
+    std::array<METRICS::Histogram*, 2> wait_hist{};
+    std::array<METRICS::Histogram*, 2> run_hist{};
+    std::vector<std::uint64_t> gauge_ids;
+
+    Impl(ExecutorMode m, size_t threads_count, size_t blocking_threads)
+        : mode(m), io_ctx(), work_guard(std::in_place, asio::make_work_guard(io_ctx)),
+          thread_count(threads_count), blocking_count(blocking_threads),
+          timer_pool(std::make_shared<TimerPool>(io_ctx))
+    {
+        if (mode == ExecutorMode::WorkStealing) {
+            // each worker drains urgent ranked work of its lane before its next task
+            cpu_ws = std::make_unique<WorkStealingPool>(thread_count, [this] { drain_urgent(Lane::Cpu); });
+            if (blocking_count > 0) {
+                blocking_ws = std::make_unique<WorkStealingPool>(blocking_count, [this] { drain_urgent(Lane::Blocking); });
+            }
+            timer_pool->forward = [](void* ctx, Task task) { static_cast<Impl*>(ctx)->post(Lane::Cpu, std::move(task)); };
+            timer_pool->forward_ctx = this;
+        }
+        register_metrics();
+    }
+
+    ~Impl() {
+        for (auto id : gauge_ids) METRICS::MetricsRegistry::global().removeGauge(id);
+        timer_pool->clear();
+    }
+
+    void register_metrics() {
+        auto& registry = METRICS::MetricsRegistry::global();
+        static std::atomic<unsigned> seq{0};
+        const std::string id = std::to_string(seq.fetch_add(1));
+        for (Lane lane : {Lane::Cpu, Lane::Blocking}) {
+            const std::string name = lane == Lane::Cpu ? "cpu" : "blocking";
+            const std::size_t i = lane == Lane::Blocking ? 1 : 0;
+            wait_hist[i] = &registry.histogram("penhive_dispatcher_task_wait_seconds", "Time a task spent queued before it ran", {{"lane", name}});
+            run_hist[i] = &registry.histogram("penhive_dispatcher_task_run_seconds", "Time a dispatched task ran", {{"lane", name}});
+            gauge_ids.push_back(registry.gaugeFn("penhive_dispatcher_queue_depth", "Tasks waiting per dispatcher lane",
+                {{"dispatcher", id}, {"lane", name}}, [this, lane] { return static_cast<double>(depth(lane)); }));
+        }
+    }
+
+    [[nodiscard]] size_t depth(Lane lane) const {
+        if (mode == ExecutorMode::WorkStealing) {
+            if (lane == Lane::Blocking) return blocking_ws ? blocking_ws->queued() : 0;
+            return cpu_ws->queued();
+        }
+        return (lane == Lane::Blocking && blocking_count > 0 ? blocking_queued : cpu_queued).load(std::memory_order_relaxed);
+    }
 
     void run_threads() {
         if (running.exchange(true)) return;
-        for (size_t i = 0; i < thread_count; ++i) {
+        if (mode == ExecutorMode::WorkStealing) {
+            cpu_ws->start();
+            if (blocking_ws) blocking_ws->start();
+        } else if (blocking_count > 0) {
+            blocking_pool = std::make_unique<asio::thread_pool>(blocking_count);
+        }
+        if (io_ctx.stopped()) io_ctx.restart();
+        if (!work_guard) work_guard.emplace(asio::make_work_guard(io_ctx));
+        const size_t io_threads = mode == ExecutorMode::WorkStealing ? 1 : thread_count;
+        for (size_t i = 0; i < io_threads; ++i) {
             threads.emplace_back([this]() {
                 try {
                     io_ctx.run();
@@ -84,13 +263,118 @@ struct EventDispatcher::Impl {
             if (t.joinable()) t.join();
         }
         threads.clear();
+        if (blocking_pool) {
+            blocking_pool->stop();
+            blocking_pool->join();
+            blocking_pool.reset();
+        }
+        if (cpu_ws) cpu_ws->stop();
+        if (blocking_ws) blocking_ws->stop();
+        cpu_queued.store(0);
+        blocking_queued.store(0);
+        for (auto& q : ranked) q.clear();
         // reset io_context to allow potential restart
         io_ctx.reset();
     }
+
+    // asio handler for SharedQueue mode: keeps queue depth exact, drains urgent
+    // ranked work first, and takes its op memory from the recycling cache
+    struct Job {
+        Impl* impl;
+        Lane lane;
+        std::atomic<size_t>* depth;
+        Task fn;
+        std::chrono::steady_clock::time_point queued{std::chrono::steady_clock::now()};
+
+        using allocator_type = RecyclingAllocator<void>;
+        allocator_type get_allocator() const noexcept { return {}; }
+
+        void operator()() {
+            depth->fetch_sub(1, std::memory_order_relaxed);
+            impl->drain_urgent(lane);
+            const std::size_t i = lane == Lane::Blocking ? 1 : 0;
+            const auto started = std::chrono::steady_clock::now();
+            impl->wait_hist[i]->observe(started - queued);
+            try {
+                fn();
+            } catch (...) {
+                // swallow exceptions to avoid terminating io thread
+            }
+            impl->run_hist[i]->observe(std::chrono::steady_clock::now() - started);
+            impl->executed.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    void post(Lane lane, Task f) {
+        if (mode == ExecutorMode::WorkStealing) {
+            if (lane == Lane::Blocking && blocking_ws) blocking_ws->submit(std::move(f));
+            else cpu_ws->submit(std::move(f));
+            return;
+        }
+        if (lane == Lane::Blocking && blocking_pool) {
+            blocking_queued.fetch_add(1, std::memory_order_relaxed);
+            asio::post(*blocking_pool, Job{this, lane, &blocking_queued, std::move(f)});
+        } else {
+            cpu_queued.fetch_add(1, std::memory_order_relaxed);
+            asio::post(io_ctx, Job{this, lane, &cpu_queued, std::move(f)});
+        }
+    }
+
+    PriorityTaskQueue& queue_of(Lane lane) { return ranked[lane == Lane::Blocking ? 1 : 0]; }
+
+    void run_ranked(Lane lane, PriorityTaskQueue::Item& task) {
+        if (task.deadline) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now > *task.deadline) record_miss(MissedDeadline{task.priority, lane, *task.deadline, now - *task.deadline});
+        }
+        try {
+            task.fn();
+        } catch (...) {
+            // swallow exceptions to avoid terminating the worker
+        }
+    }
+
+    void record_miss(const MissedDeadline& miss) {
+        missed_count.fetch_add(1, std::memory_order_relaxed);
+        std::function<void(const MissedDeadline&)> handler;
+        {
+            std::lock_guard lock(miss_mutex);
+            if (misses.size() == kMissHistory) misses.pop_front();
+            misses.push_back(miss);
+            handler = miss_handler;
+        }
+        if (handler) {
+            try { handler(miss); } catch (...) {}
+        }
+    }
+
+    // runs interactive/high tasks queued on this lane before the caller's own Normal task
+    void drain_urgent(Lane lane) {
+        auto& q = queue_of(lane);
+        while (q.hasUrgent()) {
+            auto task = q.popUrgent();
+            if (!task) break;
+            run_ranked(lane, *task);
+        }
+    }
+
+    void post_ranked(Lane lane, PriorityTaskQueue::Item task) {
+        queue_of(lane).push(std::move(task));
+        // one token per task; a token finding the queue empty means a Normal task drained it first
+        post(lane, [this, lane]() {
+            if (auto next = queue_of(lane).pop()) run_ranked(lane, *next);
+        });
+    }
 };
 
 EventDispatcher::EventDispatcher(size_t threads)
-    : impl_(std::make_unique<Impl>(threads == 0 ? 1 : threads))
+    : impl_(std::make_unique<Impl>(ExecutorMode::SharedQueue, threads == 0 ? 1 : threads, 0))
+{
+    impl_->run_threads();
+}
+
+EventDispatcher::EventDispatcher(ExecutorMode mode, size_t cpuThreads, size_t blockingThreads)
+    : impl_(std::make_unique<Impl>(mode, cpuThreads == 0 ? 1 : cpuThreads, blockingThreads))
 {
     impl_->run_threads();
 }
@@ -99,15 +383,44 @@ EventDispatcher::~EventDispatcher() {
     stop();
 }
 
-void EventDispatcher::dispatch(std::function<void()> f) {
+void EventDispatcher::dispatch(Task f) {
+    dispatch(Lane::Cpu, std::move(f));
+}
+
+namespace {
+
+// a task dispatched inside a traced request runs in that trace; untraced tasks are not wrapped
+Task inheritTrace(Task f) {
+    const auto ctx = TRACING::TraceContext::current();
+    if (!ctx.valid()) return f;
+    return [ctx, f = std::move(f)]() mutable {
+        TRACING::ContextScope scope(ctx);
+        f();
+    };
+}
+
+} // namespace
+
+void EventDispatcher::dispatch(Lane lane, Task f) {
     if (!f) return;
-    asio::post(impl_->io_ctx, std::move(f));
+    impl_->post(lane, inheritTrace(std::move(f)));
 }
 
-std::shared_ptr<Timer> EventDispatcher::dispatch_delayed(std::chrono::steady_clock::duration dur, std::function<void()> f) {
+void EventDispatcher::dispatch(Priority prio, Deadline deadline, Task f, Lane lane) {
+    if (!f) return;
+    f = inheritTrace(std::move(f));
+    if (prio == Priority::Normal && !deadline) {
+        impl_->post(lane, std::move(f));
+        return;
+    }
+    impl_->post_ranked(lane, PriorityTaskQueue::Item{std::move(f), prio, deadline});
+}
+
+std::shared_ptr<Timer> EventDispatcher::dispatch_delayed(std::chrono::steady_clock::duration dur, Task f) {
     if (!f) return nullptr;
-    auto timer = std::make_shared<Timer>(impl_->io_ctx, dur, std::move(f));
-    return timer;
+    auto impl = impl_->timer_pool->acquire(impl_->timer_pool);
+    Timer::Impl::arm(impl, dur, std::move(f));
+    return std::allocate_shared<Timer>(RecyclingAllocator<Timer>{}, std::move(impl));
 }
 
 void EventDispatcher::start() {
@@ -118,4 +431,43 @@ void EventDispatcher::stop() {
     impl_->stop_threads();
 }
 
+ExecutorMode EventDispatcher::mode() const noexcept {
+    return impl_->mode;
+}
+
+DispatcherStats EventDispatcher::stats() const {
+    DispatcherStats st;
+    st.mode = impl_->mode;
+    st.cpuThreads = impl_->thread_count;
+    st.blockingThreads = impl_->blocking_count;
+    if (impl_->mode == ExecutorMode::WorkStealing) {
+        st.cpuQueued = impl_->cpu_ws->queued();
+        st.steals = impl_->cpu_ws->steals();
+        st.executed = impl_->cpu_ws->executed();
+        st.cpuDepths = impl_->cpu_ws->depths();
+        if (impl_->blocking_ws) {
+            st.blockingQueued = impl_->blocking_ws->queued();
+            st.steals += impl_->blocking_ws->steals();
+            st.executed += impl_->blocking_ws->executed();
+        }
+    } else {
+        st.cpuQueued = impl_->cpu_queued.load(std::memory_order_relaxed);
+        st.blockingQueued = impl_->blocking_queued.load(std::memory_order_relaxed);
+        st.executed = impl_->executed.load(std::memory_order_relaxed);
+    }
+    st.rankedQueued = impl_->ranked[0].size() + impl_->ranked[1].size();
+    st.missedDeadlines = impl_->missed_count.load(std::memory_order_relaxed);
+    return st;
+}
+
+std::vector<MissedDeadline> EventDispatcher::missed_deadlines() const {
+    std::lock_guard lock(impl_->miss_mutex);
+    return {impl_->misses.begin(), impl_->misses.end()};
+}
+
+void EventDispatcher::on_deadline_missed(std::function<void(const MissedDeadline&)> handler) {
+    std::lock_guard lock(impl_->miss_mutex);
+    impl_->miss_handler = std::move(handler);
+}
+
 } // namespace CONCURRENCY
@@ -0,0 +1,46 @@
+#include "Core/concurrency/PriorityTaskQueue.hpp"
+
+namespace CONCURRENCY {
+
+void PriorityTaskQueue::push(Item item) {
+    const auto cls = static_cast<std::size_t>(item.priority);
+    // tasks without a deadline sort after every dated one and keep FIFO order by seq
+    const auto key = item.deadline.value_or(Clock::time_point::max());
+    std::lock_guard lock(mutex_);
+    classes[cls].push(Entry{key, ++seq, std::move(item)});
+    total.fetch_add(1, std::memory_order_relaxed);
+    if (cls < static_cast<std::size_t>(Priority::Normal)) urgent.fetch_add(1, std::memory_order_release);
+}
+
+std::optional<PriorityTaskQueue::Item> PriorityTaskQueue::popFrom(std::size_t lastClass) {
+    std::lock_guard lock(mutex_);
+    for (std::size_t cls = 0; cls <= lastClass; ++cls) {
+        auto& heap = classes[cls];
+        if (heap.empty()) continue;
+        // priority_queue::top() is const; the entry is discarded right after, so moving out is safe
+        Item item = std::move(const_cast<Entry&>(heap.top()).item);
+        heap.pop();
+        total.fetch_sub(1, std::memory_order_relaxed);
+        if (cls < static_cast<std::size_t>(Priority::Normal)) urgent.fetch_sub(1, std::memory_order_release);
+        return item;
+    }
+    return std::nullopt;
+}
+
+std::optional<PriorityTaskQueue::Item> PriorityTaskQueue::pop() {
+    return popFrom(classes.size() - 1);
+}
+
+std::optional<PriorityTaskQueue::Item> PriorityTaskQueue::popUrgent() {
+    if (!hasUrgent()) return std::nullopt;
+    return popFrom(static_cast<std::size_t>(Priority::Normal) - 1);
+}
+
+void PriorityTaskQueue::clear() {
+    std::lock_guard lock(mutex_);
+    for (auto& heap : classes) heap = Heap{};
+    total.store(0, std::memory_order_relaxed);
+    urgent.store(0, std::memory_order_release);
+}
+
+} // namespace CONCURRENCY
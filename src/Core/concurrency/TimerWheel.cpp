@@ -0,0 +1,232 @@
+#include "Core/concurrency/TimerWheel.hpp"
+#include <algorithm>
+
+namespace CONCURRENCY {
+
+TimerWheel::TimerWheel(std::shared_ptr<EventDispatcher> dispatcher_, std::chrono::milliseconds tick)
+    : dispatcher(std::move(dispatcher_)),
+      tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1)),
+      origin(Clock::now()),
+      rng(std::random_device{}()),
+      counters(std::make_shared<Counters>())
+{
+    heads.fill(kNil);
+    driver = std::thread([this] { run(); });
+}
+
+TimerWheel::~TimerWheel() {
+    stop();
+}
+
+void TimerWheel::stop() {
+    {
+        std::lock_guard lock(mutex_);
+        if (stopping) return;
+        stopping = true;
+    }
+    wake.notify_all();
+    if (driver.joinable()) driver.join();
+    std::lock_guard lock(mutex_);
+    for (auto& n : nodes) {
+        if (n.job) n.job->cancelled.store(true, std::memory_order_relaxed);
+        n.job.reset();
+    }
+}
+
+TimerId TimerWheel::schedule_once(Clock::duration delay, Task fn, WheelJobOptions opts) {
+    return add(delay, Clock::duration::zero(), std::move(fn), opts);
+}
+
+TimerId TimerWheel::schedule_every(Clock::duration interval, Task fn, WheelJobOptions opts) {
+    if (interval <= Clock::duration::zero()) return {};
+    return add(interval, interval, std::move(fn), opts);
+}
+
+TimerId TimerWheel::add(Clock::duration delay, Clock::duration interval, Task fn, const WheelJobOptions& opts) {
+    if (!fn) return {};
+    auto job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+    job->lane = opts.lane;
+    job->priority = opts.priority;
+    job->cancelFlag = opts.cancelFlag;
+
+    std::lock_guard lock(mutex_);
+    if (stopping) return {};
+    std::uint32_t idx;
+    if (!freeList.empty()) {
+        idx = freeList.back();
+        freeList.pop_back();
+    } else {
+        idx = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    Node& n = nodes[idx];
+    n.job = std::move(job);
+    n.interval = interval > Clock::duration::zero() ? std::max<std::uint64_t>(toTicks(interval), 1) : 0;
+    n.jitter = toTicks(opts.jitter);
+    // absolute tick, rounded up: a job never fires before its delay has passed
+    n.base = std::max(toTicks(Clock::now() - origin + delay), now + 1);
+    n.expiry = n.base + jitterTicks(n.jitter);
+    link(idx);
+    ++active;
+    return TimerId{idx, n.generation};
+}
+
+bool TimerWheel::cancel(TimerId id) noexcept {
+    std::lock_guard lock(mutex_);
+    if (!id || id.index >= nodes.size()) return false;
+    Node& n = nodes[id.index];
+    if (n.generation != id.generation || !n.job) return false;
+    n.job->cancelled.store(true, std::memory_order_relaxed);
+    unlink(id.index);
+    release(id.index);
+    return true;
+}
+
+TimerWheelStats TimerWheel::stats() const {
+    TimerWheelStats st;
+    {
+        std::lock_guard lock(mutex_);
+        st.jobs = active;
+    }
+    st.fired = counters->fired.load(std::memory_order_relaxed);
+    st.skipped = counters->skipped.load(std::memory_order_relaxed);
+    return st;
+}
+
+std::uint64_t TimerWheel::toTicks(Clock::duration d) const noexcept {
+    if (d <= Clock::duration::zero()) return 0;
+    const auto t = std::chrono::duration_cast<Clock::duration>(tick_);
+    return static_cast<std::uint64_t>((d + t - Clock::duration(1)) / t);
+}
+
+std::uint64_t TimerWheel::jitterTicks(std::uint64_t maxTicks) {
+    if (maxTicks == 0) return 0;
+    return std::uniform_int_distribution<std::uint64_t>(0, maxTicks)(rng);
+}
+
+// Level = lowest level whose slot index is the first place expiry and now differ;
+// everything above that level is identical, so the slot is reached by the cascade in time.
+void TimerWheel::link(std::uint32_t idx) {
+    Node& n = nodes[idx];
+    if (n.expiry <= now) n.expiry = now + 1;
+    std::uint32_t bucket = kOverflow;
+    for (std::size_t level = 0; level < kLevels; ++level) {
+        const auto shift = kSlotBits * (level + 1);
+        if ((n.expiry >> shift) == (now >> shift)) {
+            const auto slot = (n.expiry >> (kSlotBits * level)) & (kSlots - 1);
+            bucket = static_cast<std::uint32_t>(level * kSlots + slot);
+            break;
+        }
+    }
+    n.bucket = bucket;
+    n.prev = kNil;
+    n.next = heads[bucket];
+    if (n.next != kNil) nodes[n.next].prev = idx;
+    heads[bucket] = idx;
+}
+
+void TimerWheel::unlink(std::uint32_t idx) noexcept {
+    Node& n = nodes[idx];
+    if (n.bucket == kNil) return;
+    if (n.prev != kNil) nodes[n.prev].next = n.next;
+    else heads[n.bucket] = n.next;
+    if (n.next != kNil) nodes[n.next].prev = n.prev;
+    n.prev = n.next = n.bucket = kNil;
+}
+
+void TimerWheel::release(std::uint32_t idx) noexcept {
+    Node& n = nodes[idx];
+    n.job.reset();
+    ++n.generation;
+    --active;
+    freeList.push_back(idx);
+}
+
+// Re-link every job of one bucket; they all land on lower levels (or stay in overflow)
+void TimerWheel::cascade(std::uint32_t bucket) {
+    std::uint32_t idx = heads[bucket];
+    heads[bucket] = kNil;
+    while (idx != kNil) {
+        const std::uint32_t next = nodes[idx].next;
+        nodes[idx].bucket = kNil;
+        link(idx);
+        idx = next;
+    }
+}
+
+// One tick: cascade higher levels whose boundary we crossed (top first, so a job can fall
+// through several levels in the same tick), then fire the level-0 slot.
+void TimerWheel::advance(std::vector<std::shared_ptr<Job>>& due) {
+    ++now;
+    if ((now & ((std::uint64_t{1} << (kSlotBits * kLevels)) - 1)) == 0) cascade(kOverflow);
+    for (std::size_t level = kLevels - 1; level >= 1; --level) {
+        const auto shift = kSlotBits * level;
+        if ((now & ((std::uint64_t{1} << shift) - 1)) == 0) {
+            cascade(static_cast<std::uint32_t>(level * kSlots + ((now >> shift) & (kSlots - 1))));
+        }
+    }
+
+    const auto bucket = static_cast<std::uint32_t>(now & (kSlots - 1));
+    std::uint32_t idx = heads[bucket];
+    heads[bucket] = kNil;
+    while (idx != kNil) {
+        Node& n = nodes[idx];
+        const std::uint32_t next = n.next;
+        n.prev = n.next = n.bucket = kNil;
+        if (n.job->cancelFlag && n.job->cancelFlag->load(std::memory_order_relaxed)) {
+            n.job->cancelled.store(true, std::memory_order_relaxed);
+            release(idx);
+            idx = next;
+            continue;
+        }
+        due.push_back(n.job);
+        if (n.interval == 0) {
+            release(idx);
+        } else {
+            n.base += n.interval;
+            // a stalled driver does not replay every missed period
+            if (n.base <= now) n.base = now + n.interval;
+            n.expiry = n.base + jitterTicks(n.jitter);
+            link(idx);
+        }
+        idx = next;
+    }
+}
+
+void TimerWheel::run() {
+    std::vector<std::shared_ptr<Job>> due;
+    std::unique_lock lock(mutex_);
+    while (!stopping) {
+        const auto nextTick = origin + (now + 1) * tick_;
+        if (wake.wait_until(lock, nextTick, [this] { return stopping; })) break;
+        // catch up if the driver was descheduled for several ticks
+        const auto current = Clock::now();
+        while (origin + (now + 1) * tick_ <= current) advance(due);
+        if (due.empty()) continue;
+
+        lock.unlock();
+        for (auto& job : due) {
+            counters->fired.fetch_add(1, std::memory_order_relaxed);
+            const auto prio = job->priority;
+            const auto lane = job->lane;
+            dispatcher->dispatch(prio, std::nullopt, [counters = counters, job = std::move(job)] {
+                if (job->cancelled.load(std::memory_order_relaxed)) return;
+                if (job->running.exchange(true, std::memory_order_acquire)) {
+                    counters->skipped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                try {
+                    job->fn();
+                } catch (...) {
+                    // swallow exceptions to avoid terminating the worker
+                }
+                job->running.store(false, std::memory_order_release);
+            }, lane);
+        }
+        due.clear();
+        lock.lock();
+    }
+}
+
+} // namespace CONCURRENCY
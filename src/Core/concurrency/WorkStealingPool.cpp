@@ -0,0 +1,145 @@
+#include "Core/concurrency/WorkStealingPool.hpp"
+
+namespace CONCURRENCY {
+
+namespace {
+// which pool/worker the current thread belongs to, so nested submits stay local
+thread_local const WorkStealingPool* tlsPool = nullptr;
+thread_local std::size_t tlsWorker = 0;
+} // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t threads, std::function<void()> beforeTask)
+    : beforeTask(std::move(beforeTask)) {
+    const std::size_t n = threads == 0 ? 1 : threads;
+    workers.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) workers.push_back(std::make_unique<Worker>());
+    start();
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    stop();
+}
+
+void WorkStealingPool::start() {
+    if (running.exchange(true)) return;
+    threads.reserve(workers.size());
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        threads.emplace_back([this, i] { run(i); });
+    }
+}
+
+void WorkStealingPool::stop() {
+    if (!running.exchange(false)) return;
+    {
+        std::lock_guard lock(sleepMutex);
+    }
+    wake.notify_all();
+    for (auto& t : threads) {
+        if (t.joinable()) t.join();
+    }
+    threads.clear();
+    for (auto& w : workers) {
+        std::lock_guard lock(w->mutex_);
+        w->tasks.clear();
+    }
+    pending.store(0, std::memory_order_relaxed);
+}
+
+void WorkStealingPool::submit(Task task) {
+    if (!task) return;
+    const std::size_t target = tlsPool == this
+        ? tlsWorker
+        : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    // counted before the push so a thief never decrements below zero;
+    // seq_cst pairs with the sleeper's increment: either we see it asleep or it sees our task
+    pending.fetch_add(1);
+    {
+        std::lock_guard lock(workers[target]->mutex_);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    if (sleepers.load() > 0) {
+        { std::lock_guard lock(sleepMutex); }
+        wake.notify_one();
+    }
+}
+
+bool WorkStealingPool::popLocal(std::size_t self, Task& out) {
+    auto& w = *workers[self];
+    std::lock_guard lock(w.mutex_);
+    if (w.tasks.empty()) return false;
+    out = std::move(w.tasks.back());
+    w.tasks.pop_back();
+    // counted down under the deque lock: pending > 0 then always means a task someone can still find
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool WorkStealingPool::steal(std::size_t self, Task& out) {
+    const std::size_t n = workers.size();
+    bool contended = false;
+    // the first pass skips deques someone else holds; when it skipped any, the second waits for their
+    // locks, or a worker would spin on try_lock while pending > 0 keeps it from sleeping
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::size_t step = 1; step < n; ++step) {
+            auto& victim = *workers[(self + step) % n];
+            std::unique_lock lock(victim.mutex_, std::defer_lock);
+            if (pass == 0 && !lock.try_lock()) {
+                contended = true;
+                continue;
+            }
+            if (pass == 1) lock.lock();
+            if (victim.tasks.empty()) continue;
+            out = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            stealCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (!contended) break;
+    }
+    return false;
+}
+
+void WorkStealingPool::run(std::size_t self) {
+    tlsPool = this;
+    tlsWorker = self;
+    Task task;
+    while (running.load(std::memory_order_acquire)) {
+        if (popLocal(self, task) || steal(self, task)) {
+            try {
+                if (beforeTask) beforeTask();
+                task();
+            } catch (...) {
+                // swallow exceptions to avoid terminating the worker
+            }
+            task = nullptr;
+            execCount.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        // a submit counts its task before pushing it: the wait below would return at once, so let
+        // the submitter finish instead of spinning through it
+        if (pending.load() > 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        sleepers.fetch_add(1);
+        {
+            std::unique_lock lock(sleepMutex);
+            wake.wait(lock, [this] { return pending.load() > 0 || !running.load(); });
+        }
+        sleepers.fetch_sub(1);
+    }
+    tlsPool = nullptr;
+}
+
+std::vector<std::size_t> WorkStealingPool::depths() const {
+    std::vector<std::size_t> out;
+    out.reserve(workers.size());
+    for (const auto& w : workers) {
+        std::lock_guard lock(w->mutex_);
+        out.push_back(w->tasks.size());
+    }
+    return out;
+}
+
+} // namespace CONCURRENCY
@@ -0,0 +1,223 @@
+#include "Core/metrics/Metrics.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace METRICS {
+
+namespace {
+
+void appendNumber(std::string& out, double v) {
+    if (std::isnan(v)) {
+        out += "NaN";
+        return;
+    }
+    if (std::isinf(v)) {
+        out += v > 0 ? "+Inf" : "-Inf";
+        return;
+    }
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, ec == std::errc{} ? end : buf);
+}
+
+void appendNumber(std::string& out, std::uint64_t v) {
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, end);
+}
+
+// label values: backslash, double quote and newline are escaped; HELP text: backslash and newline
+void appendEscaped(std::string& out, std::string_view s, bool quotes) {
+    for (char c : s) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '\n') out += "\\n";
+        else if (quotes && c == '"') out += "\\\"";
+        else out += c;
+    }
+}
+
+// name{labels} or name{labels,extra} or name
+void appendSeries(std::string& out, std::string_view name, std::string_view labels, std::string_view extra = {}) {
+    out += name;
+    if (labels.empty() && extra.empty()) return;
+    out += '{';
+    out += labels;
+    if (!labels.empty() && !extra.empty()) out += ',';
+    out += extra;
+    out += '}';
+}
+
+} // namespace
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)), buckets_(std::make_unique<std::atomic<std::uint64_t>[]>(bounds_.size() + 1))
+{
+    std::sort(bounds_.begin(), bounds_.end());
+    for (std::size_t i = 0; i <= bounds_.size(); ++i) buckets_[i].store(0, std::memory_order_relaxed);
+}
+
+void Histogram::observe(double value) noexcept {
+    // few buckets: a linear scan beats a binary search and stays branch-predictable
+    std::size_t i = 0;
+    while (i < bounds_.size() && value > bounds_[i]) ++i;
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot s;
+    s.bounds = bounds_;
+    s.cumulative.resize(bounds_.size() + 1);
+    std::uint64_t running = 0;
+    for (std::size_t i = 0; i <= bounds_.size(); ++i) {
+        running += buckets_[i].load(std::memory_order_relaxed);
+        s.cumulative[i] = running;
+    }
+    // no separate count: the +Inf bucket is the count, so the two always agree within a scrape
+    s.count = running;
+    s.sum = sum_.load(std::memory_order_relaxed);
+    return s;
+}
+
+const std::vector<double>& latencyBuckets() {
+    static const std::vector<double> bounds{0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+                                            0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+    return bounds;
+}
+
+const std::vector<double>& byteBuckets() {
+    static const std::vector<double> bounds{4096, 16384, 65536, 262144, 1048576, 4194304, 16777216, 67108864};
+    return bounds;
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+std::string MetricsRegistry::renderLabels(const Labels& labels) {
+    std::string out;
+    for (const auto& [k, v] : labels) {
+        if (!out.empty()) out += ',';
+        out += k;
+        out += "=\"";
+        appendEscaped(out, v, true);
+        out += '"';
+    }
+    return out;
+}
+
+MetricsRegistry::Series& MetricsRegistry::series(std::string_view name, std::string_view help, Type type, const Labels& labels) {
+    auto it = families.find(name);
+    if (it == families.end()) {
+        it = families.emplace(std::string(name), Family{}).first;
+        it->second.help = std::string(help);
+        it->second.type = type;
+    }
+    return it->second.series[renderLabels(labels)];
+}
+
+Counter& MetricsRegistry::counter(std::string_view name, std::string_view help, const Labels& labels) {
+    std::lock_guard lock(mutex_);
+    auto& s = series(name, help, Type::Counter, labels);
+    if (!s.counter) s.counter = std::make_unique<Counter>();
+    return *s.counter;
+}
+
+Gauge& MetricsRegistry::gauge(std::string_view name, std::string_view help, const Labels& labels) {
+    std::lock_guard lock(mutex_);
+    auto& s = series(name, help, Type::Gauge, labels);
+    if (!s.gauge) s.gauge = std::make_unique<Gauge>();
+    return *s.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(std::string_view name, std::string_view help, const Labels& labels,
+                                      const std::vector<double>& bounds) {
+    std::lock_guard lock(mutex_);
+    auto& s = series(name, help, Type::Histogram, labels);
+    if (!s.histogram) s.histogram = std::make_unique<Histogram>(bounds);
+    return *s.histogram;
+}
+
+std::uint64_t MetricsRegistry::gaugeFn(std::string_view name, std::string_view help, const Labels& labels, std::function<double()> fn) {
+    std::lock_guard lock(mutex_);
+    auto& s = series(name, help, Type::Gauge, labels);
+    s.fn = std::move(fn);
+    const std::uint64_t id = nextGaugeId++;
+    gaugeFns.emplace(id, std::make_pair(std::string(name), renderLabels(labels)));
+    return id;
+}
+
+void MetricsRegistry::removeGauge(std::uint64_t id) {
+    std::lock_guard lock(mutex_);
+    auto it = gaugeFns.find(id);
+    if (it == gaugeFns.end()) return;
+    if (auto fam = families.find(it->second.first); fam != families.end()) {
+        fam->second.series.erase(it->second.second);
+        if (fam->second.series.empty()) families.erase(fam);
+    }
+    gaugeFns.erase(it);
+}
+
+std::string MetricsRegistry::render() const {
+    std::string out;
+    out.reserve(16 * 1024);
+    std::lock_guard lock(mutex_);
+    for (const auto& [name, family] : families) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        appendEscaped(out, family.help, false);
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += family.type == Type::Counter ? "counter" : family.type == Type::Gauge ? "gauge" : "histogram";
+        out += '\n';
+        for (const auto& [labels, s] : family.series) {
+            if (family.type == Type::Histogram) {
+                if (!s.histogram) continue;
+                const auto snap = s.histogram->snapshot();
+                const std::string bucket = name + "_bucket";
+                for (std::size_t i = 0; i < snap.cumulative.size(); ++i) {
+                    std::string le = "le=\"";
+                    appendNumber(le, i < snap.bounds.size() ? snap.bounds[i] : INFINITY);
+                    le += '"';
+                    appendSeries(out, bucket, labels, le);
+                    out += ' ';
+                    appendNumber(out, snap.cumulative[i]);
+                    out += '\n';
+                }
+                appendSeries(out, name + "_sum", labels);
+                out += ' ';
+                appendNumber(out, snap.sum);
+                out += '\n';
+                appendSeries(out, name + "_count", labels);
+                out += ' ';
+                appendNumber(out, snap.count);
+                out += '\n';
+                continue;
+            }
+            appendSeries(out, name, labels);
+            out += ' ';
+            if (s.counter) appendNumber(out, s.counter->value());
+            else if (s.gauge) appendNumber(out, s.gauge->value());
+            else if (s.fn) {
+                double v = 0.0;
+                try { v = s.fn(); } catch (...) { v = NAN; }
+                appendNumber(out, v);
+            } else {
+                out += '0';
+            }
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+Histogram& libvirtCall(std::string_view api) {
+    return MetricsRegistry::global().histogram("penhive_libvirt_call_seconds", "Latency of libvirt API calls",
+                                               {{"api", std::string(api)}});
+}
+
+} // namespace METRICS
@@ -0,0 +1,83 @@
+#include "Core/serialization/Writers.hpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace SERIALIZATION {
+
+namespace {
+
+constexpr bool jsonSpecial(unsigned char c) noexcept {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+constexpr bool xmlSpecial(unsigned char c, bool attribute) noexcept {
+    if (c < 0x20) return c != '\t' && c != '\n' && c != '\r';
+    return c == '&' || c == '<' || c == '>' || (attribute && (c == '"' || c == '\''));
+}
+
+#if defined(__SSE2__)
+// bytes below 0x20, compared unsigned: min(c, 0x1F) == c
+inline __m128i controlBytes(__m128i chunk) noexcept {
+    return _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(0x1F)), chunk);
+}
+
+inline std::size_t firstSet(int mask) noexcept {
+    return static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned int>(mask)));
+}
+#endif
+
+} // namespace
+
+std::size_t findJsonEscape(std::string_view s) noexcept {
+    const auto* p = reinterpret_cast<const unsigned char*>(s.data());
+    const std::size_t n = s.size();
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= n; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const __m128i hit = _mm_or_si128(controlBytes(chunk),
+                                         _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (const int mask = _mm_movemask_epi8(hit)) return i + firstSet(mask);
+    }
+#endif
+    for (; i < n; ++i) {
+        if (jsonSpecial(p[i])) return i;
+    }
+    return n;
+}
+
+std::size_t findXmlEscape(std::string_view s, bool attribute) noexcept {
+    const auto* p = reinterpret_cast<const unsigned char*>(s.data());
+    const std::size_t n = s.size();
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quot = _mm_set1_epi8(attribute ? '"' : '&');
+    const __m128i apos = _mm_set1_epi8(attribute ? '\'' : '&');
+    for (; i + 16 <= n; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, amp), _mm_cmpeq_epi8(chunk, lt)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(chunk, gt),
+                                                _mm_or_si128(_mm_cmpeq_epi8(chunk, quot), _mm_cmpeq_epi8(chunk, apos))));
+        // control bytes are rare: check them, then let the scalar test drop \t \n \r
+        hit = _mm_or_si128(hit, controlBytes(chunk));
+        int mask = _mm_movemask_epi8(hit);
+        while (mask) {
+            const std::size_t at = i + firstSet(mask);
+            if (xmlSpecial(p[at], attribute)) return at;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (xmlSpecial(p[i], attribute)) return i;
+    }
+    return n;
+}
+
+} // namespace SERIALIZATION
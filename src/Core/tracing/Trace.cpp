@@ -0,0 +1,203 @@
+#include "Core/tracing/Trace.hpp"
+#include "Core/concurrency/TimerWheel.hpp"
+#include <algorithm>
+#include <charconv>
+#include <random>
+
+namespace TRACING {
+
+namespace {
+
+thread_local TraceContext t_current;
+
+std::uint64_t random64() noexcept {
+    thread_local std::mt19937_64 rng{std::random_device{}() ^ (static_cast<std::uint64_t>(std::random_device{}()) << 32)};
+    std::uint64_t v;
+    do { v = rng(); } while (v == 0); // all-zero ids are invalid in W3C trace context
+    return v;
+}
+
+void appendHex(std::string& out, std::uint64_t v) {
+    static constexpr char digits[] = "0123456789abcdef";
+    for (int shift = 60; shift >= 0; shift -= 4) out += digits[(v >> shift) & 0xF];
+}
+
+bool parseHex(std::string_view s, std::uint64_t& out) noexcept {
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out, 16);
+    return ec == std::errc{} && end == s.data() + s.size();
+}
+
+} // namespace
+
+std::string TraceContext::traceIdHex() const {
+    std::string out;
+    out.reserve(32);
+    appendHex(out, traceHi);
+    appendHex(out, traceLo);
+    return out;
+}
+
+std::string TraceContext::spanIdHex() const {
+    std::string out;
+    out.reserve(16);
+    appendHex(out, spanId);
+    return out;
+}
+
+std::string TraceContext::traceparent() const {
+    std::string out = "00-";
+    out.reserve(55);
+    appendHex(out, traceHi);
+    appendHex(out, traceLo);
+    out += '-';
+    appendHex(out, spanId);
+    out += "-01";
+    return out;
+}
+
+std::optional<TraceContext> TraceContext::fromTraceparent(std::string_view h) noexcept {
+    // version(2) - trace id(32) - parent id(16) - flags(2)
+    if (h.size() < 55 || h[2] != '-' || h[35] != '-' || h[52] != '-') return std::nullopt;
+    TraceContext ctx;
+    if (!parseHex(h.substr(3, 16), ctx.traceHi) || !parseHex(h.substr(19, 16), ctx.traceLo)
+        || !parseHex(h.substr(36, 16), ctx.spanId)) {
+        return std::nullopt;
+    }
+    if (!ctx.valid() || ctx.spanId == 0) return std::nullopt;
+    return ctx;
+}
+
+TraceContext TraceContext::root() noexcept {
+    return TraceContext{random64(), random64(), random64()};
+}
+
+TraceContext TraceContext::current() noexcept {
+    return t_current;
+}
+
+std::uint64_t newSpanId() noexcept {
+    return random64();
+}
+
+TraceContext exchangeCurrent(const TraceContext& ctx) noexcept {
+    return std::exchange(t_current, ctx);
+}
+
+ContextScope::ContextScope(const TraceContext& ctx) noexcept : previous(t_current) {
+    t_current = ctx;
+}
+
+ContextScope::~ContextScope() {
+    t_current = previous;
+}
+
+//
+// Tracer
+//
+
+Tracer& Tracer::global() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::setExporter(std::shared_ptr<SpanExporter> exporter, std::size_t batchSize) {
+    std::vector<SpanRecord> leftover;
+    std::shared_ptr<SpanExporter> previous;
+    {
+        std::lock_guard lock(mutex_);
+        previous = std::exchange(exporter_, std::move(exporter));
+        leftover.swap(pending);
+        batchSize_ = std::max<std::size_t>(batchSize, 1);
+        enabled_.store(exporter_ != nullptr, std::memory_order_relaxed);
+    }
+    if (previous && !leftover.empty()) previous->exportSpans(std::move(leftover));
+}
+
+void Tracer::record(SpanRecord&& span) {
+    std::vector<SpanRecord> batch;
+    std::shared_ptr<SpanExporter> exporter;
+    {
+        std::lock_guard lock(mutex_);
+        if (!exporter_) return;
+        pending.push_back(std::move(span));
+        if (pending.size() < batchSize_) return;
+        batch.swap(pending);
+        exporter = exporter_;
+    }
+    // outside the lock: the exporter may serialize the batch
+    exporter->exportSpans(std::move(batch));
+}
+
+void Tracer::flush() {
+    std::vector<SpanRecord> batch;
+    std::shared_ptr<SpanExporter> exporter;
+    {
+        std::lock_guard lock(mutex_);
+        if (!exporter_ || pending.empty()) return;
+        batch.swap(pending);
+        exporter = exporter_;
+    }
+    exporter->exportSpans(std::move(batch));
+}
+
+void Tracer::start(CONCURRENCY::TimerWheel& wheel, std::chrono::seconds interval) {
+    stop();
+    auto flag = std::make_shared<std::atomic<bool>>(false);
+    {
+        std::lock_guard lock(mutex_);
+        cancelFlag = flag;
+    }
+    CONCURRENCY::WheelJobOptions opts;
+    opts.cancelFlag = flag;
+    (void)wheel.schedule_every(interval, [this] { flush(); }, std::move(opts));
+}
+
+void Tracer::stop() noexcept {
+    std::lock_guard lock(mutex_);
+    if (cancelFlag) cancelFlag->store(true);
+    cancelFlag.reset();
+}
+
+//
+// Span
+//
+
+Span::Span(std::string_view name, SpanKind kind) {
+    if (!Tracer::global().enabled()) return;
+    previous = t_current;
+    record_ = std::make_unique<SpanRecord>();
+    record_->name = std::string(name);
+    record_->kind = kind;
+    if (previous.valid()) {
+        record_->context = TraceContext{previous.traceHi, previous.traceLo, newSpanId()};
+        record_->parentSpanId = previous.spanId;
+    } else {
+        record_->context = TraceContext::root();
+    }
+    record_->start = std::chrono::system_clock::now();
+    started = std::chrono::steady_clock::now();
+    t_current = record_->context;
+}
+
+Span::~Span() {
+    if (!record_) return;
+    record_->duration = std::chrono::steady_clock::now() - started;
+    t_current = previous;
+    try {
+        Tracer::global().record(std::move(*record_));
+    } catch (...) {
+        // a span that cannot be exported is dropped, never the caller
+    }
+}
+
+void Span::setAttribute(std::string key, std::string value) {
+    if (record_) record_->attributes.emplace_back(std::move(key), std::move(value));
+}
+
+void Span::setError(int code, std::string message) {
+    if (!record_) return;
+    record_->errorCode = code;
+    record_->error = std::move(message);
+}
+
+} // namespace TRACING
@@ -0,0 +1,69 @@
+#include "Database/RocksDatabase.hpp"
+
+namespace {
+rocksdb::Slice toSlice(std::string_view sv) noexcept {
+    return rocksdb::Slice(sv.data(), sv.size());
+}
+} // namespace
+
+RocksDatabase::~RocksDatabase() noexcept {
+    (void)Close();
+}
+
+std::expected<void, rocksdb::Status>
+RocksDatabase::Open(const rocksdb::Options& options, std::string_view name) noexcept {
+    std::scoped_lock lock(mutex_);
+    if (db) return {};
+    rocksdb::DB* raw = nullptr;
+    auto status = rocksdb::DB::Open(options, std::string(name), &raw);
+    if (!status.ok()) return std::unexpected(status);
+    db.reset(raw);
+    return {};
+}
+
+std::expected<void, rocksdb::Status>
+RocksDatabase::Put(const rocksdb::WriteOptions& options, std::string_view key, std::string_view value) noexcept {
+    if (!db) return std::unexpected(rocksdb::Status::IOError("database not open"));
+    auto status = db->Put(options, toSlice(key), toSlice(value));
+    if (!status.ok()) return std::unexpected(status);
+    return {};
+}
+
+std::expected<std::string, rocksdb::Status>
+RocksDatabase::Get(const rocksdb::ReadOptions& options, std::string_view key) const noexcept {
+    if (!db) return std::unexpected(rocksdb::Status::IOError("database not open"));
+    std::string value;
+    auto status = db->Get(options, toSlice(key), &value);
+    if (!status.ok()) return std::unexpected(status);
+    return value;
+}
+
+std::expected<void, rocksdb::Status>
+RocksDatabase::Delete(const rocksdb::WriteOptions& options, std::string_view key) noexcept {
+    if (!db) return std::unexpected(rocksdb::Status::IOError("database not open"));
+    auto status = db->Delete(options, toSlice(key));
+    if (!status.ok()) return std::unexpected(status);
+    return {};
+}
+
+std::expected<void, rocksdb::Status>
+RocksDatabase::Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch& batch) noexcept {
+    if (!db) return std::unexpected(rocksdb::Status::IOError("database not open"));
+    auto status = db->Write(options, &batch);
+    if (!status.ok()) return std::unexpected(status);
+    return {};
+}
+
+std::unique_ptr<rocksdb::Iterator>
+RocksDatabase::NewIterator(const rocksdb::ReadOptions& options) noexcept {
+    if (!db) return nullptr;
+    return std::unique_ptr<rocksdb::Iterator>(db->NewIterator(options));
+}
+
+bool RocksDatabase::Close() noexcept {
+    std::scoped_lock lock(mutex_);
+    if (!db) return true;
+    auto status = db->Close();
+    db.reset();
+    return status.ok();
+}
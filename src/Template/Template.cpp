@@ -1 +1,401 @@
-#include "Template/"
\ No newline at end of file
+#include "Template/Template.hpp"
+#include "Utils/Exception.hpp"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <format>
+#include <initializer_list>
+#include <memory>
+
+namespace {
+
+// "vms.0.nics" -> "vms", "0", "nics"; an empty path is the root
+template <typename F>
+bool forEachSegment(std::string_view path, F&& visit) {
+    while (!path.empty()) {
+        const auto dot = path.find('.');
+        if (!visit(path.substr(0, dot))) return false;
+        if (dot == std::string_view::npos) break;
+        path.remove_prefix(dot + 1);
+    }
+    return true;
+}
+
+std::optional<std::size_t> arrayIndex(std::string_view segment) noexcept {
+    std::size_t i = 0;
+    auto [end, ec] = std::from_chars(segment.data(), segment.data() + segment.size(), i);
+    if (ec != std::errc{} || end != segment.data() + segment.size()) return std::nullopt;
+    return i;
+}
+
+nlohmann::json* findMutable(nlohmann::json& root, std::string_view path) noexcept {
+    return const_cast<nlohmann::json*>(Template::find(root, path));
+}
+
+// like find(), but creates missing object members on the way (set/add)
+nlohmann::json& walkOrCreate(nlohmann::json& root, std::string_view path) {
+    nlohmann::json* node = &root;
+    forEachSegment(path, [&](std::string_view segment) {
+        if (node->is_array()) {
+            if (auto i = arrayIndex(segment); i && *i < node->size()) {
+                node = &(*node)[*i];
+                return true;
+            }
+        }
+        if (!node->is_object()) *node = nlohmann::json::object();
+        node = &(*node)[std::string(segment)];
+        return true;
+    });
+    return *node;
+}
+
+//
+// sensitive field names
+//
+
+// reversed-suffix trie over the folded field name: one walk from the end of the key, built once.
+// A name matches the trailing words of a key, never the tail of a longer word.
+class SuffixMatcher {
+public:
+    SuffixMatcher(std::initializer_list<std::string_view> suffixes) {
+        nodes.emplace_back();
+        for (auto suffix : suffixes) {
+            std::size_t n = 0;
+            for (auto it = suffix.rbegin(); it != suffix.rend(); ++it) {
+                const int c = *it - 'a';
+                if (nodes[n].next[c] == 0) {
+                    nodes[n].next[c] = static_cast<std::uint16_t>(nodes.size());
+                    nodes.emplace_back();
+                }
+                n = nodes[n].next[c];
+            }
+            nodes[n].terminal = true;
+        }
+    }
+
+    [[nodiscard]] bool matches(std::string_view key) const noexcept {
+        std::size_t i = key.size();
+        // "flag_2", "password1"
+        while (i > 0 && (isDigit(key[i - 1]) || isSeparator(key[i - 1]))) --i;
+        std::size_t n = 0;
+        while (i > 0) {
+            const char ch = key[--i];
+            if (isSeparator(ch)) continue;
+            const char lower = ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch - 'A' + 'a') : ch;
+            if (lower < 'a' || lower > 'z') return false;
+            n = nodes[n].next[lower - 'a'];
+            if (n == 0) return false;
+            // whole words only: "rootPassword" and "api_key" match, "cpuflags" is not "flags"
+            if (nodes[n].terminal && wordStart(key, i)) return true;
+        }
+        return false;
+    }
+
+private:
+    static bool isDigit(char c) noexcept { return c >= '0' && c <= '9'; }
+    static bool isUpper(char c) noexcept { return c >= 'A' && c <= 'Z'; }
+    // a separator before it, or a camelCase hump
+    static bool wordStart(std::string_view key, std::size_t i) noexcept {
+        return i == 0 || isSeparator(key[i - 1]) || (isUpper(key[i]) && !isUpper(key[i - 1]));
+    }
+    static bool isSeparator(char c) noexcept { return c == '_' || c == '-' || c == '.' || c == ' '; }
+
+    struct Node {
+        std::array<std::uint16_t, 26> next{};
+        bool terminal{false};
+    };
+    std::vector<Node> nodes;
+};
+
+const SuffixMatcher& sensitiveNames() {
+    static const SuffixMatcher matcher{"password", "passwd", "passphrase", "secret", "token", "flag", "flags",
+                                       "apikey", "privatekey", "credential", "credentials"};
+    return matcher;
+}
+
+//
+// AES-256-GCM
+//
+
+constexpr std::string_view kEncryptedPrefix = "enc:v1:";
+constexpr std::size_t kIvSize = 12;
+constexpr std::size_t kTagSize = 16;
+
+struct CipherCtxFree {
+    void operator()(EVP_CIPHER_CTX* ctx) const noexcept { EVP_CIPHER_CTX_free(ctx); }
+};
+using CipherCtx = std::unique_ptr<EVP_CIPHER_CTX, CipherCtxFree>;
+
+bool isEncrypted(const nlohmann::json& v) {
+    return v.is_string() && v.get_ref<const std::string&>().starts_with(kEncryptedPrefix);
+}
+
+// one key schedule per thread, rebuilt only when the key changes; EVP picks AES-NI when the CPU has it
+class GcmCipher {
+public:
+    static GcmCipher& forKey(std::string_view secret) {
+        thread_local GcmCipher cipher;
+        std::array<unsigned char, 32> digest{};
+        unsigned int len = 0;
+        const std::string material = std::string("penhive-template-v1:").append(secret);
+        if (EVP_Digest(material.data(), material.size(), digest.data(), &len, EVP_sha256(), nullptr) != 1) {
+            throw TemplateException("Template: key derivation failed");
+        }
+        if (!cipher.enc || digest != cipher.key) cipher.rekey(digest);
+        OPENSSL_cleanse(digest.data(), digest.size());
+        return cipher;
+    }
+
+    ~GcmCipher() { OPENSSL_cleanse(key.data(), key.size()); }
+
+    // "enc:v1:" + base64(iv | ciphertext | tag)
+    std::string seal(std::string_view plain, const unsigned char* iv) {
+        std::string raw(kIvSize + plain.size() + kTagSize, '\0');
+        auto* out = reinterpret_cast<unsigned char*>(raw.data());
+        std::copy(iv, iv + kIvSize, out);
+        int len = 0;
+        int tail = 0;
+        if (EVP_EncryptInit_ex(enc.get(), nullptr, nullptr, nullptr, iv) != 1
+            || EVP_EncryptUpdate(enc.get(), out + kIvSize, &len, reinterpret_cast<const unsigned char*>(plain.data()), static_cast<int>(plain.size())) != 1
+            || EVP_EncryptFinal_ex(enc.get(), out + kIvSize + len, &tail) != 1
+            || EVP_CIPHER_CTX_ctrl(enc.get(), EVP_CTRL_GCM_GET_TAG, static_cast<int>(kTagSize), out + kIvSize + plain.size()) != 1) {
+            throw TemplateException("Template: AES-GCM encryption failed");
+        }
+        std::string encoded(kEncryptedPrefix);
+        const std::size_t prefix = encoded.size();
+        encoded.resize(prefix + 4 * ((raw.size() + 2) / 3) + 1);
+        const int written = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(encoded.data() + prefix), out, static_cast<int>(raw.size()));
+        encoded.resize(prefix + static_cast<std::size_t>(written));
+        return encoded;
+    }
+
+    // nullopt on a malformed value, a wrong key or tampering
+    std::optional<std::string> open(std::string_view encoded) {
+        if (!encoded.starts_with(kEncryptedPrefix)) return std::nullopt;
+        encoded.remove_prefix(kEncryptedPrefix.size());
+        if (encoded.empty() || encoded.size() % 4 != 0) return std::nullopt;
+        std::string raw(encoded.size() / 4 * 3, '\0');
+        auto* in = reinterpret_cast<unsigned char*>(raw.data());
+        const int decoded = EVP_DecodeBlock(in, reinterpret_cast<const unsigned char*>(encoded.data()), static_cast<int>(encoded.size()));
+        if (decoded < 0) return std::nullopt;
+        // EVP_DecodeBlock counts the bytes that padding stands for
+        std::size_t size = static_cast<std::size_t>(decoded);
+        if (encoded.ends_with("==")) size -= 2;
+        else if (encoded.ends_with('=')) size -= 1;
+        if (size < kIvSize + kTagSize) return std::nullopt;
+
+        const std::size_t cipherSize = size - kIvSize - kTagSize;
+        std::string plain(cipherSize, '\0');
+        int len = 0;
+        int tail = 0;
+        if (EVP_DecryptInit_ex(dec.get(), nullptr, nullptr, nullptr, in) != 1
+            || EVP_DecryptUpdate(dec.get(), reinterpret_cast<unsigned char*>(plain.data()), &len, in + kIvSize, static_cast<int>(cipherSize)) != 1
+            || EVP_CIPHER_CTX_ctrl(dec.get(), EVP_CTRL_GCM_SET_TAG, static_cast<int>(kTagSize), in + kIvSize + cipherSize) != 1
+            || EVP_DecryptFinal_ex(dec.get(), reinterpret_cast<unsigned char*>(plain.data()) + len, &tail) != 1) {
+            OPENSSL_cleanse(plain.data(), plain.size());
+            return std::nullopt;
+        }
+        return plain;
+    }
+
+private:
+    void rekey(const std::array<unsigned char, 32>& digest) {
+        CipherCtx e(EVP_CIPHER_CTX_new());
+        CipherCtx d(EVP_CIPHER_CTX_new());
+        if (!e || !d
+            || EVP_EncryptInit_ex(e.get(), EVP_aes_256_gcm(), nullptr, digest.data(), nullptr) != 1
+            || EVP_DecryptInit_ex(d.get(), EVP_aes_256_gcm(), nullptr, digest.data(), nullptr) != 1) {
+            throw TemplateException("Template: AES-GCM setup failed");
+        }
+        key = digest;
+        enc = std::move(e);
+        dec = std::move(d);
+    }
+
+    std::array<unsigned char, 32> key{};
+    CipherCtx enc;
+    CipherCtx dec;
+};
+
+void randomIvs(std::vector<unsigned char>& ivs) {
+    if (!ivs.empty() && RAND_bytes(ivs.data(), static_cast<int>(ivs.size())) != 1) {
+        throw TemplateException("Template: no randomness for AES-GCM nonces");
+    }
+}
+
+// strings whose own key is sensitive, or that sit anywhere under one ("credentials": {...})
+template <typename F>
+void forEachSensitive(nlohmann::json& node, bool inSensitive, const SuffixMatcher& names, F&& visit) {
+    if (node.is_string()) {
+        if (inSensitive) visit(node);
+    } else if (node.is_array()) {
+        for (auto& child : node) forEachSensitive(child, inSensitive, names, visit);
+    } else if (node.is_object()) {
+        for (auto& [key, child] : node.items()) forEachSensitive(child, inSensitive || names.matches(key), names, visit);
+    }
+}
+
+template <typename F>
+void forEachEncrypted(nlohmann::json& node, F&& visit) {
+    if (isEncrypted(node)) {
+        visit(node);
+    } else if (node.is_array() || node.is_object()) {
+        for (auto& child : node) forEachEncrypted(child, visit);
+    }
+}
+
+} // namespace
+
+const nlohmann::json* Template::find(const nlohmann::json& root, std::string_view path) noexcept {
+    const nlohmann::json* node = &root;
+    const bool found = forEachSegment(path, [&](std::string_view segment) {
+        if (node->is_object()) {
+            auto it = node->find(segment);
+            if (it == node->end()) return false;
+            node = &*it;
+            return true;
+        }
+        if (node->is_array()) {
+            auto i = arrayIndex(segment);
+            if (!i || *i >= node->size()) return false;
+            node = &(*node)[*i];
+            return true;
+        }
+        return false;
+    });
+    return found ? node : nullptr;
+}
+
+std::expected<void, std::string> Template::parse(std::string_view json_str, std::source_location loc) noexcept {
+    try {
+        nlohmann::json parsed = nlohmann::json::parse(json_str);
+        if (!parsed.is_object()) {
+            return std::unexpected(std::format("{}:{}: template root must be an object", loc.file_name(), loc.line()));
+        }
+        data = std::move(parsed);
+        return {};
+    } catch (const std::exception& e) {
+        return std::unexpected(std::format("{}:{}: {}", loc.file_name(), loc.line(), e.what()));
+    }
+}
+
+std::string Template::to_string() const {
+    return data.is_null() ? std::string("{}") : data.dump(4);
+}
+
+void Template::set(std::string key, nlohmann::json value) {
+    walkOrCreate(data, key) = std::move(value);
+}
+
+void Template::add(std::string key, nlohmann::json value) {
+    auto& node = walkOrCreate(data, key);
+    if (node.is_null()) {
+        node = nlohmann::json::array({std::move(value)});
+    } else if (node.is_array()) {
+        node.push_back(std::move(value));
+    } else {
+        node = nlohmann::json::array({std::move(node), std::move(value)});
+    }
+}
+
+std::optional<nlohmann::json> Template::get(std::string_view key) const {
+    const auto* node = find(data, key);
+    if (!node) return std::nullopt;
+    if (node->is_array()) {
+        if (node->empty()) return std::nullopt;
+        return node->front();
+    }
+    return *node;
+}
+
+std::vector<nlohmann::json> Template::get_all(std::string_view key) const {
+    const auto* node = find(data, key);
+    if (!node) return {};
+    if (node->is_array()) return std::vector<nlohmann::json>(node->begin(), node->end());
+    return {*node};
+}
+
+bool Template::remove(std::string_view key) {
+    const auto dot = key.rfind('.');
+    nlohmann::json* parent = dot == std::string_view::npos ? &data : findMutable(data, key.substr(0, dot));
+    const std::string_view last = dot == std::string_view::npos ? key : key.substr(dot + 1);
+    if (!parent) return false;
+    if (parent->is_object()) return parent->erase(std::string(last)) > 0;
+    if (parent->is_array()) {
+        auto i = arrayIndex(last);
+        if (!i || *i >= parent->size()) return false;
+        parent->erase(*i);
+        return true;
+    }
+    return false;
+}
+
+bool Template::empty() const {
+    return data.is_null() || data.empty();
+}
+
+void Template::merge(const Template& other) {
+    if (other.data.is_null()) return;
+    if (data.is_null()) data = nlohmann::json::object();
+    data.merge_patch(other.data);
+}
+
+bool Template::is_sensitive_field(std::string_view key) const {
+    return sensitiveNames().matches(key);
+}
+
+void Template::encrypt(const std::string& key) {
+    // one walk to collect, one RAND_bytes for every nonce, then one cipher context for all fields
+    std::vector<nlohmann::json*> fields;
+    forEachSensitive(data, false, sensitiveNames(), [&](nlohmann::json& v) {
+        if (!isEncrypted(v)) fields.push_back(&v);
+    });
+    if (fields.empty()) return;
+    std::vector<unsigned char> ivs(fields.size() * kIvSize);
+    randomIvs(ivs);
+    auto& cipher = GcmCipher::forKey(key);
+    std::vector<std::string> sealed;
+    sealed.reserve(fields.size());
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        sealed.push_back(cipher.seal(fields[i]->get_ref<const std::string&>(), ivs.data() + i * kIvSize));
+    }
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        auto& plain = fields[i]->get_ref<std::string&>();
+        OPENSSL_cleanse(plain.data(), plain.size());
+        *fields[i] = std::move(sealed[i]);
+    }
+}
+
+void Template::decrypt(const std::string& key) {
+    // every encrypted value, whatever its key is called now; nothing changes unless all of them open
+    std::vector<nlohmann::json*> fields;
+    forEachEncrypted(data, [&](nlohmann::json& v) { fields.push_back(&v); });
+    if (fields.empty()) return;
+    auto& cipher = GcmCipher::forKey(key);
+    std::vector<std::string> opened;
+    opened.reserve(fields.size());
+    for (auto* field : fields) {
+        auto plain = cipher.open(field->get_ref<const std::string&>());
+        if (!plain) {
+            for (auto& p : opened) OPENSSL_cleanse(p.data(), p.size());
+            throw TemplateException("Template: cannot decrypt field (wrong key or tampered value)");
+        }
+        opened.push_back(std::move(*plain));
+    }
+    for (std::size_t i = 0; i < fields.size(); ++i) *fields[i] = std::move(opened[i]);
+}
+
+std::string Template::encrypt_string(std::string_view plain, std::string_view key) const {
+    std::vector<unsigned char> iv(kIvSize);
+    randomIvs(iv);
+    return GcmCipher::forKey(key).seal(plain, iv.data());
+}
+
+std::string Template::decrypt_string(std::string_view encrypted, std::string_view key) const {
+    auto plain = GcmCipher::forKey(key).open(encrypted);
+    if (!plain) throw TemplateException("Template: cannot decrypt value (wrong key or tampered value)");
+    return std::move(*plain);
+}
@@ -0,0 +1,281 @@
+#include "Template/TemplateEngine.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <system_error>
+
+namespace {
+
+// FNV-1a: stable across builds and hosts, so it can name cache files
+constexpr std::uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+
+std::uint64_t fnv1a(std::string_view s, std::uint64_t h = kFnvOffset) noexcept {
+    for (unsigned char c : s) h = (h ^ c) * 0x100000001b3ULL;
+    return h;
+}
+
+std::uint64_t combine(std::uint64_t h, std::uint64_t v) noexcept {
+    for (int shift = 0; shift < 64; shift += 8) h = (h ^ ((v >> shift) & 0xFF)) * 0x100000001b3ULL;
+    return h;
+}
+
+// "extends" is a name or a list of names; anything else is a template error
+std::expected<void, std::string> collectReferences(const nlohmann::json& node, std::vector<std::string>& out) {
+    if (node.is_array()) {
+        for (const auto& child : node) {
+            if (auto res = collectReferences(child, out); !res) return res;
+        }
+        return {};
+    }
+    if (!node.is_object()) return {};
+    for (const auto& [key, child] : node.items()) {
+        if (key != "extends") {
+            if (auto res = collectReferences(child, out); !res) return res;
+            continue;
+        }
+        if (child.is_string()) {
+            out.push_back(child.get<std::string>());
+            continue;
+        }
+        if (!child.is_array()) return std::unexpected(std::string("\"extends\" must be a template name or a list of names"));
+        for (const auto& base : child) {
+            if (!base.is_string()) return std::unexpected(std::string("\"extends\" must be a template name or a list of names"));
+            out.push_back(base.get<std::string>());
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+//
+// CompiledTemplate
+//
+
+CompiledTemplate::CompiledTemplate(std::string name, std::uint64_t contentHash, nlohmann::json resolved)
+    : name_(std::move(name)), hash_(contentHash), root_(std::move(resolved)) {
+    std::string path;
+    indexNode(root_, path);
+}
+
+void CompiledTemplate::indexNode(const nlohmann::json& node, std::string& path) {
+    if (!path.empty()) index.emplace(path, &node);
+    if (!node.is_object() && !node.is_array()) return;
+    const std::size_t base = path.size();
+    auto descend = [&](std::string_view segment, const nlohmann::json& child) {
+        if (base != 0) path += '.';
+        path += segment;
+        indexNode(child, path);
+        path.resize(base);
+    };
+    if (node.is_object()) {
+        for (const auto& [key, child] : node.items()) descend(key, child);
+    } else {
+        for (std::size_t i = 0; i < node.size(); ++i) descend(std::to_string(i), node[i]);
+    }
+}
+
+const nlohmann::json* CompiledTemplate::find(std::string_view path) const noexcept {
+    if (path.empty()) return &root_;
+    auto it = index.find(path);
+    return it == index.end() ? nullptr : it->second;
+}
+
+std::optional<nlohmann::json> CompiledTemplate::get(std::string_view path) const {
+    const auto* node = find(path);
+    if (!node) return std::nullopt;
+    if (node->is_array()) {
+        if (node->empty()) return std::nullopt;
+        return node->front();
+    }
+    return *node;
+}
+
+//
+// TemplateEngine
+//
+
+TemplateEngine::TemplateEngine(std::filesystem::path dir) : cacheDir(std::move(dir)) {}
+
+std::expected<void, std::string> TemplateEngine::add(std::string name, std::string_view json) {
+    Template parsed;
+    if (auto res = parsed.parse(json); !res) return std::unexpected("Template " + name + ": " + res.error());
+    auto source = std::make_shared<Source>();
+    source->document = parsed.document();
+    source->hash = fnv1a(name, fnv1a(json));
+    if (auto res = collectReferences(source->document, source->references); !res) {
+        return std::unexpected("Template " + name + ": " + res.error());
+    }
+    std::unique_lock lock(mutex_);
+    sources.insert_or_assign(std::move(name), std::move(source));
+    return {};
+}
+
+std::expected<std::size_t, std::string> TemplateEngine::loadDirectory(const std::filesystem::path& dir) {
+    std::error_code ec;
+    std::filesystem::directory_iterator it(dir, ec);
+    if (ec) return std::unexpected("Cannot read template directory " + dir.string() + ": " + ec.message());
+    std::size_t loaded = 0;
+    for (const auto& entry : it) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".json") continue;
+        std::ifstream in(entry.path(), std::ios::binary);
+        const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (!in && !in.eof()) return std::unexpected("Cannot read " + entry.path().string());
+        if (auto res = add(entry.path().stem().string(), text); !res) return std::unexpected(res.error());
+        ++loaded;
+    }
+    return loaded;
+}
+
+bool TemplateEngine::remove(std::string_view name) {
+    std::unique_lock lock(mutex_);
+    auto it = sources.find(std::string(name));
+    if (it == sources.end()) return false;
+    sources.erase(it);
+    compiled.erase(std::string(name));
+    return true;
+}
+
+TemplateEngine::SourceMap TemplateEngine::snapshot() const {
+    std::shared_lock lock(mutex_);
+    return sources;
+}
+
+std::expected<std::uint64_t, std::string> TemplateEngine::contentHash(const SourceMap& map, const std::string& name,
+                                                                      std::vector<std::string>& stack) const {
+    if (std::find(stack.begin(), stack.end(), name) != stack.end()) return std::unexpected("Template inheritance cycle at " + name);
+    if (stack.size() >= kMaxDepth) return std::unexpected("Template inheritance deeper than " + std::to_string(kMaxDepth) + " at " + name);
+    auto it = map.find(name);
+    if (it == map.end()) return std::unexpected("Unknown template: " + name);
+    stack.push_back(name);
+    std::uint64_t h = it->second->hash;
+    for (const auto& ref : it->second->references) {
+        auto refHash = contentHash(map, ref, stack);
+        if (!refHash) return refHash;
+        h = combine(h, *refHash);
+    }
+    stack.pop_back();
+    return h;
+}
+
+std::expected<std::reference_wrapper<const nlohmann::json>, std::string> TemplateEngine::resolveDocument(
+    const SourceMap& map, const std::string& name, std::vector<std::string>& stack, ResolvedMap& done) {
+    if (auto it = done.find(name); it != done.end()) return std::cref(it->second);
+    auto source = map.find(name);
+    if (source == map.end()) return std::unexpected("Unknown template: " + name);
+    stack.push_back(name);
+    nlohmann::json document = source->second->document;
+    if (auto res = resolveNode(map, document, stack, done); !res) return std::unexpected(res.error());
+    stack.pop_back();
+    // unordered_map nodes do not move, so the reference stays valid as done grows
+    return std::cref(done.emplace(name, std::move(document)).first->second);
+}
+
+std::expected<void, std::string> TemplateEngine::resolveNode(const SourceMap& map, nlohmann::json& node,
+                                                             std::vector<std::string>& stack, ResolvedMap& done) {
+    if (node.is_array()) {
+        for (auto& child : node) {
+            if (auto res = resolveNode(map, child, stack, done); !res) return res;
+        }
+        return {};
+    }
+    if (!node.is_object()) return {};
+    // overrides first, so a VM's own NIC list may extend a NIC template too
+    for (auto& [key, child] : node.items()) {
+        if (key == "extends") continue;
+        if (auto res = resolveNode(map, child, stack, done); !res) return res;
+    }
+    auto extends = node.find("extends");
+    if (extends == node.end()) return {};
+
+    std::vector<std::string> bases;
+    if (extends->is_string()) {
+        bases.push_back(extends->get<std::string>());
+    } else {
+        for (const auto& base : *extends) bases.push_back(base.get<std::string>());
+    }
+    node.erase(extends);
+
+    nlohmann::json merged = nlohmann::json::object();
+    for (const auto& base : bases) {
+        // contentHash() already rejected cycles and unknown names for the whole graph
+        auto resolved = resolveDocument(map, base, stack, done);
+        if (!resolved) return std::unexpected(resolved.error());
+        merged.merge_patch(resolved->get());
+    }
+    merged.merge_patch(node);
+    node = std::move(merged);
+    return {};
+}
+
+std::expected<CompiledTemplatePtr, std::string> TemplateEngine::resolve(std::string_view name) {
+    const std::string key(name);
+    const SourceMap map = snapshot();
+    std::vector<std::string> stack;
+    auto hash = contentHash(map, key, stack);
+    if (!hash) return std::unexpected(hash.error());
+
+    {
+        std::shared_lock lock(mutex_);
+        if (auto it = compiled.find(key); it != compiled.end() && it->second->contentHash() == *hash) {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+
+    CompiledTemplatePtr result;
+    if (auto cached = loadCached(*hash)) {
+        diskHits.fetch_add(1, std::memory_order_relaxed);
+        result = std::make_shared<const CompiledTemplate>(key, *hash, std::move(*cached));
+    } else {
+        ResolvedMap done;
+        stack.clear();
+        auto resolved = resolveDocument(map, key, stack, done);
+        if (!resolved) return std::unexpected(resolved.error());
+        compiles.fetch_add(1, std::memory_order_relaxed);
+        storeCached(*hash, resolved->get());
+        result = std::make_shared<const CompiledTemplate>(key, *hash, std::move(done.at(key)));
+    }
+
+    std::unique_lock lock(mutex_);
+    // a racing resolve of the same sources produced the same document; keep whichever came first
+    auto [it, inserted] = compiled.try_emplace(key, result);
+    if (!inserted && it->second->contentHash() != *hash) it->second = result;
+    return it->second;
+}
+
+std::optional<nlohmann::json> TemplateEngine::loadCached(std::uint64_t hash) const {
+    if (cacheDir.empty()) return std::nullopt;
+    std::ifstream in(cacheDir / std::format("{:016x}.msgpack", hash), std::ios::binary);
+    if (!in) return std::nullopt;
+    const std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    // a truncated or foreign file is a miss, not an error: the template is resolved and rewritten
+    nlohmann::json doc = nlohmann::json::from_msgpack(bytes, true, false);
+    if (doc.is_discarded()) return std::nullopt;
+    return doc;
+}
+
+void TemplateEngine::storeCached(std::uint64_t hash, const nlohmann::json& resolved) const {
+    if (cacheDir.empty()) return;
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    const auto target = cacheDir / std::format("{:016x}.msgpack", hash);
+    auto tmp = target;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        const auto bytes = nlohmann::json::to_msgpack(resolved);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!out) {
+            BoostLogger::Warn("TemplateEngine: cannot write cache file " + tmp.string());
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    // readers see the old file or the complete new one
+    std::filesystem::rename(tmp, target, ec);
+    if (ec) BoostLogger::Warn("TemplateEngine: cannot publish cache file " + target.string() + ": " + ec.message());
+}
@@ -0,0 +1,367 @@
+// penhive-loadgen: replays student sessions against a PenHive node and reports latency percentiles
+//
+//   penhive-loadgen --url http://node:8080 --stage 30:20 --stage 120:20 --stage 30:0
+//
+// Each virtual user loops over one session: open /ws/tasks, create a lab of --vms VMs (202 + task each,
+// completion observed over the WebSocket), upload an image in chunks, list and read the VMs, then delete
+// the lab. Stages ramp linearly from the previous target to theirs ("<seconds>:<users>"), k6 style.
+// Run it while watching /metrics (dispatcher queue depth, pool acquire time) to size the dispatcher
+// thread count and the libvirt connection pool: the knee in p99 is where one of them saturates.
+#include <drogon/drogon.h>
+#include <drogon/WebSocketClient.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Stage {
+    std::chrono::seconds duration{0};
+    unsigned int users{0};
+};
+
+struct Options {
+    std::string url{"http://127.0.0.1:8080"};
+    std::vector<Stage> stages;
+    unsigned int vmsPerLab{3};
+    std::uint64_t memoryKiB{262144};
+    unsigned int vcpus{1};
+    std::string diskSource;              // optional backing disk for the VMs
+    std::uint64_t uploadBytes{8 << 20};  // 0 skips the upload step
+    std::uint64_t chunkBytes{1 << 20};
+    std::chrono::seconds taskTimeout{120};
+    std::chrono::seconds reportEvery{10};
+    std::size_t threads{4};
+};
+
+// per operation: every sample is kept (a run is minutes, not days), percentiles are computed on report
+class Stats {
+public:
+    void record(const std::string& op, Clock::duration took, bool ok) {
+        const double ms = std::chrono::duration<double, std::milli>(took).count();
+        std::lock_guard lock(mutex_);
+        auto& o = ops[op];
+        o.samples.push_back(ms);
+        if (!ok) ++o.errors;
+    }
+
+    void print(std::chrono::duration<double> elapsed, unsigned int activeUsers) const {
+        std::lock_guard lock(mutex_);
+        std::printf("\n[%7.1fs] users=%u\n", elapsed.count(), activeUsers);
+        std::printf("%-16s %8s %7s %9s %9s %9s %9s %9s\n", "op", "count", "err%", "rps", "p50ms", "p90ms", "p99ms", "maxms");
+        for (const auto& [name, o] : ops) {
+            if (o.samples.empty()) continue;
+            auto sorted = o.samples;
+            std::sort(sorted.begin(), sorted.end());
+            auto pct = [&](double p) { return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))]; };
+            std::printf("%-16s %8zu %6.2f%% %9.1f %9.1f %9.1f %9.1f %9.1f\n", name.c_str(), sorted.size(),
+                        100.0 * static_cast<double>(o.errors) / static_cast<double>(sorted.size()),
+                        static_cast<double>(sorted.size()) / std::max(elapsed.count(), 1e-9),
+                        pct(0.50), pct(0.90), pct(0.99), sorted.back());
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    struct Op {
+        std::vector<double> samples;
+        std::size_t errors{0};
+    };
+    mutable std::mutex mutex_;
+    std::map<std::string, Op> ops;
+};
+
+struct Run {
+    Options options;
+    Stats stats;
+    Clock::time_point started{Clock::now()};
+    std::atomic<unsigned int> target{0}; // users with an index below this keep looping
+    std::atomic<unsigned int> active{0};
+    std::atomic<bool> done{false};
+};
+
+// task id -> when /ws/tasks reported it finished (and whether it failed)
+struct TaskWatch {
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::pair<Clock::time_point, bool>> finished;
+};
+
+drogon::HttpRequestPtr jsonRequest(drogon::HttpMethod method, const std::string& path, const Json::Value& body) {
+    auto req = drogon::HttpRequest::newHttpJsonRequest(body);
+    req->setMethod(method);
+    req->setPath(path);
+    return req;
+}
+
+drogon::HttpRequestPtr request(drogon::HttpMethod method, const std::string& path) {
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(method);
+    req->setPath(path);
+    return req;
+}
+
+// one timed HTTP call; network errors and unexpected statuses both count as errors
+drogon::Task<drogon::HttpResponsePtr> timed(Run& run, const drogon::HttpClientPtr& client, const std::string& op,
+                                            drogon::HttpRequestPtr req, std::initializer_list<int> expected) {
+    const auto t0 = Clock::now();
+    drogon::HttpResponsePtr resp;
+    try {
+        resp = co_await client->sendRequestCoro(req, 30);
+    } catch (const std::exception&) {
+        run.stats.record(op, Clock::now() - t0, false);
+        co_return nullptr;
+    }
+    const int code = static_cast<int>(resp->statusCode());
+    const bool ok = std::find(expected.begin(), expected.end(), code) != expected.end();
+    run.stats.record(op, Clock::now() - t0, ok);
+    co_return ok ? resp : nullptr;
+}
+
+// waits for the task over the WebSocket; falls back to polling GET /api/v1/tasks/{id} when the socket is down
+drogon::Task<bool> awaitTask(Run& run, const drogon::HttpClientPtr& client, const std::shared_ptr<TaskWatch>& watch,
+                             bool wsUp, const std::string& op, const std::string& id, Clock::time_point submitted) {
+    auto* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    const auto deadline = submitted + run.options.taskTimeout;
+    while (Clock::now() < deadline) {
+        if (wsUp) {
+            std::lock_guard lock(watch->mutex_);
+            if (auto it = watch->finished.find(id); it != watch->finished.end()) {
+                run.stats.record(op, it->second.first - submitted, it->second.second);
+                watch->finished.erase(it);
+                co_return it->second.second;
+            }
+        } else if (auto resp = co_await timed(run, client, "task.poll", request(drogon::Get, "/api/v1/tasks/" + id), {200})) {
+            auto json = resp->getJsonObject();
+            const std::string status = json ? (*json)["status"].asString() : std::string{};
+            if (status == "completed" || status == "failed") {
+                run.stats.record(op, Clock::now() - submitted, status == "completed");
+                co_return status == "completed";
+            }
+        }
+        co_await drogon::sleepCoro(loop, wsUp ? 0.02 : 0.25);
+    }
+    run.stats.record(op, Clock::now() - submitted, false);
+    co_return false;
+}
+
+drogon::Task<> session(Run& run, unsigned int user, std::uint64_t iteration) {
+    const auto& o = run.options;
+    auto* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    auto client = drogon::HttpClient::newHttpClient(o.url, loop);
+
+    // status channel first, as the UI does
+    auto watch = std::make_shared<TaskWatch>();
+    std::string wsUrl = o.url;
+    if (wsUrl.rfind("http", 0) == 0) wsUrl.replace(0, 4, "ws");
+    auto ws = drogon::WebSocketClient::newWebSocketClient(wsUrl, loop);
+    ws->setMessageHandler([watch](const std::string& message, const drogon::WebSocketClientPtr&, const drogon::WebSocketMessageType& type) {
+        if (type != drogon::WebSocketMessageType::Text) return;
+        Json::Value v;
+        Json::Reader reader;
+        if (!reader.parse(message, v)) return;
+        const std::string status = v["status"].asString();
+        if (status != "completed" && status != "failed") return;
+        std::lock_guard lock(watch->mutex_);
+        watch->finished.try_emplace(v["taskId"].asString(), Clock::now(), status == "completed");
+    });
+    bool wsUp = false;
+    {
+        const auto t0 = Clock::now();
+        try {
+            co_await ws->connectToServerCoro(request(drogon::Get, "/ws/tasks"));
+            ws->getConnection()->send(R"({"subscribe":"*"})");
+            wsUp = true;
+        } catch (const std::exception&) {
+        }
+        run.stats.record("ws.connect", Clock::now() - t0, wsUp);
+    }
+
+    // create the lab: one deploy task per VM, all in flight at once
+    const std::string lab = "lg-" + std::to_string(user) + "-" + std::to_string(iteration);
+    std::vector<std::string> names;
+    std::vector<std::pair<std::string, Clock::time_point>> deploys;
+    for (unsigned int i = 0; i < o.vmsPerLab; ++i) {
+        Json::Value body;
+        body["name"] = lab + "-vm" + std::to_string(i);
+        body["memoryKiB"] = Json::UInt64(o.memoryKiB);
+        body["vcpus"] = o.vcpus;
+        if (!o.diskSource.empty()) body["disks"][0]["source"] = o.diskSource;
+        const auto submitted = Clock::now();
+        if (auto resp = co_await timed(run, client, "vm.create", jsonRequest(drogon::Post, "/api/v1/vms", body), {201, 202})) {
+            names.push_back(body["name"].asString());
+            auto json = resp->getJsonObject();
+            if (json && (*json)["taskId"].isString()) deploys.emplace_back((*json)["taskId"].asString(), submitted);
+        }
+    }
+    for (const auto& [id, submitted] : deploys) co_await awaitTask(run, client, watch, wsUp, "vm.deployed", id, submitted);
+
+    // image upload in chunks, as UploadManager.js does
+    if (o.uploadBytes > 0) {
+        Json::Value body;
+        body["fileName"] = lab + ".qcow2";
+        body["size"] = Json::UInt64(o.uploadBytes);
+        if (auto resp = co_await timed(run, client, "upload.begin", jsonRequest(drogon::Post, "/api/v1/uploads", body), {201})) {
+            auto json = resp->getJsonObject();
+            const std::string id = json ? (*json)["uploadId"].asString() : std::string{};
+            const std::string chunk(static_cast<std::size_t>(o.chunkBytes), '\0');
+            bool ok = !id.empty();
+            const auto t0 = Clock::now();
+            for (std::uint64_t offset = 0; ok && offset < o.uploadBytes; offset += o.chunkBytes) {
+                auto req = request(drogon::Put, "/api/v1/uploads/" + id);
+                req->addHeader("Upload-Offset", std::to_string(offset));
+                req->setContentTypeCode(drogon::CT_APPLICATION_OCTET_STREAM);
+                req->setBody(chunk.substr(0, static_cast<std::size_t>(std::min(o.chunkBytes, o.uploadBytes - offset))));
+                ok = co_await timed(run, client, "upload.chunk", req, {200}) != nullptr;
+            }
+            run.stats.record("upload.total", Clock::now() - t0, ok);
+            if (!id.empty()) co_await timed(run, client, "upload.abort", request(drogon::Delete, "/api/v1/uploads/" + id), {200, 204, 404});
+        }
+    }
+
+    // dashboard refresh and per-VM reads
+    co_await timed(run, client, "vm.list", request(drogon::Get, "/api/v1/vms"), {200});
+    for (const auto& name : names) co_await timed(run, client, "vm.get", request(drogon::Get, "/api/v1/vms/" + name), {200});
+
+    // tear the lab down (stops the domains)
+    std::vector<std::pair<std::string, Clock::time_point>> deletes;
+    for (const auto& name : names) {
+        const auto submitted = Clock::now();
+        if (auto resp = co_await timed(run, client, "vm.delete", request(drogon::Delete, "/api/v1/vms/" + name), {200, 202, 204})) {
+            auto json = resp->getJsonObject();
+            if (json && (*json)["taskId"].isString()) deletes.emplace_back((*json)["taskId"].asString(), submitted);
+        }
+    }
+    for (const auto& [id, submitted] : deletes) co_await awaitTask(run, client, watch, wsUp, "vm.deleted", id, submitted);
+
+    if (wsUp) ws->stop();
+}
+
+drogon::AsyncTask virtualUser(std::shared_ptr<Run> run, unsigned int user) {
+    run->active.fetch_add(1);
+    for (std::uint64_t iteration = 0; !run->done.load() && user < run->target.load(); ++iteration) {
+        const auto t0 = Clock::now();
+        try {
+            co_await session(*run, user, iteration);
+            run->stats.record("session", Clock::now() - t0, true);
+        } catch (const std::exception&) {
+            run->stats.record("session", Clock::now() - t0, false);
+        }
+    }
+    run->active.fetch_sub(1);
+}
+
+// target users at time t: linear from the previous stage's target to this one's
+unsigned int targetAt(const std::vector<Stage>& stages, Clock::duration t, bool& finished) {
+    unsigned int from = 0;
+    for (const auto& s : stages) {
+        if (t < s.duration) {
+            const double f = std::chrono::duration<double>(t) / std::chrono::duration<double>(s.duration);
+            finished = false;
+            return static_cast<unsigned int>(from + (static_cast<double>(s.users) - from) * f + 0.5);
+        }
+        t -= s.duration;
+        from = s.users;
+    }
+    finished = true;
+    return 0;
+}
+
+drogon::AsyncTask controller(std::shared_ptr<Run> run) {
+    auto* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    unsigned int spawned = 0;
+    auto lastReport = Clock::now();
+    for (;;) {
+        bool finished = false;
+        const unsigned int target = targetAt(run->options.stages, Clock::now() - run->started, finished);
+        run->target.store(target);
+        // users above the target finish their session and leave; below it, (re)spawn on the I/O loops
+        if (target < spawned && run->active.load() <= target) spawned = run->active.load();
+        for (; spawned < target; ++spawned) {
+            auto* ioLoop = drogon::app().getIOLoop(spawned % run->options.threads);
+            ioLoop->queueInLoop([run, user = spawned] { virtualUser(run, user); });
+        }
+        if (Clock::now() - lastReport >= run->options.reportEvery) {
+            run->stats.print(Clock::now() - run->started, run->active.load());
+            lastReport = Clock::now();
+        }
+        if (finished && run->active.load() == 0) break;
+        co_await drogon::sleepCoro(loop, 0.25);
+    }
+    run->done.store(true);
+    std::printf("\n=== final ===");
+    run->stats.print(Clock::now() - run->started, 0);
+    drogon::app().quit();
+}
+
+bool parseStage(std::string_view s, Stage& out) {
+    const auto colon = s.find(':');
+    if (colon == std::string_view::npos) return false;
+    unsigned long long secs = 0;
+    unsigned int users = 0;
+    if (std::from_chars(s.data(), s.data() + colon, secs).ec != std::errc{}) return false;
+    if (std::from_chars(s.data() + colon + 1, s.data() + s.size(), users).ec != std::errc{}) return false;
+    out = Stage{std::chrono::seconds(secs), users};
+    return true;
+}
+
+template <typename T>
+bool parseNumber(std::string_view s, T& out) {
+    return std::from_chars(s.data(), s.data() + s.size(), out).ec == std::errc{};
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: penhive-loadgen [--url http://host:port] [--stage SECONDS:USERS]... [--vms N]\n"
+        "                       [--memory-kib N] [--vcpus N] [--disk PATH] [--upload-bytes N] [--chunk-bytes N]\n"
+        "                       [--task-timeout SECONDS] [--report SECONDS] [--threads N]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const std::string_view value = i + 1 < argc ? std::string_view(argv[i + 1]) : std::string_view{};
+        bool ok = true;
+        unsigned long long n = 0;
+        if (arg == "--url") o.url = value;
+        else if (arg == "--stage") { Stage s; ok = parseStage(value, s); o.stages.push_back(s); }
+        else if (arg == "--vms") ok = parseNumber(value, o.vmsPerLab);
+        else if (arg == "--memory-kib") ok = parseNumber(value, o.memoryKiB);
+        else if (arg == "--vcpus") ok = parseNumber(value, o.vcpus);
+        else if (arg == "--disk") o.diskSource = value;
+        else if (arg == "--upload-bytes") ok = parseNumber(value, o.uploadBytes);
+        else if (arg == "--chunk-bytes") ok = parseNumber(value, o.chunkBytes) && o.chunkBytes > 0;
+        else if (arg == "--task-timeout") { ok = parseNumber(value, n); o.taskTimeout = std::chrono::seconds(n); }
+        else if (arg == "--report") { ok = parseNumber(value, n) && n > 0; o.reportEvery = std::chrono::seconds(n); }
+        else if (arg == "--threads") ok = parseNumber(value, o.threads) && o.threads > 0;
+        else { usage(); return arg == "--help" ? 0 : 2; }
+        if (!ok || value.empty()) {
+            std::fprintf(stderr, "bad value for %.*s\n", static_cast<int>(arg.size()), arg.data());
+            return 2;
+        }
+        ++i;
+    }
+    if (o.stages.empty()) o.stages = {{std::chrono::seconds(30), 10}, {std::chrono::seconds(60), 10}, {std::chrono::seconds(15), 0}};
+
+    auto run = std::make_shared<Run>();
+    run->options = std::move(o);
+    drogon::app().setThreadNum(run->options.threads);
+    drogon::app().getLoop()->queueInLoop([run] {
+        run->started = Clock::now();
+        controller(run);
+    });
+    drogon::app().run();
+    return 0;
+}
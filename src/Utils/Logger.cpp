@@ -0,0 +1,346 @@
+#include "Utils/Logger.hpp"
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/log/attributes/current_thread_id.hpp>
+#include <boost/log/attributes/mutable_constant.hpp>
+#include <boost/log/detail/thread_id.hpp>
+#include <boost/log/sources/severity_logger.hpp>
+#include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using ThreadId = attrs::current_thread_id::value_type;
+
+// what the caller captured; the flusher turns it back into a record with the caller's time and thread
+struct Entry {
+    severity_level level{severity_level::info};
+    boost::posix_time::ptime time;
+    ThreadId thread;
+    std::string message;
+};
+
+/**
+ * @brief Bounded multi-producer ring (Vyukov), drained by the single flusher
+ *
+ * Each cell carries a sequence number: a producer claims a slot with one
+ * CAS on head and publishes it by bumping the cell's sequence, so producers
+ * never wait on each other or on the consumer. A full ring is reported to
+ * the caller, which applies the overflow policy.
+ */
+class LogRing {
+public:
+    explicit LogRing(std::size_t capacity)
+        : mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1), cells(std::make_unique<Cell[]>(mask + 1))
+    {
+        for (std::size_t i = 0; i <= mask; ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // moves from e only on success
+    bool try_push(Entry& e) noexcept {
+        std::size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.entry = std::move(e);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consumer side: one thread only
+    bool try_pop(Entry& out) noexcept {
+        Cell& cell = cells[tail & mask];
+        if (cell.seq.load(std::memory_order_acquire) != tail + 1) return false;
+        out = std::move(cell.entry);
+        cell.seq.store(tail + mask + 1, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return cells[tail & mask].seq.load(std::memory_order_acquire) != tail + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> seq{0};
+        Entry entry;
+    };
+
+    const std::size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::size_t tail{0};
+};
+
+class AsyncBackend {
+public:
+    AsyncBackend(const BoostLogger::Config& config, std::vector<boost::shared_ptr<sinks::sink>> sinks)
+        : ring(config.queue_capacity), policy(config.overflow), interval(config.flush_interval), sinks_(std::move(sinks)),
+          time_attr(boost::posix_time::ptime{}), thread_attr(ThreadId{})
+    {
+        // source attributes win over the global ones, so records keep the caller's time and thread
+        logger.add_attribute("TimeStamp", time_attr);
+        logger.add_attribute("ThreadID", thread_attr);
+        running.store(true, std::memory_order_release);
+        flusher = std::thread([this] { run(); });
+    }
+
+    ~AsyncBackend() { stop(); }
+
+    bool push(severity_level level, std::string&& message) {
+        producers.fetch_add(1, std::memory_order_acq_rel);
+        if (!running.load(std::memory_order_acquire)) {
+            producers.fetch_sub(1, std::memory_order_acq_rel);
+            return false;
+        }
+        Entry e{level, boost::posix_time::microsec_clock::local_time(), bl::aux::this_thread::get_id(), std::move(message)};
+        bool pushed = ring.try_push(e);
+        if (!pushed && policy == BoostLogger::OverflowPolicy::Block) {
+            while (!(pushed = ring.try_push(e))) {
+                wake();
+                std::this_thread::yield();
+            }
+        }
+        if (pushed) {
+            // the flusher only sleeps on an empty ring, so one wake per idle period is enough;
+            // the fence pairs with the one in run(): either we see idle or the flusher sees the entry
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (idle.load(std::memory_order_relaxed)) wake();
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        producers.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    void stop() {
+        if (!running.exchange(false, std::memory_order_acq_rel)) return;
+        // a producer that saw running == true finishes its push before the final drain
+        while (producers.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+        {
+            std::lock_guard lock(mutex_);
+            stopping = true;
+        }
+        cv.notify_one();
+        if (flusher.joinable()) flusher.join();
+    }
+
+    [[nodiscard]] std::uint64_t droppedCount() const noexcept { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void wake() {
+        {
+            std::lock_guard lock(mutex_);
+            signalled = true;
+        }
+        cv.notify_one();
+    }
+
+    void run() {
+        Entry e;
+        std::uint64_t reportedDrops = 0;
+        for (;;) {
+            // one batch: everything queued right now, then a single flush of the file sink
+            std::size_t written = 0;
+            while (ring.try_pop(e)) {
+                write(e);
+                ++written;
+            }
+            if (const auto drops = dropped.load(std::memory_order_relaxed); drops != reportedDrops) {
+                Entry note{severity_level::warning, boost::posix_time::microsec_clock::local_time(), bl::aux::this_thread::get_id(),
+                           "log queue full: " + std::to_string(drops - reportedDrops) + " messages dropped"};
+                write(note);
+                reportedDrops = drops;
+                ++written;
+            }
+            if (written > 0) flush();
+
+            std::unique_lock lock(mutex_);
+            if (stopping) {
+                lock.unlock();
+                while (ring.try_pop(e)) write(e);
+                flush();
+                return;
+            }
+            idle.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // re-check after announcing idle: a push in between either sees idle or is popped now
+            if (!ring.empty()) {
+                idle.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            cv.wait_for(lock, interval, [this] { return signalled || stopping; });
+            signalled = false;
+            idle.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void write(Entry& e) {
+        time_attr.set(e.time);
+        thread_attr.set(e.thread);
+        BOOST_LOG_SEV(logger, e.level) << e.message;
+    }
+
+    void flush() {
+        for (auto& sink : sinks_) sink->flush();
+    }
+
+    LogRing ring;
+    const BoostLogger::OverflowPolicy policy;
+    const std::chrono::milliseconds interval;
+    std::vector<boost::shared_ptr<sinks::sink>> sinks_;
+
+    // used by the flusher thread only
+    src::severity_logger<severity_level> logger;
+    attrs::mutable_constant<boost::posix_time::ptime> time_attr;
+    attrs::mutable_constant<ThreadId> thread_attr;
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> idle{false};
+    std::atomic<std::size_t> producers{0};
+    std::atomic<std::uint64_t> dropped{0};
+
+    std::mutex mutex_;
+    std::condition_variable cv;
+    bool signalled{false};
+    bool stopping{false};
+    std::thread flusher;
+};
+
+// lives until static destruction, which drains it; Shutdown() stops it earlier
+std::unique_ptr<AsyncBackend> g_backend;
+
+thread_local const BoostLogger::Scope* t_scope = nullptr;
+
+// logfmt: key=value, quoted when the value has a space, quote or '='
+void appendField(std::string& line, std::string_view key, std::string_view value) {
+    if (value.empty()) return;
+    line += ' ';
+    line += key;
+    line += '=';
+    if (value.find_first_of(" \"=") == std::string_view::npos) {
+        line += value;
+        return;
+    }
+    line += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') line += '\\';
+        line += c;
+    }
+    line += '"';
+}
+
+} // namespace
+
+void BoostLogger::Init(const Config& config) {
+    std::lock_guard lock(s_init_mutex);
+    if (s_initialized.load(std::memory_order_relaxed)) return;
+
+    // مسح أي تسجيلات سابقة (لتجنب التكرار عند إعادة التهيئة)
+    bl::core::get()->remove_all_sinks();
+
+    // إضافة سمة الوقت والخطوة (thread id)
+    bl::add_common_attributes();
+
+    std::vector<boost::shared_ptr<sinks::sink>> added;
+
+    // sink للكونسول
+    if (config.enable_console) {
+        auto console_sink = bl::add_console_log(
+            std::clog,
+            bl::keywords::format = "[%TimeStamp%] [%ThreadID%] [%Severity%] %Message%"
+        );
+        console_sink->set_filter(severity >= to_boost_level(config.console_level));
+        added.push_back(console_sink);
+    }
+
+    // sink للملف؛ في الوضع غير المتزامن يُفرَّغ مرة لكل دفعة بدل كل سطر
+    if (config.enable_file) {
+        auto file_sink = bl::add_file_log(
+            bl::keywords::file_name = config.file_path,
+            bl::keywords::rotation_size = config.rotation_size,
+            bl::keywords::max_size = config.rotation_size * config.max_files,
+            bl::keywords::format = "[%TimeStamp%] [%ThreadID%] [%Severity%] %Message%",
+            bl::keywords::auto_flush = !config.async
+        );
+        file_sink->set_filter(severity >= to_boost_level(config.file_level));
+        added.push_back(file_sink);
+    }
+
+    // ضبط الحد الأدنى لمستوى التسجيل العام
+    bl::core::get()->set_filter(severity >= severity_level::trace);
+
+    // ما لا يقبله أي sink يُرفض قبل التنسيق
+    int floor = static_cast<int>(Level::fatal) + 1;
+    if (config.enable_console) floor = std::min(floor, static_cast<int>(config.console_level));
+    if (config.enable_file) floor = std::min(floor, static_cast<int>(config.file_level));
+    s_min_level.store(floor, std::memory_order_relaxed);
+
+    if (config.async) {
+        g_backend = std::make_unique<AsyncBackend>(config, std::move(added));
+        s_async.store(true, std::memory_order_release);
+    }
+
+    s_initialized.store(true, std::memory_order_release);
+}
+
+void BoostLogger::Shutdown() {
+    std::lock_guard lock(s_init_mutex);
+    s_async.store(false, std::memory_order_release);
+    if (g_backend) g_backend->stop();
+    bl::core::get()->flush();
+}
+
+std::uint64_t BoostLogger::Dropped() noexcept {
+    return g_backend ? g_backend->droppedCount() : 0;
+}
+
+BoostLogger::Scope::Scope(const LogFields& fields) : parent_(t_scope) {
+    auto keep = [this](std::string_view key, std::string_view value) {
+        if (!value.empty()) fields_.emplace_back(key, value);
+    };
+    keep("vm", fields.vm);
+    keep("lab", fields.lab);
+    keep("op_id", fields.op_id);
+    for (const auto& [key, value] : fields.extra) keep(key, value);
+    t_scope = this;
+}
+
+BoostLogger::Scope::~Scope() {
+    t_scope = parent_;
+}
+
+void BoostLogger::write(severity_level lvl, std::string&& line, const LogFields* fields) {
+    if (!s_initialized.load(std::memory_order_acquire)) {
+        // تهيئة افتراضية إذا لم تتم التهيئة يدويًا
+        Init();
+    }
+    if (fields) {
+        appendField(line, "vm", fields->vm);
+        appendField(line, "lab", fields->lab);
+        appendField(line, "op_id", fields->op_id);
+        for (const auto& [key, value] : fields->extra) appendField(line, key, value);
+    }
+    for (const Scope* scope = t_scope; scope; scope = scope->parent_) {
+        for (const auto& [key, value] : scope->fields_) appendField(line, key, value);
+    }
+    if (s_async.load(std::memory_order_acquire) && enqueue(lvl, std::move(line))) return;
+    BOOST_LOG_SEV(s_logger, lvl) << line;
+}
+
+bool BoostLogger::enqueue(severity_level lvl, std::string&& msg) {
+    return g_backend && g_backend->push(lvl, std::move(msg));
+}
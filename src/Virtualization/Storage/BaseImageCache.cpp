@@ -0,0 +1,120 @@
+#include "Virtualization/Storage/BaseImageCache.hpp"
+#include <iterator>
+
+void BaseImageCache::touch(Entry& entry) {
+    lru.splice(lru.begin(), lru, entry.lru);
+}
+
+BaseImageCache::Claim BaseImageCache::claim(std::string_view name, std::string_view sourcePath, CachedImage* hit) {
+    std::lock_guard lock(mutex_);
+    const std::string key(name);
+    if (auto it = entries.find(key); it != entries.end() && it->second.image.sourcePath == sourcePath) {
+        touch(it->second);
+        if (hit) *hit = it->second.image;
+        return Claim::Hit;
+    }
+    if (!pulling.insert(key).second) return Claim::Busy;
+    return Claim::Pull;
+}
+
+void BaseImageCache::completed(CachedImage image) {
+    std::lock_guard lock(mutex_);
+    const std::string key = image.name;
+    pulling.erase(key);
+    if (auto it = entries.find(key); it != entries.end()) {
+        // a copy of the old source that clones still back: keep it under a retired key until
+        // they are gone, so it can never be handed out again but is still evicted later
+        const std::string retired = key + '\x1f' + it->second.image.sourcePath;
+        auto node = entries.extract(it);
+        node.key() = retired;
+        *node.mapped().lru = retired;
+        entries.insert(std::move(node));
+        for (auto& [clone, owner] : cloneOf) {
+            if (owner == key) owner = retired;
+        }
+    }
+    used += image.bytes;
+    lru.push_front(key);
+    entries.emplace(key, Entry{std::move(image), lru.begin()});
+}
+
+void BaseImageCache::restore(CachedImage image, const std::vector<std::string>& cloneVolumes) {
+    std::lock_guard lock(mutex_);
+    const std::string key = image.name.empty() ? '\x1f' + image.volumeName : image.name;
+    if (entries.count(key)) return;
+    image.clones = 0;
+    for (const auto& clone : cloneVolumes) {
+        if (cloneOf.try_emplace(clone, key).second) ++image.clones;
+    }
+    used += image.bytes;
+    lru.push_back(key);
+    entries.emplace(key, Entry{std::move(image), std::prev(lru.end())});
+}
+
+void BaseImageCache::failed(std::string_view name) {
+    std::lock_guard lock(mutex_);
+    pulling.erase(std::string(name));
+}
+
+std::optional<CachedImage> BaseImageCache::pin(std::string_view name, std::string_view sourcePath, std::string_view cloneVolume) {
+    std::lock_guard lock(mutex_);
+    auto it = entries.find(std::string(name));
+    if (it == entries.end() || it->second.image.sourcePath != sourcePath) return std::nullopt;
+    touch(it->second);
+    if (cloneOf.try_emplace(std::string(cloneVolume), it->first).second) ++it->second.image.clones;
+    return it->second.image;
+}
+
+void BaseImageCache::release(std::string_view cloneVolume) {
+    std::lock_guard lock(mutex_);
+    auto c = cloneOf.find(std::string(cloneVolume));
+    if (c == cloneOf.end()) return;
+    if (auto it = entries.find(c->second); it != entries.end() && it->second.image.clones > 0) --it->second.image.clones;
+    cloneOf.erase(c);
+}
+
+BaseImageCache::Eviction BaseImageCache::evictFor(std::uint64_t incoming) {
+    std::lock_guard lock(mutex_);
+    Eviction out;
+    if (incoming > capacity) {
+        out.fits = false;
+        return out;
+    }
+    // walk from the cold end; pinned copies are skipped, not counted as freeable
+    auto it = lru.end();
+    while (used + incoming > capacity && it != lru.begin()) {
+        --it;
+        auto entry = entries.find(*it);
+        if (entry->second.image.clones > 0) continue;
+        used -= entry->second.image.bytes;
+        out.victims.push_back(std::move(entry->second.image));
+        entries.erase(entry);
+        it = lru.erase(it);
+    }
+    out.fits = used + incoming <= capacity;
+    return out;
+}
+
+std::optional<CachedImage> BaseImageCache::forget(std::string_view name) {
+    std::lock_guard lock(mutex_);
+    auto it = entries.find(std::string(name));
+    if (it == entries.end() || it->second.image.clones > 0) return std::nullopt;
+    CachedImage out = std::move(it->second.image);
+    used -= out.bytes;
+    lru.erase(it->second.lru);
+    entries.erase(it);
+    return out;
+}
+
+std::vector<CachedImage> BaseImageCache::list() const {
+    std::lock_guard lock(mutex_);
+    std::vector<CachedImage> out;
+    out.reserve(entries.size());
+    for (const auto& key : lru) out.push_back(entries.at(key).image);
+    return out;
+}
+
+std::uint64_t BaseImageCache::usedBytes() const {
+    std::lock_guard lock(mutex_);
+    return used;
+}
@@ -0,0 +1,33 @@
+#include "Virtualization/Storage/BaseImageRegistry.hpp"
+#include <mutex>
+
+void BaseImageRegistry::add(BaseImage image) {
+    std::unique_lock lk(mutex_);
+    auto key = image.name;
+    images.insert_or_assign(std::move(key), std::move(image));
+}
+
+bool BaseImageRegistry::remove(std::string_view name) {
+    std::unique_lock lk(mutex_);
+    return images.erase(std::string(name)) > 0;
+}
+
+std::optional<BaseImage> BaseImageRegistry::find(std::string_view name) const {
+    std::shared_lock lk(mutex_);
+    auto it = images.find(std::string(name));
+    if (it == images.end()) return std::nullopt;
+    return it->second;
+}
+
+std::vector<BaseImage> BaseImageRegistry::list() const {
+    std::shared_lock lk(mutex_);
+    std::vector<BaseImage> out;
+    out.reserve(images.size());
+    for (const auto& [_, img] : images) out.push_back(img);
+    return out;
+}
+
+std::size_t BaseImageRegistry::size() const {
+    std::shared_lock lk(mutex_);
+    return images.size();
+}
@@ -0,0 +1,294 @@
+#include "Virtualization/Storage/ImageImporter.hpp"
+#include "Virtualization/Storage/ContentHash.hpp"
+#include "Utils/Logger.hpp"
+#include <json/json.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <spawn.h>
+#include <string_view>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+constexpr std::size_t kIsoMagicOffset = 0x8001;
+constexpr std::size_t kHashChunk = 1 << 20;
+constexpr std::size_t kTarBlock = 512;
+
+bool at(const std::string& head, std::size_t offset, std::string_view magic) {
+    return head.size() >= offset + magic.size() && std::string_view(head).substr(offset, magic.size()) == magic;
+}
+
+// the qemu-img driver name for -f
+const char* driverOf(ImageFormat format) {
+    switch (format) {
+        case ImageFormat::Raw: return "raw";
+        case ImageFormat::Qcow2: return "qcow2";
+        case ImageFormat::Vmdk: return "vmdk";
+        case ImageFormat::Vdi: return "vdi";
+        case ImageFormat::Vhdx: return "vhdx";
+        case ImageFormat::Vpc: return "vpc";
+        default: return nullptr;
+    }
+}
+
+std::uint64_t octal(std::string_view field) {
+    std::uint64_t v = 0;
+    for (char c : field) {
+        if (c < '0' || c > '7') break;
+        v = v * 8 + static_cast<std::uint64_t>(c - '0');
+    }
+    return v;
+}
+
+// progress lines look like "    (42.17/100%)" and are separated by '\r'
+std::optional<double> progressOf(std::string_view line) {
+    const auto open = line.find('(');
+    const auto slash = line.find("/100%)");
+    if (open == std::string_view::npos || slash == std::string_view::npos || slash < open) return std::nullopt;
+    double percent = 0;
+    const auto digits = line.substr(open + 1, slash - open - 1);
+    if (std::from_chars(digits.data(), digits.data() + digits.size(), percent).ec != std::errc{}) return std::nullopt;
+    return percent;
+}
+
+std::uint64_t allocatedBytes(const std::filesystem::path& file) {
+    struct stat st{};
+    if (::stat(file.c_str(), &st) != 0) return 0;
+    return static_cast<std::uint64_t>(st.st_blocks) * 512;
+}
+
+// rename when both are on one filesystem, copy + remove otherwise
+Result<void> moveFile(const std::filesystem::path& from, const std::filesystem::path& to) {
+    std::error_code ec;
+    std::filesystem::rename(from, to, ec);
+    if (!ec) return Result<void>{};
+    if (ec != std::errc::cross_device_link) return Result<void>{"cannot move " + from.string() + ": " + ec.message()};
+    const auto part = to.parent_path() / ("." + to.filename().string() + ".part");
+    if (!std::filesystem::copy_file(from, part, std::filesystem::copy_options::overwrite_existing, ec)) {
+        std::filesystem::remove(part, ec);
+        return Result<void>{"cannot copy " + from.string() + ": " + ec.message()};
+    }
+    std::filesystem::rename(part, to, ec);
+    if (ec) return Result<void>{"cannot publish " + to.string() + ": " + ec.message()};
+    std::filesystem::remove(from, ec);
+    return Result<void>{};
+}
+
+// the same digest a streamed upload of these bytes gets
+std::string digestOf(const std::filesystem::path& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return {};
+    ContentHasher hasher;
+    std::string chunk(kHashChunk, '\0');
+    while (in) {
+        in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        if (in.gcount() > 0) hasher.update(std::string_view(chunk.data(), static_cast<std::size_t>(in.gcount())));
+    }
+    return in.bad() ? std::string{} : hasher.finish();
+}
+
+} // namespace
+
+const char* toString(ImageFormat format) noexcept {
+    switch (format) {
+        case ImageFormat::Raw: return "raw";
+        case ImageFormat::Qcow2: return "qcow2";
+        case ImageFormat::Vmdk: return "vmdk";
+        case ImageFormat::Vdi: return "vdi";
+        case ImageFormat::Vhdx: return "vhdx";
+        case ImageFormat::Vpc: return "vhd";
+        case ImageFormat::Ova: return "ova";
+        case ImageFormat::Iso: return "iso";
+        case ImageFormat::Unknown: break;
+    }
+    return "unknown";
+}
+
+ImageFormat ImageImporter::detect(const std::filesystem::path& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return ImageFormat::Unknown;
+    std::string head(kIsoMagicOffset + 5, '\0');
+    in.read(head.data(), static_cast<std::streamsize>(head.size()));
+    head.resize(static_cast<std::size_t>(in.gcount()));
+    if (head.empty()) return ImageFormat::Unknown;
+
+    if (at(head, 0, "QFI\xfb")) return ImageFormat::Qcow2;
+    if (at(head, 0, "KDMV") || at(head, 0, "# Disk DescriptorFile")) return ImageFormat::Vmdk;
+    if (at(head, 0x40, "\x7f\x10\xda\xbe")) return ImageFormat::Vdi;
+    if (at(head, 0, "vhdxfile")) return ImageFormat::Vhdx;
+    if (at(head, 0, "conectix")) return ImageFormat::Vpc;
+    if (at(head, 257, "ustar")) return ImageFormat::Ova;
+    if (at(head, kIsoMagicOffset, "CD001")) return ImageFormat::Iso;
+
+    // a fixed VHD only has its footer at the very end
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(file, ec);
+    if (!ec && size >= 512) {
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(size - 512));
+        std::string footer(8, '\0');
+        if (in.read(footer.data(), 8) && footer == "conectix") return ImageFormat::Vpc;
+    }
+    return ImageFormat::Raw;
+}
+
+Result<ImageImporter::TarMember> ImageImporter::findDisk(const std::filesystem::path& ova) {
+    std::ifstream in(ova, std::ios::binary);
+    if (!in) return Result<TarMember>{"cannot open " + ova.string()};
+    std::array<char, kTarBlock> header{};
+    std::uint64_t offset = 0;
+    while (in.read(header.data(), kTarBlock)) {
+        if (header[0] == '\0') break; // end-of-archive block
+        const std::string_view name(header.data(), strnlen(header.data(), 100));
+        const std::uint64_t size = octal(std::string_view(header.data() + 124, 12));
+        const char type = header[156];
+        if ((type == '0' || type == '\0') && name.size() > 5 && name.substr(name.size() - 5) == ".vmdk") {
+            return Result<TarMember>{TarMember{offset + kTarBlock, size}};
+        }
+        const std::uint64_t skip = (size + kTarBlock - 1) / kTarBlock * kTarBlock;
+        offset += kTarBlock + skip;
+        in.seekg(static_cast<std::streamoff>(offset));
+    }
+    return Result<TarMember>{"no .vmdk disk in " + ova.string()};
+}
+
+Result<void> ImageImporter::run(const std::vector<std::string>& argv, const Progress& progress) const {
+    int out[2];
+    if (::pipe(out) != 0) return Result<void>{std::string("pipe failed: ") + std::strerror(errno)};
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, out[0]);
+
+    std::vector<char*> args;
+    args.reserve(argv.size() + 1);
+    for (const auto& a : argv) args.push_back(const_cast<char*>(a.c_str()));
+    args.push_back(nullptr);
+
+    pid_t pid = 0;
+    const int rc = posix_spawnp(&pid, args[0], &actions, nullptr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(out[1]);
+    if (rc != 0) {
+        ::close(out[0]);
+        return Result<void>{"cannot run " + argv[0] + ": " + std::strerror(rc)};
+    }
+
+    // progress comes on stdout, errors on stderr; both share the pipe and the last other line is the error
+    std::string pending;
+    std::string lastMessage;
+    std::array<char, 4096> chunk{};
+    for (;;) {
+        const ssize_t n = ::read(out[0], chunk.data(), chunk.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        pending.append(chunk.data(), static_cast<std::size_t>(n));
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < pending.size(); ++i) {
+            if (pending[i] != '\r' && pending[i] != '\n') continue;
+            const std::string_view line(pending.data() + start, i - start);
+            start = i + 1;
+            if (line.find_first_not_of(" \t") == std::string_view::npos) continue;
+            if (auto percent = progressOf(line)) {
+                if (progress) progress(*percent);
+            } else {
+                lastMessage = std::string(line);
+            }
+        }
+        pending.erase(0, start);
+    }
+    ::close(out[0]);
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) return Result<void>{};
+    std::string err = argv[0] + " " + argv[1] + " failed";
+    if (WIFEXITED(status)) err += " (exit " + std::to_string(WEXITSTATUS(status)) + ")";
+    if (WIFSIGNALED(status)) err += " (signal " + std::to_string(WTERMSIG(status)) + ")";
+    if (!lastMessage.empty()) err += ": " + lastMessage;
+    return Result<void>{std::move(err)};
+}
+
+Result<ImportResult> ImageImporter::import(const std::filesystem::path& source,
+                                           const std::filesystem::path& outputDir,
+                                           const Progress& progress) const {
+    using R = Result<ImportResult>;
+    ImportResult result;
+    result.sourceFormat = detect(source);
+    if (result.sourceFormat == ImageFormat::Unknown) return R{"cannot read " + source.string()};
+    std::error_code ec;
+    result.sourceBytes = std::filesystem::file_size(source, ec);
+
+    const bool iso = result.sourceFormat == ImageFormat::Iso;
+    result.outputFormat = iso ? "raw" : "qcow2";
+    result.output = outputDir / (source.stem().string() + (iso ? ".iso" : ".qcow2"));
+    if (std::filesystem::exists(result.output, ec)) return R{"already exists: " + result.output.string()};
+
+    // nothing to convert: publish the upload itself
+    if (iso || (result.sourceFormat == ImageFormat::Qcow2 && !options.compress)) {
+        if (auto moved = moveFile(source, result.output); moved.isErr()) return R{std::move(moved).unwrapErr()};
+        result.allocatedBytes = allocatedBytes(result.output);
+        result.digest = digestOf(result.output);
+        if (progress) progress(100.0);
+        return R{std::move(result)};
+    }
+
+    std::vector<std::string> argv = {options.qemuImg, "convert", "-p", "-O", "qcow2",
+                                     "-m", std::to_string(std::clamp(options.coroutines, 1u, 16u)), "-S", "4k"};
+    // compressed clusters have to be written in order
+    if (options.compress) argv.push_back("-c");
+    else argv.push_back("-W");
+
+    if (result.sourceFormat == ImageFormat::Ova) {
+        auto disk = findDisk(source);
+        if (disk.isErr()) return R{std::move(disk).unwrapErr()};
+        // the raw driver exposes the tar member as a file, vmdk reads it from there
+        Json::Value file;
+        file["driver"] = "file";
+        file["filename"] = source.string();
+        Json::Value slice;
+        slice["driver"] = "raw";
+        slice["offset"] = Json::UInt64(disk.unwrap().offset);
+        slice["size"] = Json::UInt64(disk.unwrap().size);
+        slice["file"] = std::move(file);
+        Json::Value spec;
+        spec["driver"] = "vmdk";
+        spec["file"] = std::move(slice);
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        argv.push_back("json:" + Json::writeString(writer, spec));
+    } else {
+        argv.push_back("-f");
+        argv.push_back(driverOf(result.sourceFormat));
+        argv.push_back(source.string());
+    }
+    const auto part = outputDir / ("." + result.output.filename().string() + ".part");
+    argv.push_back(part.string());
+
+    BoostLogger::Info("Import " + source.filename().string() + ": " + toString(result.sourceFormat) + " -> qcow2");
+    if (auto converted = run(argv, progress); converted.isErr()) {
+        std::filesystem::remove(part, ec);
+        return R{std::move(converted).unwrapErr()};
+    }
+    std::filesystem::rename(part, result.output, ec);
+    if (ec) {
+        std::filesystem::remove(part, ec);
+        return R{"cannot publish " + result.output.string() + ": " + ec.message()};
+    }
+    std::filesystem::remove(source, ec);
+    result.converted = true;
+    result.allocatedBytes = allocatedBytes(result.output);
+    result.digest = digestOf(result.output);
+    return R{std::move(result)};
+}
@@ -0,0 +1,248 @@
+#include "Virtualization/Storage/ImageObjectStore.hpp"
+#include "Core/interfaces/IDatabase.hpp"
+#include <charconv>
+#include <functional>
+#include <mutex>
+
+namespace {
+
+constexpr std::string_view kObjectPrefix = "img/obj/";
+constexpr std::string_view kNamePrefix = "img/name/";
+constexpr std::string_view kClonePrefix = "img/clone/";
+constexpr char kSep = '\x1f';
+
+std::string key(std::string_view prefix, std::string_view id) {
+    std::string out(prefix);
+    out += id;
+    return out;
+}
+
+std::string encode(const ImageObject& o) {
+    std::string out = o.volumeName;
+    out += kSep;
+    out += o.format;
+    out += kSep;
+    out += std::to_string(o.sizeBytes);
+    return out;
+}
+
+std::optional<ImageObject> decode(std::string_view digest, std::string_view v) {
+    const auto a = v.find(kSep);
+    if (a == std::string_view::npos) return std::nullopt;
+    const auto b = v.find(kSep, a + 1);
+    if (b == std::string_view::npos) return std::nullopt;
+    ImageObject o;
+    o.digest = std::string(digest);
+    o.volumeName = std::string(v.substr(0, a));
+    o.format = std::string(v.substr(a + 1, b - a - 1));
+    const auto size = v.substr(b + 1);
+    std::from_chars(size.data(), size.data() + size.size(), o.sizeBytes);
+    return o;
+}
+
+// upper bound = prefix with its last byte incremented, as in VmMetadataStore
+void scanPrefix(IRocksDB& db, std::string_view prefix, const std::function<void(std::string_view, std::string_view)>& fn) {
+    std::string upper(prefix);
+    upper.back() = static_cast<char>(upper.back() + 1);
+    rocksdb::Slice upperSlice(upper);
+    rocksdb::ReadOptions ro;
+    ro.iterate_upper_bound = &upperSlice;
+    ro.fill_cache = false;
+    auto it = db.NewIterator(ro);
+    if (!it) return;
+    for (it->Seek(rocksdb::Slice(prefix.data(), prefix.size())); it->Valid(); it->Next()) {
+        const auto k = it->key();
+        const auto v = it->value();
+        fn(std::string_view(k.data(), k.size()).substr(prefix.size()), std::string_view(v.data(), v.size()));
+    }
+}
+
+} // namespace
+
+ImageObject ImageObjectStore::Entry::snapshot() const {
+    ImageObject out = object;
+    out.names = names.size();
+    out.clones = clones.size();
+    return out;
+}
+
+ImageObjectStore::ImageObjectStore(std::shared_ptr<IRocksDB> db)
+    : db(std::move(db)) {}
+
+std::size_t ImageObjectStore::load() {
+    if (!db) return 0;
+    std::unique_lock lock(mutex_);
+    objects.clear();
+    byName.clear();
+    byClone.clear();
+    scanPrefix(*db, kObjectPrefix, [&](std::string_view digest, std::string_view value) {
+        if (auto o = decode(digest, value)) objects[o->digest].object = std::move(*o);
+    });
+    // references to an object whose key is gone are dangling; they are ignored, not resurrected
+    scanPrefix(*db, kNamePrefix, [&](std::string_view name, std::string_view digest) {
+        auto it = objects.find(std::string(digest));
+        if (it == objects.end()) return;
+        it->second.names.emplace(name);
+        byName.insert_or_assign(std::string(name), it->first);
+    });
+    scanPrefix(*db, kClonePrefix, [&](std::string_view clone, std::string_view digest) {
+        auto it = objects.find(std::string(digest));
+        if (it == objects.end()) return;
+        it->second.clones.emplace(clone);
+        byClone.insert_or_assign(std::string(clone), it->first);
+    });
+    return objects.size();
+}
+
+Result<ImageCommit> ImageObjectStore::commit(const ImageObject& candidate, std::string_view name) {
+    if (candidate.digest.empty() || candidate.volumeName.empty() || name.empty()) {
+        return Result<ImageCommit>{std::string("digest, volume and name are required")};
+    }
+    const std::string nameKey(name);
+    std::unique_lock lock(mutex_);
+
+    auto existing = objects.find(candidate.digest);
+    auto previous = byName.find(nameKey);
+    const std::string previousDigest = previous == byName.end() ? std::string{} : previous->second;
+    if (previousDigest == candidate.digest) {
+        ImageCommit same{existing->second.snapshot(), existing->second.object.volumeName != candidate.volumeName, std::nullopt};
+        return Result<ImageCommit>{std::move(same)};
+    }
+
+    // the name moves away from its old content; that object may now be unreferenced
+    std::optional<std::string> orphanDigest;
+    if (!previousDigest.empty()) {
+        const auto& old = objects.at(previousDigest);
+        if (old.names.size() == 1 && old.clones.empty()) orphanDigest = previousDigest;
+    }
+
+    if (db) {
+        rocksdb::WriteBatch batch;
+        if (existing == objects.end()) batch.Put(key(kObjectPrefix, candidate.digest), encode(candidate));
+        batch.Put(key(kNamePrefix, name), candidate.digest);
+        if (orphanDigest) batch.Delete(key(kObjectPrefix, *orphanDigest));
+        if (auto res = db->Write(rocksdb::WriteOptions{}, batch); !res) {
+            return Result<ImageCommit>{"cannot persist image index: " + res.error().ToString()};
+        }
+    }
+
+    ImageCommit out;
+    if (!previousDigest.empty()) {
+        objects.at(previousDigest).names.erase(nameKey);
+        if (orphanDigest) out.orphaned = dropIfUnreferenced(*orphanDigest);
+    }
+    if (existing == objects.end()) {
+        existing = objects.emplace(candidate.digest, Entry{}).first;
+        existing->second.object = candidate;
+    } else {
+        out.duplicate = existing->second.object.volumeName != candidate.volumeName;
+    }
+    existing->second.names.insert(nameKey);
+    byName.insert_or_assign(nameKey, candidate.digest);
+    out.object = existing->second.snapshot();
+    return Result<ImageCommit>{std::move(out)};
+}
+
+std::optional<ImageObject> ImageObjectStore::dropIfUnreferenced(const std::string& digest) {
+    auto it = objects.find(digest);
+    if (it == objects.end() || !it->second.names.empty() || !it->second.clones.empty()) return std::nullopt;
+    ImageObject out = it->second.snapshot();
+    objects.erase(it);
+    return out;
+}
+
+std::optional<ImageObject> ImageObjectStore::find(std::string_view digest) const {
+    std::shared_lock lock(mutex_);
+    auto it = objects.find(std::string(digest));
+    if (it == objects.end()) return std::nullopt;
+    return it->second.snapshot();
+}
+
+std::optional<ImageObject> ImageObjectStore::resolve(std::string_view nameOrDigest) const {
+    std::shared_lock lock(mutex_);
+    const std::string key(nameOrDigest);
+    auto named = byName.find(key);
+    auto it = objects.find(named == byName.end() ? key : named->second);
+    if (it == objects.end()) return std::nullopt;
+    return it->second.snapshot();
+}
+
+std::optional<ImageObject> ImageObjectStore::findByVolume(std::string_view volumeName) const {
+    std::shared_lock lock(mutex_);
+    for (const auto& [_, entry] : objects) {
+        if (entry.object.volumeName == volumeName) return entry.snapshot();
+    }
+    return std::nullopt;
+}
+
+Result<std::optional<ImageObject>> ImageObjectStore::releaseName(std::string_view name) {
+    using R = Result<std::optional<ImageObject>>;
+    std::unique_lock lock(mutex_);
+    auto named = byName.find(std::string(name));
+    if (named == byName.end()) return R{std::optional<ImageObject>{}};
+    const std::string digest = named->second;
+    auto& entry = objects.at(digest);
+    const bool last = entry.names.size() == 1 && entry.clones.empty();
+    if (db) {
+        rocksdb::WriteBatch batch;
+        batch.Delete(key(kNamePrefix, name));
+        if (last) batch.Delete(key(kObjectPrefix, digest));
+        if (auto res = db->Write(rocksdb::WriteOptions{}, batch); !res) {
+            return R{"cannot persist image index: " + res.error().ToString()};
+        }
+    }
+    entry.names.erase(named->first);
+    byName.erase(named);
+    return R{dropIfUnreferenced(digest)};
+}
+
+Result<void> ImageObjectStore::retainClone(std::string_view digest, std::string_view cloneVolume) {
+    std::unique_lock lock(mutex_);
+    auto it = objects.find(std::string(digest));
+    if (it == objects.end()) return Result<void>{"unknown image object: " + std::string(digest)};
+    if (db) {
+        if (auto res = db->Put(rocksdb::WriteOptions{}, key(kClonePrefix, cloneVolume), digest); !res) {
+            return Result<void>{"cannot persist image index: " + res.error().ToString()};
+        }
+    }
+    it->second.clones.emplace(cloneVolume);
+    byClone.insert_or_assign(std::string(cloneVolume), it->first);
+    return Result<void>{};
+}
+
+Result<std::optional<ImageObject>> ImageObjectStore::releaseClone(std::string_view cloneVolume) {
+    using R = Result<std::optional<ImageObject>>;
+    std::unique_lock lock(mutex_);
+    auto cloned = byClone.find(std::string(cloneVolume));
+    if (cloned == byClone.end()) return R{std::optional<ImageObject>{}};
+    const std::string digest = cloned->second;
+    auto& entry = objects.at(digest);
+    const bool last = entry.clones.size() == 1 && entry.names.empty();
+    if (db) {
+        rocksdb::WriteBatch batch;
+        batch.Delete(key(kClonePrefix, cloneVolume));
+        if (last) batch.Delete(key(kObjectPrefix, digest));
+        if (auto res = db->Write(rocksdb::WriteOptions{}, batch); !res) {
+            return R{"cannot persist image index: " + res.error().ToString()};
+        }
+    }
+    entry.clones.erase(cloned->first);
+    byClone.erase(cloned);
+    return R{dropIfUnreferenced(digest)};
+}
+
+std::vector<std::pair<std::string, ImageObject>> ImageObjectStore::aliases() const {
+    std::shared_lock lock(mutex_);
+    std::vector<std::pair<std::string, ImageObject>> out;
+    out.reserve(byName.size());
+    for (const auto& [name, digest] : byName) out.emplace_back(name, objects.at(digest).snapshot());
+    return out;
+}
+
+std::vector<ImageObject> ImageObjectStore::list() const {
+    std::shared_lock lock(mutex_);
+    std::vector<ImageObject> out;
+    out.reserve(objects.size());
+    for (const auto& [_, entry] : objects) out.push_back(entry.snapshot());
+    return out;
+}
@@ -0,0 +1,452 @@
+#include "Virtualization/Storage/VirtualMachineStorageManager.hpp"
+#include "Virtualization/builder/VolumeDefinitionBuilder.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Utils/Logger.hpp"
+#include <pugixml.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+namespace {
+
+struct PoolDeleter { void operator()(virStoragePoolPtr p) const noexcept { if (p) virStoragePoolFree(p); } };
+struct VolDeleter { void operator()(virStorageVolPtr v) const noexcept { if (v) virStorageVolFree(v); } };
+using PoolPtr = std::unique_ptr<std::remove_pointer_t<virStoragePoolPtr>, PoolDeleter>;
+using VolPtr = std::unique_ptr<std::remove_pointer_t<virStorageVolPtr>, VolDeleter>;
+
+std::string lastError() {
+    virErrorPtr e = virGetLastError();
+    return e && e->message ? e->message : "unknown";
+}
+
+std::string takeString(char* s) {
+    if (!s) return {};
+    std::string out(s);
+    free(s);
+    return out;
+}
+
+// "kali-2024.1.qcow2" -> "kali-2024.1"
+std::string logicalName(std::string_view volumeName) {
+    for (std::string_view ext : { ".qcow2", ".img", ".raw" }) {
+        if (volumeName.size() > ext.size() && volumeName.substr(volumeName.size() - ext.size()) == ext) {
+            return std::string(volumeName.substr(0, volumeName.size() - ext.size()));
+        }
+    }
+    return std::string(volumeName);
+}
+
+// the cache pool volume of a base: named after the source path, so a pinned older copy and a fresh one never collide
+std::string cacheVolumeName(const BaseImage& base) {
+    char tag[17];
+    std::snprintf(tag, sizeof(tag), "%016zx", std::hash<std::string>{}(base.path));
+    return std::string(tag) + "-" + base.volumeName;
+}
+
+// connector->acquire() throws; storage calls report failures through Result
+std::optional<HypervisorConnectionPool::Lease> tryLease(HypervisorConnector& connector, std::string& error) {
+    try {
+        return connector.acquire();
+    } catch (const std::exception& e) {
+        error = e.what();
+        return std::nullopt;
+    }
+}
+
+} // namespace
+
+StorageOrchestrator::StorageOrchestrator(std::shared_ptr<HypervisorConnector> conn, std::string basePool, std::string clonePool)
+    : connector(std::move(conn)), basePoolName(std::move(basePool)), clonePoolName(std::move(clonePool)) {}
+
+void StorageOrchestrator::registerBaseImage(BaseImage image) {
+    registry.add(std::move(image));
+}
+
+void StorageOrchestrator::attachObjectStore(std::shared_ptr<ImageObjectStore> store) {
+    objects = std::move(store);
+}
+
+Result<BaseImage> StorageOrchestrator::describeBaseVolume(std::string_view name, const std::string& volumeName) const {
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) return Err{"not connected: " + connErr};
+    PoolPtr pool(virStoragePoolLookupByName(lease->get(), basePoolName.c_str()));
+    if (!pool) return Err{"base pool '" + basePoolName + "' not found: " + lastError()};
+    VolPtr vol(virStorageVolLookupByName(pool.get(), volumeName.c_str()));
+    if (!vol) return Err{"base volume not found: " + volumeName};
+    BaseImage img;
+    img.name = std::string(name);
+    img.volumeName = volumeName;
+    img.path = takeString(virStorageVolGetPath(vol.get()));
+    virStorageVolInfo info{};
+    if (virStorageVolGetInfo(vol.get(), &info) == 0) img.capacityBytes = info.capacity;
+    return Result<BaseImage>{std::move(img)};
+}
+
+Result<BaseImage> StorageOrchestrator::adoptObject(std::string_view name, const ImageObject& object) {
+    auto img = describeBaseVolume(name, object.volumeName);
+    if (img.isErr()) return img;
+    img.unwrap().format = object.format;
+    registry.add(img.unwrap());
+    // the digest works as a name too: templates may pin the exact content
+    BaseImage pinned = img.unwrap();
+    pinned.name = object.digest;
+    registry.add(std::move(pinned));
+    return img;
+}
+
+Result<void> StorageOrchestrator::deleteBaseVolume(std::string_view volumeName) {
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) return Result<void>{"not connected: " + connErr};
+    PoolPtr pool(virStoragePoolLookupByName(lease->get(), basePoolName.c_str()));
+    if (!pool) return Result<void>{"base pool '" + basePoolName + "' not found: " + lastError()};
+    VolPtr vol(virStorageVolLookupByName(pool.get(), std::string(volumeName).c_str()));
+    if (!vol) return Result<void>{};
+    if (virStorageVolDelete(vol.get(), 0) < 0) return Result<void>{"virStorageVolDelete failed: " + lastError()};
+    return Result<void>{};
+}
+
+void StorageOrchestrator::releaseObject(const ImageObject& object) {
+    registry.remove(object.digest);
+    registry.remove(logicalName(object.volumeName));
+    if (auto res = deleteBaseVolume(object.volumeName); res.isErr()) {
+        BoostLogger::Warn("Cannot delete unreferenced base " + object.volumeName + ": " + res.unwrapErr());
+        return;
+    }
+    BoostLogger::Info("Deleted unreferenced base " + object.volumeName + " (" + object.digest + ")");
+}
+
+Result<ImageCommit> StorageOrchestrator::commitBaseVolume(std::string_view name, const ImageObject& candidate) {
+    if (!objects) return Err{std::string("no image object store attached")};
+    auto committed = objects->commit(candidate, name);
+    if (committed.isErr()) return committed;
+    const auto& res = committed.unwrap();
+    if (res.duplicate) {
+        if (auto dropped = deleteBaseVolume(candidate.volumeName); dropped.isErr()) {
+            BoostLogger::Warn("Cannot drop duplicate import " + candidate.volumeName + ": " + dropped.unwrapErr());
+        } else {
+            BoostLogger::Info("Import " + candidate.volumeName + " is a duplicate of " + res.object.volumeName +
+                              " (" + candidate.digest + ")");
+        }
+    }
+    if (res.orphaned) releaseObject(*res.orphaned);
+    if (auto adopted = adoptObject(name, res.object); adopted.isErr()) {
+        BoostLogger::Warn("Base image " + std::string(name) + " not registered: " + adopted.unwrapErr());
+    }
+    return committed;
+}
+
+Result<std::vector<std::string>> StorageOrchestrator::listBaseVolumes() const {
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) return Result<std::vector<std::string>>{"not connected: " + connErr};
+    PoolPtr pool(virStoragePoolLookupByName(lease->get(), basePoolName.c_str()));
+    if (!pool) return Result<std::vector<std::string>>{"base pool '" + basePoolName + "' not found: " + lastError()};
+    virStoragePoolRefresh(pool.get(), 0);
+
+    virStorageVolPtr* vols = nullptr;
+    int n = virStoragePoolListAllVolumes(pool.get(), &vols, 0);
+    if (n < 0) return Result<std::vector<std::string>>{"cannot list base volumes: " + lastError()};
+
+    std::vector<std::string> names;
+    names.reserve(static_cast<std::size_t>(n));
+    std::unordered_map<std::string, BaseImage> byVolume; // for the content-store aliases below
+    for (int i = 0; i < n; ++i) {
+        VolPtr vol(vols[i]);
+        const char* volName = virStorageVolGetName(vol.get());
+        if (!volName) continue;
+        BaseImage img;
+        img.volumeName = volName;
+        img.name = logicalName(img.volumeName);
+        img.path = takeString(virStorageVolGetPath(vol.get()));
+        virStorageVolInfo info{};
+        if (virStorageVolGetInfo(vol.get(), &info) == 0) img.capacityBytes = info.capacity;
+        if (img.volumeName.ends_with(".img") || img.volumeName.ends_with(".raw")) img.format = "raw";
+        names.push_back(img.name);
+        if (objects) byVolume.emplace(img.volumeName, img);
+        registry.add(std::move(img));
+    }
+    free(vols);
+    if (objects) {
+        // deduplicated uploads have no volume of their own: their names point at the object's
+        for (const auto& [alias, object] : objects->aliases()) {
+            auto it = byVolume.find(object.volumeName);
+            if (it == byVolume.end()) continue;
+            for (const std::string* name : { &alias, &object.digest }) {
+                BaseImage img = it->second;
+                img.name = *name;
+                img.format = object.format;
+                registry.add(std::move(img));
+            }
+            names.push_back(alias);
+        }
+    }
+    return Result<std::vector<std::string>>{std::move(names)};
+}
+
+Result<BaseImage> StorageOrchestrator::resolveBase(std::string_view baseName) const {
+    auto base = registry.find(baseName);
+    if (!base) {
+        // first use after startup: learn the base pool once
+        auto listed = listBaseVolumes();
+        if (listed.isErr()) return Err{std::move(listed).unwrapErr()};
+        base = registry.find(baseName);
+        if (!base) return Err{"unknown base image: " + std::string(baseName)};
+    }
+    return Result<BaseImage>{std::move(*base)};
+}
+
+Result<std::string> StorageOrchestrator::createLinkedClone(std::string_view baseName, std::string_view cloneBaseName) {
+    auto resolved = resolveBase(baseName);
+    if (resolved.isErr()) return Err{std::move(resolved).unwrapErr()};
+    const BaseImage* base = &resolved.unwrap();
+    const std::string cloneVolume = std::string(cloneBaseName) + ".qcow2";
+
+    // a prefetched local copy wins over the shared one; pinned now so it is not evicted under the clone
+    std::string backing = base->path;
+    std::optional<CachedImage> local;
+    if (cache) local = cache->pin(base->name, base->path, cloneVolume);
+    if (local) backing = local->path;
+    auto unpin = [&] { if (local) cache->release(cloneVolume); };
+
+    std::string xml;
+    try {
+        xml = VolumeDefinitionBuilder()
+                  .setName(cloneVolume)
+                  .setFormat("qcow2")
+                  .setCapacity(base->capacityBytes)
+                  .setBackingStore(backing)
+                  .setBackingFormat(base->format)
+                  .build();
+    } catch (const StorageException& e) {
+        unpin();
+        return Err{std::string(e.what())};
+    }
+
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) {
+        unpin();
+        return Err{"not connected: " + connErr};
+    }
+    PoolPtr pool(virStoragePoolLookupByName(lease->get(), clonePoolName.c_str()));
+    if (!pool) {
+        unpin();
+        return Err{"clone pool '" + clonePoolName + "' not found: " + lastError()};
+    }
+
+    VolPtr vol(virStorageVolCreateXML(pool.get(), xml.c_str(), 0));
+    if (!vol) {
+        unpin();
+        return Err{"virStorageVolCreateXML failed: " + lastError()};
+    }
+    std::string path = takeString(virStorageVolGetPath(vol.get()));
+    if (objects) {
+        // the clone pins its backing object; without the reference the base could be deleted under it
+        if (auto object = objects->findByVolume(base->volumeName)) {
+            if (auto held = objects->retainClone(object->digest, cloneVolume); held.isErr()) {
+                virStorageVolDelete(vol.get(), 0);
+                unpin();
+                return Err{std::move(held).unwrapErr()};
+            }
+        }
+    }
+    BoostLogger::Info("Linked clone " + path + " -> " + backing);
+    return Result<std::string>{std::move(path)};
+}
+
+Result<void> StorageOrchestrator::deleteVolume(std::string_view volumeName) {
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) return Result<void>{"not connected: " + connErr};
+    PoolPtr pool(virStoragePoolLookupByName(lease->get(), clonePoolName.c_str()));
+    if (!pool) return Result<void>{"clone pool '" + clonePoolName + "' not found: " + lastError()};
+    VolPtr vol(virStorageVolLookupByName(pool.get(), std::string(volumeName).c_str()));
+    if (!vol) return Result<void>{"volume not found: " + std::string(volumeName)};
+    if (virStorageVolDelete(vol.get(), 0) < 0) return Result<void>{"virStorageVolDelete failed: " + lastError()};
+    if (cache) cache->release(volumeName);
+    if (objects) {
+        auto released = objects->releaseClone(volumeName);
+        if (released.isErr()) BoostLogger::Warn("Image index: " + released.unwrapErr());
+        else if (released.unwrap()) releaseObject(*released.unwrap());
+    }
+    return Result<void>{};
+}
+
+Result<std::string> StorageOrchestrator::getVolumePath(std::string_view volumeName) const {
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) return Err{"not connected: " + connErr};
+    const std::string name(volumeName);
+    for (const std::string* poolName : { &clonePoolName, &basePoolName }) {
+        PoolPtr pool(virStoragePoolLookupByName(lease->get(), poolName->c_str()));
+        if (!pool) continue;
+        VolPtr vol(virStorageVolLookupByName(pool.get(), name.c_str()));
+        if (vol) return Result<std::string>{takeString(virStorageVolGetPath(vol.get()))};
+    }
+    return Err{"volume not found: " + name};
+}
+
+void StorageOrchestrator::attachCache(std::shared_ptr<BaseImageCache> baseCache, std::string cachePool) {
+    cache = std::move(baseCache);
+    cachePoolName = std::move(cachePool);
+}
+
+Result<std::string> StorageOrchestrator::prefetch(std::string_view baseName) {
+    if (!cache) return Err{std::string("no base image cache on this host")};
+    auto base = resolveBase(baseName);
+    if (base.isErr()) return Err{std::move(base).unwrapErr()};
+    static auto& hits = METRICS::MetricsRegistry::global().counter("penhive_base_cache_hits_total", "Prefetches served by the local base cache");
+    static auto& pulls = METRICS::MetricsRegistry::global().counter("penhive_base_cache_pulls_total", "Base images copied into the local cache");
+
+    CachedImage hit;
+    switch (cache->claim(base.unwrap().name, base.unwrap().path, &hit)) {
+        case BaseImageCache::Claim::Hit:
+            hits.inc();
+            return Result<std::string>{std::move(hit.path)};
+        case BaseImageCache::Claim::Busy:
+            return Err{"prefetch of " + base.unwrap().name + " already running"};
+        case BaseImageCache::Claim::Pull:
+            break;
+    }
+    auto pulled = pullToCache(base.unwrap());
+    if (pulled.isErr()) {
+        cache->failed(base.unwrap().name);
+        return Err{std::move(pulled).unwrapErr()};
+    }
+    pulls.inc();
+    std::string path = pulled.unwrap().path;
+    BoostLogger::Info("Base cache: " + base.unwrap().name + " -> " + path + " ("
+                      + std::to_string(pulled.unwrap().bytes >> 20) + " MiB)");
+    cache->completed(std::move(pulled).unwrap());
+    return Result<std::string>{std::move(path)};
+}
+
+Result<std::size_t> StorageOrchestrator::loadCache() {
+    if (!cache) return Result<std::size_t>{std::size_t{0}};
+    if (auto listed = listBaseVolumes(); listed.isErr()) return Err{std::move(listed).unwrapErr()};
+    // what each cache volume would be a copy of; logical names win over the digest aliases
+    std::unordered_map<std::string, BaseImage> expected;
+    for (auto& base : registry.list()) {
+        const bool logical = base.name == logicalName(base.volumeName);
+        auto [it, inserted] = expected.try_emplace(cacheVolumeName(base), base);
+        if (!inserted && logical) it->second = std::move(base);
+    }
+
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) return Err{"not connected: " + connErr};
+    PoolPtr cachePool(virStoragePoolLookupByName(lease->get(), cachePoolName.c_str()));
+    if (!cachePool) return Err{"cache pool '" + cachePoolName + "' not found: " + lastError()};
+    virStoragePoolRefresh(cachePool.get(), 0);
+
+    // backing file -> clones, from the overlays in the clone pool
+    std::unordered_map<std::string, std::vector<std::string>> clonesOf;
+    if (PoolPtr clonePool(virStoragePoolLookupByName(lease->get(), clonePoolName.c_str())); clonePool) {
+        virStorageVolPtr* vols = nullptr;
+        const int n = virStoragePoolListAllVolumes(clonePool.get(), &vols, 0);
+        for (int i = 0; i < n; ++i) {
+            VolPtr vol(vols[i]);
+            const std::string xml = takeString(virStorageVolGetXMLDesc(vol.get(), 0));
+            pugi::xml_document doc;
+            if (!doc.load_buffer(xml.data(), xml.size())) continue;
+            const char* backing = doc.child("volume").child("backingStore").child_value("path");
+            const char* name = virStorageVolGetName(vol.get());
+            if (*backing && name) clonesOf[backing].emplace_back(name);
+        }
+        free(vols);
+    }
+
+    virStorageVolPtr* vols = nullptr;
+    const int n = virStoragePoolListAllVolumes(cachePool.get(), &vols, 0);
+    if (n < 0) return Err{"cannot list cache volumes: " + lastError()};
+    std::size_t restored = 0;
+    for (int i = 0; i < n; ++i) {
+        VolPtr vol(vols[i]);
+        const char* volName = virStorageVolGetName(vol.get());
+        if (!volName) continue;
+        CachedImage image;
+        image.volumeName = volName;
+        image.path = takeString(virStorageVolGetPath(vol.get()));
+        virStorageVolInfo info{};
+        if (virStorageVolGetInfo(vol.get(), &info) == 0) image.bytes = info.allocation;
+        const auto clones = clonesOf.find(image.path);
+        if (auto it = expected.find(image.volumeName); it != expected.end()) {
+            image.name = it->second.name;
+            image.sourcePath = it->second.path;
+        } else if (clones == clonesOf.end()) {
+            // a copy of a source that is gone, and nothing backs onto it
+            if (virStorageVolDelete(vol.get(), 0) == 0) BoostLogger::Info("Base cache: dropped stale " + image.volumeName);
+            continue;
+        }
+        cache->restore(std::move(image), clones == clonesOf.end() ? std::vector<std::string>{} : clones->second);
+        ++restored;
+    }
+    free(vols);
+    if (restored) BoostLogger::Info("Base cache: restored " + std::to_string(restored) + " copies from " + cachePoolName);
+    return Result<std::size_t>{restored};
+}
+
+Result<CachedImage> StorageOrchestrator::pullToCache(const BaseImage& base) {
+    // a copy of an older source with no clones left is removed first; a pinned one is retired by completed()
+    if (auto stale = cache->forget(base.name)) deleteCachedVolume(stale->volumeName);
+
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) return Err{"not connected: " + connErr};
+    PoolPtr basePool(virStoragePoolLookupByName(lease->get(), basePoolName.c_str()));
+    if (!basePool) return Err{"base pool '" + basePoolName + "' not found: " + lastError()};
+    VolPtr source(virStorageVolLookupByName(basePool.get(), base.volumeName.c_str()));
+    if (!source) return Err{"base volume not found: " + base.volumeName};
+    virStorageVolInfo info{};
+    if (virStorageVolGetInfo(source.get(), &info) != 0) return Err{"cannot read " + base.volumeName + ": " + lastError()};
+
+    auto room = cache->evictFor(info.allocation);
+    for (const auto& victim : room.victims) deleteCachedVolume(victim.volumeName);
+    if (!room.fits) return Err{"base cache full: " + base.name + " needs " + std::to_string(info.allocation >> 20) + " MiB"};
+
+    std::string xml;
+    try {
+        xml = VolumeDefinitionBuilder()
+                  .setName(cacheVolumeName(base))
+                  .setFormat(base.format)
+                  .setCapacity(info.capacity)
+                  .build();
+    } catch (const StorageException& e) {
+        return Err{std::string(e.what())};
+    }
+    PoolPtr cachePool(virStoragePoolLookupByName(lease->get(), cachePoolName.c_str()));
+    if (!cachePool) return Err{"cache pool '" + cachePoolName + "' not found: " + lastError()};
+    // libvirt copies the data host-side (sparse-aware for file pools); nothing passes through this process
+    VolPtr copy(virStorageVolCreateXMLFrom(cachePool.get(), xml.c_str(), source.get(), 0));
+    if (!copy) return Err{"virStorageVolCreateXMLFrom failed: " + lastError()};
+
+    CachedImage image;
+    image.name = base.name;
+    image.sourcePath = base.path;
+    image.volumeName = virStorageVolGetName(copy.get());
+    image.path = takeString(virStorageVolGetPath(copy.get()));
+    virStorageVolInfo local{};
+    image.bytes = virStorageVolGetInfo(copy.get(), &local) == 0 ? local.allocation : info.allocation;
+    return Result<CachedImage>{std::move(image)};
+}
+
+void StorageOrchestrator::deleteCachedVolume(const std::string& volumeName) {
+    std::string connErr;
+    auto lease = tryLease(*connector, connErr);
+    if (!lease) return;
+    PoolPtr pool(virStoragePoolLookupByName(lease->get(), cachePoolName.c_str()));
+    if (!pool) return;
+    VolPtr vol(virStorageVolLookupByName(pool.get(), volumeName.c_str()));
+    if (!vol) return;
+    if (virStorageVolDelete(vol.get(), 0) < 0) {
+        BoostLogger::Warn("Base cache: cannot delete " + volumeName + ": " + lastError());
+        return;
+    }
+    BoostLogger::Info("Base cache: evicted " + volumeName);
+}
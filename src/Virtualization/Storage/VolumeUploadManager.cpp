@@ -0,0 +1,300 @@
+#include "Virtualization/Storage/VolumeUploadManager.hpp"
+#include "Virtualization/Storage/ImageObjectStore.hpp"
+#include "Virtualization/Storage/VirtualMachineStorageManager.hpp"
+#include "Virtualization/builder/VolumeDefinitionBuilder.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Utils/Logger.hpp"
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <libvirt/libvirt.h>
+#include <libvirt/virterror.h>
+#include <optional>
+
+namespace {
+
+struct PoolDeleter { void operator()(virStoragePoolPtr p) const noexcept { if (p) virStoragePoolFree(p); } };
+struct VolDeleter { void operator()(virStorageVolPtr v) const noexcept { if (v) virStorageVolFree(v); } };
+struct StreamDeleter { void operator()(virStreamPtr s) const noexcept { if (s) virStreamFree(s); } };
+using PoolPtr = std::unique_ptr<std::remove_pointer_t<virStoragePoolPtr>, PoolDeleter>;
+using VolPtr = std::unique_ptr<std::remove_pointer_t<virStorageVolPtr>, VolDeleter>;
+using StreamPtr = std::unique_ptr<std::remove_pointer_t<virStreamPtr>, StreamDeleter>;
+
+std::string lastError() {
+    virErrorPtr e = virGetLastError();
+    return e && e->message ? e->message : "unknown";
+}
+
+std::string newUploadId() {
+    thread_local boost::uuids::random_generator gen;
+    return boost::uuids::to_string(gen());
+}
+
+bool endsWith(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+}
+
+// the file name becomes a volume name inside the pool directory: no paths, no hidden files
+bool isSafeVolumeName(std::string_view name) {
+    if (name.empty() || name.size() > 255 || name.front() == '.') return false;
+    for (char c : name) {
+        if (c == '/' || c == '\\' || static_cast<unsigned char>(c) < 0x20) return false;
+    }
+    return true;
+}
+
+std::string formatFor(std::string_view fileName) {
+    return endsWith(fileName, ".qcow2") ? "qcow2" : "raw";
+}
+
+} // namespace
+
+VolumeUploadManager::VolumeUploadManager(std::shared_ptr<HypervisorConnector> connector,
+                                         std::string poolName,
+                                         std::chrono::minutes idleTimeout)
+    : connector(std::move(connector)), poolName(std::move(poolName)), idleTimeout(idleTimeout) {}
+
+void VolumeUploadManager::attachObjectStore(std::shared_ptr<ImageObjectStore> store,
+                                            std::shared_ptr<StorageOrchestrator> orchestrator) {
+    objects = std::move(store);
+    storage = std::move(orchestrator);
+}
+
+std::shared_ptr<VolumeUploadManager::Session> VolumeUploadManager::find(std::string_view id) const {
+    std::shared_lock lock(mutex_);
+    auto it = sessions.find(std::string(id));
+    return it == sessions.end() ? nullptr : it->second;
+}
+
+Result<UploadProgress> VolumeUploadManager::begin(std::string_view fileName, std::uint64_t size) {
+    if (!isSafeVolumeName(fileName)) return Result<UploadProgress>{std::string("invalid file name")};
+    if (size == 0) return Result<UploadProgress>{std::string("empty upload")};
+
+    UploadProgress progress;
+    progress.id = newUploadId();
+    progress.fileName = std::string(fileName);
+    progress.volumeName = progress.fileName;
+    progress.format = formatFor(fileName);
+    progress.size = size;
+
+    {
+        std::shared_lock lock(mutex_);
+        for (const auto& [id, s] : sessions) {
+            // two uploads into the same volume would interleave their bytes
+            if (s->progress.volumeName == progress.volumeName) {
+                return Result<UploadProgress>{"upload already in progress for " + progress.volumeName + " (" + id + ")"};
+            }
+        }
+    }
+
+    try {
+        auto lease = connector->acquire();
+        PoolPtr pool(virStoragePoolLookupByName(lease.get(), poolName.c_str()));
+        if (!pool) return Result<UploadProgress>{"pool '" + poolName + "' not found: " + lastError()};
+        if (VolPtr existing(virStorageVolLookupByName(pool.get(), progress.volumeName.c_str())); existing) {
+            return Result<UploadProgress>{"volume already exists: " + progress.volumeName};
+        }
+
+        VolumeDefinitionBuilder builder;
+        builder.setName(progress.volumeName).setFormat(progress.format).setCapacity(size);
+        const std::string xml = builder.build();
+        VolPtr vol(virStorageVolCreateXML(pool.get(), xml.c_str(), 0));
+        if (!vol) return Result<UploadProgress>{"virStorageVolCreateXML failed: " + lastError()};
+    } catch (const std::exception& e) {
+        return Result<UploadProgress>{std::string("cannot create upload volume: ") + e.what()};
+    }
+
+    auto session = std::make_shared<Session>();
+    session->progress = progress;
+    session->lastActivity = std::chrono::steady_clock::now();
+    {
+        std::unique_lock lock(mutex_);
+        sessions.emplace(progress.id, std::move(session));
+    }
+    BoostLogger::Info("Upload started: " + progress.volumeName + " (" + std::to_string(size) + " bytes)");
+    return Result<UploadProgress>{std::move(progress)};
+}
+
+Result<UploadProgress> VolumeUploadManager::writeChunk(std::string_view id, std::uint64_t offset, std::string_view data) {
+    auto session = find(id);
+    if (!session) return Result<UploadProgress>{std::string("unknown upload")};
+    if (data.size() > kMaxChunkBytes) return Result<UploadProgress>{std::string("chunk too large")};
+
+    std::lock_guard lock(session->mutex_);
+    auto& p = session->progress;
+    session->lastActivity = std::chrono::steady_clock::now();
+
+    // retry of a chunk we already stored (lost response): acknowledge without rewriting
+    if (offset + data.size() <= p.received) {
+        UploadProgress copy = p;
+        return Result<UploadProgress>{std::move(copy)};
+    }
+    if (offset != p.received) {
+        return Result<UploadProgress>{"offset mismatch: expected " + std::to_string(p.received)};
+    }
+    if (offset + data.size() > p.size) return Result<UploadProgress>{std::string("chunk exceeds declared size")};
+
+    if (!data.empty()) {
+        if (auto err = streamChunk(p.volumeName, offset, data); !err.empty()) return Result<UploadProgress>{std::move(err)};
+        session->hasher.update(data);
+        p.received += data.size();
+    }
+    if (p.received == p.size && !p.complete) {
+        p.complete = true;
+        BoostLogger::Info("Upload complete: " + p.volumeName);
+        commitContent(p, session->hasher);
+    }
+    UploadProgress copy = p;
+    return Result<UploadProgress>{std::move(copy)};
+}
+
+std::string VolumeUploadManager::streamChunk(const std::string& volumeName, std::uint64_t offset, std::string_view data) {
+    // throughput = rate(penhive_upload_bytes_total); a chunk's latency covers lookup, stream and finish
+    static auto& bytes = METRICS::MetricsRegistry::global().counter("penhive_upload_bytes_total", "Bytes streamed into volumes");
+    static auto& chunk = METRICS::MetricsRegistry::global().histogram("penhive_upload_chunk_seconds", "Time to stream one upload chunk");
+    METRICS::ScopedTimer timer(chunk);
+    try {
+        auto lease = connector->acquire();
+        PoolPtr pool(virStoragePoolLookupByName(lease.get(), poolName.c_str()));
+        if (!pool) return "pool '" + poolName + "' not found: " + lastError();
+        VolPtr vol(virStorageVolLookupByName(pool.get(), volumeName.c_str()));
+        if (!vol) return "volume vanished: " + volumeName;
+
+        StreamPtr stream(virStreamNew(lease.get(), 0));
+        if (!stream) return "virStreamNew failed: " + lastError();
+        if (virStorageVolUpload(vol.get(), stream.get(), offset, data.size(), 0) < 0) {
+            return "virStorageVolUpload failed: " + lastError();
+        }
+        // the request body is sent as is: no copy into an intermediate buffer
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            const int n = virStreamSend(stream.get(), data.data() + sent, data.size() - sent);
+            if (n < 0) {
+                virStreamAbort(stream.get());
+                return "virStreamSend failed: " + lastError();
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+        if (virStreamFinish(stream.get()) < 0) return "virStreamFinish failed: " + lastError();
+        bytes.inc(data.size());
+        return {};
+    } catch (const std::exception& e) {
+        return e.what();
+    }
+}
+
+// runs under the session lock, once: the upload stays complete even if the index cannot be updated
+void VolumeUploadManager::commitContent(UploadProgress& p, ContentHasher& hasher) {
+    p.digest = hasher.finish();
+    if (p.digest.empty() || !objects) return;
+
+    ImageObject candidate;
+    candidate.digest = p.digest;
+    candidate.volumeName = p.volumeName;
+    candidate.format = p.format;
+    candidate.sizeBytes = p.size;
+    std::string name = p.fileName;
+    for (std::string_view ext : { ".qcow2", ".img", ".raw", ".iso" }) {
+        if (endsWith(name, ext) && name.size() > ext.size()) {
+            name.resize(name.size() - ext.size());
+            break;
+        }
+    }
+    auto committed = objects->commit(candidate, name);
+    if (committed.isErr()) {
+        BoostLogger::Warn("Upload " + p.volumeName + " not deduplicated: " + committed.unwrapErr());
+        return;
+    }
+    const auto& res = committed.unwrap();
+    if (res.duplicate) {
+        if (auto err = deleteVolume(p.volumeName); !err.empty()) {
+            BoostLogger::Warn("Cannot drop duplicate upload " + p.volumeName + ": " + err);
+        } else {
+            BoostLogger::Info("Upload " + p.volumeName + " is a duplicate of " + res.object.volumeName + " (" + p.digest + ")");
+        }
+        p.volumeName = res.object.volumeName;
+        p.deduplicated = true;
+    }
+    if (res.orphaned) {
+        // the name was re-uploaded with new content and nothing else used the old one
+        if (storage) storage->releaseObject(*res.orphaned);
+        else if (auto err = deleteVolume(res.orphaned->volumeName); !err.empty()) {
+            BoostLogger::Warn("Cannot delete replaced base " + res.orphaned->volumeName + ": " + err);
+        }
+    }
+    if (storage) {
+        if (auto adopted = storage->adoptObject(name, res.object); adopted.isErr()) {
+            BoostLogger::Warn("Base image " + name + " not registered: " + adopted.unwrapErr());
+        }
+    }
+}
+
+Result<UploadProgress> VolumeUploadManager::status(std::string_view id) const {
+    auto session = find(id);
+    if (!session) return Result<UploadProgress>{std::string("unknown upload")};
+    std::lock_guard lock(session->mutex_);
+    UploadProgress copy = session->progress;
+    return Result<UploadProgress>{std::move(copy)};
+}
+
+std::vector<UploadProgress> VolumeUploadManager::list() const {
+    std::vector<std::shared_ptr<Session>> snapshot;
+    {
+        std::shared_lock lock(mutex_);
+        snapshot.reserve(sessions.size());
+        for (const auto& [id, s] : sessions) snapshot.push_back(s);
+    }
+    std::vector<UploadProgress> out;
+    out.reserve(snapshot.size());
+    for (const auto& s : snapshot) {
+        std::lock_guard lock(s->mutex_);
+        out.push_back(s->progress);
+    }
+    return out;
+}
+
+Result<void> VolumeUploadManager::abort(std::string_view id) {
+    std::shared_ptr<Session> session;
+    {
+        std::unique_lock lock(mutex_);
+        auto it = sessions.find(std::string(id));
+        if (it == sessions.end()) return Result<void>{std::string("unknown upload")};
+        session = std::move(it->second);
+        sessions.erase(it);
+    }
+    std::lock_guard lock(session->mutex_);
+    if (session->progress.complete) return Result<void>{};
+    if (auto err = deleteVolume(session->progress.volumeName); !err.empty()) return Result<void>{std::move(err)};
+    BoostLogger::Info("Upload aborted: " + session->progress.volumeName);
+    return Result<void>{};
+}
+
+std::string VolumeUploadManager::deleteVolume(const std::string& volumeName) {
+    try {
+        auto lease = connector->acquire();
+        PoolPtr pool(virStoragePoolLookupByName(lease.get(), poolName.c_str()));
+        if (!pool) return "pool '" + poolName + "' not found: " + lastError();
+        VolPtr vol(virStorageVolLookupByName(pool.get(), volumeName.c_str()));
+        if (!vol) return {};
+        if (virStorageVolDelete(vol.get(), 0) < 0) return "virStorageVolDelete failed: " + lastError();
+        return {};
+    } catch (const std::exception& e) {
+        return e.what();
+    }
+}
+
+std::size_t VolumeUploadManager::purgeIdle() {
+    const auto cutoff = std::chrono::steady_clock::now() - idleTimeout;
+    std::vector<std::string> stale;
+    {
+        std::shared_lock lock(mutex_);
+        for (const auto& [id, s] : sessions) {
+            std::lock_guard sl(s->mutex_);
+            // finished uploads only lose their session here; abort() keeps complete volumes
+            if (s->lastActivity < cutoff) stale.push_back(id);
+        }
+    }
+    for (const auto& id : stale) (void)abort(id);
+    return stale.size();
+}
@@ -1,5 +1,6 @@
 #include "Virtualization/builder/VirtualMachineBuilder.hpp"
 #include <pugixml.hpp>
+#include <algorithm>
 
 void VirtualMachineBuilder::buildDocument() {
   auto root = doc.append_child("domain");
@@ -19,6 +20,7 @@ void VirtualMachineBuilder::buildDocument() {
   buildMemorySection();
   buildCpuSection();
   buildDevicesSection();
+  bildGraphicsSection();
 }
 
 void VirtualMachineBuilder::buildOsSection() {
@@ -36,8 +38,42 @@ void VirtualMachineBuilder::buildMemorySection() {
 }
 
 void VirtualMachineBuilder::buildCpuSection() {
-  auto vcpu = doc.child("domain").append_child("vcpu");
+  auto domain = doc.child("domain");
+  auto vcpu = domain.append_child("vcpu");
+  vcpu.append_attribute("placement") = "static";
   vcpu.text() = vcpuCount;
+  const bool iothread = ioProfile && ioProfile->dedicatedIothreads && !diskPath.empty();
+  if (iothread) domain.append_child("iothreads").text() = 1;
+
+  if (!placement.vcpuPins.empty() || !placement.emulatorPin.empty() || !placement.iothreadPins.empty()) {
+    auto cputune = domain.append_child("cputune");
+    for (std::size_t i = 0; i < placement.vcpuPins.size(); ++i) {
+      auto pin = cputune.append_child("vcpupin");
+      pin.append_attribute("vcpu") = static_cast<unsigned int>(i);
+      pin.append_attribute("cpuset") = placement.vcpuPins[i].c_str();
+    }
+    if (!placement.emulatorPin.empty()) {
+      cputune.append_child("emulatorpin").append_attribute("cpuset") = placement.emulatorPin.c_str();
+    }
+    // the disk's iothread sits with the emulator threads, away from the vCPUs
+    const std::string& iothreadCpus = placement.iothreadPins.empty() ? placement.emulatorPin : placement.iothreadPins.front();
+    if (iothread && !iothreadCpus.empty()) {
+      auto pin = cputune.append_child("iothreadpin");
+      pin.append_attribute("iothread") = 1;
+      pin.append_attribute("cpuset") = iothreadCpus.c_str();
+    }
+  }
+  if (!placement.memoryNodes.empty()) {
+    auto memory = domain.append_child("numatune").append_child("memory");
+    memory.append_attribute("mode") = placement.numaMode.c_str();
+    memory.append_attribute("nodeset") = placement.memoryNodes.c_str();
+  }
+  if (placement.hugepageSizeKiB > 0) {
+    auto page = domain.append_child("memoryBacking").append_child("hugepages").append_child("page");
+    page.append_attribute("size") = placement.hugepageSizeKiB;
+    page.append_attribute("unit") = "KiB";
+    if (!placement.memoryNodes.empty()) page.append_attribute("nodeset") = placement.memoryNodes.c_str();
+  }
 }
 
 void VirtualMachineBuilder::buildDevicesSection() {
@@ -52,6 +88,13 @@ void VirtualMachineBuilder::buildDevicesSection() {
     auto driver = disk.append_child("driver");
     driver.append_attribute("name") = "qemu";
     driver.append_attribute("type") = "qcow2";
+    if (ioProfile) {
+      driver.append_attribute("cache") = std::string(ioProfile->cache).c_str();
+      driver.append_attribute("io") = std::string(ioProfile->io).c_str();
+      driver.append_attribute("discard") = std::string(ioProfile->discard).c_str();
+      if (ioProfile->multiqueue) driver.append_attribute("queues") = std::max(vcpuCount, 1u);
+      if (ioProfile->dedicatedIothreads) driver.append_attribute("iothread") = 1;
+    }
 
     auto source = disk.append_child("source");
     source.append_attribute("file") = diskPath.c_str();
@@ -68,8 +111,8 @@ void VirtualMachineBuilder::bildGraphicsSection() {
   auto graphics = devices.append_child("graphics");
 
   graphics.append_attribute("type") = "spice";
-  graphics.append_attribute("port") = "-1";
-  graphics.append_attribute("autoport") = "yes";
+  graphics.append_attribute("port") = consolePort;
+  graphics.append_attribute("autoport") = consolePort > 0 ? "no" : "yes";
   graphics.append_attribute("listen") = vncListenAddress.c_str();
 
   auto listen = graphics.append_child("listen");
@@ -105,4 +148,24 @@ VirtualMachineBuilder& VirtualMachineBuilder::setOsType(std::string_view osType)
 VirtualMachineBuilder& VirtualMachineBuilder::setArchitecture(std::string_view arch) {
   this->architecture = arch;
   return *this;
-}
\ No newline at end of file
+}
+
+VirtualMachineBuilder& VirtualMachineBuilder::setPlacement(CpuPlacement placement) {
+  this->placement = std::move(placement);
+  return *this;
+}
+VirtualMachineBuilder& VirtualMachineBuilder::setConsolePort(int port) {
+  this->consolePort = port;
+  return *this;
+}
+
+Result<void> VirtualMachineBuilder::setIoProfile(std::string_view profile) {
+  if (profile.empty()) {
+    ioProfile = nullptr;
+    return Result<void>{};
+  }
+  const IoProfile* found = VmConfig::findIoProfile(profile);
+  if (!found) return Result<void>{"Unknown I/O profile: " + std::string(profile)};
+  ioProfile = found;
+  return Result<void>{};
+}
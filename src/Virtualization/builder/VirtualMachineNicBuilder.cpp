@@ -17,11 +17,19 @@ void VirtualMachineNicBuilder::buildDocument() {
         source.append_attribute("bridge") = sourceDevice.c_str();
     } else if (deviceType == "direct") {
         source.append_attribute("dev") = sourceDevice.c_str();
-        source.append_attribute("mode") = "passthrough";
+        source.append_attribute("mode") = directMode.c_str();
     }
     
     auto modelNode = interface.append_child("model");
     modelNode.append_attribute("type") = model.c_str();
+
+    if (!driverName.empty() || queues > 1 || rxQueueSize || txQueueSize) {
+        auto driver = interface.append_child("driver");
+        if (!driverName.empty()) driver.append_attribute("name") = driverName.c_str();
+        if (queues > 1) driver.append_attribute("queues") = queues;
+        if (rxQueueSize) driver.append_attribute("rx_queue_size") = rxQueueSize;
+        if (txQueueSize) driver.append_attribute("tx_queue_size") = txQueueSize;
+    }
 }
 
 // Fluent interface implementations
@@ -48,4 +56,36 @@ VirtualMachineNicBuilder& VirtualMachineNicBuilder::setDeviceType(std::string_vi
 VirtualMachineNicBuilder& VirtualMachineNicBuilder::setSourceDevice(std::string_view device) {
     this->sourceDevice = device;
     return *this;
+}
+
+VirtualMachineNicBuilder& VirtualMachineNicBuilder::setDirectMode(std::string_view mode) {
+    this->directMode = mode;
+    return *this;
+}
+
+VirtualMachineNicBuilder& VirtualMachineNicBuilder::setDriver(std::string_view name, unsigned int queues) {
+    this->driverName = name;
+    this->queues = queues;
+    return *this;
+}
+
+VirtualMachineNicBuilder& VirtualMachineNicBuilder::setRingSizes(unsigned int rx, unsigned int tx) {
+    this->rxQueueSize = rx;
+    this->txQueueSize = tx;
+    return *this;
+}
+
+Result<void> VirtualMachineNicBuilder::setNetProfile(std::string_view profile, unsigned int vcpus) {
+    if (profile.empty()) {
+        setDriver("").setRingSizes(0);
+        return Result<void>{};
+    }
+    const NetProfile* found = VmConfig::findNetProfile(profile);
+    if (!found) return Result<void>{"Unknown network profile: " + std::string(profile)};
+    // same rules as a NIC in a deployed VmConfig
+    NetworkConfig nic;
+    nic.model = model;
+    VmConfig::applyNetProfile(nic, *found, vcpus);
+    setDriver(nic.driverName, nic.queues).setRingSizes(nic.rxQueueSize, nic.txQueueSize);
+    return Result<void>{};
 }
\ No newline at end of file
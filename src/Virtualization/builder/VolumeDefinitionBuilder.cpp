@@ -0,0 +1,95 @@
+#include "Virtualization/builder/VolumeDefinitionBuilder.hpp"
+#include "Virtualization/Utils/VmException.hpp"
+#include <libxml/xmlwriter.h>
+
+namespace {
+const xmlChar* X(const char* s) {
+    return reinterpret_cast<const xmlChar*>(s);
+}
+} // namespace
+
+VolumeDefinitionBuilder::VolumeDefinitionBuilder() = default;
+
+VolumeDefinitionBuilder::~VolumeDefinitionBuilder() {
+    finalize();
+}
+
+void VolumeDefinitionBuilder::finalize() {
+    if (writer) {
+        xmlFreeTextWriter(writer);
+        writer = nullptr;
+    }
+    if (xmlBuf) {
+        xmlBufferFree(xmlBuf);
+        xmlBuf = nullptr;
+    }
+}
+
+VolumeDefinitionBuilder& VolumeDefinitionBuilder::setName(std::string_view name) {
+    this->name = name;
+    return *this;
+}
+
+VolumeDefinitionBuilder& VolumeDefinitionBuilder::setFormat(std::string_view format) {
+    this->format = format;
+    return *this;
+}
+
+VolumeDefinitionBuilder& VolumeDefinitionBuilder::setCapacity(unsigned long long bytes) {
+    this->capacityBytes = bytes;
+    return *this;
+}
+
+VolumeDefinitionBuilder& VolumeDefinitionBuilder::setBackingStore(std::string_view backingPath) {
+    this->backingPath = backingPath;
+    return *this;
+}
+
+VolumeDefinitionBuilder& VolumeDefinitionBuilder::setBackingFormat(std::string_view format) {
+    this->backingFormat = format;
+    return *this;
+}
+
+std::string VolumeDefinitionBuilder::build() {
+    if (name.empty()) throw StorageException("volume name is required");
+    finalize();
+    xmlBuf = xmlBufferCreate();
+    writer = xmlBuf ? xmlNewTextWriterMemory(xmlBuf, 0) : nullptr;
+    if (!writer) {
+        finalize();
+        throw StorageException("cannot create XML writer");
+    }
+
+    const std::string capacity = std::to_string(capacityBytes);
+    bool ok = xmlTextWriterStartElement(writer, X("volume")) >= 0
+        && xmlTextWriterWriteElement(writer, X("name"), X(name.c_str())) >= 0
+        && xmlTextWriterStartElement(writer, X("capacity")) >= 0
+        && xmlTextWriterWriteAttribute(writer, X("unit"), X("bytes")) >= 0
+        && xmlTextWriterWriteString(writer, X(capacity.c_str())) >= 0
+        && xmlTextWriterEndElement(writer) >= 0
+        // overlays start empty: allocation 0 keeps the pool from preallocating
+        && xmlTextWriterWriteElement(writer, X("allocation"), X("0")) >= 0
+        && xmlTextWriterStartElement(writer, X("target")) >= 0
+        && xmlTextWriterStartElement(writer, X("format")) >= 0
+        && xmlTextWriterWriteAttribute(writer, X("type"), X(format.c_str())) >= 0
+        && xmlTextWriterEndElement(writer) >= 0
+        && xmlTextWriterEndElement(writer) >= 0;
+
+    if (ok && !backingPath.empty()) {
+        ok = xmlTextWriterStartElement(writer, X("backingStore")) >= 0
+            && xmlTextWriterWriteElement(writer, X("path"), X(backingPath.c_str())) >= 0
+            && xmlTextWriterStartElement(writer, X("format")) >= 0
+            && xmlTextWriterWriteAttribute(writer, X("type"), X(backingFormat.c_str())) >= 0
+            && xmlTextWriterEndElement(writer) >= 0
+            && xmlTextWriterEndElement(writer) >= 0;
+    }
+    ok = ok && xmlTextWriterEndElement(writer) >= 0 && xmlTextWriterFlush(writer) >= 0;
+    if (!ok) {
+        finalize();
+        throw StorageException("failed to write volume XML for " + name);
+    }
+
+    buffer.assign(reinterpret_cast<const char*>(xmlBufferContent(xmlBuf)), static_cast<std::size_t>(xmlBufferLength(xmlBuf)));
+    finalize();
+    return buffer;
+}
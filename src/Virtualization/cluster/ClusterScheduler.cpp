@@ -0,0 +1,160 @@
+#include "Virtualization/cluster/ClusterScheduler.hpp"
+#include "resources/allocation/LabSliceManager.hpp"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+
+namespace {
+
+constexpr std::uint64_t kUnknownDisk = std::numeric_limits<std::uint64_t>::max();
+
+} // namespace
+
+Result<HostCapacity> HostCapacity::read(virConnectPtr conn, const std::string& storagePool) {
+    if (!conn) return Result<HostCapacity>{std::string("No connection")};
+    HostCapacity cap;
+    virNodeInfo info{};
+    if (virNodeGetInfo(conn, &info) < 0) {
+        virErrorPtr err = virGetLastError();
+        return Result<HostCapacity>{std::string("virNodeGetInfo failed: ") + (err && err->message ? err->message : "unknown")};
+    }
+    cap.totalMemoryKiB = info.memory;
+    cap.cpus = info.cpus;
+    cap.freeMemoryKiB = virNodeGetFreeMemory(conn) / 1024;
+
+    virDomainStatsRecordPtr* records = nullptr;
+    const int n = virConnectGetAllDomainStats(conn, VIR_DOMAIN_STATS_VCPU | VIR_DOMAIN_STATS_BALLOON, &records,
+                                              VIR_CONNECT_GET_ALL_DOMAINS_STATS_ACTIVE);
+    for (int i = 0; i < n; ++i) {
+        unsigned int vcpus = 0;
+        unsigned long long maxKiB = 0;
+        if (virTypedParamsGetUInt(records[i]->params, records[i]->nparams, "vcpu.current", &vcpus) == 1) cap.committedVcpus += vcpus;
+        if (virTypedParamsGetULLong(records[i]->params, records[i]->nparams, "balloon.maximum", &maxKiB) == 1) cap.committedMemoryKiB += maxKiB;
+    }
+    if (records) virDomainStatsRecordListFree(records);
+
+    // a host without that pool keeps its images elsewhere: disk is then not a constraint
+    cap.freeDiskKiB = kUnknownDisk;
+    if (virStoragePoolPtr pool = virStoragePoolLookupByName(conn, storagePool.c_str())) {
+        virStoragePoolInfo poolInfo{};
+        if (virStoragePoolGetInfo(pool, &poolInfo) == 0) cap.freeDiskKiB = poolInfo.available / 1024;
+        virStoragePoolFree(pool);
+    }
+    return Result<HostCapacity>{cap};
+}
+
+ClusterScheduler::ClusterScheduler(ScheduleOptions options)
+    : opts(options) {}
+
+ClusterScheduler::Demand ClusterScheduler::demandOf(const VmConfig& cfg) noexcept {
+    Demand d;
+    d.memoryKiB = cfg.memory;
+    d.vcpus = std::max(cfg.vcpus, 1u);
+    for (const auto& disk : cfg.disks) d.diskKiB += disk.size;
+    return d;
+}
+
+bool ClusterScheduler::fits(const HostCapacity& host, const Demand& d) const noexcept {
+    const double memBudget = static_cast<double>(host.totalMemoryKiB) * opts.memoryOvercommit - static_cast<double>(opts.memoryReserveKiB);
+    if (static_cast<double>(host.committedMemoryKiB + d.memoryKiB) > memBudget) return false;
+    if (host.committedVcpus + d.vcpus > static_cast<std::uint64_t>(host.cpus) * opts.vcpuOvercommit) return false;
+    if (host.freeDiskKiB != kUnknownDisk && d.diskKiB + opts.diskReserveKiB > host.freeDiskKiB) return false;
+    return true;
+}
+
+double ClusterScheduler::loadAfter(const HostCapacity& host, const Demand& d) const noexcept {
+    const double memBudget = std::max(1.0, static_cast<double>(host.totalMemoryKiB) * opts.memoryOvercommit - static_cast<double>(opts.memoryReserveKiB));
+    const double cpuBudget = std::max(1.0, static_cast<double>(host.cpus) * opts.vcpuOvercommit);
+    return std::max(static_cast<double>(host.committedMemoryKiB + d.memoryKiB) / memBudget,
+                    static_cast<double>(host.committedVcpus + d.vcpus) / cpuBudget);
+}
+
+void ClusterScheduler::take(HostCapacity& host, const Demand& d) noexcept {
+    host.committedMemoryKiB += d.memoryKiB;
+    host.committedVcpus += d.vcpus;
+    host.freeMemoryKiB -= std::min(host.freeMemoryKiB, d.memoryKiB);
+    if (host.freeDiskKiB != kUnknownDisk) host.freeDiskKiB -= std::min(host.freeDiskKiB, d.diskKiB);
+}
+
+int ClusterScheduler::pick(const std::vector<HostSlot>& hosts, const std::vector<int>& candidates, const Demand& d) const {
+    int best = -1;
+    double bestLoad = 0.0;
+    for (int h : candidates) {
+        const double load = loadAfter(hosts[h].capacity, d);
+        // strict comparison: ties go to the host listed first, so schedules are reproducible
+        const bool better = opts.policy == SchedulePolicy::BinPack ? load > bestLoad : load < bestLoad;
+        if (best < 0 || better) {
+            best = h;
+            bestLoad = load;
+        }
+    }
+    return best;
+}
+
+std::vector<std::string> ClusterScheduler::schedule(const std::vector<VmConfig>& cfgs, std::vector<HostSlot> hosts) const {
+    std::vector<std::string> out(cfgs.size());
+    std::vector<Demand> demands(cfgs.size());
+    for (std::size_t i = 0; i < cfgs.size(); ++i) demands[i] = demandOf(cfgs[i]);
+
+    // lab -> members in input order; "" collects VMs without a lab, each scheduled alone
+    std::map<std::string, std::vector<std::size_t>> labs;
+    std::vector<std::vector<std::size_t>> groups;
+    for (std::size_t i = 0; i < cfgs.size(); ++i) {
+        if (auto lab = LabSliceManager::labOf(cfgs[i])) labs[*lab].push_back(i);
+        else groups.push_back({i});
+    }
+    for (auto& [_, members] : labs) groups.push_back(std::move(members));
+
+    auto sum = [&](const std::vector<std::size_t>& members) {
+        Demand total;
+        for (std::size_t i : members) {
+            total.memoryKiB += demands[i].memoryKiB;
+            total.vcpus += demands[i].vcpus;
+            total.diskKiB += demands[i].diskKiB;
+        }
+        return total;
+    };
+    std::vector<Demand> totals;
+    totals.reserve(groups.size());
+    for (const auto& g : groups) totals.push_back(sum(g));
+    std::vector<std::size_t> order(groups.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return totals[a].memoryKiB > totals[b].memoryKiB; });
+
+    for (std::size_t g : order) {
+        const auto& members = groups[g];
+        std::vector<int> whole;
+        for (int h = 0; h < static_cast<int>(hosts.size()); ++h) {
+            if (hosts[h].up && fits(hosts[h].capacity, totals[g])) whole.push_back(h);
+        }
+        if (int h = pick(hosts, whole, totals[g]); h >= 0) {
+            take(hosts[h].capacity, totals[g]);
+            for (std::size_t i : members) out[i] = hosts[h].name;
+            continue;
+        }
+
+        // split: biggest VMs first, each towards the host holding most of the lab already
+        std::vector<std::size_t> bySize = members;
+        std::stable_sort(bySize.begin(), bySize.end(), [&](std::size_t a, std::size_t b) { return demands[a].memoryKiB > demands[b].memoryKiB; });
+        std::vector<std::size_t> held(hosts.size(), 0);
+        for (std::size_t i : bySize) {
+            std::vector<int> candidates;
+            std::size_t mostHeld = 0;
+            for (int h = 0; h < static_cast<int>(hosts.size()); ++h) {
+                if (!hosts[h].up || !fits(hosts[h].capacity, demands[i])) continue;
+                if (held[h] > mostHeld) {
+                    mostHeld = held[h];
+                    candidates.clear();
+                }
+                if (held[h] == mostHeld) candidates.push_back(h);
+            }
+            if (int h = pick(hosts, candidates, demands[i]); h >= 0) {
+                take(hosts[h].capacity, demands[i]);
+                ++held[h];
+                out[i] = hosts[h].name;
+            }
+        }
+    }
+    return out;
+}
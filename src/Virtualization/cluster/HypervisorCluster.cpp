@@ -0,0 +1,360 @@
+#include "Virtualization/cluster/HypervisorCluster.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <mutex>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view kDomainPrefix = "cluster/domain/";
+
+rocksdb::Slice toSlice(std::string_view sv) {
+    return rocksdb::Slice(sv.data(), sv.size());
+}
+
+} // namespace
+
+HypervisorCluster::HypervisorCluster(std::shared_ptr<IRocksDB> db, ScheduleOptions options, std::string storagePool)
+    : db(std::move(db)), scheduler(options), storagePool(std::move(storagePool)),
+      segments(std::make_shared<SegmentAllocator>(this->db))
+{
+    if (!this->db) return;
+    segments->load();
+    std::string upper(kDomainPrefix);
+    upper.back() = static_cast<char>(upper.back() + 1);
+    rocksdb::Slice upperSlice(upper);
+    rocksdb::ReadOptions ro;
+    ro.iterate_upper_bound = &upperSlice;
+    ro.fill_cache = false;
+    auto it = this->db->NewIterator(ro);
+    if (!it) return;
+    for (it->Seek(toSlice(kDomainPrefix)); it->Valid(); it->Next()) {
+        const std::string_view k(it->key().data(), it->key().size());
+        if (k.size() <= kDomainPrefix.size()) continue;
+        const std::string_view v(it->value().data(), it->value().size());
+        const auto tab = v.find('\t');
+        Placed where{std::string(v.substr(0, tab)), tab == std::string_view::npos ? std::string{} : std::string(v.substr(tab + 1))};
+        placed.emplace(std::string(k.substr(kDomainPrefix.size())), std::move(where));
+    }
+}
+
+HypervisorCluster::~HypervisorCluster() = default;
+
+std::string HypervisorCluster::key(std::string_view domain) {
+    std::string k(kDomainPrefix);
+    k += domain;
+    return k;
+}
+
+void HypervisorCluster::remember(const std::string& domain, Placed where) {
+    std::string value = where.host;
+    if (!where.lab.empty()) value += '\t' + where.lab;
+    {
+        std::unique_lock lock(mutex_);
+        placed[domain] = std::move(where);
+    }
+    if (!db) return;
+    if (auto res = db->Put(rocksdb::WriteOptions{}, key(domain), value); !res) {
+        BoostLogger::Warn("HypervisorCluster: host of " + domain + " not persisted: " + res.error().ToString());
+    }
+}
+
+void HypervisorCluster::forget(const std::string& domain) {
+    {
+        std::unique_lock lock(mutex_);
+        placed.erase(domain);
+    }
+    if (db) (void)db->Delete(rocksdb::WriteOptions{}, key(domain));
+}
+
+Result<void> HypervisorCluster::addHost(const ClusterHostSpec& spec) {
+    if (spec.name.empty() || spec.uri.empty()) return Result<void>{std::string("Host needs a name and a URI")};
+    {
+        std::shared_lock lock(mutex_);
+        if (nodes.count(spec.name)) return Result<void>{"Host already added: " + spec.name};
+    }
+    auto host = std::make_shared<Host>();
+    host->spec = spec;
+    host->connector = std::make_shared<HypervisorConnector>(spec.db ? spec.db : db, spec.poolSize);
+    try {
+        host->connector->connectOrThrow(spec.uri);
+        if (spec.baseCacheBytes > 0) {
+            host->storage = std::make_shared<StorageOrchestrator>(host->connector);
+            host->storage->attachCache(std::make_shared<BaseImageCache>(spec.baseCacheBytes), spec.baseCachePool);
+            // copies pulled before a restart stay usable, and stay pinned by the clones backed by them
+            if (auto restored = host->storage->loadCache(); restored.isErr()) {
+                BoostLogger::Warn("HypervisorCluster: " + spec.name + " base cache not restored: " + restored.unwrapErr());
+            }
+        }
+        host->manager = std::make_shared<VirtualMachineManager>(host->connector, nullptr, host->storage);
+        if (spec.fabric.mode != FabricOptions::Mode::Isolated) {
+            host->manager->setNetworkFabric(std::make_shared<NetworkFabric>(host->connector, spec.fabric, segments));
+        }
+    } catch (const std::exception& e) {
+        return Result<void>{"Host " + spec.name + " (" + spec.uri + "): " + e.what()};
+    }
+    host->status.name = spec.name;
+    host->status.uri = spec.uri;
+    try {
+        auto lease = host->connector->acquire();
+        auto cap = HostCapacity::read(lease.get(), storagePool);
+        host->status.up = cap.isOk();
+        if (cap.isOk()) host->status.capacity = cap.unwrap();
+        else host->status.error = cap.unwrapErr();
+    } catch (const std::exception& e) {
+        host->status.error = e.what();
+    }
+    host->status.refreshedAt = Clock::now();
+    std::unique_lock lock(mutex_);
+    if (!nodes.try_emplace(spec.name, std::move(host)).second) return Result<void>{"Host already added: " + spec.name};
+    BoostLogger::Info("HypervisorCluster: added host " + spec.name + " (" + spec.uri + ")");
+    return Result<void>{};
+}
+
+void HypervisorCluster::removeHost(const std::string& name) {
+    std::shared_ptr<Host> host;
+    {
+        std::unique_lock lock(mutex_);
+        auto it = nodes.find(name);
+        if (it == nodes.end()) return;
+        host = std::move(it->second);
+        nodes.erase(it);
+    }
+    // the manager (and its worker threads) goes away outside the lock
+    host.reset();
+}
+
+std::vector<std::string> HypervisorCluster::hosts() const {
+    std::shared_lock lock(mutex_);
+    std::vector<std::string> out;
+    out.reserve(nodes.size());
+    for (const auto& [name, _] : nodes) out.push_back(name);
+    return out;
+}
+
+std::shared_ptr<VirtualMachineManager> HypervisorCluster::manager(std::string_view host) const {
+    std::shared_lock lock(mutex_);
+    auto it = nodes.find(std::string(host));
+    return it == nodes.end() ? nullptr : it->second->manager;
+}
+
+std::optional<std::string> HypervisorCluster::hostOf(std::string_view domain) const {
+    std::shared_lock lock(mutex_);
+    auto it = placed.find(std::string(domain));
+    if (it == placed.end()) return std::nullopt;
+    return it->second.host;
+}
+
+std::optional<std::string> HypervisorCluster::labOf(std::string_view domain) const {
+    std::shared_lock lock(mutex_);
+    auto it = placed.find(std::string(domain));
+    if (it == placed.end() || it->second.lab.empty()) return std::nullopt;
+    return it->second.lab;
+}
+
+void HypervisorCluster::rehome(const std::string& domain, const std::string& host) {
+    auto lab = labOf(domain);
+    remember(domain, Placed{host, lab.value_or(std::string{})});
+}
+
+std::shared_ptr<VirtualMachineManager> HypervisorCluster::managerOf(std::string_view domain) const {
+    std::shared_lock lock(mutex_);
+    auto d = placed.find(std::string(domain));
+    if (d == placed.end()) return nullptr;
+    auto it = nodes.find(d->second.host);
+    return it == nodes.end() ? nullptr : it->second->manager;
+}
+
+std::shared_ptr<HypervisorConnector> HypervisorCluster::connector(std::string_view host) const {
+    std::shared_lock lock(mutex_);
+    auto it = nodes.find(std::string(host));
+    return it == nodes.end() ? nullptr : it->second->connector;
+}
+
+std::shared_ptr<StorageOrchestrator> HypervisorCluster::storage(std::string_view host) const {
+    std::shared_lock lock(mutex_);
+    auto it = nodes.find(std::string(host));
+    return it == nodes.end() ? nullptr : it->second->storage;
+}
+
+std::string HypervisorCluster::uri(std::string_view host) const {
+    std::shared_lock lock(mutex_);
+    auto it = nodes.find(std::string(host));
+    return it == nodes.end() ? std::string{} : it->second->spec.uri;
+}
+
+std::vector<std::string> HypervisorCluster::domainsOn(std::string_view host) const {
+    std::shared_lock lock(mutex_);
+    std::vector<std::string> out;
+    for (const auto& [domain, where] : placed) {
+        if (where.host == host) out.push_back(domain);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::size_t HypervisorCluster::refreshCapacity() {
+    std::vector<std::shared_ptr<Host>> all;
+    {
+        std::shared_lock lock(mutex_);
+        for (const auto& [_, h] : nodes) all.push_back(h);
+    }
+    std::vector<ClusterHostStatus> fresh(all.size());
+    // one thread per host: a slow TLS link delays only its own host
+    parallelFor(all.size(), all.size(), [&](std::size_t i) {
+        auto& s = fresh[i];
+        s.name = all[i]->spec.name;
+        s.uri = all[i]->spec.uri;
+        auto lease = all[i]->connector->acquire();
+        auto cap = HostCapacity::read(lease.get(), storagePool);
+        s.up = cap.isOk();
+        if (cap.isOk()) s.capacity = cap.unwrap();
+        else s.error = cap.unwrapErr();
+        s.refreshedAt = Clock::now();
+    }, [&](std::size_t i, std::string what) {
+        fresh[i].up = false;
+        fresh[i].error = std::move(what);
+        fresh[i].refreshedAt = Clock::now();
+    });
+
+    std::size_t up = 0;
+    std::unique_lock lock(mutex_);
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        all[i]->status = std::move(fresh[i]);
+        if (all[i]->status.up) ++up;
+    }
+    return up;
+}
+
+std::vector<ClusterHostStatus> HypervisorCluster::status() const {
+    std::shared_lock lock(mutex_);
+    std::vector<ClusterHostStatus> out;
+    out.reserve(nodes.size());
+    for (const auto& [_, h] : nodes) out.push_back(h->status);
+    return out;
+}
+
+std::map<std::string, std::vector<std::size_t>> HypervisorCluster::plan(const std::vector<VmConfig>& cfgs,
+                                                                         std::map<std::string, std::shared_ptr<Host>>& byName,
+                                                                         std::vector<std::string>& chosen) {
+    std::vector<HostSlot> slots;
+    {
+        std::shared_lock lock(mutex_);
+        for (const auto& [name, h] : nodes) {
+            slots.push_back(HostSlot{name, h->status.capacity, h->status.up});
+            byName.emplace(name, h);
+        }
+    }
+    chosen = scheduler.schedule(cfgs, std::move(slots));
+    std::map<std::string, std::vector<std::size_t>> perHost;
+    for (std::size_t i = 0; i < cfgs.size(); ++i) {
+        if (!chosen[i].empty()) perHost[chosen[i]].push_back(i);
+    }
+    return perHost;
+}
+
+std::size_t HypervisorCluster::prefetchOn(Host& host, const std::vector<VmConfig>& cfgs, const std::vector<std::size_t>& members) {
+    if (!host.storage) return 0;
+    std::vector<std::string> bases;
+    for (std::size_t i : members) {
+        // linked clones come from the warm pool of the VM's template: prefetch what it clones from
+        auto it = cfgs[i].metadata.find("template");
+        if (it == cfgs[i].metadata.end() || it->second.empty()) continue;
+        std::string base = host.manager->getWarmPool().baseImageOf(it->second);
+        if (base.empty()) continue;
+        if (std::find(bases.begin(), bases.end(), base) == bases.end()) bases.push_back(std::move(base));
+    }
+    std::size_t ready = 0;
+    for (const auto& base : bases) {
+        auto res = host.storage->prefetch(base);
+        if (res.isOk()) ++ready;
+        else BoostLogger::Warn("HypervisorCluster: " + host.spec.name + " boots " + base + " from shared storage: " + res.unwrapErr());
+    }
+    return ready;
+}
+
+std::size_t HypervisorCluster::prefetch(const std::vector<VmConfig>& cfgs) {
+    if (refreshCapacity() == 0) return 0;
+    std::map<std::string, std::shared_ptr<Host>> byName;
+    std::vector<std::string> chosen;
+    auto perHost = plan(cfgs, byName, chosen);
+    std::vector<std::pair<std::string, std::vector<std::size_t>>> work(perHost.begin(), perHost.end());
+    std::vector<std::size_t> ready(work.size(), 0);
+    // hosts pull side by side; the copies of one host share its disk and run one after another
+    parallelFor(work.size(), work.size(), [&](std::size_t w) {
+        ready[w] = prefetchOn(*byName.at(work[w].first), cfgs, work[w].second);
+    }, [&](std::size_t w, std::string what) {
+        // nothing ready there: deploy_batch pulls what it needs itself
+        BoostLogger::Warn("HypervisorCluster: prefetch on " + work[w].first + " failed: " + what);
+    });
+    std::size_t total = 0;
+    for (std::size_t n : ready) total += n;
+    return total;
+}
+
+Result<DeployBatchResult> HypervisorCluster::deploy_batch(const std::vector<VmConfig>& cfgs) {
+    const auto t0 = Clock::now();
+    if (refreshCapacity() == 0) return Result<DeployBatchResult>{std::string("No hypervisor host is up")};
+
+    std::map<std::string, std::shared_ptr<Host>> byName;
+    std::vector<std::string> chosen;
+    auto perHost = plan(cfgs, byName, chosen);
+
+    DeployBatchResult batch;
+    batch.outcomes.resize(cfgs.size());
+    for (std::size_t i = 0; i < cfgs.size(); ++i) {
+        auto& out = batch.outcomes[i];
+        out.name = cfgs[i].name;
+        out.wave = deployWaveOf(cfgs[i]);
+        if (chosen[i].empty()) out.error = "No host has capacity for " + cfgs[i].name;
+    }
+
+    std::vector<std::pair<std::string, std::vector<std::size_t>>> work(perHost.begin(), perHost.end());
+    std::vector<DeployStageTimings> timings(work.size());
+    auto fail = [&](std::size_t w, const std::string& err) {
+        const auto& [hostName, members] = work[w];
+        for (std::size_t i : members) {
+            batch.outcomes[i].host = hostName;
+            batch.outcomes[i].error = hostName + ": " + err;
+        }
+    };
+    parallelFor(work.size(), work.size(), [&](std::size_t w) {
+        const auto& [hostName, members] = work[w];
+        std::vector<VmConfig> subset;
+        subset.reserve(members.size());
+        for (std::size_t i : members) subset.push_back(cfgs[i]);
+        // a hit when prefetch() already ran for this lab
+        (void)prefetchOn(*byName.at(hostName), cfgs, members);
+        auto res = byName.at(hostName)->manager->deploy_batch(subset);
+        if (res.isErr()) { fail(w, res.unwrapErr()); return; }
+        auto hostBatch = std::move(res).unwrap();
+        for (std::size_t k = 0; k < members.size(); ++k) {
+            auto& out = batch.outcomes[members[k]];
+            out = std::move(hostBatch.outcomes[k]);
+            out.host = hostName;
+            if (out.ok()) remember(out.name, Placed{hostName, LabSliceManager::labOf(cfgs[members[k]]).value_or(std::string{})});
+        }
+        timings[w] = std::move(hostBatch.timings);
+    }, fail);
+
+    // hosts deploy side by side: each stage took as long as its slowest host
+    for (const auto& t : timings) {
+        batch.timings.buildXml = std::max(batch.timings.buildXml, t.buildXml);
+        batch.timings.define = std::max(batch.timings.define, t.define);
+        batch.timings.allocate = std::max(batch.timings.allocate, t.allocate);
+        batch.timings.start = std::max(batch.timings.start, t.start);
+    }
+    batch.timings.total = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0);
+    BoostLogger::Info("HypervisorCluster: deployed " + std::to_string(batch.succeeded()) + "/" + std::to_string(cfgs.size())
+                      + " VMs on " + std::to_string(work.size()) + " hosts");
+    return Result<DeployBatchResult>{std::move(batch)};
+}
+
+Result<void> HypervisorCluster::deleteDomain(std::string_view name, bool deleteStorage) {
+    auto m = managerOf(name);
+    if (!m) return Result<void>{"Domain not placed on any host: " + std::string(name)};
+    auto res = m->deleteDomain(name, deleteStorage);
+    if (res.isOk()) forget(std::string(name));
+    return res;
+}
@@ -0,0 +1,317 @@
+#include "Virtualization/cluster/MigrationManager.hpp"
+#include "Virtualization/vmm/LibvirtCall.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <libvirt/libvirt.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string lastError(const char* what) {
+    virErrorPtr err = virGetLastError();
+    return std::string(what) + ": " + (err && err->message ? err->message : "unknown");
+}
+
+std::chrono::milliseconds elapsedSince(Clock::time_point t0) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0);
+}
+
+void readJobStats(virDomainPtr dom, MigrationProgress& p) {
+    int type = VIR_DOMAIN_JOB_NONE;
+    virTypedParameterPtr params = nullptr;
+    int n = 0;
+    if (virDomainGetJobStats(dom, &type, &params, &n, 0) < 0) return;
+    unsigned long long v = 0;
+    if (virTypedParamsGetULLong(params, n, VIR_DOMAIN_JOB_DATA_TOTAL, &v) == 1) p.dataTotal = v;
+    if (virTypedParamsGetULLong(params, n, VIR_DOMAIN_JOB_DATA_PROCESSED, &v) == 1) p.dataProcessed = v;
+    if (virTypedParamsGetULLong(params, n, VIR_DOMAIN_JOB_DATA_REMAINING, &v) == 1) p.dataRemaining = v;
+    if (virTypedParamsGetULLong(params, n, VIR_DOMAIN_JOB_MEMORY_DIRTY_RATE, &v) == 1) p.dirtyRate = v;
+    virTypedParamsFree(params, n);
+}
+
+} // namespace
+
+MigrationManager::MigrationManager(std::shared_ptr<HypervisorCluster> cluster, MigrationLimits limits)
+    : cluster(std::move(cluster)), limits(limits)
+{
+    this->limits.outgoingPerHost = std::max(1u, this->limits.outgoingPerHost);
+    this->limits.incomingPerHost = std::max(1u, this->limits.incomingPerHost);
+    this->limits.total = std::max(1u, this->limits.total);
+}
+
+void MigrationManager::acquireSlots(const std::string& from, const std::string& to) {
+    std::unique_lock lock(mutex_);
+    slotFreed.wait(lock, [&] {
+        return running < limits.total && outgoing[from] < limits.outgoingPerHost && incoming[to] < limits.incomingPerHost;
+    });
+    ++running;
+    ++outgoing[from];
+    ++incoming[to];
+}
+
+void MigrationManager::releaseSlots(const std::string& from, const std::string& to) {
+    {
+        std::lock_guard lock(mutex_);
+        --running;
+        --outgoing[from];
+        --incoming[to];
+    }
+    slotFreed.notify_all();
+}
+
+void MigrationManager::publish(const MigrationProgress& p, const ProgressFn& progress) {
+    {
+        std::lock_guard lock(mutex_);
+        if (p.phase == MigrationPhase::Completed || p.phase == MigrationPhase::Failed) inFlight.erase(p.domain);
+        else inFlight[p.domain] = p;
+    }
+    if (!progress) return;
+    try {
+        progress(p);
+    } catch (...) {
+        // a broken listener must not break the migration
+    }
+}
+
+std::vector<MigrationProgress> MigrationManager::active() const {
+    std::lock_guard lock(mutex_);
+    std::vector<MigrationProgress> out;
+    out.reserve(inFlight.size());
+    for (const auto& [_, p] : inFlight) out.push_back(p);
+    return out;
+}
+
+MigrationResult MigrationManager::migrate(const std::string& domain, const std::string& toHost,
+                                          const MigrationOptions& options, const ProgressFn& progress) {
+    const auto t0 = Clock::now();
+    MigrationResult result;
+    result.domain = domain;
+    result.to = toHost;
+    auto from = cluster->hostOf(domain);
+    if (!from) {
+        result.error = "Domain not placed on any host: " + domain;
+        return result;
+    }
+    result.from = *from;
+    if (result.from == toHost) {
+        result.error = domain + " already runs on " + toHost;
+        return result;
+    }
+    const std::string destUri = cluster->uri(toHost);
+    auto source = cluster->connector(result.from);
+    if (destUri.empty() || !source) {
+        result.error = "Unknown host: " + (destUri.empty() ? toHost : result.from);
+        return result;
+    }
+
+    MigrationProgress state;
+    state.domain = domain;
+    state.from = result.from;
+    state.to = toHost;
+    publish(state, progress);
+    acquireSlots(result.from, toHost);
+
+    auto finish = [&](std::string error) {
+        releaseSlots(result.from, toHost);
+        result.error = std::move(error);
+        result.took = elapsedSince(t0);
+        state.phase = result.ok() ? MigrationPhase::Completed : MigrationPhase::Failed;
+        state.elapsed = result.took;
+        publish(state, progress);
+        if (result.ok()) {
+            PH_INFO(LogFields{.vm = domain}, "Migrated {} -> {} in {} ms", result.from, toHost, result.took.count());
+        } else {
+            PH_WARN(LogFields{.vm = domain}, "Migration failed: {}", result.error);
+        }
+        return result;
+    };
+
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = source->acquire();
+    } catch (const std::exception& e) {
+        return finish(std::string("Not connected to ") + result.from + ": " + e.what());
+    }
+    virDomainPtr dom = virDomainLookupByName(lease.get(), domain.c_str());
+    if (!dom) return finish(lastError("Domain lookup failed"));
+    const bool live = virDomainIsActive(dom) == 1;
+
+    unsigned int flags = VIR_MIGRATE_PEER2PEER | VIR_MIGRATE_PERSIST_DEST | VIR_MIGRATE_UNDEFINE_SOURCE;
+    if (live) {
+        // lab disks are overlays on a base image every host caches: only the overlay is copied
+        flags |= VIR_MIGRATE_LIVE | VIR_MIGRATE_NON_SHARED_INC;
+        if (options.autoConverge) flags |= VIR_MIGRATE_AUTO_CONVERGE;
+        if (options.postCopy) flags |= VIR_MIGRATE_POSTCOPY;
+        if (options.compressed) flags |= VIR_MIGRATE_COMPRESSED;
+    } else {
+        flags |= VIR_MIGRATE_OFFLINE; // only the definition moves; disks are on shared storage
+    }
+    virTypedParameterPtr params = nullptr;
+    int nparams = 0;
+    int maxparams = 0;
+    if (options.bandwidthMiBs > 0) {
+        (void)virTypedParamsAddULLong(&params, &nparams, &maxparams, VIR_MIGRATE_PARAM_BANDWIDTH, options.bandwidthMiBs);
+        if (options.postCopy) (void)virTypedParamsAddULLong(&params, &nparams, &maxparams, VIR_MIGRATE_PARAM_BANDWIDTH_POSTCOPY, options.bandwidthMiBs);
+    }
+
+    // job stats, post-copy switch and timeout run beside the blocking migrate call
+    std::mutex monitorMutex;
+    std::condition_variable monitorWake;
+    bool done = false;
+    std::atomic<bool> switched{false};
+    std::atomic<bool> aborted{false};
+    std::thread monitor;
+    if (live) {
+        monitor = std::thread([&] {
+            std::unique_lock lock(monitorMutex);
+            while (!monitorWake.wait_for(lock, options.pollInterval, [&] { return done; })) {
+                lock.unlock();
+                MigrationProgress p = state;
+                p.phase = switched ? MigrationPhase::Postcopy : MigrationPhase::Precopy;
+                p.elapsed = elapsedSince(t0);
+                readJobStats(dom, p);
+                publish(p, progress);
+                if (!switched && options.postCopy && p.elapsed >= options.postCopyAfter) {
+                    if (virDomainMigrateStartPostCopy(dom, 0) == 0) switched = true;
+                } else if (!switched && !aborted && p.elapsed >= options.timeout) {
+                    aborted = virDomainAbortJob(dom) == 0;
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    const int rc = LIBVIRT_CALL(virDomainMigrateToURI3, dom, destUri.c_str(), params, static_cast<unsigned int>(nparams), flags);
+    const std::string error = rc < 0 ? lastError("virDomainMigrateToURI3 failed") : std::string{};
+    {
+        std::lock_guard lock(monitorMutex);
+        done = true;
+    }
+    monitorWake.notify_all();
+    if (monitor.joinable()) monitor.join();
+    virTypedParamsFree(params, nparams);
+    virDomainFree(dom);
+
+    result.postCopy = switched;
+    if (rc < 0) {
+        return finish(aborted ? "Pre-copy did not converge within " + std::to_string(options.timeout.count()) + " s; aborted" : error);
+    }
+    // the source keeps nothing: pool record, console port, MACs, placement and lab membership go
+    if (auto previous = cluster->managerOf(domain)) previous->releaseMigrated(domain);
+    cluster->rehome(domain, toHost);
+    return finish({});
+}
+
+Result<std::vector<MigrationManager::Move>> MigrationManager::plan(const std::vector<std::string>& domains,
+                                                                   const std::vector<std::string>& excluded) {
+    std::vector<VmConfig> cfgs;
+    cfgs.reserve(domains.size());
+    for (const auto& d : domains) {
+        auto m = cluster->managerOf(d);
+        if (!m) return Result<std::vector<Move>>{"Domain not placed on any host: " + d};
+        auto cfg = m->getConfig(d);
+        if (cfg.isErr()) return Result<std::vector<Move>>{"Cannot read config of " + d + ": " + cfg.unwrapErr()};
+        VmConfig copy = *cfg.unwrap();
+        if (auto lab = cluster->labOf(d)) copy.metadata["lab"] = *lab;
+        cfgs.push_back(std::move(copy));
+    }
+
+    std::vector<HostSlot> slots;
+    for (const auto& s : cluster->status()) {
+        const bool out = std::find(excluded.begin(), excluded.end(), s.name) != excluded.end();
+        slots.push_back(HostSlot{s.name, s.capacity, s.up && !out});
+    }
+    const auto targets = cluster->getScheduler().schedule(cfgs, std::move(slots));
+
+    std::vector<Move> moves;
+    moves.reserve(domains.size());
+    for (std::size_t i = 0; i < domains.size(); ++i) moves.push_back(Move{domains[i], targets[i]});
+    return Result<std::vector<Move>>{std::move(moves)};
+}
+
+std::vector<MigrationResult> MigrationManager::runAll(const std::vector<Move>& moves, const MigrationOptions& options,
+                                                      const ProgressFn& progress) {
+    std::vector<MigrationResult> results(moves.size());
+    // the slots do the real limiting; this only bounds the threads parked on them
+    parallelFor(moves.size(), limits.total, [&](std::size_t i) {
+        results[i] = migrate(moves[i].domain, moves[i].to, options, progress);
+    }, [&](std::size_t i, std::string what) {
+        results[i].domain = moves[i].domain;
+        results[i].to = moves[i].to;
+        results[i].error = std::move(what);
+    });
+    return results;
+}
+
+Result<std::vector<MigrationResult>> MigrationManager::drain(const std::string& host, const MigrationOptions& options,
+                                                             const ProgressFn& progress) {
+    const auto domains = cluster->domainsOn(host);
+    if (domains.empty()) return Result<std::vector<MigrationResult>>{std::vector<MigrationResult>{}};
+    (void)cluster->refreshCapacity();
+    auto moves = plan(domains, {host});
+    if (moves.isErr()) return Result<std::vector<MigrationResult>>{moves.unwrapErr()};
+    for (const auto& m : moves.unwrap()) {
+        if (m.to.empty()) return Result<std::vector<MigrationResult>>{"No other host has room for " + m.domain + "; nothing moved"};
+    }
+    BoostLogger::Info("Draining " + host + ": " + std::to_string(domains.size()) + " domains");
+    return Result<std::vector<MigrationResult>>{runAll(moves.unwrap(), options, progress)};
+}
+
+Result<std::vector<MigrationResult>> MigrationManager::rebalance(double highWater, const MigrationOptions& options,
+                                                                 const ProgressFn& progress) {
+    if (cluster->refreshCapacity() < 2) return Result<std::vector<MigrationResult>>{std::string("Rebalancing needs two hosts up")};
+    const auto& scheduler = cluster->getScheduler();
+
+    std::vector<std::string> hot;
+    std::vector<std::string> shed;
+    for (const auto& s : cluster->status()) {
+        if (!s.up || scheduler.load(s.capacity) <= highWater) continue;
+        hot.push_back(s.name);
+        auto m = cluster->manager(s.name);
+        if (!m) continue;
+
+        // labs move whole; the cheapest ones go first until the host is back under the mark
+        struct Group {
+            std::vector<std::string> domains;
+            std::uint64_t memoryKiB{0};
+            unsigned int vcpus{0};
+        };
+        std::map<std::string, Group> byLab;
+        std::vector<Group> groups;
+        for (const auto& d : cluster->domainsOn(s.name)) {
+            auto cfg = m->getConfig(d);
+            if (cfg.isErr()) continue;
+            const auto& c = *cfg.unwrap();
+            Group* g;
+            if (auto lab = cluster->labOf(d)) g = &byLab[*lab];
+            else g = &groups.emplace_back();
+            g->domains.push_back(d);
+            g->memoryKiB += c.memory;
+            g->vcpus += std::max(c.vcpus, 1u);
+        }
+        for (auto& [_, g] : byLab) groups.push_back(std::move(g));
+        std::stable_sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) { return a.memoryKiB < b.memoryKiB; });
+
+        HostCapacity projected = s.capacity;
+        for (const auto& g : groups) {
+            if (scheduler.load(projected) <= highWater) break;
+            projected.committedMemoryKiB -= std::min(projected.committedMemoryKiB, g.memoryKiB);
+            projected.committedVcpus -= std::min(projected.committedVcpus, g.vcpus);
+            shed.insert(shed.end(), g.domains.begin(), g.domains.end());
+        }
+    }
+    if (shed.empty()) return Result<std::vector<MigrationResult>>{std::vector<MigrationResult>{}};
+
+    auto moves = plan(shed, hot);
+    if (moves.isErr()) return Result<std::vector<MigrationResult>>{moves.unwrapErr()};
+    std::vector<Move> feasible;
+    for (const auto& m : moves.unwrap()) {
+        if (!m.to.empty()) feasible.push_back(m); // what the cooler hosts cannot take stays put
+    }
+    BoostLogger::Info("Rebalancing " + std::to_string(hot.size()) + " hot hosts: moving " + std::to_string(feasible.size())
+                      + " of " + std::to_string(shed.size()) + " candidate domains");
+    return Result<std::vector<MigrationResult>>{runAll(feasible, options, progress)};
+}
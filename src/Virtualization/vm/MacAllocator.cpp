@@ -0,0 +1,202 @@
+#include "Virtualization/vm/MacAllocator.hpp"
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <thread>
+
+namespace {
+
+constexpr std::string_view kMacPrefix = "mac/";
+constexpr char kHex[] = "0123456789abcdef";
+constexpr int kMaxAttempts = 64;
+
+rocksdb::Slice toSlice(std::string_view sv) {
+    return rocksdb::Slice(sv.data(), sv.size());
+}
+
+// splitmix64: one add and three xorshift-multiplies per address
+std::uint64_t nextRandom() noexcept {
+    thread_local std::uint64_t state = [] {
+        std::random_device rd;
+        return (static_cast<std::uint64_t>(rd()) << 32) ^ rd() ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+    }();
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// FNV-1a: unlike std::hash it is the same across builds, so a lab keeps its prefix
+std::uint64_t fnv1a(std::string_view s) noexcept {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : s) h = (h ^ c) * 0x100000001b3ULL;
+    return h;
+}
+
+int hexValue(char c) noexcept {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+constexpr MacAllocator::Mac kLocalBit = 0x02ULL << 40;     // locally administered
+constexpr MacAllocator::Mac kMulticastBit = 0x01ULL << 40; // must stay clear
+
+} // namespace
+
+MacAllocator::MacAllocator(std::shared_ptr<IRocksDB> db)
+    : db(std::move(db))
+{
+    if (!this->db) return;
+    std::string upper(kMacPrefix);
+    upper.back() = static_cast<char>(upper.back() + 1);
+    rocksdb::Slice upperSlice(upper);
+    rocksdb::ReadOptions ro;
+    ro.iterate_upper_bound = &upperSlice;
+    ro.fill_cache = false;
+    auto it = this->db->NewIterator(ro);
+    if (!it) return;
+    for (it->Seek(toSlice(kMacPrefix)); it->Valid(); it->Next()) {
+        const std::string_view k(it->key().data(), it->key().size());
+        Mac mac = 0;
+        bool ok = k.size() == kMacPrefix.size() + 12;
+        for (std::size_t i = kMacPrefix.size(); ok && i < k.size(); ++i) {
+            const int v = hexValue(k[i]);
+            ok = v >= 0;
+            mac = (mac << 4) | static_cast<Mac>(v);
+        }
+        if (ok) insertLocked(mac, it->value().ToString());
+    }
+}
+
+std::array<char, 18> MacAllocator::format(Mac mac) noexcept {
+    std::array<char, 18> out{};
+    for (int i = 0; i < 6; ++i) {
+        const auto byte = static_cast<unsigned>((mac >> (40 - 8 * i)) & 0xFF);
+        out[3 * i] = kHex[byte >> 4];
+        out[3 * i + 1] = kHex[byte & 0xF];
+        if (i < 5) out[3 * i + 2] = ':';
+    }
+    out[17] = '\0';
+    return out;
+}
+
+std::optional<MacAllocator::Mac> MacAllocator::parse(std::string_view text) noexcept {
+    if (text.size() != 17) return std::nullopt;
+    Mac mac = 0;
+    for (int i = 0; i < 6; ++i) {
+        const int hi = hexValue(text[3 * i]);
+        const int lo = hexValue(text[3 * i + 1]);
+        if (hi < 0 || lo < 0) return std::nullopt;
+        if (i < 5 && text[3 * i + 2] != ':') return std::nullopt;
+        mac = (mac << 8) | static_cast<Mac>(hi << 4 | lo);
+    }
+    return mac;
+}
+
+std::string MacAllocator::randomMac() {
+    const auto buf = format(candidate({}));
+    return std::string(buf.data(), 17);
+}
+
+MacAllocator::Mac MacAllocator::candidate(std::string_view lab) noexcept {
+    const Mac r = nextRandom();
+    if (lab.empty()) return ((r & 0xFFFFFFFFFFFFULL) | kLocalBit) & ~kMulticastBit;
+    const Mac labBits = static_cast<Mac>(fnv1a(lab) & 0xFFFF);
+    return kLocalBit | (labBits << 24) | (r & 0xFFFFFF);
+}
+
+std::string MacAllocator::key(Mac mac) {
+    std::string k(kMacPrefix);
+    k.resize(kMacPrefix.size() + 12);
+    for (int i = 0; i < 12; ++i) k[kMacPrefix.size() + i] = kHex[(mac >> (44 - 4 * i)) & 0xF];
+    return k;
+}
+
+bool MacAllocator::insertLocked(Mac mac, const std::string& owner) {
+    auto [it, inserted] = owners.try_emplace(mac, owner);
+    if (!inserted) return it->second == owner;
+    byOwner[owner].push_back(mac);
+    return true;
+}
+
+void MacAllocator::eraseLocked(Mac mac) {
+    auto it = owners.find(mac);
+    if (it == owners.end()) return;
+    auto owned = byOwner.find(it->second);
+    if (owned != byOwner.end()) {
+        std::erase(owned->second, mac);
+        if (owned->second.empty()) byOwner.erase(owned);
+    }
+    owners.erase(it);
+}
+
+Result<std::string> MacAllocator::allocate(const std::string& owner, std::string_view lab) {
+    std::lock_guard lock(mutex_);
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+        const Mac mac = candidate(lab);
+        if (owners.count(mac)) continue;
+        if (db) {
+            auto res = db->Put(rocksdb::WriteOptions{}, key(mac), owner);
+            if (!res) return Err{"Persisting MAC failed: " + res.error().ToString()};
+        }
+        insertLocked(mac, owner);
+        const auto buf = format(mac);
+        return Result<std::string>{std::string(buf.data(), 17)};
+    }
+    // 24 random bits per lab: only reachable with millions of NICs in one lab
+    return Err{"No free MAC address after " + std::to_string(kMaxAttempts) + " attempts"};
+}
+
+bool MacAllocator::reserve(std::string_view text, const std::string& owner) {
+    const auto mac = parse(text);
+    if (!mac || (*mac & kMulticastBit)) return false;
+    std::lock_guard lock(mutex_);
+    if (auto it = owners.find(*mac); it != owners.end()) return it->second == owner;
+    if (db && !db->Put(rocksdb::WriteOptions{}, key(*mac), owner)) return false;
+    return insertLocked(*mac, owner);
+}
+
+void MacAllocator::release(std::string_view text) {
+    const auto mac = parse(text);
+    if (!mac) return;
+    std::lock_guard lock(mutex_);
+    if (!owners.count(*mac)) return;
+    if (db) (void)db->Delete(rocksdb::WriteOptions{}, key(*mac));
+    eraseLocked(*mac);
+}
+
+void MacAllocator::releaseOwner(const std::string& owner) {
+    std::lock_guard lock(mutex_);
+    auto it = byOwner.find(owner);
+    if (it == byOwner.end()) return;
+    const auto macs = it->second;
+    if (db) {
+        rocksdb::WriteBatch batch;
+        for (Mac mac : macs) batch.Delete(key(mac));
+        (void)db->Write(rocksdb::WriteOptions{}, batch);
+    }
+    for (Mac mac : macs) eraseLocked(mac);
+}
+
+bool MacAllocator::contains(std::string_view text) const {
+    const auto mac = parse(text);
+    if (!mac) return false;
+    std::lock_guard lock(mutex_);
+    return owners.count(*mac) > 0;
+}
+
+std::optional<std::string> MacAllocator::ownerOf(std::string_view text) const {
+    const auto mac = parse(text);
+    if (!mac) return std::nullopt;
+    std::lock_guard lock(mutex_);
+    auto it = owners.find(*mac);
+    if (it == owners.end()) return std::nullopt;
+    return it->second;
+}
+
+std::size_t MacAllocator::size() const {
+    std::lock_guard lock(mutex_);
+    return owners.size();
+}
@@ -0,0 +1,65 @@
+#include "Virtualization/vm/PortAllocator.hpp"
+#include <bit>
+#include <stdexcept>
+
+PortAllocator::PortAllocator(std::uint16_t first, std::uint16_t last)
+    : first(first), last(last) {
+    if (first == 0 || first > last) throw std::invalid_argument("Invalid port range");
+    clear();
+}
+
+void PortAllocator::clear() noexcept {
+    const std::size_t n = capacity();
+    words.assign((n + 63) / 64, 0);
+    // bits past the end of the range are permanently "used" so scans never return them
+    if (const std::size_t tail = n % 64; tail != 0) {
+        words.back() = ~std::uint64_t{0} << tail;
+    }
+    cursor = 0;
+    freeCount = n;
+}
+
+std::optional<std::uint16_t> PortAllocator::reserve() noexcept {
+    if (freeCount == 0) return std::nullopt;
+    for (std::size_t step = 0; step < words.size(); ++step) {
+        const std::size_t w = (cursor + step) % words.size();
+        const std::uint64_t freeBits = ~words[w];
+        if (freeBits == 0) continue;
+        const int bit = std::countr_zero(freeBits);
+        words[w] |= std::uint64_t{1} << bit;
+        --freeCount;
+        cursor = w;
+        return static_cast<std::uint16_t>(first + w * 64 + static_cast<std::size_t>(bit));
+    }
+    return std::nullopt;
+}
+
+bool PortAllocator::reserve(std::uint16_t port) noexcept {
+    if (!contains(port)) return false;
+    const std::size_t idx = port - first;
+    std::uint64_t& word = words[idx / 64];
+    const std::uint64_t mask = std::uint64_t{1} << (idx % 64);
+    if (word & mask) return false;
+    word |= mask;
+    --freeCount;
+    return true;
+}
+
+bool PortAllocator::release(std::uint16_t port) noexcept {
+    if (!contains(port)) return false;
+    const std::size_t idx = port - first;
+    std::uint64_t& word = words[idx / 64];
+    const std::uint64_t mask = std::uint64_t{1} << (idx % 64);
+    if (!(word & mask)) return false;
+    word &= ~mask;
+    ++freeCount;
+    // prefer handing out low ports again so the range stays compact
+    if (idx / 64 < cursor) cursor = idx / 64;
+    return true;
+}
+
+bool PortAllocator::isReserved(std::uint16_t port) const noexcept {
+    if (!contains(port)) return false;
+    const std::size_t idx = port - first;
+    return (words[idx / 64] >> (idx % 64)) & 1u;
+}
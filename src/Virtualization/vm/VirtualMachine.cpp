@@ -1,4 +1,5 @@
-#include "/home/hussin/Desktop/PenHive/include/Virtualization/vm/VirtualMachine.hpp"
+#include "Virtualization/vm/VirtualMachine.hpp"
+#include "Virtualization/vmm/LibvirtCall.hpp"
 #include <libvirt/libvirt.h>
 #include <libvirt/virterror.h>
 
@@ -8,6 +9,12 @@ VirtualMachine::VirtualMachine(std::shared_ptr<HypervisorConnector> conn, std::s
     if (!domain) throw VmException("VM not found: " + name);
 }
 
+VirtualMachine::VirtualMachine(std::shared_ptr<HypervisorConnector> conn, std::string_view vmName, virDomainPtr Dom)
+    : connector(std::move(conn)), name(vmName), domain(nullptr), state(VmState::Unknown) {
+    if (Dom && virDomainRef(Dom) == 0) domain = Dom;
+    if (!domain) throw VmException("VM not found: " + name);
+}
+
 VirtualMachine::~VirtualMachine() {
     if (domain) virDomainFree(domain);
 }
@@ -21,16 +28,16 @@ int VirtualMachine::setDomain(virDomainPtr Dom) {
 
 virDomainPtr VirtualMachine::getDomain() { return domain; }
 
-void VirtualMachine::start() { checkLibvirtError(virDomainCreate(domain), "start"); }
-void VirtualMachine::shutdown() { checkLibvirtError(virDomainShutdown(domain), "shutdown"); }
-void VirtualMachine::reboot() { checkLibvirtError(virDomainReboot(domain, 0), "reboot"); }
-void VirtualMachine::destroy() { checkLibvirtError(virDomainDestroy(domain), "destroy"); }
+void VirtualMachine::start() { checkLibvirtError(LIBVIRT_CALL(virDomainCreate, domain), "start"); }
+void VirtualMachine::shutdown() { checkLibvirtError(LIBVIRT_CALL(virDomainShutdown, domain), "shutdown"); }
+void VirtualMachine::reboot() { checkLibvirtError(LIBVIRT_CALL(virDomainReboot, domain, 0), "reboot"); }
+void VirtualMachine::destroy() { checkLibvirtError(LIBVIRT_CALL(virDomainDestroy, domain), "destroy"); }
 
 const std::string& VirtualMachine::getName() const noexcept { return name; }
 
 VirtualMachine::VmState VirtualMachine::getState() const {
     int s;
-    if (virDomainGetState(domain, &s, nullptr, 0) < 0) return VmState::Unknown;
+    if (LIBVIRT_CALL(virDomainGetState, domain, &s, nullptr, 0) < 0) return VmState::Unknown;
     return mapLibvirtState(s);
 }
 
@@ -41,8 +48,8 @@ void VirtualMachine::refreshHandle() {
     if (domain) { virDomainFree(domain); domain = nullptr; }
     if (connector) {
         try {
-            connector->ensureConnected();
-            domain = virDomainLookupByName(connector->getRawHandle(), name.c_str());
+            auto lease = connector->acquire();
+            domain = LIBVIRT_CALL(virDomainLookupByName, lease.get(), name.c_str());
         } catch (...) {
             domain = nullptr;
         }
@@ -1,50 +1,50 @@
-#include "/home/hussin/Desktop/PenHive/include/Virtualization/vm/VirtualMachineNic.hpp"
-#include <random>
-#include <sstream>
-#include <iomanip>
+#include "Virtualization/vm/VirtualMachineNic.hpp"
+#include "Virtualization/vm/MacAllocator.hpp"
 #include <stdexcept>
 
-VirtualMachineNic::VirtualMachineNic() : mac(generate_mac()) {}
-VirtualMachineNic::VirtualMachineNic(std::string m) : mac(std::move(m)) {}
+namespace {
+
+// a bare virtio NIC on libvirt's default network
+NetworkConfig defaultNic(std::string mac) {
+    NetworkConfig nic;
+    nic.type = "network";
+    nic.source = "default";
+    nic.model = "virtio";
+    nic.macAddress = std::move(mac);
+    return nic;
+}
+
+std::string interfaceXml(const NetworkConfig& nic) {
+    std::string xml;
+    VmConfig::writeInterfaceXML(xml, nic);
+    return xml;
+}
+
+} // namespace
+
+VirtualMachineNic::VirtualMachineNic() : nic(defaultNic(generate_mac())) {}
+VirtualMachineNic::VirtualMachineNic(std::string m) : nic(defaultNic(std::move(m))) {}
+VirtualMachineNic::VirtualMachineNic(NetworkConfig config) : nic(std::move(config)) {
+    if (nic.macAddress.empty()) nic.macAddress = generate_mac();
+}
 VirtualMachineNic::~VirtualMachineNic() = default;
 
 bool VirtualMachineNic::attach(virDomainPtr domain) {
     if (!domain) throw std::invalid_argument("domain is null");
-    std::ostringstream xml;
-    xml << "<interface type='network'>"
-        << "<source network='default'/>"
-        << "<model type='virtio'/>"
-        << "<mac address='" << mac << "'/>"
-        << "</interface>";
-    int rc = virDomainAttachDeviceFlags(domain, xml.str().c_str(), VIR_DOMAIN_AFFECT_CONFIG | VIR_DOMAIN_AFFECT_LIVE);
+    int rc = virDomainAttachDeviceFlags(domain, interfaceXml(nic).c_str(), VIR_DOMAIN_AFFECT_CONFIG | VIR_DOMAIN_AFFECT_LIVE);
     return rc == 0;
 }
 
 bool VirtualMachineNic::detach(virDomainPtr domain) {
     if (!domain) throw std::invalid_argument("domain is null");
-    std::ostringstream xml;
-    xml << "<interface type='network'>"
-        << "<source network='default'/>"
-        << "<model type='virtio'/>"
-        << "<mac address='" << mac << "'/>"
-        << "</interface>";
-    int rc = virDomainDetachDeviceFlags(domain, xml.str().c_str(), VIR_DOMAIN_AFFECT_CONFIG | VIR_DOMAIN_AFFECT_LIVE);
+    // libvirt picks the device by MAC; the rest only has to be consistent with it
+    int rc = virDomainDetachDeviceFlags(domain, interfaceXml(nic).c_str(), VIR_DOMAIN_AFFECT_CONFIG | VIR_DOMAIN_AFFECT_LIVE);
     return rc == 0;
 }
 
-std::string VirtualMachineNic::getMac() const noexcept { return mac; }
+std::string VirtualMachineNic::getMac() const noexcept { return nic.macAddress; }
 
 std::string VirtualMachineNic::generate_mac() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 255);
-    std::ostringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (int i = 0; i < 6; ++i) {
-        int byte = dis(gen);
-        if (i == 0) byte = (byte & 0xFE) | 0x02;
-        ss << std::setw(2) << (byte & 0xFF);
-        if (i != 5) ss << ":";
-    }
-    return ss.str();
-}
\ No newline at end of file
+    // no index here: callers that need fleet-wide uniqueness go through a MacAllocator
+    return MacAllocator::randomMac();
+}
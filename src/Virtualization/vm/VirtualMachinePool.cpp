@@ -1,22 +1,60 @@
-#include "/home/hussin/Desktop/PenHive/include/Virtualization/vm/VirtualMachinePool.hpp"
+#include "Virtualization/vm/VirtualMachinePool.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Utils/Logger.hpp"
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <algorithm>
+#include <cstdlib>
 
-VirtualMachinePool::VirtualMachinePool(std::shared_ptr<HypervisorConnector> connector)
-    : connector(std::move(connector)), db(this->connector ? this->connector->getDB() : nullptr) {}
+VirtualMachinePool::VirtualMachinePool(std::shared_ptr<HypervisorConnector> connector,
+                                       std::uint16_t firstConsolePort,
+                                       std::uint16_t lastConsolePort)
+    : connector(std::move(connector)), db(this->connector ? this->connector->getDB() : nullptr),
+      store(db ? std::make_unique<VmMetadataStore>(db) : nullptr),
+      ports(firstConsolePort, lastConsolePort) {}
 
 VirtualMachinePool::~VirtualMachinePool() = default;
 
-Result<int> VirtualMachinePool::allocate() {
-    std::scoped_lock lock(mutex_);
-    int id = nextId++;
-    std::string uuid = generate_uuid();
-    int reservedPort = -1;
-    try { reservedPort = findAvailablePort(5900, 6000); } catch (...) { reservedPort = -1; }
-    entries.emplace(id, Entry{uuid, reservedPort});
-    // TODO: persist via db if available (use IRocksDB::Put)
-    (void)uuid; (void)reservedPort;
-    return Result<int>{id};
+Result<int> VirtualMachinePool::allocate(std::string_view name, int consolePort) {
+    auto res = allocateBatch({ std::string(name) }, { consolePort });
+    if (res.isErr()) return Result<int>{res.unwrapErr()};
+    return Result<int>{res.unwrap().front()};
+}
+
+Result<std::vector<int>> VirtualMachinePool::allocateBatch(const std::vector<std::string>& names,
+                                                           const std::vector<int>& consolePorts) {
+    // lock wait plus the RocksDB group commit
+    static auto& latency = METRICS::MetricsRegistry::global().histogram("penhive_pool_allocate_seconds",
+        "Time to allocate VM pool records (one commit per batch)");
+    METRICS::ScopedTimer timer(latency);
+    std::unique_lock lock(mutex_);
+    awaitRecovery(lock);
+    std::vector<int> ids;
+    ids.reserve(names.size());
+    VmMetadataStore::Batch batch;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        const auto& name = names[i];
+        int id = nextId++;
+        const int wanted = i < consolePorts.size() ? consolePorts[i] : kAutoConsolePort;
+        // an adopted port is already marked in the bitmap; only autoport consoles take one here
+        const int port = wanted == kAutoConsolePort ? reservePort() : wanted;
+        Entry e{generate_uuid(), port > 0 ? port : -1, name};
+        if (store) batch.put(toRecord(id, e));
+        entries.emplace(id, std::move(e));
+        ids.push_back(id);
+    }
+    if (store) {
+        batch.setNextId(nextId);
+        if (auto st = store->commit(batch); !st) {
+            // roll back the in-memory side so memory and disk stay consistent
+            for (int id : ids) {
+                releasePort(entries[id].reservedPort);
+                entries.erase(id);
+            }
+            return Result<std::vector<int>>{std::string("Failed to persist VM metadata: ") + st.error().ToString()};
+        }
+    }
+    return Result<std::vector<int>>{std::move(ids)};
 }
 
 std::optional<std::pair<std::string,int>> VirtualMachinePool::getMeta(int id) {
@@ -26,33 +64,176 @@ std::optional<std::pair<std::string,int>> VirtualMachinePool::getMeta(int id) {
     return std::make_pair(it->second.uuid, it->second.reservedPort);
 }
 
+std::optional<VmRecord> VirtualMachinePool::getRecord(int id) {
+    std::scoped_lock lock(mutex_);
+    auto it = entries.find(id);
+    if (it == entries.end()) return std::nullopt;
+    return toRecord(id, it->second);
+}
+
+std::vector<VmRecord> VirtualMachinePool::records() {
+    std::scoped_lock lock(mutex_);
+    std::vector<VmRecord> out;
+    out.reserve(entries.size());
+    for (const auto& [id, e] : entries) out.push_back(toRecord(id, e));
+    return out;
+}
+
 bool VirtualMachinePool::remove(int id) {
     std::scoped_lock lock(mutex_);
     auto it = entries.find(id);
     if (it == entries.end()) return false;
+    if (store) {
+        if (auto st = store->erase(toRecord(id, it->second)); !st) {
+            BoostLogger::Warn("VirtualMachinePool: failed to delete record " + std::to_string(id) + ": " + st.error().ToString());
+        }
+    }
+    releasePort(it->second.reservedPort);
     entries.erase(it);
-    // TODO: remove from db if available
     return true;
 }
 
+bool VirtualMachinePool::removeByName(std::string_view name) {
+    int id = -1;
+    {
+        std::scoped_lock lock(mutex_);
+        for (const auto& [key, e] : entries) {
+            if (e.name == name) {
+                id = key;
+                break;
+            }
+        }
+    }
+    return id >= 0 && remove(id);
+}
+
+int VirtualMachinePool::warmStart() {
+    if (!store) return 0;
+    auto loaded = store->loadAll();
+    std::scoped_lock lock(mutex_);
+    int maxId = 0;
+    for (auto& r : loaded) {
+        maxId = std::max(maxId, r.id);
+        if (r.consolePort > 0) (void)ports.reserve(static_cast<std::uint16_t>(r.consolePort));
+        entries.insert_or_assign(r.id, Entry{std::move(r.uuid), r.consolePort, std::move(r.name)});
+    }
+    nextId = std::max({ nextId, maxId + 1, store->loadNextId().value_or(1) });
+    return static_cast<int>(loaded.size());
+}
+
+int VirtualMachinePool::reserveConsolePort() {
+    std::unique_lock lock(mutex_);
+    awaitRecovery(lock);
+    return reservePort();
+}
+
+bool VirtualMachinePool::claimConsolePort(int port) {
+    if (port <= 0 || port > 65535) return false;
+    std::unique_lock lock(mutex_);
+    awaitRecovery(lock);
+    const auto p = static_cast<std::uint16_t>(port);
+    return !ports.contains(p) || ports.reserve(p);
+}
+
+void VirtualMachinePool::releaseConsolePort(int port) {
+    std::scoped_lock lock(mutex_);
+    releasePort(port);
+}
+
+std::optional<std::uint16_t> VirtualMachinePool::consolePort(std::string_view name) {
+    std::scoped_lock lock(mutex_);
+    for (const auto& [_, e] : entries) {
+        if (e.name == name && e.reservedPort > 0) return static_cast<std::uint16_t>(e.reservedPort);
+    }
+    return std::nullopt;
+}
+
+std::size_t VirtualMachinePool::availablePorts() {
+    std::scoped_lock lock(mutex_);
+    return ports.available();
+}
+
 std::string VirtualMachinePool::generate_uuid() {
-    boost::uuids::random_generator gen;
+    // random_generator seeds from the OS on construction; reuse one per thread
+    thread_local boost::uuids::random_generator gen;
     return boost::uuids::to_string(gen());
 }
 
-int VirtualMachinePool::findAvailablePort(int startPort, int endPort) {
-    if (startPort < 1 || endPort > 65535 || startPort > endPort) {
-        throw std::invalid_argument("Invalid port range");
+int VirtualMachinePool::reservePort() {
+    auto port = ports.reserve();
+    return port ? static_cast<int>(*port) : -1;
+}
+
+void VirtualMachinePool::releasePort(int port) {
+    if (port > 0) (void)ports.release(static_cast<std::uint16_t>(port));
+}
+
+void VirtualMachinePool::beginRecovery() {
+    std::scoped_lock lock(mutex_);
+    recovering = true;
+}
+
+void VirtualMachinePool::endRecovery() {
+    {
+        std::scoped_lock lock(mutex_);
+        recovering = false;
     }
-    boost::asio::io_context io_context;
-    for (int port = startPort; port <= endPort; ++port) {
-        boost::asio::ip::tcp::acceptor acceptor(io_context);
-        boost::system::error_code ec;
-        acceptor.open(boost::asio::ip::tcp::v4(), ec);
-        if (ec) continue;
-        acceptor.bind({boost::asio::ip::tcp::v4(), static_cast<unsigned short>(port)}, ec);
-        acceptor.close();
-        if (!ec) return port;
+    recovered.notify_all();
+}
+
+void VirtualMachinePool::awaitRecovery(std::unique_lock<std::mutex>& lock) {
+    recovered.wait(lock, [this] { return !recovering; });
+}
+
+Result<std::size_t> VirtualMachinePool::repair(const PoolRepair& drift) {
+    std::scoped_lock lock(mutex_);
+    VmMetadataStore::Batch batch;
+    std::size_t touched = 0;
+    for (int id : drift.stale) {
+        auto it = entries.find(id);
+        if (it == entries.end()) continue;
+        if (store) batch.erase(toRecord(id, it->second));
+        releasePort(it->second.reservedPort);
+        entries.erase(it);
+        ++touched;
     }
-    throw std::runtime_error("No available port");
-}
\ No newline at end of file
+    for (const auto& [id, port] : drift.ports) {
+        auto it = entries.find(id);
+        if (it == entries.end() || it->second.reservedPort == port) continue;
+        // erase first: it drops the old port/ index key, put writes the new one
+        if (store) batch.erase(toRecord(id, it->second));
+        releasePort(it->second.reservedPort);
+        if (port > 0) (void)ports.reserve(static_cast<std::uint16_t>(port));
+        it->second.reservedPort = port;
+        if (store) batch.put(toRecord(id, it->second));
+        ++touched;
+    }
+    for (const auto& r : drift.adopted) {
+        const int id = nextId++;
+        Entry e{r.uuid.empty() ? generate_uuid() : r.uuid, r.consolePort, r.name};
+        if (e.reservedPort > 0) (void)ports.reserve(static_cast<std::uint16_t>(e.reservedPort));
+        if (store) batch.put(toRecord(id, e));
+        entries.emplace(id, std::move(e));
+        ++touched;
+    }
+    // ports running domains listen on (autoport picks, domains of other tools) are never handed out
+    const auto mark = [&](int port) {
+        if (port > 0 && port <= 65535) (void)ports.reserve(static_cast<std::uint16_t>(port));
+    };
+    for (int port : drift.livePorts) mark(port);
+    Result<std::size_t> out{touched};
+    if (store && !batch.empty()) {
+        batch.setNextId(nextId);
+        // memory already holds the repaired view; a failed commit only means the next start repairs again
+        if (auto st = store->commit(batch); !st) {
+            out = Result<std::size_t>{std::string("Failed to persist VM metadata repair: ") + st.error().ToString()};
+        }
+    }
+    // port/ keys of records that did not make it into entries (a crash between the writes)
+    if (store) store->forEachPort([&](int port, int /*id*/) { mark(port); });
+    return out;
+}
+
+VmRecord VirtualMachinePool::toRecord(int id, const Entry& e) const {
+    return VmRecord{id, e.uuid, e.name, e.reservedPort};
+}
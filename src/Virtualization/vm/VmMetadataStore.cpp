@@ -0,0 +1,158 @@
+#include "Virtualization/vm/VmMetadataStore.hpp"
+#include <charconv>
+#include <cstdio>
+
+namespace {
+
+constexpr std::string_view kVmPrefix = "vm/";
+constexpr std::string_view kUuidPrefix = "uuid/";
+constexpr std::string_view kPortPrefix = "port/";
+constexpr std::string_view kNextIdKey = "meta/next_id";
+constexpr char kSep = '\x1f';
+
+rocksdb::Slice toSlice(std::string_view sv) {
+    return rocksdb::Slice(sv.data(), sv.size());
+}
+
+std::optional<int> parseInt(std::string_view sv) {
+    int value = 0;
+    auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+    if (ec != std::errc{} || ptr != sv.data() + sv.size()) return std::nullopt;
+    return value;
+}
+
+std::string encode(const VmRecord& r) {
+    std::string out;
+    out.reserve(r.uuid.size() + r.name.size() + 8);
+    out += r.uuid;
+    out += kSep;
+    out += std::to_string(r.consolePort);
+    out += kSep;
+    out += r.name;
+    return out;
+}
+
+std::optional<VmRecord> decode(int id, std::string_view v) {
+    const auto a = v.find(kSep);
+    if (a == std::string_view::npos) return std::nullopt;
+    const auto b = v.find(kSep, a + 1);
+    if (b == std::string_view::npos) return std::nullopt;
+    VmRecord r;
+    r.id = id;
+    r.uuid = std::string(v.substr(0, a));
+    r.consolePort = parseInt(v.substr(a + 1, b - a - 1)).value_or(-1);
+    r.name = std::string(v.substr(b + 1));
+    return r;
+}
+
+} // namespace
+
+std::string VmMetadataStore::vmKey(int id) {
+    char buf[24];
+    int n = std::snprintf(buf, sizeof(buf), "vm/%010d", id);
+    return std::string(buf, static_cast<std::size_t>(n));
+}
+
+std::string VmMetadataStore::uuidKey(std::string_view uuid) {
+    std::string key(kUuidPrefix);
+    key += uuid;
+    return key;
+}
+
+std::string VmMetadataStore::portKey(int port) {
+    return std::string(kPortPrefix) + std::to_string(port);
+}
+
+//
+// Batch
+//
+void VmMetadataStore::Batch::put(const VmRecord& record) {
+    const std::string id = std::to_string(record.id);
+    batch.Put(vmKey(record.id), encode(record));
+    if (!record.uuid.empty()) batch.Put(uuidKey(record.uuid), id);
+    if (record.consolePort > 0) batch.Put(portKey(record.consolePort), id);
+}
+
+void VmMetadataStore::Batch::erase(const VmRecord& record) {
+    batch.Delete(vmKey(record.id));
+    if (!record.uuid.empty()) batch.Delete(uuidKey(record.uuid));
+    if (record.consolePort > 0) batch.Delete(portKey(record.consolePort));
+}
+
+void VmMetadataStore::Batch::setNextId(int nextId) {
+    batch.Put(toSlice(kNextIdKey), std::to_string(nextId));
+}
+
+//
+// VmMetadataStore
+//
+VmMetadataStore::VmMetadataStore(std::shared_ptr<IRocksDB> db)
+    : db(std::move(db)) {}
+
+VmMetadataStore::Status VmMetadataStore::commit(Batch& batch) {
+    if (batch.empty()) return {};
+    auto res = db->Write(rocksdb::WriteOptions{}, batch.batch);
+    batch.batch.Clear();
+    return res;
+}
+
+VmMetadataStore::Status VmMetadataStore::put(const VmRecord& record) {
+    Batch b;
+    b.put(record);
+    return commit(b);
+}
+
+VmMetadataStore::Status VmMetadataStore::erase(const VmRecord& record) {
+    Batch b;
+    b.erase(record);
+    return commit(b);
+}
+
+void VmMetadataStore::scanPrefix(std::string_view prefix,
+                                 const std::function<void(std::string_view, std::string_view)>& fn) const {
+    // upper bound = prefix with its last byte incremented ("vm/" -> "vm0")
+    std::string upper(prefix);
+    upper.back() = static_cast<char>(upper.back() + 1);
+    rocksdb::Slice upperSlice(upper);
+
+    rocksdb::ReadOptions ro;
+    ro.iterate_upper_bound = &upperSlice;
+    ro.fill_cache = false; // one-shot warm-start scan
+    auto it = db->NewIterator(ro);
+    if (!it) return;
+    for (it->Seek(toSlice(prefix)); it->Valid(); it->Next()) {
+        const auto key = it->key();
+        const auto value = it->value();
+        fn(std::string_view(key.data(), key.size()), std::string_view(value.data(), value.size()));
+    }
+}
+
+std::vector<VmRecord> VmMetadataStore::loadAll() const {
+    std::vector<VmRecord> out;
+    scanPrefix(kVmPrefix, [&](std::string_view key, std::string_view value) {
+        auto id = parseInt(key.substr(kVmPrefix.size()));
+        if (!id) return;
+        if (auto r = decode(*id, value)) out.push_back(std::move(*r));
+    });
+    return out;
+}
+
+std::optional<int> VmMetadataStore::loadNextId() const {
+    auto v = db->Get(rocksdb::ReadOptions{}, kNextIdKey);
+    if (!v) return std::nullopt;
+    return parseInt(*v);
+}
+
+std::optional<int> VmMetadataStore::findIdByUuid(std::string_view uuid) const {
+    auto v = db->Get(rocksdb::ReadOptions{}, uuidKey(uuid));
+    if (!v) return std::nullopt;
+    return parseInt(*v);
+}
+
+void VmMetadataStore::forEachPort(const std::function<void(int, int)>& fn) const {
+    scanPrefix(kPortPrefix, [&](std::string_view key, std::string_view value) {
+        auto port = parseInt(key.substr(kPortPrefix.size()));
+        auto id = parseInt(value);
+        if (port && id) fn(*port, *id);
+    });
+}
@@ -0,0 +1,327 @@
+#include "Virtualization/vm/WarmPool.hpp"
+#include "Virtualization/vm/VirtualMachineNic.hpp"
+#include "Virtualization/vmm/VirtualMachineManager.hpp"
+#include "Utils/Logger.hpp"
+#include <libvirt/libvirt.h>
+#include <optional>
+
+namespace {
+
+std::string interfaceXml(NetworkConfig net) {
+    if (net.model.empty()) net.model = "virtio";
+    std::string xml;
+    VmConfig::writeInterfaceXML(xml, net);
+    return xml;
+}
+
+std::string cloneVolumeName(const std::string& instance) {
+    return instance + ".qcow2";
+}
+
+// why `request` can't take an instance of `base`; empty when it can
+std::string mismatch(const VmConfig& base, const VmConfig& request) {
+    // libvirt only renames inactive domains, and a paused one is still active
+    if (!request.name.empty()) return "named request";
+    if (!request.disks.empty()) return "request brings its own disks";
+    if (request.memory != 0 && request.memory != base.memory) return "memory differs from the template";
+    if (request.vcpus != 0 && request.vcpus != base.vcpus) return "vcpus differ from the template";
+    return {};
+}
+
+} // namespace
+
+WarmPool::WarmPool(VirtualMachineManager& manager,
+                   std::shared_ptr<HypervisorConnector> connector,
+                   std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                   std::shared_ptr<StorageOrchestrator> storage)
+    : manager(manager),
+      connector(std::move(connector)),
+      dispatcher(std::move(dispatcher)),
+      storage(std::move(storage)) {}
+
+WarmPool::~WarmPool() {
+    shutdown();
+}
+
+void WarmPool::shutdown() {
+    if (stopping.exchange(true, std::memory_order_acq_rel)) return;
+    std::vector<std::string> booting;
+    {
+        std::lock_guard lock(mutex_);
+        for (auto& [id, slot] : slots) {
+            // destroying the timers cancels pauses that have not fired yet
+            for (const auto& [name, _] : slot.booting) booting.push_back(name);
+            slot.inFlight -= static_cast<unsigned int>(slot.booting.size());
+            slot.booting.clear();
+        }
+    }
+    // unpaused guests would otherwise keep running with nobody to hand them out
+    for (const auto& name : booting) discard(name);
+}
+
+void WarmPool::registerTemplate(WarmPoolSpec spec) {
+    const std::string id = spec.templateId;
+    {
+        std::lock_guard lock(mutex_);
+        auto& slot = slots[id];
+        slot.spec = std::move(spec);
+    }
+    scheduleRefill(id);
+}
+
+void WarmPool::unregisterTemplate(std::string_view templateId) {
+    std::vector<std::string> names;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = slots.find(templateId);
+        if (it == slots.end()) return;
+        for (const auto& inst : it->second.ready) names.push_back(inst.name);
+        // booting instances go too: park() and the readiness callback find no slot and leave them alone
+        for (const auto& [name, _] : it->second.booting) names.push_back(name);
+        slots.erase(it);
+    }
+    for (const auto& name : names) discard(name);
+}
+
+std::size_t WarmPool::readyCount(std::string_view templateId) const {
+    std::lock_guard lock(mutex_);
+    auto it = slots.find(templateId);
+    return it == slots.end() ? 0 : it->second.ready.size();
+}
+
+std::string WarmPool::baseImageOf(std::string_view templateId) const {
+    std::lock_guard lock(mutex_);
+    auto it = slots.find(templateId);
+    return it == slots.end() ? std::string{} : it->second.spec.baseImage;
+}
+
+Result<WarmInstance> WarmPool::acquire(std::string_view templateId, const VmConfig& request) {
+    const std::string id(templateId);
+    std::optional<WarmInstance> picked;
+    VmConfig handed;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = slots.find(id);
+        if (it == slots.end()) return Result<WarmInstance>{std::string("Unknown warm pool template: ") + id};
+        const auto& base = it->second.spec.base;
+        if (auto why = mismatch(base, request); !why.empty()) return Result<WarmInstance>{"warm pool skipped: " + why};
+        if (!it->second.ready.empty()) {
+            // oldest first: it has been paused the longest and is the most settled
+            picked = std::move(it->second.ready.front());
+            it->second.ready.pop_front();
+            handed = base;
+        }
+    }
+    scheduleRefill(id);
+    if (!picked) return Result<WarmInstance>{std::string("warm pool empty")};
+
+    handed.name = picked->name;
+    handed.uuid.clear();
+    handed.networks = request.networks;
+    for (const auto& [key, value] : request.metadata) handed.metadata[key] = value;
+    handed.metadata.try_emplace("template", id);
+    // handout NICs get the template's network profile, like the NICs of a cold deploy
+    if (auto profile = handed.metadata.find("netProfile"); profile != handed.metadata.end()) {
+        if (const NetProfile* p = VmConfig::findNetProfile(profile->second)) {
+            for (auto& n : handed.networks) VmConfig::applyNetProfile(n, *p, handed.vcpus);
+        }
+    }
+
+    // the instance is ours alone from the pop on: every failure past it deletes it
+    bool ok = false;
+    try {
+        auto lease = connector->acquire();
+        if (virDomainPtr domain = virDomainLookupByName(lease.get(), picked->name.c_str())) {
+            ok = virDomainResume(domain) == 0 && rewire(domain, *picked, handed.networks);
+            virDomainFree(domain);
+        }
+    } catch (const std::exception& e) {
+        BoostLogger::Warn("WarmPool: handout of " + picked->name + " failed: " + e.what());
+    }
+    if (!ok) {
+        discard(picked->name);
+        return Result<WarmInstance>{std::string("Failed to hand out warm instance: ") + picked->name};
+    }
+
+    picked->config = std::move(handed);
+    BoostLogger::Info("WarmPool: handed out " + picked->name);
+    return Result<WarmInstance>{std::move(*picked)};
+}
+
+bool WarmPool::rewire(virDomainPtr domain, const WarmInstance& inst, const std::vector<NetworkConfig>& networks) {
+    constexpr unsigned int flags = VIR_DOMAIN_AFFECT_LIVE | VIR_DOMAIN_AFFECT_CONFIG;
+    if (!inst.parkingMac.empty()) {
+        // libvirt matches the device to detach by MAC
+        VirtualMachineNic parking(inst.parkingMac);
+        if (!parking.detach(domain)) return false;
+    }
+    for (const auto& net : networks) {
+        const std::string xml = interfaceXml(net);
+        if (virDomainAttachDeviceFlags(domain, xml.c_str(), flags) != 0) return false;
+    }
+    return true;
+}
+
+void WarmPool::scheduleRefill(const std::string& templateId) {
+    if (stopping.load(std::memory_order_acquire)) return;
+    unsigned int missing = 0;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = slots.find(templateId);
+        if (it == slots.end()) return;
+        auto& slot = it->second;
+        const auto have = static_cast<unsigned int>(slot.ready.size()) + slot.inFlight;
+        if (have >= slot.spec.targetSize) return;
+        missing = slot.spec.targetSize - have;
+        slot.inFlight += missing;
+    }
+    for (unsigned int i = 0; i < missing; ++i) {
+        // refills yield to interactive work on the same lane
+        dispatcher->dispatch(CONCURRENCY::Priority::Background, std::nullopt, [this, templateId] { refillOne(templateId); },
+                             CONCURRENCY::Lane::Blocking);
+    }
+}
+
+void WarmPool::refillOne(const std::string& templateId) {
+    WarmPoolSpec spec;
+    std::string name;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = slots.find(templateId);
+        if (it == slots.end()) return;
+        if (stopping.load(std::memory_order_acquire)) {
+            --it->second.inFlight;
+            return;
+        }
+        spec = it->second.spec;
+        name = templateId + "-warm-" + std::to_string(++it->second.sequence);
+    }
+
+    auto res = provision(spec, name);
+    if (res.isErr()) {
+        BoostLogger::Warn("WarmPool: refill of " + templateId + " failed: " + res.unwrapErr());
+        std::lock_guard lock(mutex_);
+        if (auto it = slots.find(templateId); it != slots.end()) --it->second.inFlight;
+        // no retry loop here: the next acquire() schedules another attempt
+        return;
+    }
+
+    WarmInstance inst = std::move(res).unwrap();
+    auto prober = manager.getReadinessProber();
+    std::unique_lock lock(mutex_);
+    auto it = slots.find(templateId);
+    if (it == slots.end() || stopping.load(std::memory_order_acquire)) {
+        // unregistered or shut down while the instance was being deployed: nobody else knows about it
+        if (it != slots.end()) --it->second.inFlight;
+        lock.unlock();
+        discard(name);
+        return;
+    }
+    if (prober && !spec.readiness.empty()) {
+        it->second.booting[name] = nullptr;
+        lock.unlock();
+        prober->watch(name, "warm/" + templateId, spec.readiness, [this, templateId, inst](const ReadinessStatus& status) {
+            {
+                std::lock_guard lock(mutex_);
+                auto it = slots.find(templateId);
+                // unregisterTemplate() or shutdown() already took the booting entry, and deleted the instance
+                if (it == slots.end() || !it->second.booting.count(inst.name)) return;
+                if (status.state != ReadinessState::Ready) {
+                    it->second.booting.erase(inst.name);
+                    --it->second.inFlight;
+                }
+            }
+            // off the prober's thread: discard() ends in deleteDomain(), which calls back into the prober
+            if (status.state == ReadinessState::Ready) {
+                dispatcher->dispatch(CONCURRENCY::Lane::Blocking, [this, templateId, inst] { park(templateId, inst); });
+                return;
+            }
+            BoostLogger::Warn("WarmPool: " + inst.name + " never got ready (" + status.detail + "), discarding");
+            // no retry loop here either: the next acquire() schedules another attempt
+            dispatcher->dispatch(CONCURRENCY::Lane::Blocking, [this, name = inst.name] { discard(name); });
+        });
+        return;
+    }
+    // the pause is dispatched rather than run inline so the timer is never destroyed inside its own callback
+    it->second.booting[name] = dispatcher->dispatch_delayed(spec.bootGrace, [this, templateId, inst] {
+        dispatcher->dispatch(CONCURRENCY::Lane::Blocking, [this, templateId, inst] { park(templateId, inst); });
+    });
+}
+
+void WarmPool::park(const std::string& templateId, WarmInstance inst) {
+    {
+        std::lock_guard lock(mutex_);
+        auto it = slots.find(templateId);
+        // shutdown() (or unregisterTemplate) already took the instance and its inFlight count
+        if (it == slots.end() || !it->second.booting.erase(inst.name)) return;
+    }
+
+    bool paused = false;
+    try {
+        auto lease = connector->acquire();
+        if (virDomainPtr domain = virDomainLookupByName(lease.get(), inst.name.c_str())) {
+            paused = virDomainSuspend(domain) == 0;
+            virDomainFree(domain);
+        }
+    } catch (const std::exception& e) {
+        BoostLogger::Warn("WarmPool: pausing " + inst.name + ": " + e.what());
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        auto it = slots.find(templateId);
+        if (it != slots.end()) {
+            --it->second.inFlight;
+            if (paused) {
+                inst.readyAt = std::chrono::steady_clock::now();
+                it->second.ready.push_back(std::move(inst));
+                return;
+            }
+        }
+    }
+    // a running instance nobody can hand out only burns memory
+    if (!paused) BoostLogger::Warn("WarmPool: failed to pause " + inst.name + ", discarding");
+    discard(inst.name);
+}
+
+Result<WarmInstance> WarmPool::provision(const WarmPoolSpec& spec, const std::string& name) {
+    VmConfig cfg = spec.base;
+    cfg.name = name;
+    cfg.uuid.clear();
+
+    if (storage && !spec.baseImage.empty()) {
+        auto clone = storage->createLinkedClone(spec.baseImage, name);
+        if (clone.isErr()) return Result<WarmInstance>{clone.unwrapErr()};
+        if (cfg.disks.empty()) {
+            auto& disk = cfg.disks.emplace_back();
+            disk.type = "file";
+            disk.device = "disk";
+            disk.target = "vda";
+        }
+        cfg.disks.front().source = std::move(clone).unwrap();
+        cfg.disks.front().driver = "qcow2";
+    }
+
+    // warm instances boot on an isolated parking network; real NICs are wired at handout
+    VirtualMachineNic parking;
+    NetworkConfig parkingNic = parking.config();
+    parkingNic.source = spec.parkingNetwork;
+    cfg.networks = {std::move(parkingNic)};
+
+    auto deployed = manager.dispatch_deploy(cfg);
+    if (deployed.isErr()) {
+        if (storage && !spec.baseImage.empty()) (void)storage->deleteVolume(cloneVolumeName(name));
+        return Result<WarmInstance>{deployed.unwrapErr()};
+    }
+
+    WarmInstance inst;
+    inst.name = name;
+    inst.id = deployed.unwrap();
+    inst.parkingMac = parking.getMac();
+    return Result<WarmInstance>{std::move(inst)};
+}
+
+void WarmPool::discard(const std::string& name) {
+    (void)manager.deleteDomain(name, false);
+    if (storage) (void)storage->deleteVolume(cloneVolumeName(name));
+}
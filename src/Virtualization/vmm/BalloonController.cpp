@@ -0,0 +1,159 @@
+#include "Virtualization/vmm/BalloonController.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <libvirt/libvirt.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+BalloonSample sampleOf(virDomainStatsRecordPtr rec) {
+    BalloonSample s;
+    unsigned long long v = 0;
+    if (virTypedParamsGetULLong(rec->params, rec->nparams, "balloon.current", &v) == 1) s.currentKiB = v;
+    if (virTypedParamsGetULLong(rec->params, rec->nparams, "balloon.maximum", &v) == 1) s.maximumKiB = v;
+    // usable (guest 4.x+) counts page cache the guest can drop; unused is the fallback
+    if (virTypedParamsGetULLong(rec->params, rec->nparams, "balloon.usable", &v) == 1
+        || virTypedParamsGetULLong(rec->params, rec->nparams, "balloon.unused", &v) == 1) {
+        s.usableKiB = v;
+        s.hasGuestStats = true;
+    }
+    return s;
+}
+
+} // namespace
+
+BalloonController::BalloonController(std::shared_ptr<HypervisorConnector> connector, BalloonPolicy policy)
+    : connector(std::move(connector)), policy_(policy) {}
+
+BalloonController::~BalloonController() {
+    stop();
+}
+
+void BalloonController::start(CONCURRENCY::TimerWheel& wheel, std::chrono::seconds interval) {
+    stop();
+    auto flag = std::make_shared<std::atomic<bool>>(false);
+    {
+        std::lock_guard lock(mutex_);
+        cancelFlag = flag;
+    }
+    CONCURRENCY::WheelJobOptions opts;
+    opts.lane = CONCURRENCY::Lane::Blocking;
+    opts.cancelFlag = flag;
+    (void)wheel.schedule_every(interval, [weak = weak_from_this()]() {
+        auto self = weak.lock();
+        if (!self) return;
+        auto res = self->runOnce();
+        if (res.isErr()) BoostLogger::Warn("BalloonController: " + res.unwrapErr());
+    }, std::move(opts));
+}
+
+void BalloonController::stop() noexcept {
+    std::lock_guard lock(mutex_);
+    if (cancelFlag) cancelFlag->store(true);
+    cancelFlag.reset();
+}
+
+void BalloonController::setPolicy(const BalloonPolicy& policy) {
+    std::lock_guard lock(mutex_);
+    policy_ = policy;
+}
+
+BalloonPolicy BalloonController::getPolicy() const {
+    std::lock_guard lock(mutex_);
+    return policy_;
+}
+
+BalloonPassStats BalloonController::lastPass() const {
+    std::lock_guard lock(mutex_);
+    return last;
+}
+
+std::optional<std::uint64_t> BalloonController::target(const BalloonSample& s, const BalloonPolicy& p) {
+    if (!s.hasGuestStats || s.maximumKiB == 0 || s.currentKiB == 0) return std::nullopt;
+    const auto max = static_cast<double>(s.maximumKiB);
+    const std::uint64_t usable = std::min(s.usableKiB, s.currentKiB);
+    const std::uint64_t used = s.currentKiB - usable;
+
+    std::uint64_t next;
+    if (static_cast<double>(usable) < p.growBelow * static_cast<double>(s.currentKiB)) {
+        next = s.maximumKiB; // under pressure: deflate completely instead of creeping up
+    } else {
+        const auto withHeadroom = static_cast<std::uint64_t>(static_cast<double>(used) * (1.0 + p.headroom));
+        std::uint64_t want = std::max(withHeadroom, used + p.minFreeKiB);
+        want = std::clamp(want, std::min(static_cast<std::uint64_t>(max * p.floorFraction), s.maximumKiB), s.maximumKiB);
+        if (want < s.currentKiB) {
+            const auto step = static_cast<std::uint64_t>(max * p.shrinkStep);
+            next = std::max(want, s.currentKiB > step ? s.currentKiB - step : 0);
+        } else {
+            next = want;
+        }
+    }
+    const std::uint64_t diff = next > s.currentKiB ? next - s.currentKiB : s.currentKiB - next;
+    if (diff < p.hysteresisKiB) return std::nullopt;
+    return next;
+}
+
+Result<BalloonPassStats> BalloonController::runOnce() {
+    const auto t0 = Clock::now();
+    const BalloonPolicy policy = getPolicy();
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception& e) {
+        return Result<BalloonPassStats>{std::string("Not connected: ") + e.what()};
+    }
+
+    virDomainStatsRecordPtr* records = nullptr;
+    const int n = virConnectGetAllDomainStats(lease.get(), VIR_DOMAIN_STATS_BALLOON, &records, VIR_CONNECT_GET_ALL_DOMAINS_STATS_RUNNING);
+    if (n < 0) {
+        virErrorPtr err = virGetLastError();
+        return Result<BalloonPassStats>{std::string("virConnectGetAllDomainStats failed: ") + (err && err->message ? err->message : "unknown")};
+    }
+
+    BalloonPassStats pass;
+    pass.domains = static_cast<std::size_t>(n);
+    std::unordered_set<std::string> seen;
+    for (int i = 0; i < n; ++i) {
+        virDomainStatsRecordPtr rec = records[i];
+        const char* rawName = virDomainGetName(rec->dom);
+        const std::string name = rawName ? rawName : "";
+        seen.insert(name);
+        const BalloonSample sample = sampleOf(rec);
+        if (!sample.hasGuestStats) {
+            // domains defined before memballoon had a stats period: ask once per run of the domain
+            if (policy.statsPeriod > 0) {
+                bool first;
+                {
+                    std::lock_guard lock(mutex_);
+                    first = statsRequested.insert(name).second;
+                }
+                if (first) (void)virDomainSetMemoryStatsPeriod(rec->dom, static_cast<int>(policy.statsPeriod), VIR_DOMAIN_AFFECT_LIVE);
+            }
+            pass.reclaimedKiB += sample.maximumKiB - std::min(sample.currentKiB, sample.maximumKiB);
+            continue;
+        }
+        ++pass.withGuestStats;
+        std::uint64_t after = sample.currentKiB;
+        if (auto next = target(sample, policy)) {
+            if (virDomainSetMemoryFlags(rec->dom, static_cast<unsigned long>(*next), VIR_DOMAIN_AFFECT_LIVE) == 0) {
+                (*next < sample.currentKiB ? pass.shrunk : pass.grown) += 1;
+                after = *next;
+            } else {
+                ++pass.failed;
+            }
+        }
+        pass.reclaimedKiB += sample.maximumKiB - std::min(after, sample.maximumKiB);
+    }
+    virDomainStatsRecordListFree(records);
+
+    pass.took = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0);
+    {
+        std::lock_guard lock(mutex_);
+        // a domain that stopped loses its live stats period; forget it so the next run asks again
+        std::erase_if(statsRequested, [&](const std::string& name) { return !seen.count(name); });
+        last = pass;
+    }
+    return Result<BalloonPassStats>{pass};
+}
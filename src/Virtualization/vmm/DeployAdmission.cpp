@@ -0,0 +1,281 @@
+#include "Virtualization/vmm/DeployAdmission.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// weight of the newest deploy in the moving average
+constexpr double kDeployTimeAlpha = 0.2;
+constexpr long long kMaxRetryAfterSeconds = 3600;
+
+METRICS::Counter& decisions(std::string_view result) {
+    return METRICS::MetricsRegistry::global().counter("penhive_deploy_admission_total",
+        "Deploy admission decisions by result", {{"result", std::string(result)}});
+}
+
+std::string_view resultOf(AdmissionRejection::Reason reason) {
+    switch (reason) {
+        case AdmissionRejection::Reason::TenantQueueFull: return "tenant_queue_full";
+        case AdmissionRejection::Reason::TenantOverBudget: return "tenant_over_budget";
+        case AdmissionRejection::Reason::HostQueueFull: return "host_queue_full";
+        case AdmissionRejection::Reason::HostFull: return "host_full";
+    }
+    return "rejected";
+}
+
+} // namespace
+
+DeployAdmission::Ticket::Ticket(Ticket&& other) noexcept
+    : owner(std::exchange(other.owner, nullptr)), tenant_(std::move(other.tenant_)),
+      vcpus(other.vcpus), memoryKiB(other.memoryKiB) {}
+
+DeployAdmission::Ticket& DeployAdmission::Ticket::operator=(Ticket&& other) noexcept {
+    if (this != &other) {
+        if (owner) owner->drop(*this);
+        owner = std::exchange(other.owner, nullptr);
+        tenant_ = std::move(other.tenant_);
+        vcpus = other.vcpus;
+        memoryKiB = other.memoryKiB;
+    }
+    return *this;
+}
+
+DeployAdmission::Ticket::~Ticket() {
+    if (owner) owner->drop(*this);
+}
+
+DeployAdmission::DeployAdmission(std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher, AdmissionOptions options)
+    : dispatcher_(std::move(dispatcher)), opts(std::move(options)),
+      deployMs(static_cast<double>(opts.initialDeployTime.count()))
+{
+    opts.maxInFlight = std::max(opts.maxInFlight, 1u);
+    auto& registry = METRICS::MetricsRegistry::global();
+    gaugeIds.push_back(registry.gaugeFn("penhive_deploy_admission_in_flight", "Deploys holding a define/start slot", {},
+        [this] { return static_cast<double>(stats().inFlight); }));
+    gaugeIds.push_back(registry.gaugeFn("penhive_deploy_admission_queued", "Deploys admitted and waiting for a slot", {},
+        [this] { return static_cast<double>(stats().queued); }));
+}
+
+DeployAdmission::~DeployAdmission() {
+    for (auto id : gaugeIds) METRICS::MetricsRegistry::global().removeGauge(id);
+    // queued work that never got a slot: its tickets must not call back into us
+    std::lock_guard lock(mutex_);
+    for (auto& [name, tenant] : tenants) {
+        for (auto& pending : tenant.queue) pending.ticket.owner = nullptr;
+    }
+}
+
+void DeployAdmission::setCapacitySources(std::shared_ptr<PlacementEngine> engine, std::shared_ptr<LabSliceManager> labSlices) {
+    std::atomic_store(&placement, std::move(engine));
+    std::atomic_store(&slices, std::move(labSlices));
+}
+
+std::string DeployAdmission::tenantOf(const VmConfig& cfg) {
+    return LabSliceManager::labOf(cfg).value_or(std::string());
+}
+
+Result<DeployAdmission::Ticket, AdmissionRejection> DeployAdmission::admit(const VmConfig& cfg) {
+    using R = Result<Ticket, AdmissionRejection>;
+    const std::string tenant = tenantOf(cfg);
+    if (auto rejection = check(cfg, tenant)) {
+        decisions(resultOf(rejection->reason)).inc();
+        return R{Err{std::move(*rejection)}};
+    }
+    decisions("admitted").inc();
+    Ticket ticket;
+    ticket.owner = this;
+    ticket.tenant_ = tenant;
+    ticket.vcpus = cfg.vcpus;
+    ticket.memoryKiB = cfg.memory;
+    return R{std::move(ticket)};
+}
+
+std::optional<AdmissionRejection> DeployAdmission::check(const VmConfig& cfg, const std::string& tenant) {
+    // capacity is read before taking the lock: cgroup reads are syscalls
+    std::optional<PlacementHeadroom> room;
+    if (auto engine = std::atomic_load(&placement)) room = engine->headroom();
+    std::optional<std::uint64_t> labRoom;
+    if (auto labSlices = std::atomic_load(&slices); labSlices && !tenant.empty()) labRoom = labSlices->memoryRoom(tenant);
+
+    std::lock_guard lock(mutex_);
+    auto reject = [&](AdmissionRejection::Reason reason, std::chrono::seconds retryAfter, std::string message) {
+        ++rejectedTotal;
+        return std::optional<AdmissionRejection>{AdmissionRejection{reason, retryAfter, std::move(message)}};
+    };
+    // when our own unfinished deploys are what is missing, the wait is for them; otherwise for a delete
+    auto capacityRetry = [&](bool fitsWithoutPending) {
+        return fitsWithoutPending ? estimate(queued + inFlight) : opts.capacityRetry;
+    };
+
+    auto it = tenants.find(tenant);
+    const std::size_t mine = it == tenants.end() ? 0 : it->second.admitted;
+    if (mine >= opts.maxQueuedPerTenant) {
+        // round-robin: each tenant ahead takes one slot per turn of ours
+        const auto ahead = mine * std::max<std::size_t>(turns.size(), 1) + inFlight;
+        return reject(AdmissionRejection::Reason::TenantQueueFull, estimate(ahead),
+                      "Too many deploys queued for " + (tenant.empty() ? std::string("VMs outside labs") : "lab " + tenant));
+    }
+    if (queued >= opts.maxQueued) {
+        return reject(AdmissionRejection::Reason::HostQueueFull, estimate(queued + inFlight), "Deploy queue of this host is full");
+    }
+    if (room) {
+        const bool vcpusFit = cfg.vcpus <= room->vcpus;
+        const bool memoryFits = cfg.memory <= room->memoryKiB;
+        if (cfg.vcpus + pendingVcpus > room->vcpus || cfg.memory + pendingMemoryKiB > room->memoryKiB) {
+            return reject(AdmissionRejection::Reason::HostFull, capacityRetry(vcpusFit && memoryFits),
+                          "Host has no room for " + std::to_string(cfg.vcpus) + " vCPUs and "
+                          + std::to_string(cfg.memory / 1024) + " MiB");
+        }
+    }
+    if (labRoom) {
+        const unsigned long long labPending = it == tenants.end() ? 0 : it->second.memoryKiB;
+        if ((cfg.memory + labPending) * 1024 > *labRoom) {
+            return reject(AdmissionRejection::Reason::TenantOverBudget, capacityRetry(cfg.memory * 1024 <= *labRoom),
+                          "Lab " + tenant + " would exceed its memory limit");
+        }
+    }
+
+    auto& entry = tenants[tenant];
+    ++entry.admitted;
+    entry.memoryKiB += cfg.memory;
+    ++queued;
+    pendingVcpus += cfg.vcpus;
+    pendingMemoryKiB += cfg.memory;
+    ++admittedTotal;
+    return std::nullopt;
+}
+
+std::chrono::seconds DeployAdmission::estimate(std::size_t ahead) const {
+    const double rounds = static_cast<double>(ahead / opts.maxInFlight) + 1.0;
+    const auto seconds = static_cast<long long>(std::ceil(rounds * deployMs / 1000.0));
+    return std::chrono::seconds(std::clamp(seconds, 1LL, kMaxRetryAfterSeconds));
+}
+
+void DeployAdmission::start(Ticket ticket, Work work) {
+    if (!ticket) {
+        // not admitted here (no admission at the time): runs unqueued
+        dispatcher_->dispatch(CONCURRENCY::Lane::Blocking, std::move(work));
+        return;
+    }
+    std::vector<Pending> runnable;
+    {
+        std::lock_guard lock(mutex_);
+        auto& entry = tenants[ticket.tenant()];
+        if (entry.queue.empty()) turns.push_back(ticket.tenant());
+        entry.queue.push_back(Pending{std::move(ticket), std::move(work), TRACING::TraceContext::current()});
+        runnable = takeRunnable();
+    }
+    launch(std::move(runnable));
+}
+
+void DeployAdmission::run(Ticket ticket, const Work& work) {
+    if (!ticket) {
+        work();
+        return;
+    }
+    {
+        std::lock_guard lock(mutex_);
+        auto& entry = tenants[ticket.tenant()];
+        --entry.admitted;
+        --queued;
+        ++inFlight;
+    }
+    const std::string tenant = ticket.tenant();
+    const unsigned int vcpus = ticket.vcpus;
+    const unsigned long long memoryKiB = ticket.memoryKiB;
+    ticket.owner = nullptr;
+    const auto t0 = std::chrono::steady_clock::now();
+    try {
+        work();
+    } catch (...) {
+        finished(tenant, vcpus, memoryKiB, std::chrono::steady_clock::now() - t0);
+        throw;
+    }
+    finished(tenant, vcpus, memoryKiB, std::chrono::steady_clock::now() - t0);
+}
+
+std::vector<DeployAdmission::Pending> DeployAdmission::takeRunnable() {
+    std::vector<Pending> out;
+    while (inFlight < opts.maxInFlight && !turns.empty()) {
+        const std::string name = std::move(turns.front());
+        turns.pop_front();
+        auto& entry = tenants[name];
+        if (entry.queue.empty()) continue;
+        out.push_back(std::move(entry.queue.front()));
+        entry.queue.pop_front();
+        if (!entry.queue.empty()) turns.push_back(name);
+        --entry.admitted;
+        --queued;
+        ++inFlight;
+    }
+    return out;
+}
+
+void DeployAdmission::launch(std::vector<Pending> runnable) {
+    for (auto& pending : runnable) {
+        Ticket& ticket = pending.ticket;
+        ticket.owner = nullptr; // the slot is taken; finished() gives the demand back
+        dispatcher_->dispatch(CONCURRENCY::Lane::Blocking,
+            [this, tenant = ticket.tenant(), vcpus = ticket.vcpus, memoryKiB = ticket.memoryKiB,
+             work = std::move(pending.work), trace = pending.trace] {
+                TRACING::ContextScope scope(trace);
+                const auto t0 = std::chrono::steady_clock::now();
+                try {
+                    work();
+                } catch (const std::exception& e) {
+                    BoostLogger::Warn(std::string("Admitted deploy threw: ") + e.what());
+                } catch (...) {
+                    BoostLogger::Warn("Admitted deploy threw an unknown exception");
+                }
+                finished(tenant, vcpus, memoryKiB, std::chrono::steady_clock::now() - t0);
+            });
+    }
+}
+
+void DeployAdmission::finished(const std::string& tenant, unsigned int vcpus, unsigned long long memoryKiB,
+                               std::chrono::steady_clock::duration took) {
+    std::vector<Pending> runnable;
+    {
+        std::lock_guard lock(mutex_);
+        --inFlight;
+        pendingVcpus -= std::min<unsigned long long>(pendingVcpus, vcpus);
+        pendingMemoryKiB -= std::min(pendingMemoryKiB, memoryKiB);
+        if (auto it = tenants.find(tenant); it != tenants.end()) {
+            it->second.memoryKiB -= std::min(it->second.memoryKiB, memoryKiB);
+            if (idle(it->second)) tenants.erase(it);
+        }
+        const double ms = std::chrono::duration<double, std::milli>(took).count();
+        deployMs += kDeployTimeAlpha * (ms - deployMs);
+        runnable = takeRunnable();
+    }
+    launch(std::move(runnable));
+}
+
+void DeployAdmission::drop(Ticket& ticket) noexcept {
+    std::lock_guard lock(mutex_);
+    ticket.owner = nullptr;
+    --queued;
+    pendingVcpus -= std::min<unsigned long long>(pendingVcpus, ticket.vcpus);
+    pendingMemoryKiB -= std::min(pendingMemoryKiB, ticket.memoryKiB);
+    auto it = tenants.find(ticket.tenant_);
+    if (it == tenants.end()) return;
+    auto& entry = it->second;
+    if (entry.admitted > 0) --entry.admitted;
+    entry.memoryKiB -= std::min(entry.memoryKiB, ticket.memoryKiB);
+    if (idle(entry)) tenants.erase(it);
+}
+
+AdmissionStats DeployAdmission::stats() const {
+    std::lock_guard lock(mutex_);
+    AdmissionStats out;
+    out.inFlight = inFlight;
+    out.queued = queued;
+    out.tenants = turns.size();
+    out.admitted = admittedTotal;
+    out.rejected = rejectedTotal;
+    out.deployTime = std::chrono::milliseconds(static_cast<long long>(deployMs));
+    return out;
+}
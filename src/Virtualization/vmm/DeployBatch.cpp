@@ -0,0 +1,29 @@
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <string_view>
+
+std::size_t DeployBatchResult::succeeded() const noexcept {
+    return static_cast<std::size_t>(std::count_if(outcomes.begin(), outcomes.end(),
+        [](const DeployOutcome& o) { return o.ok(); }));
+}
+
+std::size_t DeployBatchResult::failed() const noexcept {
+    return outcomes.size() - succeeded();
+}
+
+unsigned int deployWaveOf(const VmConfig& cfg) noexcept {
+    if (auto it = cfg.metadata.find("wave"); it != cfg.metadata.end()) {
+        unsigned int wave = 0;
+        const auto& v = it->second;
+        auto [ptr, ec] = std::from_chars(v.data(), v.data() + v.size(), wave);
+        if (ec == std::errc{} && ptr == v.data() + v.size()) return wave;
+    }
+
+    static constexpr std::array<std::string_view, 5> infraRoles{ "router", "switch", "firewall", "dhcp", "dns" };
+    if (auto it = cfg.metadata.find("role"); it != cfg.metadata.end()) {
+        if (std::find(infraRoles.begin(), infraRoles.end(), it->second) != infraRoles.end()) return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,100 @@
+#include "Virtualization/vmm/DomainRegistry.hpp"
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+DomainRegistry::DomainRegistry(std::size_t shards)
+    : byName(std::max<std::size_t>(shards, 1)), byUuid(std::max<std::size_t>(shards, 1)) {}
+
+DomainRegistry::Shard& DomainRegistry::shardOf(std::vector<Shard>& shards, std::string_view key) const noexcept {
+    return shards[KeyHash{}(key) % shards.size()];
+}
+
+const DomainRegistry::Shard& DomainRegistry::shardOf(const std::vector<Shard>& shards, std::string_view key) const noexcept {
+    return shards[KeyHash{}(key) % shards.size()];
+}
+
+DomainHandlePtr DomainRegistry::lookup(const std::vector<Shard>& shards, std::string_view key) const {
+    const auto& shard = shardOf(shards, key);
+    std::shared_lock lock(shard.mutex_);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second;
+}
+
+DomainHandlePtr DomainRegistry::find(std::string_view name) const {
+    return lookup(byName, name);
+}
+
+DomainHandlePtr DomainRegistry::findByUuid(std::string_view uuid) const {
+    return lookup(byUuid, uuid);
+}
+
+DomainHandlePtr DomainRegistry::insert(virDomainPtr domain) {
+    if (!domain) return nullptr;
+    // both are cached in the virDomain object: no round trip to libvirtd
+    const char* name = virDomainGetName(domain);
+    char uuid[VIR_UUID_STRING_BUFLEN] = {};
+    if (!name || virDomainGetUUIDString(domain, uuid) < 0) return nullptr;
+    if (virDomainRef(domain) < 0) return nullptr;
+    auto handle = std::make_shared<const DomainHandle>(domain, name, uuid);
+
+    // one shard lock at a time: a reader may briefly find a name without its uuid, never a deadlock
+    DomainHandlePtr previous;
+    {
+        auto& shard = shardOf(byName, handle->name());
+        std::unique_lock lock(shard.mutex_);
+        auto [it, inserted] = shard.entries.try_emplace(handle->name(), handle);
+        if (inserted) {
+            count.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            previous = std::exchange(it->second, handle);
+        }
+    }
+    // a name redefined with a new uuid leaves no stale uuid entry behind
+    if (previous && previous->uuid() != handle->uuid()) {
+        auto& shard = shardOf(byUuid, previous->uuid());
+        std::unique_lock lock(shard.mutex_);
+        if (auto it = shard.entries.find(previous->uuid()); it != shard.entries.end() && it->second == previous) shard.entries.erase(it);
+    }
+    {
+        auto& shard = shardOf(byUuid, handle->uuid());
+        std::unique_lock lock(shard.mutex_);
+        shard.entries.insert_or_assign(handle->uuid(), handle);
+    }
+    return handle;
+}
+
+void DomainRegistry::erase(std::string_view name) {
+    DomainHandlePtr removed;
+    {
+        auto& shard = shardOf(byName, name);
+        std::unique_lock lock(shard.mutex_);
+        auto it = shard.entries.find(name);
+        if (it == shard.entries.end()) return;
+        removed = std::move(it->second);
+        shard.entries.erase(it);
+        count.fetch_sub(1, std::memory_order_relaxed);
+    }
+    auto& shard = shardOf(byUuid, removed->uuid());
+    std::unique_lock lock(shard.mutex_);
+    if (auto it = shard.entries.find(removed->uuid()); it != shard.entries.end() && it->second == removed) shard.entries.erase(it);
+    // removed drops its libvirt reference here, or when the last reader lets go of it
+}
+
+void DomainRegistry::clear() {
+    for (auto* shards : {&byName, &byUuid}) {
+        for (auto& shard : *shards) {
+            Map dropped;
+            {
+                std::unique_lock lock(shard.mutex_);
+                dropped.swap(shard.entries);
+            }
+        }
+    }
+    count.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,458 @@
+#include "Virtualization/vmm/DomainStateCache.hpp"
+#include "Virtualization/vmm/DomainSummary.hpp"
+#include "Virtualization/Utils/VmException.hpp"
+#include "Utils/Logger.hpp"
+#include <libvirt/virterror.h>
+#include <thread>
+#include <unordered_set>
+
+namespace {
+
+// keepalive gives up after 5 s x 3 probes; retrying faster would only fail the same way
+constexpr auto kReconnectDelay = std::chrono::seconds(5);
+
+// libvirt يتطلب event loop واحد على مستوى العملية، ويجب تسجيله قبل فتح أي اتصال يستقبل أحداثًا
+struct EventLoop {
+    std::mutex mutex;
+    std::thread thread;
+    std::atomic<bool> quit{false};
+    std::size_t users{0};
+};
+
+EventLoop& eventLoop() {
+    static EventLoop loop;
+    return loop;
+}
+
+void registerEventImpl() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        if (virEventRegisterDefaultImpl() < 0) {
+            virErrorPtr e = virGetLastError();
+            throw LibvirtException(std::string("virEventRegisterDefaultImpl failed: ") + (e && e->message ? e->message : "unknown"));
+        }
+    });
+}
+
+// the first user starts the loop thread
+void acquireEventLoop() {
+    registerEventImpl();
+    auto& loop = eventLoop();
+    std::scoped_lock lk(loop.mutex);
+    if (loop.users++ > 0) return;
+    loop.quit.store(false);
+    loop.thread = std::thread([&loop] {
+        while (!loop.quit.load()) {
+            if (virEventRunDefaultImpl() < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+    });
+}
+
+// the last user stops it: a zero timeout wakes virEventRunDefaultImpl so the thread sees quit
+void releaseEventLoop() noexcept {
+    auto& loop = eventLoop();
+    std::scoped_lock lk(loop.mutex);
+    if (loop.users == 0 || --loop.users > 0) return;
+    loop.quit.store(true);
+    const int wake = virEventAddTimeout(0, [](int timer, void*) { virEventRemoveTimeout(timer); }, nullptr, nullptr);
+    if (loop.thread.joinable()) {
+        // without the wake-up timer the thread would block until the next event; leave it rather than hang
+        if (wake >= 0) loop.thread.join();
+        else loop.thread.detach();
+    }
+}
+
+std::string domainUuid(virDomainPtr dom) {
+    char buf[VIR_UUID_STRING_BUFLEN] = {};
+    if (virDomainGetUUIDString(dom, buf) < 0) return {};
+    return buf;
+}
+
+// Translate a lifecycle event into the state the domain is in afterwards
+std::optional<VirtualMachine::VmState> stateAfterEvent(int event) {
+    using S = VirtualMachine::VmState;
+    switch (event) {
+        case VIR_DOMAIN_EVENT_STARTED: return S::Running;
+        case VIR_DOMAIN_EVENT_SUSPENDED: return S::Paused;
+        case VIR_DOMAIN_EVENT_RESUMED: return S::Running;
+        case VIR_DOMAIN_EVENT_STOPPED: return S::Shutdown;
+        case VIR_DOMAIN_EVENT_PMSUSPENDED: return S::Suspended;
+        case VIR_DOMAIN_EVENT_CRASHED: return S::Crashed;
+        // DEFINED doesn't change a known domain's state (handled by the caller);
+        // SHUTDOWN: guest is still running until STOPPED arrives
+        default: return std::nullopt;
+    }
+}
+
+// Event details and virDomainGetState reasons are separate enums; map the detail to the
+// reason virDomainGetState would report afterwards so reconcile and events agree
+int reasonAfterEvent(int event, int detail) {
+    switch (event) {
+        case VIR_DOMAIN_EVENT_STARTED:
+            switch (detail) {
+                case VIR_DOMAIN_EVENT_STARTED_BOOTED: return VIR_DOMAIN_RUNNING_BOOTED;
+                case VIR_DOMAIN_EVENT_STARTED_MIGRATED: return VIR_DOMAIN_RUNNING_MIGRATED;
+                case VIR_DOMAIN_EVENT_STARTED_RESTORED: return VIR_DOMAIN_RUNNING_RESTORED;
+                case VIR_DOMAIN_EVENT_STARTED_FROM_SNAPSHOT: return VIR_DOMAIN_RUNNING_FROM_SNAPSHOT;
+                case VIR_DOMAIN_EVENT_STARTED_WAKEUP: return VIR_DOMAIN_RUNNING_WAKEUP;
+                default: return VIR_DOMAIN_RUNNING_UNKNOWN;
+            }
+        case VIR_DOMAIN_EVENT_RESUMED:
+            switch (detail) {
+                case VIR_DOMAIN_EVENT_RESUMED_UNPAUSED: return VIR_DOMAIN_RUNNING_UNPAUSED;
+                case VIR_DOMAIN_EVENT_RESUMED_MIGRATED: return VIR_DOMAIN_RUNNING_MIGRATED;
+                case VIR_DOMAIN_EVENT_RESUMED_FROM_SNAPSHOT: return VIR_DOMAIN_RUNNING_FROM_SNAPSHOT;
+                default: return VIR_DOMAIN_RUNNING_UNKNOWN;
+            }
+        case VIR_DOMAIN_EVENT_SUSPENDED:
+            switch (detail) {
+                case VIR_DOMAIN_EVENT_SUSPENDED_PAUSED: return VIR_DOMAIN_PAUSED_USER;
+                case VIR_DOMAIN_EVENT_SUSPENDED_MIGRATED: return VIR_DOMAIN_PAUSED_MIGRATION;
+                case VIR_DOMAIN_EVENT_SUSPENDED_IOERROR: return VIR_DOMAIN_PAUSED_IOERROR;
+                case VIR_DOMAIN_EVENT_SUSPENDED_WATCHDOG: return VIR_DOMAIN_PAUSED_WATCHDOG;
+                case VIR_DOMAIN_EVENT_SUSPENDED_FROM_SNAPSHOT: return VIR_DOMAIN_PAUSED_FROM_SNAPSHOT;
+                case VIR_DOMAIN_EVENT_SUSPENDED_API_ERROR: return VIR_DOMAIN_PAUSED_API_ERROR;
+                default: return VIR_DOMAIN_PAUSED_UNKNOWN;
+            }
+        case VIR_DOMAIN_EVENT_STOPPED:
+            switch (detail) {
+                case VIR_DOMAIN_EVENT_STOPPED_SHUTDOWN: return VIR_DOMAIN_SHUTOFF_SHUTDOWN;
+                case VIR_DOMAIN_EVENT_STOPPED_DESTROYED: return VIR_DOMAIN_SHUTOFF_DESTROYED;
+                case VIR_DOMAIN_EVENT_STOPPED_CRASHED: return VIR_DOMAIN_SHUTOFF_CRASHED;
+                case VIR_DOMAIN_EVENT_STOPPED_MIGRATED: return VIR_DOMAIN_SHUTOFF_MIGRATED;
+                case VIR_DOMAIN_EVENT_STOPPED_SAVED: return VIR_DOMAIN_SHUTOFF_SAVED;
+                case VIR_DOMAIN_EVENT_STOPPED_FAILED: return VIR_DOMAIN_SHUTOFF_FAILED;
+                case VIR_DOMAIN_EVENT_STOPPED_FROM_SNAPSHOT: return VIR_DOMAIN_SHUTOFF_FROM_SNAPSHOT;
+                default: return VIR_DOMAIN_SHUTOFF_UNKNOWN;
+            }
+        case VIR_DOMAIN_EVENT_CRASHED:
+            return detail == VIR_DOMAIN_EVENT_CRASHED_PANICKED ? VIR_DOMAIN_CRASHED_PANICKED : VIR_DOMAIN_CRASHED_UNKNOWN;
+        default:
+            return 0; // PMSUSPENDED reasons only have UNKNOWN
+    }
+}
+
+} // namespace
+
+DomainStateCache::DomainStateCache(std::shared_ptr<HypervisorConnector> connector,
+                                   std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                                   std::chrono::seconds reconcileInterval)
+    : connector(std::move(connector)), dispatcher(std::move(dispatcher)), reconcileInterval(reconcileInterval) {}
+
+DomainStateCache::~DomainStateCache() {
+    stop();
+}
+
+void DomainStateCache::start() {
+    std::scoped_lock lk(lifecycleMutex);
+    if (running.exchange(true)) return;
+    bool loopAcquired = false;
+    try {
+        acquireEventLoop();
+        loopAcquired = true;
+        openEventConnection();
+    } catch (...) {
+        if (loopAcquired) releaseEventLoop();
+        running.store(false);
+        throw;
+    }
+
+    // seed after registering so no transition between the snapshot and the first event is lost
+    reconcile();
+    scheduleReconcile();
+    BoostLogger::Info("DomainStateCache started (event-driven)");
+}
+
+void DomainStateCache::stop() noexcept {
+    std::scoped_lock lk(lifecycleMutex);
+    if (!running.exchange(false)) return;
+    for (auto* timer : {&reconcileTimer, &reconnectTimer}) {
+        if (!*timer) continue;
+        (*timer)->cancel();
+        timer->reset();
+    }
+    closeEventConnection();
+    releaseEventLoop();
+}
+
+void DomainStateCache::openEventConnection() {
+    const std::string uri = connector->getUri();
+    virConnectPtr conn = virConnectOpen(uri.c_str());
+    if (!conn) {
+        virErrorPtr e = virGetLastError();
+        throw LibvirtException("event connection to " + uri + " failed: " + (e && e->message ? e->message : "unknown"));
+    }
+    // keepalive also wakes the event loop periodically so a dead daemon is noticed
+    virConnectSetKeepAlive(conn, 5, 3);
+    // a daemon restart ends the event stream without any lifecycle event: only this tells us
+    if (virConnectRegisterCloseCallback(conn, &DomainStateCache::closeCallback, this, nullptr) < 0) {
+        virErrorPtr e = virGetLastError();
+        const std::string err = std::string("close callback registration failed: ") + (e && e->message ? e->message : "unknown");
+        virConnectClose(conn);
+        throw LibvirtException(err);
+    }
+    int id = virConnectDomainEventRegisterAny(conn, nullptr, VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+        VIR_DOMAIN_EVENT_CALLBACK(&DomainStateCache::lifecycleCallback), this, nullptr);
+    if (id < 0) {
+        virErrorPtr e = virGetLastError();
+        const std::string err = std::string("lifecycle event registration failed: ") + (e && e->message ? e->message : "unknown");
+        virConnectUnregisterCloseCallback(conn, &DomainStateCache::closeCallback);
+        virConnectClose(conn);
+        throw LibvirtException(err);
+    }
+    eventConn = conn;
+    callbackId.store(id);
+}
+
+void DomainStateCache::closeEventConnection() noexcept {
+    if (!eventConn) return;
+    virConnectUnregisterCloseCallback(eventConn, &DomainStateCache::closeCallback);
+    int id = callbackId.exchange(-1);
+    if (id >= 0) virConnectDomainEventDeregisterAny(eventConn, id);
+    virConnectClose(eventConn);
+    eventConn = nullptr;
+}
+
+void DomainStateCache::closeCallback(virConnectPtr /*conn*/, int reason, void* opaque) {
+    // our own virConnectClose unregisters first; this is only the daemon or the link going away
+    if (reason == VIR_CONNECT_CLOSE_REASON_CLIENT) return;
+    auto* self = static_cast<DomainStateCache*>(opaque);
+    // the lifecycle callback died with the connection: until it is back only reconcile() updates us
+    self->callbackId.store(-1);
+    try {
+        BoostLogger::Warn("DomainStateCache: event connection closed (reason " + std::to_string(reason) + "), reconnecting");
+        // not on the libvirt event thread: the new connection's handshake needs that loop running
+        if (self->dispatcher) {
+            self->dispatcher->dispatch([weak = self->weak_from_this()]() {
+                if (auto cache = weak.lock()) cache->reconnect();
+            });
+        }
+    } catch (...) {
+        // never let exceptions escape into libvirt's event loop
+    }
+}
+
+void DomainStateCache::reconnect() {
+    {
+        std::scoped_lock lk(lifecycleMutex);
+        // stopped meanwhile, or an earlier attempt already got the callback back
+        if (!running.load() || callbackId.load() >= 0) return;
+        closeEventConnection();
+        try {
+            openEventConnection();
+        } catch (const std::exception& e) {
+            BoostLogger::Warn(std::string("DomainStateCache: reconnect failed: ") + e.what());
+            scheduleReconnect();
+            return;
+        }
+    }
+    // transitions while the connection was down came with no event
+    reconcile();
+    BoostLogger::Info("DomainStateCache: event connection restored");
+}
+
+void DomainStateCache::scheduleReconnect() {
+    if (!dispatcher || !running.load()) return;
+    reconnectTimer = dispatcher->dispatch_delayed(kReconnectDelay, [weak = weak_from_this()]() {
+        auto self = weak.lock();
+        if (!self || !self->running.load()) return;
+        // from a fresh task, as in scheduleReconcile: a failed attempt replaces reconnectTimer
+        self->dispatcher->dispatch([weak]() {
+            if (auto cache = weak.lock()) cache->reconnect();
+        });
+    });
+}
+
+void DomainStateCache::scheduleReconcile() {
+    if (!dispatcher || !running.load()) return;
+    // keep the Timer alive: destroying it cancels the wait. Jobs hold a weak reference so a cache
+    // destroyed after the timer fired but before the job ran is not touched
+    reconcileTimer = dispatcher->dispatch_delayed(reconcileInterval, [weak = weak_from_this()]() {
+        auto self = weak.lock();
+        if (!self || !self->running.load()) return;
+        self->reconcile();
+        // re-arm from a fresh task: replacing reconcileTimer here would destroy the timer running this callback
+        self->dispatcher->dispatch([weak]() {
+            auto self = weak.lock();
+            if (!self) return;
+            std::scoped_lock lk(self->lifecycleMutex);
+            self->scheduleReconcile();
+        });
+    });
+}
+
+int DomainStateCache::reconcile() {
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception& e) {
+        BoostLogger::Warn(std::string("DomainStateCache: reconcile skipped: ") + e.what());
+        return -1;
+    }
+
+    // events that land while the listing runs are newer than what it returns
+    const auto listedAt = std::chrono::steady_clock::now();
+    // one bulk call for every domain's state instead of a GetState round trip each
+    auto summaries = collectDomainSummaries(lease.get());
+    if (summaries.isErr()) {
+        lease.invalidate();
+        return -1;
+    }
+    const auto domains = std::move(summaries).unwrap();
+
+    std::unordered_set<std::string> seen;
+    seen.reserve(domains.size());
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& d : domains) {
+        seen.emplace(d.name);
+        upsert(DomainStateEntry{d.name, d.uuid, d.state, d.stateReason, now}, listedAt);
+    }
+
+    // drop domains that disappeared while no event reached us
+    std::vector<std::string> stale;
+    {
+        std::shared_lock lk(mutex_);
+        for (const auto& [name, e] : byName) {
+            if (!seen.count(name) && e.updatedAt <= listedAt) stale.push_back(name);
+        }
+    }
+    for (const auto& name : stale) erase(name, listedAt);
+    {
+        // later listings start after these undefines and no longer return the domains
+        std::unique_lock lk(mutex_);
+        std::erase_if(erasedAt, [&](const auto& kv) { return kv.second <= listedAt; });
+    }
+    return static_cast<int>(domains.size());
+}
+
+int DomainStateCache::lifecycleCallback(virConnectPtr /*conn*/, virDomainPtr dom, int event, int detail, void* opaque) {
+    auto* self = static_cast<DomainStateCache*>(opaque);
+    try {
+        self->onLifecycle(dom, event, detail);
+    } catch (...) {
+        // never let exceptions escape into libvirt's event loop
+    }
+    return 0;
+}
+
+void DomainStateCache::onLifecycle(virDomainPtr dom, int event, int detail) {
+    const char* name = virDomainGetName(dom);
+    if (!name) return;
+    if (event == VIR_DOMAIN_EVENT_UNDEFINED) {
+        erase(name);
+        return;
+    }
+    if (event == VIR_DOMAIN_EVENT_DEFINED) {
+        // redefining a running domain (config update) must not flip it to Shutdown; only an
+        // unknown, newly defined domain starts out shut off
+        if (get(name)) return;
+        upsert(DomainStateEntry{name, domainUuid(dom), VirtualMachine::VmState::Shutdown, VIR_DOMAIN_SHUTOFF_UNKNOWN,
+                                std::chrono::steady_clock::now()});
+        return;
+    }
+    auto state = stateAfterEvent(event);
+    if (!state) return;
+    upsert(DomainStateEntry{name, domainUuid(dom), *state, reasonAfterEvent(event, detail), std::chrono::steady_clock::now()});
+}
+
+void DomainStateCache::upsert(DomainStateEntry entry, TimePoint listedAt) {
+    DomainStateEvent ev;
+    {
+        std::unique_lock lk(mutex_);
+        if (listedAt == TimePoint::max()) {
+            erasedAt.erase(entry.name);
+        } else if (auto gone = erasedAt.find(entry.name); gone != erasedAt.end() && gone->second > listedAt) {
+            return; // undefined while the listing ran
+        }
+        auto it = byName.find(entry.name);
+        if (it != byName.end()) {
+            if (it->second.updatedAt > listedAt) return;
+            ev.previous = it->second.state;
+            if (it->second.state == entry.state && it->second.uuid == entry.uuid) {
+                it->second.updatedAt = entry.updatedAt;
+                it->second.reason = entry.reason;
+                return; // nothing changed, don't wake listeners
+            }
+            if (it->second.uuid != entry.uuid) uuidToName.erase(it->second.uuid);
+            it->second = entry;
+        } else {
+            byName.emplace(entry.name, entry);
+        }
+        if (!entry.uuid.empty()) uuidToName[entry.uuid] = entry.name;
+    }
+    ev.kind = DomainStateEvent::Kind::Updated;
+    ev.entry = std::move(entry);
+    notify(ev);
+}
+
+void DomainStateCache::erase(const std::string& name, TimePoint listedAt) {
+    DomainStateEvent ev;
+    {
+        std::unique_lock lk(mutex_);
+        // an undefine event: a listing already running may still return the domain
+        if (listedAt == TimePoint::max()) erasedAt[name] = std::chrono::steady_clock::now();
+        auto it = byName.find(name);
+        if (it == byName.end() || it->second.updatedAt > listedAt) return;
+        ev.previous = it->second.state;
+        ev.entry = std::move(it->second);
+        uuidToName.erase(ev.entry.uuid);
+        byName.erase(it);
+    }
+    ev.kind = DomainStateEvent::Kind::Removed;
+    notify(ev);
+}
+
+void DomainStateCache::notify(const DomainStateEvent& ev) {
+    std::vector<Listener> snapshot;
+    {
+        std::scoped_lock lk(listenerMutex);
+        snapshot.reserve(listeners.size());
+        for (const auto& [_, l] : listeners) snapshot.push_back(l);
+    }
+    for (const auto& l : snapshot) {
+        try { l(ev); } catch (...) { /* listener bugs must not break the cache */ }
+    }
+}
+
+std::optional<DomainStateEntry> DomainStateCache::get(std::string_view name) const {
+    std::shared_lock lk(mutex_);
+    auto it = byName.find(std::string(name));
+    if (it == byName.end()) return std::nullopt;
+    return it->second;
+}
+
+std::optional<DomainStateEntry> DomainStateCache::getByUuid(std::string_view uuid) const {
+    std::shared_lock lk(mutex_);
+    auto u = uuidToName.find(std::string(uuid));
+    if (u == uuidToName.end()) return std::nullopt;
+    auto it = byName.find(u->second);
+    if (it == byName.end()) return std::nullopt;
+    return it->second;
+}
+
+std::vector<DomainStateEntry> DomainStateCache::list() const {
+    std::shared_lock lk(mutex_);
+    std::vector<DomainStateEntry> out;
+    out.reserve(byName.size());
+    for (const auto& [_, e] : byName) out.push_back(e);
+    return out;
+}
+
+std::size_t DomainStateCache::size() const {
+    std::shared_lock lk(mutex_);
+    return byName.size();
+}
+
+std::uint64_t DomainStateCache::subscribe(Listener listener) {
+    std::scoped_lock lk(listenerMutex);
+    const auto id = nextListenerId++;
+    listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void DomainStateCache::unsubscribe(std::uint64_t id) {
+    std::scoped_lock lk(listenerMutex);
+    std::erase_if(listeners, [id](const auto& p) { return p.first == id; });
+}
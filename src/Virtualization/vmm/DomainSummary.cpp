@@ -0,0 +1,80 @@
+#include "Virtualization/vmm/DomainSummary.hpp"
+#include "Virtualization/vmm/LibvirtCall.hpp"
+#include <cstdlib>
+
+namespace {
+
+std::string uuidOf(virDomainPtr dom) {
+    char buf[VIR_UUID_STRING_BUFLEN] = {};
+    // the uuid is cached in the virDomain object: no RPC
+    if (virDomainGetUUIDString(dom, buf) < 0) return {};
+    return buf;
+}
+
+// Slow path: one list call plus one virDomainGetInfo per domain
+Result<std::vector<DomainSummary>> collectViaInfo(virConnectPtr conn, unsigned int listFlags) {
+    virDomainPtr* domains = nullptr;
+    int n = virConnectListAllDomains(conn, &domains, listFlags);
+    if (n < 0) {
+        virErrorPtr e = virGetLastError();
+        return Result<std::vector<DomainSummary>>{std::string("virConnectListAllDomains failed: ") + (e && e->message ? e->message : "unknown")};
+    }
+    std::vector<DomainSummary> out;
+    out.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) {
+        virDomainPtr dom = domains[i];
+        DomainSummary s;
+        if (const char* name = virDomainGetName(dom)) s.name = name;
+        s.uuid = uuidOf(dom);
+        virDomainInfo info{};
+        if (virDomainGetInfo(dom, &info) == 0) {
+            s.state = VirtualMachine::mapLibvirtState(info.state);
+            s.vcpus = info.nrVirtCpu;
+            s.maxVcpus = info.nrVirtCpu;
+            s.memoryKiB = info.memory;
+            s.maxMemoryKiB = info.maxMem;
+            s.cpuTimeNs = info.cpuTime;
+            s.active = info.state == VIR_DOMAIN_RUNNING || info.state == VIR_DOMAIN_PAUSED || info.state == VIR_DOMAIN_BLOCKED;
+        }
+        out.push_back(std::move(s));
+        virDomainFree(dom);
+    }
+    free(domains);
+    return Result<std::vector<DomainSummary>>{std::move(out)};
+}
+
+} // namespace
+
+Result<std::vector<DomainSummary>> collectDomainSummaries(virConnectPtr conn, unsigned int listFlags) {
+    if (!conn) return Result<std::vector<DomainSummary>>{std::string("Not connected")};
+
+    constexpr unsigned int groups = VIR_DOMAIN_STATS_STATE | VIR_DOMAIN_STATS_CPU_TOTAL
+                                  | VIR_DOMAIN_STATS_BALLOON | VIR_DOMAIN_STATS_VCPU;
+    virDomainStatsRecordPtr* records = nullptr;
+    int n = LIBVIRT_CALL(virConnectGetAllDomainStats, conn, groups, &records, listFlags);
+    if (n < 0) return collectViaInfo(conn, listFlags);
+
+    std::vector<DomainSummary> out;
+    out.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) {
+        virDomainStatsRecordPtr rec = records[i];
+        DomainSummary s;
+        if (const char* name = virDomainGetName(rec->dom)) s.name = name;
+        s.uuid = uuidOf(rec->dom);
+
+        int state = VIR_DOMAIN_NOSTATE;
+        virTypedParamsGetInt(rec->params, rec->nparams, "state.state", &state);
+        virTypedParamsGetInt(rec->params, rec->nparams, "state.reason", &s.stateReason);
+        s.state = VirtualMachine::mapLibvirtState(state);
+        s.active = state == VIR_DOMAIN_RUNNING || state == VIR_DOMAIN_PAUSED || state == VIR_DOMAIN_BLOCKED;
+
+        virTypedParamsGetUInt(rec->params, rec->nparams, "vcpu.current", &s.vcpus);
+        virTypedParamsGetUInt(rec->params, rec->nparams, "vcpu.maximum", &s.maxVcpus);
+        virTypedParamsGetULLong(rec->params, rec->nparams, "balloon.current", &s.memoryKiB);
+        virTypedParamsGetULLong(rec->params, rec->nparams, "balloon.maximum", &s.maxMemoryKiB);
+        virTypedParamsGetULLong(rec->params, rec->nparams, "cpu.time", &s.cpuTimeNs);
+        out.push_back(std::move(s));
+    }
+    virDomainStatsRecordListFree(records);
+    return Result<std::vector<DomainSummary>>{std::move(out)};
+}
@@ -0,0 +1,197 @@
+#include "Virtualization/vmm/DomainTemplateCache.hpp"
+#include <charconv>
+#include <limits>
+#include <mutex>
+
+namespace {
+
+// \x1e<slot><index>\x1f: control characters never appear in a valid domain XML
+constexpr char kSlotBegin = '\x1e';
+constexpr char kSlotEnd = '\x1f';
+// the writer prints the port as a number, so the port slot is found by value
+constexpr int kPortSentinel = std::numeric_limits<int>::min() + 7;
+
+std::string marker(DomainTemplate::Slot slot, std::uint32_t index = 0) {
+    std::string m;
+    m += kSlotBegin;
+    m += static_cast<char>('0' + static_cast<int>(slot));
+    m += std::to_string(index);
+    m += kSlotEnd;
+    return m;
+}
+
+bool hasPortSlot(const GraphicsConfig& g) noexcept {
+    return !g.type.empty() && !g.autoport;
+}
+
+} // namespace
+
+void appendXmlEscaped(std::string& out, std::string_view value) {
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        const char* rep = nullptr;
+        switch (value[i]) {
+            case '&': rep = "&amp;"; break;
+            case '<': rep = "&lt;"; break;
+            case '>': rep = "&gt;"; break;
+            case '\'': rep = "&apos;"; break;
+            case '"': rep = "&quot;"; break;
+            default: continue;
+        }
+        out.append(value.data() + start, i - start);
+        out += rep;
+        start = i + 1;
+    }
+    out.append(value.data() + start, value.size() - start);
+}
+
+Result<DomainTemplate> DomainTemplate::compile(const VmConfig& prototype, DomainWriter writeDomain, PlacementWriter writePlacement) {
+    DomainTemplate tpl;
+    tpl.writePlacement = writePlacement;
+    tpl.shape = prototype;
+    tpl.shape.name.clear();
+    tpl.shape.placement = {};
+    for (auto& d : tpl.shape.disks) d.source.clear();
+    for (auto& n : tpl.shape.networks) n.macAddress = n.macAddress.empty() ? "" : "x"; // only presence matters
+    if (!prototype.uuid.empty()) tpl.shape.uuid = "x";
+    // one template serves every lab: the partition is a slot, only its presence is shape
+    if (!prototype.resourcePartition.empty()) tpl.shape.resourcePartition = "x";
+
+    VmConfig marked = prototype;
+    marked.name = marker(Slot::Name);
+    if (!marked.uuid.empty()) marked.uuid = marker(Slot::Uuid);
+    if (!marked.resourcePartition.empty()) marked.resourcePartition = marker(Slot::Partition);
+    marked.placement = {};
+    // nosharepages is written with the hugepages into the placement slot's <memoryBacking>
+    marked.memoryTuning.sharePages = true;
+    for (std::uint32_t i = 0; i < marked.disks.size(); ++i) marked.disks[i].source = marker(Slot::DiskSource, i);
+    for (std::uint32_t i = 0; i < marked.networks.size(); ++i) {
+        if (!marked.networks[i].macAddress.empty()) marked.networks[i].macAddress = marker(Slot::Mac, i);
+    }
+    if (hasPortSlot(marked.graphics)) marked.graphics.port = kPortSentinel;
+
+    std::string xml;
+    xml.reserve(2048);
+    writeDomain(xml, marked);
+
+    // placement has no fixed shape (0..n pins, optional numatune/hugepages): it goes right after <vcpu>
+    const auto vcpuEnd = xml.find("</vcpu>");
+    if (vcpuEnd == std::string::npos) return Result<DomainTemplate>{std::string("Domain template has no <vcpu> element")};
+    xml.insert(vcpuEnd + 7, marker(Slot::Placement));
+    if (hasPortSlot(marked.graphics)) {
+        const auto needle = "'" + std::to_string(kPortSentinel) + "'";
+        const auto at = xml.find(needle);
+        if (at == std::string::npos) return Result<DomainTemplate>{std::string("Domain template has no graphics port")};
+        xml.replace(at + 1, needle.size() - 2, marker(Slot::GraphicsPort));
+    }
+
+    std::size_t pos = 0;
+    for (;;) {
+        const auto begin = xml.find(kSlotBegin, pos);
+        if (begin == std::string::npos) break;
+        const auto end = xml.find(kSlotEnd, begin);
+        if (end == std::string::npos || end < begin + 3) return Result<DomainTemplate>{std::string("Malformed slot in domain template")};
+        Part part;
+        part.literal.assign(xml, pos, begin - pos);
+        part.slot = static_cast<Slot>(xml[begin + 1] - '0');
+        std::from_chars(xml.data() + begin + 2, xml.data() + end, part.index);
+        tpl.literalBytes += part.literal.size();
+        tpl.parts.push_back(std::move(part));
+        pos = end + 1;
+    }
+    tpl.tail.assign(xml, pos);
+    tpl.literalBytes += tpl.tail.size();
+    return Result<DomainTemplate>{std::move(tpl)};
+}
+
+// everything the writer emits that is not a slot; metadata is not part of the domain XML
+bool DomainTemplate::matches(const VmConfig& cfg) const {
+    const auto& s = shape;
+    if (cfg.memory != s.memory || cfg.vcpus != s.vcpus || cfg.osType != s.osType || cfg.arch != s.arch) return false;
+    if (cfg.currentMemory != s.currentMemory || cfg.maxVcpus != s.maxVcpus || cfg.emulator != s.emulator) return false;
+    if (cfg.iothreads != s.iothreads) return false;
+    if (cfg.title != s.title || cfg.description != s.description) return false;
+    if (cfg.uuid.empty() != s.uuid.empty()) return false;
+    if (cfg.resourcePartition.empty() != s.resourcePartition.empty()) return false;
+    if (cfg.disks.size() != s.disks.size() || cfg.networks.size() != s.networks.size()) return false;
+    for (std::size_t i = 0; i < cfg.disks.size(); ++i) {
+        const auto& a = cfg.disks[i];
+        const auto& b = s.disks[i];
+        if (a.type != b.type || a.device != b.device || a.driver != b.driver || a.target != b.target || a.readOnly != b.readOnly) return false;
+        if (a.cache != b.cache || a.io != b.io || a.discard != b.discard || a.queues != b.queues || a.iothread != b.iothread) return false;
+    }
+    for (std::size_t i = 0; i < cfg.networks.size(); ++i) {
+        const auto& a = cfg.networks[i];
+        const auto& b = s.networks[i];
+        if (a.type != b.type || a.source != b.source || a.model != b.model) return false;
+        if (a.driverName != b.driverName || a.queues != b.queues || a.directMode != b.directMode) return false;
+        if (a.rxQueueSize != b.rxQueueSize || a.txQueueSize != b.txQueueSize) return false;
+        if (a.macAddress.empty() != b.macAddress.empty()) return false;
+    }
+    const auto& m = cfg.memoryTuning;
+    const auto& sm = s.memoryTuning;
+    if (m.balloon != sm.balloon || m.statsPeriod != sm.statsPeriod || m.autodeflate != sm.autodeflate
+        || m.freePageReporting != sm.freePageReporting || m.sharePages != sm.sharePages) return false;
+    const auto& g = cfg.graphics;
+    if (g.type != s.graphics.type) return false;
+    if (!g.type.empty() && (g.autoport != s.graphics.autoport || g.listenAddress != s.graphics.listenAddress)) return false;
+    return true;
+}
+
+void DomainTemplate::render(std::string& out, const VmConfig& cfg) const {
+    out.reserve(out.size() + literalBytes + 64 + cfg.name.size() + cfg.disks.size() * 64 + cfg.networks.size() * 18);
+    for (const auto& part : parts) {
+        out += part.literal;
+        switch (part.slot) {
+            case Slot::Name: appendXmlEscaped(out, cfg.name); break;
+            case Slot::Uuid: appendXmlEscaped(out, cfg.uuid); break;
+            case Slot::Placement: writePlacement(out, cfg.placement, cfg.memoryTuning); break;
+            case Slot::DiskSource: appendXmlEscaped(out, cfg.disks[part.index].source); break;
+            case Slot::Mac: appendXmlEscaped(out, cfg.networks[part.index].macAddress); break;
+            case Slot::Partition: appendXmlEscaped(out, cfg.resourcePartition); break;
+            case Slot::GraphicsPort: {
+                char buf[16];
+                auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), cfg.graphics.port);
+                out.append(buf, end);
+                break;
+            }
+        }
+    }
+    out += tail;
+}
+
+DomainTemplateCache::DomainTemplateCache(DomainTemplate::DomainWriter writeDomain, DomainTemplate::PlacementWriter writePlacement)
+    : writeDomain(writeDomain), writePlacement(writePlacement) {}
+
+Result<std::string> DomainTemplateCache::render(std::string_view templateId, const VmConfig& cfg) {
+    std::shared_ptr<const DomainTemplate> tpl;
+    {
+        std::shared_lock lock(mutex_);
+        auto it = templates.find(std::string(templateId));
+        if (it != templates.end() && it->second->matches(cfg)) tpl = it->second;
+    }
+    if (tpl) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        // compiled outside the lock; two racing misses both compile and the last one wins
+        auto compiled = DomainTemplate::compile(cfg, writeDomain, writePlacement);
+        if (compiled.isErr()) return Err{compiled.unwrapErr()};
+        tpl = std::make_shared<const DomainTemplate>(std::move(compiled).unwrap());
+        compiles.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock lock(mutex_);
+        templates[std::string(templateId)] = tpl;
+    }
+    std::string xml;
+    tpl->render(xml, cfg);
+    return Result<std::string>{std::move(xml)};
+}
+
+void DomainTemplateCache::invalidate(std::string_view templateId) {
+    std::unique_lock lock(mutex_);
+    templates.erase(std::string(templateId));
+}
+
+void DomainTemplateCache::clear() {
+    std::unique_lock lock(mutex_);
+    templates.clear();
+}
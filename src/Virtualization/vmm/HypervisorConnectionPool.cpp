@@ -0,0 +1,138 @@
+#include "Virtualization/vmm/HypervisorConnectionPool.hpp"
+#include "Virtualization/Utils/VmException.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Virtualization/vmm/LibvirtCall.hpp"
+#include <libvirt/virterror.h>
+#include <utility>
+
+//
+// Lease
+//
+HypervisorConnectionPool::Lease::~Lease() {
+    release();
+}
+
+HypervisorConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool(std::move(other.pool)),
+      conn(std::exchange(other.conn, nullptr)),
+      broken(std::exchange(other.broken, false)) {}
+
+HypervisorConnectionPool::Lease& HypervisorConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = std::move(other.pool);
+        conn = std::exchange(other.conn, nullptr);
+        broken = std::exchange(other.broken, false);
+    }
+    return *this;
+}
+
+void HypervisorConnectionPool::Lease::release() noexcept {
+    if (pool && conn) pool->checkin(conn, broken);
+    pool.reset();
+    conn = nullptr;
+    broken = false;
+}
+
+//
+// HypervisorConnectionPool
+//
+HypervisorConnectionPool::HypervisorConnectionPool(std::string uri, std::size_t capacity)
+    : uri(std::move(uri)), maxSize(capacity == 0 ? 1 : capacity) {
+    idle.reserve(maxSize);
+}
+
+HypervisorConnectionPool::~HypervisorConnectionPool() {
+    close();
+}
+
+HypervisorConnectionPool::Lease HypervisorConnectionPool::acquire() {
+    // includes waiting for a free slot: a saturated pool shows up here before anywhere else
+    static auto& wait = METRICS::MetricsRegistry::global().histogram("penhive_libvirt_pool_acquire_seconds",
+        "Time to check a connection out of the libvirt pool");
+    METRICS::ScopedTimer timer(wait);
+    std::unique_lock lock(mutex_);
+    available.wait(lock, [this] { return closed || !idle.empty() || opened < maxSize; });
+    return checkoutLocked(lock);
+}
+
+std::optional<HypervisorConnectionPool::Lease> HypervisorConnectionPool::tryAcquire(std::chrono::milliseconds timeout) {
+    std::unique_lock lock(mutex_);
+    if (!available.wait_for(lock, timeout, [this] { return closed || !idle.empty() || opened < maxSize; })) {
+        return std::nullopt;
+    }
+    return checkoutLocked(lock);
+}
+
+HypervisorConnectionPool::Lease HypervisorConnectionPool::checkoutLocked(std::unique_lock<std::mutex>& lock) {
+    if (closed) throw LibvirtException("connection pool for " + uri + " is closed");
+
+    // Reuse an idle handle if the daemon still considers it alive
+    while (!idle.empty()) {
+        virConnectPtr c = idle.back();
+        idle.pop_back();
+        lock.unlock();
+        if (virConnectIsAlive(c) == 1) return Lease{shared_from_this(), c};
+        virConnectClose(c);
+        lock.lock();
+        --opened;
+    }
+
+    // Reserve a slot, then open outside the lock: virConnectOpen is a full RPC handshake
+    ++opened;
+    lock.unlock();
+    try {
+        return Lease{shared_from_this(), openOrThrow()};
+    } catch (...) {
+        lock.lock();
+        --opened;
+        available.notify_one();
+        throw;
+    }
+}
+
+virConnectPtr HypervisorConnectionPool::openOrThrow() {
+    virConnectPtr c = LIBVIRT_CALL(virConnectOpen, uri.c_str());
+    if (!c) {
+        virErrorPtr e = virGetLastError();
+        throw LibvirtException("connect to " + uri + " failed: " + (e && e->message ? e->message : "unknown"));
+    }
+    // keepalive lets virConnectIsAlive notice a dead daemon without a blocking RPC
+    virConnectSetKeepAlive(c, 5, 3);
+    return c;
+}
+
+void HypervisorConnectionPool::checkin(virConnectPtr conn, bool broken) noexcept {
+    std::unique_lock lock(mutex_);
+    if (broken || closed) {
+        --opened;
+        lock.unlock();
+        virConnectClose(conn);
+    } else {
+        idle.push_back(conn);
+        lock.unlock();
+    }
+    available.notify_one();
+}
+
+void HypervisorConnectionPool::close() noexcept {
+    std::vector<virConnectPtr> toClose;
+    {
+        std::scoped_lock lock(mutex_);
+        closed = true;
+        toClose.swap(idle);
+        opened -= toClose.size();
+    }
+    for (virConnectPtr c : toClose) virConnectClose(c);
+    available.notify_all();
+}
+
+std::size_t HypervisorConnectionPool::idleCount() const {
+    std::scoped_lock lock(mutex_);
+    return idle.size();
+}
+
+std::size_t HypervisorConnectionPool::openCount() const {
+    std::scoped_lock lock(mutex_);
+    return opened;
+}
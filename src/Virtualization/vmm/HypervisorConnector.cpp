@@ -1,9 +1,9 @@
-#include "/home/hussin/Desktop/PenHive/include/Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
 #include <stdexcept>
 #include <libvirt/libvirt.h>
 
-HypervisorConnector::HypervisorConnector(std::shared_ptr<IRocksDB> db)
-    : db(std::move(db)), conn(nullptr) {}
+HypervisorConnector::HypervisorConnector(std::shared_ptr<IRocksDB> db, std::size_t poolSize)
+    : conn(nullptr), db(std::move(db)), poolSize(poolSize == 0 ? 1 : poolSize) {}
 
 HypervisorConnector::~HypervisorConnector() {
     close();
@@ -12,8 +12,21 @@ HypervisorConnector::~HypervisorConnector() {
 bool HypervisorConnector::connect(const std::string& uri) noexcept {
     std::scoped_lock lock(mutex_);
     if (conn) return true;
-    conn = virConnectOpen(uri.c_str());
-    return conn != nullptr;
+    // reconnects (ensureConnected, connectOrThrow()) go back to the host we were connected to
+    const std::string target = uri.empty() ? this->uri : uri;
+    conn = virConnectOpen(target.c_str());
+    if (!conn) return false;
+    this->uri = target;
+    // the primary handle stays for callers that need a stable connection (events, getRawHandle);
+    // all other libvirt traffic goes through the pool
+    try {
+        pool = std::make_shared<HypervisorConnectionPool>(target, poolSize);
+    } catch (...) {
+        virConnectClose(conn);
+        conn = nullptr;
+        return false;
+    }
+    return true;
 }
 
 void HypervisorConnector::connectOrThrow(const std::string& uri) {
@@ -25,6 +38,11 @@ void HypervisorConnector::connectOrThrow(const std::string& uri) {
 
 void HypervisorConnector::close() noexcept {
     std::scoped_lock lock(mutex_);
+    if (pool) {
+        // outstanding leases keep the pool alive and close their handle on checkin
+        pool->close();
+        pool.reset();
+    }
     if (conn) {
         virConnectClose(conn);
         conn = nullptr;
@@ -36,7 +54,7 @@ virConnectPtr HypervisorConnector::getRawHandle() const noexcept {
 }
 
 virConnectPtr HypervisorConnector::ensureConnected() {
-    std::scoped_lock lock(mutex_);
+    std::unique_lock lock(mutex_);
     if (!conn) {
         lock.unlock();
         connectOrThrow();
@@ -52,3 +70,27 @@ bool HypervisorConnector::isConnected() const noexcept {
 std::shared_ptr<IRocksDB> HypervisorConnector::getDB() const noexcept {
     return db;
 }
+
+std::string HypervisorConnector::getUri() const {
+    std::scoped_lock lock(mutex_);
+    return uri;
+}
+
+HypervisorConnectionPool::Lease HypervisorConnector::acquire() {
+    std::shared_ptr<HypervisorConnectionPool> p;
+    {
+        std::unique_lock lock(mutex_);
+        if (!pool) {
+            lock.unlock();
+            connectOrThrow();
+            lock.lock();
+        }
+        p = pool;
+    }
+    if (!p) throw std::runtime_error("libvirt: connection pool unavailable");
+    return p->acquire();
+}
+
+std::size_t HypervisorConnector::getPoolSize() const noexcept {
+    return poolSize;
+}
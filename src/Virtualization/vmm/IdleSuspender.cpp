@@ -0,0 +1,289 @@
+#include "Virtualization/vmm/IdleSuspender.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <libvirt/libvirt.h>
+#include <vector>
+
+namespace {
+
+std::string lastError(const char* what) {
+    virErrorPtr err = virGetLastError();
+    return std::string(what) + ": " + (err && err->message ? err->message : "unknown");
+}
+
+} // namespace
+
+IdleSuspender::IdleSuspender(std::shared_ptr<HypervisorConnector> connector,
+                             std::shared_ptr<DomainStateCache> states,
+                             std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                             IdlePolicy policy)
+    : connector(std::move(connector)), states(std::move(states)), dispatcher(std::move(dispatcher)), policy(policy) {}
+
+IdleSuspender::~IdleSuspender() {
+    stop();
+}
+
+void IdleSuspender::start(CONCURRENCY::TimerWheel& wheel, std::chrono::seconds interval) {
+    stop();
+    auto flag = std::make_shared<std::atomic<bool>>(false);
+    std::uint64_t id = 0;
+    const std::weak_ptr<IdleSuspender> weak = weak_from_this();
+    // the cache may still hold a snapshot with this listener after stop() unsubscribed it
+    if (states) id = states->subscribe([weak](const DomainStateEvent& ev) {
+        if (auto self = weak.lock()) self->onState(ev);
+    });
+    {
+        std::lock_guard lock(mutex_);
+        cancelFlag = flag;
+        subscription = id;
+    }
+    CONCURRENCY::WheelJobOptions opts;
+    opts.lane = CONCURRENCY::Lane::Blocking;
+    opts.cancelFlag = flag;
+    (void)wheel.schedule_every(interval, [weak]() {
+        auto self = weak.lock();
+        if (!self) return;
+        auto res = self->runOnce();
+        if (res.isErr()) BoostLogger::Warn("IdleSuspender: " + res.unwrapErr());
+    }, std::move(opts));
+}
+
+void IdleSuspender::stop() noexcept {
+    std::shared_ptr<std::atomic<bool>> flag;
+    std::uint64_t id = 0;
+    {
+        std::lock_guard lock(mutex_);
+        flag = std::move(cancelFlag);
+        id = std::exchange(subscription, 0);
+    }
+    if (flag) flag->store(true);
+    if (id && states) states->unsubscribe(id);
+}
+
+void IdleSuspender::setExempt(const std::string& domain, bool isExempt) {
+    std::lock_guard lock(mutex_);
+    if (isExempt) exempt.insert(domain);
+    else exempt.erase(domain);
+}
+
+void IdleSuspender::forget(const std::string& domain) {
+    std::lock_guard lock(mutex_);
+    entries.erase(domain);
+    exempt.erase(domain);
+}
+
+void IdleSuspender::touch(std::string_view domain) {
+    std::lock_guard lock(mutex_);
+    if (auto it = entries.find(std::string(domain)); it != entries.end()) it->second.lastActive = Clock::now();
+}
+
+void IdleSuspender::observe(const std::vector<DomainUsage>& round) {
+    const auto now = Clock::now();
+    std::lock_guard lock(mutex_);
+    for (const auto& usage : round) {
+        const bool busy = usage.point.cpuShare() >= policy.cpuThreshold
+            || (policy.ioBytesPerSecond > 0 && usage.point.ioBps() >= policy.ioBytesPerSecond);
+        if (!busy) continue;
+        if (auto it = entries.find(usage.domain); it != entries.end()) it->second.lastActive = now;
+    }
+}
+
+void IdleSuspender::onState(const DomainStateEvent& ev) {
+    std::lock_guard lock(mutex_);
+    if (ev.kind == DomainStateEvent::Kind::Removed) {
+        entries.erase(ev.entry.name);
+        return;
+    }
+    auto it = entries.find(ev.entry.name);
+    if (it == entries.end()) return;
+    // resumed or started by someone else: it is no longer ours to resume
+    if (ev.entry.state == VirtualMachine::VmState::Running && it->second.suspended != Suspended::No && !it->second.resuming.valid()) {
+        it->second.suspended = Suspended::No;
+        it->second.lastActive = Clock::now();
+    }
+}
+
+Result<void> IdleSuspender::doResume(const std::string& domain, Suspended how) {
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception& e) {
+        return Result<void>{std::string("Not connected: ") + e.what()};
+    }
+    virDomainPtr dom = virDomainLookupByName(lease.get(), domain.c_str());
+    if (!dom) return Result<void>{"Domain not found: " + domain};
+    // virDomainCreate restores from the managed save image instead of booting
+    const int rc = how == Suspended::Paused ? virDomainResume(dom) : virDomainCreate(dom);
+    Result<void> res = rc == 0 ? Result<void>{} : Result<void>{lastError(how == Suspended::Paused ? "virDomainResume failed" : "Restoring managed save failed")};
+    virDomainFree(dom);
+    return res;
+}
+
+Result<void> IdleSuspender::ensureRunning(std::string_view domain) {
+    const std::string name(domain);
+    std::unique_lock lock(mutex_);
+    auto it = entries.find(name);
+    if (it == entries.end()) {
+        // saved before a restart of the service: the managed save image is the only trace
+        lock.unlock();
+        const auto cached = states ? states->get(name) : std::nullopt;
+        if (!cached || cached->state != VirtualMachine::VmState::Shutdown) return Result<void>{};
+        bool hasImage = false;
+        try {
+            auto lease = connector->acquire();
+            if (virDomainPtr dom = virDomainLookupByName(lease.get(), name.c_str())) {
+                hasImage = virDomainHasManagedSaveImage(dom, 0) == 1;
+                virDomainFree(dom);
+            }
+        } catch (const std::exception&) {
+            return Result<void>{std::string("Not connected")};
+        }
+        if (!hasImage) return Result<void>{};
+        lock.lock();
+        it = entries.try_emplace(name).first;
+        if (it->second.suspended == Suspended::No && !it->second.resuming.valid()) it->second.suspended = Suspended::Saved;
+    }
+
+    auto& entry = it->second;
+    entry.lastActive = Clock::now();
+    if (entry.resuming.valid()) {
+        ++coalesced;
+        auto pending = entry.resuming;
+        lock.unlock();
+        return pending.get();
+    }
+    if (entry.suspended == Suspended::No) return Result<void>{};
+
+    std::promise<Result<void>> done;
+    entry.resuming = done.get_future().share();
+    const Suspended how = entry.suspended;
+    ++resumes;
+    lock.unlock();
+
+    Result<void> res{std::string("Resume interrupted")};
+    try {
+        res = doResume(name, how);
+    } catch (const std::exception& e) {
+        res = Result<void>{std::string(e.what())};
+    }
+
+    lock.lock();
+    if (auto again = entries.find(name); again != entries.end()) {
+        again->second.resuming = {};
+        if (res.isOk()) {
+            again->second.suspended = Suspended::No;
+            again->second.lastActive = Clock::now();
+        }
+    }
+    lock.unlock();
+    done.set_value(res);
+    return res;
+}
+
+CONCURRENCY::Offload<Result<void>> IdleSuspender::co_ensureRunning(std::string domain) {
+    return {dispatcher, CONCURRENCY::Lane::Blocking, [self = shared_from_this(), domain = std::move(domain)] { return self->ensureRunning(domain); }};
+}
+
+Result<std::size_t> IdleSuspender::runOnce() {
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception& e) {
+        return Result<std::size_t>{std::string("Not connected: ") + e.what()};
+    }
+    constexpr unsigned int groups = VIR_DOMAIN_STATS_STATE | VIR_DOMAIN_STATS_CPU_TOTAL | VIR_DOMAIN_STATS_VCPU;
+    virDomainStatsRecordPtr* records = nullptr;
+    const int n = virConnectGetAllDomainStats(lease.get(), groups, &records, VIR_CONNECT_GET_ALL_DOMAINS_STATS_ACTIVE);
+    if (n < 0) return Result<std::size_t>{lastError("virConnectGetAllDomainStats failed")};
+
+    struct Action {
+        virDomainPtr dom;
+        std::string name;
+        Suspended to;
+    };
+    std::vector<Action> actions;
+    const auto now = Clock::now();
+    {
+        std::lock_guard lock(mutex_);
+        std::unordered_set<std::string> seen;
+        for (int i = 0; i < n; ++i) {
+            virDomainStatsRecordPtr rec = records[i];
+            const char* raw = virDomainGetName(rec->dom);
+            if (!raw) continue;
+            std::string name(raw);
+            int state = VIR_DOMAIN_NOSTATE;
+            unsigned long long cpuNs = 0;
+            unsigned int vcpus = 1;
+            virTypedParamsGetInt(rec->params, rec->nparams, "state.state", &state);
+            virTypedParamsGetULLong(rec->params, rec->nparams, "cpu.time", &cpuNs);
+            virTypedParamsGetUInt(rec->params, rec->nparams, "vcpu.current", &vcpus);
+            seen.insert(name);
+
+            auto [it, added] = entries.try_emplace(name);
+            auto& e = it->second;
+            if (added) {
+                e.cpuNs = cpuNs;
+                e.sampledAt = now;
+                e.lastActive = now;
+                continue;
+            }
+            if (state == VIR_DOMAIN_RUNNING) {
+                const auto wallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - e.sampledAt).count();
+                const double used = wallNs > 0 && cpuNs >= e.cpuNs
+                    ? static_cast<double>(cpuNs - e.cpuNs) / (static_cast<double>(wallNs) * std::max(1u, vcpus))
+                    : 1.0;
+                if (e.suspended != Suspended::No && !e.resuming.valid()) e.suspended = Suspended::No; // resumed elsewhere
+                if (used >= policy.cpuThreshold) e.lastActive = now;
+                const auto idle = now - e.lastActive;
+                if (!exempt.count(name) && !e.resuming.valid()) {
+                    if (policy.pauseAfter.count() > 0 && idle >= policy.pauseAfter) actions.push_back({rec->dom, name, Suspended::Paused});
+                    else if (policy.pauseAfter.count() == 0 && policy.saveAfter.count() > 0 && idle >= policy.saveAfter) actions.push_back({rec->dom, name, Suspended::Saved});
+                }
+            } else if (state == VIR_DOMAIN_PAUSED && e.suspended == Suspended::Paused && !e.resuming.valid()
+                       && policy.saveAfter.count() > 0 && now - e.suspendedAt >= policy.saveAfter) {
+                actions.push_back({rec->dom, name, Suspended::Saved});
+            }
+            e.cpuNs = cpuNs;
+            e.sampledAt = now;
+        }
+        // saved domains are inactive and absent from the list; everything else that vanished is gone
+        std::erase_if(entries, [&](const auto& kv) { return !seen.count(kv.first) && kv.second.suspended != Suspended::Saved; });
+    }
+
+    std::size_t suspended = 0;
+    for (const auto& a : actions) {
+        {
+            // touched while we were deciding: leave it alone
+            std::lock_guard lock(mutex_);
+            auto it = entries.find(a.name);
+            if (it == entries.end() || it->second.lastActive > now || it->second.resuming.valid()) continue;
+        }
+        const int rc = a.to == Suspended::Paused ? virDomainSuspend(a.dom) : virDomainManagedSave(a.dom, 0);
+        if (rc < 0) {
+            BoostLogger::Warn("IdleSuspender: " + a.name + ": " + lastError(a.to == Suspended::Paused ? "virDomainSuspend failed" : "virDomainManagedSave failed"));
+            continue;
+        }
+        ++suspended;
+        std::lock_guard lock(mutex_);
+        if (auto it = entries.find(a.name); it != entries.end()) {
+            it->second.suspended = a.to;
+            it->second.suspendedAt = Clock::now();
+        }
+    }
+    virDomainStatsRecordListFree(records);
+    if (suspended > 0) BoostLogger::Info("IdleSuspender: suspended " + std::to_string(suspended) + " idle domains");
+    return Result<std::size_t>{suspended};
+}
+
+IdleStats IdleSuspender::stats() const {
+    std::lock_guard lock(mutex_);
+    IdleStats s;
+    s.tracked = entries.size();
+    for (const auto& [_, e] : entries) {
+        if (e.suspended == Suspended::Paused) ++s.paused;
+        else if (e.suspended == Suspended::Saved) ++s.saved;
+    }
+    s.resumes = resumes;
+    s.coalescedResumes = coalesced;
+    return s;
+}
@@ -0,0 +1,18 @@
+#include "Virtualization/vmm/LibvirtCall.hpp"
+#include <libvirt/virterror.h>
+#include <string>
+
+namespace LIBVIRT {
+
+void recordFailure(const CallSite& site, TRACING::Span& span) {
+    virErrorPtr err = virGetLastError();
+    const int code = err ? err->code : VIR_ERR_INTERNAL_ERROR;
+    // failures are rare: the series lookup (registry mutex) stays off the success path
+    METRICS::MetricsRegistry::global()
+        .counter("penhive_libvirt_errors_total", "Failed libvirt API calls by virErrorNumber",
+                 {{"api", site.api}, {"code", std::to_string(code)}})
+        .inc();
+    span.setError(code, err && err->message ? err->message : "unknown");
+}
+
+} // namespace LIBVIRT
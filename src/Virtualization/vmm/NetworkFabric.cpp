@@ -0,0 +1,541 @@
+#include "Virtualization/vmm/NetworkFabric.hpp"
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <libvirt/libvirt.h>
+#include <linux/if_link.h>
+#include <linux/neighbour.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::string_view kPrefix = "ph-";
+constexpr unsigned int kVniLast = 0xFFFFFF;
+
+std::string lastError(const std::string& what) {
+    virErrorPtr err = virGetLastError();
+    return what + ": " + (err && err->message ? err->message : "unknown");
+}
+
+std::string linkName(char kind, unsigned int vni) {
+    char name[IFNAMSIZ];
+    std::snprintf(name, sizeof(name), "ph%c%06x", kind, vni);
+    return name;
+}
+
+std::string bridgeOf(unsigned int vni) { return linkName('b', vni); }
+std::string tunnelOf(unsigned int vni) { return linkName('v', vni); }
+
+SegmentKind kindOf(const FabricOptions& opts) noexcept {
+    return opts.mode == FabricOptions::Mode::Vlan ? SegmentKind::Vlan : SegmentKind::Vni;
+}
+
+// one rtnetlink request, attributes appended in place
+class NlRequest {
+public:
+    NlRequest(std::uint16_t type, std::uint16_t flags) : buf(NLMSG_HDRLEN, 0) {
+        auto* h = header();
+        h->nlmsg_type = type;
+        h->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+    }
+
+    template <typename T>
+    void body(const T& value) { append(&value, sizeof(value)); }
+
+    void attr(std::uint16_t type, const void* data, std::size_t len) {
+        rtattr rta{};
+        rta.rta_type = type;
+        rta.rta_len = static_cast<unsigned short>(RTA_LENGTH(len));
+        append(&rta, sizeof(rta));
+        append(data, len);
+    }
+    void attr(std::uint16_t type, std::string_view s) {
+        std::string z(s);
+        attr(type, z.c_str(), z.size() + 1);
+    }
+    template <typename T>
+    void attr(std::uint16_t type, T value) { attr(type, &value, sizeof(value)); }
+
+    std::size_t nest(std::uint16_t type) {
+        const std::size_t at = buf.size();
+        attr(type, nullptr, 0);
+        return at;
+    }
+    void close(std::size_t at) {
+        auto* rta = reinterpret_cast<rtattr*>(buf.data() + at);
+        rta->rta_len = static_cast<unsigned short>(buf.size() - at);
+    }
+
+    [[nodiscard]] std::string finish(std::uint32_t seq) {
+        header()->nlmsg_len = static_cast<std::uint32_t>(buf.size());
+        header()->nlmsg_seq = seq;
+        return std::string(buf.data(), buf.size());
+    }
+
+private:
+    nlmsghdr* header() { return reinterpret_cast<nlmsghdr*>(buf.data()); }
+
+    void append(const void* data, std::size_t len) {
+        const std::size_t at = buf.size();
+        buf.resize(at + NLMSG_ALIGN(len), 0);
+        if (len) std::memcpy(buf.data() + at, data, len);
+    }
+
+    std::vector<char> buf;
+};
+
+/**
+ * Several requests in one sendmsg; the kernel runs them in order and acks
+ * each one. Returns one errno per request (0 = done).
+ */
+std::vector<int> runBatch(std::vector<NlRequest>& requests) {
+    std::vector<int> result(requests.size(), EIO);
+    if (requests.empty()) return result;
+    const int fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        std::fill(result.begin(), result.end(), errno);
+        return result;
+    }
+    std::string out;
+    for (std::size_t i = 0; i < requests.size(); ++i) out += requests[i].finish(static_cast<std::uint32_t>(i + 1));
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    if (::sendto(fd, out.data(), out.size(), 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+        std::fill(result.begin(), result.end(), errno);
+        ::close(fd);
+        return result;
+    }
+    std::size_t pending = requests.size();
+    std::vector<char> in(64 * 1024);
+    while (pending > 0) {
+        const ssize_t n = ::recv(fd, in.data(), in.size(), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        auto len = static_cast<unsigned int>(n);
+        for (auto* h = reinterpret_cast<nlmsghdr*>(in.data()); NLMSG_OK(h, len); h = NLMSG_NEXT(h, len)) {
+            if (h->nlmsg_type != NLMSG_ERROR || h->nlmsg_seq == 0 || h->nlmsg_seq > requests.size()) continue;
+            const auto* e = static_cast<const nlmsgerr*>(NLMSG_DATA(h));
+            result[h->nlmsg_seq - 1] = -e->error;
+            --pending;
+        }
+    }
+    ::close(fd);
+    return result;
+}
+
+NlRequest newLink(const std::string& name, std::uint16_t flags = NLM_F_CREATE | NLM_F_EXCL) {
+    NlRequest req(RTM_NEWLINK, flags);
+    ifinfomsg ifi{};
+    ifi.ifi_family = AF_UNSPEC;
+    ifi.ifi_flags = IFF_UP;
+    ifi.ifi_change = IFF_UP;
+    req.body(ifi);
+    req.attr(IFLA_IFNAME, name);
+    return req;
+}
+
+NlRequest bridgeRequest(const std::string& name) {
+    auto req = newLink(name);
+    const auto info = req.nest(IFLA_LINKINFO);
+    req.attr(IFLA_INFO_KIND, std::string_view("bridge"));
+    req.close(info);
+    return req;
+}
+
+NlRequest tunnelRequest(const std::string& name, unsigned int vni, unsigned int master, unsigned int underlay,
+                        const FabricOptions& opts) {
+    auto req = newLink(name);
+    req.attr(IFLA_MASTER, static_cast<std::uint32_t>(master));
+    const auto info = req.nest(IFLA_LINKINFO);
+    req.attr(IFLA_INFO_KIND, std::string_view("vxlan"));
+    const auto data = req.nest(IFLA_INFO_DATA);
+    req.attr(IFLA_VXLAN_ID, static_cast<std::uint32_t>(vni));
+    if (underlay) req.attr(IFLA_VXLAN_LINK, static_cast<std::uint32_t>(underlay));
+    req.attr(IFLA_VXLAN_PORT, htons(opts.vxlanPort));
+    req.attr(IFLA_VXLAN_LEARNING, static_cast<std::uint8_t>(1));
+    in_addr group{};
+    if (!opts.multicastGroup.empty() && ::inet_pton(AF_INET, opts.multicastGroup.c_str(), &group) == 1) {
+        req.attr(IFLA_VXLAN_GROUP, group);
+    }
+    req.close(data);
+    req.close(info);
+    return req;
+}
+
+// all-zero FDB entry: flood unknown/broadcast frames to this peer (head-end replication)
+NlRequest peerRequest(unsigned int tunnel, const in_addr& peer) {
+    NlRequest req(RTM_NEWNEIGH, NLM_F_CREATE | NLM_F_APPEND);
+    ndmsg ndm{};
+    ndm.ndm_family = AF_BRIDGE;
+    ndm.ndm_ifindex = static_cast<int>(tunnel);
+    ndm.ndm_state = NUD_NOARP | NUD_PERMANENT;
+    ndm.ndm_flags = NTF_SELF;
+    req.body(ndm);
+    const unsigned char any[6] = {0, 0, 0, 0, 0, 0};
+    req.attr(NDA_LLADDR, any, sizeof(any));
+    req.attr(NDA_DST, peer);
+    return req;
+}
+
+NlRequest deleteRequest(const std::string& name) {
+    NlRequest req(RTM_DELLINK, 0);
+    ifinfomsg ifi{};
+    ifi.ifi_family = AF_UNSPEC;
+    req.body(ifi);
+    req.attr(IFLA_IFNAME, name);
+    return req;
+}
+
+} // namespace
+
+NetworkFabric::NetworkFabric(std::shared_ptr<HypervisorConnector> connector, FabricOptions options,
+                             std::shared_ptr<SegmentAllocator> segments)
+    : connector(std::move(connector)), opts(std::move(options)),
+      segments(segments ? std::move(segments) : std::make_shared<SegmentAllocator>()),
+      holder(this->connector ? this->connector->getUri() : std::string{}) {}
+
+std::string NetworkFabric::labPrefix(std::string_view lab) {
+    return std::string(kPrefix) + std::string(lab) + "-";
+}
+
+bool NetworkFabric::isLabNetwork(std::string_view network) noexcept {
+    return network.starts_with(kPrefix);
+}
+
+// FNV-1a folded to 24 bits; 0 is not a valid VNI. Only where the search for a free id starts
+unsigned int NetworkFabric::vniOf(std::string_view network) noexcept {
+    std::uint32_t h = 2166136261u;
+    for (unsigned char c : network) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    const unsigned int vni = (h >> 24) ^ (h & 0xFFFFFF);
+    return vni == 0 ? 1 : vni;
+}
+
+void NetworkFabric::seedSegments() {
+    // ids of segments defined before a restart, or before the allocator knew them, stay taken
+    if (opts.mode == FabricOptions::Mode::Isolated) {
+        segmentsSeeded = true;
+        return;
+    }
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception& e) {
+        BoostLogger::Warn(std::string("NetworkFabric: cannot read the defined segments: ") + e.what());
+        return; // retried on the next use
+    }
+    segmentsSeeded = true;
+    const auto kind = kindOf(opts);
+    virNetworkPtr* nets = nullptr;
+    const int n = virConnectListAllNetworks(lease.get(), &nets, 0);
+    for (int i = 0; i < n; ++i) {
+        const char* name = virNetworkGetName(nets[i]);
+        if (name && isLabNetwork(name)) {
+            if (char* xml = virNetworkGetXMLDesc(nets[i], 0)) {
+                const std::string_view text(xml);
+                unsigned int id = 0;
+                if (kind == SegmentKind::Vlan) {
+                    if (auto at = text.find("<tag id='"); at != std::string_view::npos) {
+                        id = static_cast<unsigned int>(std::strtoul(xml + at + 9, nullptr, 10));
+                    }
+                } else if (auto at = text.find("<bridge name='phb"); at != std::string_view::npos) {
+                    id = static_cast<unsigned int>(std::strtoul(xml + at + 17, nullptr, 16));
+                }
+                if (id != 0 && !segments->adopt(kind, name, holder, id)) {
+                    BoostLogger::Warn("NetworkFabric: " + std::string(name) + " uses segment id " + std::to_string(id) +
+                                      ", which " + segments->owner(kind, id).value_or("another segment") + " holds");
+                }
+                free(xml);
+            }
+        }
+        virNetworkFree(nets[i]);
+    }
+    free(nets);
+}
+
+Result<unsigned int> NetworkFabric::segmentId(const std::string& name) {
+    std::lock_guard lock(mutex_);
+    if (!segmentsSeeded) seedSegments();
+    const unsigned int hint = vniOf(name);
+    if (opts.mode == FabricOptions::Mode::Vlan) {
+        return segments->acquire(SegmentKind::Vlan, name, holder, opts.vlanFirst, opts.vlanLast, hint);
+    }
+    // VNIs start at 1: the hash itself is tried first
+    return segments->acquire(SegmentKind::Vni, name, holder, 1, kVniLast, hint - 1);
+}
+
+void NetworkFabric::releaseSegments(const std::vector<std::string>& networks) {
+    if (opts.mode == FabricOptions::Mode::Isolated) return;
+    const auto kind = kindOf(opts);
+    for (const auto& n : networks) {
+        if (auto released = segments->release(kind, n, holder); released.isErr()) {
+            BoostLogger::Warn("NetworkFabric: " + released.unwrapErr());
+        }
+    }
+}
+
+std::string NetworkFabric::networkXml(const std::string& name, unsigned int id) const {
+    std::string xml = "<network><name>" + name + "</name>";
+    switch (opts.mode) {
+        case FabricOptions::Mode::Isolated:
+            // no <forward>: isolated L2 segment; libvirt picks the bridge name
+            xml += "<bridge stp='off' delay='0'/>";
+            break;
+        case FabricOptions::Mode::Vlan:
+            xml += "<forward mode='bridge'/><bridge name='" + opts.ovsBridge + "'/><virtualport type='openvswitch'/>";
+            xml += "<vlan><tag id='" + std::to_string(id) + "'/></vlan>";
+            break;
+        case FabricOptions::Mode::Vxlan:
+            xml += "<forward mode='bridge'/><bridge name='" + bridgeOf(id) + "'/>";
+            break;
+    }
+    xml += "</network>";
+    return xml;
+}
+
+std::vector<std::string> NetworkFabric::createLinks(const std::vector<std::string>& networks,
+                                                   const std::vector<unsigned int>& vnis) {
+    std::vector<std::string> errors(networks.size());
+    const auto failed = [&](std::size_t i, const char* what, int err) {
+        if (err == 0 || err == EEXIST || !errors[i].empty()) return;
+        errors[i] = std::string(what) + " for " + networks[i] + ": " + std::strerror(err);
+    };
+
+    // 1) bridges (created up)
+    std::vector<NlRequest> bridges;
+    for (auto vni : vnis) bridges.push_back(bridgeRequest(bridgeOf(vni)));
+    const auto made = runBatch(bridges);
+    for (std::size_t i = 0; i < networks.size(); ++i) failed(i, "bridge", made[i]);
+
+    // 2) tunnels enslaved to them, then the flood entries of the peers
+    const unsigned int underlay = opts.underlay.empty() ? 0 : if_nametoindex(opts.underlay.c_str());
+    if (!opts.underlay.empty() && underlay == 0) {
+        for (std::size_t i = 0; i < networks.size(); ++i) failed(i, "underlay", ENODEV);
+        return errors;
+    }
+    std::vector<NlRequest> tunnels;
+    std::vector<std::size_t> owner;
+    for (std::size_t i = 0; i < networks.size(); ++i) {
+        if (!errors[i].empty()) continue;
+        const unsigned int master = if_nametoindex(bridgeOf(vnis[i]).c_str());
+        if (master == 0) { failed(i, "bridge", ENODEV); continue; }
+        tunnels.push_back(tunnelRequest(tunnelOf(vnis[i]), vnis[i], master, underlay, opts));
+        owner.push_back(i);
+    }
+    const auto linked = runBatch(tunnels);
+    for (std::size_t k = 0; k < owner.size(); ++k) failed(owner[k], "vxlan", linked[k]);
+
+    if (!opts.multicastGroup.empty() || opts.peers.empty()) return errors;
+    std::vector<in_addr> peers;
+    for (const auto& p : opts.peers) {
+        in_addr a{};
+        if (::inet_pton(AF_INET, p.c_str(), &a) == 1) peers.push_back(a);
+    }
+    std::vector<NlRequest> fdb;
+    owner.clear();
+    for (std::size_t i = 0; i < networks.size(); ++i) {
+        if (!errors[i].empty()) continue;
+        const unsigned int tunnel = if_nametoindex(tunnelOf(vnis[i]).c_str());
+        if (tunnel == 0) { failed(i, "vxlan", ENODEV); continue; }
+        for (const auto& peer : peers) {
+            fdb.push_back(peerRequest(tunnel, peer));
+            owner.push_back(i);
+        }
+    }
+    const auto flooded = runBatch(fdb);
+    for (std::size_t k = 0; k < owner.size(); ++k) failed(owner[k], "vxlan peer", flooded[k]);
+    return errors;
+}
+
+std::set<std::string> NetworkFabric::deleteLinks(const std::vector<std::string>& networks) {
+    std::vector<NlRequest> requests;
+    std::vector<const std::string*> owner;
+    for (const auto& n : networks) {
+        const auto vni = segments->find(SegmentKind::Vni, n);
+        if (!vni) continue; // never got links from this fabric
+        requests.push_back(deleteRequest(tunnelOf(*vni)));
+        requests.push_back(deleteRequest(bridgeOf(*vni)));
+        owner.push_back(&n);
+    }
+    std::set<std::string> kept;
+    const auto res = runBatch(requests);
+    for (std::size_t k = 0; k < res.size(); ++k) {
+        if (res[k] != 0 && res[k] != ENODEV) {
+            BoostLogger::Warn("NetworkFabric: cannot delete links of " + *owner[k / 2] + ": " + std::strerror(res[k]));
+            kept.insert(*owner[k / 2]);
+        }
+    }
+    return kept;
+}
+
+std::vector<std::string> NetworkFabric::ensure(const std::vector<std::string>& networks) {
+    std::vector<std::string> errors(networks.size());
+    std::vector<std::size_t> todo;
+    std::vector<std::pair<std::size_t, std::size_t>> repeats; // a name given twice -> its first occurrence
+    {
+        std::lock_guard lock(mutex_);
+        std::map<std::string_view, std::size_t> first;
+        for (std::size_t i = 0; i < networks.size(); ++i) {
+            if (ready.contains(networks[i])) continue;
+            auto [it, fresh] = first.try_emplace(networks[i], i);
+            if (fresh) todo.push_back(i);
+            else repeats.emplace_back(i, it->second);
+        }
+    }
+    if (todo.empty()) return errors;
+
+    // tags/VNIs up front: the define below runs on a pool lease and must not wait for another one
+    std::vector<unsigned int> ids(networks.size(), 0);
+    if (opts.mode != FabricOptions::Mode::Isolated) {
+        for (auto i : todo) {
+            auto id = segmentId(networks[i]);
+            if (id.isErr()) errors[i] = std::move(id).unwrapErr();
+            else ids[i] = id.unwrap();
+        }
+    }
+
+    if (opts.mode == FabricOptions::Mode::Vxlan) {
+        std::vector<std::string> names;
+        std::vector<unsigned int> vnis;
+        std::vector<std::size_t> owner;
+        for (auto i : todo) {
+            if (!errors[i].empty()) continue;
+            names.push_back(networks[i]);
+            vnis.push_back(ids[i]);
+            owner.push_back(i);
+        }
+        auto linkErrors = createLinks(names, vnis);
+        for (std::size_t k = 0; k < owner.size(); ++k) errors[owner[k]] = std::move(linkErrors[k]);
+    }
+
+    parallelFor(todo.size(), connector->getPoolSize(), [&](std::size_t k) {
+        const std::size_t i = todo[k];
+        if (!errors[i].empty()) return;
+        const auto& name = networks[i];
+        HypervisorConnectionPool::Lease lease;
+        try {
+            lease = connector->acquire();
+        } catch (const std::exception& e) {
+            errors[i] = std::string("Not connected: ") + e.what();
+            return;
+        }
+        virNetworkPtr net = virNetworkLookupByName(lease.get(), name.c_str());
+        if (!net) {
+            net = virNetworkDefineXML(lease.get(), networkXml(name, ids[i]).c_str());
+            if (!net) { errors[i] = lastError("virNetworkDefineXML " + name); return; }
+        }
+        // a concurrent ensure of the same segment may have started it already
+        if (virNetworkIsActive(net) != 1 && virNetworkCreate(net) < 0) errors[i] = lastError("virNetworkCreate " + name);
+        else virNetworkSetAutostart(net, 1);
+        virNetworkFree(net);
+    }, [&](std::size_t k, std::string what) { errors[todo[k]] = std::move(what); });
+
+    for (const auto& [i, first] : repeats) errors[i] = errors[first];
+    std::lock_guard lock(mutex_);
+    for (auto i : todo) {
+        if (errors[i].empty()) ready.insert(networks[i]);
+    }
+    return errors;
+}
+
+std::vector<std::string> NetworkFabric::remove(const std::vector<std::string>& networks) {
+    std::vector<std::string> errors(networks.size());
+    {
+        // the ids of segments defined before a restart are read from libvirt before they go
+        std::lock_guard lock(mutex_);
+        if (!segmentsSeeded) seedSegments();
+    }
+    parallelFor(networks.size(), connector->getPoolSize(), [&](std::size_t i) {
+        HypervisorConnectionPool::Lease lease;
+        try {
+            lease = connector->acquire();
+        } catch (const std::exception& e) {
+            errors[i] = std::string("Not connected: ") + e.what();
+            return;
+        }
+        virNetworkPtr net = virNetworkLookupByName(lease.get(), networks[i].c_str());
+        if (!net) return;
+        if (virNetworkIsActive(net) == 1 && virNetworkDestroy(net) < 0) errors[i] = lastError("virNetworkDestroy");
+        else if (virNetworkUndefine(net) < 0) errors[i] = lastError("virNetworkUndefine");
+        virNetworkFree(net);
+    }, [&](std::size_t i, std::string what) { errors[i] = std::move(what); });
+
+    std::vector<std::string> gone;
+    {
+        std::lock_guard lock(mutex_);
+        for (std::size_t i = 0; i < networks.size(); ++i) {
+            if (!errors[i].empty()) continue;
+            ready.erase(networks[i]);
+            gone.push_back(networks[i]);
+        }
+    }
+    // libvirt does not own the bridges of bridge-mode networks; a VNI whose links are still up stays held
+    if (opts.mode == FabricOptions::Mode::Vxlan && !gone.empty()) {
+        const auto kept = deleteLinks(gone);
+        std::erase_if(gone, [&](const std::string& n) { return kept.contains(n); });
+    }
+    releaseSegments(gone);
+    return errors;
+}
+
+Result<std::size_t> NetworkFabric::releaseLab(std::string_view lab) {
+    const auto prefix = labPrefix(lab);
+    std::vector<std::string> names;
+    try {
+        auto lease = connector->acquire();
+        virNetworkPtr* nets = nullptr;
+        const int n = virConnectListAllNetworks(lease.get(), &nets, 0);
+        if (n < 0) return Result<std::size_t>{lastError("virConnectListAllNetworks failed")};
+        for (int i = 0; i < n; ++i) {
+            if (const char* name = virNetworkGetName(nets[i]); name && std::string_view(name).starts_with(prefix)) names.emplace_back(name);
+            virNetworkFree(nets[i]);
+        }
+        free(nets);
+    } catch (const std::exception& e) {
+        return Result<std::size_t>{std::string("Not connected: ") + e.what()};
+    }
+
+    const auto errors = remove(names);
+    std::size_t removed = 0;
+    std::string firstError;
+    for (const auto& e : errors) {
+        if (e.empty()) ++removed;
+        else if (firstError.empty()) firstError = e;
+    }
+    if (!firstError.empty()) return Result<std::size_t>{"Lab " + std::string(lab) + ": " + firstError};
+    BoostLogger::Info("NetworkFabric: released " + std::to_string(removed) + " networks of lab " + std::string(lab));
+    return Result<std::size_t>{removed};
+}
+
+void NetworkFabric::retain(const std::string& lab, const std::string& domain) {
+    std::lock_guard lock(mutex_);
+    labDomains[lab].insert(domain);
+    domainLab[domain] = lab;
+}
+
+std::optional<std::string> NetworkFabric::release(const std::string& domain) {
+    std::lock_guard lock(mutex_);
+    auto it = domainLab.find(domain);
+    if (it == domainLab.end()) return std::nullopt;
+    const std::string lab = std::move(it->second);
+    domainLab.erase(it);
+    auto members = labDomains.find(lab);
+    if (members == labDomains.end()) return std::nullopt;
+    members->second.erase(domain);
+    if (!members->second.empty()) return std::nullopt;
+    labDomains.erase(members);
+    return lab;
+}
@@ -0,0 +1,243 @@
+#include "Virtualization/vmm/PlacementEngine.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <pugixml.hpp>
+
+namespace {
+
+std::string joinCpus(const std::vector<int>& cpus) {
+    std::string out;
+    for (int c : cpus) {
+        if (!out.empty()) out += ',';
+        out += std::to_string(c);
+    }
+    return out;
+}
+
+} // namespace
+
+std::size_t HostTopology::cpuCount() const noexcept {
+    std::size_t n = 0;
+    for (const auto& cell : cells) n += cell.cpus.size();
+    return n;
+}
+
+Result<HostTopology> HostTopology::fromCapabilities(const std::string& capsXml) {
+    pugi::xml_document doc;
+    if (!doc.load_string(capsXml.c_str())) return Result<HostTopology>{std::string("Invalid capabilities XML")};
+    auto cells = doc.child("capabilities").child("host").child("topology").child("cells");
+    if (!cells) return Result<HostTopology>{std::string("Capabilities have no NUMA topology")};
+
+    HostTopology topo;
+    for (auto cell : cells.children("cell")) {
+        NumaCell c;
+        c.id = cell.attribute("id").as_int();
+        c.memoryKiB = cell.child("memory").text().as_ullong();
+        for (auto pages : cell.children("pages")) {
+            c.hugepages[pages.attribute("size").as_uint()] = pages.text().as_ullong();
+        }
+        for (auto cpu : cell.child("cpus").children("cpu")) {
+            HostCpu hc;
+            hc.id = cpu.attribute("id").as_int();
+            hc.socket = cpu.attribute("socket_id").as_int();
+            hc.core = cpu.attribute("core_id").as_int();
+            hc.siblings = cpu.attribute("siblings").as_string();
+            c.cpus.push_back(std::move(hc));
+        }
+        topo.cells.push_back(std::move(c));
+    }
+    if (topo.cells.empty()) return Result<HostTopology>{std::string("Capabilities list no NUMA cells")};
+    return Result<HostTopology>{std::move(topo)};
+}
+
+PlacementEngine::PlacementEngine(HostTopology topology, PlacementOptions options)
+    : topo(std::move(topology)), opts(std::move(options))
+{
+    if (opts.overcommit == 0) opts.overcommit = 1;
+}
+
+Result<HostTopology> PlacementEngine::readHostTopology(virConnectPtr conn) {
+    if (!conn) return Result<HostTopology>{std::string("No libvirt connection")};
+    char* caps = virConnectGetCapabilities(conn);
+    if (!caps) {
+        virErrorPtr err = virGetLastError();
+        return Result<HostTopology>{std::string("virConnectGetCapabilities failed: ") + (err && err->message ? err->message : "unknown")};
+    }
+    std::string xml(caps);
+    free(caps);
+    return HostTopology::fromCapabilities(xml);
+}
+
+Result<CpuPlacement> PlacementEngine::place(const std::string& domain, unsigned int vcpus, unsigned long long memoryKiB,
+                                            const std::string& shareGroup) {
+    std::lock_guard lock(mutex_);
+    if (reservations.count(domain)) return Result<CpuPlacement>{std::string("Domain already placed: ") + domain};
+
+    // best cell: fits, then lowest vCPU load ratio, then lowest memory commitment
+    const NumaCell* best = nullptr;
+    double bestLoad = std::numeric_limits<double>::max();
+    unsigned long long bestMem = 0;
+    std::vector<const HostCpu*> bestCpus;
+    const std::map<int, unsigned int>* siblings = nullptr;
+    if (!shareGroup.empty()) {
+        if (auto it = groupCells.find(shareGroup); it != groupCells.end()) siblings = &it->second;
+    }
+    const double memoryFactor = opts.hugepageSizeKiB > 0 ? 1.0 : std::max(1.0, opts.memoryOvercommit);
+    std::map<int, double> busy; // cell -> observed busy vCPUs
+    if (opts.observedLoadWeight > 0) {
+        for (const auto& [_, r] : reservations) {
+            if (r.cell >= 0) busy[r.cell] += r.observed;
+        }
+    }
+    for (const auto& cell : topo.cells) {
+        std::vector<const HostCpu*> usable;
+        unsigned int pinned = 0;
+        for (const auto& cpu : cell.cpus) {
+            if (opts.reservedCpus.count(cpu.id)) continue;
+            usable.push_back(&cpu);
+            pinned += cpuLoad[cpu.id];
+        }
+        if (usable.empty() || vcpus > usable.size()) continue;
+        const auto committed = cellMemory[cell.id];
+        if (static_cast<double>(committed + memoryKiB) > static_cast<double>(cell.memoryKiB) * memoryFactor) continue;
+        if (pinned + vcpus > usable.size() * opts.overcommit) continue;
+        if (opts.hugepageSizeKiB > 0) {
+            auto it = cell.hugepages.find(opts.hugepageSizeKiB);
+            if (it == cell.hugepages.end() || it->second * opts.hugepageSizeKiB < committed + memoryKiB) continue;
+        }
+        double load = static_cast<double>(pinned + vcpus) / static_cast<double>(usable.size());
+        if (auto it = busy.find(cell.id); it != busy.end()) load += opts.observedLoadWeight * it->second / static_cast<double>(usable.size());
+        if (siblings && siblings->count(cell.id)) load -= opts.sharedBaseAffinity;
+        if (!best || load < bestLoad || (load == bestLoad && committed < bestMem)) {
+            best = &cell;
+            bestLoad = load;
+            bestMem = committed;
+            bestCpus = std::move(usable);
+        }
+    }
+
+    CpuPlacement placement;
+    Reservation res;
+    res.memoryKiB = memoryKiB;
+    res.group = shareGroup;
+    if (!best) {
+        // too big for any single cell: no pins, spread the memory instead of overflowing one node
+        std::string all;
+        for (const auto& cell : topo.cells) {
+            if (!all.empty()) all += ',';
+            all += std::to_string(cell.id);
+        }
+        placement.memoryNodes = all;
+        placement.numaMode = "interleave";
+        reservations.emplace(domain, std::move(res));
+        return Result<CpuPlacement>{std::move(placement)};
+    }
+
+    // least loaded CPUs first; a core whose sibling was already taken for this domain goes last
+    std::vector<int> chosen;
+    std::set<std::pair<int, int>> usedCores; // (socket, core)
+    for (unsigned int i = 0; i < vcpus; ++i) {
+        auto pick = std::min_element(bestCpus.begin(), bestCpus.end(), [&](const HostCpu* a, const HostCpu* b) {
+            const bool aShared = usedCores.count({a->socket, a->core}) > 0;
+            const bool bShared = usedCores.count({b->socket, b->core}) > 0;
+            if (aShared != bShared) return !aShared;
+            if (cpuLoad[a->id] != cpuLoad[b->id]) return cpuLoad[a->id] < cpuLoad[b->id];
+            return a->id < b->id;
+        });
+        const HostCpu* cpu = *pick;
+        chosen.push_back(cpu->id);
+        usedCores.insert({cpu->socket, cpu->core});
+        bestCpus.erase(pick);
+    }
+
+    std::vector<int> cellCpus;
+    for (const auto& cpu : best->cpus) {
+        if (!opts.reservedCpus.count(cpu.id)) cellCpus.push_back(cpu.id);
+    }
+    for (int cpu : chosen) {
+        placement.vcpuPins.push_back(std::to_string(cpu));
+        ++cpuLoad[cpu];
+    }
+    placement.emulatorPin = joinCpus(cellCpus);
+    placement.memoryNodes = std::to_string(best->id);
+    placement.numaMode = "strict";
+    placement.hugepageSizeKiB = opts.hugepageSizeKiB;
+
+    cellMemory[best->id] += memoryKiB;
+    res.cell = best->id;
+    res.cpus = std::move(chosen);
+    if (!shareGroup.empty()) ++groupCells[shareGroup][best->id];
+    reservations.emplace(domain, std::move(res));
+    return Result<CpuPlacement>{std::move(placement)};
+}
+
+void PlacementEngine::release(const std::string& domain) {
+    std::lock_guard lock(mutex_);
+    auto it = reservations.find(domain);
+    if (it == reservations.end()) return;
+    for (int cpu : it->second.cpus) {
+        if (cpuLoad[cpu] > 0) --cpuLoad[cpu];
+    }
+    if (it->second.cell >= 0) {
+        auto& mem = cellMemory[it->second.cell];
+        mem = mem > it->second.memoryKiB ? mem - it->second.memoryKiB : 0;
+        if (auto group = groupCells.find(it->second.group); group != groupCells.end()) {
+            if (auto cell = group->second.find(it->second.cell); cell != group->second.end() && --cell->second == 0) group->second.erase(cell);
+            if (group->second.empty()) groupCells.erase(group);
+        }
+    }
+    reservations.erase(it);
+}
+
+void PlacementEngine::observeLoad(const std::vector<std::pair<std::string, double>>& busyVcpus) {
+    // one noisy pass should not move the next placement much
+    constexpr double alpha = 0.3;
+    std::lock_guard lock(mutex_);
+    for (const auto& [domain, vcpus] : busyVcpus) {
+        auto it = reservations.find(domain);
+        if (it == reservations.end()) continue;
+        it->second.observed += alpha * (vcpus - it->second.observed);
+    }
+}
+
+std::map<int, unsigned int> PlacementEngine::cellLoad() const {
+    std::lock_guard lock(mutex_);
+    std::map<int, unsigned int> out;
+    for (const auto& cell : topo.cells) {
+        unsigned int n = 0;
+        for (const auto& cpu : cell.cpus) {
+            auto it = cpuLoad.find(cpu.id);
+            if (it != cpuLoad.end()) n += it->second;
+        }
+        out[cell.id] = n;
+    }
+    return out;
+}
+
+PlacementHeadroom PlacementEngine::headroom() const {
+    std::lock_guard lock(mutex_);
+    PlacementHeadroom out;
+    const double memoryFactor = opts.hugepageSizeKiB > 0 ? 1.0 : std::max(1.0, opts.memoryOvercommit);
+    for (const auto& cell : topo.cells) {
+        unsigned long long usable = 0;
+        unsigned long long pinned = 0;
+        for (const auto& cpu : cell.cpus) {
+            if (opts.reservedCpus.count(cpu.id)) continue;
+            ++usable;
+            if (auto it = cpuLoad.find(cpu.id); it != cpuLoad.end()) pinned += it->second;
+        }
+        const unsigned long long slots = usable * opts.overcommit;
+        if (slots > pinned) out.vcpus += slots - pinned;
+
+        auto limit = static_cast<unsigned long long>(static_cast<double>(cell.memoryKiB) * memoryFactor);
+        if (opts.hugepageSizeKiB > 0) {
+            auto it = cell.hugepages.find(opts.hugepageSizeKiB);
+            limit = it == cell.hugepages.end() ? 0 : std::min(limit, it->second * opts.hugepageSizeKiB);
+        }
+        auto mem = cellMemory.find(cell.id);
+        const unsigned long long committed = mem == cellMemory.end() ? 0 : mem->second;
+        if (limit > committed) out.memoryKiB += limit - committed;
+    }
+    return out;
+}
@@ -0,0 +1,525 @@
+#include "Virtualization/vmm/ReadinessProber.hpp"
+#include "Utils/Logger.hpp"
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <json/json.h>
+#include <libvirt/libvirt-qemu.h>
+#include <libvirt/libvirt.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> splitList(std::string_view v) {
+    std::vector<std::string> out;
+    while (!v.empty()) {
+        const auto comma = v.find(',');
+        auto item = v.substr(0, comma);
+        while (!item.empty() && item.front() == ' ') item.remove_prefix(1);
+        while (!item.empty() && item.back() == ' ') item.remove_suffix(1);
+        if (!item.empty()) out.emplace_back(item);
+        if (comma == std::string_view::npos) break;
+        v.remove_prefix(comma + 1);
+    }
+    return out;
+}
+
+template <typename T>
+std::optional<T> parseNumber(std::string_view sv) {
+    T value{};
+    auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+    if (ec != std::errc{} || ptr != sv.data() + sv.size()) return std::nullopt;
+    return value;
+}
+
+// the "return" member of a guest agent reply; nullopt when the agent did not answer
+std::optional<Json::Value> agentCommand(virDomainPtr dom, const Json::Value& command, int timeoutSeconds) {
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    char* raw = virDomainQemuAgentCommand(dom, Json::writeString(writer, command).c_str(), timeoutSeconds, 0);
+    if (!raw) return std::nullopt;
+    Json::Value reply;
+    Json::CharReaderBuilder reader;
+    std::string errors;
+    std::istringstream in(raw);
+    const bool parsed = Json::parseFromStream(reader, in, &reply, &errors);
+    free(raw);
+    if (!parsed || !reply.isObject()) return std::nullopt;
+    return reply["return"];
+}
+
+bool usable(const virDomainIPAddress& a) {
+    if (!a.addr) return false;
+    const std::string_view addr(a.addr);
+    if (a.type == VIR_IP_ADDR_TYPE_IPV4) return !addr.starts_with("127.") && !addr.starts_with("169.254.");
+    return addr != "::1" && !addr.starts_with("fe80");
+}
+
+// first routable address, IPv4 before IPv6
+std::string pickAddress(virDomainPtr dom, unsigned int source) {
+    virDomainInterfacePtr* ifaces = nullptr;
+    const int n = virDomainInterfaceAddresses(dom, &ifaces, source, 0);
+    if (n < 0) return {};
+    std::string v4;
+    std::string v6;
+    for (int i = 0; i < n; ++i) {
+        const auto* iface = ifaces[i];
+        if (iface->name && std::string_view(iface->name) == "lo") continue;
+        for (unsigned int j = 0; j < iface->naddrs; ++j) {
+            const auto& a = iface->addrs[j];
+            if (!usable(a)) continue;
+            if (a.type == VIR_IP_ADDR_TYPE_IPV4 && v4.empty()) v4 = a.addr;
+            else if (a.type != VIR_IP_ADDR_TYPE_IPV4 && v6.empty()) v6 = a.addr;
+        }
+    }
+    for (int i = 0; i < n; ++i) virDomainInterfaceFree(ifaces[i]);
+    free(ifaces);
+    return v4.empty() ? v6 : v4;
+}
+
+} // namespace
+
+ReadinessSpec ReadinessSpec::fromConfig(const VmConfig& cfg) {
+    ReadinessSpec spec;
+    auto get = [&](const char* key) -> std::optional<std::string_view> {
+        auto it = cfg.metadata.find(key);
+        if (it == cfg.metadata.end()) return std::nullopt;
+        return std::string_view(it->second);
+    };
+    if (auto v = get("ready.agent")) spec.agent = *v != "0";
+    if (auto v = get("ready.address")) spec.address = *v != "0";
+    if (auto v = get("ready.services")) spec.services = splitList(*v);
+    if (auto v = get("ready.tcp")) {
+        for (const auto& p : splitList(*v)) {
+            if (auto port = parseNumber<std::uint16_t>(p); port && *port > 0) spec.tcpPorts.push_back(*port);
+        }
+    }
+    if (auto v = get("ready.host")) spec.tcpHost = std::string(*v);
+    if (auto v = get("ready.timeout")) {
+        if (auto s = parseNumber<unsigned int>(*v); s && *s > 0) spec.timeout = std::chrono::seconds(*s);
+    }
+    return spec;
+}
+
+struct ReadinessProber::Probe {
+    std::string domain;
+    ReadinessSpec spec;
+    std::map<std::string, long long> execs; // in and out
+    std::string address;                    // in: last known, out: current
+    std::string failure;                    // first check that failed; empty = ready
+};
+
+ReadinessProber::ReadinessProber(std::shared_ptr<HypervisorConnector> connector, ReadinessOptions options)
+    : connector(std::move(connector)), opts(options) {}
+
+ReadinessProber::~ReadinessProber() {
+    stop();
+}
+
+void ReadinessProber::start(CONCURRENCY::TimerWheel& timers) {
+    stop();
+    std::lock_guard lock(mutex_);
+    wheel = &timers;
+    cancelFlag = std::make_shared<std::atomic<bool>>(false);
+    // domains watched before the start wait for their first round
+    for (auto& [name, g] : groups) arm(name, g);
+}
+
+void ReadinessProber::stop() noexcept {
+    std::vector<ReadinessStatus> changed;
+    std::vector<std::pair<Settled, ReadinessStatus>> settled;
+    {
+        std::lock_guard lock(mutex_);
+        if (cancelFlag) cancelFlag->store(true);
+        cancelFlag.reset();
+        wheel = nullptr;
+        for (auto& [_, g] : groups) {
+            g.timer = {};
+            g.armedFor = Clock::time_point::max();
+        }
+        // nothing probes them any more: waiters must not hang on a Probing status
+        for (auto& [_, t] : targets) {
+            if (t.status.state != ReadinessState::Probing) continue;
+            t.probing = false;
+            settle(t, ReadinessState::Failed, "prober stopped", settled);
+            changed.push_back(t.status);
+        }
+    }
+    try {
+        notify(changed, settled);
+    } catch (...) {
+        // a listener threw; stop() runs from the destructor
+    }
+}
+
+void ReadinessProber::watch(const std::string& domain, const std::string& group, ReadinessSpec spec, Settled onSettled) {
+    std::vector<ReadinessStatus> changed;
+    std::vector<std::pair<Settled, ReadinessStatus>> settled;
+    {
+        std::lock_guard lock(mutex_);
+        const auto now = Clock::now();
+        auto [it, added] = targets.try_emplace(domain);
+        auto& t = it->second;
+        if (!added) {
+            // redeployed under the same name: the old watch is over
+            if (t.status.state == ReadinessState::Probing) settle(t, ReadinessState::Failed, "watched again", settled);
+            if (t.status.group != group) dropMember(t.status.group, domain);
+        }
+        t = Target{};
+        t.spec = std::move(spec);
+        t.status.domain = domain;
+        t.status.group = group;
+        t.started = now;
+        t.backoff = opts.initialDelay;
+        t.due = now + opts.initialDelay;
+        t.onSettled = std::move(onSettled);
+
+        auto& g = groups[group];
+        if (std::find(g.domains.begin(), g.domains.end(), domain) == g.domains.end()) g.domains.push_back(domain);
+        if (t.spec.empty()) settle(t, ReadinessState::Ready, {}, settled);
+        else arm(group, g);
+        changed.push_back(t.status);
+    }
+    notify(changed, settled);
+}
+
+void ReadinessProber::forget(const std::string& domain) {
+    std::vector<std::pair<Settled, ReadinessStatus>> settled;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = targets.find(domain);
+        if (it == targets.end()) return;
+        auto& t = it->second;
+        if (t.status.state == ReadinessState::Probing) settle(t, ReadinessState::Failed, "no longer watched", settled);
+        dropMember(t.status.group, domain);
+        targets.erase(it);
+    }
+    notify({}, settled);
+}
+
+std::optional<ReadinessStatus> ReadinessProber::status(std::string_view domain) const {
+    std::lock_guard lock(mutex_);
+    auto it = targets.find(std::string(domain));
+    if (it == targets.end()) return std::nullopt;
+    auto out = it->second.status;
+    if (out.state == ReadinessState::Probing) {
+        out.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - it->second.started);
+    }
+    return out;
+}
+
+std::vector<ReadinessStatus> ReadinessProber::group(std::string_view name) const {
+    std::lock_guard lock(mutex_);
+    std::vector<ReadinessStatus> out;
+    auto g = groups.find(std::string(name));
+    if (g == groups.end()) return out;
+    const auto now = Clock::now();
+    out.reserve(g->second.domains.size());
+    for (const auto& domain : g->second.domains) {
+        auto it = targets.find(domain);
+        if (it == targets.end()) continue;
+        out.push_back(it->second.status);
+        if (out.back().state == ReadinessState::Probing) {
+            out.back().elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - it->second.started);
+        }
+    }
+    return out;
+}
+
+std::uint64_t ReadinessProber::subscribe(Listener listener) {
+    std::lock_guard lock(listenersMutex);
+    const auto id = nextListenerId++;
+    listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void ReadinessProber::unsubscribe(std::uint64_t id) {
+    std::lock_guard lock(listenersMutex);
+    std::erase_if(listeners, [id](const auto& l) { return l.first == id; });
+}
+
+void ReadinessProber::dropMember(const std::string& name, const std::string& domain) {
+    auto g = groups.find(name);
+    if (g == groups.end()) return;
+    std::erase(g->second.domains, domain);
+    if (!g->second.domains.empty()) return;
+    if (wheel && g->second.timer) wheel->cancel(g->second.timer);
+    // a round in progress finds the group gone and stops there
+    groups.erase(g);
+}
+
+void ReadinessProber::arm(const std::string& name, Group& g) {
+    if (!wheel || g.running) return;
+    auto earliest = Clock::time_point::max();
+    for (const auto& domain : g.domains) {
+        auto it = targets.find(domain);
+        if (it == targets.end() || it->second.status.state != ReadinessState::Probing) continue;
+        earliest = std::min(earliest, it->second.due);
+    }
+    if (earliest == Clock::time_point::max()) {
+        if (g.timer) wheel->cancel(g.timer);
+        g.timer = {};
+        g.armedFor = earliest;
+        return;
+    }
+    if (g.timer && g.armedFor <= earliest) return;
+    if (g.timer) wheel->cancel(g.timer);
+    CONCURRENCY::WheelJobOptions options;
+    options.lane = CONCURRENCY::Lane::Blocking;
+    options.cancelFlag = cancelFlag;
+    const auto delay = std::max(earliest - Clock::now(), Clock::duration::zero());
+    g.timer = wheel->schedule_once(delay, [weak = weak_from_this(), name] {
+        if (auto self = weak.lock()) self->round(name);
+    }, std::move(options));
+    g.armedFor = earliest;
+}
+
+void ReadinessProber::round(const std::string& name) {
+    std::vector<Probe> probes;
+    {
+        std::lock_guard lock(mutex_);
+        auto g = groups.find(name);
+        if (g == groups.end()) return;
+        g->second.timer = {};
+        g->second.armedFor = Clock::time_point::max();
+        g->second.running = true;
+        // the wheel fires on tick boundaries: whatever is due within the next tick goes now
+        const auto horizon = Clock::now() + (wheel ? wheel->tick() : std::chrono::milliseconds(0));
+        for (const auto& domain : g->second.domains) {
+            auto it = targets.find(domain);
+            if (it == targets.end()) continue;
+            auto& t = it->second;
+            if (t.status.state != ReadinessState::Probing || t.due > horizon) continue;
+            t.probing = true;
+            probes.push_back(Probe{domain, t.spec, t.execs, t.status.address, {}});
+        }
+    }
+
+    parallelFor(probes.size(), connector->getPoolSize(), [&](std::size_t i) { probeAgent(probes[i]); },
+                [&](std::size_t i, std::string what) { probes[i].failure = std::move(what); });
+    probeTcp(probes);
+
+    std::vector<ReadinessStatus> changed;
+    std::vector<std::pair<Settled, ReadinessStatus>> settled;
+    {
+        std::lock_guard lock(mutex_);
+        const auto now = Clock::now();
+        for (auto& p : probes) {
+            auto it = targets.find(p.domain);
+            // forgotten or watched again while we were probing
+            if (it == targets.end() || !it->second.probing) continue;
+            auto& t = it->second;
+            t.probing = false;
+            t.execs = std::move(p.execs);
+            ++t.status.attempts;
+            const bool moved = !p.address.empty() && p.address != t.status.address;
+            if (!p.address.empty()) t.status.address = p.address;
+            if (p.failure.empty()) {
+                settle(t, ReadinessState::Ready, {}, settled);
+            } else if (now - t.started >= t.spec.timeout) {
+                BoostLogger::Warn("Readiness of " + p.domain + " timed out: " + p.failure);
+                settle(t, ReadinessState::Failed, "timed out: " + p.failure, settled);
+            } else {
+                t.status.detail = std::move(p.failure);
+                t.backoff = std::min(t.backoff * 2, opts.maxDelay);
+                t.due = now + t.backoff;
+                if (!moved) continue;
+            }
+            changed.push_back(t.status);
+        }
+        if (auto g = groups.find(name); g != groups.end()) {
+            g->second.running = false;
+            arm(name, g->second);
+        }
+    }
+    notify(changed, settled);
+}
+
+void ReadinessProber::settle(Target& t, ReadinessState state, std::string detail,
+                             std::vector<std::pair<Settled, ReadinessStatus>>& settled) {
+    t.status.state = state;
+    t.status.detail = std::move(detail);
+    t.status.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t.started);
+    t.execs.clear();
+    if (t.onSettled) settled.emplace_back(std::exchange(t.onSettled, nullptr), t.status);
+}
+
+void ReadinessProber::notify(const std::vector<ReadinessStatus>& changed,
+                             std::vector<std::pair<Settled, ReadinessStatus>>& settled) {
+    if (!changed.empty()) {
+        std::vector<Listener> copy;
+        {
+            std::lock_guard lock(listenersMutex);
+            copy.reserve(listeners.size());
+            for (const auto& [_, l] : listeners) copy.push_back(l);
+        }
+        for (const auto& status : changed) {
+            for (const auto& l : copy) l(status);
+        }
+    }
+    for (auto& [fn, status] : settled) {
+        try {
+            fn(status);
+        } catch (...) {
+            // a settle callback must not take the round down
+        }
+    }
+}
+
+void ReadinessProber::probeAgent(Probe& p) const {
+    const bool needAgent = p.spec.agent || !p.spec.services.empty();
+    const bool needAddress = p.spec.address || (!p.spec.tcpPorts.empty() && p.spec.tcpHost.empty());
+    if (!needAgent && !needAddress) return;
+
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception& e) {
+        p.failure = std::string("not connected: ") + e.what();
+        return;
+    }
+    virDomainPtr dom = virDomainLookupByName(lease.get(), p.domain.c_str());
+    if (!dom) {
+        p.failure = "domain not found";
+        return;
+    }
+    const int timeout = static_cast<int>(opts.agentTimeout.count());
+
+    if (needAgent) {
+        Json::Value ping;
+        ping["execute"] = "guest-ping";
+        if (!agentCommand(dom, ping, timeout)) {
+            p.failure = "guest agent not answering";
+            virDomainFree(dom);
+            return;
+        }
+    }
+    if (needAddress) {
+        // the agent sees every interface; without one the DHCP leases of libvirt networks are all we have
+        p.address = pickAddress(dom, needAgent ? VIR_DOMAIN_INTERFACE_ADDRESSES_SRC_AGENT : VIR_DOMAIN_INTERFACE_ADDRESSES_SRC_LEASE);
+        if (p.address.empty()) {
+            p.failure = "no address yet";
+            virDomainFree(dom);
+            return;
+        }
+    }
+
+    // start every unit check first, then collect: a check still running is collected next round
+    for (const auto& unit : p.spec.services) {
+        if (p.execs.count(unit)) continue;
+        Json::Value exec;
+        exec["execute"] = "guest-exec";
+        exec["arguments"]["path"] = "systemctl";
+        exec["arguments"]["arg"].append("is-active");
+        exec["arguments"]["arg"].append("--quiet");
+        exec["arguments"]["arg"].append(unit);
+        auto started = agentCommand(dom, exec, timeout);
+        if (started && (*started)["pid"].isIntegral()) p.execs[unit] = (*started)["pid"].asInt64();
+        else if (p.failure.empty()) p.failure = "service " + unit + ": guest-exec refused";
+    }
+    for (const auto& unit : p.spec.services) {
+        auto pid = p.execs.find(unit);
+        if (pid == p.execs.end()) continue;
+        Json::Value query;
+        query["execute"] = "guest-exec-status";
+        query["arguments"]["pid"] = Json::Int64(pid->second);
+        auto status = agentCommand(dom, query, timeout);
+        if (!status) {
+            // the pid is gone (agent restarted): start over
+            p.execs.erase(pid);
+            if (p.failure.empty()) p.failure = "service " + unit + ": status lost";
+            continue;
+        }
+        if (!(*status)["exited"].asBool()) {
+            if (p.failure.empty()) p.failure = "service " + unit + ": check running";
+            continue;
+        }
+        const auto code = (*status)["exitcode"].asInt();
+        p.execs.erase(pid);
+        if (code != 0 && p.failure.empty()) p.failure = "service " + unit + " is not active";
+    }
+    virDomainFree(dom);
+}
+
+void ReadinessProber::probeTcp(std::vector<Probe>& probes) const {
+    struct Connect {
+        std::size_t probe;
+        std::uint16_t port;
+        int fd{-1};
+        std::string error; // set when the connect has failed
+        bool done{false};
+    };
+    std::vector<Connect> connects;
+    for (std::size_t i = 0; i < probes.size(); ++i) {
+        auto& p = probes[i];
+        if (!p.failure.empty() || p.spec.tcpPorts.empty()) continue;
+        const std::string& host = p.spec.tcpHost.empty() ? p.address : p.spec.tcpHost;
+        for (const auto port : p.spec.tcpPorts) {
+            Connect c{i, port, -1, {}, false};
+            addrinfo hints{};
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_NUMERICSERV;
+            addrinfo* res = nullptr;
+            if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) {
+                c.error = "cannot resolve " + host;
+                c.done = true;
+            } else {
+                c.fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                const int rc = c.fd < 0 ? -1 : connect(c.fd, res->ai_addr, res->ai_addrlen);
+                if (rc != 0 && (c.fd < 0 || errno != EINPROGRESS)) {
+                    c.error = std::strerror(errno);
+                    c.done = true;
+                } else if (rc == 0) {
+                    c.done = true; // connected at once (loopback)
+                }
+                freeaddrinfo(res);
+            }
+            connects.push_back(std::move(c));
+        }
+    }
+    if (connects.empty()) return;
+
+    const auto deadline = Clock::now() + opts.tcpTimeout;
+    std::vector<pollfd> fds;
+    std::vector<std::size_t> waiting;
+    for (;;) {
+        fds.clear();
+        waiting.clear();
+        for (std::size_t i = 0; i < connects.size(); ++i) {
+            if (connects[i].done) continue;
+            fds.push_back(pollfd{connects[i].fd, POLLOUT, 0});
+            waiting.push_back(i);
+        }
+        if (fds.empty()) break;
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (left <= 0) break;
+        const int n = poll(fds.data(), fds.size(), static_cast<int>(left));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (std::size_t k = 0; k < fds.size(); ++k) {
+            if (!fds[k].revents) continue;
+            auto& c = connects[waiting[k]];
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+            if (err != 0) c.error = std::strerror(err);
+            c.done = true;
+        }
+    }
+    for (auto& c : connects) {
+        if (!c.done) c.error = "no answer";
+        if (c.fd >= 0) close(c.fd);
+        auto& p = probes[c.probe];
+        if (!c.error.empty() && p.failure.empty()) p.failure = "tcp " + std::to_string(c.port) + ": " + c.error;
+    }
+}
@@ -0,0 +1,176 @@
+#include "Virtualization/vmm/SegmentAllocator.hpp"
+#include "Core/interfaces/IDatabase.hpp"
+#include <algorithm>
+#include <charconv>
+#include <functional>
+
+namespace {
+
+constexpr std::string_view kPrefixes[] = {"fabric/vlan/", "fabric/vni/"};
+constexpr char kSep = '\x1f';
+
+std::string_view prefixOf(SegmentKind kind) noexcept {
+    return kPrefixes[static_cast<std::size_t>(kind)];
+}
+
+std::string key(SegmentKind kind, std::string_view network) {
+    std::string out(prefixOf(kind));
+    out += network;
+    return out;
+}
+
+// upper bound = prefix with its last byte incremented, as in VmMetadataStore
+void scanPrefix(IRocksDB& db, std::string_view prefix, const std::function<void(std::string_view, std::string_view)>& fn) {
+    std::string upper(prefix);
+    upper.back() = static_cast<char>(upper.back() + 1);
+    rocksdb::Slice upperSlice(upper);
+    rocksdb::ReadOptions ro;
+    ro.iterate_upper_bound = &upperSlice;
+    ro.fill_cache = false;
+    auto it = db.NewIterator(ro);
+    if (!it) return;
+    for (it->Seek(rocksdb::Slice(prefix.data(), prefix.size())); it->Valid(); it->Next()) {
+        const auto k = it->key();
+        const auto v = it->value();
+        fn(std::string_view(k.data(), k.size()).substr(prefix.size()), std::string_view(v.data(), v.size()));
+    }
+}
+
+} // namespace
+
+SegmentAllocator::SegmentAllocator(std::shared_ptr<IRocksDB> db)
+    : db(std::move(db)) {}
+
+std::size_t SegmentAllocator::load() {
+    if (!db) return 0;
+    std::lock_guard lock(mutex_);
+    std::size_t loaded = 0;
+    for (auto kind : {SegmentKind::Vlan, SegmentKind::Vni}) {
+        auto& t = table(kind);
+        t.byNetwork.clear();
+        t.byId.clear();
+        scanPrefix(*db, prefixOf(kind), [&](std::string_view network, std::string_view value) {
+            Entry e;
+            const auto idEnd = std::min(value.find(kSep), value.size());
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + idEnd, e.id);
+            if (ec != std::errc{} || e.id == 0) return;
+            for (auto at = idEnd; at < value.size();) {
+                const auto next = std::min(value.find(kSep, at + 1), value.size());
+                if (next > at + 1) e.holders.emplace(value.substr(at + 1, next - at - 1));
+                at = next;
+            }
+            // two rows on one id cannot come from acquire(); the first one keeps it
+            if (e.holders.empty() || !t.byId.try_emplace(e.id, network).second) return;
+            t.byNetwork.emplace(std::string(network), std::move(e));
+            ++loaded;
+        });
+    }
+    return loaded;
+}
+
+Result<void> SegmentAllocator::persist(SegmentKind kind, std::string_view network, const Entry& entry) {
+    if (!db) return Result<void>{};
+    if (entry.holders.empty()) {
+        if (auto st = db->Delete(rocksdb::WriteOptions{}, key(kind, network)); !st) {
+            return Result<void>{"cannot release segment id of " + std::string(network) + ": " + st.error().ToString()};
+        }
+        return Result<void>{};
+    }
+    std::string value = std::to_string(entry.id);
+    for (const auto& h : entry.holders) {
+        value += kSep;
+        value += h;
+    }
+    if (auto st = db->Put(rocksdb::WriteOptions{}, key(kind, network), value); !st) {
+        return Result<void>{"cannot persist segment id of " + std::string(network) + ": " + st.error().ToString()};
+    }
+    return Result<void>{};
+}
+
+Result<unsigned int> SegmentAllocator::acquire(SegmentKind kind, std::string_view network, std::string_view holder,
+                                               unsigned int first, unsigned int last, unsigned int hint) {
+    if (first == 0 || last < first) return Err{std::string("empty segment id range")};
+    std::lock_guard lock(mutex_);
+    auto& t = table(kind);
+    if (auto it = t.byNetwork.find(network); it != t.byNetwork.end()) {
+        if (it->second.holders.contains(holder)) return Result<unsigned int>{it->second.id};
+        Entry next = it->second;
+        next.holders.emplace(holder);
+        if (auto saved = persist(kind, network, next); saved.isErr()) return Err{std::move(saved).unwrapErr()};
+        it->second = std::move(next);
+        return Result<unsigned int>{it->second.id};
+    }
+    const unsigned int span = last - first + 1;
+    for (unsigned int k = 0; k < span; ++k) {
+        Entry e;
+        e.id = first + static_cast<unsigned int>((static_cast<unsigned long long>(hint) + k) % span);
+        if (t.byId.contains(e.id)) continue;
+        e.holders.emplace(holder);
+        if (auto saved = persist(kind, network, e); saved.isErr()) return Err{std::move(saved).unwrapErr()};
+        t.byId.emplace(e.id, std::string(network));
+        const unsigned int id = e.id;
+        t.byNetwork.emplace(std::string(network), std::move(e));
+        return Result<unsigned int>{id};
+    }
+    return Err{"no free segment id for " + std::string(network)};
+}
+
+bool SegmentAllocator::adopt(SegmentKind kind, std::string_view network, std::string_view holder, unsigned int id) {
+    std::lock_guard lock(mutex_);
+    auto& t = table(kind);
+    if (auto it = t.byNetwork.find(network); it != t.byNetwork.end()) {
+        if (it->second.id != id) return false;
+        if (it->second.holders.contains(holder)) return true;
+        Entry next = it->second;
+        next.holders.emplace(holder);
+        if (persist(kind, network, next).isErr()) return false;
+        it->second = std::move(next);
+        return true;
+    }
+    if (id == 0 || t.byId.contains(id)) return false;
+    Entry e;
+    e.id = id;
+    e.holders.emplace(holder);
+    if (persist(kind, network, e).isErr()) return false;
+    t.byId.emplace(id, std::string(network));
+    t.byNetwork.emplace(std::string(network), std::move(e));
+    return true;
+}
+
+Result<void> SegmentAllocator::release(SegmentKind kind, std::string_view network, std::string_view holder) {
+    std::lock_guard lock(mutex_);
+    auto& t = table(kind);
+    auto it = t.byNetwork.find(network);
+    if (it == t.byNetwork.end() || !it->second.holders.contains(holder)) return Result<void>{};
+    Entry next = it->second;
+    next.holders.erase(next.holders.find(holder));
+    if (auto saved = persist(kind, network, next); saved.isErr()) return saved;
+    if (!next.holders.empty()) {
+        it->second = std::move(next);
+        return Result<void>{};
+    }
+    t.byId.erase(it->second.id);
+    t.byNetwork.erase(it);
+    return Result<void>{};
+}
+
+std::optional<unsigned int> SegmentAllocator::find(SegmentKind kind, std::string_view network) const {
+    std::lock_guard lock(mutex_);
+    const auto& t = table(kind);
+    auto it = t.byNetwork.find(network);
+    if (it == t.byNetwork.end()) return std::nullopt;
+    return it->second.id;
+}
+
+std::optional<std::string> SegmentAllocator::owner(SegmentKind kind, unsigned int id) const {
+    std::lock_guard lock(mutex_);
+    const auto& t = table(kind);
+    auto it = t.byId.find(id);
+    if (it == t.byId.end()) return std::nullopt;
+    return it->second;
+}
+
+std::size_t SegmentAllocator::size(SegmentKind kind) const {
+    std::lock_guard lock(mutex_);
+    return table(kind).byNetwork.size();
+}
@@ -0,0 +1,267 @@
+#include "Virtualization/vmm/SnapshotEngine.hpp"
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include "Virtualization/vmm/DomainTemplateCache.hpp"
+#include "Virtualization/vmm/LibvirtCall.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view kMemberPrefix = "snap/";
+
+std::string lastError(const char* what) {
+    virErrorPtr err = virGetLastError();
+    return std::string(what) + ": " + (err && err->message ? err->message : "unknown");
+}
+
+rocksdb::Slice toSlice(std::string_view sv) {
+    return rocksdb::Slice(sv.data(), sv.size());
+}
+
+std::string snapshotXml(const std::string& name, const std::string& description) {
+    std::string xml = "<domainsnapshot><name>";
+    appendXmlEscaped(xml, name);
+    xml += "</name>";
+    if (!description.empty()) {
+        xml += "<description>";
+        appendXmlEscaped(xml, description);
+        xml += "</description>";
+    }
+    xml += "</domainsnapshot>";
+    return xml;
+}
+
+// a domain handle plus the lease of the connection it belongs to
+struct DomainRef {
+    HypervisorConnectionPool::Lease lease;
+    virDomainPtr dom{nullptr};
+
+    DomainRef() = default;
+    DomainRef(const DomainRef&) = delete;
+    DomainRef& operator=(const DomainRef&) = delete;
+    ~DomainRef() { if (dom) virDomainFree(dom); }
+};
+
+Result<void> lookup(HypervisorConnector& connector, std::string_view name, DomainRef& ref) {
+    try {
+        ref.lease = connector.acquire();
+    } catch (const std::exception& e) {
+        return Result<void>{std::string("Not connected: ") + e.what()};
+    }
+    ref.dom = virDomainLookupByName(ref.lease.get(), std::string(name).c_str());
+    if (!ref.dom) return Result<void>{"Domain not found: " + std::string(name)};
+    return Result<void>{};
+}
+
+} // namespace
+
+std::size_t LabRevertResult::succeeded() const noexcept {
+    return static_cast<std::size_t>(std::count_if(outcomes.begin(), outcomes.end(), [](const RevertOutcome& o) { return o.ok(); }));
+}
+
+std::size_t LabRevertResult::failed() const noexcept {
+    return outcomes.size() - succeeded();
+}
+
+SnapshotEngine::SnapshotEngine(std::shared_ptr<HypervisorConnector> connector, std::shared_ptr<IRocksDB> db)
+    : connector(std::move(connector)), db(std::move(db))
+{
+    if (!this->db) return;
+    std::string upper(kMemberPrefix);
+    upper.back() = static_cast<char>(upper.back() + 1);
+    rocksdb::Slice upperSlice(upper);
+    rocksdb::ReadOptions ro;
+    ro.iterate_upper_bound = &upperSlice;
+    ro.fill_cache = false;
+    auto it = this->db->NewIterator(ro);
+    if (!it) return;
+    for (it->Seek(toSlice(kMemberPrefix)); it->Valid(); it->Next()) {
+        const std::string_view k(it->key().data(), it->key().size());
+        // domain names cannot contain '/', so the last one separates lab and domain
+        const auto slash = k.rfind('/');
+        if (slash == std::string_view::npos || slash <= kMemberPrefix.size() || slash + 1 == k.size()) continue;
+        std::string lab(k.substr(kMemberPrefix.size(), slash - kMemberPrefix.size()));
+        std::string domain(k.substr(slash + 1));
+        labMembers[lab].insert(domain);
+        domains[std::move(domain)] = Member{std::move(lab), it->value().ToString()};
+    }
+}
+
+std::string SnapshotEngine::key(const std::string& lab, const std::string& domain) {
+    std::string k(kMemberPrefix);
+    k += lab;
+    k += '/';
+    k += domain;
+    return k;
+}
+
+void SnapshotEngine::setGolden(std::string templateId, GoldenSpec spec) {
+    std::lock_guard lock(mutex_);
+    goldens[std::move(templateId)] = std::move(spec);
+}
+
+GoldenSpec SnapshotEngine::golden(std::string_view templateId) const {
+    std::lock_guard lock(mutex_);
+    auto it = goldens.find(std::string(templateId));
+    return it == goldens.end() ? GoldenSpec{} : it->second;
+}
+
+std::string SnapshotEngine::templateOf(std::string_view domain) const {
+    std::lock_guard lock(mutex_);
+    auto it = domains.find(std::string(domain));
+    return it == domains.end() ? std::string{} : it->second.templateId;
+}
+
+void SnapshotEngine::track(const std::string& domain, const std::string& lab, const std::string& templateId) {
+    std::lock_guard lock(mutex_);
+    if (auto it = domains.find(domain); it != domains.end()) {
+        if (it->second.lab == lab && it->second.templateId == templateId) return;
+        labMembers[it->second.lab].erase(domain);
+        if (db) (void)db->Delete(rocksdb::WriteOptions{}, key(it->second.lab, domain));
+    }
+    if (db) {
+        if (auto res = db->Put(rocksdb::WriteOptions{}, key(lab, domain), templateId); !res) {
+            BoostLogger::Warn("SnapshotEngine: membership of " + domain + " not persisted: " + res.error().ToString());
+        }
+    }
+    domains[domain] = Member{lab, templateId};
+    labMembers[lab].insert(domain);
+}
+
+void SnapshotEngine::untrack(const std::string& domain) {
+    std::lock_guard lock(mutex_);
+    auto it = domains.find(domain);
+    if (it == domains.end()) return;
+    if (db) (void)db->Delete(rocksdb::WriteOptions{}, key(it->second.lab, domain));
+    if (auto lab = labMembers.find(it->second.lab); lab != labMembers.end()) {
+        lab->second.erase(domain);
+        if (lab->second.empty()) labMembers.erase(lab);
+    }
+    domains.erase(it);
+}
+
+std::vector<std::string> SnapshotEngine::members(const std::string& lab) const {
+    std::lock_guard lock(mutex_);
+    auto it = labMembers.find(lab);
+    if (it == labMembers.end()) return {};
+    return {it->second.begin(), it->second.end()};
+}
+
+std::optional<std::string> SnapshotEngine::labOf(std::string_view domain) const {
+    std::lock_guard lock(mutex_);
+    auto it = domains.find(std::string(domain));
+    if (it == domains.end()) return std::nullopt;
+    return it->second.lab;
+}
+
+Result<void> SnapshotEngine::create(virDomainPtr domain, const std::string& name, const SnapshotOptions& options) {
+    if (!domain) return Result<void>{std::string("No domain")};
+    unsigned int flags = VIR_DOMAIN_SNAPSHOT_CREATE_ATOMIC;
+    if (options.mode == SnapshotMode::External) flags |= VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY;
+    virDomainSnapshotPtr snap = virDomainSnapshotCreateXML(domain, snapshotXml(name, options.description).c_str(), flags);
+    if (!snap) return Result<void>{lastError("virDomainSnapshotCreateXML failed")};
+    virDomainSnapshotFree(snap);
+    return Result<void>{};
+}
+
+Result<void> SnapshotEngine::create(std::string_view domain, const std::string& name, const SnapshotOptions& options) {
+    DomainRef ref;
+    if (auto res = lookup(*connector, domain, ref); res.isErr()) return res;
+    return create(ref.dom, name, options);
+}
+
+Result<void> SnapshotEngine::revert(std::string_view domain, const std::string& name, bool startIfShutOff) {
+    DomainRef ref;
+    if (auto res = lookup(*connector, domain, ref); res.isErr()) return res;
+    virDomainSnapshotPtr snap = virDomainSnapshotLookupByName(ref.dom, name.c_str(), 0);
+    if (!snap) return Result<void>{"Snapshot " + name + " not found for " + std::string(domain)};
+    // FORCE: a lab box is reset whatever state the student left it in
+    unsigned int flags = VIR_DOMAIN_SNAPSHOT_REVERT_FORCE;
+    if (startIfShutOff) flags |= VIR_DOMAIN_SNAPSHOT_REVERT_RUNNING;
+    const int rc = LIBVIRT_CALL(virDomainRevertToSnapshot, snap, flags);
+    virDomainSnapshotFree(snap);
+    if (rc < 0) return Result<void>{lastError("virDomainRevertToSnapshot failed")};
+    return Result<void>{};
+}
+
+Result<void> SnapshotEngine::remove(std::string_view domain, const std::string& name) {
+    DomainRef ref;
+    if (auto res = lookup(*connector, domain, ref); res.isErr()) return res;
+    virDomainSnapshotPtr snap = virDomainSnapshotLookupByName(ref.dom, name.c_str(), 0);
+    if (!snap) return Result<void>{"Snapshot " + name + " not found for " + std::string(domain)};
+    const int rc = virDomainSnapshotDelete(snap, 0);
+    virDomainSnapshotFree(snap);
+    if (rc < 0) return Result<void>{lastError("virDomainSnapshotDelete failed")};
+    return Result<void>{};
+}
+
+Result<std::vector<std::string>> SnapshotEngine::list(std::string_view domain) {
+    DomainRef ref;
+    if (auto res = lookup(*connector, domain, ref); res.isErr()) return Result<std::vector<std::string>>{res.unwrapErr()};
+    virDomainSnapshotPtr* snaps = nullptr;
+    const int n = virDomainListAllSnapshots(ref.dom, &snaps, 0);
+    if (n < 0) return Result<std::vector<std::string>>{lastError("virDomainListAllSnapshots failed")};
+    std::vector<std::string> names;
+    names.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) {
+        if (const char* name = virDomainSnapshotGetName(snaps[i])) names.emplace_back(name);
+        virDomainSnapshotFree(snaps[i]);
+    }
+    free(snaps);
+    std::sort(names.begin(), names.end());
+    return Result<std::vector<std::string>>{std::move(names)};
+}
+
+Result<void> SnapshotEngine::captureGolden(virDomainPtr domain, std::string_view templateId) {
+    if (!domain) return Result<void>{std::string("No domain")};
+    const GoldenSpec spec = golden(templateId);
+    // a new golden state replaces the old one under the same name
+    if (virDomainSnapshotPtr old = virDomainSnapshotLookupByName(domain, spec.snapshot.c_str(), 0)) {
+        const int rc = virDomainSnapshotDelete(old, 0);
+        virDomainSnapshotFree(old);
+        if (rc < 0) return Result<void>{lastError("Replacing golden snapshot failed")};
+    }
+    SnapshotOptions options;
+    options.mode = spec.mode;
+    options.description = templateId.empty() ? std::string("golden state") : "golden state of template " + std::string(templateId);
+    return create(domain, spec.snapshot, options);
+}
+
+Result<void> SnapshotEngine::captureGolden(std::string_view domain) {
+    DomainRef ref;
+    if (auto res = lookup(*connector, domain, ref); res.isErr()) return res;
+    return captureGolden(ref.dom, templateOf(domain));
+}
+
+Result<void> SnapshotEngine::revertToGolden(std::string_view domain) {
+    const GoldenSpec spec = golden(templateOf(domain));
+    return revert(domain, spec.snapshot, spec.startAfterRevert);
+}
+
+Result<LabRevertResult> SnapshotEngine::revert_lab(const std::string& lab) {
+    const auto start = Clock::now();
+    LabRevertResult result;
+    result.lab = lab;
+    const auto names = members(lab);
+    if (names.empty()) return Result<LabRevertResult>{"Lab " + lab + " has no tracked VMs"};
+    result.outcomes.resize(names.size());
+    parallelFor(names.size(), connector->getPoolSize(), [&](std::size_t i) {
+        auto& out = result.outcomes[i];
+        out.domain = names[i];
+        const auto t0 = Clock::now();
+        try {
+            auto res = revertToGolden(names[i]);
+            if (res.isErr()) out.error = res.unwrapErr();
+        } catch (const std::exception& e) {
+            out.error = e.what();
+        }
+        out.took = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0);
+    }, [&](std::size_t i, std::string what) { result.outcomes[i].error = std::move(what); });
+    result.total = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+    BoostLogger::Info("revert_lab " + lab + ": " + std::to_string(result.succeeded()) + "/" + std::to_string(names.size())
+        + " VMs reset in " + std::to_string(result.total.count()) + " ms");
+    return Result<LabRevertResult>{std::move(result)};
+}
@@ -0,0 +1,221 @@
+#include "Virtualization/vmm/StartupReconciler.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Utils/Logger.hpp"
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include "Virtualization/vmm/DomainSummary.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+#include <libvirt/libvirt.h>
+#include <pugixml.hpp>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+Result<std::vector<DomainSummary>> listDomains(HypervisorConnector& connector) {
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector.acquire();
+    } catch (const std::exception& e) {
+        return Result<std::vector<DomainSummary>>{std::string("Not connected: ") + e.what()};
+    }
+    return collectDomainSummaries(lease.get(), 0);
+}
+
+// a running domain, or one without a record: its XML says which console ports it holds
+struct Probe {
+    std::string name;
+    std::string uuid;
+    int record{-1}; // pool id, -1 = no record yet
+    int port{-1};
+    int tlsPort{-1};
+    bool found{false};
+    bool ours{false}; // carries PenHive's <metadata>
+};
+
+// libvirt keeps the element but may rewrite its prefix: match the namespace URI
+bool definedByPenHive(const pugi::xml_node& domain) {
+    for (auto node : domain.child("metadata").children()) {
+        for (auto attr : node.attributes()) {
+            if (std::string_view(attr.name()).starts_with("xmlns") && attr.value() == VmConfig::kMetadataNamespace) return true;
+        }
+    }
+    return false;
+}
+
+void probe(HypervisorConnector& connector, Probe& p) {
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector.acquire();
+    } catch (const std::exception&) {
+        return;
+    }
+    virDomainPtr dom = virDomainLookupByName(lease.get(), p.name.c_str());
+    if (!dom) return; // undefined since the list
+    char* xml = virDomainGetXMLDesc(dom, 0);
+    virDomainFree(dom);
+    if (!xml) return;
+    p.found = true;
+    pugi::xml_document doc;
+    if (doc.load_string(xml)) {
+        const auto domain = doc.child("domain");
+        p.ours = definedByPenHive(domain);
+        for (auto g : domain.child("devices").children("graphics")) {
+            const int port = g.attribute("port").as_int(-1);
+            const int tls = g.attribute("tlsPort").as_int(-1);
+            if (p.port <= 0 && port > 0 && port <= 65535) p.port = port;
+            if (p.tlsPort <= 0 && tls > 0 && tls <= 65535) p.tlsPort = tls;
+        }
+    }
+    free(xml);
+}
+
+} // namespace
+
+StartupReconciler::StartupReconciler(VirtualMachinePool& pool, std::shared_ptr<HypervisorConnector> connector)
+    : pool(pool), connector(std::move(connector)) {}
+
+StartupReconciler::~StartupReconciler() = default;
+
+int StartupReconciler::begin(CONCURRENCY::EventDispatcher& dispatcher) {
+    pool.beginRecovery();
+    std::promise<int> loaded;
+    std::shared_future<int> snapshot = loaded.get_future().share();
+    {
+        std::lock_guard lock(mutex_);
+        phase = Phase::Queued;
+    }
+    dispatcher.dispatch(CONCURRENCY::Lane::Blocking, [self = shared_from_this(), snapshot] { self->run(snapshot); });
+    // overlaps with the bulk list; a throw breaks the promise and the job reports it
+    const int records = pool.warmStart();
+    loaded.set_value(records);
+    return records;
+}
+
+void StartupReconciler::cancel() {
+    std::unique_lock lock(mutex_);
+    if (phase == Phase::Queued) {
+        phase = Phase::Cancelled;
+        lock.unlock();
+        pool.endRecovery();
+        return;
+    }
+    phaseChanged.wait(lock, [this] { return phase != Phase::Running; });
+}
+
+bool StartupReconciler::done() const {
+    std::lock_guard lock(mutex_);
+    return phase == Phase::Done;
+}
+
+std::optional<ReconcileReport> StartupReconciler::report() const {
+    std::lock_guard lock(mutex_);
+    return result_;
+}
+
+void StartupReconciler::run(std::shared_future<int> snapshot) {
+    {
+        std::lock_guard lock(mutex_);
+        // cancelled before a thread got to us: the pool may already be gone
+        if (phase != Phase::Queued) return;
+        phase = Phase::Running;
+    }
+    ReconcileReport result;
+    try {
+        result = reconcile(snapshot);
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    } catch (...) {
+        result.error = "unknown error";
+    }
+    pool.endRecovery();
+    finish(std::move(result));
+}
+
+ReconcileReport StartupReconciler::reconcile(std::shared_future<int>& snapshot) {
+    static auto& latency = METRICS::MetricsRegistry::global().histogram("penhive_startup_reconcile_seconds",
+        "Time from startup until the VM pool and libvirt agree");
+    const auto t0 = Clock::now();
+    ReconcileReport out;
+    auto listed = listDomains(*connector);
+    out.records = static_cast<std::size_t>(snapshot.get());
+    if (listed.isErr()) {
+        // the snapshot's ports are reserved already, plus any persisted port/ key; drift waits for the next start
+        (void)pool.repair(PoolRepair{});
+        out.error = listed.unwrapErr();
+        out.took = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0);
+        return out;
+    }
+    const auto& domains = listed.unwrap();
+    out.domains = domains.size();
+
+    const auto records = pool.records();
+    PoolRepair drift;
+    std::unordered_map<std::string_view, const VmRecord*> byName;
+    for (const auto& r : records) {
+        if (r.name.empty()) continue;
+        // libvirt names are unique: a second record of one name is a leftover
+        if (!byName.emplace(r.name, &r).second) drift.stale.push_back(r.id);
+    }
+    std::unordered_set<std::string_view> live;
+    std::vector<Probe> probes;
+    for (const auto& d : domains) {
+        live.insert(d.name);
+        auto it = byName.find(d.name);
+        // every running domain is read: the ports it listens on are taken whoever defined it
+        if (it == byName.end()) probes.push_back(Probe{d.name, d.uuid, -1});
+        else if (d.active) probes.push_back(Probe{d.name, d.uuid, it->second->id});
+    }
+    for (const auto& [name, record] : byName) {
+        if (!live.count(name)) drift.stale.push_back(record->id);
+    }
+
+    // a probe that throws counts as a domain gone since the listing, like one probe() cannot read
+    parallelFor(probes.size(), connector->getPoolSize(), [&](std::size_t i) { probe(*connector, probes[i]); },
+                [&](std::size_t i, std::string what) {
+                    probes[i].found = false;
+                    BoostLogger::Warn("Startup reconcile: cannot read " + probes[i].name + ": " + what);
+                });
+    out.probed = probes.size();
+    std::unordered_map<int, int> recorded; // pool id -> console port of its record
+    for (const auto& r : records) recorded.emplace(r.id, r.consolePort);
+    for (const auto& p : probes) {
+        if (!p.found) continue;
+        drift.livePorts.push_back(p.port);
+        drift.livePorts.push_back(p.tlsPort);
+        if (p.record < 0) {
+            // domains of other tools on the same libvirt are left alone
+            if (p.ours) drift.adopted.push_back(VmRecord{-1, p.uuid, p.name, p.port});
+            else ++out.foreign;
+        } else if (p.port > 0 && recorded[p.record] != p.port) {
+            drift.ports.emplace_back(p.record, p.port);
+        }
+    }
+    out.stale = drift.stale.size();
+    out.adopted = drift.adopted.size();
+    out.ports = drift.ports.size();
+    // also when nothing drifted: the sweep marks the live and persisted ports
+    if (auto res = pool.repair(drift); res.isErr()) out.error = res.unwrapErr();
+    latency.observe(Clock::now() - t0);
+    out.took = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0);
+    return out;
+}
+
+void StartupReconciler::finish(ReconcileReport result) {
+    if (result.error.empty()) {
+        BoostLogger::Info("Startup reconcile: " + std::to_string(result.records) + " records, " + std::to_string(result.domains)
+            + " domains; " + std::to_string(result.stale) + " stale, " + std::to_string(result.adopted) + " adopted, "
+            + std::to_string(result.ports) + " ports fixed, " + std::to_string(result.foreign) + " foreign in " + std::to_string(result.took.count()) + " ms");
+    } else {
+        BoostLogger::Warn("Startup reconcile incomplete: " + result.error);
+    }
+    {
+        std::lock_guard lock(mutex_);
+        result_ = std::move(result);
+        phase = Phase::Done;
+    }
+    phaseChanged.notify_all();
+}
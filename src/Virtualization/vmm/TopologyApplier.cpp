@@ -0,0 +1,431 @@
+#include "Virtualization/vmm/TopologyApplier.hpp"
+#include "Virtualization/builder/VirtualMachineNicBuilder.hpp"
+#include "Virtualization/vmm/DeployBatch.hpp"
+#include "Virtualization/vmm/TopologyStore.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <libvirt/libvirt.h>
+#include <set>
+
+namespace {
+
+std::string lastError(const char* what) {
+    virErrorPtr err = virGetLastError();
+    return std::string(what) + ": " + (err && err->message ? err->message : "unknown");
+}
+
+// ids end up in libvirt network names
+bool validId(std::string_view id) {
+    if (id.empty() || id.size() > 64) return false;
+    return std::all_of(id.begin(), id.end(), [](unsigned char c) {
+        return std::isalnum(c) || c == '-' || c == '_' || c == '.';
+    });
+}
+
+bool isSegment(std::string_view type) {
+    return type == "switch" || type == "hub";
+}
+
+std::string interfaceXml(const std::string& network, const std::string& mac, std::string_view profile = {}, unsigned int vcpus = 0) {
+    VirtualMachineNicBuilder builder;
+    builder.setDeviceType("network").setNetworkName(network).setMacAddress(mac);
+    (void)builder.setNetProfile(profile, vcpus); // checked by desiredWiring
+    std::string xml;
+    builder.build_into(xml);
+    return xml;
+}
+
+// smallest device id per switch component, so the network name survives redrawing cables
+class SegmentSets {
+public:
+    const std::string& find(const std::string& id) {
+        auto it = parent.try_emplace(id, id).first;
+        if (it->second == id) return it->second;
+        const std::string root = find(it->second);
+        it = parent.find(id);
+        it->second = root;
+        return it->second;
+    }
+
+    void unite(const std::string& a, const std::string& b) {
+        const std::string ra = find(a);
+        const std::string rb = find(b);
+        if (ra == rb) return;
+        // the root is always the smallest id of its set
+        if (ra < rb) parent[rb] = ra;
+        else parent[ra] = rb;
+    }
+
+private:
+    std::map<std::string, std::string> parent;
+};
+
+} // namespace
+
+TopologyApplier::TopologyApplier(std::shared_ptr<HypervisorConnector> connector)
+    : connector(connector), fabric(std::make_shared<NetworkFabric>(std::move(connector))) {}
+
+void TopologyApplier::setNetworkFabric(std::shared_ptr<NetworkFabric> networks) {
+    if (networks) std::atomic_store(&fabric, std::move(networks));
+}
+
+void TopologyApplier::setMacAllocator(std::shared_ptr<MacAllocator> allocator) {
+    std::atomic_store(&macs, std::move(allocator));
+}
+
+void TopologyApplier::setTopologyStore(std::shared_ptr<TopologyStore> store) {
+    std::atomic_store(&designs, std::move(store));
+}
+
+std::string TopologyApplier::networkPrefix(std::string_view lab) {
+    return NetworkFabric::labPrefix(lab);
+}
+
+std::string TopologyApplier::segmentNetwork(std::string_view lab, std::string_view root) {
+    return networkPrefix(lab) + std::string(root);
+}
+
+std::string TopologyApplier::p2pNetwork(std::string_view lab, std::string_view a, std::string_view b) {
+    // ':' never occurs in a device id, so neither another cable nor a switch can produce this name
+    return networkPrefix(lab) + "p2p:" + std::string(std::min(a, b)) + ":" + std::string(std::max(a, b));
+}
+
+Result<std::map<std::string, std::vector<std::string>>> TopologyApplier::desiredWiring(const LabTopology& topology) {
+    using Wiring = std::map<std::string, std::vector<std::string>>;
+    if (!validId(topology.lab)) return Result<Wiring>{"Invalid lab id: " + topology.lab};
+
+    std::map<std::string, const TopologyDevice*> devices;
+    Wiring wiring;
+    for (const auto& d : topology.devices) {
+        if (!validId(d.id)) return Result<Wiring>{"Invalid device id: " + d.id};
+        if (!d.netProfile.empty() && !VmConfig::findNetProfile(d.netProfile)) {
+            return Result<Wiring>{"Unknown network profile of " + d.id + ": " + d.netProfile};
+        }
+        devices[d.id] = &d;
+        // deployed VMs without cables still get their stale lab NICs removed
+        if (!isSegment(d.type) && !d.domain.empty()) wiring[d.domain];
+    }
+
+    SegmentSets segments;
+    std::vector<std::pair<const TopologyDevice*, const TopologyDevice*>> links;
+    links.reserve(topology.links.size());
+    for (const auto& l : topology.links) {
+        auto a = devices.find(l.from);
+        auto b = devices.find(l.to);
+        if (a == devices.end() || b == devices.end()) return Result<Wiring>{"Link " + l.id + " references an unknown device"};
+        if (isSegment(a->second->type) && isSegment(b->second->type)) segments.unite(a->first, b->first);
+        links.emplace_back(a->second, b->second);
+    }
+
+    for (auto [a, b] : links) {
+        const bool segA = isSegment(a->type);
+        const bool segB = isSegment(b->type);
+        if (segA && segB) continue;
+        if (segA || segB) {
+            const auto* sw = segA ? a : b;
+            const auto* vm = segA ? b : a;
+            if (vm->domain.empty()) continue; // not deployed yet
+            wiring[vm->domain].push_back(segmentNetwork(topology.lab, segments.find(sw->id)));
+            continue;
+        }
+        if (a->domain.empty() || b->domain.empty() || a->domain == b->domain) continue;
+        const auto net = p2pNetwork(topology.lab, a->id, b->id);
+        wiring[a->domain].push_back(net);
+        wiring[b->domain].push_back(net);
+    }
+    for (auto& [domain, nets] : wiring) std::sort(nets.begin(), nets.end());
+    return Result<Wiring>{std::move(wiring)};
+}
+
+Result<std::map<std::string, TopologyApplier::CurrentDomain>> TopologyApplier::readWiring(const std::vector<std::string>& domains, const std::string& prefix) {
+    using Wiring = std::map<std::string, CurrentDomain>;
+    std::vector<CurrentDomain> nics(domains.size());
+    std::vector<std::string> errors(domains.size());
+    parallelFor(domains.size(), connector->getPoolSize(), [&](std::size_t i) {
+        HypervisorConnectionPool::Lease lease;
+        try {
+            lease = connector->acquire();
+        } catch (const std::exception& e) {
+            errors[i] = std::string("Not connected: ") + e.what();
+            return;
+        }
+        virDomainPtr dom = virDomainLookupByName(lease.get(), domains[i].c_str());
+        if (!dom) { errors[i] = "Domain not found: " + domains[i]; return; }
+        char* xml = virDomainGetXMLDesc(dom, 0);
+        virDomainFree(dom);
+        if (!xml) { errors[i] = lastError("virDomainGetXMLDesc failed"); return; }
+        auto cfg = configs.get(domains[i], xml);
+        free(xml);
+        if (cfg.isErr()) { errors[i] = "Unparsable XML for domain " + domains[i]; return; }
+        nics[i].vcpus = cfg.unwrap()->vcpus;
+        for (const auto& n : cfg.unwrap()->networks) {
+            if (n.type != "network" || !n.source.starts_with(prefix)) continue;
+            nics[i].nics.push_back({n.source, n.macAddress});
+        }
+    }, [&](std::size_t i, std::string what) { errors[i] = std::move(what); });
+    Wiring out;
+    for (std::size_t i = 0; i < domains.size(); ++i) {
+        if (!errors[i].empty()) return Result<Wiring>{errors[i]};
+        out.emplace(domains[i], std::move(nics[i]));
+    }
+    return Result<Wiring>{std::move(out)};
+}
+
+Result<std::vector<std::string>> TopologyApplier::managedNetworks(const std::string& prefix) {
+    auto lease = connector->acquire();
+    virNetworkPtr* nets = nullptr;
+    const int n = virConnectListAllNetworks(lease.get(), &nets, 0);
+    if (n < 0) return Result<std::vector<std::string>>{lastError("virConnectListAllNetworks failed")};
+    std::vector<std::string> out;
+    for (int i = 0; i < n; ++i) {
+        if (const char* name = virNetworkGetName(nets[i]); name && std::string_view(name).starts_with(prefix)) out.emplace_back(name);
+        virNetworkFree(nets[i]);
+    }
+    free(nets);
+    std::sort(out.begin(), out.end());
+    return Result<std::vector<std::string>>{std::move(out)};
+}
+
+std::set<std::string> TopologyApplier::outsideUsers(const std::vector<std::string>& networks, const std::set<std::string>& graphDomains) {
+    std::set<std::string> used;
+    if (networks.empty()) return used;
+    auto lease = connector->acquire();
+    const std::set<std::string> candidates(networks.begin(), networks.end());
+
+    // running domains: the planned detaches already ran, so every port left belongs to someone else
+    for (const auto& name : networks) {
+        virNetworkPtr net = virNetworkLookupByName(lease.get(), name.c_str());
+        if (!net) continue;
+        virNetworkPortPtr* ports = nullptr;
+        const int n = virNetworkListAllPorts(net, &ports, 0);
+        for (int i = 0; i < n; ++i) virNetworkPortFree(ports[i]);
+        free(ports);
+        virNetworkFree(net);
+        if (n != 0) used.insert(name); // < 0: can't tell, keep it
+    }
+
+    // shut-off domains have no ports; their configs still reference the network
+    virDomainPtr* domains = nullptr;
+    const int n = virConnectListAllDomains(lease.get(), &domains, VIR_CONNECT_LIST_DOMAINS_INACTIVE);
+    if (n < 0) return candidates;
+    for (int i = 0; i < n; ++i) {
+        const char* domainName = virDomainGetName(domains[i]);
+        if (domainName && !graphDomains.count(domainName)) {
+            if (char* xml = virDomainGetXMLDesc(domains[i], VIR_DOMAIN_XML_INACTIVE)) {
+                if (auto cfg = configs.get(domainName, xml); cfg.isOk()) {
+                    for (const auto& nic : cfg.unwrap()->networks) {
+                        if (nic.type == "network" && candidates.count(nic.source)) used.insert(nic.source);
+                    }
+                }
+                free(xml);
+            }
+        }
+        virDomainFree(domains[i]);
+    }
+    free(domains);
+    return used;
+}
+
+Result<TopologyWiring> TopologyApplier::wiringOf(const LabTopology& topology) {
+    auto desired = desiredWiring(topology);
+    if (desired.isErr()) return Err{std::move(desired).unwrapErr()};
+    TopologyWiring out;
+    out.lab = topology.lab;
+    out.networks = std::move(desired).unwrap();
+    for (const auto& d : topology.devices) {
+        if (d.domain.empty()) continue;
+        out.domains.insert(d.domain);
+        if (!d.netProfile.empty()) out.profiles[d.domain] = d.netProfile;
+    }
+    return Result<TopologyWiring>{std::move(out)};
+}
+
+Result<TopologyWiring> TopologyApplier::storedWiring(std::string_view lab) const {
+    auto store = std::atomic_load(&designs);
+    if (!store) return Err{std::string("No topology store configured")};
+    if (!validId(lab)) return Err{"Invalid lab id: " + std::string(lab)};
+    auto wiring = store->wiring(lab);
+    if (!wiring) return Err{"No topology stored for lab " + std::string(lab)};
+    return Result<TopologyWiring>{std::move(*wiring)};
+}
+
+Result<TopologyPlan> TopologyApplier::plan(const LabTopology& topology) {
+    auto wiring = wiringOf(topology);
+    if (wiring.isErr()) return Err{std::move(wiring).unwrapErr()};
+    return planWiring(wiring.unwrap());
+}
+
+Result<TopologyPlan> TopologyApplier::planStored(std::string_view lab) {
+    auto wiring = storedWiring(lab);
+    if (wiring.isErr()) return Err{std::move(wiring).unwrapErr()};
+    return planWiring(wiring.unwrap());
+}
+
+Result<TopologyPlan> TopologyApplier::planWiring(const TopologyWiring& wiring) {
+    const auto& desired = wiring.networks;
+    const auto prefix = networkPrefix(wiring.lab);
+
+    std::vector<std::string> domains;
+    for (const auto& [domain, nets] : desired) domains.push_back(domain);
+    try {
+        auto current = readWiring(domains, prefix);
+        if (current.isErr()) return Result<TopologyPlan>{current.unwrapErr()};
+        auto existing = managedNetworks(prefix);
+        if (existing.isErr()) return Result<TopologyPlan>{existing.unwrapErr()};
+
+        TopologyPlan plan;
+        std::set<std::string> needed;
+        for (const auto& [domain, nets] : desired) needed.insert(nets.begin(), nets.end());
+        const std::set<std::string> have(existing.unwrap().begin(), existing.unwrap().end());
+        std::set_difference(needed.begin(), needed.end(), have.begin(), have.end(), std::back_inserter(plan.createNetworks));
+        std::set_difference(have.begin(), have.end(), needed.begin(), needed.end(), std::back_inserter(plan.removeNetworks));
+
+        const auto& profiles = wiring.profiles;
+        for (const auto& [domain, nets] : desired) {
+            std::map<std::string, unsigned int> wanted;
+            for (const auto& n : nets) ++wanted[n];
+            const auto& now = current.unwrap().at(domain);
+            const auto profile = profiles.find(domain);
+            // an existing NIC on a wanted network is kept; only the surplus and the shortfall change
+            for (const auto& nic : now.nics) {
+                auto it = wanted.find(nic.network);
+                if (it != wanted.end() && it->second > 0) {
+                    --it->second;
+                    continue;
+                }
+                plan.changes.push_back({NicChange::Kind::Detach, domain, nic.network, nic.mac, {}, {}, 0});
+            }
+            for (const auto& [network, count] : wanted) {
+                for (unsigned int k = 0; k < count; ++k) {
+                    plan.changes.push_back({NicChange::Kind::Attach, domain, network, {}, {},
+                                            profile == profiles.end() ? std::string{} : profile->second, now.vcpus});
+                }
+            }
+        }
+        return Result<TopologyPlan>{std::move(plan)};
+    } catch (const std::exception& e) {
+        return Result<TopologyPlan>{std::string("Not connected: ") + e.what()};
+    }
+}
+
+Result<TopologyApplyResult> TopologyApplier::apply(const LabTopology& topology) {
+    auto wiring = wiringOf(topology);
+    if (wiring.isErr()) return Err{std::move(wiring).unwrapErr()};
+    return applyWiring(wiring.unwrap());
+}
+
+Result<TopologyApplyResult> TopologyApplier::applyStored(std::string_view lab) {
+    auto wiring = storedWiring(lab);
+    if (wiring.isErr()) return Err{std::move(wiring).unwrapErr()};
+    return applyWiring(wiring.unwrap());
+}
+
+Result<TopologyApplyResult> TopologyApplier::applyWiring(const TopologyWiring& wiring) {
+    std::lock_guard lock(applyMutex);
+    auto planRes = planWiring(wiring);
+    if (planRes.isErr()) return Result<TopologyApplyResult>{planRes.unwrapErr()};
+
+    TopologyApplyResult result;
+    result.plan = std::move(planRes).unwrap();
+    auto& plan = result.plan;
+    const std::size_t width = connector->getPoolSize();
+    const auto allocator = std::atomic_load(&macs);
+    const auto networks = std::atomic_load(&fabric);
+
+    // 1) networks first: attaches below need them running
+    auto netErrors = networks->ensure(plan.createNetworks);
+    std::set<std::string> brokenNetworks;
+    for (std::size_t i = 0; i < netErrors.size(); ++i) {
+        if (netErrors[i].empty()) continue;
+        result.errors.push_back(std::move(netErrors[i]));
+        brokenNetworks.insert(plan.createNetworks[i]);
+    }
+
+    // 2) one job per domain (libvirt serializes device changes per domain anyway), domains in parallel
+    std::map<std::string, std::vector<std::size_t>> byDomain;
+    for (std::size_t i = 0; i < plan.changes.size(); ++i) byDomain[plan.changes[i].domain].push_back(i);
+    std::vector<const std::vector<std::size_t>*> jobs;
+    for (const auto& [domain, idx] : byDomain) jobs.push_back(&idx);
+    parallelFor(jobs.size(), width, [&](std::size_t j) {
+        auto& first = plan.changes[jobs[j]->front()];
+        HypervisorConnectionPool::Lease lease;
+        virDomainPtr dom = nullptr;
+        try {
+            lease = connector->acquire();
+            dom = virDomainLookupByName(lease.get(), first.domain.c_str());
+        } catch (const std::exception& e) {
+            for (auto i : *jobs[j]) plan.changes[i].error = e.what();
+            return;
+        }
+        if (!dom) {
+            for (auto i : *jobs[j]) plan.changes[i].error = "Domain not found: " + first.domain;
+            return;
+        }
+        unsigned int flags = VIR_DOMAIN_AFFECT_CONFIG;
+        if (virDomainIsActive(dom) == 1) flags |= VIR_DOMAIN_AFFECT_LIVE;
+        // detaches were planned before attaches, so a NIC moving networks frees its slot first
+        for (auto i : *jobs[j]) {
+            auto& change = plan.changes[i];
+            if (change.kind == NicChange::Kind::Attach && brokenNetworks.count(change.network)) {
+                change.error = "Network not available: " + change.network;
+                continue;
+            }
+            const bool attach = change.kind == NicChange::Kind::Attach;
+            if (attach) {
+                if (allocator) {
+                    auto mac = allocator->allocate(change.domain, wiring.lab);
+                    if (mac.isErr()) { change.error = mac.unwrapErr(); continue; }
+                    change.mac = std::move(mac).unwrap();
+                } else {
+                    change.mac = MacAllocator::randomMac();
+                }
+            }
+            const auto xml = interfaceXml(change.network, change.mac, change.profile, change.vcpus);
+            const int rc = attach
+                ? virDomainAttachDeviceFlags(dom, xml.c_str(), flags)
+                : virDomainDetachDeviceFlags(dom, xml.c_str(), flags);
+            if (rc < 0) change.error = lastError(attach ? "attach" : "detach");
+            // a failed attach gives its address back; a successful detach frees the old one
+            if (allocator && (attach == (rc < 0))) allocator->release(change.mac);
+        }
+        virDomainFree(dom);
+    }, [&](std::size_t j, std::string what) {
+        // the changes of that domain not known to have failed are not known to be applied either
+        for (auto i : *jobs[j]) {
+            if (plan.changes[i].error.empty()) plan.changes[i].error = what;
+        }
+    });
+    std::set<std::string> stillUsed;
+    for (const auto& c : plan.changes) {
+        (c.error.empty() ? result.applied : result.failed) += 1;
+        if (!c.error.empty() && c.kind == NicChange::Kind::Detach) stillUsed.insert(c.network);
+    }
+
+    // 3) drop lab networks nothing is cabled to any more (kept while a detach from them failed,
+    //    or while a domain the graph doesn't know about is still on them)
+    std::vector<std::string> unused;
+    for (const auto& n : plan.removeNetworks) {
+        if (!stillUsed.count(n)) unused.push_back(n);
+    }
+    try {
+        for (const auto& n : outsideUsers(unused, wiring.domains)) {
+            result.errors.push_back("Network " + n + " kept: still used by a domain outside the topology");
+            std::erase(unused, n);
+        }
+    } catch (const std::exception& e) {
+        // without the check nothing is safe to delete
+        result.errors.push_back(std::string("Not connected: ") + e.what());
+        unused.clear();
+    }
+    for (auto& e : networks->remove(unused)) {
+        if (!e.empty()) result.errors.push_back(std::move(e));
+    }
+    return Result<TopologyApplyResult>{std::move(result)};
+}
+
+Result<std::size_t> TopologyApplier::teardown(std::string_view lab) {
+    if (!validId(lab)) return Result<std::size_t>{"Invalid lab id: " + std::string(lab)};
+    std::lock_guard lock(applyMutex);
+    return std::atomic_load(&fabric)->releaseLab(lab);
+}
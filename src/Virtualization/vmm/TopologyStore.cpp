@@ -0,0 +1,620 @@
+#include "Virtualization/vmm/TopologyStore.hpp"
+#include "Core/interfaces/IDatabase.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <numeric>
+
+namespace {
+
+constexpr std::string_view kPrefix = "topo/";
+constexpr char kSep = '\x1f';
+constexpr std::size_t kMaxLabels = 0xffff;
+constexpr std::size_t kCompactMin = 32;
+
+rocksdb::Slice toSlice(std::string_view sv) {
+    return rocksdb::Slice(sv.data(), sv.size());
+}
+
+// lab and device ids end up in keys and libvirt network names (same rule as TopologyApplier)
+bool validId(std::string_view id) {
+    if (id.empty() || id.size() > 64) return false;
+    return std::all_of(id.begin(), id.end(), [](unsigned char c) {
+        return std::isalnum(c) || c == '-' || c == '_' || c == '.';
+    });
+}
+
+bool validText(std::string_view text) {
+    return text.size() <= 256 && text.find(kSep) == std::string_view::npos;
+}
+
+std::string labPrefix(std::string_view lab) {
+    std::string key(kPrefix);
+    key += lab;
+    key += '/';
+    return key;
+}
+
+std::string versionKey(std::string_view lab) {
+    return labPrefix(lab) + "v";
+}
+
+std::string deviceKey(std::string_view lab, std::string_view id) {
+    return labPrefix(lab) + "d/" + std::string(id);
+}
+
+std::string linkKey(std::string_view lab, std::string_view id) {
+    return labPrefix(lab) + "l/" + std::string(id);
+}
+
+// every key of the lab: "topo/<lab>/" up to "topo/<lab>0"
+void deleteLab(rocksdb::WriteBatch& batch, std::string_view lab) {
+    const std::string begin = labPrefix(lab);
+    std::string end = begin;
+    end.back() = static_cast<char>(end.back() + 1);
+    batch.DeleteRange(begin, end);
+}
+
+std::optional<std::uint64_t> parseU64(std::string_view sv) {
+    std::uint64_t value = 0;
+    auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+    if (ec != std::errc{} || ptr != sv.data() + sv.size()) return std::nullopt;
+    return value;
+}
+
+std::vector<std::string_view> split(std::string_view v) {
+    std::vector<std::string_view> parts;
+    for (std::size_t pos = 0;;) {
+        const auto next = v.find(kSep, pos);
+        parts.push_back(v.substr(pos, next == std::string_view::npos ? std::string_view::npos : next - pos));
+        if (next == std::string_view::npos) return parts;
+        pos = next + 1;
+    }
+}
+
+} // namespace
+
+//
+// Graph
+//
+std::optional<std::uint16_t> TopologyStore::Graph::intern(std::string_view label) {
+    // a handful of device types and profiles per lab: a scan beats a map here
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        if (labels[i] == label) return static_cast<std::uint16_t>(i);
+    }
+    if (labels.size() >= kMaxLabels) return std::nullopt;
+    labels.emplace_back(label);
+    return static_cast<std::uint16_t>(labels.size() - 1);
+}
+
+std::uint32_t TopologyStore::Graph::addDevice(DeviceRecord record) {
+    record.live = true;
+    std::uint32_t slot;
+    if (!freeDevices.empty()) {
+        // the old links of a reused slot are tombstones, so its CSR entries stay harmless
+        slot = freeDevices.back();
+        freeDevices.pop_back();
+        devices[slot] = std::move(record);
+    } else {
+        slot = static_cast<std::uint32_t>(devices.size());
+        devices.push_back(std::move(record));
+    }
+    deviceSlots.emplace(devices[slot].id, slot);
+    return slot;
+}
+
+void TopologyStore::Graph::addLink(LinkRecord record) {
+    const auto slot = static_cast<std::uint32_t>(links.size());
+    linkSlots.emplace(record.id, slot);
+    links.push_back(std::move(record));
+    adjacencyDirty = true;
+}
+
+void TopologyStore::Graph::rebuildAdjacency() {
+    offsets.assign(devices.size() + 1, 0);
+    for (const auto& l : links) {
+        if (l.from == kNone) continue;
+        ++offsets[l.from + 1];
+        ++offsets[l.to + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    adjacency.resize(offsets.back());
+    std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::uint32_t i = 0; i < links.size(); ++i) {
+        const auto& l = links[i];
+        if (l.from == kNone) continue;
+        adjacency[fill[l.from]++] = i;
+        adjacency[fill[l.to]++] = i;
+    }
+    adjacencyDirty = false;
+}
+
+template <typename Fn>
+void TopologyStore::Graph::forEachLink(std::uint32_t slot, Fn&& fn) {
+    if (slot + 1 >= offsets.size()) return; // added after the last rebuild, no links yet
+    for (auto i = offsets[slot]; i < offsets[slot + 1]; ++i) {
+        const auto& l = links[adjacency[i]];
+        // anything else is a tombstone of an earlier device in this slot
+        if (l.from == slot) fn(l.to, adjacency[i]);
+        else if (l.to == slot) fn(l.from, adjacency[i]);
+    }
+}
+
+void TopologyStore::Graph::compact() {
+    const std::size_t dead = freeDevices.size() + (links.size() - linkSlots.size());
+    if (dead < kCompactMin || dead <= deviceSlots.size() + linkSlots.size()) return;
+
+    std::vector<std::string> keptLabels{std::string()};
+    std::vector<std::uint16_t> labelMap(labels.size(), 0);
+    std::vector<bool> labelKept(labels.size(), false);
+    labelKept[0] = true;
+    auto relabel = [&](std::uint16_t i) {
+        if (!labelKept[i]) {
+            labelKept[i] = true;
+            labelMap[i] = static_cast<std::uint16_t>(keptLabels.size());
+            keptLabels.push_back(std::move(labels[i]));
+        }
+        return labelMap[i];
+    };
+
+    std::vector<std::uint32_t> slotMap(devices.size(), kNone);
+    std::vector<DeviceRecord> keptDevices;
+    keptDevices.reserve(deviceSlots.size());
+    deviceSlots.clear();
+    for (std::uint32_t i = 0; i < devices.size(); ++i) {
+        auto& d = devices[i];
+        if (!d.live) continue;
+        d.type = relabel(d.type);
+        d.profile = relabel(d.profile);
+        slotMap[i] = static_cast<std::uint32_t>(keptDevices.size());
+        deviceSlots.emplace(d.id, slotMap[i]);
+        keptDevices.push_back(std::move(d));
+    }
+
+    std::vector<LinkRecord> keptLinks;
+    keptLinks.reserve(linkSlots.size());
+    linkSlots.clear();
+    for (auto& l : links) {
+        if (l.from == kNone) continue;
+        l.from = slotMap[l.from];
+        l.to = slotMap[l.to];
+        linkSlots.emplace(l.id, static_cast<std::uint32_t>(keptLinks.size()));
+        keptLinks.push_back(std::move(l));
+    }
+
+    labels = std::move(keptLabels);
+    devices = std::move(keptDevices);
+    links = std::move(keptLinks);
+    freeDevices.clear();
+    adjacencyDirty = true;
+}
+
+//
+// TopologyStore
+//
+TopologyStore::TopologyStore(std::shared_ptr<IRocksDB> db, std::size_t maxResident)
+    : db(std::move(db)), maxResident(std::max<std::size_t>(maxResident, 1)) {}
+
+TopologyStore::~TopologyStore() = default;
+
+DeviceKind TopologyStore::kindOf(std::string_view type) noexcept {
+    if (type == "pc") return DeviceKind::Pc;
+    if (type == "server") return DeviceKind::Server;
+    if (type == "router") return DeviceKind::Router;
+    if (type == "switch") return DeviceKind::Switch;
+    if (type == "hub") return DeviceKind::Hub;
+    if (type == "firewall") return DeviceKind::Firewall;
+    return DeviceKind::Other;
+}
+
+std::optional<LabTopology> TopologyStore::topology(std::string_view lab) {
+    std::lock_guard lock(mutex_);
+    const Graph* g = graphOf(lab);
+    if (!g) return std::nullopt;
+    LabTopology out;
+    out.lab = std::string(lab);
+    out.devices.reserve(g->deviceSlots.size());
+    for (const auto& d : g->devices) {
+        if (!d.live) continue;
+        out.devices.push_back({d.id, g->label(d.type), d.domain, g->label(d.profile)});
+    }
+    out.links.reserve(g->liveLinks());
+    for (const auto& l : g->links) {
+        if (l.from == kNone) continue;
+        out.links.push_back({l.id, g->devices[l.from].id, g->devices[l.to].id});
+    }
+    return out;
+}
+
+std::optional<std::uint64_t> TopologyStore::version(std::string_view lab) {
+    std::lock_guard lock(mutex_);
+    const Graph* g = graphOf(lab);
+    if (!g) return std::nullopt;
+    return g->version;
+}
+
+std::optional<TopologyWiring> TopologyStore::wiring(std::string_view lab) {
+    std::lock_guard lock(mutex_);
+    Graph* g = graphOf(lab);
+    if (!g) return std::nullopt;
+    if (g->adjacencyDirty) g->rebuildAdjacency();
+    const auto isSegment = [&](std::uint32_t slot) {
+        const auto kind = g->devices[slot].kind;
+        return kind == DeviceKind::Switch || kind == DeviceKind::Hub;
+    };
+
+    // every switch/hub component is one network, named after its smallest device id
+    std::vector<std::uint32_t> root(g->devices.size(), kNone);
+    std::vector<std::uint32_t> component;
+    for (std::uint32_t s = 0; s < g->devices.size(); ++s) {
+        if (!g->devices[s].live || !isSegment(s) || root[s] != kNone) continue;
+        component.assign(1, s);
+        root[s] = s;
+        std::uint32_t smallest = s;
+        for (std::size_t k = 0; k < component.size(); ++k) {
+            g->forEachLink(component[k], [&](std::uint32_t other, std::uint32_t) {
+                if (!isSegment(other) || root[other] != kNone) return;
+                root[other] = s;
+                component.push_back(other);
+                if (g->devices[other].id < g->devices[smallest].id) smallest = other;
+            });
+        }
+        for (auto c : component) root[c] = smallest;
+    }
+
+    TopologyWiring out;
+    out.lab = std::string(lab);
+    for (std::uint32_t s = 0; s < g->devices.size(); ++s) {
+        const auto& d = g->devices[s];
+        if (!d.live || d.domain.empty()) continue;
+        out.domains.insert(d.domain);
+        if (isSegment(s)) continue;
+        // deployed VMs without cables still get their stale lab NICs removed
+        auto& nets = out.networks[d.domain];
+        if (d.profile != 0) out.profiles[d.domain] = g->label(d.profile);
+        g->forEachLink(s, [&](std::uint32_t other, std::uint32_t) {
+            const auto& o = g->devices[other];
+            if (isSegment(other)) nets.push_back(TopologyApplier::segmentNetwork(lab, g->devices[root[other]].id));
+            else if (!o.domain.empty() && o.domain != d.domain) nets.push_back(TopologyApplier::p2pNetwork(lab, d.id, o.id));
+        });
+    }
+    for (auto& [domain, nets] : out.networks) std::sort(nets.begin(), nets.end());
+    return out;
+}
+
+std::optional<std::string> TopologyStore::applyDelta(Graph& graph, std::string_view lab, const TopologyDelta& delta,
+                                                     rocksdb::WriteBatch& batch, TopologyRevision& revision, UndoLog* undo) {
+    using Op = TopologyDelta::Op;
+    using Kind = Undo::Kind;
+    auto record = [&](Undo entry) {
+        if (undo) undo->entries.push_back(std::move(entry));
+    };
+    auto devicePut = [&](std::uint32_t slot) {
+        const auto& d = graph.devices[slot];
+        std::string value = graph.label(d.type);
+        value += kSep;
+        value += d.domain;
+        value += kSep;
+        value += graph.label(d.profile);
+        batch.Put(deviceKey(lab, d.id), value);
+    };
+    auto checkDevice = [](const TopologyDelta& d) -> std::optional<std::string> {
+        if (d.type && !validText(*d.type)) return "Invalid device type of " + d.id;
+        if (d.domain && !validText(*d.domain)) return "Invalid domain of " + d.id;
+        if (d.netProfile && !d.netProfile->empty() && !VmConfig::findNetProfile(*d.netProfile)) {
+            return "Unknown network profile of " + d.id + ": " + *d.netProfile;
+        }
+        return std::nullopt;
+    };
+
+    switch (delta.op) {
+    case Op::AddDevice: {
+        if (!validId(delta.id)) return "Invalid device id: " + delta.id;
+        if (graph.deviceSlots.count(delta.id)) return "Device " + delta.id + " already exists";
+        if (auto err = checkDevice(delta)) return err;
+        const std::string type = delta.type.value_or("");
+        auto typeLabel = graph.intern(type);
+        auto profileLabel = graph.intern(delta.netProfile.value_or(""));
+        if (!typeLabel || !profileLabel) return std::string("Too many distinct device types and profiles");
+        const bool reused = !graph.freeDevices.empty();
+        const auto slot = graph.addDevice(DeviceRecord{delta.id, delta.domain.value_or(""), *typeLabel, *profileLabel, kindOf(type), true});
+        record(Undo{Kind::AddedDevice, slot, reused, {}, {}});
+        devicePut(slot);
+        return std::nullopt;
+    }
+    case Op::UpdateDevice: {
+        auto it = graph.deviceSlots.find(delta.id);
+        if (it == graph.deviceSlots.end()) return "Unknown device: " + delta.id;
+        if (auto err = checkDevice(delta)) return err;
+        auto& d = graph.devices[it->second];
+        record(Undo{Kind::ChangedDevice, it->second, false, d, {}});
+        if (delta.type) {
+            auto typeLabel = graph.intern(*delta.type);
+            if (!typeLabel) return std::string("Too many distinct device types and profiles");
+            d.type = *typeLabel;
+            d.kind = kindOf(*delta.type);
+        }
+        if (delta.netProfile) {
+            auto profileLabel = graph.intern(*delta.netProfile);
+            if (!profileLabel) return std::string("Too many distinct device types and profiles");
+            d.profile = *profileLabel;
+        }
+        if (delta.domain) d.domain = *delta.domain;
+        devicePut(it->second);
+        return std::nullopt;
+    }
+    case Op::RemoveDevice: {
+        auto it = graph.deviceSlots.find(delta.id);
+        if (it == graph.deviceSlots.end()) return "Unknown device: " + delta.id;
+        const std::uint32_t slot = it->second;
+        if (graph.adjacencyDirty) graph.rebuildAdjacency();
+        graph.forEachLink(slot, [&](std::uint32_t, std::uint32_t index) {
+            auto& l = graph.links[index];
+            batch.Delete(linkKey(lab, l.id));
+            graph.linkSlots.erase(l.id);
+            record(Undo{Kind::RemovedLink, index, false, {}, std::move(l)});
+            l = LinkRecord{};
+            ++revision.removedLinks;
+        });
+        batch.Delete(deviceKey(lab, delta.id));
+        graph.deviceSlots.erase(it);
+        record(Undo{Kind::RemovedDevice, slot, false, std::move(graph.devices[slot]), {}});
+        graph.devices[slot] = DeviceRecord{};
+        graph.freeDevices.push_back(slot);
+        return std::nullopt;
+    }
+    case Op::AddLink: {
+        if (!validId(delta.id)) return "Invalid link id: " + delta.id;
+        if (graph.linkSlots.count(delta.id)) return "Link " + delta.id + " already exists";
+        auto a = graph.deviceSlots.find(delta.from);
+        auto b = graph.deviceSlots.find(delta.to);
+        if (a == graph.deviceSlots.end() || b == graph.deviceSlots.end()) {
+            return "Link " + delta.id + " references an unknown device";
+        }
+        if (a->second == b->second) return "Link " + delta.id + " connects " + delta.from + " to itself";
+        batch.Put(linkKey(lab, delta.id), delta.from + kSep + delta.to);
+        record(Undo{Kind::AddedLink, static_cast<std::uint32_t>(graph.links.size()), false, {}, {}});
+        graph.addLink(LinkRecord{delta.id, a->second, b->second});
+        return std::nullopt;
+    }
+    case Op::RemoveLink: {
+        auto it = graph.linkSlots.find(delta.id);
+        if (it == graph.linkSlots.end()) return "Unknown link: " + delta.id;
+        batch.Delete(linkKey(lab, delta.id));
+        record(Undo{Kind::RemovedLink, it->second, false, {}, std::move(graph.links[it->second])});
+        graph.links[it->second] = LinkRecord{};
+        graph.linkSlots.erase(it);
+        return std::nullopt;
+    }
+    }
+    return std::string("Unknown topology operation");
+}
+
+void TopologyStore::rollback(Graph& graph, UndoLog& undo) {
+    using Kind = Undo::Kind;
+    for (auto it = undo.entries.rbegin(); it != undo.entries.rend(); ++it) {
+        auto& u = *it;
+        switch (u.kind) {
+        case Kind::AddedDevice:
+            graph.deviceSlots.erase(graph.devices[u.slot].id);
+            if (u.reused) {
+                graph.devices[u.slot] = DeviceRecord{};
+                graph.freeDevices.push_back(u.slot);
+            } else {
+                graph.devices.pop_back();
+            }
+            break;
+        case Kind::ChangedDevice:
+            graph.devices[u.slot] = std::move(u.device);
+            break;
+        case Kind::RemovedDevice:
+            // the slot went to the back of freeDevices; anything later that took it is undone already
+            graph.freeDevices.pop_back();
+            graph.deviceSlots.emplace(u.device.id, u.slot);
+            graph.devices[u.slot] = std::move(u.device);
+            break;
+        case Kind::AddedLink:
+            graph.linkSlots.erase(graph.links.back().id);
+            graph.links.pop_back();
+            break;
+        case Kind::RemovedLink:
+            graph.linkSlots.emplace(u.link.id, u.slot);
+            graph.links[u.slot] = std::move(u.link);
+            break;
+        }
+    }
+    // labels interned by the batch are referenced by nothing now
+    graph.labels.resize(undo.labels);
+    // a rebuild in the middle of the batch saw links that are gone again
+    if (!undo.entries.empty()) graph.adjacencyDirty = true;
+    undo.entries.clear();
+}
+
+Result<TopologyRevision> TopologyStore::replace(const LabTopology& design) {
+    if (!validId(design.lab)) return Result<TopologyRevision>{"Invalid lab id: " + design.lab};
+    std::lock_guard lock(mutex_);
+    const Graph* current = graphOf(design.lab);
+
+    Graph next;
+    next.version = (current ? current->version : 0) + 1;
+    next.devices.reserve(design.devices.size());
+    next.links.reserve(design.links.size());
+    rocksdb::WriteBatch batch;
+    deleteLab(batch, design.lab);
+    TopologyRevision revision;
+    for (const auto& d : design.devices) {
+        TopologyDelta delta{TopologyDelta::Op::AddDevice, d.id, d.type, d.domain, d.netProfile, {}, {}};
+        if (auto err = applyDelta(next, design.lab, delta, batch, revision)) return Result<TopologyRevision>{std::move(*err)};
+    }
+    // cables drawn before they had ids get the first free link-<n> once the named ones are in
+    std::vector<const TopologyLink*> unnamed;
+    for (const auto& l : design.links) {
+        if (l.id.empty()) {
+            unnamed.push_back(&l);
+            continue;
+        }
+        TopologyDelta delta{TopologyDelta::Op::AddLink, l.id, {}, {}, {}, l.from, l.to};
+        if (auto err = applyDelta(next, design.lab, delta, batch, revision)) return Result<TopologyRevision>{std::move(*err)};
+    }
+    std::size_t n = 0;
+    for (const auto* l : unnamed) {
+        std::string id;
+        do {
+            id = "link-" + std::to_string(++n);
+        } while (next.linkSlots.count(id));
+        TopologyDelta delta{TopologyDelta::Op::AddLink, id, {}, {}, {}, l->from, l->to};
+        if (auto err = applyDelta(next, design.lab, delta, batch, revision)) return Result<TopologyRevision>{std::move(*err)};
+    }
+    batch.Put(versionKey(design.lab), std::to_string(next.version));
+
+    if (db) {
+        if (auto res = db->Write(rocksdb::WriteOptions{}, batch); !res) {
+            return Result<TopologyRevision>{"Failed to persist topology: " + res.error().ToString()};
+        }
+    }
+    revision.version = next.version;
+    revision.devices = next.deviceSlots.size();
+    revision.links = next.liveLinks();
+    store(design.lab, std::move(next));
+    return revision;
+}
+
+Result<TopologyRevision, TopologyDeltaError> TopologyStore::update(std::string_view lab, std::uint64_t baseVersion,
+                                                                   const std::vector<TopologyDelta>& deltas) {
+    using R = Result<TopologyRevision, TopologyDeltaError>;
+    if (!validId(lab)) return R{Err{TopologyDeltaError{false, 0, "Invalid lab id: " + std::string(lab)}}};
+    std::lock_guard lock(mutex_);
+    Graph* current = graphOf(lab);
+    const std::uint64_t stored = current ? current->version : 0;
+    if (baseVersion != stored) {
+        return R{Err{TopologyDeltaError{true, stored, "Topology changed since version " + std::to_string(baseVersion)}}};
+    }
+
+    // the batch is all or nothing: deltas run in place and the undo log takes them back on any failure;
+    // a new lab's graph is only stored once persisted
+    Graph fresh;
+    Graph& graph = current ? *current : fresh;
+    UndoLog undo;
+    undo.labels = graph.labels.size();
+    rocksdb::WriteBatch batch;
+    TopologyRevision revision;
+    for (std::size_t i = 0; i < deltas.size(); ++i) {
+        if (auto err = applyDelta(graph, lab, deltas[i], batch, revision, &undo)) {
+            rollback(graph, undo);
+            return R{Err{TopologyDeltaError{false, stored, "op " + std::to_string(i) + ": " + *err}}};
+        }
+    }
+    batch.Put(versionKey(lab), std::to_string(stored + 1));
+
+    if (db) {
+        if (auto res = db->Write(rocksdb::WriteOptions{}, batch); !res) {
+            rollback(graph, undo);
+            return R{Err{TopologyDeltaError{false, stored, "Failed to persist topology: " + res.error().ToString()}}};
+        }
+    }
+    graph.version = stored + 1;
+    graph.compact();
+    revision.version = graph.version;
+    revision.devices = graph.deviceSlots.size();
+    revision.links = graph.liveLinks();
+    if (!current) store(std::string(lab), std::move(fresh));
+    return R{revision};
+}
+
+Result<bool> TopologyStore::erase(std::string_view lab) {
+    if (!validId(lab)) return Result<bool>{"Invalid lab id: " + std::string(lab)};
+    std::lock_guard lock(mutex_);
+    const bool existed = graphOf(lab) != nullptr;
+    if (!existed) return false;
+    if (db) {
+        rocksdb::WriteBatch batch;
+        deleteLab(batch, lab);
+        if (auto res = db->Write(rocksdb::WriteOptions{}, batch); !res) {
+            return Result<bool>{"Failed to delete topology: " + res.error().ToString()};
+        }
+    }
+    auto it = byLab.find(std::string(lab));
+    resident.erase(it->second);
+    byLab.erase(it);
+    return true;
+}
+
+TopologyStore::Graph* TopologyStore::graphOf(std::string_view lab) {
+    if (auto it = byLab.find(std::string(lab)); it != byLab.end()) {
+        resident.splice(resident.begin(), resident, it->second);
+        return &it->second->graph;
+    }
+    if (!db) return nullptr;
+    auto loaded = loadGraph(lab);
+    if (!loaded) return nullptr;
+    store(std::string(lab), std::move(*loaded));
+    return &resident.front().graph;
+}
+
+std::optional<TopologyStore::Graph> TopologyStore::loadGraph(std::string_view lab) const {
+    const std::string prefix = labPrefix(lab);
+    std::string upper = prefix;
+    upper.back() = static_cast<char>(upper.back() + 1);
+    rocksdb::Slice upperSlice(upper);
+
+    rocksdb::ReadOptions ro;
+    ro.iterate_upper_bound = &upperSlice;
+    auto it = db->NewIterator(ro);
+    if (!it) return std::nullopt;
+
+    Graph g;
+    bool found = false;
+    std::vector<std::array<std::string, 3>> links; // id, from, to: resolved once all devices are in
+    for (it->Seek(toSlice(prefix)); it->Valid(); it->Next()) {
+        const auto k = it->key();
+        const auto v = it->value();
+        const std::string_view key = std::string_view(k.data(), k.size()).substr(prefix.size());
+        const std::string_view value(v.data(), v.size());
+        if (key == "v") {
+            g.version = parseU64(value).value_or(0);
+            found = true;
+        } else if (key.starts_with("d/")) {
+            const auto parts = split(value);
+            if (parts.size() != 3) continue;
+            auto typeLabel = g.intern(parts[0]);
+            auto profileLabel = g.intern(parts[2]);
+            if (!typeLabel || !profileLabel) continue;
+            g.addDevice(DeviceRecord{std::string(key.substr(2)), std::string(parts[1]), *typeLabel, *profileLabel,
+                                     kindOf(parts[0]), true});
+        } else if (key.starts_with("l/")) {
+            const auto parts = split(value);
+            if (parts.size() != 2) continue;
+            links.push_back({std::string(key.substr(2)), std::string(parts[0]), std::string(parts[1])});
+        }
+    }
+    if (!found) return std::nullopt;
+    for (auto& [id, from, to] : links) {
+        auto a = g.deviceSlots.find(from);
+        auto b = g.deviceSlots.find(to);
+        if (a == g.deviceSlots.end() || b == g.deviceSlots.end()) continue;
+        g.addLink(LinkRecord{std::move(id), a->second, b->second});
+    }
+    return g;
+}
+
+void TopologyStore::store(std::string lab, Graph graph) {
+    if (auto it = byLab.find(lab); it != byLab.end()) {
+        it->second->graph = std::move(graph);
+        resident.splice(resident.begin(), resident, it->second);
+        return;
+    }
+    resident.push_front(Resident{lab, std::move(graph)});
+    byLab.emplace(std::move(lab), resident.begin());
+    evictOverflow();
+}
+
+void TopologyStore::evictOverflow() {
+    // without a database the resident graphs are the only copy
+    if (!db) return;
+    while (resident.size() > maxResident) {
+        byLab.erase(resident.back().lab);
+        resident.pop_back();
+    }
+}
@@ -0,0 +1,487 @@
+#include "Virtualization/vmm/UsageCollector.hpp"
+#include "Core/interfaces/IDatabase.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Utils/Logger.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <limits>
+#include <libvirt/libvirt.h>
+
+namespace {
+
+constexpr std::string_view kPrefix = "usage/";
+constexpr auto kPruneEvery = std::chrono::hours(1);
+// widths of the Sample bit-fields
+constexpr std::int64_t kMaxSpanMs = (1 << 22) - 1;
+constexpr std::uint32_t kMaxVcpus = (1 << 10) - 1;
+
+std::string lastError(const char* what) {
+    virErrorPtr err = virGetLastError();
+    return std::string(what) + ": " + (err && err->message ? err->message : "unknown");
+}
+
+rocksdb::Slice toSlice(std::string_view sv) {
+    return rocksdb::Slice(sv.data(), sv.size());
+}
+
+// fixed width so the keys of a VM sort by time
+std::string rowKey(std::string_view domain, std::uint64_t bucket) {
+    char digits[24];
+    std::snprintf(digits, sizeof(digits), "%010llu", static_cast<unsigned long long>(bucket));
+    std::string key(kPrefix);
+    key += domain;
+    key += '/';
+    key += digits;
+    return key;
+}
+
+std::uint32_t clamp32(std::uint64_t v) noexcept {
+    return static_cast<std::uint32_t>(std::min<std::uint64_t>(v, std::numeric_limits<std::uint32_t>::max()));
+}
+
+std::uint32_t unixSeconds(std::chrono::system_clock::time_point t) noexcept {
+    const auto s = std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
+    return s <= 0 ? 0 : clamp32(static_cast<std::uint64_t>(s));
+}
+
+// a counter that went backwards is a restarted guest: it counts from zero again
+std::uint64_t delta(std::uint64_t now, std::uint64_t before) noexcept {
+    return now >= before ? now - before : now;
+}
+
+std::uint64_t asU64(const virTypedParameter& p) noexcept {
+    switch (p.type) {
+        case VIR_TYPED_PARAM_ULLONG: return p.value.ul;
+        case VIR_TYPED_PARAM_LLONG: return p.value.l > 0 ? static_cast<std::uint64_t>(p.value.l) : 0;
+        case VIR_TYPED_PARAM_UINT: return p.value.ui;
+        case VIR_TYPED_PARAM_INT: return p.value.i > 0 ? static_cast<std::uint64_t>(p.value.i) : 0;
+        default: return 0;
+    }
+}
+
+double perSecond(std::uint64_t kib, std::uint64_t spanMs) noexcept {
+    return spanMs ? static_cast<double>(kib) * 1024.0 * 1000.0 / static_cast<double>(spanMs) : 0.0;
+}
+
+double busyVcpus(std::uint64_t cpuUs, std::uint64_t spanMs) noexcept {
+    return spanMs ? static_cast<double>(cpuUs) / (static_cast<double>(spanMs) * 1000.0) : 0.0;
+}
+
+// "spanMs cpuUs memKiB memPeakKiB diskReadKiB diskWriteKiB netRxKiB netTxKiB vcpus"
+std::optional<std::array<std::uint64_t, 9>> parseRow(std::string_view v) {
+    std::array<std::uint64_t, 9> out{};
+    const char* p = v.data();
+    const char* end = v.data() + v.size();
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        while (p < end && *p == ' ') ++p;
+        auto [next, ec] = std::from_chars(p, end, out[i]);
+        if (ec != std::errc{}) return std::nullopt;
+        p = next;
+    }
+    return out;
+}
+
+double metricOf(const UsagePoint& p, UsageMetric metric) noexcept {
+    switch (metric) {
+        case UsageMetric::Cpu: return p.cpu;
+        case UsageMetric::Memory: return static_cast<double>(p.memoryKiB);
+        case UsageMetric::Disk: return p.diskReadBps + p.diskWriteBps;
+        case UsageMetric::Network: return p.netRxBps + p.netTxBps;
+    }
+    return 0.0;
+}
+
+} // namespace
+
+struct UsageCollector::Reading {
+    std::string name;
+    Counters counters;
+    std::uint32_t vcpus{0};
+    std::uint64_t memKiB{0};
+};
+
+UsageCollector::UsageCollector(std::shared_ptr<HypervisorConnector> connector, std::shared_ptr<IRocksDB> db,
+                               UsageOptions options)
+    : connector(std::move(connector)), db(std::move(db)), opts(options) {}
+
+UsageCollector::~UsageCollector() {
+    stop();
+}
+
+void UsageCollector::start(CONCURRENCY::TimerWheel& timers, std::chrono::seconds interval) {
+    stop();
+    auto flag = std::make_shared<std::atomic<bool>>(false);
+    CONCURRENCY::WheelJobOptions options;
+    options.lane = CONCURRENCY::Lane::Blocking;
+    options.cancelFlag = flag;
+    const auto id = timers.schedule_every(interval, [weak = weak_from_this()]() {
+        auto self = weak.lock();
+        if (!self) return;
+        auto res = self->runOnce();
+        if (res.isErr()) BoostLogger::Warn("UsageCollector: " + res.unwrapErr());
+    }, std::move(options));
+    std::lock_guard lock(mutex_);
+    cancelFlag = std::move(flag);
+    wheel = &timers;
+    timer = id;
+}
+
+void UsageCollector::stop() noexcept {
+    std::shared_ptr<std::atomic<bool>> flag;
+    CONCURRENCY::TimerWheel* timers = nullptr;
+    CONCURRENCY::TimerId id;
+    {
+        std::lock_guard lock(mutex_);
+        flag = std::move(cancelFlag);
+        timers = std::exchange(wheel, nullptr);
+        id = std::exchange(timer, {});
+    }
+    // the flag stops a firing already queued on the lane, cancel() takes the job off the wheel
+    if (flag) flag->store(true);
+    if (timers && id) timers->cancel(id);
+}
+
+Result<std::size_t> UsageCollector::runOnce() {
+    return collect(std::nullopt);
+}
+
+Result<std::size_t> UsageCollector::runOnce(std::chrono::system_clock::time_point at) {
+    return collect(at);
+}
+
+Result<std::size_t> UsageCollector::collect(std::optional<std::chrono::system_clock::time_point> at) {
+    static auto& latency = METRICS::MetricsRegistry::global().histogram("penhive_usage_collect_seconds",
+        "One usage collector pass over all active domains");
+    static auto& trackedGauge = METRICS::MetricsRegistry::global().gauge("penhive_usage_tracked_domains",
+        "Domains with a usage ring");
+    const auto t0 = Clock::now();
+
+    std::vector<Reading> readings;
+    {
+        HypervisorConnectionPool::Lease lease;
+        try {
+            lease = connector->acquire();
+        } catch (const std::exception& e) {
+            return Result<std::size_t>{std::string("Not connected: ") + e.what()};
+        }
+        constexpr unsigned int groups = VIR_DOMAIN_STATS_CPU_TOTAL | VIR_DOMAIN_STATS_BALLOON | VIR_DOMAIN_STATS_VCPU
+            | VIR_DOMAIN_STATS_INTERFACE | VIR_DOMAIN_STATS_BLOCK;
+        virDomainStatsRecordPtr* records = nullptr;
+        const int n = virConnectGetAllDomainStats(lease.get(), groups, &records, VIR_CONNECT_GET_ALL_DOMAINS_STATS_ACTIVE);
+        if (n < 0) return Result<std::size_t>{lastError("virConnectGetAllDomainStats failed")};
+
+        readings.reserve(static_cast<std::size_t>(n));
+        for (int i = 0; i < n; ++i) {
+            virDomainStatsRecordPtr rec = records[i];
+            const char* raw = virDomainGetName(rec->dom);
+            if (!raw) continue;
+            Reading r;
+            r.name = raw;
+            std::uint64_t rss = 0;
+            std::uint64_t current = 0;
+            // one walk over the record; virTypedParamsGet* would scan it once per field and per device
+            for (int p = 0; p < rec->nparams; ++p) {
+                const virTypedParameter& param = rec->params[p];
+                const std::string_view field(param.field);
+                if (field == "cpu.time") r.counters.cpuNs = asU64(param);
+                else if (field == "vcpu.current") r.vcpus = clamp32(asU64(param));
+                else if (field == "balloon.rss") rss = asU64(param);
+                else if (field == "balloon.current") current = asU64(param);
+                else if (field.starts_with("block.")) {
+                    if (field.ends_with(".rd.bytes")) r.counters.diskRead += asU64(param);
+                    else if (field.ends_with(".wr.bytes")) r.counters.diskWrite += asU64(param);
+                } else if (field.starts_with("net.")) {
+                    if (field.ends_with(".rx.bytes")) r.counters.netRx += asU64(param);
+                    else if (field.ends_with(".tx.bytes")) r.counters.netTx += asU64(param);
+                }
+            }
+            r.memKiB = rss ? rss : current;
+            readings.push_back(std::move(r));
+        }
+        virDomainStatsRecordListFree(records);
+    }
+
+    // spans come from the monotonic clock; an explicit stamp stands in for both
+    const auto now = at ? Clock::time_point(std::chrono::duration_cast<Clock::duration>(at->time_since_epoch())) : Clock::now();
+    const std::uint32_t wall = unixSeconds(at.value_or(std::chrono::system_clock::now()));
+    const std::uint32_t period = clamp32(std::max<std::int64_t>(1, opts.rollup.count()));
+    std::vector<std::pair<std::string, std::string>> rows;
+    std::vector<DomainUsage> round;
+    round.reserve(readings.size());
+    std::vector<std::string> prune;
+    std::uint32_t cutoff = 0;
+    std::size_t trackedNow = 0;
+    {
+        std::lock_guard lock(mutex_);
+        const auto pass = ++passes;
+        for (auto& r : readings) {
+            auto [it, added] = series.try_emplace(r.name);
+            auto& s = it->second;
+            s.pass = pass;
+            if (added) {
+                // the first pass only primes the counters
+                retired.erase(r.name);
+                s.ring.reserve(opts.ringSamples);
+                s.last = r.counters;
+                s.sampledAt = now;
+                s.vcpus = r.vcpus;
+                continue;
+            }
+            const auto spanMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - s.sampledAt).count();
+            if (spanMs <= 0) continue;
+
+            Sample sample;
+            sample.at = wall;
+            sample.spanMs = static_cast<std::uint32_t>(std::min<std::int64_t>(spanMs, kMaxSpanMs));
+            sample.vcpus = std::min<std::uint32_t>(r.vcpus, kMaxVcpus);
+            sample.cpuUs = clamp32(delta(r.counters.cpuNs, s.last.cpuNs) / 1000);
+            sample.memKiB = clamp32(r.memKiB);
+            sample.diskReadKiB = clamp32(delta(r.counters.diskRead, s.last.diskRead) / 1024);
+            sample.diskWriteKiB = clamp32(delta(r.counters.diskWrite, s.last.diskWrite) / 1024);
+            sample.netRxKiB = clamp32(delta(r.counters.netRx, s.last.netRx) / 1024);
+            sample.netTxKiB = clamp32(delta(r.counters.netTx, s.last.netTx) / 1024);
+            s.last = r.counters;
+            s.sampledAt = now;
+            s.vcpus = r.vcpus;
+
+            if (opts.ringSamples > 0) {
+                if (s.ring.size() < opts.ringSamples) {
+                    s.ring.push_back(sample);
+                } else {
+                    s.ring[s.head] = sample;
+                    s.head = (s.head + 1) % opts.ringSamples;
+                }
+            }
+
+            const std::uint32_t bucket = wall - wall % period;
+            if (s.rollup.bucket != bucket) {
+                closeRollup(r.name, s.rollup, rows);
+                s.rollup = Rollup{};
+                s.rollup.bucket = bucket;
+            }
+            auto& roll = s.rollup;
+            roll.spanMs += sample.spanMs;
+            roll.cpuUs += sample.cpuUs;
+            roll.memKiBSum += sample.memKiB;
+            roll.memPeakKiB = std::max(roll.memPeakKiB, sample.memKiB);
+            ++roll.samples;
+            roll.diskReadKiB += sample.diskReadKiB;
+            roll.diskWriteKiB += sample.diskWriteKiB;
+            roll.netRxKiB += sample.netRxKiB;
+            roll.netTxKiB += sample.netTxKiB;
+            roll.vcpus = s.vcpus;
+
+            round.push_back(DomainUsage{r.name, pointOf(sample)});
+        }
+
+        // shut off or deleted: the open period is written now, the ring goes
+        for (auto it = series.begin(); it != series.end();) {
+            if (it->second.pass == pass) {
+                ++it;
+                continue;
+            }
+            if (it->second.rollup.bucket) retired[it->first] = it->second.rollup.bucket;
+            closeRollup(it->first, it->second.rollup, rows);
+            it = series.erase(it);
+        }
+
+        if (db && now - lastPrune >= kPruneEvery) {
+            lastPrune = now;
+            const auto keep = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(opts.retention).count());
+            cutoff = wall > keep ? static_cast<std::uint32_t>(wall - keep) : 0;
+            if (cutoff > 0) {
+                prune.reserve(series.size() + retired.size());
+                for (const auto& [name, _] : series) prune.push_back(name);
+                for (auto it = retired.begin(); it != retired.end();) {
+                    prune.push_back(it->first);
+                    // this prune takes its last rows: nothing of it is left to age out
+                    it = it->second < cutoff ? retired.erase(it) : std::next(it);
+                }
+            }
+        }
+        trackedNow = series.size();
+    }
+
+    if (db && (!rows.empty() || !prune.empty())) {
+        rocksdb::WriteBatch batch;
+        for (const auto& [key, value] : rows) batch.Put(toSlice(key), toSlice(value));
+        for (const auto& name : prune) batch.DeleteRange(rowKey(name, 0), rowKey(name, cutoff));
+        if (auto res = db->Write(rocksdb::WriteOptions{}, batch); !res) {
+            BoostLogger::Warn("UsageCollector: writing rollups failed: " + res.error().ToString());
+        }
+    }
+
+    trackedGauge.set(static_cast<double>(trackedNow));
+    if (!round.empty()) {
+        std::vector<Listener> toCall;
+        {
+            std::lock_guard lock(listenersMutex);
+            toCall.reserve(listeners.size());
+            for (const auto& [_, listener] : listeners) toCall.push_back(listener);
+        }
+        for (const auto& listener : toCall) listener(round);
+    }
+    latency.observe(Clock::now() - t0);
+    return Result<std::size_t>{readings.size()};
+}
+
+void UsageCollector::closeRollup(const std::string& domain, Rollup& r,
+                                 std::vector<std::pair<std::string, std::string>>& rows) const {
+    if (!db || !r.bucket || !r.samples) return;
+    std::string value;
+    value.reserve(96);
+    for (const std::uint64_t v : {r.spanMs, r.cpuUs, r.memKiBSum / r.samples, std::uint64_t{r.memPeakKiB}, r.diskReadKiB,
+                                  r.diskWriteKiB, r.netRxKiB, r.netTxKiB, std::uint64_t{r.vcpus}}) {
+        if (!value.empty()) value += ' ';
+        value += std::to_string(v);
+    }
+    rows.emplace_back(rowKey(domain, r.bucket), std::move(value));
+    r.samples = 0;
+}
+
+UsagePoint UsageCollector::pointOf(const Sample& s) {
+    UsagePoint p;
+    p.at = std::chrono::system_clock::time_point(std::chrono::seconds(s.at));
+    p.span = std::chrono::milliseconds(s.spanMs);
+    p.cpu = busyVcpus(s.cpuUs, s.spanMs);
+    p.vcpus = s.vcpus;
+    p.memoryKiB = p.memoryPeakKiB = s.memKiB;
+    p.diskReadBps = perSecond(s.diskReadKiB, s.spanMs);
+    p.diskWriteBps = perSecond(s.diskWriteKiB, s.spanMs);
+    p.netRxBps = perSecond(s.netRxKiB, s.spanMs);
+    p.netTxBps = perSecond(s.netTxKiB, s.spanMs);
+    return p;
+}
+
+UsagePoint UsageCollector::pointOf(const Rollup& r, std::uint32_t rollupSeconds) {
+    UsagePoint p;
+    p.at = std::chrono::system_clock::time_point(std::chrono::seconds(std::uint64_t{r.bucket} + rollupSeconds));
+    p.span = std::chrono::milliseconds(r.spanMs);
+    p.cpu = busyVcpus(r.cpuUs, r.spanMs);
+    p.vcpus = r.vcpus;
+    p.memoryKiB = r.samples ? r.memKiBSum / r.samples : 0;
+    p.memoryPeakKiB = r.memPeakKiB;
+    p.diskReadBps = perSecond(r.diskReadKiB, r.spanMs);
+    p.diskWriteBps = perSecond(r.diskWriteKiB, r.spanMs);
+    p.netRxBps = perSecond(r.netRxKiB, r.spanMs);
+    p.netTxBps = perSecond(r.netTxKiB, r.spanMs);
+    return p;
+}
+
+std::optional<UsagePoint> UsageCollector::latest(std::string_view domain) const {
+    std::lock_guard lock(mutex_);
+    auto it = series.find(std::string(domain));
+    if (it == series.end() || it->second.ring.empty()) return std::nullopt;
+    const auto& s = it->second;
+    const auto& newest = s.ring.size() < opts.ringSamples ? s.ring.back() : s.ring[(s.head + s.ring.size() - 1) % s.ring.size()];
+    return pointOf(newest);
+}
+
+std::vector<UsagePoint> UsageCollector::history(std::string_view domain, std::chrono::system_clock::time_point from,
+                                                std::chrono::system_clock::time_point to) const {
+    const std::uint32_t fromS = unixSeconds(from);
+    const std::uint32_t toS = unixSeconds(to);
+    if (toS < fromS) return {};
+
+    std::vector<UsagePoint> recent;
+    // end of the first sample the ring holds; a period starting before it has samples the ring has lost
+    std::uint32_t oldest = std::numeric_limits<std::uint32_t>::max();
+    std::uint32_t open = 0; // the period still folding: its row, if any, is from an earlier run of the VM
+    {
+        std::lock_guard lock(mutex_);
+        if (auto it = series.find(std::string(domain)); it != series.end() && !it->second.ring.empty()) {
+            const auto& s = it->second;
+            const std::size_t n = s.ring.size();
+            const std::size_t first = n < opts.ringSamples ? 0 : s.head;
+            oldest = s.ring[first].at;
+            open = s.rollup.bucket;
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto& sample = s.ring[(first + i) % n];
+                if (sample.at >= fromS && sample.at <= toS) recent.push_back(pointOf(sample));
+            }
+        }
+    }
+
+    std::vector<UsagePoint> out;
+    const std::uint32_t period = clamp32(std::max<std::int64_t>(1, opts.rollup.count()));
+    std::uint64_t covered = 0; // end of the newest closed rollup read: ring samples before it are in it
+    if (db && fromS < oldest) {
+        // the rollup holding `from` starts before it; every one starting before the ring has time the ring lacks
+        const std::string begin = rowKey(domain, fromS - fromS % period);
+        const std::string upper = rowKey(domain, std::min<std::uint64_t>(std::uint64_t{toS} + 1, oldest));
+        rocksdb::Slice upperSlice(upper);
+        rocksdb::ReadOptions ro;
+        ro.iterate_upper_bound = &upperSlice;
+        if (auto it = db->NewIterator(ro)) {
+            const std::size_t bucketAt = begin.size() - 10;
+            for (it->Seek(toSlice(begin)); it->Valid(); it->Next()) {
+                const auto k = it->key();
+                const auto v = it->value();
+                const std::string_view key(k.data(), k.size());
+                if (key.size() != begin.size()) continue;
+                std::uint32_t bucket = 0;
+                if (std::from_chars(key.data() + bucketAt, key.data() + key.size(), bucket).ec != std::errc{}) continue;
+                auto row = parseRow(std::string_view(v.data(), v.size()));
+                if (!row) continue;
+                const auto& f = *row;
+                Rollup r;
+                r.bucket = bucket;
+                r.spanMs = f[0];
+                r.cpuUs = f[1];
+                r.memKiBSum = f[2];
+                r.samples = 1;
+                r.memPeakKiB = clamp32(f[3]);
+                r.diskReadKiB = f[4];
+                r.diskWriteKiB = f[5];
+                r.netRxKiB = f[6];
+                r.netTxKiB = f[7];
+                r.vcpus = clamp32(f[8]);
+                out.push_back(pointOf(r, period));
+                if (bucket != open) covered = std::uint64_t{bucket} + period;
+            }
+        }
+    }
+    for (auto& p : recent) {
+        if (static_cast<std::uint64_t>(unixSeconds(p.at)) >= covered) out.push_back(std::move(p));
+    }
+    // a row of the open period ends after the samples that follow it
+    std::stable_sort(out.begin(), out.end(), [](const UsagePoint& a, const UsagePoint& b) { return a.at < b.at; });
+    return out;
+}
+
+std::vector<DomainUsage> UsageCollector::top(UsageMetric metric, std::size_t limit) const {
+    std::vector<DomainUsage> out;
+    {
+        std::lock_guard lock(mutex_);
+        out.reserve(series.size());
+        for (const auto& [name, s] : series) {
+            if (s.ring.empty()) continue;
+            const auto& newest = s.ring.size() < opts.ringSamples ? s.ring.back() : s.ring[(s.head + s.ring.size() - 1) % s.ring.size()];
+            out.push_back(DomainUsage{name, pointOf(newest)});
+        }
+    }
+    const std::size_t n = std::min(limit, out.size());
+    std::partial_sort(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(n), out.end(),
+        [metric](const DomainUsage& a, const DomainUsage& b) { return metricOf(a.point, metric) > metricOf(b.point, metric); });
+    out.resize(n);
+    return out;
+}
+
+std::size_t UsageCollector::tracked() const {
+    std::lock_guard lock(mutex_);
+    return series.size();
+}
+
+std::uint64_t UsageCollector::subscribe(Listener listener) {
+    std::lock_guard lock(listenersMutex);
+    const auto id = nextListenerId++;
+    listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void UsageCollector::unsubscribe(std::uint64_t id) {
+    std::lock_guard lock(listenersMutex);
+    std::erase_if(listeners, [id](const auto& entry) { return entry.first == id; });
+}
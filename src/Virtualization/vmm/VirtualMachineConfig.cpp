@@ -1,5 +1,163 @@
-#include "/home/hussin/Desktop/PenHive/include/Virtualization/vmm/VirtualMachineConfig.hpp"
-#include <sstream>
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+#include "Virtualization/vmm/DomainTemplateCache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <pugixml.hpp>
+
+namespace {
+
+// libvirt accepts b, KB/K/KiB, MB/M/MiB, GB/G/GiB, TB/T/TiB; its own dumps use KiB
+unsigned long long toKiB(unsigned long long value, std::string_view unit) {
+    if (unit.empty() || unit == "KiB" || unit == "K" || unit == "k") return value;
+    if (unit == "b" || unit == "bytes") return value / 1024;
+    if (unit == "KB") return value * 1000 / 1024;
+    if (unit == "MiB" || unit == "M") return value * 1024;
+    if (unit == "MB") return value * 1000 * 1000 / 1024;
+    if (unit == "GiB" || unit == "G") return value * 1024 * 1024;
+    if (unit == "GB") return value * 1000 * 1000 * 1000 / 1024;
+    if (unit == "TiB" || unit == "T") return value * 1024 * 1024 * 1024;
+    if (unit == "TB") return value * 1000 * 1000 * 1000 * 1000 / 1024;
+    return value;
+}
+
+unsigned long readKiB(pugi::xml_node node) {
+    return static_cast<unsigned long>(toKiB(node.text().as_ullong(0), node.attribute("unit").as_string()));
+}
+
+// the readiness checks that talk to the guest agent need its channel (see ReadinessSpec::fromConfig)
+bool needsGuestAgent(const VmConfig& cfg) {
+    if (cfg.guestAgent) return true;
+    if (auto it = cfg.metadata.find("ready.agent"); it != cfg.metadata.end() && it->second != "0") return true;
+    auto it = cfg.metadata.find("ready.services");
+    return it != cfg.metadata.end() && !it->second.empty();
+}
+
+// attribute that carries the disk source for each <disk type>
+const char* diskSourceAttribute(std::string_view type) noexcept {
+    if (type == "block") return "dev";
+    if (type == "dir") return "dir";
+    if (type == "network") return "name";
+    if (type == "volume") return "volume";
+    return "file";
+}
+
+// lab disks are linked clones thrown away with the lab: host crashes lose nothing worth keeping
+constexpr IoProfile kIoProfiles[] = {
+    {"lab-throwaway", "unsafe", "io_uring", "unmap", true, false},
+    {"persistent", "none", "native", "unmap", true, true},
+};
+
+// scans, floods and traffic generators choke on one queue pair with a 256-entry ring
+constexpr NetProfile kNetProfiles[] = {
+    {"vhost", "vhost", false, 0, 0},
+    {"throughput", "vhost", true, 1024, 0},
+};
+
+// queue pairs past this only add tap fds and interrupt vectors
+constexpr unsigned int kMaxNetQueues = 16;
+
+// multiqueue and iothreads only exist on virtio-blk
+bool isVirtioDisk(const DiskConfig& d) noexcept {
+    return d.device == "disk" && d.target.starts_with("vd");
+}
+
+void appendAttribute(std::string& xml, std::string_view name, std::string_view value) {
+    if (value.empty()) return;
+    xml += ' ';
+    xml += name;
+    xml += "='";
+    appendXmlEscaped(xml, value);
+    xml += "'";
+}
+
+} // namespace
+
+const IoProfile* VmConfig::findIoProfile(std::string_view name) noexcept {
+    for (const auto& profile : kIoProfiles) {
+        if (profile.name == name) return &profile;
+    }
+    return nullptr;
+}
+
+Result<void> VmConfig::applyIoProfile(VmConfig& cfg, std::string_view name) {
+    if (name.empty()) return Result<void>{};
+    const IoProfile* profile = findIoProfile(name);
+    if (!profile) return Result<void>{"Unknown I/O profile: " + std::string(name)};
+    for (auto& d : cfg.disks) {
+        if (d.device != "disk") continue; // cdroms are read-only media: nothing to tune
+        if (d.cache.empty()) d.cache = profile->cache;
+        // io=native needs O_DIRECT: qemu refuses it under a cache mode of the disk's own (writeback, ...)
+        if (d.io.empty() && (profile->io != "native" || d.cache == "none" || d.cache == "directsync")) d.io = profile->io;
+        if (d.discard.empty() && !d.readOnly) d.discard = profile->discard;
+        if (!isVirtioDisk(d)) continue;
+        if (profile->multiqueue && d.queues == 0) d.queues = std::max(cfg.vcpus, 1u);
+        if (profile->dedicatedIothreads && d.iothread == 0) d.iothread = ++cfg.iothreads;
+    }
+    // keep iothreads off the vCPU cores: they share the cell's spare CPUs with the emulator threads
+    auto& p = cfg.placement;
+    if (p.iothreadPins.empty() && !p.emulatorPin.empty()) p.iothreadPins.assign(cfg.iothreads, p.emulatorPin);
+    return Result<void>{};
+}
+
+const NetProfile* VmConfig::findNetProfile(std::string_view name) noexcept {
+    for (const auto& profile : kNetProfiles) {
+        if (profile.name == name) return &profile;
+    }
+    return nullptr;
+}
+
+void VmConfig::applyNetProfile(NetworkConfig& nic, const NetProfile& profile, unsigned int vcpus) {
+    if (!nic.model.empty() && nic.model != "virtio") return; // e1000 & co have no vhost or queues
+    if (nic.driverName.empty()) nic.driverName = profile.driver;
+    if (profile.multiqueue && nic.queues == 0 && vcpus > 1) nic.queues = std::min(vcpus, kMaxNetQueues);
+    if (nic.rxQueueSize == 0) nic.rxQueueSize = profile.rxQueueSize;
+    if (nic.txQueueSize == 0) nic.txQueueSize = profile.txQueueSize;
+}
+
+Result<void> VmConfig::applyNetProfile(VmConfig& cfg, std::string_view name) {
+    if (name.empty()) return Result<void>{};
+    const NetProfile* profile = findNetProfile(name);
+    if (!profile) return Result<void>{"Unknown network profile: " + std::string(name)};
+    for (auto& n : cfg.networks) applyNetProfile(n, *profile, cfg.vcpus);
+    return Result<void>{};
+}
+
+void VmConfig::writeInterfaceXML(std::string& xml, const NetworkConfig& n) {
+    const std::string_view type = n.type.empty() ? std::string_view("network") : std::string_view(n.type);
+    xml += "<interface type='";
+    appendXmlEscaped(xml, type);
+    xml += "'>";
+    if (type == "bridge" || type == "network") {
+        xml += type == "bridge" ? "<source bridge='" : "<source network='";
+        appendXmlEscaped(xml, n.source.empty() ? std::string_view("default") : std::string_view(n.source));
+        xml += "'/>";
+    } else if (type == "direct") {
+        xml += "<source dev='";
+        appendXmlEscaped(xml, n.source);
+        xml += "' mode='";
+        appendXmlEscaped(xml, n.directMode.empty() ? std::string_view("bridge") : std::string_view(n.directMode));
+        xml += "'/>";
+    }
+    if (!n.macAddress.empty()) {
+        xml += "<mac address='";
+        appendXmlEscaped(xml, n.macAddress);
+        xml += "'/>";
+    }
+    if (!n.model.empty()) {
+        xml += "<model type='";
+        appendXmlEscaped(xml, n.model);
+        xml += "'/>";
+    }
+    if (!n.driverName.empty() || n.queues || n.rxQueueSize || n.txQueueSize) {
+        xml += "<driver";
+        appendAttribute(xml, "name", n.driverName);
+        if (n.queues) appendAttribute(xml, "queues", std::to_string(n.queues));
+        if (n.rxQueueSize) appendAttribute(xml, "rx_queue_size", std::to_string(n.rxQueueSize));
+        if (n.txQueueSize) appendAttribute(xml, "tx_queue_size", std::to_string(n.txQueueSize));
+        xml += "/>";
+    }
+    xml += "</interface>";
+}
 
 bool VmConfig::validate() const {
     if (name.empty()) return false;
@@ -8,28 +166,302 @@ bool VmConfig::validate() const {
     return true;
 }
 
+// <cputune>/<numatune>/<memoryBacking>; order inside <domain> does not matter to libvirt
+void VmConfig::writePlacementXML(std::string& xml, const CpuPlacement& p, const MemoryTuning& memory) {
+    if (!p.vcpuPins.empty() || !p.emulatorPin.empty() || !p.iothreadPins.empty()) {
+        xml += "<cputune>";
+        for (std::size_t i = 0; i < p.vcpuPins.size(); ++i) {
+            xml += "<vcpupin vcpu='";
+            xml += std::to_string(i);
+            xml += "' cpuset='";
+            appendXmlEscaped(xml, p.vcpuPins[i]);
+            xml += "'/>";
+        }
+        if (!p.emulatorPin.empty()) {
+            xml += "<emulatorpin cpuset='";
+            appendXmlEscaped(xml, p.emulatorPin);
+            xml += "'/>";
+        }
+        for (std::size_t i = 0; i < p.iothreadPins.size(); ++i) {
+            xml += "<iothreadpin iothread='";
+            xml += std::to_string(i + 1);
+            xml += "' cpuset='";
+            appendXmlEscaped(xml, p.iothreadPins[i]);
+            xml += "'/>";
+        }
+        xml += "</cputune>";
+    }
+    if (!p.memoryNodes.empty()) {
+        xml += "<numatune><memory mode='";
+        appendXmlEscaped(xml, p.numaMode);
+        xml += "' nodeset='";
+        appendXmlEscaped(xml, p.memoryNodes);
+        xml += "'/></numatune>";
+    }
+    // hugepages and nosharepages share one <memoryBacking>: libvirt only allows a single one
+    if (p.hugepageSizeKiB == 0 && memory.sharePages) return;
+    xml += "<memoryBacking>";
+    if (p.hugepageSizeKiB > 0) {
+        xml += "<hugepages><page size='";
+        xml += std::to_string(p.hugepageSizeKiB);
+        xml += "' unit='KiB'";
+        if (!p.memoryNodes.empty()) {
+            xml += " nodeset='";
+            appendXmlEscaped(xml, p.memoryNodes);
+            xml += "'";
+        }
+        xml += "/></hugepages>";
+    }
+    if (!memory.sharePages) xml += "<nosharepages/>";
+    xml += "</memoryBacking>";
+}
+
+void VmConfig::writeXML(std::string& xml, const VmConfig& cfg) {
+    xml += "<domain type='kvm'><name>";
+    appendXmlEscaped(xml, cfg.name);
+    xml += "</name>";
+    if (!cfg.uuid.empty()) {
+        xml += "<uuid>";
+        appendXmlEscaped(xml, cfg.uuid);
+        xml += "</uuid>";
+    }
+    if (!cfg.title.empty()) {
+        xml += "<title>";
+        appendXmlEscaped(xml, cfg.title);
+        xml += "</title>";
+    }
+    if (!cfg.description.empty()) {
+        xml += "<description>";
+        appendXmlEscaped(xml, cfg.description);
+        xml += "</description>";
+    }
+    xml += "<metadata><penhive:domain xmlns:penhive='";
+    xml += kMetadataNamespace;
+    xml += "'/></metadata>";
+    xml += "<memory unit='KiB'>";
+    xml += std::to_string(cfg.memory);
+    xml += "</memory>";
+    if (cfg.currentMemory != 0 && cfg.currentMemory != cfg.memory) {
+        xml += "<currentMemory unit='KiB'>";
+        xml += std::to_string(cfg.currentMemory);
+        xml += "</currentMemory>";
+    }
+    // <vcpu> holds the maximum; current= is the number that is online at boot
+    xml += "<vcpu placement='static'";
+    if (cfg.maxVcpus > cfg.vcpus) {
+        xml += " current='";
+        xml += std::to_string(cfg.vcpus);
+        xml += "'";
+    }
+    xml += ">";
+    xml += std::to_string(std::max(cfg.vcpus, cfg.maxVcpus));
+    xml += "</vcpu>";
+    writePlacementXML(xml, cfg.placement, cfg.memoryTuning);
+    if (!cfg.resourcePartition.empty()) {
+        xml += "<resource><partition>";
+        appendXmlEscaped(xml, cfg.resourcePartition);
+        xml += "</partition></resource>";
+    }
+    if (cfg.iothreads > 0) {
+        xml += "<iothreads>";
+        xml += std::to_string(cfg.iothreads);
+        xml += "</iothreads>";
+    }
+    xml += "<os><type arch='";
+    appendXmlEscaped(xml, cfg.arch);
+    xml += "'>";
+    appendXmlEscaped(xml, cfg.osType);
+    xml += "</type></os><devices>";
+    if (!cfg.emulator.empty()) {
+        xml += "<emulator>";
+        appendXmlEscaped(xml, cfg.emulator);
+        xml += "</emulator>";
+    }
+    for (const auto& d : cfg.disks) {
+        xml += "<disk type='";
+        appendXmlEscaped(xml, d.type);
+        xml += "' device='";
+        appendXmlEscaped(xml, d.device);
+        xml += "'>";
+        if (!d.driver.empty() || !d.cache.empty() || !d.io.empty() || !d.discard.empty() || d.queues || d.iothread) {
+            xml += "<driver";
+            appendAttribute(xml, "type", d.driver);
+            appendAttribute(xml, "cache", d.cache);
+            appendAttribute(xml, "io", d.io);
+            appendAttribute(xml, "discard", d.discard);
+            if (d.queues) appendAttribute(xml, "queues", std::to_string(d.queues));
+            if (d.iothread) appendAttribute(xml, "iothread", std::to_string(d.iothread));
+            xml += "/>";
+        }
+        xml += "<source ";
+        xml += diskSourceAttribute(d.type);
+        xml += "='";
+        appendXmlEscaped(xml, d.source);
+        xml += "'/><target dev='";
+        appendXmlEscaped(xml, d.target);
+        xml += "'/>";
+        if (d.readOnly) xml += "<readonly/>";
+        xml += "</disk>";
+    }
+    if (cfg.networks.empty()) {
+        xml += "<interface type='network'><source network='default'/></interface>";
+    }
+    for (const auto& n : cfg.networks) writeInterfaceXML(xml, n);
+    if (needsGuestAgent(cfg)) {
+        xml += "<channel type='unix'><target type='virtio' name='org.qemu.guest_agent.0'/></channel>";
+    }
+    if (!cfg.graphics.type.empty()) {
+        xml += "<graphics type='";
+        appendXmlEscaped(xml, cfg.graphics.type);
+        if (cfg.graphics.autoport) {
+            xml += "' autoport='yes'";
+        } else {
+            xml += "' port='";
+            xml += std::to_string(cfg.graphics.port);
+            xml += "' autoport='no'";
+        }
+        if (!cfg.graphics.listenAddress.empty()) {
+            xml += " listen='";
+            appendXmlEscaped(xml, cfg.graphics.listenAddress);
+            xml += "'";
+        }
+        xml += "/>";
+    }
+    const auto& mem = cfg.memoryTuning;
+    if (!mem.balloon) {
+        xml += "<memballoon model='none'/>";
+    } else {
+        xml += "<memballoon model='virtio'";
+        if (mem.autodeflate) xml += " autodeflate='on'";
+        if (mem.freePageReporting) xml += " freePageReporting='on'";
+        if (mem.statsPeriod > 0) {
+            xml += "><stats period='";
+            xml += std::to_string(mem.statsPeriod);
+            xml += "'/></memballoon>";
+        } else {
+            xml += "/>";
+        }
+    }
+    xml += "</devices></domain>";
+}
+
 std::string VmConfig::toXML() const {
-    std::ostringstream xml;
-    xml << "<domain type='kvm'>"
-        << "<name>" << name << "</name>"
-        << "<memory unit='KiB'>" << memory << "</memory>"
-        << "<vcpu>" << vcpus << "</vcpu>"
-        << "<os><type arch='" << arch << "'>" << osType << "</type></os>";
-    xml << "<devices>";
-    if (!disks.empty()) {
-        const auto& d = disks.front();
-        xml << "<disk type='" << d.type << "' device='" << d.device << "'>"
-            << "<driver type='" << d.driver << "'/>"
-            << "<source file='" << d.source << "'/>"
-            << "<target dev='" << d.target << "'/>"
-            << "</disk>";
-    }
-    xml << "</devices></domain>";
-    return xml.str();
-}
-
-VmConfig VmConfig::fromXML(const std::string& /*xml*/) {
+    std::string xml;
+    xml.reserve(1024);
+    writeXML(xml, *this);
+    return xml;
+}
+
+Result<VmConfig> VmConfig::parse(std::string_view text) {
+    pugi::xml_document doc;
+    const auto loaded = doc.load_buffer(text.data(), text.size());
+    if (!loaded) return Result<VmConfig>{std::string("Invalid domain XML: ") + loaded.description()};
+    const auto domain = doc.child("domain");
+    if (!domain) return Result<VmConfig>{std::string("Invalid domain XML: no <domain> element")};
+
     VmConfig cfg;
-    // TODO: parse using pugixml for robust parsing
-    return cfg;
+    cfg.name = domain.child_value("name");
+    cfg.uuid = domain.child_value("uuid");
+    cfg.title = domain.child_value("title");
+    cfg.description = domain.child_value("description");
+    cfg.memory = readKiB(domain.child("memory"));
+    cfg.currentMemory = domain.child("currentMemory") ? readKiB(domain.child("currentMemory")) : cfg.memory;
+
+    const auto vcpu = domain.child("vcpu");
+    cfg.maxVcpus = vcpu.text().as_uint(0);
+    cfg.vcpus = vcpu.attribute("current").as_uint(cfg.maxVcpus);
+
+    const auto type = domain.child("os").child("type");
+    cfg.osType = type.child_value();
+    cfg.arch = type.attribute("arch").as_string();
+
+    if (const auto cputune = domain.child("cputune")) {
+        for (auto pin : cputune.children("vcpupin")) {
+            const auto index = pin.attribute("vcpu").as_uint();
+            if (index >= cfg.placement.vcpuPins.size()) cfg.placement.vcpuPins.resize(index + 1);
+            cfg.placement.vcpuPins[index] = pin.attribute("cpuset").as_string();
+        }
+        cfg.placement.emulatorPin = cputune.child("emulatorpin").attribute("cpuset").as_string();
+        for (auto pin : cputune.children("iothreadpin")) {
+            const auto id = pin.attribute("iothread").as_uint();
+            if (id == 0) continue;
+            if (id > cfg.placement.iothreadPins.size()) cfg.placement.iothreadPins.resize(id);
+            cfg.placement.iothreadPins[id - 1] = pin.attribute("cpuset").as_string();
+        }
+    }
+    cfg.iothreads = domain.child("iothreads").text().as_uint(0);
+    if (const auto memory = domain.child("numatune").child("memory")) {
+        cfg.placement.memoryNodes = memory.attribute("nodeset").as_string();
+        cfg.placement.numaMode = memory.attribute("mode").as_string("strict");
+    }
+    const auto backing = domain.child("memoryBacking");
+    if (const auto page = backing.child("hugepages").child("page")) {
+        cfg.placement.hugepageSizeKiB = static_cast<unsigned long>(toKiB(page.attribute("size").as_ullong(0), page.attribute("unit").as_string()));
+    }
+    if (backing.child("nosharepages")) cfg.memoryTuning.sharePages = false;
+
+    cfg.resourcePartition = domain.child("resource").child_value("partition");
+
+
+    const auto devices = domain.child("devices");
+    cfg.emulator = devices.child_value("emulator");
+    for (auto disk : devices.children("disk")) {
+        DiskConfig d;
+        d.type = disk.attribute("type").as_string("file");
+        d.device = disk.attribute("device").as_string("disk");
+        const auto driver = disk.child("driver");
+        d.driver = driver.attribute("type").as_string();
+        d.cache = driver.attribute("cache").as_string();
+        d.io = driver.attribute("io").as_string();
+        d.discard = driver.attribute("discard").as_string();
+        d.queues = driver.attribute("queues").as_uint(0);
+        d.iothread = driver.attribute("iothread").as_uint(0);
+        d.source = disk.child("source").attribute(diskSourceAttribute(d.type)).as_string();
+        d.target = disk.child("target").attribute("dev").as_string();
+        d.readOnly = static_cast<bool>(disk.child("readonly"));
+        cfg.disks.push_back(std::move(d));
+    }
+    for (auto iface : devices.children("interface")) {
+        NetworkConfig n;
+        n.type = iface.attribute("type").as_string("network");
+        const auto source = iface.child("source");
+        n.source = n.type == "bridge" ? source.attribute("bridge").as_string()
+                 : n.type == "network" ? source.attribute("network").as_string()
+                 : source.attribute("dev").as_string();
+        n.model = iface.child("model").attribute("type").as_string();
+        n.macAddress = iface.child("mac").attribute("address").as_string();
+        if (n.type == "direct") n.directMode = source.attribute("mode").as_string();
+        const auto driver = iface.child("driver");
+        n.driverName = driver.attribute("name").as_string();
+        n.queues = driver.attribute("queues").as_uint(0);
+        n.rxQueueSize = driver.attribute("rx_queue_size").as_uint(0);
+        n.txQueueSize = driver.attribute("tx_queue_size").as_uint(0);
+        cfg.networks.push_back(std::move(n));
+    }
+    for (auto channel : devices.children("channel")) {
+        if (std::strcmp(channel.child("target").attribute("name").as_string(), "org.qemu.guest_agent.0") == 0) {
+            cfg.guestAgent = true;
+        }
+    }
+    // only the first display is modelled; live XML also carries the port autoport picked
+    if (const auto g = devices.child("graphics")) {
+        cfg.graphics.type = g.attribute("type").as_string();
+        cfg.graphics.autoport = std::strcmp(g.attribute("autoport").as_string("no"), "yes") == 0;
+        cfg.graphics.port = g.attribute("port").as_int(-1);
+        cfg.graphics.listenAddress = g.attribute("listen").as_string(g.child("listen").attribute("address").as_string());
+    }
+    if (const auto balloon = devices.child("memballoon")) {
+        auto& mem = cfg.memoryTuning;
+        mem.balloon = std::strcmp(balloon.attribute("model").as_string("virtio"), "none") != 0;
+        mem.autodeflate = std::strcmp(balloon.attribute("autodeflate").as_string("off"), "on") == 0;
+        mem.freePageReporting = std::strcmp(balloon.attribute("freePageReporting").as_string("off"), "on") == 0;
+        mem.statsPeriod = balloon.child("stats").attribute("period").as_uint(0);
+    }
+    return Result<VmConfig>{std::move(cfg)};
+}
+
+VmConfig VmConfig::fromXML(const std::string& xml) {
+    auto res = parse(xml);
+    if (res.isErr()) return VmConfig{};
+    return std::move(res).unwrap();
 }
@@ -1,4 +1,5 @@
-#include "/home/hussin/Desktop/PenHive/include/Virtualization/vmm/VirtualMachineDriver.hpp"
+#include "Virtualization/vmm/VirtualMachineDriver.hpp"
+#include "Virtualization/vmm/LibvirtCall.hpp"
 #include <libvirt/libvirt.h>
 
 VirtualMachineDriver::VirtualMachineDriver(std::shared_ptr<HypervisorConnector> conn)
@@ -7,15 +8,15 @@ VirtualMachineDriver::~VirtualMachineDriver() = default;
 
 bool VirtualMachineDriver::startDomain(virDomainPtr domain) {
     if (!domain) return false;
-    return virDomainCreate(domain) == 0;
+    return LIBVIRT_CALL(virDomainCreate, domain) == 0;
 }
 
 bool VirtualMachineDriver::shutdownDomain(virDomainPtr domain) {
     if (!domain) return false;
-    return virDomainShutdown(domain) == 0;
+    return LIBVIRT_CALL(virDomainShutdown, domain) == 0;
 }
 
 bool VirtualMachineDriver::destroyDomain(virDomainPtr domain) {
     if (!domain) return false;
-    return virDomainDestroy(domain) == 0;
+    return LIBVIRT_CALL(virDomainDestroy, domain) == 0;
 }
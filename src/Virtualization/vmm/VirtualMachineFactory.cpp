@@ -1,38 +1,34 @@
-#include "/home/hussin/Desktop/PenHive/include/Virtualization/vmm/VirtualMachineFactory.hpp"
-#include <sstream>
+#include "Virtualization/vmm/VirtualMachineFactory.hpp"
+#include "Virtualization/vmm/LibvirtCall.hpp"
 #include <libvirt/libvirt.h>
 
 VirtualMachineFactory::VirtualMachineFactory(std::shared_ptr<HypervisorConnector> conn)
-    : connector(std::move(conn)) {}
+    : connector(std::move(conn)), templates(&VmConfig::writeXML, &VmConfig::writePlacementXML) {}
 VirtualMachineFactory::~VirtualMachineFactory() = default;
 
 Result<std::string> VirtualMachineFactory::buildDomainXML(const VmConfig& cfg) {
-    if (!cfg.validate()) return Result<std::string>{std::string("Invalid VM config")};
-    std::ostringstream xml;
-    xml << "<domain type='kvm'>"
-        << "<name>" << cfg.name << "</name>"
-        << "<memory unit='KiB'>" << cfg.memory << "</memory>"
-        << "<vcpu>" << cfg.vcpus << "</vcpu>"
-        << "<os><type arch='" << cfg.arch << "'>" << cfg.osType << "</type></os>"
-        << "<devices>";
-    if (!cfg.disks.empty()) {
-        const auto& d = cfg.disks[0];
-        xml << "<disk type='" << d.type << "' device='" << d.device << "'>"
-            << "<driver type='" << d.driver << "'/>"
-            << "<source file='" << d.source << "'/>"
-            << "<target dev='" << d.target << "'/>"
-            << "</disk>";
-    }
-    xml << "<interface type='network'><source network='default'/></interface>";
-    xml << "</devices></domain>";
-    return Result<std::string>{xml.str()};
+    if (!cfg.validate()) return Err{"Invalid VM config"};
+    std::string xml;
+    xml.reserve(1024);
+    VmConfig::writeXML(xml, cfg);
+    return Result<std::string>{std::move(xml)};
+}
+
+Result<std::string> VirtualMachineFactory::buildDomainXML(const VmConfig& cfg, std::string_view templateId) {
+    if (templateId.empty()) return buildDomainXML(cfg);
+    if (!cfg.validate()) return Err{"Invalid VM config"};
+    return templates.render(templateId, cfg);
 }
 
 Result<virDomainPtr> VirtualMachineFactory::defineDomain(const std::string& xml) {
     if (!connector) return Result<virDomainPtr>{std::string("No connector")};
-    virConnectPtr c = connector->getRawHandle();
-    if (!c) return Result<virDomainPtr>{std::string("Not connected")};
-    virDomainPtr dom = virDomainDefineXML(c, xml.c_str());
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception& e) {
+        return Result<virDomainPtr>{std::string("Not connected: ") + e.what()};
+    }
+    virDomainPtr dom = LIBVIRT_CALL(virDomainDefineXML, lease.get(), xml.c_str());
     if (!dom) {
         virErrorPtr err = virGetLastError();
         return Result<virDomainPtr>{std::string(std::string("virDomainDefineXML failed: ") + (err && err->message ? err->message : "unknown"))};
@@ -1,11 +1,72 @@
-#include "/home/hussin/Desktop/PenHive/include/Virtualization/vmm/VirtualMachineManager.hpp"
+#include "Virtualization/vmm/VirtualMachineManager.hpp"
+#include "Core/metrics/Metrics.hpp"
+#include "Virtualization/vmm/LibvirtCall.hpp"
 #include <libvirt/libvirt.h>
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <thread>
 #include <utility>
 
 using namespace std::chrono_literals;
 
+namespace {
+
+// VMs stamped from one template share a compiled domain XML template
+std::string_view templateIdOf(const VmConfig& cfg) noexcept {
+    auto it = cfg.metadata.find("template");
+    return it == cfg.metadata.end() ? std::string_view{} : std::string_view(it->second);
+}
+
+std::string_view metadataOf(const VmConfig& cfg, const std::string& key) noexcept {
+    auto it = cfg.metadata.find(key);
+    return it == cfg.metadata.end() ? std::string_view{} : std::string_view(it->second);
+}
+
+// disk and NIC tuning of the template, see VmConfig::applyIoProfile / applyNetProfile
+Result<void> applyProfiles(VmConfig& cfg) {
+    if (auto io = VmConfig::applyIoProfile(cfg, metadataOf(cfg, "ioProfile")); io.isErr()) return io;
+    return VmConfig::applyNetProfile(cfg, metadataOf(cfg, "netProfile"));
+}
+
+// a domain with snapshots (golden states) can only be undefined together with their metadata
+int undefineDomain(virDomainPtr domain) {
+    return virDomainUndefineFlags(domain, VIR_DOMAIN_UNDEFINE_SNAPSHOTS_METADATA | VIR_DOMAIN_UNDEFINE_MANAGED_SAVE);
+}
+
+using Clock = std::chrono::steady_clock;
+
+// penhive_deploy_stage_seconds{stage}: one series per step of dispatch_deploy
+METRICS::Histogram& deployStage(std::string_view stage) {
+    return METRICS::MetricsRegistry::global().histogram("penhive_deploy_stage_seconds",
+        "Time spent per step of a single deploy", {{"stage", std::string(stage)}});
+}
+
+METRICS::Histogram& batchStage(std::string_view stage) {
+    return METRICS::MetricsRegistry::global().histogram("penhive_deploy_batch_stage_seconds",
+        "Time spent per phase of a deploy batch", {{"stage", std::string(stage)}});
+}
+
+// records the time since the previous lap into a stage histogram
+class StageClock {
+public:
+    void lap(METRICS::Histogram& stage) noexcept {
+        const auto now = Clock::now();
+        stage.observe(now - mark);
+        mark = now;
+    }
+    void total(METRICS::Histogram& stage) const noexcept { stage.observe(Clock::now() - start); }
+
+private:
+    Clock::time_point start{Clock::now()};
+    Clock::time_point mark{start};
+};
+
+} // namespace
+
 VirtualMachineManager::VirtualMachineManager(std::shared_ptr<HypervisorConnector> conn,
-                                             std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher)
+                                             std::shared_ptr<CONCURRENCY::EventDispatcher> dispatcher,
+                                             std::shared_ptr<StorageOrchestrator> storage)
     : connector(std::move(conn)),
       vmpool(std::make_unique<VirtualMachinePool>(connector)),
       factory(std::make_unique<VirtualMachineFactory>(connector)),
@@ -18,12 +79,52 @@ VirtualMachineManager::VirtualMachineManager(std::shared_ptr<HypervisorConnector
         dispatcher_ = std::make_shared<CONCURRENCY::EventDispatcher>(2); // default 2 threads
         own_dispatcher_ = true;
     }
+
+    stateCache = std::make_shared<DomainStateCache>(connector, dispatcher_);
+    // domains undefined behind our back (virsh, another node) drop their cached handle, and so does
+    // a name redefined under a new uuid; the next lookup fetches a fresh one
+    registryListener = stateCache->subscribe([this](const DomainStateEvent& ev) {
+        if (ev.kind == DomainStateEvent::Kind::Removed) {
+            registry.erase(ev.entry.name);
+        } else if (auto cached = registry.find(ev.entry.name); cached && !ev.entry.uuid.empty() && cached->uuid() != ev.entry.uuid) {
+            registry.erase(ev.entry.name);
+        }
+    });
+    try {
+        stateCache->start();
+    } catch (const std::exception& e) {
+        // the cache still serves reads; health checks fall back to reconcile() until events work
+        BoostLogger::Warn(std::string("DomainStateCache: events unavailable: ") + e.what());
+    }
+    warmPool = std::make_unique<WarmPool>(*this, connector, dispatcher_, std::move(storage));
+    timerWheel = std::make_unique<CONCURRENCY::TimerWheel>(dispatcher_);
+    // the pool snapshot loads here while the dispatcher lists the domains; drift is repaired there
+    // and deploys wait for it, reads are served from the snapshot right away
+    reconciler = std::make_shared<StartupReconciler>(*vmpool, connector);
+    const int restored = reconciler->begin(*dispatcher_);
+    if (restored > 0) BoostLogger::Info("VirtualMachinePool: restored " + std::to_string(restored) + " records");
     BoostLogger::Info("VirtualMachineManager initialized");
 }
 
 VirtualMachineManager::~VirtualMachineManager() {
     // Stop any owned dispatcher (EventDispatcher::stop is safe to call)
     try {
+        if (reconciler) reconciler->cancel();
+        // first: deleting the instances still booting needs the prober and the rest of the manager
+        if (warmPool) warmPool->shutdown();
+        if (auto b = std::atomic_load(&balloons)) b->stop();
+        if (auto idle = std::atomic_load(&idleSuspender)) idle->stop();
+        if (auto prober = std::atomic_load(&readiness)) prober->stop();
+        if (auto collector = std::atomic_load(&usage)) {
+            collector->stop();
+            collector->unsubscribe(usageListener.load());
+        }
+        if (timerWheel) timerWheel->stop();
+        if (stateCache) {
+            stateCache->stop();
+            stateCache->unsubscribe(registryListener);
+        }
+        registry.clear();
         if (own_dispatcher_ && dispatcher_) {
             dispatcher_->stop();
             // allow graceful shutdown
@@ -35,58 +136,145 @@ VirtualMachineManager::~VirtualMachineManager() {
 }
 
 Result<int> VirtualMachineManager::dispatch_deploy(const VmConfig& cfg) {
-    std::scoped_lock lk(managerMutex);
+    static auto& prepareStage = deployStage("prepare");
+    static auto& xmlStage = deployStage("build_xml");
+    static auto& defineStage = deployStage("define");
+    static auto& allocateStage = deployStage("allocate");
+    static auto& goldenStage = deployStage("golden");
+    static auto& startStage = deployStage("start");
+    static auto& totalStage = deployStage("total");
+    static auto& succeeded = METRICS::MetricsRegistry::global().counter("penhive_deploys_total", "Single deploys by result", {{"result", "ok"}});
+    static auto& failed = METRICS::MetricsRegistry::global().counter("penhive_deploys_total", "Single deploys by result", {{"result", "error"}});
+    StageClock clock;
+    // parent of the libvirt spans below: what is left of the deploy's time is ours
+    TRACING::Span span("vm.deploy");
+    span.setAttribute("vm", cfg.name);
+
+    // factory, pool and driver are thread-safe and libvirt calls go through the connection pool,
+    // so concurrent deploys no longer serialize on managerMutex
     // ensure libvirt connection
     try {
         connector->connectOrThrow();
     } catch (const std::exception& e) {
+        failed.inc();
         return Result<int>{std::string("Connector error: ") + e.what()};
     }
 
+    // unique MACs for the NICs and a NUMA cell, unless the caller already chose them
+    VmConfig prepared = cfg;
+    std::vector<std::string> newMacs;
+    if (auto macs = assignMacs(prepared, newMacs); macs.isErr()) {
+        failed.inc();
+        return Result<int>{macs.unwrapErr()};
+    }
+    const bool placed = place(prepared);
+    partition(prepared);
+    const int consolePort = stampConsolePort(prepared);
+    bool portAdopted = false; // from allocate() on, the pool record owns the port
+    // gives back what was reserved above when a later step fails
+    auto rollback = [&] {
+        if (placed) unplace(cfg.name);
+        releaseMacs(newMacs);
+        if (!portAdopted) vmpool->releaseConsolePort(consolePort);
+        failed.inc();
+    };
+    if (auto profiles = applyProfiles(prepared); profiles.isErr()) {
+        rollback();
+        return Result<int>{profiles.unwrapErr()};
+    }
+    if (auto networks = ensureNetworks({&prepared, 1}); !networks.front().empty()) {
+        rollback();
+        return Result<int>{networks.front()};
+    }
+    clock.lap(prepareStage);
+
     // build XML
-    auto xmlRes = factory->buildDomainXML(cfg);
-    if (xmlRes.isErr()) return Result<int>{xmlRes.unwrapErr()};
+    auto xmlRes = factory->buildDomainXML(prepared, templateIdOf(prepared));
+    if (xmlRes.isErr()) {
+        rollback();
+        return Result<int>{xmlRes.unwrapErr()};
+    }
+    clock.lap(xmlStage);
 
     // define domain
     auto defRes = factory->defineDomain(xmlRes.unwrap());
-    if (defRes.isErr()) return Result<int>{defRes.unwrapErr()};
+    if (defRes.isErr()) {
+        rollback();
+        return Result<int>{defRes.unwrapErr()};
+    }
+    clock.lap(defineStage);
 
     // allocate metadata record
-    auto alloc = vmpool->allocate();
+    portAdopted = true;
+    auto alloc = vmpool->allocate(cfg.name, consolePort);
     if (alloc.isErr()) {
         // cleanup defined domain to avoid leak if needed
         virDomainPtr d = defRes.unwrap();
         if (d) {
             // try undefine (best-effort)
-            virDomainUndefine(d);
+            undefineDomain(d);
             virDomainFree(d);
         }
+        rollback();
         return Result<int>{alloc.unwrapErr()};
     }
 
+    clock.lap(allocateStage);
+
     virDomainPtr domain = defRes.unwrap();
+    snapshotGolden(domain, prepared);
+    clock.lap(goldenStage);
     // start domain
     if (!driver->startDomain(domain)) {
         // attempt cleanup
-        virDomainUndefine(domain);
+        undefineDomain(domain);
         virDomainFree(domain);
+        if (auto snapshots = std::atomic_load(&snapshotEngine)) snapshots->untrack(cfg.name);
+        rollback();
         return Result<int>{std::string("Failed to start domain")};
     }
 
-    // free domain handle (management via name)
+    clock.lap(startStage);
+
+    // the registry keeps its own reference for later lookups
+    (void)registry.insert(domain);
     virDomainFree(domain);
+    isolate(cfg);
+    watchReadiness(cfg);
+    // infrastructure the rest of the lab depends on is never suspended
+    if (auto idle = std::atomic_load(&idleSuspender); idle && deployWaveOf(cfg) == 0) idle->setExempt(cfg.name);
 
-    BoostLogger::Info("Domain deployed: {}", cfg.name);
+    clock.total(totalStage);
+    succeeded.inc();
+    PH_INFO(LogFields{.vm = cfg.name, .lab = LabSliceManager::labOf(cfg).value_or("")}, "Domain deployed, id {}", alloc.unwrap());
     return Result<int>{alloc.unwrap()};
 }
 
-void VirtualMachineManager::dispatch_deploy_async(const VmConfig& cfg, std::function<void(Result<int>)> callback) {
-    // make a copy of cfg for background task
-    VmConfig cfg_copy = cfg;
-    auto dispatcher = dispatcher_;
-    auto self = shared_from_this(); // NOTE: if class doesn't inherit enable_shared_from_this, this needs change
-    // To avoid requiring enable_shared_from_this, capture weak_ptr-less: we assume manager lifetime > tasks or dispatcher owned.
-    dispatcher->dispatch([this, cfg_copy = std::move(cfg_copy), callback = std::move(callback)]() mutable {
+Result<int> VirtualMachineManager::deploy_from_template(std::string_view templateId, const VmConfig& cfg) {
+    // a warm instance started in the default partition and a running qemu can't change it:
+    // lab VMs with a slice boot cold, inside their lab's budget from the first instruction
+    const bool sliced = std::atomic_load(&labSlices) && LabSliceManager::labOf(cfg);
+    if (!sliced) {
+        // lab networks must exist before a handout attaches NICs to them
+        if (auto networks = ensureNetworks({&cfg, 1}); !networks.front().empty()) return Result<int>{networks.front()};
+        auto warm = warmPool->acquire(templateId, cfg);
+        if (warm.isOk()) {
+            const auto inst = std::move(warm).unwrap();
+            // to the lab a handout is a deploy like any other: fabric refcount, readiness
+            isolate(inst.config);
+            watchReadiness(inst.config);
+            return Result<int>{inst.id};
+        }
+        BoostLogger::Info("Warm pool miss for " + std::string(templateId) + ": " + warm.unwrapErr());
+    }
+    VmConfig stamped = cfg;
+    stamped.metadata.try_emplace("template", templateId);
+    return dispatch_deploy(stamped);
+}
+
+std::optional<AdmissionRejection> VirtualMachineManager::dispatch_deploy_async(const VmConfig& cfg, std::function<void(Result<int>)> callback) {
+    // we assume manager lifetime > tasks (dispatcher is stopped in the destructor when owned)
+    auto work = [this, cfg_copy = cfg, callback = std::move(callback)]() {
         auto res = this->dispatch_deploy(cfg_copy);
         if (callback) {
             try {
@@ -95,110 +283,674 @@ void VirtualMachineManager::dispatch_deploy_async(const VmConfig& cfg, std::func
                 // swallow callback exceptions
             }
         }
-    });
+    };
+    auto gate = std::atomic_load(&admission);
+    if (!gate) {
+        dispatcher_->dispatch(CONCURRENCY::Lane::Blocking, std::move(work));
+        return std::nullopt;
+    }
+    auto ticket = gate->admit(cfg);
+    if (ticket.isErr()) return std::move(ticket).unwrapErr();
+    gate->start(std::move(ticket).unwrap(), std::move(work));
+    return std::nullopt;
+}
+
+namespace {
+
+std::chrono::milliseconds elapsedSince(Clock::time_point t0) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0);
+}
+
+void recordBatchTimings(const DeployStageTimings& t) {
+    static auto& buildXml = batchStage("build_xml");
+    static auto& define = batchStage("define");
+    static auto& allocate = batchStage("allocate");
+    static auto& start = batchStage("start");
+    static auto& total = batchStage("total");
+    buildXml.observe(t.buildXml);
+    define.observe(t.define);
+    allocate.observe(t.allocate);
+    start.observe(t.start);
+    total.observe(t.total);
+}
+
+} // namespace
+
+Result<DeployBatchResult> VirtualMachineManager::deploy_batch(const std::vector<VmConfig>& cfgs) {
+    const auto batchStart = Clock::now();
+    TRACING::Span span("vm.deploy_batch");
+    span.setAttribute("vms", std::to_string(cfgs.size()));
+    try {
+        connector->connectOrThrow();
+    } catch (const std::exception& e) {
+        return Result<DeployBatchResult>{std::string("Connector error: ") + e.what()};
+    }
+
+    DeployBatchResult batch;
+    batch.outcomes.resize(cfgs.size());
+    std::vector<std::string> xmls(cfgs.size());
+    std::vector<virDomainPtr> domains(cfgs.size(), nullptr);
+    std::vector<char> placed(cfgs.size(), 0); // not vector<bool>: written from parallel workers
+    std::vector<std::vector<std::string>> newMacs(cfgs.size());
+    std::vector<int> consolePorts(cfgs.size(), -1);
+    std::vector<DeployAdmission::Ticket> tickets(cfgs.size());
+    // behind admission control the batch takes no more define/start slots than the gate has
+    const auto gate = std::atomic_load(&admission);
+    const std::size_t width = gate ? std::min<std::size_t>(connector->getPoolSize(), gate->options().maxInFlight)
+                                   : connector->getPoolSize();
+
+    auto undefine = [&](std::size_t i) {
+        if (domains[i]) {
+            undefineDomain(domains[i]);
+            virDomainFree(domains[i]);
+            domains[i] = nullptr;
+        }
+    };
+
+    // an exception out of a stage fails only the VM it was thrown for
+    auto failed = [&](std::size_t i, std::string what) { batch.outcomes[i].error = std::move(what); };
+
+    // members the gate refuses fail up front, before they take MACs, NUMA room or a console port
+    if (gate) {
+        for (std::size_t i = 0; i < cfgs.size(); ++i) {
+            auto ticket = gate->admit(cfgs[i]);
+            if (!ticket.isErr()) { tickets[i] = std::move(ticket).unwrap(); continue; }
+            auto& out = batch.outcomes[i];
+            out.rejection = std::move(ticket).unwrapErr();
+            out.error = out.rejection->message + " (retry after " + std::to_string(out.rejection->retryAfter.count()) + "s)";
+        }
+    }
+
+    // lab segments of the whole batch in one go, before anything is defined on them
+    auto netErrors = ensureNetworks(cfgs);
+
+    // 1) build XML (CPU only)
+    auto t0 = Clock::now();
+    parallelFor(cfgs.size(), std::max<std::size_t>(width, std::thread::hardware_concurrency()), [&](std::size_t i) {
+        auto& out = batch.outcomes[i];
+        out.name = cfgs[i].name;
+        out.wave = deployWaveOf(cfgs[i]);
+        if (!out.error.empty()) return;
+        if (!netErrors[i].empty()) { out.error = std::move(netErrors[i]); return; }
+        VmConfig prepared = cfgs[i];
+        if (auto macs = assignMacs(prepared, newMacs[i]); macs.isErr()) { out.error = macs.unwrapErr(); return; }
+        placed[i] = place(prepared);
+        partition(prepared);
+        consolePorts[i] = stampConsolePort(prepared);
+        if (auto profiles = applyProfiles(prepared); profiles.isErr()) { out.error = profiles.unwrapErr(); return; }
+        auto xmlRes = factory->buildDomainXML(prepared, templateIdOf(prepared));
+        if (xmlRes.isErr()) { out.error = xmlRes.unwrapErr(); return; }
+        xmls[i] = std::move(xmlRes).unwrap();
+    }, failed);
+    batch.timings.buildXml = elapsedSince(t0);
+
+    // 2) define domains concurrently over the connection pool
+    t0 = Clock::now();
+    parallelFor(cfgs.size(), width, [&](std::size_t i) {
+        auto& out = batch.outcomes[i];
+        if (!out.error.empty()) return;
+        auto defRes = factory->defineDomain(xmls[i]);
+        if (defRes.isErr()) { out.error = defRes.unwrapErr(); return; }
+        domains[i] = defRes.unwrap();
+    }, failed);
+    batch.timings.define = elapsedSince(t0);
+
+    // 3) allocate pool records: one group commit for the whole batch
+    t0 = Clock::now();
+    std::vector<std::size_t> defined;
+    std::vector<std::string> names;
+    std::vector<int> ports;
+    for (std::size_t i = 0; i < cfgs.size(); ++i) {
+        if (!batch.outcomes[i].error.empty()) {
+            vmpool->releaseConsolePort(std::exchange(consolePorts[i], -1));
+            tickets[i] = {}; // its demand no longer holds back other deploys
+            continue;
+        }
+        defined.push_back(i);
+        names.push_back(cfgs[i].name);
+        ports.push_back(consolePorts[i]);
+    }
+    if (!defined.empty()) {
+        auto alloc = vmpool->allocateBatch(names, ports);
+        if (alloc.isErr()) {
+            const auto err = alloc.unwrapErr();
+            for (std::size_t i : defined) {
+                batch.outcomes[i].error = err;
+                undefine(i);
+                tickets[i] = {};
+            }
+        } else {
+            const auto& ids = alloc.unwrap();
+            for (std::size_t k = 0; k < defined.size(); ++k) batch.outcomes[defined[k]].id = ids[k];
+        }
+    }
+    batch.timings.allocate = elapsedSince(t0);
+
+    // 4) start in dependency waves; a wave starts only after the previous one returned
+    t0 = Clock::now();
+    std::map<unsigned int, std::vector<std::size_t>> waves;
+    for (std::size_t i = 0; i < cfgs.size(); ++i) {
+        if (batch.outcomes[i].error.empty()) waves[batch.outcomes[i].wave].push_back(i);
+    }
+    auto abandon = [&](std::size_t i, std::string error) {
+        auto& out = batch.outcomes[i];
+        out.error = std::move(error);
+        if (out.id >= 0) (void)vmpool->remove(out.id);
+        out.id = -1;
+        // a throw after the start would leave the guest running without its definition
+        if (domains[i] && virDomainIsActive(domains[i]) == 1) virDomainDestroy(domains[i]);
+        undefine(i);
+        if (auto snapshots = std::atomic_load(&snapshotEngine)) snapshots->untrack(cfgs[i].name);
+    };
+    for (const auto& [wave, members] : waves) {
+        const auto waveStart = Clock::now();
+        parallelFor(members.size(), width, [&](std::size_t k) {
+            const std::size_t i = members[k];
+            auto startOne = [&] {
+                snapshotGolden(domains[i], cfgs[i]);
+                if (!driver->startDomain(domains[i])) {
+                    virErrorPtr err = virGetLastError();
+                    abandon(i, std::string("Failed to start domain: ") + (err && err->message ? err->message : "unknown"));
+                    return;
+                }
+                (void)registry.insert(domains[i]);
+                isolate(cfgs[i]);
+                watchReadiness(cfgs[i]);
+                if (auto idle = std::atomic_load(&idleSuspender); idle && wave == 0) idle->setExempt(cfgs[i].name);
+            };
+            // the start holds one of the gate's slots: queued single deploys wait for it like for any other
+            if (gate) gate->run(std::move(tickets[i]), startOne);
+            else startOne();
+        }, [&](std::size_t k, std::string what) { abandon(members[k], std::move(what)); });
+        batch.timings.waves.push_back(elapsedSince(waveStart));
+    }
+    batch.timings.start = elapsedSince(t0);
+
+    for (auto& d : domains) {
+        if (d) virDomainFree(d);
+    }
+    for (std::size_t i = 0; i < cfgs.size(); ++i) {
+        if (batch.outcomes[i].error.empty()) continue;
+        if (placed[i]) unplace(cfgs[i].name);
+        releaseMacs(newMacs[i]);
+    }
+    batch.timings.total = elapsedSince(batchStart);
+    recordBatchTimings(batch.timings);
+
+    BoostLogger::Info("deploy_batch: " + std::to_string(batch.succeeded()) + "/" + std::to_string(cfgs.size())
+        + " domains up in " + std::to_string(batch.timings.total.count()) + " ms");
+    return Result<DeployBatchResult>{std::move(batch)};
+}
+
+// awaitables are built on the caller's loop; the lambdas only run once the coroutine suspends
+CONCURRENCY::Offload<Result<int>> VirtualMachineManager::co_deploy(VmConfig cfg) {
+    return {dispatcher_, CONCURRENCY::Lane::Blocking, [this, cfg = std::move(cfg)] { return dispatch_deploy(cfg); }};
+}
+
+CONCURRENCY::Offload<Result<std::unique_ptr<VirtualMachine>>> VirtualMachineManager::co_find(std::string name) {
+    return {dispatcher_, CONCURRENCY::Lane::Blocking, [this, name = std::move(name)] {
+        // a VM paused or saved for idling is brought back before anyone looks at it
+        if (auto woken = wake(name); woken.isErr()) BoostLogger::Warn("Resume of idle domain failed: " + woken.unwrapErr());
+        return findDomainByName(name);
+    }};
+}
+
+CONCURRENCY::Offload<Result<std::vector<DomainSummary>>> VirtualMachineManager::co_list(bool includeInactive) {
+    return {dispatcher_, CONCURRENCY::Lane::Blocking, [this, includeInactive] { return listDomainSummaries(includeInactive); }};
+}
+
+CONCURRENCY::Offload<Result<void>> VirtualMachineManager::co_delete(std::string name, bool deleteStorage) {
+    return {dispatcher_, CONCURRENCY::Lane::Blocking, [this, name = std::move(name), deleteStorage] { return deleteDomain(name, deleteStorage); }};
+}
+
+CONCURRENCY::Offload<Result<ConsoleEndpoint>> VirtualMachineManager::co_console(std::string name) {
+    return {dispatcher_, CONCURRENCY::Lane::Blocking, [this, name = std::move(name)] { return consoleEndpoint(name); }};
+}
+
+Result<ConsoleEndpoint> VirtualMachineManager::consoleEndpoint(std::string_view name) {
+    // an idle-suspended VM has no listening display until it is resumed
+    if (auto woken = wake(name); woken.isErr()) return Result<ConsoleEndpoint>{woken.unwrapErr()};
+    auto cfg = getConfig(name);
+    if (cfg.isErr()) return Result<ConsoleEndpoint>{cfg.unwrapErr()};
+    const auto& graphics = cfg.unwrap()->graphics;
+    if (graphics.type != "vnc" && graphics.type != "spice") {
+        return Result<ConsoleEndpoint>{std::string("Domain has no VNC/SPICE display: ") + std::string(name)};
+    }
+    ConsoleEndpoint endpoint;
+    endpoint.type = graphics.type;
+    // a wildcard listen is reachable on loopback; the proxy runs on the hypervisor host
+    endpoint.host = graphics.listenAddress.empty() || graphics.listenAddress == "0.0.0.0" ? "127.0.0.1" : graphics.listenAddress;
+    const auto reserved = vmpool->consolePort(name);
+    // domains defined before ports were stamped (or with autoport) listen where the live XML says
+    if (graphics.port > 0 && graphics.port <= 65535) endpoint.port = static_cast<std::uint16_t>(graphics.port);
+    else if (reserved) endpoint.port = *reserved;
+    else return Result<ConsoleEndpoint>{std::string("Domain display has no port yet: ") + std::string(name)};
+    if (reserved && *reserved != endpoint.port) {
+        BoostLogger::Warn("Console of " + std::string(name) + " listens on " + std::to_string(endpoint.port)
+            + ", pool reserved " + std::to_string(*reserved));
+    }
+    return Result<ConsoleEndpoint>{std::move(endpoint)};
 }
 
 std::shared_ptr<std::atomic<bool>> VirtualMachineManager::schedule_health_check(std::string vmName, std::chrono::seconds interval) {
     auto cancelFlag = std::make_shared<std::atomic<bool>>(false);
-    auto dispatcher = dispatcher_;
-    // recursive shared task
-    auto task = std::make_shared<std::function<void()>>();
-    *task = [this, dispatcher, vmName, interval, cancelFlag, task]() {
+    auto cache = stateCache;
+    auto check = [cache, vmName = std::move(vmName), cancelFlag]() {
         if (cancelFlag->load()) return;
-        // check VM state (synchronous call inside dispatcher thread)
-        auto res = this->findDomainByName(vmName);
-        if (res.isOk()) {
-            auto vm = res.unwrap();
-            auto state = vm->getState();
-            BoostLogger::Info("HealthCheck: VM '{}' state: {}", vmName, static_cast<int>(state));
+        // state comes from the event-fed cache: no lookup, no manager lock, no VirtualMachine object
+        if (!cache->isEventDriven()) cache->reconcile();
+        // runs every interval for every watched VM: trace only, compiled out of release builds
+        if (auto entry = cache->get(vmName)) {
+            PH_TRACE(LogFields{.vm = vmName}, "HealthCheck: state {}", static_cast<int>(entry->state));
         } else {
-            BoostLogger::Warn("HealthCheck: VM '{}' not found or error: {}", vmName, res.unwrapErr());
-        }
-        // schedule next tick
-        if (!cancelFlag->load()) {
-            dispatcher->dispatch_delayed(interval, [task]() {
-                // call the stored function
-                try {
-                    (*task)();
-                } catch (...) { /* swallow */ }
-            });
+            PH_WARN(LogFields{.vm = vmName}, "HealthCheck: VM not found");
         }
     };
 
-    // start first check asynchronously
-    dispatcher->dispatch([task]() {
-        try { (*task)(); } catch (...) {}
-    });
+    // without domain events every check falls back to a libvirt reconcile
+    const auto lane = cache->isEventDriven() ? CONCURRENCY::Lane::Cpu : CONCURRENCY::Lane::Blocking;
+    // first check right away, then on the shared wheel; the flag drops the job at its next tick
+    dispatcher_->dispatch(lane, check);
+    CONCURRENCY::WheelJobOptions opts;
+    opts.jitter = interval / 10;
+    opts.lane = lane;
+    opts.cancelFlag = cancelFlag;
+    (void)timerWheel->schedule_every(interval, std::move(check), std::move(opts));
 
     return cancelFlag;
 }
 
-Result<std::unique_ptr<VirtualMachine>> VirtualMachineManager::findDomainByName(std::string_view name) {
-    std::lock_guard<std::mutex> lk(managerMutex);
-    if (!connector->isConnected()) {
-        if (!connector->connect()) {
-            return Result<std::unique_ptr<VirtualMachine>>{std::string("Failed to connect to hypervisor")};
-        }
+Result<VirtualMachine::VmState> VirtualMachineManager::getState(std::string_view name) const {
+    if (auto entry = stateCache->get(name)) return Result<VirtualMachine::VmState>{VirtualMachine::VmState{entry->state}};
+    return Result<VirtualMachine::VmState>{std::string("Domain not found: ") + std::string(name)};
+}
+
+std::vector<DomainStateEntry> VirtualMachineManager::listStates() const {
+    return stateCache->list();
+}
+
+bool VirtualMachineManager::alive(const DomainHandle& handle) noexcept {
+    // a handle outlives a libvirtd restart but not usefully; IsAlive is answered locally
+    return virConnectIsAlive(virDomainGetConnect(handle.get())) == 1;
+}
+
+DomainHandlePtr VirtualMachineManager::handleOf(std::string_view name) {
+    if (auto handle = registry.find(name)) {
+        if (alive(*handle)) return handle;
+        registry.erase(name);
+    }
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception&) {
+        return nullptr;
     }
+    virDomainPtr domain = LIBVIRT_CALL(virDomainLookupByName, lease.get(), std::string(name).c_str());
+    if (!domain) return nullptr;
+    auto handle = registry.insert(domain);
+    virDomainFree(domain);
+    return handle;
+}
 
-    virDomainPtr domain = virDomainLookupByName(connector->getRawHandle(), name.data());
-    if (!domain) {
-        return Result<std::unique_ptr<VirtualMachine>>{std::string("Domain not found: " + std::string(name))};
+DomainHandlePtr VirtualMachineManager::handleOfUuid(std::string_view uuid) {
+    if (auto handle = registry.findByUuid(uuid)) {
+        if (alive(*handle)) return handle;
+        registry.erase(handle->name());
     }
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+    virDomainPtr domain = LIBVIRT_CALL(virDomainLookupByUUIDString, lease.get(), std::string(uuid).c_str());
+    if (!domain) return nullptr;
+    auto handle = registry.insert(domain);
     virDomainFree(domain);
-    return Result<std::unique_ptr<VirtualMachine>>{std::make_unique<VirtualMachine>(connector, std::string(name))};
+    return handle;
 }
 
-Result<std::vector<std::unique_ptr<VirtualMachine>>> VirtualMachineManager::listAllDomains() {
-    std::lock_guard<std::mutex> lk(managerMutex);
-    if (!connector->isConnected()) {
-        if (!connector->connect()) {
-            return Result<std::vector<std::unique_ptr<VirtualMachine>>>{std::string("Failed to connect to hypervisor")};
-        }
+Result<std::unique_ptr<VirtualMachine>> VirtualMachineManager::findDomainByName(std::string_view name) {
+    // registry hit: one shard read lock and a virDomainRef, no libvirt round trip
+    auto handle = handleOf(name);
+    if (!handle) {
+        return Result<std::unique_ptr<VirtualMachine>>{std::string("Domain not found: " + std::string(name))};
+    }
+    try {
+        return Result<std::unique_ptr<VirtualMachine>>{std::make_unique<VirtualMachine>(connector, name, handle->get())};
+    } catch (const VmException& e) {
+        return Result<std::unique_ptr<VirtualMachine>>{std::string(e.what())};
     }
+}
 
-    int count = virConnectNumOfDomains(connector->getRawHandle());
-    if (count < 0) {
-        return Result<std::vector<std::unique_ptr<VirtualMachine>>>{std::string("Failed to get domain count")};
+Result<std::unique_ptr<VirtualMachine>> VirtualMachineManager::findDomainByUuid(std::string_view uuid) {
+    auto handle = handleOfUuid(uuid);
+    if (!handle) {
+        return Result<std::unique_ptr<VirtualMachine>>{std::string("Domain not found: " + std::string(uuid))};
+    }
+    try {
+        return Result<std::unique_ptr<VirtualMachine>>{std::make_unique<VirtualMachine>(connector, handle->name(), handle->get())};
+    } catch (const VmException& e) {
+        return Result<std::unique_ptr<VirtualMachine>>{std::string(e.what())};
+    }
+}
+
+Result<std::shared_ptr<const VmConfig>> VirtualMachineManager::getConfig(std::string_view name) {
+    auto handle = handleOf(name);
+    if (!handle) {
+        return Result<std::shared_ptr<const VmConfig>>{std::string("Domain not found: " + std::string(name))};
+    }
+    char* xml = virDomainGetXMLDesc(handle->get(), 0);
+    if (!xml) {
+        return Result<std::shared_ptr<const VmConfig>>{std::string("Failed to read XML of domain: " + std::string(name))};
+    }
+    auto cfg = configCache.get(name, xml);
+    free(xml);
+    return cfg;
+}
+
+Result<std::vector<std::unique_ptr<VirtualMachine>>> VirtualMachineManager::listAllDomains() {
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception&) {
+        return Result<std::vector<std::unique_ptr<VirtualMachine>>>{std::string("Failed to connect to hypervisor")};
     }
-    if (count == 0) return Result<std::vector<std::unique_ptr<VirtualMachine>>>{std::vector<std::unique_ptr<VirtualMachine>>{}};
 
-    std::vector<int> ids(static_cast<size_t>(count));
-    int actual = virConnectListDomains(connector->getRawHandle(), ids.data(), count);
-    if (actual < 0) {
+    // one call instead of NumOfDomains + ListDomains + LookupByID per domain
+    virDomainPtr* domains = nullptr;
+    int count = virConnectListAllDomains(lease.get(), &domains, VIR_CONNECT_LIST_DOMAINS_ACTIVE);
+    if (count < 0) {
         return Result<std::vector<std::unique_ptr<VirtualMachine>>>{std::string("Failed to list domains")};
     }
 
     std::vector<std::unique_ptr<VirtualMachine>> vms;
-    vms.reserve(actual);
+    vms.reserve(static_cast<size_t>(count));
 
-    for (int i = 0; i < actual; ++i) {
-        virDomainPtr domain = virDomainLookupByID(connector->getRawHandle(), ids[i]);
-        if (!domain) continue;
-        const char* name = virDomainGetName(domain);
+    for (int i = 0; i < count; ++i) {
+        // the listed handles are the lookups: each VirtualMachine takes its own reference, and the
+        // registry keeps one so later finds skip virDomainLookupByName
+        const char* name = virDomainGetName(domains[i]);
         if (name) {
-            vms.push_back(std::make_unique<VirtualMachine>(connector, std::string(name)));
+            try {
+                vms.push_back(std::make_unique<VirtualMachine>(connector, std::string(name), domains[i]));
+                if (!registry.find(name)) (void)registry.insert(domains[i]);
+            } catch (const VmException&) {
+                // virDomainRef failed
+            }
         }
-        virDomainFree(domain);
+        virDomainFree(domains[i]);
     }
+    free(domains);
 
     return Result<std::vector<std::unique_ptr<VirtualMachine>>>{std::move(vms)};
 }
 
+Result<std::vector<DomainSummary>> VirtualMachineManager::listDomainSummaries(bool includeInactive) {
+    HypervisorConnectionPool::Lease lease;
+    try {
+        lease = connector->acquire();
+    } catch (const std::exception&) {
+        return Result<std::vector<DomainSummary>>{std::string("Failed to connect to hypervisor")};
+    }
+    return collectDomainSummaries(lease.get(), includeInactive ? 0u : static_cast<unsigned int>(VIR_CONNECT_LIST_DOMAINS_ACTIVE));
+}
+
 Result<void> VirtualMachineManager::deleteDomain(std::string_view name, bool /*deleteStorage*/) {
-    std::lock_guard<std::mutex> lk(managerMutex);
+    // no manager-wide lock: two deletes of one name race in libvirt, and the loser gets its error
     auto vmRes = findDomainByName(name);
     if (vmRes.isErr()) {
         return Result<void>{vmRes.unwrapErr()};
     }
-    auto vm = vmRes.unwrap();
+    auto vm = std::move(vmRes).unwrap();
     if (vm->isActive()) {
         if (virDomainDestroy(vm->getRawHandle()) < 0) {
             return Result<void>{std::string("Failed to destroy running domain: " + std::string(name))};
         }
     }
-    if (virDomainUndefine(vm->getRawHandle()) < 0) {
+    if (undefineDomain(vm->getRawHandle()) < 0) {
         return Result<void>{std::string("Failed to undefine domain: " + std::string(name))};
     }
+    forget(std::string(name));
     return Result<void>{};
-}
\ No newline at end of file
+}
+
+void VirtualMachineManager::releaseMigrated(std::string_view name) {
+    // libvirt already undefined the source copy (VIR_MIGRATE_UNDEFINE_SOURCE)
+    forget(std::string(name));
+}
+
+void VirtualMachineManager::forget(const std::string& name) {
+    registry.erase(name);
+    (void)vmpool->removeByName(name); // also frees the console port
+    if (auto slices = std::atomic_load(&labSlices)) slices->detachDomain(name);
+    if (auto fabric = std::atomic_load(&networkFabric)) {
+        // the lab's last VM here is gone: its segments go with it (a later apply recreates them)
+        if (auto lab = fabric->release(name); lab) {
+            if (auto res = fabric->releaseLab(*lab); res.isErr()) BoostLogger::Warn("Lab networks: " + res.unwrapErr());
+        }
+    }
+    unplace(name);
+    if (auto macs = std::atomic_load(&macAllocator)) macs->releaseOwner(name);
+    if (auto snapshots = std::atomic_load(&snapshotEngine)) snapshots->untrack(name);
+    if (auto idle = std::atomic_load(&idleSuspender)) idle->forget(name);
+    if (auto prober = std::atomic_load(&readiness)) prober->forget(name);
+    configCache.erase(name);
+}
+
+void VirtualMachineManager::setSnapshotEngine(std::shared_ptr<SnapshotEngine> engine) {
+    std::atomic_store(&snapshotEngine, std::move(engine));
+}
+
+void VirtualMachineManager::setBalloonController(std::shared_ptr<BalloonController> controller, std::chrono::seconds interval) {
+    if (controller) controller->start(*timerWheel, interval);
+    if (auto previous = std::atomic_exchange(&balloons, std::move(controller))) previous->stop();
+}
+
+void VirtualMachineManager::setIdleSuspender(std::shared_ptr<IdleSuspender> suspender, std::chrono::seconds interval) {
+    if (suspender) suspender->start(*timerWheel, interval);
+    std::atomic_store(&usageSinks->idle, suspender);
+    if (auto previous = std::atomic_exchange(&idleSuspender, std::move(suspender))) previous->stop();
+}
+
+void VirtualMachineManager::setReadinessProber(std::shared_ptr<ReadinessProber> prober) {
+    if (prober) prober->start(*timerWheel);
+    if (auto previous = std::atomic_exchange(&readiness, std::move(prober))) previous->stop();
+}
+
+void VirtualMachineManager::setUsageCollector(std::shared_ptr<UsageCollector> collector, std::chrono::seconds interval) {
+    std::uint64_t listener = 0;
+    if (collector) {
+        // the consumers are looked up per pass, so they may be set before or after the collector
+        listener = collector->subscribe([weak = std::weak_ptr<UsageSinks>(usageSinks)](const std::vector<DomainUsage>& round) {
+            auto sinks = weak.lock();
+            if (!sinks) return;
+            if (auto idle = std::atomic_load(&sinks->idle)) idle->observe(round);
+            if (auto engine = std::atomic_load(&sinks->placement)) {
+                std::vector<std::pair<std::string, double>> busy;
+                busy.reserve(round.size());
+                for (const auto& u : round) busy.emplace_back(u.domain, u.point.cpu);
+                engine->observeLoad(busy);
+            }
+        });
+        collector->start(*timerWheel, interval);
+    }
+    const auto previousListener = usageListener.exchange(listener);
+    if (auto previous = std::atomic_exchange(&usage, std::move(collector))) {
+        previous->stop();
+        previous->unsubscribe(previousListener);
+    }
+}
+
+Result<void> VirtualMachineManager::wake(std::string_view name) {
+    auto idle = std::atomic_load(&idleSuspender);
+    if (!idle) return Result<void>{};
+    return idle->ensureRunning(name);
+}
+
+void VirtualMachineManager::touch(std::string_view name) {
+    if (auto idle = std::atomic_load(&idleSuspender)) idle->touch(name);
+}
+
+int VirtualMachineManager::stampConsolePort(VmConfig& cfg) {
+    auto& graphics = cfg.graphics;
+    if (graphics.type != "vnc" && graphics.type != "spice") return VirtualMachinePool::kNoConsolePort;
+    if (!graphics.autoport && graphics.port > 0) {
+        // fixed ports are marked too, or an autoport VM could be handed the same one later
+        if (vmpool->claimConsolePort(graphics.port)) return graphics.port;
+        BoostLogger::Warn("Console port " + std::to_string(graphics.port) + " of " + cfg.name + " is held by another VM");
+        return VirtualMachinePool::kNoConsolePort;
+    }
+    const int port = vmpool->reserveConsolePort();
+    // range exhausted: leave it to libvirt's autoport, the proxy then reads the live port
+    if (port < 0) return VirtualMachinePool::kNoConsolePort;
+    graphics.port = port;
+    graphics.autoport = false;
+    return port;
+}
+
+void VirtualMachineManager::snapshotGolden(virDomainPtr domain, const VmConfig& cfg) {
+    auto snapshots = std::atomic_load(&snapshotEngine);
+    if (!snapshots) return;
+    const auto lab = LabSliceManager::labOf(cfg);
+    const std::string templateId(templateIdOf(cfg));
+    // only lab members and template instances have a state worth resetting to
+    if (!lab && templateId.empty()) return;
+    if (lab) snapshots->track(cfg.name, *lab, templateId);
+    if (!snapshots->golden(templateId).captureOnDeploy) return;
+    if (auto res = snapshots->captureGolden(domain, templateId); res.isErr()) {
+        BoostLogger::Warn("Golden snapshot of " + cfg.name + " failed: " + res.unwrapErr());
+    }
+}
+
+void VirtualMachineManager::setLabSlices(std::shared_ptr<LabSliceManager> slices) {
+    std::atomic_store(&labSlices, std::move(slices));
+    wireAdmission();
+}
+
+void VirtualMachineManager::setDeployAdmission(std::shared_ptr<DeployAdmission> gate) {
+    std::atomic_store(&admission, std::move(gate));
+    wireAdmission();
+}
+
+void VirtualMachineManager::wireAdmission() {
+    if (auto gate = std::atomic_load(&admission)) gate->setCapacitySources(std::atomic_load(&placement), std::atomic_load(&labSlices));
+}
+
+void VirtualMachineManager::setNetworkFabric(std::shared_ptr<NetworkFabric> fabric) {
+    std::atomic_store(&networkFabric, std::move(fabric));
+}
+
+std::vector<std::string> VirtualMachineManager::ensureNetworks(std::span<const VmConfig> cfgs) {
+    std::vector<std::string> errors(cfgs.size());
+    auto fabric = std::atomic_load(&networkFabric);
+    if (!fabric) return errors;
+    std::vector<std::string> names;
+    std::vector<std::size_t> owner;
+    for (std::size_t i = 0; i < cfgs.size(); ++i) {
+        for (const auto& n : cfgs[i].networks) {
+            if (n.type != "network" || !NetworkFabric::isLabNetwork(n.source)) continue;
+            names.push_back(n.source);
+            owner.push_back(i);
+        }
+    }
+    if (names.empty()) return errors;
+    const auto failed = fabric->ensure(names);
+    for (std::size_t k = 0; k < names.size(); ++k) {
+        if (!failed[k].empty() && errors[owner[k]].empty()) errors[owner[k]] = failed[k];
+    }
+    return errors;
+}
+
+void VirtualMachineManager::isolate(const VmConfig& cfg) {
+    auto lab = LabSliceManager::labOf(cfg);
+    if (!lab) return;
+    if (auto fabric = std::atomic_load(&networkFabric)) fabric->retain(*lab, cfg.name);
+    // qemu already started in the lab's partition (see partition()); this only records membership
+    if (auto slices = std::atomic_load(&labSlices)) slices->attachDomain(*lab, cfg.name, std::uint64_t{cfg.memory} * 1024);
+}
+
+void VirtualMachineManager::partition(VmConfig& cfg) {
+    if (!cfg.resourcePartition.empty()) return;
+    auto lab = LabSliceManager::labOf(cfg);
+    auto slices = std::atomic_load(&labSlices);
+    if (!lab || !slices) return;
+    // the VM still runs, in libvirt's default /machine partition; only the lab budget is lost
+    auto res = slices->partitionFor(*lab);
+    if (res.isErr()) {
+        BoostLogger::Warn("Lab isolation for " + cfg.name + ": " + res.unwrapErr());
+        return;
+    }
+    cfg.resourcePartition = std::move(res).unwrap();
+}
+
+void VirtualMachineManager::watchReadiness(const VmConfig& cfg) {
+    // outside a lab nobody waits on the guest; the warm pool watches its own instances
+    auto lab = LabSliceManager::labOf(cfg);
+    if (!lab) return;
+    if (auto prober = std::atomic_load(&readiness)) prober->watch(cfg.name, *lab, ReadinessSpec::fromConfig(cfg));
+}
+
+void VirtualMachineManager::setPlacementEngine(std::shared_ptr<PlacementEngine> engine) {
+    std::atomic_store(&usageSinks->placement, engine);
+    std::atomic_store(&placement, std::move(engine));
+    wireAdmission();
+}
+
+bool VirtualMachineManager::place(VmConfig& cfg) {
+    if (!cfg.placement.empty()) return false;
+    auto engine = std::atomic_load(&placement);
+    if (!engine) return false;
+    // an unplaced VM still runs, just floating over all host CPUs
+    // clones of one template share a base image: keep them on one cell for KSM
+    auto res = engine->place(cfg.name, cfg.vcpus, cfg.memory, std::string(templateIdOf(cfg)));
+    if (res.isErr()) {
+        BoostLogger::Warn("NUMA placement for " + cfg.name + ": " + res.unwrapErr());
+        return false;
+    }
+    cfg.placement = std::move(res).unwrap();
+    return true;
+}
+
+void VirtualMachineManager::unplace(const std::string& name) {
+    if (auto engine = std::atomic_load(&placement)) engine->release(name);
+}
+
+void VirtualMachineManager::setMacAllocator(std::shared_ptr<MacAllocator> allocator) {
+    std::atomic_store(&macAllocator, std::move(allocator));
+}
+
+Result<void> VirtualMachineManager::assignMacs(VmConfig& cfg, std::vector<std::string>& reserved) {
+    auto macs = std::atomic_load(&macAllocator);
+    if (!macs) return {};
+    const auto lab = LabSliceManager::labOf(cfg).value_or("");
+    for (auto& nic : cfg.networks) {
+        if (nic.macAddress.empty()) {
+            auto mac = macs->allocate(cfg.name, lab);
+            if (mac.isErr()) {
+                releaseMacs(reserved);
+                return Result<void>{mac.unwrapErr()};
+            }
+            nic.macAddress = std::move(mac).unwrap();
+            reserved.push_back(nic.macAddress);
+            continue;
+        }
+        // caller-chosen address: refuse it if another VM already has it
+        const bool known = macs->contains(nic.macAddress);
+        if (!macs->reserve(nic.macAddress, cfg.name)) {
+            releaseMacs(reserved);
+            const auto owner = macs->ownerOf(nic.macAddress);
+            return Result<void>{"MAC " + nic.macAddress + (owner ? " already used by " + *owner : std::string(" is not a valid unicast address"))};
+        }
+        if (!known) reserved.push_back(nic.macAddress);
+    }
+    return {};
+}
+
+void VirtualMachineManager::releaseMacs(std::vector<std::string>& reserved) {
+    if (reserved.empty()) return;
+    if (auto macs = std::atomic_load(&macAllocator)) {
+        for (const auto& mac : reserved) macs->release(mac);
+    }
+    reserved.clear();
+}
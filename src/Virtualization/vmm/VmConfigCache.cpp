@@ -0,0 +1,39 @@
+#include "Virtualization/vmm/VmConfigCache.hpp"
+#include <functional>
+#include <mutex>
+
+Result<std::shared_ptr<const VmConfig>> VmConfigCache::get(std::string_view domain, std::string_view xml) {
+    const std::size_t hash = std::hash<std::string_view>{}(xml);
+    const std::string key(domain);
+    {
+        std::shared_lock lock(mutex_);
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.hash == hash && it->second.length == xml.size()) {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return Result<std::shared_ptr<const VmConfig>>{it->second.config};
+        }
+    }
+    // parsed outside the lock; two racing misses both parse the same XML and either result is fine
+    auto parsed = VmConfig::parse(xml);
+    if (parsed.isErr()) return Result<std::shared_ptr<const VmConfig>>{parsed.unwrapErr()};
+    auto config = std::make_shared<const VmConfig>(std::move(parsed).unwrap());
+    parses.fetch_add(1, std::memory_order_relaxed);
+    std::unique_lock lock(mutex_);
+    entries[key] = Entry{hash, xml.size(), config};
+    return Result<std::shared_ptr<const VmConfig>>{std::move(config)};
+}
+
+void VmConfigCache::erase(std::string_view domain) {
+    std::unique_lock lock(mutex_);
+    entries.erase(std::string(domain));
+}
+
+void VmConfigCache::clear() {
+    std::unique_lock lock(mutex_);
+    entries.clear();
+}
+
+std::size_t VmConfigCache::size() const {
+    std::shared_lock lock(mutex_);
+    return entries.size();
+}
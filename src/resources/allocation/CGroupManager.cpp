@@ -0,0 +1,117 @@
+#include "resources/allocation/CGroupManager.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+std::string limitValue(std::uint64_t v) {
+    return v == CGroupManager::kUnlimited ? std::string("max") : std::to_string(v);
+}
+
+} // namespace
+
+CGroupManager::CGroupManager(const std::string& name, std::string root)
+    : cgroupPath(std::move(root) + "/" + name)
+{
+    createCGroup();
+}
+
+CGroupManager::~CGroupManager() {
+    closeAll();
+}
+
+void CGroupManager::createCGroup() {
+    if (mkdir(cgroupPath.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::system_error(errno, std::system_category(), "Failed to create cgroup " + cgroupPath);
+    }
+}
+
+void CGroupManager::remove() {
+    closeAll();
+    if (rmdir(cgroupPath.c_str()) != 0 && errno != ENOENT) {
+        throw std::system_error(errno, std::system_category(), "Failed to remove cgroup " + cgroupPath);
+    }
+}
+
+void CGroupManager::enableControllers(std::string_view controllers) {
+    writeValue("cgroup.subtree_control", std::string(controllers));
+}
+
+void CGroupManager::setCPULimit(unsigned long quota_us, unsigned long period_us) {
+    writeValue("cpu.max", limitValue(quota_us) + " " + std::to_string(period_us));
+}
+
+void CGroupManager::setCPUWeight(unsigned int weight) {
+    writeValue("cpu.weight", std::to_string(weight));
+}
+
+void CGroupManager::setMemoryLimit(const std::string& limit) {
+    writeValue("memory.max", limit);
+}
+
+void CGroupManager::setMemoryLimit(std::uint64_t bytes) {
+    writeValue("memory.max", limitValue(bytes));
+}
+
+void CGroupManager::setMemoryHigh(std::uint64_t bytes) {
+    writeValue("memory.high", limitValue(bytes));
+}
+
+void CGroupManager::setIOLimit(const std::string& device, std::uint64_t rbps, std::uint64_t wbps,
+                               std::uint64_t riops, std::uint64_t wiops) {
+    writeValue("io.max", device + " rbps=" + limitValue(rbps) + " wbps=" + limitValue(wbps)
+        + " riops=" + limitValue(riops) + " wiops=" + limitValue(wiops));
+}
+
+void CGroupManager::setPidsLimit(std::uint64_t max) {
+    writeValue("pids.max", limitValue(max));
+}
+
+void CGroupManager::addProcess(pid_t pid) {
+    writeValue("cgroup.procs", std::to_string(pid));
+}
+
+std::uint64_t CGroupManager::readValue(const std::string& file) const {
+    // read-only and rare (admission checks): no cached descriptor
+    const std::string full = cgroupPath + "/" + file;
+    const int fd = ::open(full.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::system_category(), "Cannot open cgroup file " + full);
+    char buf[32];
+    const ssize_t n = ::pread(fd, buf, sizeof(buf) - 1, 0);
+    const int err = errno;
+    ::close(fd);
+    if (n < 0) throw std::system_error(err, std::system_category(), "Cannot read cgroup file " + full);
+    buf[n] = '\0';
+    if (std::strncmp(buf, "max", 3) == 0) return kUnlimited;
+    return std::strtoull(buf, nullptr, 10);
+}
+
+int CGroupManager::fdOf(const std::string& file) {
+    auto it = fds.find(file);
+    if (it != fds.end()) return it->second;
+    const std::string full = cgroupPath + "/" + file;
+    const int fd = ::open(full.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::system_category(), "Cannot open cgroup file " + full);
+    fds.emplace(file, fd);
+    return fd;
+}
+
+void CGroupManager::writeValue(const std::string& file, const std::string& value) {
+    std::lock_guard lock(mutex_);
+    const int fd = fdOf(file);
+    // cgroupfs takes each write as one command; the offset is ignored, pwrite just avoids lseek
+    if (::pwrite(fd, value.data(), value.size(), 0) < 0) {
+        throw std::system_error(errno, std::system_category(), "Cannot write to cgroup file " + file + ": " + value);
+    }
+}
+
+void CGroupManager::closeAll() noexcept {
+    std::lock_guard lock(mutex_);
+    for (auto& [file, fd] : fds) ::close(fd);
+    fds.clear();
+}
@@ -0,0 +1,57 @@
+#include "resources/allocation/KsmTuner.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+KsmTuner::KsmTuner(std::string sysfsRoot)
+    : root(std::move(sysfsRoot)) {}
+
+Result<void> KsmTuner::write(const char* file, const std::string& value) const {
+    const std::string path = root + "/" + file;
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return Result<void>{"Cannot open " + path + ": " + std::strerror(errno)};
+    const ssize_t n = ::write(fd, value.data(), value.size());
+    const int err = errno;
+    ::close(fd);
+    if (n != static_cast<ssize_t>(value.size())) return Result<void>{"Cannot write " + path + ": " + std::strerror(err)};
+    return Result<void>{};
+}
+
+Result<std::uint64_t> KsmTuner::read(const char* file) const {
+    const std::string path = root + "/" + file;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return Result<std::uint64_t>{"Cannot open " + path + ": " + std::strerror(errno)};
+    char buf[32];
+    const ssize_t n = ::read(fd, buf, sizeof(buf));
+    ::close(fd);
+    std::uint64_t value = 0;
+    if (n <= 0 || std::from_chars(buf, buf + n, value).ec != std::errc{}) return Result<std::uint64_t>{"Cannot parse " + path};
+    return Result<std::uint64_t>{value};
+}
+
+Result<void> KsmTuner::enable(const KsmSettings& settings) {
+    // EBUSY while pages are merged: keep whatever the host already runs with
+    (void)write("merge_across_nodes", settings.mergeAcrossNodes ? "1" : "0");
+    if (auto res = write("pages_to_scan", std::to_string(settings.pagesToScan)); res.isErr()) return res;
+    if (auto res = write("sleep_millisecs", std::to_string(settings.sleepMillisecs)); res.isErr()) return res;
+    return write("run", "1");
+}
+
+Result<void> KsmTuner::disable() {
+    return write("run", "0");
+}
+
+Result<KsmStats> KsmTuner::stats() const {
+    KsmStats s;
+    auto sharing = read("pages_sharing");
+    if (sharing.isErr()) return Result<KsmStats>{sharing.unwrapErr()};
+    s.pagesSharing = sharing.unwrap();
+    if (auto v = read("pages_shared"); v.isOk()) s.pagesShared = v.unwrap();
+    if (auto v = read("pages_unshared"); v.isOk()) s.pagesUnshared = v.unwrap();
+    if (auto v = read("full_scans"); v.isOk()) s.fullScans = v.unwrap();
+    if (auto v = read("run"); v.isOk()) s.running = v.unwrap() == 1;
+    s.savedBytes = s.pagesSharing * static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    return Result<KsmStats>{s};
+}
@@ -0,0 +1,142 @@
+#include "resources/allocation/LabSliceManager.hpp"
+#include <algorithm>
+#include <cctype>
+#include <system_error>
+
+LabSliceManager::LabSliceManager(std::string cgroupRoot, std::string sliceName)
+    : sliceName(sliceName), root(std::move(cgroupRoot) + "/" + sliceName)
+{
+    const auto parent = root.substr(0, root.rfind('/'));
+    slice = std::make_unique<CGroupManager>(sliceName, parent);
+    slice->enableControllers();
+}
+
+void LabSliceManager::setDefaultLimits(SliceLimits limits) {
+    std::lock_guard lock(mutex_);
+    defaults = std::move(limits);
+}
+
+Result<void> LabSliceManager::setLimits(const std::string& lab, const SliceLimits& limits) {
+    if (!validName(lab)) return Result<void>{"Invalid lab id: " + lab};
+    std::lock_guard lock(mutex_);
+    try {
+        auto& entry = ensureLab(lab);
+        entry.limits = limits;
+        apply(*entry.group, limits);
+    } catch (const std::exception& e) {
+        return Result<void>{std::string("cgroup: ") + e.what()};
+    }
+    return {};
+}
+
+Result<std::string> LabSliceManager::partitionFor(const std::string& lab) {
+    // T == E here: errors must go through Err or they come back as the partition
+    if (!validName(lab)) return Err{"Invalid lab id: " + lab};
+    std::lock_guard lock(mutex_);
+    try {
+        (void)ensureLab(lab);
+    } catch (const std::exception& e) {
+        return Err{std::string("cgroup: ") + e.what()};
+    }
+    // relative to the cgroup root, which is how libvirt resolves partitions
+    return Result<std::string>{"/" + sliceName + "/" + groupName(lab)};
+}
+
+void LabSliceManager::attachDomain(const std::string& lab, const std::string& domainName, std::uint64_t memoryBytes) {
+    std::lock_guard lock(mutex_);
+    domainLab[domainName] = Member{lab, memoryBytes};
+}
+
+void LabSliceManager::detachDomain(const std::string& domainName) {
+    std::lock_guard lock(mutex_);
+    // libvirt removes the domain's own leaf when qemu exits
+    domainLab.erase(domainName);
+}
+
+Result<void> LabSliceManager::removeLab(const std::string& lab) {
+    std::lock_guard lock(mutex_);
+    auto it = labs_.find(lab);
+    if (it == labs_.end()) return {};
+    try {
+        it->second.group->remove();
+    } catch (const std::exception& e) {
+        return Result<void>{std::string("cgroup: ") + e.what()};
+    }
+    std::erase_if(domainLab, [&](const auto& kv) { return kv.second.lab == lab; });
+    labs_.erase(it);
+    return {};
+}
+
+std::optional<std::uint64_t> LabSliceManager::memoryRoom(const std::string& lab) const {
+    std::lock_guard lock(mutex_);
+    auto it = labs_.find(lab);
+    const auto limit = it == labs_.end() ? defaults.memoryMaxBytes : it->second.limits.memoryMaxBytes;
+    if (limit == CGroupManager::kUnlimited) return std::nullopt;
+    // guests touch their RAM lazily: memory.current of a lab that just booted is far below what
+    // its domains may grow to, so what they were given counts even before it is resident
+    std::uint64_t committed = 0;
+    for (const auto& [domain, member] : domainLab) {
+        if (member.lab == lab) committed += member.memoryBytes;
+    }
+    // a lab without a group yet has nothing running
+    if (it != labs_.end()) {
+        try {
+            committed = std::max(committed, it->second.group->readValue("memory.current"));
+        } catch (const std::exception&) {
+            // unreadable: the reservations alone
+        }
+    }
+    return committed < limit ? limit - committed : 0;
+}
+
+std::vector<std::string> LabSliceManager::labs() const {
+    std::lock_guard lock(mutex_);
+    std::vector<std::string> out;
+    out.reserve(labs_.size());
+    for (const auto& [name, lab] : labs_) out.push_back(name);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::optional<std::string> LabSliceManager::labOf(const VmConfig& cfg) {
+    for (const char* key : {"lab", "tenant"}) {
+        auto it = cfg.metadata.find(key);
+        if (it != cfg.metadata.end() && !it->second.empty()) return it->second;
+    }
+    return std::nullopt;
+}
+
+// ids end up as directory names: no separators, no dot-only names
+bool LabSliceManager::validName(const std::string& name) {
+    if (name.empty() || name.size() > 128 || name == "." || name == "..") return false;
+    return std::all_of(name.begin(), name.end(), [](unsigned char c) {
+        return std::isalnum(c) || c == '-' || c == '_' || c == '.';
+    });
+}
+
+std::string LabSliceManager::groupName(const std::string& lab) {
+    return "lab-" + lab + ".partition";
+}
+
+LabSliceManager::Lab& LabSliceManager::ensureLab(const std::string& lab) {
+    auto it = labs_.find(lab);
+    if (it != labs_.end()) return it->second;
+    Lab entry;
+    entry.group = std::make_unique<CGroupManager>(groupName(lab), root);
+    // libvirt's per-VM leaves below the lab need the same controllers
+    entry.group->enableControllers();
+    entry.limits = defaults;
+    apply(*entry.group, entry.limits);
+    return labs_.emplace(lab, std::move(entry)).first->second;
+}
+
+void LabSliceManager::apply(CGroupManager& group, const SliceLimits& limits) {
+    group.setCPULimit(limits.cpuQuotaUs, limits.cpuPeriodUs);
+    group.setCPUWeight(limits.cpuWeight);
+    group.setMemoryHigh(limits.memoryHighBytes);
+    group.setMemoryLimit(limits.memoryMaxBytes);
+    group.setPidsLimit(limits.pidsMax);
+    for (const auto& io : limits.io) {
+        group.setIOLimit(io.device, io.rbps, io.wbps, io.riops, io.wiops);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "ScratchDb.hpp"
+#include "Virtualization/vmm/HypervisorConnector.hpp"
+#include "Virtualization/vmm/VirtualMachineConfig.hpp"
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace bench {
+
+// libvirt's built-in test driver: domains, networks and pools live in this
+// process, so the deploy path runs end to end without qemu or root
+inline constexpr const char* kTestHypervisor = "test:///default";
+
+// a connector on the test driver; throws when libvirt was built without it
+inline std::shared_ptr<HypervisorConnector> testHypervisor(std::shared_ptr<IRocksDB> db) {
+    auto connector = std::make_shared<HypervisorConnector>(std::move(db));
+    if (!connector->connect(kTestHypervisor)) throw std::runtime_error("cannot open test:///default");
+    return connector;
+}
+
+// what a lab VM looks like: one qcow2 disk, NICs on the default network, a SPICE console
+inline VmConfig labVm(std::string name, unsigned int nics = 1) {
+    VmConfig cfg;
+    cfg.name = std::move(name);
+    cfg.osType = "hvm";
+    cfg.arch = "x86_64";
+    cfg.memory = 1024 * 1024;
+    cfg.vcpus = 2;
+    DiskConfig disk;
+    disk.type = "file";
+    disk.device = "disk";
+    disk.source = "/var/lib/libvirt/images/" + cfg.name + ".qcow2";
+    disk.target = "vda";
+    disk.driver = "qcow2";
+    cfg.disks.push_back(std::move(disk));
+    for (unsigned int i = 0; i < nics; ++i) {
+        NetworkConfig nic;
+        nic.type = "network";
+        nic.source = "default";
+        nic.model = "virtio";
+        cfg.networks.push_back(std::move(nic));
+    }
+    cfg.graphics.type = "spice";
+    cfg.graphics.listenAddress = "127.0.0.1";
+    cfg.graphics.autoport = true;
+    cfg.metadata["template"] = "bench-lab-vm";
+    return cfg;
+}
+
+} // namespace bench
@@ -0,0 +1,93 @@
+// deploy N VMs end to end on libvirt's test driver: MACs, placement, XML, define, pool commit, start.
+// No qemu behind it, so the numbers are the control plane's own cost per deploy; a regression here
+// is ours, not the hypervisor's.
+#include "BenchFixtures.hpp"
+#include "Virtualization/vmm/VirtualMachineManager.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// members go in reverse: the manager before the connector, the DB last
+struct Rig {
+    fixtures::ScratchDb scratch;
+    std::shared_ptr<HypervisorConnector> connector;
+    std::unique_ptr<VirtualMachineManager> manager;
+
+    Rig() : connector(bench::testHypervisor(scratch.db())),
+            manager(std::make_unique<VirtualMachineManager>(connector)) {}
+};
+
+std::vector<VmConfig> lab(std::int64_t vms) {
+    static std::atomic<unsigned int> seq{0};
+    const std::string prefix = "bench-" + std::to_string(seq++) + "-";
+    std::vector<VmConfig> cfgs;
+    for (std::int64_t i = 0; i < vms; ++i) cfgs.push_back(bench::labVm(prefix + std::to_string(i)));
+    return cfgs;
+}
+
+void teardown(VirtualMachineManager& manager, const std::vector<VmConfig>& cfgs) {
+    for (const auto& cfg : cfgs) (void)manager.deleteDomain(cfg.name, false);
+}
+
+// one dispatch_deploy per VM, one after the other (what the API does for single creates)
+void BM_Deploy_Sequential(benchmark::State& state) {
+    std::unique_ptr<Rig> rig;
+    try {
+        rig = std::make_unique<Rig>();
+    } catch (const std::exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto cfgs = lab(state.range(0));
+        state.ResumeTiming();
+        for (const auto& cfg : cfgs) {
+            if (auto id = rig->manager->dispatch_deploy(cfg); id.isErr()) {
+                state.SkipWithError(id.unwrapErr().c_str());
+                break;
+            }
+        }
+        state.PauseTiming();
+        teardown(*rig->manager, cfgs);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Deploy_Sequential)->Arg(1)->Arg(10)->Arg(50)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// a whole lab through deploy_batch: defines in parallel, one pool commit, start waves
+void BM_Deploy_Batch(benchmark::State& state) {
+    std::unique_ptr<Rig> rig;
+    try {
+        rig = std::make_unique<Rig>();
+    } catch (const std::exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto cfgs = lab(state.range(0));
+        state.ResumeTiming();
+        auto res = rig->manager->deploy_batch(cfgs);
+        if (res.isErr()) {
+            state.SkipWithError(res.unwrapErr().c_str());
+            break;
+        }
+        if (res.unwrap().failed()) {
+            state.SkipWithError("some VMs of the batch failed to deploy");
+            break;
+        }
+        state.PauseTiming();
+        teardown(*rig->manager, cfgs);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Deploy_Batch)->Arg(10)->Arg(50)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
@@ -0,0 +1,69 @@
+// EventDispatcher: throughput of short CPU tasks and the post-to-run latency, per executor mode
+#include "Core/concurrency/EventDispatcher.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace {
+
+using CONCURRENCY::EventDispatcher;
+using CONCURRENCY::ExecutorMode;
+
+ExecutorMode modeOf(const benchmark::State& state) {
+    return state.range(0) ? ExecutorMode::WorkStealing : ExecutorMode::SharedQueue;
+}
+
+// a burst of no-op tasks, timed until the last one has run
+void BM_Dispatcher_Throughput(benchmark::State& state) {
+    EventDispatcher dispatcher(modeOf(state), static_cast<std::size_t>(state.range(1)));
+    dispatcher.start();
+    constexpr int kBurst = 10000;
+    // outside the loop: the last task may still be notifying when the waiter moves on
+    std::atomic<int> left{0};
+    std::mutex m;
+    std::condition_variable done;
+    for (auto _ : state) {
+        left.store(kBurst, std::memory_order_relaxed);
+        for (int i = 0; i < kBurst; ++i) {
+            dispatcher.dispatch([&] {
+                if (left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::scoped_lock lock(m);
+                    done.notify_one();
+                }
+            });
+        }
+        std::unique_lock lock(m);
+        done.wait(lock, [&] { return left.load(std::memory_order_acquire) == 0; });
+    }
+    dispatcher.stop();
+    state.SetItemsProcessed(state.iterations() * kBurst);
+}
+BENCHMARK(BM_Dispatcher_Throughput)
+    ->ArgNames({"stealing", "threads"})
+    ->ArgsProduct({{0, 1}, {1, 4, 8}})
+    ->UseRealTime();
+
+// from dispatch() to the task starting on a worker, one task in flight
+void BM_Dispatcher_Latency(benchmark::State& state) {
+    EventDispatcher dispatcher(modeOf(state), 4);
+    dispatcher.start();
+    std::atomic<std::int64_t> startedNs{0};
+    std::chrono::steady_clock::time_point posted;
+    for (auto _ : state) {
+        startedNs.store(0, std::memory_order_relaxed);
+        posted = std::chrono::steady_clock::now();
+        dispatcher.dispatch([&] {
+            const auto ns = (std::chrono::steady_clock::now() - posted).count();
+            startedNs.store(ns > 0 ? ns : 1, std::memory_order_release); // 0 is "not yet"
+            startedNs.notify_one();
+        });
+        startedNs.wait(0, std::memory_order_acquire);
+        state.SetIterationTime(static_cast<double>(startedNs.load(std::memory_order_acquire)) / 1e9);
+    }
+    dispatcher.stop();
+}
+BENCHMARK(BM_Dispatcher_Latency)->ArgName("stealing")->Arg(0)->Arg(1)->UseManualTime();
+
+} // namespace
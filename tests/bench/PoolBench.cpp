@@ -0,0 +1,72 @@
+// VirtualMachinePool::allocate under contention: the pool mutex, the port bitmap and, with a DB,
+// the RocksDB group commit every deploy waits on
+#include "BenchFixtures.hpp"
+#include "Virtualization/vm/VirtualMachinePool.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace {
+
+// one pool per run, shared by the benchmark threads; ports are given back as they are used
+struct SharedPool {
+    std::unique_ptr<fixtures::ScratchDb> scratch;
+    std::unique_ptr<VirtualMachinePool> pool;
+};
+
+SharedPool& sharedPool() {
+    static SharedPool instance;
+    return instance;
+}
+
+void allocate(benchmark::State& state, bool persisted) {
+    auto& shared = sharedPool();
+    if (state.thread_index() == 0) {
+        shared.scratch = persisted ? std::make_unique<fixtures::ScratchDb>() : nullptr;
+        auto connector = persisted ? std::make_shared<HypervisorConnector>(shared.scratch->db()) : nullptr;
+        // the whole range, so the threads never run the bitmap dry
+        shared.pool = std::make_unique<VirtualMachinePool>(connector, 5900, 65000);
+    }
+    const std::string name = "bench-" + std::to_string(state.thread_index());
+    for (auto _ : state) {
+        auto id = shared.pool->allocate(name);
+        if (id.isErr()) {
+            state.SkipWithError(id.unwrapErr().c_str());
+            break;
+        }
+        (void)shared.pool->remove(id.unwrap());
+    }
+    if (state.thread_index() == 0) {
+        shared.pool.reset();
+        shared.scratch.reset();
+    }
+}
+
+void BM_Pool_Allocate(benchmark::State& state) { allocate(state, false); }
+BENCHMARK(BM_Pool_Allocate)->ThreadRange(1, 16)->UseRealTime();
+
+void BM_Pool_AllocatePersisted(benchmark::State& state) { allocate(state, true); }
+BENCHMARK(BM_Pool_AllocatePersisted)->ThreadRange(1, 16)->UseRealTime();
+
+// one commit for a whole lab, against one commit per VM above
+void BM_Pool_AllocateBatch(benchmark::State& state) {
+    fixtures::ScratchDb scratch;
+    VirtualMachinePool pool(std::make_shared<HypervisorConnector>(scratch.db()), 5900, 65000);
+    std::vector<std::string> names;
+    for (std::int64_t i = 0; i < state.range(0); ++i) names.push_back("lab-vm-" + std::to_string(i));
+    for (auto _ : state) {
+        auto ids = pool.allocateBatch(names);
+        if (ids.isErr()) {
+            state.SkipWithError(ids.unwrapErr().c_str());
+            break;
+        }
+        state.PauseTiming();
+        for (int id : ids.unwrap()) (void)pool.remove(id);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Pool_AllocateBatch)->Arg(10)->Arg(50);
+
+} // namespace
@@ -0,0 +1,54 @@
+// lab templates: parse of a designer document and the inheritance merge
+#include "Template/Template.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+
+namespace {
+
+// a lab of `vms` machines as the designer saves it
+std::string labDocument(int vms) {
+    std::string json = R"({"name":"web-exploitation","owner":"instructor","vms":[)";
+    for (int i = 0; i < vms; ++i) {
+        if (i) json += ',';
+        json += R"({"name":"vm-)" + std::to_string(i) +
+                R"(","memory":2048,"vcpus":2,"image":"kali-2024.2","password":"changeme",)"
+                R"("nics":[{"network":"dmz","model":"virtio"},{"network":"mgmt","model":"virtio"}],)"
+                R"("ready":{"port":22,"timeout":120}})";
+    }
+    json += R"(],"networks":[{"name":"dmz","cidr":"10.10.1.0/24"},{"name":"mgmt","cidr":"10.10.2.0/24"}]})";
+    return json;
+}
+
+void BM_Template_Parse(benchmark::State& state) {
+    const std::string json = labDocument(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        Template t;
+        if (auto parsed = t.parse(json); !parsed) state.SkipWithError(parsed.error().c_str());
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * json.size()));
+}
+BENCHMARK(BM_Template_Parse)->Arg(1)->Arg(10)->Arg(50);
+
+// a course template overriding part of a base lab (what inheritance does per deploy)
+void BM_Template_Merge(benchmark::State& state) {
+    Template base;
+    (void)base.parse(labDocument(static_cast<int>(state.range(0))));
+    Template overrides;
+    (void)overrides.parse(R"({"owner":"course-42","networks":null,"ready":{"timeout":300}})");
+    for (auto _ : state) {
+        Template merged = base;
+        merged.merge(overrides);
+        benchmark::DoNotOptimize(merged);
+    }
+}
+BENCHMARK(BM_Template_Merge)->Arg(1)->Arg(10)->Arg(50);
+
+void BM_Template_Get(benchmark::State& state) {
+    Template t;
+    (void)t.parse(labDocument(10));
+    for (auto _ : state) benchmark::DoNotOptimize(t.get("vms.7.nics.1.network"));
+}
+BENCHMARK(BM_Template_Get);
+
+} // namespace
@@ -0,0 +1,80 @@
+// domain XML on the deploy path: the pugixml builder, the factory cold and from a compiled template,
+// and the attribute serializers behind the designer's templates
+#include "BenchFixtures.hpp"
+#include "Core/interfaces/IAttribute.hpp"
+#include "Virtualization/builder/VirtualMachineBuilder.hpp"
+#include "Virtualization/vmm/VirtualMachineFactory.hpp"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+void BM_VirtualMachineBuilder_Build(benchmark::State& state) {
+    VirtualMachineBuilder builder;
+    for (auto _ : state) {
+        builder.reset();
+        builder.setName("lab-kali-01")
+            .setMemoryMiB(2048)
+            .setCpuCount(2)
+            .setDisk("/var/lib/libvirt/images/lab-kali-01.qcow2")
+            .setConsolePort(5901);
+        benchmark::DoNotOptimize(builder.build());
+    }
+}
+BENCHMARK(BM_VirtualMachineBuilder_Build);
+
+void BM_Factory_BuildDomainXML(benchmark::State& state) {
+    VirtualMachineFactory factory(nullptr);
+    auto cfg = bench::labVm("lab-kali-01", static_cast<unsigned int>(state.range(0)));
+    cfg.metadata.erase("template");
+    for (auto _ : state) {
+        auto xml = factory.buildDomainXML(cfg);
+        if (xml.isErr()) state.SkipWithError(xml.unwrapErr().c_str());
+        benchmark::DoNotOptimize(xml);
+    }
+}
+BENCHMARK(BM_Factory_BuildDomainXML)->Arg(1)->Arg(4);
+
+// what a deploy pays once the template is compiled: only the per-instance slots are rendered
+void BM_Factory_BuildDomainXMLFromTemplate(benchmark::State& state) {
+    VirtualMachineFactory factory(nullptr);
+    auto cfg = bench::labVm("lab-kali-01", static_cast<unsigned int>(state.range(0)));
+    for (auto _ : state) {
+        auto xml = factory.buildDomainXML(cfg, "bench-lab-vm");
+        if (xml.isErr()) state.SkipWithError(xml.unwrapErr().c_str());
+        benchmark::DoNotOptimize(xml);
+    }
+}
+BENCHMARK(BM_Factory_BuildDomainXMLFromTemplate)->Arg(1)->Arg(4);
+
+VectorAttribute nicAttribute() {
+    VectorAttribute nic("NIC");
+    nic.add("NETWORK", "lab-net-1");
+    nic.add("MODEL", "virtio");
+    nic.add("MAC", "52:54:00:12:34:56");
+    nic.add("IP", "10.10.1.15");
+    nic.add("BRIDGE", "phbr-1a2b3c");
+    nic.add("FILTER", "clean-traffic");
+    nic.add("QUEUES", "2");
+    nic.add("DESCRIPTION", "attacker <-> dmz & \"web\"");
+    return nic;
+}
+
+void BM_VectorAttribute_ToXml(benchmark::State& state) {
+    const auto nic = nicAttribute();
+    for (auto _ : state) benchmark::DoNotOptimize(nic.to_xml());
+}
+BENCHMARK(BM_VectorAttribute_ToXml);
+
+void BM_VectorAttribute_ToJson(benchmark::State& state) {
+    const auto nic = nicAttribute();
+    for (auto _ : state) benchmark::DoNotOptimize(nic.to_json());
+}
+BENCHMARK(BM_VectorAttribute_ToJson);
+
+void BM_SingleAttribute_ToXml(benchmark::State& state) {
+    const SingleAttribute memory("MEMORY", "2048");
+    for (auto _ : state) benchmark::DoNotOptimize(memory.to_xml());
+}
+BENCHMARK(BM_SingleAttribute_ToXml);
+
+} // namespace
@@ -0,0 +1,44 @@
+#pragma once
+#include "Database/RocksDatabase.hpp"
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+// shared by tests/unit and tests/bench (penhive_test_support in tests/CMakeLists.txt)
+namespace fixtures {
+
+// RocksDB in a fresh directory under the temp dir, removed with the object;
+// a second store on db() sees what the first one wrote, as after a restart
+class ScratchDb {
+public:
+    ScratchDb() {
+        static std::atomic<unsigned int> seq{0};
+        dir_ = std::filesystem::temp_directory_path() /
+               ("penhive-scratch-" + std::to_string(::getpid()) + "-" + std::to_string(seq++));
+        auto db = std::make_shared<RocksDatabase>();
+        rocksdb::Options options;
+        options.create_if_missing = true;
+        if (auto opened = db->Open(options, dir_.string()); !opened)
+            throw std::runtime_error("cannot open " + dir_.string() + ": " + opened.error().ToString());
+        db_ = std::move(db);
+    }
+    ~ScratchDb() {
+        (void)db_->Close();
+        std::error_code ec;
+        std::filesystem::remove_all(dir_, ec);
+    }
+
+    ScratchDb(const ScratchDb&) = delete;
+    ScratchDb& operator=(const ScratchDb&) = delete;
+
+    [[nodiscard]] const std::shared_ptr<IRocksDB>& db() const noexcept { return db_; }
+
+private:
+    std::filesystem::path dir_;
+    std::shared_ptr<IRocksDB> db_;
+};
+
+} // namespace fixtures
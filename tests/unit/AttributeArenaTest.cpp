@@ -0,0 +1,39 @@
+// AttributeArena / VectorAttribute: values in the arena across moves and copies
+#include "Core/interfaces/IAttribute.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+namespace {
+
+TEST(AttributeArena, MovedFromArenaStoresAgain) {
+    AttributeArena arena;
+    const auto kept = arena.store("virtio");
+    AttributeArena moved(std::move(arena));
+    // the block went with the move, so views into it stay valid
+    EXPECT_EQ(kept, "virtio");
+    EXPECT_EQ(moved.store("sata"), "sata");
+
+    EXPECT_EQ(arena.store("scsi"), "scsi");
+    AttributeArena assigned;
+    assigned = std::move(arena);
+    EXPECT_EQ(arena.store(std::string(1000, 'x')).size(), 1000u);
+}
+
+TEST(VectorAttribute, AddAfterMoveStartsFresh) {
+    VectorAttribute disk("target");
+    disk.add("dev", "vda");
+    disk.add("bus", "virtio");
+    VectorAttribute moved(std::move(disk));
+    EXPECT_EQ(moved.find("bus")->second, "virtio");
+
+    disk.add("dev", "sda");
+    EXPECT_EQ(disk.find("dev")->second, "sda");
+    EXPECT_EQ(moved.find("dev")->second, "vda");
+
+    VectorAttribute copy(moved);
+    moved = std::move(disk);
+    EXPECT_EQ(moved.find("dev")->second, "sda");
+    EXPECT_EQ(copy.find("bus")->second, "virtio");
+}
+
+} // namespace
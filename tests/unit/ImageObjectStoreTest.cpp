@@ -0,0 +1,107 @@
+// ImageObjectStore: content-addressed base images, names and clones as references
+#include "ScratchDb.hpp"
+#include "Virtualization/Storage/ImageObjectStore.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+
+ImageObject object(std::string digest, std::string volume) {
+    ImageObject o;
+    o.digest = std::move(digest);
+    o.volumeName = std::move(volume);
+    o.sizeBytes = 1 << 20;
+    return o;
+}
+
+TEST(ImageObjectStore, SameBytesUnderAnotherNameAreADuplicate) {
+    ImageObjectStore store;
+    auto first = store.commit(object("sha256:aa", "kali-upload-1.qcow2"), "kali");
+    ASSERT_FALSE(first.isErr()) << first.unwrapErr();
+    EXPECT_FALSE(first.unwrap().duplicate);
+    EXPECT_EQ(first.unwrap().object.names, 1u);
+
+    auto second = store.commit(object("sha256:aa", "kali-upload-2.qcow2"), "kali-2024");
+    ASSERT_FALSE(second.isErr()) << second.unwrapErr();
+    // the caller deletes the new volume; both names resolve to the first one
+    EXPECT_TRUE(second.unwrap().duplicate);
+    EXPECT_EQ(second.unwrap().object.volumeName, "kali-upload-1.qcow2");
+    EXPECT_EQ(second.unwrap().object.names, 2u);
+    EXPECT_EQ(store.resolve("kali-2024")->volumeName, "kali-upload-1.qcow2");
+    EXPECT_EQ(store.resolve("sha256:aa")->refs(), 2u);
+    EXPECT_EQ(store.list().size(), 1u);
+
+    EXPECT_TRUE(store.commit(object("", "x.qcow2"), "x").isErr());
+}
+
+TEST(ImageObjectStore, ObjectIsOrphanedOnlyWithoutNamesAndClones) {
+    ImageObjectStore store;
+    ASSERT_FALSE(store.commit(object("sha256:aa", "base.qcow2"), "ubuntu").isErr());
+    ASSERT_FALSE(store.commit(object("sha256:aa", "copy.qcow2"), "ubuntu-lts").isErr());
+    ASSERT_FALSE(store.retainClone("sha256:aa", "lab1-vm1.qcow2").isErr());
+    EXPECT_TRUE(store.retainClone("sha256:ff", "lab1-vm2.qcow2").isErr());
+
+    auto released = store.releaseName("ubuntu");
+    ASSERT_FALSE(released.isErr());
+    EXPECT_FALSE(released.unwrap());
+    released = store.releaseName("ubuntu-lts");
+    ASSERT_FALSE(released.isErr());
+    // the clone still backs onto it
+    EXPECT_FALSE(released.unwrap());
+    EXPECT_EQ(store.find("sha256:aa")->clones, 1u);
+
+    auto unused = store.releaseClone("lab1-vm1.qcow2");
+    ASSERT_FALSE(unused.isErr());
+    ASSERT_TRUE(unused.unwrap());
+    EXPECT_EQ(unused.unwrap()->volumeName, "base.qcow2");
+    EXPECT_FALSE(store.find("sha256:aa"));
+
+    // unknown names and clones are no-ops
+    EXPECT_FALSE(store.releaseName("ubuntu").unwrap());
+    EXPECT_FALSE(store.releaseClone("lab1-vm1.qcow2").unwrap());
+}
+
+TEST(ImageObjectStore, RenamingToNewContentOrphansTheOldObject) {
+    ImageObjectStore store;
+    ASSERT_FALSE(store.commit(object("sha256:aa", "v1.qcow2"), "metasploitable").isErr());
+    auto moved = store.commit(object("sha256:bb", "v2.qcow2"), "metasploitable");
+    ASSERT_FALSE(moved.isErr()) << moved.unwrapErr();
+    ASSERT_TRUE(moved.unwrap().orphaned);
+    EXPECT_EQ(moved.unwrap().orphaned->volumeName, "v1.qcow2");
+    EXPECT_FALSE(moved.unwrap().duplicate);
+    EXPECT_EQ(store.resolve("metasploitable")->digest, "sha256:bb");
+    EXPECT_FALSE(store.find("sha256:aa"));
+
+    // a clone keeps the old content alive across a rename
+    ASSERT_FALSE(store.retainClone("sha256:bb", "lab-vm.qcow2").isErr());
+    moved = store.commit(object("sha256:cc", "v3.qcow2"), "metasploitable");
+    ASSERT_FALSE(moved.isErr());
+    EXPECT_FALSE(moved.unwrap().orphaned);
+    EXPECT_EQ(store.find("sha256:bb")->refs(), 1u);
+}
+
+TEST(ImageObjectStore, LoadRebuildsTheCounts) {
+    fixtures::ScratchDb scratch;
+    {
+        ImageObjectStore store(scratch.db());
+        ASSERT_FALSE(store.commit(object("sha256:aa", "a.qcow2"), "alpine").isErr());
+        ASSERT_FALSE(store.commit(object("sha256:aa", "a2.qcow2"), "alpine-edge").isErr());
+        ASSERT_FALSE(store.commit(object("sha256:bb", "b.qcow2"), "debian").isErr());
+        ASSERT_FALSE(store.retainClone("sha256:aa", "lab1-vm1.qcow2").isErr());
+        ASSERT_FALSE(store.retainClone("sha256:aa", "lab1-vm2.qcow2").isErr());
+        ASSERT_TRUE(store.releaseName("debian").unwrap());
+    }
+
+    ImageObjectStore restarted(scratch.db());
+    EXPECT_EQ(restarted.load(), 1u);
+    auto alpine = restarted.find("sha256:aa");
+    ASSERT_TRUE(alpine);
+    EXPECT_EQ(alpine->volumeName, "a.qcow2");
+    EXPECT_EQ(alpine->sizeBytes, 1u << 20);
+    EXPECT_EQ(alpine->names, 2u);
+    EXPECT_EQ(alpine->clones, 2u);
+    EXPECT_FALSE(restarted.resolve("debian"));
+    EXPECT_EQ(restarted.findByVolume("a.qcow2")->digest, "sha256:aa");
+    EXPECT_EQ(restarted.aliases().size(), 2u);
+}
+
+} // namespace
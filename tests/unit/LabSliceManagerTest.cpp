@@ -0,0 +1,61 @@
+// LabSliceManager: partitionFor() over a fake cgroupfs (plain files in a temp dir)
+#include "resources/allocation/LabSliceManager.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// cgroupfs only opens existing files: a group "exists" once its control files do
+void fakeGroup(const fs::path& dir) {
+    fs::create_directories(dir);
+    for (const char* file : {"cgroup.subtree_control", "cpu.max", "cpu.weight", "memory.high", "memory.max", "pids.max"})
+        std::ofstream(dir / file);
+}
+
+class LabSlices : public ::testing::Test {
+protected:
+    void SetUp() override {
+        fakeGroup(root / "penhive.slice");
+        slices = std::make_unique<LabSliceManager>(root.string());
+    }
+    void TearDown() override {
+        slices.reset();
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+
+    fs::path root{fs::temp_directory_path() / ("penhive-unit-cgroup-" + std::to_string(::getpid()))};
+    std::unique_ptr<LabSliceManager> slices;
+};
+
+TEST_F(LabSlices, InvalidLabIdIsAnError) {
+    for (const std::string lab : {"", "..", "a/b", "lab 1"}) {
+        auto res = slices->partitionFor(lab);
+        ASSERT_TRUE(res.isErr()) << lab;
+        EXPECT_NE(res.unwrapErr().find("Invalid lab id"), std::string::npos);
+        EXPECT_TRUE(slices->setLimits(lab, SliceLimits{}).isErr()) << lab;
+    }
+    EXPECT_TRUE(slices->labs().empty());
+}
+
+TEST_F(LabSlices, CgroupFailureIsAnError) {
+    // the lab group is created but has no control files to write the limits to
+    auto res = slices->partitionFor("lab1");
+    ASSERT_TRUE(res.isErr());
+    EXPECT_EQ(res.unwrapErr().rfind("cgroup: ", 0), 0u);
+    EXPECT_TRUE(slices->labs().empty());
+}
+
+TEST_F(LabSlices, PartitionIsRelativeToTheCgroupRoot) {
+    fakeGroup(root / "penhive.slice" / "lab-lab1.partition");
+    auto res = slices->partitionFor("lab1");
+    ASSERT_FALSE(res.isErr()) << res.unwrapErr();
+    EXPECT_EQ(res.unwrap(), "/penhive.slice/lab-lab1.partition");
+    EXPECT_EQ(slices->labs(), std::vector<std::string>{"lab1"});
+}
+
+} // namespace
@@ -0,0 +1,96 @@
+// SegmentAllocator: cluster-wide VLAN/VNI ids, held per host and persisted
+#include "ScratchDb.hpp"
+#include "Virtualization/vmm/SegmentAllocator.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr const char* kHostA = "qemu+ssh://a/system";
+constexpr const char* kHostB = "qemu+ssh://b/system";
+
+TEST(SegmentAllocator, StartsAtTheHintAndKeepsTheIdPerNetwork) {
+    SegmentAllocator segments;
+    auto id = segments.acquire(SegmentKind::Vni, "ph-lab1-sw1", kHostA, 100, 199, 42);
+    ASSERT_FALSE(id.isErr()) << id.unwrapErr();
+    EXPECT_EQ(id.unwrap(), 142u);
+
+    // the same network again, from the same host or another one, is the same segment
+    EXPECT_EQ(segments.acquire(SegmentKind::Vni, "ph-lab1-sw1", kHostA, 100, 199, 7).unwrap(), 142u);
+    EXPECT_EQ(segments.acquire(SegmentKind::Vni, "ph-lab1-sw1", kHostB, 100, 199, 7).unwrap(), 142u);
+    EXPECT_EQ(segments.find(SegmentKind::Vni, "ph-lab1-sw1"), 142u);
+    EXPECT_EQ(segments.owner(SegmentKind::Vni, 142), "ph-lab1-sw1");
+    EXPECT_EQ(segments.size(SegmentKind::Vni), 1u);
+    // VLAN tags are a separate table
+    EXPECT_EQ(segments.size(SegmentKind::Vlan), 0u);
+}
+
+TEST(SegmentAllocator, ProbesPastTakenIdsAndWrapsAround) {
+    SegmentAllocator segments;
+    // both names hash to the last id of the range
+    EXPECT_EQ(segments.acquire(SegmentKind::Vlan, "ph-lab1-a", kHostA, 10, 12, 2).unwrap(), 12u);
+    EXPECT_EQ(segments.acquire(SegmentKind::Vlan, "ph-lab1-b", kHostA, 10, 12, 2).unwrap(), 10u);
+    EXPECT_EQ(segments.acquire(SegmentKind::Vlan, "ph-lab1-c", kHostA, 10, 12, 2).unwrap(), 11u);
+    EXPECT_TRUE(segments.acquire(SegmentKind::Vlan, "ph-lab1-d", kHostA, 10, 12, 2).isErr());
+    EXPECT_TRUE(segments.acquire(SegmentKind::Vlan, "ph-lab1-e", kHostA, 12, 10, 0).isErr());
+}
+
+TEST(SegmentAllocator, IdIsFreedByTheLastHolderOnly) {
+    SegmentAllocator segments;
+    ASSERT_EQ(segments.acquire(SegmentKind::Vni, "ph-lab1-sw1", kHostA, 1, 1, 0).unwrap(), 1u);
+    ASSERT_EQ(segments.acquire(SegmentKind::Vni, "ph-lab1-sw1", kHostB, 1, 1, 0).unwrap(), 1u);
+
+    ASSERT_FALSE(segments.release(SegmentKind::Vni, "ph-lab1-sw1", kHostA).isErr());
+    // host B still carries traffic on it: nobody else may get the id
+    EXPECT_EQ(segments.find(SegmentKind::Vni, "ph-lab1-sw1"), 1u);
+    EXPECT_TRUE(segments.acquire(SegmentKind::Vni, "ph-lab2-sw1", kHostA, 1, 1, 0).isErr());
+
+    // releasing twice, or for a host that never held it, changes nothing
+    ASSERT_FALSE(segments.release(SegmentKind::Vni, "ph-lab1-sw1", kHostA).isErr());
+    EXPECT_EQ(segments.find(SegmentKind::Vni, "ph-lab1-sw1"), 1u);
+
+    ASSERT_FALSE(segments.release(SegmentKind::Vni, "ph-lab1-sw1", kHostB).isErr());
+    EXPECT_FALSE(segments.find(SegmentKind::Vni, "ph-lab1-sw1"));
+    EXPECT_FALSE(segments.owner(SegmentKind::Vni, 1));
+    EXPECT_EQ(segments.acquire(SegmentKind::Vni, "ph-lab2-sw1", kHostA, 1, 1, 0).unwrap(), 1u);
+}
+
+TEST(SegmentAllocator, AdoptRefusesAnIdOfAnotherSegment) {
+    SegmentAllocator segments;
+    EXPECT_TRUE(segments.adopt(SegmentKind::Vlan, "ph-lab1-sw1", kHostA, 300));
+    EXPECT_TRUE(segments.adopt(SegmentKind::Vlan, "ph-lab1-sw1", kHostB, 300));
+    // defined in libvirt with a tag another segment holds, or a second tag for the same one
+    EXPECT_FALSE(segments.adopt(SegmentKind::Vlan, "ph-lab2-sw1", kHostA, 300));
+    EXPECT_FALSE(segments.adopt(SegmentKind::Vlan, "ph-lab1-sw1", kHostA, 301));
+    EXPECT_FALSE(segments.adopt(SegmentKind::Vlan, "ph-lab3-sw1", kHostA, 0));
+    EXPECT_EQ(segments.acquire(SegmentKind::Vlan, "ph-lab2-sw1", kHostA, 300, 301, 0).unwrap(), 301u);
+}
+
+TEST(SegmentAllocator, LoadRestoresIdsAndHolders) {
+    fixtures::ScratchDb scratch;
+    {
+        SegmentAllocator segments(scratch.db());
+        ASSERT_EQ(segments.acquire(SegmentKind::Vni, "ph-lab1-sw1", kHostA, 5000, 5999, 17).unwrap(), 5017u);
+        ASSERT_EQ(segments.acquire(SegmentKind::Vni, "ph-lab1-sw1", kHostB, 5000, 5999, 17).unwrap(), 5017u);
+        ASSERT_EQ(segments.acquire(SegmentKind::Vlan, "ph-lab1-sw1", kHostA, 2, 4094, 8).unwrap(), 10u);
+        ASSERT_EQ(segments.acquire(SegmentKind::Vni, "ph-lab2-sw1", kHostA, 5000, 5999, 18).unwrap(), 5018u);
+        ASSERT_FALSE(segments.release(SegmentKind::Vni, "ph-lab2-sw1", kHostA).isErr());
+    }
+
+    SegmentAllocator restarted(scratch.db());
+    EXPECT_EQ(restarted.load(), 2u);
+    EXPECT_EQ(restarted.find(SegmentKind::Vni, "ph-lab1-sw1"), 5017u);
+    EXPECT_EQ(restarted.find(SegmentKind::Vlan, "ph-lab1-sw1"), 10u);
+    EXPECT_FALSE(restarted.find(SegmentKind::Vni, "ph-lab2-sw1"));
+
+    // both holders came back: one release keeps the id taken
+    ASSERT_FALSE(restarted.release(SegmentKind::Vni, "ph-lab1-sw1", kHostB).isErr());
+    EXPECT_EQ(restarted.acquire(SegmentKind::Vni, "ph-lab3-sw1", kHostA, 5000, 5999, 17).unwrap(), 5018u);
+    ASSERT_FALSE(restarted.release(SegmentKind::Vni, "ph-lab1-sw1", kHostA).isErr());
+
+    SegmentAllocator again(scratch.db());
+    EXPECT_EQ(again.load(), 2u);
+    EXPECT_FALSE(again.find(SegmentKind::Vni, "ph-lab1-sw1"));
+    EXPECT_EQ(again.find(SegmentKind::Vni, "ph-lab3-sw1"), 5018u);
+}
+
+} // namespace
@@ -0,0 +1,215 @@
+// TopologyStore: designer graphs per lab, delta batches with undo, wiring() for the applier
+#include "ScratchDb.hpp"
+#include "Virtualization/vmm/TopologyStore.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+
+namespace {
+
+using Op = TopologyDelta::Op;
+
+// pc1 and pc2 on a two-switch segment, pc1 cabled straight to srv1, rtr1 not deployed yet
+LabTopology campus() {
+    LabTopology t;
+    t.lab = "lab1";
+    t.devices = {
+        {"sw2", "switch", "", ""},
+        {"sw1", "switch", "", ""},
+        {"pc1", "pc", "lab1-pc1", "vhost"},
+        {"pc2", "pc", "lab1-pc2", ""},
+        {"srv1", "server", "lab1-srv1", ""},
+        {"rtr1", "router", "", ""},
+    };
+    t.links = {
+        {"l1", "sw2", "sw1"},
+        {"l2", "pc1", "sw2"},
+        {"l3", "pc2", "sw1"},
+        {"l4", "pc1", "srv1"},
+        {"", "rtr1", "srv1"},
+    };
+    return t;
+}
+
+TopologyDelta add(std::string id, std::string type, std::string domain = {}) {
+    TopologyDelta d;
+    d.op = Op::AddDevice;
+    d.id = std::move(id);
+    d.type = std::move(type);
+    d.domain = std::move(domain);
+    return d;
+}
+
+TopologyDelta link(std::string id, std::string from, std::string to) {
+    TopologyDelta d;
+    d.op = Op::AddLink;
+    d.id = std::move(id);
+    d.from = std::move(from);
+    d.to = std::move(to);
+    return d;
+}
+
+TopologyDelta remove(Op op, std::string id) {
+    TopologyDelta d;
+    d.op = op;
+    d.id = std::move(id);
+    return d;
+}
+
+// devices and links by id, so two graphs compare regardless of slot order
+void expectSameDesign(const LabTopology& a, const LabTopology& b) {
+    auto devices = [](const LabTopology& t) {
+        std::vector<std::string> out;
+        for (const auto& d : t.devices) out.push_back(d.id + "/" + d.type + "/" + d.domain + "/" + d.netProfile);
+        std::sort(out.begin(), out.end());
+        return out;
+    };
+    auto links = [](const LabTopology& t) {
+        std::vector<std::string> out;
+        for (const auto& l : t.links) out.push_back(l.id + "/" + l.from + "/" + l.to);
+        std::sort(out.begin(), out.end());
+        return out;
+    };
+    EXPECT_EQ(devices(a), devices(b));
+    EXPECT_EQ(links(a), links(b));
+}
+
+TEST(TopologyStore, ReplaceStoresTheDesignAndNamesCables) {
+    TopologyStore store;
+    auto rev = store.replace(campus());
+    ASSERT_FALSE(rev.isErr()) << rev.unwrapErr();
+    EXPECT_EQ(rev.unwrap().version, 1u);
+    EXPECT_EQ(rev.unwrap().devices, 6u);
+    EXPECT_EQ(rev.unwrap().links, 5u);
+
+    auto stored = store.topology("lab1");
+    ASSERT_TRUE(stored);
+    auto expected = campus();
+    expected.links.back().id = "link-1";
+    expectSameDesign(*stored, expected);
+
+    EXPECT_EQ(store.replace(campus()).unwrap().version, 2u);
+    EXPECT_FALSE(store.topology("lab2"));
+
+    auto broken = campus();
+    broken.links.push_back({"l9", "pc1", "nowhere"});
+    EXPECT_TRUE(store.replace(broken).isErr());
+    EXPECT_EQ(store.version("lab1"), 2u);
+}
+
+TEST(TopologyStore, StaleBaseVersionIsAConflict) {
+    TopologyStore store;
+    ASSERT_FALSE(store.replace(campus()).isErr());
+    auto res = store.update("lab1", 0, {add("pc3", "pc")});
+    ASSERT_TRUE(res.isErr());
+    EXPECT_TRUE(res.unwrapErr().conflict);
+    EXPECT_EQ(res.unwrapErr().version, 1u);
+
+    // the first batch of a new lab starts from version 0
+    auto created = store.update("lab2", 0, {add("pc1", "pc"), add("sw1", "switch"), link("l1", "pc1", "sw1")});
+    ASSERT_FALSE(created.isErr()) << created.unwrapErr().message;
+    EXPECT_EQ(created.unwrap().version, 1u);
+    EXPECT_EQ(created.unwrap().links, 1u);
+}
+
+TEST(TopologyStore, FailedBatchLeavesGraphAndDatabaseUntouched) {
+    fixtures::ScratchDb scratch;
+    TopologyStore store(scratch.db());
+    ASSERT_FALSE(store.replace(campus()).isErr());
+    const auto before = *store.topology("lab1");
+
+    TopologyDelta retype;
+    retype.op = Op::UpdateDevice;
+    retype.id = "pc2";
+    retype.type = "firewall";
+    retype.domain = "lab1-fw1";
+    const std::vector<TopologyDelta> batch{
+        remove(Op::RemoveDevice, "sw1"), // drops l1 and l3 with it
+        remove(Op::RemoveLink, "l4"),
+        retype,
+        add("pc3", "workstation", "lab1-pc3"), // a label the graph did not have
+        link("l5", "pc3", "sw2"),
+        link("l6", "pc3", "ghost"), // fails: everything above is undone
+    };
+    auto res = store.update("lab1", 1, batch);
+    ASSERT_TRUE(res.isErr());
+    EXPECT_FALSE(res.unwrapErr().conflict);
+    EXPECT_NE(res.unwrapErr().message.find("op 5"), std::string::npos);
+
+    EXPECT_EQ(store.version("lab1"), 1u);
+    expectSameDesign(*store.topology("lab1"), before);
+    // nothing of the batch reached RocksDB either
+    TopologyStore restarted(scratch.db());
+    EXPECT_EQ(restarted.version("lab1"), 1u);
+    expectSameDesign(*restarted.topology("lab1"), before);
+
+    // and the graph is still consistent: the same batch without the bad cable applies
+    auto applied = store.update("lab1", 1, std::vector<TopologyDelta>(batch.begin(), batch.end() - 1));
+    ASSERT_FALSE(applied.isErr()) << applied.unwrapErr().message;
+    EXPECT_EQ(applied.unwrap().version, 2u);
+    EXPECT_EQ(applied.unwrap().removedLinks, 2u);
+    EXPECT_EQ(applied.unwrap().devices, 6u);
+    EXPECT_EQ(applied.unwrap().links, 3u); // l2, link-1, l5
+
+    TopologyStore reloaded(scratch.db());
+    expectSameDesign(*reloaded.topology("lab1"), *store.topology("lab1"));
+}
+
+TEST(TopologyStore, WiringMatchesTheApplierAndFollowsDeltas) {
+    TopologyStore store;
+    ASSERT_FALSE(store.replace(campus()).isErr());
+    auto wiring = store.wiring("lab1");
+    ASSERT_TRUE(wiring);
+
+    // both switches make one segment, named after the smaller id
+    const auto segment = TopologyApplier::segmentNetwork("lab1", "sw1");
+    const auto p2p = TopologyApplier::p2pNetwork("lab1", "pc1", "srv1");
+    EXPECT_EQ(wiring->networks.at("lab1-pc1"), (std::vector<std::string>{std::min(segment, p2p), std::max(segment, p2p)}));
+    EXPECT_EQ(wiring->networks.at("lab1-pc2"), std::vector<std::string>{segment});
+    // rtr1 has no domain, so its cable to srv1 carries nothing
+    EXPECT_EQ(wiring->networks.at("lab1-srv1"), std::vector<std::string>{p2p});
+    EXPECT_EQ(wiring->profiles.at("lab1-pc1"), "vhost");
+    EXPECT_FALSE(wiring->profiles.contains("lab1-pc2"));
+    EXPECT_EQ(wiring->domains, (std::set<std::string>{"lab1-pc1", "lab1-pc2", "lab1-srv1"}));
+
+    auto desired = TopologyApplier::desiredWiring(*store.topology("lab1"));
+    ASSERT_FALSE(desired.isErr()) << desired.unwrapErr();
+    for (const auto& [domain, nets] : desired.unwrap()) EXPECT_EQ(wiring->networks.at(domain), nets) << domain;
+
+    // cutting the inter-switch cable splits the segment in two
+    ASSERT_FALSE(store.update("lab1", 1, {remove(Op::RemoveLink, "l1")}).isErr());
+    wiring = store.wiring("lab1");
+    EXPECT_EQ(wiring->networks.at("lab1-pc2"), std::vector<std::string>{segment});
+    const auto split = TopologyApplier::segmentNetwork("lab1", "sw2");
+    EXPECT_EQ(wiring->networks.at("lab1-pc1"), (std::vector<std::string>{std::min(split, p2p), std::max(split, p2p)}));
+
+    // a deployed VM without cables is still listed, so its stale lab NICs go
+    ASSERT_FALSE(store.update("lab1", 2, {remove(Op::RemoveDevice, "sw1")}).isErr());
+    wiring = store.wiring("lab1");
+    EXPECT_TRUE(wiring->networks.at("lab1-pc2").empty());
+}
+
+TEST(TopologyStore, EvictedLabsAreReadBack) {
+    fixtures::ScratchDb scratch;
+    TopologyStore store(scratch.db(), 1);
+    ASSERT_FALSE(store.replace(campus()).isErr());
+    auto other = campus();
+    other.lab = "lab2";
+    ASSERT_FALSE(store.replace(other).isErr());
+
+    // lab1 was pushed out by lab2 and comes back from RocksDB, then takes deltas as before
+    auto back = store.topology("lab1");
+    ASSERT_TRUE(back);
+    auto expected = campus();
+    expected.links.back().id = "link-1";
+    expectSameDesign(*back, expected);
+    ASSERT_FALSE(store.update("lab1", 1, {add("pc3", "pc", "lab1-pc3")}).isErr());
+    EXPECT_EQ(store.version("lab2"), 1u);
+    EXPECT_EQ(store.version("lab1"), 2u);
+
+    EXPECT_TRUE(store.erase("lab1").unwrap());
+    EXPECT_FALSE(store.erase("lab1").unwrap());
+    EXPECT_FALSE(store.topology("lab1"));
+    EXPECT_TRUE(store.topology("lab2"));
+}
+
+} // namespace
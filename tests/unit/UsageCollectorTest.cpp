@@ -0,0 +1,131 @@
+// UsageCollector: rollup rows in RocksDB and history() over them; one pass on libvirt's test driver
+#include "ScratchDb.hpp"
+#include "Virtualization/vmm/UsageCollector.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+using std::chrono::seconds;
+using std::chrono::system_clock;
+
+constexpr std::uint64_t kBucket = 1'000'000'200; // a multiple of the default 300 s rollup
+
+system_clock::time_point at(std::uint64_t unixSeconds) {
+    return system_clock::time_point(seconds(unixSeconds));
+}
+
+// the documented row: usage/<vm>/<bucket, 10 digits> -> spanMs cpuUs memKiB memPeakKiB diskRd diskWr netRx netTx vcpus
+void putRow(IRocksDB& db, std::string_view vm, std::uint64_t bucket, std::string_view value) {
+    const std::string digits = std::to_string(bucket);
+    const std::string key = "usage/" + std::string(vm) + "/" + std::string(10 - digits.size(), '0') + digits;
+    ASSERT_TRUE(db.Put(rocksdb::WriteOptions{}, key, value));
+}
+
+class UsageRollups : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto& db = *scratch.db();
+        // five minutes at half of two vCPUs, 3000 KiB read
+        putRow(db, "vm-1", kBucket, "300000 150000000 2048 4096 3000 0 0 0 2");
+        putRow(db, "vm-1", kBucket + 300, "300000 600000000 1024 1024 0 600 300 0 4");
+        putRow(db, "vm-1", kBucket + 600, "150000 0 512 512 0 0 0 150 4");
+        putRow(db, "vm-1", kBucket + 900, "not a rollup");
+        // a VM whose name extends vm-1's must not show up in its history
+        putRow(db, "vm-10", kBucket + 300, "300000 0 1 1 0 0 0 0 1");
+    }
+
+    fixtures::ScratchDb scratch;
+    std::shared_ptr<UsageCollector> collector{std::make_shared<UsageCollector>(nullptr, scratch.db())};
+};
+
+TEST_F(UsageRollups, HistoryBeforeTheRingComesFromRollups) {
+    // `from` inside the first period still gets that period
+    const auto points = collector->history("vm-1", at(kBucket + 100), at(kBucket + 1200));
+    ASSERT_EQ(points.size(), 3u);
+
+    const auto& first = points[0];
+    EXPECT_EQ(first.at, at(kBucket + 300)); // rollups are stamped with the end of their period
+    EXPECT_EQ(first.span, std::chrono::milliseconds(300000));
+    EXPECT_DOUBLE_EQ(first.cpu, 0.5);
+    EXPECT_EQ(first.vcpus, 2u);
+    EXPECT_DOUBLE_EQ(first.cpuShare(), 0.25);
+    EXPECT_EQ(first.memoryKiB, 2048u);
+    EXPECT_EQ(first.memoryPeakKiB, 4096u);
+    EXPECT_DOUBLE_EQ(first.diskReadBps, 3000.0 * 1024 / 300);
+
+    // each period keeps the vCPU count it was measured with
+    EXPECT_EQ(points[1].vcpus, 4u);
+    EXPECT_DOUBLE_EQ(points[1].cpu, 2.0);
+    EXPECT_DOUBLE_EQ(points[1].ioBps(), 900.0 * 1024 / 300);
+    EXPECT_DOUBLE_EQ(points[2].netTxBps, 1024.0);
+    EXPECT_TRUE(std::is_sorted(points.begin(), points.end(),
+                               [](const UsagePoint& a, const UsagePoint& b) { return a.at < b.at; }));
+}
+
+TEST_F(UsageRollups, HistoryHonoursTheRange) {
+    EXPECT_EQ(collector->history("vm-1", at(kBucket), at(kBucket + 300)).size(), 2u);
+    EXPECT_EQ(collector->history("vm-1", at(kBucket + 600), at(kBucket + 600)).size(), 1u);
+    EXPECT_TRUE(collector->history("vm-1", at(kBucket + 300), at(kBucket)).empty());
+    EXPECT_EQ(collector->history("vm-10", at(kBucket), at(kBucket + 900)).size(), 1u);
+    EXPECT_TRUE(collector->history("vm-2", at(kBucket), at(kBucket + 900)).empty());
+    // nothing was sampled in this process
+    EXPECT_FALSE(collector->latest("vm-1"));
+    EXPECT_EQ(collector->tracked(), 0u);
+}
+
+// passes over the test driver's running domain, stamped 1.1 s apart: ring samples, the rows of closed periods and the seam
+TEST(UsageCollector, PassesFillTheRingAndWriteClosedPeriods) {
+    fixtures::ScratchDb scratch;
+    auto connector = std::make_shared<HypervisorConnector>(scratch.db());
+    if (!connector->connect("test:///default")) GTEST_SKIP() << "libvirt test driver not available";
+    UsageOptions options;
+    options.ringSamples = 2;
+    options.rollup = seconds(1);
+    auto collector = std::make_shared<UsageCollector>(connector, scratch.db(), options);
+
+    const auto step = std::chrono::milliseconds(1100);
+    auto first = collector->runOnce(at(kBucket));
+    if (first.isErr()) GTEST_SKIP() << "no domain stats on the test driver: " << first.unwrapErr();
+    ASSERT_GT(first.unwrap(), 0u);
+    // the first pass only primes the counters
+    EXPECT_FALSE(collector->latest("test"));
+
+    // passes in the seconds kBucket + 1 .. kBucket + 4, one period each
+    for (int i = 1; i <= 4; ++i) ASSERT_FALSE(collector->runOnce(at(kBucket) + i * step).isErr());
+    const auto latest = collector->latest("test");
+    ASSERT_TRUE(latest);
+    EXPECT_GT(latest->vcpus, 0u);
+    EXPECT_EQ(latest->at, at(kBucket + 4));
+    EXPECT_EQ(latest->span, step);
+    EXPECT_EQ(collector->tracked(), 1u);
+
+    // every pass after the second closed the period of the one before it
+    std::size_t rows = 0;
+    const std::string prefix = "usage/test/";
+    std::string upper = prefix;
+    upper.back() = static_cast<char>(upper.back() + 1);
+    rocksdb::Slice upperSlice(upper);
+    rocksdb::ReadOptions ro;
+    ro.iterate_upper_bound = &upperSlice;
+    auto it = scratch.db()->NewIterator(ro);
+    ASSERT_TRUE(it);
+    for (it->Seek(prefix); it->Valid(); it->Next()) ++rows;
+    EXPECT_EQ(rows, 3u);
+
+    // the ring keeps the last two samples, the rollups the two periods before: every span once, no gap
+    const auto points = collector->history("test", at(0), at(kBucket + 60));
+    ASSERT_EQ(points.size(), 4u);
+    const std::vector<system_clock::time_point> ends{at(kBucket + 2), at(kBucket + 3), at(kBucket + 3), at(kBucket + 4)};
+    std::chrono::milliseconds covered{0};
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        EXPECT_EQ(points[i].at, ends[i]) << i;
+        EXPECT_EQ(points[i].span, step) << i;
+        covered += points[i].span;
+    }
+    EXPECT_EQ(covered, 4 * step);
+}
+
+} // namespace
@@ -0,0 +1,43 @@
+// VirtualMachinePool: console ports of pool records (autoport, fixed, none)
+#include "Virtualization/vm/VirtualMachinePool.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(VirtualMachinePool, OnlyAutoportConsolesTakeAPort) {
+    VirtualMachinePool pool(nullptr, 5900, 5903);
+    auto none = pool.allocate("headless", VirtualMachinePool::kNoConsolePort);
+    ASSERT_FALSE(none.isErr()) << none.unwrapErr();
+    EXPECT_EQ(pool.getRecord(none.unwrap())->consolePort, -1);
+    EXPECT_EQ(pool.availablePorts(), 4u);
+
+    auto ids = pool.allocateBatch({"vm-a", "vm-b", "vm-c"},
+                                  {VirtualMachinePool::kAutoConsolePort, VirtualMachinePool::kNoConsolePort});
+    ASSERT_FALSE(ids.isErr()) << ids.unwrapErr();
+    // a missing entry is an autoport console too
+    EXPECT_GT(pool.getRecord(ids.unwrap()[0])->consolePort, 0);
+    EXPECT_EQ(pool.getRecord(ids.unwrap()[1])->consolePort, -1);
+    EXPECT_GT(pool.getRecord(ids.unwrap()[2])->consolePort, 0);
+    EXPECT_EQ(pool.availablePorts(), 2u);
+    EXPECT_FALSE(pool.consolePort("vm-b"));
+}
+
+TEST(VirtualMachinePool, FixedPortIsNeverHandedOut) {
+    VirtualMachinePool pool(nullptr, 5900, 5901);
+    ASSERT_TRUE(pool.claimConsolePort(5901));
+    // held by the first VM; one outside the range has nothing to collide with
+    EXPECT_FALSE(pool.claimConsolePort(5901));
+    EXPECT_TRUE(pool.claimConsolePort(7000));
+
+    auto fixed = pool.allocate("fixed", 5901);
+    ASSERT_FALSE(fixed.isErr()) << fixed.unwrapErr();
+    EXPECT_EQ(pool.consolePort("fixed"), 5901);
+    EXPECT_EQ(pool.reserveConsolePort(), 5900);
+    EXPECT_EQ(pool.reserveConsolePort(), -1);
+
+    // removing the record frees the fixed port like any other
+    ASSERT_TRUE(pool.remove(fixed.unwrap()));
+    EXPECT_EQ(pool.reserveConsolePort(), 5901);
+}
+
+} // namespace